@@ -339,6 +339,42 @@ protected:
 };
 using SeparableFilter = SeparableFilterForward;
 
+/*!
+ * \brief convert, resize and normalize uint8 images into network inputs
+ *
+ * Each output pixel is resized from the source image converted to BGR or
+ * RGB, rounded to uint8 like the naive and fallback Resize do, and then
+ * normalized as (x - mean[c]) * scale[c] for output channel c. The
+ * fixed-point LINEAR kernels that x86 and arm use for 3-channel uint8 NHWC
+ * Resize may round differently, so the result can differ from an unfused
+ * chain on those backends by one uint8 step, i.e. scale[c].
+ *
+ * src is a uint8 image in the layout given by param().src_format, and dst is
+ * Float32 or QuantizedS8 in the layout (N, 3, OH, OW) for NCHW, or
+ * (N, 1, OH, OW, 4) and (N, 1, OH, OW, 8) for NCHW44 and NCHW88, where the
+ * padded channels are zero.
+ */
+class ImagePreprocessForward : public OperatorBase {
+    DEF_OPR_IMPL(ImagePreprocessForward, OperatorBase, 1, 1);
+    DEF_OPR_PARAM(ImagePreprocess);
+
+public:
+    using InterpolationMode = Param::InterpolationMode;
+    using SrcFormat = Param::SrcFormat;
+
+    virtual void exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                      _megdnn_workspace workspace) = 0;
+    //! the dtype of dst is kept if it is valid, or set to Float32
+    void deduce_layout(const TensorLayout& src, TensorLayout& dst);
+    virtual size_t get_workspace_in_bytes(const TensorLayout& src,
+                                          const TensorLayout& dst) = 0;
+
+protected:
+    void check_exec(const TensorLayout& src, const TensorLayout& dst,
+                    size_t workspace_in_bytes);
+};
+using ImagePreprocess = ImagePreprocessForward;
+
 }  // namespace megdnn
 
 #include "megdnn/internal/opr_header_epilogue.h"
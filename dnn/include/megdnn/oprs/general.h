@@ -1210,7 +1210,14 @@ public:
             IndexingMultiAxisVecBase::AxisIndexerLayoutOnly;
     using IndexDescLayoutOnly = IndexingMultiAxisVecBase::IndexDescLayoutOnly;
 
-    size_t get_workspace_in_bytes(const TensorShape&, const size_t*, size_t) {
+    /*!
+     * \param indexed shape of the indexed tensor, i.e. dst of gather or
+     *      value of modifying oprs
+     * \param axes the axes with index vectors
+     */
+    virtual size_t get_workspace_in_bytes(const TensorShape& /* indexed */,
+                                          const size_t* /* axes */,
+                                          size_t /* nr_axes */) {
         return 0;
     }
 
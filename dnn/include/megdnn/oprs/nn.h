@@ -1849,6 +1849,171 @@ protected:
                     const TensorLayout& grad_s, size_t workspace_in_bytes);
 };
 
+/*!
+ * \brief normalize the trailing param().normalized_dim dims of data
+ *
+ * mean and rstd (reciprocal of the standard deviation) are computed over the
+ * normalized dims and have the shape of the leading dims; weight and bias
+ * have the shape of the normalized dims and are only used if param().affine
+ * is set.
+ */
+class LayerNormBase : public OperatorBase {
+    DEF_OPR_IMPL_CTOR(LayerNormBase, OperatorBase);
+    DEF_OPR_PARAM(LayerNorm);
+
+protected:
+    void deduce_layout_fwd(const TensorLayout& data, const TensorLayout& weight,
+                           const TensorLayout& bias, TensorLayout& dst,
+                           TensorLayout& mean, TensorLayout& rstd);
+    void check_layout_fwd(const TensorLayout& data, const TensorLayout& weight,
+                          const TensorLayout& bias, const TensorLayout& dst,
+                          const TensorLayout& mean, const TensorLayout& rstd);
+};
+
+class LayerNormForward : public LayerNormBase {
+    DEF_OPR_IMPL(LayerNormForward, LayerNormBase, 3, 3);
+
+public:
+    virtual void exec(_megdnn_tensor_in data, _megdnn_tensor_in weight,
+                      _megdnn_tensor_in bias, _megdnn_tensor_out dst,
+                      _megdnn_tensor_out mean, _megdnn_tensor_out rstd,
+                      _megdnn_workspace workspace) = 0;
+    void deduce_layout(const TensorLayout& data, const TensorLayout& weight,
+                       const TensorLayout& bias, TensorLayout& dst,
+                       TensorLayout& mean, TensorLayout& rstd);
+    virtual size_t get_workspace_in_bytes(const TensorLayout& data,
+                                          const TensorLayout& weight,
+                                          const TensorLayout& bias,
+                                          const TensorLayout& dst,
+                                          const TensorLayout& mean,
+                                          const TensorLayout& rstd) = 0;
+
+protected:
+    void check_exec(const TensorLayout& data, const TensorLayout& weight,
+                    const TensorLayout& bias, const TensorLayout& dst,
+                    const TensorLayout& mean, const TensorLayout& rstd,
+                    size_t workspace_in_bytes);
+};
+using LayerNorm = LayerNormForward;
+
+class LayerNormBackward : public LayerNormBase {
+    DEF_OPR_IMPL(LayerNormBackward, LayerNormBase, 5, 3);
+
+public:
+    virtual void exec(_megdnn_tensor_in diff, _megdnn_tensor_in data,
+                      _megdnn_tensor_in weight, _megdnn_tensor_in mean,
+                      _megdnn_tensor_in rstd, _megdnn_tensor_out ddata,
+                      _megdnn_tensor_out dweight, _megdnn_tensor_out dbias,
+                      _megdnn_workspace workspace) = 0;
+    void deduce_layout(const TensorLayout& diff, const TensorLayout& data,
+                       const TensorLayout& weight, const TensorLayout& mean,
+                       const TensorLayout& rstd, TensorLayout& ddata,
+                       TensorLayout& dweight, TensorLayout& dbias);
+    virtual size_t get_workspace_in_bytes(const TensorLayout& diff,
+                                          const TensorLayout& data,
+                                          const TensorLayout& weight,
+                                          const TensorLayout& mean,
+                                          const TensorLayout& rstd,
+                                          const TensorLayout& ddata,
+                                          const TensorLayout& dweight,
+                                          const TensorLayout& dbias) = 0;
+
+protected:
+    void check_exec(const TensorLayout& diff, const TensorLayout& data,
+                    const TensorLayout& weight, const TensorLayout& mean,
+                    const TensorLayout& rstd, const TensorLayout& ddata,
+                    const TensorLayout& dweight, const TensorLayout& dbias,
+                    size_t workspace_in_bytes);
+};
+
+/*!
+ * \brief dst = exp(src) / sum(exp(src)) along param().axis
+ */
+class SoftmaxBase : public OperatorBase {
+    DEF_OPR_IMPL_CTOR(SoftmaxBase, OperatorBase);
+    DEF_OPR_PARAM(Softmax);
+
+protected:
+    //! normalized axis of a layout
+    size_t get_axis(const TensorLayout& layout) const;
+    void deduce_layout_fwd(const TensorLayout& src, TensorLayout& dst);
+    void check_layout_fwd(const TensorLayout& src, const TensorLayout& dst);
+};
+
+class SoftmaxForward : public SoftmaxBase {
+    DEF_OPR_IMPL(SoftmaxForward, SoftmaxBase, 1, 1);
+
+public:
+    virtual void exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                      _megdnn_workspace workspace) = 0;
+    void deduce_layout(const TensorLayout& src, TensorLayout& dst);
+    virtual size_t get_workspace_in_bytes(const TensorLayout& src,
+                                          const TensorLayout& dst) = 0;
+
+protected:
+    void check_exec(const TensorLayout& src, const TensorLayout& dst,
+                    size_t workspace_in_bytes);
+};
+using Softmax = SoftmaxForward;
+
+/*!
+ * \brief grad = (diff - sum(diff * dst)) * dst, where dst is the output of
+ *      the forward opr
+ */
+class SoftmaxBackward : public SoftmaxBase {
+    DEF_OPR_IMPL(SoftmaxBackward, SoftmaxBase, 2, 1);
+
+public:
+    virtual void exec(_megdnn_tensor_in dst, _megdnn_tensor_in diff,
+                      _megdnn_tensor_out grad, _megdnn_workspace workspace) = 0;
+    virtual size_t get_workspace_in_bytes(const TensorLayout& dst,
+                                          const TensorLayout& diff,
+                                          const TensorLayout& grad) = 0;
+
+protected:
+    void check_exec(const TensorLayout& dst, const TensorLayout& diff,
+                    const TensorLayout& grad, size_t workspace_in_bytes);
+};
+
+/*!
+ * \brief dst = softmax(param().scale * q * k^T + mask) * v, computed without
+ *      materializing the attention scores
+ *
+ * q, k and v have the shapes (..., Sq, D), (..., Sk, D) and (..., Sk, Dv),
+ * where the leading dims (e.g. batch and head) must be the same; dst has the
+ * shape (..., Sq, Dv). mask is optional and is added to the scaled scores; it
+ * has the same ndim as q and each dim is either equal to that of the scores
+ * (..., Sq, Sk) or 1 to be broadcast. A query whose keys are all masked out
+ * (by -inf in mask, or by the causal mask if Sq > Sk) gives NaN, like the
+ * softmax of the unfused graph.
+ */
+class AttentionForward : public OperatorBase {
+    DEF_OPR_IMPL(AttentionForward, OperatorBase, 4, 1);
+    DEF_OPR_PARAM(Attention);
+
+public:
+    /*!
+     * \param mask an empty tensor (ndim == 0) if there is no mask
+     */
+    virtual void exec(_megdnn_tensor_in q, _megdnn_tensor_in k,
+                      _megdnn_tensor_in v, _megdnn_tensor_in mask,
+                      _megdnn_tensor_out dst, _megdnn_workspace workspace) = 0;
+    void deduce_layout(const TensorLayout& q, const TensorLayout& k,
+                       const TensorLayout& v, const TensorLayout& mask,
+                       TensorLayout& dst);
+    virtual size_t get_workspace_in_bytes(const TensorLayout& q,
+                                          const TensorLayout& k,
+                                          const TensorLayout& v,
+                                          const TensorLayout& mask,
+                                          const TensorLayout& dst) = 0;
+
+protected:
+    void check_exec(const TensorLayout& q, const TensorLayout& k,
+                    const TensorLayout& v, const TensorLayout& mask,
+                    const TensorLayout& dst, size_t workspace_in_bytes);
+};
+using Attention = AttentionForward;
+
 }  // namespace megdnn
 #include "megdnn/internal/opr_header_epilogue.h"
 
@@ -1164,3 +1164,45 @@ Note: NCHW_NCHW4_WEIGHT will auto pad oc and ic, you should remove oc in later o
  add_fields('int32', 'qmax', '2147483647')
  )
 
+
+(pdef('LayerNorm').
+ add_fields('bool', Doc('affine', 'whether to apply weight and bias'), 'true').
+ add_fields('float32', Doc('eps', 'added to the variance for stability'),
+            '1e-5f').
+ add_fields('uint64',
+            Doc('normalized_dim', 'number of trailing dims to be normalized'),
+            '1',
+            Doc('normalized_size', 'product of the normalized trailing dims'),
+            '1')
+ )
+
+(pdef('Softmax').
+ add_fields('int32', Doc('axis', 'axis along which softmax is computed; '
+                         'negative value counts from the last axis'), '-1')
+ )
+
+(pdef('Attention').
+ add_fields('float32', Doc('scale', 'scale of q * k^T before softmax'), '1.f').
+ add_fields('bool', Doc('causal', 'whether to mask out the keys after the '
+                        'query position, aligned at the last key'), 'false')
+ )
+
+(pdef('ImagePreprocess').
+ add_enum(Doc('SrcFormat', 'format of the uint8 source image, which is NHWC '
+              'with 3 channels for BGR and RGB, and (N, H * 3 / 2, W, 1) for '
+              'the BT.601 YUV420 semi-planar NV21 and NV12'),
+          'BGR', 'RGB', 'NV21', 'NV12', name_field='src_format').
+ add_enum_alias('Format', 'Convolution').
+ add_enum_alias('InterpolationMode', 'WarpPerspectiveV1', name_field='imode').
+ add_fields('bool', Doc('rgb', 'whether the output channels are in RGB '
+                        'order rather than BGR'), 'false').
+ add_fields('uint32',
+            Doc('oh', 'output height, or 0 to keep the source height'), '0',
+            Doc('ow', 'output width, or 0 to keep the source width'), '0').
+ add_fields('float32',
+            Doc('mean0', 'mean subtracted from output channel 0'), '0.f',
+            'mean1', '0.f', 'mean2', '0.f',
+            Doc('scale0', 'scale multiplied to output channel 0 after '
+                'subtracting the mean'), '1.f',
+            'scale1', '1.f', 'scale2', '1.f')
+ )
@@ -0,0 +1,82 @@
+/**
+ * \file dnn/src/common/attention.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megdnn/oprs.h"
+#include "src/common/utils.h"
+
+namespace megdnn {
+
+void AttentionForward::deduce_layout(const TensorLayout& q,
+                                     const TensorLayout& k,
+                                     const TensorLayout& v,
+                                     const TensorLayout&, TensorLayout& dst) {
+    megdnn_assert(q.ndim >= 3 && v.ndim == q.ndim, "%s",
+                  megdnn_layout_msg(q).c_str());
+    MEGDNN_MARK_USED_VAR(k);
+    dst = TensorLayout{q, q.dtype};
+    dst.shape[dst.ndim - 1] = v.shape[v.ndim - 1];
+    dst.init_contiguous_stride();
+}
+
+void AttentionForward::check_exec(const TensorLayout& q, const TensorLayout& k,
+                                  const TensorLayout& v,
+                                  const TensorLayout& mask,
+                                  const TensorLayout& dst,
+                                  size_t workspace_in_bytes) {
+    auto errmsg = [&]() {
+        return megdnn_layout_msg(q) + ", " + megdnn_layout_msg(k) + ", " +
+               megdnn_layout_msg(v) + ", " + megdnn_layout_msg(mask) + ", " +
+               megdnn_layout_msg(dst);
+    };
+    MEGDNN_MARK_USED_VAR(errmsg);
+    megdnn_assert(q.dtype.category() == DTypeCategory::FLOAT &&
+                          q.dtype == k.dtype && q.dtype == v.dtype &&
+                          q.dtype == dst.dtype,
+                  "%s", errmsg().c_str());
+    megdnn_assert(q.ndim >= 3 && k.ndim == q.ndim && v.ndim == q.ndim &&
+                          dst.ndim == q.ndim,
+                  "%s", errmsg().c_str());
+    megdnn_assert_contiguous(q);
+    megdnn_assert_contiguous(k);
+    megdnn_assert_contiguous(v);
+    megdnn_assert_contiguous(dst);
+    size_t n = q.ndim;
+    for (size_t i = 0; i + 2 < n; ++i) {
+        megdnn_assert(k.shape[i] == q.shape[i] && v.shape[i] == q.shape[i] &&
+                              dst.shape[i] == q.shape[i],
+                      "%s", errmsg().c_str());
+    }
+    // Sq, Sk, D and Dv
+    megdnn_assert(k.shape[n - 1] == q.shape[n - 1] &&
+                          v.shape[n - 2] == k.shape[n - 2] &&
+                          dst.shape[n - 2] == q.shape[n - 2] &&
+                          dst.shape[n - 1] == v.shape[n - 1],
+                  "%s", errmsg().c_str());
+    if (mask.ndim) {
+        megdnn_assert(mask.dtype == q.dtype && mask.ndim == n,
+                      "%s", errmsg().c_str());
+        megdnn_assert_contiguous(mask);
+        for (size_t i = 0; i < n; ++i) {
+            size_t expect = i + 1 == n ? k.shape[n - 2] : q.shape[i];
+            megdnn_assert(mask.shape[i] == expect || mask.shape[i] == 1,
+                          "mask can not be broadcast to the scores: %s",
+                          errmsg().c_str());
+        }
+    }
+    auto required_workspace_in_bytes =
+            get_workspace_in_bytes(q, k, v, mask, dst);
+    megdnn_assert(workspace_in_bytes >= required_workspace_in_bytes);
+}
+
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,66 @@
+/**
+ * \file dnn/src/common/attention_helper.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "megdnn/basic_types.h"
+
+namespace megdnn {
+namespace attention {
+
+//! sizes of an attention problem with the leading dims flattened to batch
+struct Shape {
+    size_t batch, sq, sk, d, dv;
+
+    Shape(const TensorLayout& q, const TensorLayout& k, const TensorLayout& v) {
+        size_t n = q.ndim;
+        batch = 1;
+        for (size_t i = 0; i + 2 < n; ++i) {
+            batch *= q.shape[i];
+        }
+        sq = q.shape[n - 2];
+        sk = k.shape[n - 2];
+        d = q.shape[n - 1];
+        dv = v.shape[n - 1];
+    }
+
+    //! whether key j is masked out for query i by the causal mask
+    bool causal_masked(size_t i, size_t j) const { return j + sq > i + sk; }
+};
+
+/*!
+ * \brief the mask broadcast to the scores (..., Sq, Sk), which has zero
+ *      strides on the broadcast dims
+ */
+static inline TensorLayout broadcast_mask(const TensorLayout& mask,
+                                          const TensorLayout& q,
+                                          const TensorLayout& k) {
+    TensorShape scores = q;
+    scores.shape[scores.ndim - 1] = k.shape[k.ndim - 2];
+    return mask.broadcast(scores);
+}
+
+//! offset of the mask of the \p b-th flattened batch
+static inline ptrdiff_t mask_batch_offset(const TensorLayout& bmask,
+                                          size_t b) {
+    ptrdiff_t offset = 0;
+    for (size_t i = bmask.ndim - 2; i-- > 0;) {
+        offset += static_cast<ptrdiff_t>(b % bmask.shape[i]) *
+                  bmask.stride[i];
+        b /= bmask.shape[i];
+    }
+    return offset;
+}
+
+}  // namespace attention
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
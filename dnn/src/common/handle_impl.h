@@ -216,7 +216,13 @@ private:
     cb(TQTBackward) \
     cb(CheckHasInf) \
     cb(LSQForward) \
-    cb(LSQBackward)
+    cb(LSQBackward) \
+    cb(LayerNormForward) \
+    cb(LayerNormBackward) \
+    cb(SoftmaxForward) \
+    cb(SoftmaxBackward) \
+    cb(AttentionForward) \
+    cb(ImagePreprocessForward)
 
 /*!
  * \brief specialize HandleImpl::create_operator for a single opr type;
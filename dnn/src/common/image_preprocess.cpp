@@ -0,0 +1,74 @@
+/**
+ * \file dnn/src/common/image_preprocess.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megdnn/oprs.h"
+#include "src/common/image_preprocess_helper.h"
+#include "src/common/utils.h"
+
+namespace megdnn {
+
+void ImagePreprocessForward::deduce_layout(const TensorLayout& src,
+                                           TensorLayout& dst) {
+    auto errmsg = [&]() { return megdnn_layout_msg(src); };
+    MEGDNN_MARK_USED_VAR(errmsg);
+    auto&& p = param();
+    bool yuv = image_preprocess::is_yuv(p.src_format);
+    megdnn_assert(src.ndim == 4 && src.shape[3] == (yuv ? 1_z : 3_z), "%s",
+                  errmsg().c_str());
+    size_t ih = src.shape[1], iw = src.shape[2];
+    if (yuv) {
+        megdnn_assert(ih % 3 == 0 && ih / 3 % 2 == 0 && iw % 2 == 0,
+                      "NV21 and NV12 images must have even height and width: "
+                      "%s",
+                      errmsg().c_str());
+        ih = ih / 3 * 2;
+    }
+    size_t oh = p.oh ? p.oh : ih, ow = p.ow ? p.ow : iw;
+    size_t pack = image_preprocess::pack_size(p.format);
+    megdnn_assert(pack, "unsupported format of ImagePreprocess: %d",
+                  static_cast<int>(p.format));
+    DType dtype = dst.dtype.valid() ? dst.dtype : dtype::Float32();
+    if (pack == 1) {
+        dst = TensorLayout{{src.shape[0], 3, oh, ow}, dtype};
+    } else {
+        dst = TensorLayout{{src.shape[0], 1, oh, ow, pack}, dtype};
+    }
+}
+
+void ImagePreprocessForward::check_exec(const TensorLayout& src,
+                                        const TensorLayout& dst,
+                                        size_t workspace_in_bytes) {
+    auto errmsg = [&]() {
+        return megdnn_layout_msg(src) + ", " + megdnn_layout_msg(dst);
+    };
+    MEGDNN_MARK_USED_VAR(errmsg);
+    megdnn_assert(src.dtype == dtype::Uint8() &&
+                          (dst.dtype == dtype::Float32() ||
+                           dst.dtype.enumv() == DTypeEnum::QuantizedS8),
+                  "ImagePreprocess only supports Uint8 to Float32 or "
+                  "QuantizedS8: %s",
+                  errmsg().c_str());
+    megdnn_assert(param().imode == InterpolationMode::LINEAR ||
+                          param().imode == InterpolationMode::NEAREST,
+                  "ImagePreprocess only supports LINEAR and NEAREST");
+    megdnn_assert_contiguous(src);
+    megdnn_assert_contiguous(dst);
+    TensorLayout dst_expected{dst.dtype};
+    deduce_layout(src, dst_expected);
+    megdnn_assert_eq_shape(dst_expected, dst);
+    auto required_workspace_in_bytes = get_workspace_in_bytes(src, dst);
+    megdnn_assert(workspace_in_bytes >= required_workspace_in_bytes);
+}
+
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
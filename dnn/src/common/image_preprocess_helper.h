@@ -0,0 +1,194 @@
+/**
+ * \file dnn/src/common/image_preprocess_helper.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "megdnn/basic_types.h"
+#include "megdnn/opr_param_defs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace megdnn {
+namespace image_preprocess {
+
+using Param = param::ImagePreprocess;
+
+static inline bool is_yuv(Param::SrcFormat src_format) {
+    return src_format == Param::SrcFormat::NV21 ||
+           src_format == Param::SrcFormat::NV12;
+}
+
+//! number of channels in a pack of the output format, or 0 if unsupported
+static inline size_t pack_size(Param::Format format) {
+    switch (format) {
+        case Param::Format::NCHW:
+            return 1;
+        case Param::Format::NCHW44:
+            return 4;
+        case Param::Format::NCHW88:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+//! sizes of an image preprocess problem
+struct Shape {
+    size_t n, ih, iw, oh, ow, pack;
+
+    Shape(const Param& param, const TensorLayout& src,
+          const TensorLayout& dst) {
+        n = src.shape[0];
+        ih = is_yuv(param.src_format) ? src.shape[1] / 3 * 2 : src.shape[1];
+        iw = src.shape[2];
+        oh = dst.shape[2];
+        ow = dst.shape[3];
+        pack = pack_size(param.format);
+    }
+
+    //! offset of output channel c of pixel (h, w) in the n-th image
+    size_t dst_offset(size_t b, size_t c, size_t h, size_t w) const {
+        if (pack == 1) {
+            return ((b * 3 + c) * oh + h) * ow + w;
+        }
+        return ((b * oh + h) * ow + w) * pack + c;
+    }
+};
+
+//! source coordinates of an output coordinate and the weight of \p i1
+struct Coord {
+    int i0, i1;
+    float alpha;
+};
+
+/*!
+ * \brief map an output coordinate to the source like Resize does on uint8
+ *      images
+ */
+static inline Coord get_coord(Param::InterpolationMode imode, int isize,
+                              int osize, int idx) {
+    if (imode == Param::InterpolationMode::NEAREST) {
+        double scale = static_cast<double>(osize) / isize;
+        int i = static_cast<int>(std::floor(idx * (1.0 / scale)));
+        i = std::min(std::max(i, 0), isize - 1);
+        return {i, i, 0.f};
+    }
+    if (isize == 1) {
+        return {0, 0, 0.f};
+    }
+    float scale = static_cast<float>(osize) / isize;
+    float alpha = (idx + 0.5f) / scale - 0.5f;
+    int i0 = static_cast<int>(std::floor(alpha));
+    alpha -= i0;
+    if (i0 < 0) {
+        i0 = 0;
+        alpha = 0;
+    } else if (i0 + 1 >= isize) {
+        i0 = isize - 2;
+        alpha = 1;
+    }
+    return {i0, i0 + 1, alpha};
+}
+
+static inline uint8_t saturate_u8(int32_t x) {
+    return static_cast<uint8_t>(std::min(std::max(x, 0), 255));
+}
+
+/*!
+ * \brief BT.601 YUV to BGR, which is the same as the BT601 modes of CvtColor
+ *
+ * The fixed point approximation comes from libyuv.
+ */
+static inline void yuv2bgr(int y, int u, int v, uint8_t* bgr) {
+    constexpr int YG = 18997, YGB = -1160, UB = -128, UG = 25, VG = 52,
+                  VR = -102;
+    constexpr int BB = UB * 128 + YGB, BG = UG * 128 + VG * 128 + YGB,
+                  BR = VR * 128 + YGB;
+    int32_t y1 = static_cast<uint32_t>(y * 0x0101 * YG) >> 16;
+    bgr[0] = saturate_u8((-(u * UB) + y1 + BB) >> 6);
+    bgr[1] = saturate_u8((-(u * UG + v * VG) + y1 + BG) >> 6);
+    bgr[2] = saturate_u8((-(v * VR) + y1 + BR) >> 6);
+}
+
+/*!
+ * \brief convert row \p y of an image to BGR
+ *
+ * \param img the first byte of the image
+ * \param[out] bgr BGR values of the row, with 3 * iw bytes
+ */
+static inline void cvt_row(Param::SrcFormat src_format, const uint8_t* img,
+                           size_t ih, size_t iw, size_t y, uint8_t* bgr) {
+    switch (src_format) {
+        case Param::SrcFormat::BGR:
+            std::copy(img + y * iw * 3, img + (y + 1) * iw * 3, bgr);
+            return;
+        case Param::SrcFormat::RGB: {
+            const uint8_t* row = img + y * iw * 3;
+            for (size_t x = 0; x < iw; ++x) {
+                bgr[x * 3] = row[x * 3 + 2];
+                bgr[x * 3 + 1] = row[x * 3 + 1];
+                bgr[x * 3 + 2] = row[x * 3];
+            }
+            return;
+        }
+        default: {
+            // V comes first in NV21 and U in NV12
+            const uint8_t* row = img + y * iw;
+            const uint8_t* uv = img + (ih + y / 2) * iw;
+            size_t ui = src_format == Param::SrcFormat::NV12 ? 0 : 1;
+            for (size_t x = 0; x < iw; ++x) {
+                size_t x0 = x & ~static_cast<size_t>(1);
+                yuv2bgr(row[x], uv[x0 + ui], uv[x0 + 1 - ui], bgr + x * 3);
+            }
+            return;
+        }
+    }
+}
+
+//! index in BGR of output channel \p c
+static inline size_t bgr_index(const Param& param, size_t c) {
+    return param.rgb ? 2 - c : c;
+}
+
+//! mean and scale of the output channels
+struct Normalize {
+    float mean[3], scale[3];
+
+    explicit Normalize(const Param& param)
+            : mean{param.mean0, param.mean1, param.mean2},
+              scale{param.scale0, param.scale1, param.scale2} {}
+
+    float operator()(float x, size_t c) const {
+        return (x - mean[c]) * scale[c];
+    }
+};
+
+//! convert normalized values to the output dtype
+template <typename ctype>
+struct OutputCvt {
+    explicit OutputCvt(DType) {}
+    ctype operator()(float x) const { return x; }
+};
+
+template <>
+struct OutputCvt<dt_qint8> {
+    DTypeParam<dtype::QuantizedS8> param;
+    explicit OutputCvt(DType dtype)
+            : param{dtype.param<dtype::QuantizedS8>()} {}
+    dt_qint8 operator()(float x) const { return param.quantize(x); }
+};
+
+}  // namespace image_preprocess
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,143 @@
+/**
+ * \file dnn/src/common/layer_norm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megdnn/oprs.h"
+#include "src/common/utils.h"
+
+namespace megdnn {
+
+void LayerNormBase::deduce_layout_fwd(const TensorLayout& data,
+                                      const TensorLayout& /* weight */,
+                                      const TensorLayout& /* bias */,
+                                      TensorLayout& dst, TensorLayout& mean,
+                                      TensorLayout& rstd) {
+    auto normalized_dim = param().normalized_dim;
+    megdnn_assert(normalized_dim > 0 && normalized_dim <= data.ndim,
+                  "invalid normalized_dim %zu for %s",
+                  static_cast<size_t>(normalized_dim),
+                  data.to_string().c_str());
+    TensorShape unnormalized_shape;
+    unnormalized_shape.ndim = data.ndim - normalized_dim;
+    for (size_t i = 0; i < unnormalized_shape.ndim; ++i) {
+        unnormalized_shape.shape[i] = data.shape[i];
+    }
+    if (!unnormalized_shape.ndim) {
+        unnormalized_shape = TensorShape{1};
+    }
+    dst = TensorLayout{data, data.dtype};
+    mean = TensorLayout{unnormalized_shape, dtype::Float32()};
+    rstd = TensorLayout{unnormalized_shape, dtype::Float32()};
+}
+
+void LayerNormBase::check_layout_fwd(const TensorLayout& data,
+                                     const TensorLayout& weight,
+                                     const TensorLayout& bias,
+                                     const TensorLayout& dst,
+                                     const TensorLayout& mean,
+                                     const TensorLayout& rstd) {
+    auto errmsg = [&]() {
+        return megdnn_layout_msg(data) + ", " + megdnn_layout_msg(weight) +
+               ", " + megdnn_layout_msg(bias) + ", " + megdnn_layout_msg(dst) +
+               ", " + megdnn_layout_msg(mean) + ", " + megdnn_layout_msg(rstd);
+    };
+    MEGDNN_MARK_USED_VAR(errmsg);
+    megdnn_assert(data.dtype.category() == DTypeCategory::FLOAT, "%s",
+                  errmsg().c_str());
+    megdnn_assert_contiguous(data);
+    megdnn_assert_contiguous(dst);
+    megdnn_assert_contiguous(mean);
+    megdnn_assert_contiguous(rstd);
+    TensorLayout dst_expected, mean_expected, rstd_expected;
+    deduce_layout_fwd(data, weight, bias, dst_expected, mean_expected,
+                      rstd_expected);
+    megdnn_assert_eq_layout(dst_expected, dst);
+    megdnn_assert_eq_layout(mean_expected, mean);
+    megdnn_assert_eq_layout(rstd_expected, rstd);
+
+    size_t normalized_size = 1;
+    for (size_t i = data.ndim - param().normalized_dim; i < data.ndim; ++i) {
+        normalized_size *= data.shape[i];
+    }
+    megdnn_assert(normalized_size == param().normalized_size,
+                  "normalized_size mismatch: expect=%zu got=%zu; %s",
+                  normalized_size, static_cast<size_t>(param().normalized_size),
+                  errmsg().c_str());
+    if (param().affine) {
+        megdnn_assert_contiguous(weight);
+        megdnn_assert_contiguous(bias);
+        megdnn_assert(weight.dtype == data.dtype && bias.dtype == data.dtype,
+                      "%s", errmsg().c_str());
+        megdnn_assert(weight.total_nr_elems() == normalized_size &&
+                              bias.total_nr_elems() == normalized_size,
+                      "%s", errmsg().c_str());
+    }
+}
+
+void LayerNormForward::deduce_layout(const TensorLayout& data,
+                                     const TensorLayout& weight,
+                                     const TensorLayout& bias,
+                                     TensorLayout& dst, TensorLayout& mean,
+                                     TensorLayout& rstd) {
+    deduce_layout_fwd(data, weight, bias, dst, mean, rstd);
+}
+
+void LayerNormForward::check_exec(const TensorLayout& data,
+                                  const TensorLayout& weight,
+                                  const TensorLayout& bias,
+                                  const TensorLayout& dst,
+                                  const TensorLayout& mean,
+                                  const TensorLayout& rstd,
+                                  size_t workspace_in_bytes) {
+    check_layout_fwd(data, weight, bias, dst, mean, rstd);
+    auto required_workspace_in_bytes =
+            get_workspace_in_bytes(data, weight, bias, dst, mean, rstd);
+    megdnn_assert(workspace_in_bytes >= required_workspace_in_bytes);
+}
+
+void LayerNormBackward::deduce_layout(const TensorLayout& /* diff */,
+                                      const TensorLayout& data,
+                                      const TensorLayout& weight,
+                                      const TensorLayout& /* mean */,
+                                      const TensorLayout& /* rstd */,
+                                      TensorLayout& ddata,
+                                      TensorLayout& dweight,
+                                      TensorLayout& dbias) {
+    ddata = TensorLayout{data, data.dtype};
+    if (param().affine) {
+        dweight = TensorLayout{weight, weight.dtype};
+        dbias = TensorLayout{weight, weight.dtype};
+    } else {
+        dweight = TensorLayout{TensorShape{1}, data.dtype};
+        dbias = TensorLayout{TensorShape{1}, data.dtype};
+    }
+}
+
+void LayerNormBackward::check_exec(
+        const TensorLayout& diff, const TensorLayout& data,
+        const TensorLayout& weight, const TensorLayout& mean,
+        const TensorLayout& rstd, const TensorLayout& ddata,
+        const TensorLayout& dweight, const TensorLayout& dbias,
+        size_t workspace_in_bytes) {
+    check_layout_fwd(data, weight, weight, diff, mean, rstd);
+    megdnn_assert_eq_layout(data, ddata);
+    if (param().affine) {
+        megdnn_assert_eq_layout(weight, dweight);
+        megdnn_assert_eq_layout(weight, dbias);
+    }
+    auto required_workspace_in_bytes = get_workspace_in_bytes(
+            diff, data, weight, mean, rstd, ddata, dweight, dbias);
+    megdnn_assert(workspace_in_bytes >= required_workspace_in_bytes);
+}
+
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -130,6 +130,12 @@ DEF(ChecksumForward, 1, true, false);
 DEF(CheckHasInf, 2, true, true);
 DEF(LSQForward, 5, true, true);
 DEF(LSQBackward, 7, true, false);
+DEF(LayerNormForward, 6, true, true);
+DEF(LayerNormBackward, 8, true, true);
+DEF(SoftmaxForward, 2, true, true);
+DEF(SoftmaxBackward, 3, true, false);
+DEF(AttentionForward, 5, true, true);
+DEF(ImagePreprocessForward, 2, true, true);
 }  // namespace megdnn
 
 // vim: syntax=cpp.doxygen
@@ -0,0 +1,64 @@
+/**
+ * \file dnn/src/common/softmax.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megdnn/oprs.h"
+#include "src/common/utils.h"
+
+namespace megdnn {
+
+size_t SoftmaxBase::get_axis(const TensorLayout& layout) const {
+    int axis = param().axis;
+    int ndim = layout.ndim;
+    megdnn_assert(axis >= -ndim && axis < ndim, "invalid axis %d for %s", axis,
+                  layout.to_string().c_str());
+    return axis < 0 ? axis + ndim : axis;
+}
+
+void SoftmaxBase::deduce_layout_fwd(const TensorLayout& src,
+                                    TensorLayout& dst) {
+    dst = TensorLayout{src, src.dtype};
+}
+
+void SoftmaxBase::check_layout_fwd(const TensorLayout& src,
+                                   const TensorLayout& dst) {
+    megdnn_assert(src.dtype.category() == DTypeCategory::FLOAT, "%s",
+                  megdnn_layout_msg(src).c_str());
+    megdnn_assert_contiguous(src);
+    megdnn_assert_eq_layout(src, dst);
+    get_axis(src);
+}
+
+void SoftmaxForward::deduce_layout(const TensorLayout& src, TensorLayout& dst) {
+    deduce_layout_fwd(src, dst);
+}
+
+void SoftmaxForward::check_exec(const TensorLayout& src,
+                                const TensorLayout& dst,
+                                size_t workspace_in_bytes) {
+    check_layout_fwd(src, dst);
+    auto required_workspace_in_bytes = get_workspace_in_bytes(src, dst);
+    megdnn_assert(workspace_in_bytes >= required_workspace_in_bytes);
+}
+
+void SoftmaxBackward::check_exec(const TensorLayout& dst,
+                                 const TensorLayout& diff,
+                                 const TensorLayout& grad,
+                                 size_t workspace_in_bytes) {
+    check_layout_fwd(dst, grad);
+    megdnn_assert_eq_layout(dst, diff);
+    auto required_workspace_in_bytes = get_workspace_in_bytes(dst, diff, grad);
+    megdnn_assert(workspace_in_bytes >= required_workspace_in_bytes);
+}
+
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,29 @@
+/**
+ * \file dnn/src/cuda/softmax/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/cuda/softmax/opr_impl.h"
+#include "src/common/utils.h"
+
+using namespace megdnn;
+using namespace cuda;
+
+void SoftmaxForwardImpl::exec(_megdnn_tensor_in, _megdnn_tensor_out,
+                              _megdnn_workspace) {
+    megdnn_throw("SoftmaxForward not support in cuda");
+}
+
+void SoftmaxBackwardImpl::exec(_megdnn_tensor_in, _megdnn_tensor_in,
+                               _megdnn_tensor_out, _megdnn_workspace) {
+    megdnn_throw("SoftmaxBackward not support in cuda");
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,100 @@
+/**
+ * \file dnn/src/fallback/argsort/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/argsort/opr_impl.h"
+#include "src/common/utils.h"
+#include "src/fallback/topk/radix_helper.h"
+#include "src/naive/handle.h"
+
+#include <limits>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_argsort)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+
+template <typename ctype>
+void forward_row(size_t N, const ctype* sptr, ctype* dptr, dt_int32* iptr,
+                 bool ascending, uint64_t* buf) {
+    // for descending order, sort complemented keys with ties in descending
+    // order of indices, as std::greater<std::pair<ctype, int>>
+    uint64_t* items = buf;
+    for (size_t i = 0; i < N; ++i) {
+        uint32_t key = radix::KeyTrait<ctype>::to_key(sptr[i]);
+        uint64_t item;
+        if (ascending) {
+            item = static_cast<uint64_t>(key) << 32 | i;
+            items[i] = item;
+        } else {
+            item = static_cast<uint64_t>(~key) << 32 |
+                   static_cast<uint32_t>(~i);
+            items[N - 1 - i] = item;
+        }
+    }
+    items = radix::sort_items(items, buf + N, N);
+    for (size_t i = 0; i < N; ++i) {
+        uint32_t tie = radix::item_tie(items[i]);
+        uint32_t idx = ascending ? tie : ~tie;
+        dptr[i] = sptr[idx];
+        iptr[i] = idx;
+    }
+}
+
+}  // anonymous namespace
+
+void ArgsortForwardImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                              _megdnn_tensor_out indices,
+                              _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, indices.layout, workspace.size);
+    size_t M = src.layout.shape[0], N = src.layout.shape[1];
+    megdnn_assert(N <= std::numeric_limits<uint32_t>::max());
+    auto iptr = indices.ptr<dt_int32>();
+    auto wptr = workspace.ptr<uint64_t>();
+    bool ascending = param().order == Order::ASCENDING;
+    switch (src.layout.dtype.enumv()) {
+#define cb(dt)                                                              \
+    case DTypeTrait<dt>::enumv:                                             \
+        MIDOUT_BEGIN(megdnn_fallback_argsort, midout_iv(0), dt) {           \
+            using ctype = DTypeTrait<dt>::ctype;                            \
+            auto sptr = src.ptr<ctype>();                                   \
+            auto dptr = dst.ptr<ctype>();                                   \
+            auto kern = [=](size_t m, size_t thread_id) {                   \
+                forward_row(N, sptr + m * N, dptr + m * N, iptr + m * N,    \
+                            ascending, wptr + thread_id * N * 2);           \
+            };                                                              \
+            MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, M);             \
+            return;                                                         \
+        }                                                                   \
+        MIDOUT_END();                                                       \
+        break;
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+#undef cb
+        default:
+            break;
+    }
+    megdnn_throw("bad dtype");
+}
+
+size_t ArgsortForwardImpl::get_workspace_in_bytes(const TensorLayout& src,
+                                                  const TensorLayout&,
+                                                  const TensorLayout&) {
+    size_t nr_threads = static_cast<naive::HandleImpl*>(handle())
+                                ->megcore_dispatcher()
+                                ->nr_threads();
+    // the items to be sorted and the radix sort buffer
+    return sizeof(uint64_t) * 2 * src[1] * nr_threads;
+}
+
+// vim: syntax=cpp.doxygen
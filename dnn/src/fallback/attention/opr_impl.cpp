@@ -0,0 +1,286 @@
+/**
+ * \file dnn/src/fallback/attention/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/attention/opr_impl.h"
+#include "src/common/attention_helper.h"
+#include "src/common/utils.h"
+#include "src/fallback/float4_helper.h"
+#include "src/naive/handle.h"
+
+#include <limits>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_attention)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+using F4 = Float4;
+
+/*
+ * Each task processes blocks of Q_BLOCK queries; for each block of K_BLOCK
+ * keys, the keys and values are reused by all the queries in the block while
+ * they are in cache.
+ */
+constexpr size_t Q_BLOCK = 8, K_BLOCK = 64;
+
+constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+size_t get_nr_tasks(Handle* handle, const attention::Shape& s) {
+    size_t nr_units = s.batch * ((s.sq + Q_BLOCK - 1) / Q_BLOCK);
+    return std::max<size_t>(1, std::min(get_nr_threads(handle), nr_units));
+}
+
+//! floats of the workspace of each task: the score tile, and the running max,
+//! sum and output of each query
+size_t task_workspace_size(const attention::Shape& s) {
+    return Q_BLOCK * (K_BLOCK + 2 + s.dv);
+}
+
+float dot(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    float ret = 0;
+    if (n >= 4) {
+        auto acc0 = F4::mul(F4::load(a), F4::load(b)), acc1 = F4::set1(0.f);
+        for (i = 4; i + 8 <= n; i += 8) {
+            acc0 = F4::add(acc0, F4::mul(F4::load(a + i), F4::load(b + i)));
+            acc1 = F4::add(acc1,
+                           F4::mul(F4::load(a + i + 4), F4::load(b + i + 4)));
+        }
+        if (i + 4 <= n) {
+            acc0 = F4::add(acc0, F4::mul(F4::load(a + i), F4::load(b + i)));
+            i += 4;
+        }
+        ret = F4::reduce_add(F4::add(acc0, acc1));
+    }
+    for (; i < n; ++i) {
+        ret += a[i] * b[i];
+    }
+    return ret;
+}
+
+//! dst = dst * alpha + x * beta
+void scale_axpy(float* dst, float alpha, const float* x, float beta,
+                size_t n) {
+    size_t i = 0;
+    auto valpha = F4::set1(alpha), vbeta = F4::set1(beta);
+    for (; i + 4 <= n; i += 4) {
+        F4::store(dst + i, F4::add(F4::mul(F4::load(dst + i), valpha),
+                                   F4::mul(F4::load(x + i), vbeta)));
+    }
+    for (; i < n; ++i) {
+        dst[i] = dst[i] * alpha + x[i] * beta;
+    }
+}
+
+//! dst += x * beta
+void axpy(float* dst, const float* x, float beta, size_t n) {
+    size_t i = 0;
+    auto vbeta = F4::set1(beta);
+    for (; i + 4 <= n; i += 4) {
+        F4::store(dst + i,
+                  F4::add(F4::load(dst + i), F4::mul(F4::load(x + i), vbeta)));
+    }
+    for (; i < n; ++i) {
+        dst[i] += x[i] * beta;
+    }
+}
+
+//! replace x with exp(x - max) and return the sum
+float exp_sum(float* x, size_t n, float max) {
+    size_t i = 0;
+    float sum = 0;
+    if (n >= 4) {
+        auto vmax = F4::set1(max), vsum = F4::set1(0.f);
+        for (; i + 4 <= n; i += 4) {
+            auto e = F4::exp(F4::sub(F4::load(x + i), vmax));
+            F4::store(x + i, e);
+            vsum = F4::add(vsum, e);
+        }
+        sum = F4::reduce_add(vsum);
+    }
+    for (; i < n; ++i) {
+        x[i] = std::exp(x[i] - max);
+        sum += x[i];
+    }
+    return sum;
+}
+
+struct Problem {
+    const float *q, *k, *v, *mask;
+    TensorLayout bmask;
+    float* dst;
+    attention::Shape shape;
+    float scale;
+    bool causal;
+};
+
+/*!
+ * \brief compute the queries [q_begin, q_end) of batch b
+ * \param ws workspace of task_workspace_size() floats
+ */
+void attention_block(const Problem& p, size_t b, size_t q_begin, size_t q_end,
+                     float* ws) {
+    auto&& s = p.shape;
+    size_t nr_q = q_end - q_begin;
+    float* tile = ws;
+    float* row_max = tile + Q_BLOCK * K_BLOCK;
+    float* row_sum = row_max + Q_BLOCK;
+    float* acc = row_sum + Q_BLOCK;
+    std::fill(row_max, row_max + nr_q, NEG_INF);
+    std::fill(row_sum, row_sum + nr_q, 0.f);
+    std::fill(acc, acc + nr_q * s.dv, 0.f);
+
+    const float* qb = p.q + (b * s.sq + q_begin) * s.d;
+    const float* kb = p.k + b * s.sk * s.d;
+    const float* vb = p.v + b * s.sk * s.dv;
+    const float* mask_b = nullptr;
+    ptrdiff_t mask_row_stride = 0, mask_col_stride = 0;
+    if (p.mask) {
+        mask_b = p.mask + attention::mask_batch_offset(p.bmask, b);
+        mask_row_stride = p.bmask.stride[p.bmask.ndim - 2];
+        mask_col_stride = p.bmask.stride[p.bmask.ndim - 1];
+    }
+    // keys after the last visible one of the last query are skipped
+    size_t k_end = s.sk;
+    if (p.causal) {
+        k_end = q_end + s.sk > s.sq ? std::min(s.sk, q_end + s.sk - s.sq) : 0;
+    }
+
+    for (size_t k0 = 0; k0 < k_end; k0 += K_BLOCK) {
+        size_t nr_k = std::min(K_BLOCK, k_end - k0);
+        for (size_t r = 0; r < nr_q; ++r) {
+            size_t i = q_begin + r;
+            const float* qi = qb + r * s.d;
+            float* score = tile + r * K_BLOCK;
+            float block_max = NEG_INF;
+            for (size_t j = 0; j < nr_k; ++j) {
+                if (p.causal && s.causal_masked(i, k0 + j)) {
+                    score[j] = NEG_INF;
+                    continue;
+                }
+                float x = dot(qi, kb + (k0 + j) * s.d, s.d) * p.scale;
+                if (mask_b) {
+                    x += mask_b[i * mask_row_stride +
+                                (k0 + j) * mask_col_stride];
+                }
+                score[j] = x;
+                block_max = std::max(block_max, x);
+            }
+            if (block_max == NEG_INF) {
+                continue;
+            }
+            float new_max = std::max(row_max[r], block_max);
+            float block_sum = exp_sum(score, nr_k, new_max);
+            float* acc_r = acc + r * s.dv;
+            const float* vj = vb + k0 * s.dv;
+            // rescale the output accumulated with the previous max while
+            // adding the first value of this block
+            float alpha = row_max[r] == NEG_INF
+                                  ? 0.f
+                                  : std::exp(row_max[r] - new_max);
+            scale_axpy(acc_r, alpha, vj, score[0], s.dv);
+            for (size_t j = 1; j < nr_k; ++j) {
+                if (score[j] != 0.f) {
+                    axpy(acc_r, vj + j * s.dv, score[j], s.dv);
+                }
+            }
+            row_sum[r] = row_sum[r] * alpha + block_sum;
+            row_max[r] = new_max;
+        }
+    }
+
+    float* ob = p.dst + (b * s.sq + q_begin) * s.dv;
+    for (size_t r = 0; r < nr_q; ++r) {
+        float* out = ob + r * s.dv;
+        if (row_sum[r] == 0.f) {
+            // all the keys are masked out
+            std::fill(out, out + s.dv,
+                      std::numeric_limits<float>::quiet_NaN());
+            continue;
+        }
+        float inv = 1.f / row_sum[r];
+        const float* acc_r = acc + r * s.dv;
+        for (size_t x = 0; x < s.dv; ++x) {
+            out[x] = acc_r[x] * inv;
+        }
+    }
+}
+
+}  // anonymous namespace
+
+void AttentionForwardImpl::exec(_megdnn_tensor_in q, _megdnn_tensor_in k,
+                                _megdnn_tensor_in v, _megdnn_tensor_in mask,
+                                _megdnn_tensor_out dst,
+                                _megdnn_workspace workspace) {
+    if (q.layout.dtype != dtype::Float32()) {
+        return naive::AttentionForwardImpl::exec(q, k, v, mask, dst,
+                                                 workspace);
+    }
+    check_exec(q.layout, k.layout, v.layout, mask.layout, dst.layout,
+               workspace.size);
+    attention::Shape shape{q.layout, k.layout, v.layout};
+    size_t nr_tasks = get_nr_tasks(handle(), shape);
+    MIDOUT_BEGIN(megdnn_fallback_attention, midout_iv(0)) {
+        Problem p{q.ptr<dt_float32>(),
+                  k.ptr<dt_float32>(),
+                  v.ptr<dt_float32>(),
+                  nullptr,
+                  {},
+                  dst.ptr<dt_float32>(),
+                  shape,
+                  param().scale,
+                  param().causal};
+        if (mask.layout.ndim) {
+            p.mask = mask.ptr<dt_float32>();
+            p.bmask = attention::broadcast_mask(mask.layout, q.layout,
+                                                k.layout);
+        }
+        auto wptr = workspace.ptr<dt_float32>();
+        size_t ws_size = task_workspace_size(shape);
+        size_t q_blocks = (shape.sq + Q_BLOCK - 1) / Q_BLOCK,
+               nr_units = shape.batch * q_blocks;
+        auto kern = [=](size_t task_id, size_t) {
+            float* ws = wptr + task_id * ws_size;
+            size_t end = nr_units * (task_id + 1) / nr_tasks;
+            for (size_t u = nr_units * task_id / nr_tasks; u < end; ++u) {
+                size_t b = u / q_blocks, q_begin = u % q_blocks * Q_BLOCK;
+                attention_block(p, b, q_begin,
+                                std::min(q_begin + Q_BLOCK, p.shape.sq), ws);
+            }
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_tasks);
+    }
+    MIDOUT_END();
+}
+
+size_t AttentionForwardImpl::get_workspace_in_bytes(const TensorLayout& q,
+                                                    const TensorLayout& k,
+                                                    const TensorLayout& v,
+                                                    const TensorLayout&,
+                                                    const TensorLayout&) {
+    if (q.dtype != dtype::Float32()) {
+        return 0;
+    }
+    attention::Shape shape{q, k, v};
+    return get_nr_tasks(handle(), shape) * task_workspace_size(shape) *
+           sizeof(dt_float32);
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,42 @@
+/**
+ * \file dnn/src/fallback/attention/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/attention/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief float32 attention computed over blocks of queries and keys
+ *
+ * The scores of a query block against a key block are kept in a small tile of
+ * the workspace, and the softmax is accumulated online with a running max and
+ * sum per query, so the full score matrix is never written to memory. Other
+ * dtypes are handled by the naive impl.
+ */
+class AttentionForwardImpl : public naive::AttentionForwardImpl {
+public:
+    using naive::AttentionForwardImpl::AttentionForwardImpl;
+    void exec(_megdnn_tensor_in q, _megdnn_tensor_in k, _megdnn_tensor_in v,
+              _megdnn_tensor_in mask, _megdnn_tensor_out dst,
+              _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& q, const TensorLayout& k,
+                                  const TensorLayout& v,
+                                  const TensorLayout& mask,
+                                  const TensorLayout& dst) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
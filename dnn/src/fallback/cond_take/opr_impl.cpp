@@ -0,0 +1,208 @@
+/**
+ * \file dnn/src/fallback/cond_take/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/cond_take/opr_impl.h"
+#include "src/common/cond_take/predicate.cuh"
+#include "src/common/utils.h"
+#include "src/fallback/scan_helper.h"
+#include "src/naive/handle.h"
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_cond_take)
+
+using namespace megdnn;
+using namespace fallback;
+using namespace cond_take;
+
+using Param = CondTake::Param;
+
+namespace {
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+template <uint32_t mode, typename ctype>
+size_t count(const ctype* mask, size_t begin, size_t end,
+             Pred<mode, ctype> pred) {
+    size_t cnt = 0;
+    for (size_t i = begin; i < end; ++i) {
+        cnt += pred(mask[i]);
+    }
+    return cnt;
+}
+
+/*!
+ * \brief write the indices of matched elements starting from begin to
+ *      dest[pos, pos_end)
+ *
+ * The index is always stored and the output position advanced only on a
+ * match, so there is no branch on the mask; the loop stops once all the
+ * matched elements of the block are found, so it never writes past pos_end.
+ */
+template <uint32_t mode, typename ctype>
+void gen_index(const ctype* mask, size_t begin, dt_int32* dest, size_t pos,
+               size_t pos_end, Pred<mode, ctype> pred) {
+    for (size_t i = begin; pos < pos_end; ++i) {
+        dest[pos] = i;
+        pos += pred(mask[i]);
+    }
+}
+}  // anonymous namespace
+
+template <typename ctype>
+void CondTakeImpl::dispatch_count(size_t size, size_t nr_blocks,
+                                  size_t* counts, const ctype* mask) {
+    KParam kparam(m_param);
+    switch (m_param.mode) {
+#define cb(_m)                                                        \
+    case Param::Mode::_m: {                                           \
+        Pred<PEnum::_m, ctype> pred(kparam);                          \
+        auto kern = [=](size_t blk, size_t) {                         \
+            counts[blk] = count(mask,                                 \
+                                scan::block_begin(size, nr_blocks, blk), \
+                                scan::block_begin(size, nr_blocks,    \
+                                                  blk + 1),           \
+                                pred);                                \
+        };                                                            \
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_blocks);   \
+        return;                                                       \
+    }
+        MEGDNN_FOREACH_COND_TAKE_MODE(cb)
+#undef cb
+    }
+    megdnn_assert_internal(0);
+}
+
+template <typename ctype>
+void CondTakeImpl::dispatch_genidx(size_t size, size_t nr_blocks,
+                                   const size_t* offsets, dt_int32* dest,
+                                   const ctype* mask) {
+    KParam kparam(m_param);
+    switch (m_param.mode) {
+#define cb(_m)                                                              \
+    case Param::Mode::_m: {                                                 \
+        Pred<PEnum::_m, ctype> pred(kparam);                                \
+        auto kern = [=](size_t blk, size_t) {                               \
+            gen_index(mask, scan::block_begin(size, nr_blocks, blk), dest,  \
+                      offsets[blk], offsets[blk + 1], pred);                \
+        };                                                                  \
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_blocks);         \
+        return;                                                             \
+    }
+        MEGDNN_FOREACH_COND_TAKE_MODE(cb)
+#undef cb
+    }
+    megdnn_assert_internal(0);
+}
+
+size_t CondTakeImpl::get_workspace_in_bytes(const TensorLayout& data) {
+    // count and then offset of each block, and the total size
+    size_t nr_blocks = scan::get_nr_blocks(data.total_nr_elems(),
+                                           get_nr_threads(handle()));
+    return (nr_blocks + 1) * sizeof(size_t);
+}
+
+CondTakeImpl::Output CondTakeImpl::exec(_megdnn_tensor_in data,
+                                        _megdnn_tensor_in mask,
+                                        _megdnn_workspace workspace,
+                                        DynOutMallocPolicyCall malloc_policy) {
+    auto size = check_exec_get_size(data.layout, mask.layout, workspace.size);
+    size_t nr_threads = get_nr_threads(handle());
+    size_t nr_blocks = scan::get_nr_blocks(size, nr_threads);
+    auto offsets = workspace.ptr<size_t>();
+
+    switch (mask.layout.dtype.enumv()) {
+#define cb(_dt)                                                             \
+    case DTypeTrait<_dt>::enumv: {                                          \
+        MIDOUT_BEGIN(megdnn_fallback_cond_take, midout_iv(0), _dt) {        \
+            using ctype = DTypeTrait<_dt>::ctype;                           \
+            dispatch_count<ctype>(size, nr_blocks, offsets,                 \
+                                  mask.ptr<ctype>());                       \
+        }                                                                   \
+        MIDOUT_END();                                                       \
+        break;                                                              \
+    }
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+        cb(::megdnn::dtype::Bool)
+#undef cb
+        default:
+            megdnn_throw("bad mask dtype");
+    }
+
+    // the output size is needed to allocate the outputs
+    static_cast<naive::HandleImpl*>(handle())->megcore_dispatcher()->sync();
+    size_t out_size = 0;
+    for (size_t i = 0; i < nr_blocks; ++i) {
+        size_t cnt = offsets[i];
+        offsets[i] = out_size;
+        out_size += cnt;
+    }
+    offsets[nr_blocks] = out_size;
+
+    auto out_data =
+            malloc_policy.alloc_output(0, data.layout.dtype, {out_size});
+    auto out_idx = malloc_policy.alloc_output(1, dtype::Int32(), {out_size});
+    auto out_idx_ptr = out_idx.ptr<dt_int32>();
+
+    switch (mask.layout.dtype.enumv()) {
+#define cb(_dt)                                                             \
+    case DTypeTrait<_dt>::enumv: {                                          \
+        MIDOUT_BEGIN(megdnn_fallback_cond_take, midout_iv(1), _dt) {        \
+            using ctype = DTypeTrait<_dt>::ctype;                           \
+            dispatch_genidx<ctype>(size, nr_blocks, offsets, out_idx_ptr,   \
+                                   mask.ptr<ctype>());                      \
+        }                                                                   \
+        MIDOUT_END();                                                       \
+        break;                                                              \
+    }
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+        cb(::megdnn::dtype::Bool)
+#undef cb
+        default:
+            megdnn_throw("bad mask dtype");
+    }
+
+    size_t nr_out_blocks = scan::get_nr_blocks(out_size, nr_threads);
+    switch (data.layout.dtype.enumv()) {
+#define cb(_dt)                                                              \
+    case DTypeTrait<_dt>::enumv: {                                           \
+        MIDOUT_BEGIN(megdnn_fallback_cond_take, midout_iv(2), _dt) {         \
+            using ctype = DTypeTrait<_dt>::ctype;                            \
+            auto out_data_ptr = out_data.ptr<ctype>();                       \
+            auto data_ptr = data.ptr<ctype>();                               \
+            auto kern = [=](size_t blk, size_t) {                            \
+                size_t end = scan::block_begin(out_size, nr_out_blocks,      \
+                                               blk + 1);                     \
+                for (size_t i = scan::block_begin(out_size, nr_out_blocks,   \
+                                                  blk);                      \
+                     i < end; ++i) {                                         \
+                    out_data_ptr[i] = data_ptr[out_idx_ptr[i]];              \
+                }                                                            \
+            };                                                               \
+            MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_out_blocks);  \
+        }                                                                    \
+        MIDOUT_END();                                                        \
+        break;                                                               \
+    }
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+        cb(::megdnn::dtype::Bool)
+#undef cb
+        default:
+            megdnn_throw("bad data dtype");
+    }
+
+    return {{out_data, out_idx}};
+}
+
+// vim: syntax=cpp.doxygen
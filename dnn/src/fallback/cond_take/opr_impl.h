@@ -0,0 +1,47 @@
+/**
+ * \file dnn/src/fallback/cond_take/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/cond_take/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief CondTake by a parallel prefix sum over the mask
+ *
+ * The input is split into blocks; the matched elements of each block are
+ * counted in parallel, the counts are scanned to get the output offset of
+ * each block, and then the blocks are compacted in parallel.
+ */
+class CondTakeImpl : public naive::CondTakeImpl {
+    template <typename ctype>
+    void dispatch_count(size_t size, size_t nr_blocks, size_t* counts,
+                        const ctype* mask);
+    template <typename ctype>
+    void dispatch_genidx(size_t size, size_t nr_blocks, const size_t* offsets,
+                         dt_int32* dest, const ctype* mask);
+
+public:
+    using naive::CondTakeImpl::CondTakeImpl;
+
+    size_t get_workspace_in_bytes(const TensorLayout& data) override;
+
+    Output exec(_megdnn_tensor_in data, _megdnn_tensor_in mask,
+                _megdnn_workspace workspace,
+                DynOutMallocPolicyCall malloc_policy) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
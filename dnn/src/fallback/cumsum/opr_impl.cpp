@@ -0,0 +1,203 @@
+/**
+ * \file dnn/src/fallback/cumsum/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/cumsum/opr_impl.h"
+#include "src/common/reduce_helper.h"
+#include "src/common/utils.h"
+#include "src/fallback/scan_helper.h"
+#include "src/naive/handle.h"
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_cumsum)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+//! number of blocks to split the scanned axis of each slice into
+size_t get_nr_blocks(size_t A, size_t B, size_t C, size_t nr_threads) {
+    if (A >= nr_threads)
+        return 1;
+    size_t nr = (nr_threads + A - 1) / A;
+    return std::max<size_t>(
+            1, std::min({nr, B, B * C / scan::MIN_BLOCK_SIZE}));
+}
+
+//! sum of the rows [b_begin, b_end) of a slice, each row having C values
+template <typename T>
+void block_sum(const T* src, size_t b_begin, size_t b_end, size_t C, T* sum) {
+    if (C == 1) {
+        sum[0] = scan::contig_sum(src + b_begin, b_end - b_begin);
+        return;
+    }
+    std::fill(sum, sum + C, T(0));
+    for (size_t b = b_begin; b < b_end; ++b) {
+        const T* row = src + b * C;
+        for (size_t c = 0; c < C; ++c) {
+            sum[c] += row[c];
+        }
+    }
+}
+
+/*!
+ * \brief scan the rows [b_begin, b_end) of a slice
+ * \param carry C values to start with, updated to the sums after the block
+ */
+template <typename T>
+void scan_block(const T* src, T* dst, size_t b_begin, size_t b_end, size_t C,
+                T* carry, bool exclusive, bool reverse) {
+    if (C == 1 && !reverse) {
+        carry[0] = scan::ContigScan<T>::run(src + b_begin, dst + b_begin,
+                                            b_end - b_begin, carry[0],
+                                            exclusive);
+        return;
+    }
+    // the C values of a row are independent, so the inner loop vectorizes
+    auto scan_row = [&](size_t b) {
+        const T* s = src + b * C;
+        T* d = dst + b * C;
+        if (exclusive) {
+            for (size_t c = 0; c < C; ++c) {
+                T x = s[c];
+                d[c] = carry[c];
+                carry[c] += x;
+            }
+        } else {
+            for (size_t c = 0; c < C; ++c) {
+                carry[c] += s[c];
+                d[c] = carry[c];
+            }
+        }
+    };
+    if (reverse) {
+        for (size_t b = b_end; b > b_begin; --b) {
+            scan_row(b - 1);
+        }
+    } else {
+        for (size_t b = b_begin; b < b_end; ++b) {
+            scan_row(b);
+        }
+    }
+}
+}  // anonymous namespace
+
+template <typename T>
+void CumsumForwardImpl::exec_internal(const T* src, T* dst, size_t A,
+                                      size_t B, size_t C, T* workspace) {
+    bool exclusive = param().exclusive, reverse = param().reverse;
+    size_t nr_threads = get_nr_threads(handle());
+    size_t nr_blocks = get_nr_blocks(A, B, C, nr_threads);
+    size_t slice = B * C;
+
+    if (nr_blocks == 1) {
+        size_t nr_tasks = std::min(A, nr_threads);
+        auto kern = [=](size_t task_id, size_t thread_id) {
+            T carry_val;
+            T* carry = C == 1 ? &carry_val : workspace + thread_id * C;
+            size_t a_end = scan::block_begin(A, nr_tasks, task_id + 1);
+            for (size_t a = scan::block_begin(A, nr_tasks, task_id); a < a_end;
+                 ++a) {
+                std::fill(carry, carry + C, T(0));
+                scan_block(src + a * slice, dst + a * slice, 0, B, C, carry,
+                           exclusive, reverse);
+            }
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_tasks);
+        return;
+    }
+
+    // the workspace holds C values for each block of each slice
+    auto get_block = [=](size_t index, size_t& a, size_t& b_begin,
+                         size_t& b_end) {
+        a = index / nr_blocks;
+        size_t blk = index % nr_blocks;
+        b_begin = scan::block_begin(B, nr_blocks, blk);
+        b_end = scan::block_begin(B, nr_blocks, blk + 1);
+    };
+    auto sum_kern = [=](size_t index, size_t) {
+        size_t a, b_begin, b_end;
+        get_block(index, a, b_begin, b_end);
+        block_sum(src + a * slice, b_begin, b_end, C, workspace + index * C);
+    };
+    MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(sum_kern, A * nr_blocks);
+
+    // replace the block sums with the offsets of the blocks
+    auto offset_kern = [=]() {
+        for (size_t a = 0; a < A; ++a) {
+            T* sums = workspace + a * nr_blocks * C;
+            for (size_t c = 0; c < C; ++c) {
+                T carry = T(0);
+                for (size_t i = 0; i < nr_blocks; ++i) {
+                    size_t blk = reverse ? nr_blocks - 1 - i : i;
+                    T x = sums[blk * C + c];
+                    sums[blk * C + c] = carry;
+                    carry += x;
+                }
+            }
+        }
+    };
+    MEGDNN_DISPATCH_CPU_KERN_OPR(offset_kern());
+
+    auto scan_kern = [=](size_t index, size_t) {
+        size_t a, b_begin, b_end;
+        get_block(index, a, b_begin, b_end);
+        scan_block(src + a * slice, dst + a * slice, b_begin, b_end, C,
+                   workspace + index * C, exclusive, reverse);
+    };
+    MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(scan_kern, A * nr_blocks);
+}
+
+void CumsumForwardImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                             _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, workspace.size);
+
+    size_t A, B, C;
+    reduce::get_ABC(src.layout, A, B, C, param().axis);
+#define cb(DType)                                                         \
+    if (src.layout.dtype == DType()) {                                    \
+        MIDOUT_BEGIN(megdnn_fallback_cumsum, midout_iv(0), DType) {       \
+            using ctype = DTypeTrait<DType>::ctype;                       \
+            exec_internal<ctype>(src.ptr<ctype>(), dst.ptr<ctype>(), A, B, \
+                                 C, workspace.ptr<ctype>());              \
+            return;                                                       \
+        }                                                                 \
+        MIDOUT_END();                                                     \
+    }
+    MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+#undef cb
+    megdnn_assert_internal(0);
+}
+
+size_t CumsumForwardImpl::get_workspace_in_bytes(const TensorLayout& src,
+                                                 const TensorLayout&) {
+    size_t A, B, C;
+    reduce::get_ABC(src, A, B, C, param().axis);
+    size_t nr_threads = get_nr_threads(handle());
+    size_t nr_blocks = get_nr_blocks(A, B, C, nr_threads);
+    size_t nr_elems;
+    if (nr_blocks > 1) {
+        // sums and then offsets of the blocks
+        nr_elems = A * nr_blocks * C;
+    } else {
+        // carries of each thread; a single value is kept on stack
+        nr_elems = C == 1 ? 0 : nr_threads * C;
+    }
+    return nr_elems * src.dtype.size();
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,44 @@
+/**
+ * \file dnn/src/fallback/cumsum/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/cumsum/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief cumsum by a two-pass parallel prefix sum
+ *
+ * Slices of the tensor before the scanned axis are processed by different
+ * threads; if there are fewer slices than threads, the scanned axis is also
+ * split into blocks, whose sums are computed first to get the offset of each
+ * block.
+ */
+class CumsumForwardImpl : public naive::CumsumForwardImpl {
+    template <typename T>
+    void exec_internal(const T* src, T* dst, size_t A, size_t B, size_t C,
+                       T* workspace);
+
+public:
+    using naive::CumsumForwardImpl::CumsumForwardImpl;
+
+    void exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+              _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& src,
+                                  const TensorLayout& dst) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,133 @@
+/**
+ * \file dnn/src/fallback/float4_helper.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "megdnn/arch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if MEGDNN_X86
+#include <xmmintrin.h>
+#include "src/x86/elemwise/sse_util/sse_mathfun.h"
+#elif MEGDNN_AARCH64 || MEGDNN_ARMV7
+#include "src/arm_common/elemwise/neon_mathfun.h"
+#endif
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief minimal vector of 4 floats used by the fused row kernels
+ *
+ * It maps to SSE on x86 and NEON on arm, where the exp implementations of the
+ * elemwise oprs are also available, and to plain arrays elsewhere.
+ */
+struct Float4 {
+#if MEGDNN_X86
+    using vec = __m128;
+    static vec load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, vec v) { _mm_storeu_ps(p, v); }
+    static vec set1(float x) { return _mm_set1_ps(x); }
+    static vec add(vec a, vec b) { return _mm_add_ps(a, b); }
+    static vec sub(vec a, vec b) { return _mm_sub_ps(a, b); }
+    static vec mul(vec a, vec b) { return _mm_mul_ps(a, b); }
+    static vec max(vec a, vec b) { return _mm_max_ps(a, b); }
+    static vec exp(vec a) { return x86::detail::exp_ps(a); }
+    //! whether a > b in any lane
+    static bool any_gt(vec a, vec b) {
+        return _mm_movemask_ps(_mm_cmpgt_ps(a, b));
+    }
+    static float reduce_add(vec a) {
+        a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+        return _mm_cvtss_f32(a);
+    }
+    static float reduce_max(vec a) {
+        a = _mm_max_ps(a, _mm_movehl_ps(a, a));
+        a = _mm_max_ss(a, _mm_shuffle_ps(a, a, 1));
+        return _mm_cvtss_f32(a);
+    }
+    static float lane(vec a, int i) {
+        alignas(16) float buf[4];
+        _mm_store_ps(buf, a);
+        return buf[i];
+    }
+#elif MEGDNN_AARCH64 || MEGDNN_ARMV7
+    using vec = float32x4_t;
+    static vec load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, vec v) { vst1q_f32(p, v); }
+    static vec set1(float x) { return vdupq_n_f32(x); }
+    static vec add(vec a, vec b) { return vaddq_f32(a, b); }
+    static vec sub(vec a, vec b) { return vsubq_f32(a, b); }
+    static vec mul(vec a, vec b) { return vmulq_f32(a, b); }
+    static vec max(vec a, vec b) { return vmaxq_f32(a, b); }
+    static vec exp(vec a) { return arm_common::exp_ps_f32(a); }
+    static bool any_gt(vec a, vec b) {
+        uint32x4_t mask = vcgtq_f32(a, b);
+        uint32x2_t half = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+        return vget_lane_u32(vpmax_u32(half, half), 0);
+    }
+    static float reduce_add(vec a) {
+        float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+        return vget_lane_f32(vpadd_f32(s, s), 0);
+    }
+    static float reduce_max(vec a) {
+        float32x2_t s = vmax_f32(vget_low_f32(a), vget_high_f32(a));
+        return vget_lane_f32(vpmax_f32(s, s), 0);
+    }
+    static float lane(vec a, int i) {
+        float buf[4];
+        vst1q_f32(buf, a);
+        return buf[i];
+    }
+#else
+    struct vec {
+        float v[4];
+    };
+    static vec load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+    static void store(float* p, vec v) { std::copy(v.v, v.v + 4, p); }
+    static vec set1(float x) { return {{x, x, x, x}}; }
+#define cb(_name, _expr)                      \
+    static vec _name(vec a, vec b) {          \
+        vec r;                                \
+        for (int i = 0; i < 4; ++i) {         \
+            float x = a.v[i], y = b.v[i];     \
+            r.v[i] = _expr;                   \
+        }                                     \
+        return r;                             \
+    }
+    cb(add, x + y) cb(sub, x - y) cb(mul, x * y) cb(max, std::max(x, y))
+#undef cb
+    static vec exp(vec a) {
+        for (int i = 0; i < 4; ++i)
+            a.v[i] = std::exp(a.v[i]);
+        return a;
+    }
+    static bool any_gt(vec a, vec b) {
+        return a.v[0] > b.v[0] || a.v[1] > b.v[1] || a.v[2] > b.v[2] ||
+               a.v[3] > b.v[3];
+    }
+    static float reduce_add(vec a) {
+        return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]);
+    }
+    static float reduce_max(vec a) {
+        return std::max(std::max(a.v[0], a.v[1]), std::max(a.v[2], a.v[3]));
+    }
+    static float lane(vec a, int i) { return a.v[i]; }
+#endif
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
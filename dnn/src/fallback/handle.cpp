@@ -36,6 +36,16 @@
 #include "src/fallback/batched_matrix_mul/opr_impl.h"
 #include "src/fallback/conv_bias/opr_impl.h"
 #include "src/fallback/powc/opr_impl.h"
+#include "src/fallback/topk/opr_impl.h"
+#include "src/fallback/argsort/opr_impl.h"
+#include "src/fallback/cumsum/opr_impl.h"
+#include "src/fallback/cond_take/opr_impl.h"
+#include "src/fallback/indexing_multi_axis_vec/opr_impl.h"
+#include "src/fallback/mesh_indexing/opr_impl.h"
+#include "src/fallback/layer_norm/opr_impl.h"
+#include "src/fallback/softmax/opr_impl.h"
+#include "src/fallback/attention/opr_impl.h"
+#include "src/fallback/image_preprocess/opr_impl.h"
 
 namespace megdnn {
 namespace fallback {
@@ -70,6 +80,25 @@ MEGDNN_SPECIALIZE_CREATE_OPERATOR(Resize)
 MEGDNN_SPECIALIZE_CREATE_OPERATOR(BatchedMatrixMulForward)
 MEGDNN_SPECIALIZE_CREATE_OPERATOR(ConvBias)
 MEGDNN_SPECIALIZE_CREATE_OPERATOR(PowC)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(TopK)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(ArgsortForward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(CumsumForward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(CondTake)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(IndexingMultiAxisVec)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(IndexingSetMultiAxisVec)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(IndexingIncrMultiAxisVec)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(MeshIndexing)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(IncrMeshIndexing)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(SetMeshIndexing)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(BatchedMeshIndexing)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(BatchedIncrMeshIndexing)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(BatchedSetMeshIndexing)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(LayerNormForward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(LayerNormBackward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(SoftmaxForward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(SoftmaxBackward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(AttentionForward)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(ImagePreprocessForward)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
@@ -0,0 +1,211 @@
+/**
+ * \file dnn/src/fallback/image_preprocess/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/image_preprocess/opr_impl.h"
+#include "src/common/image_preprocess_helper.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+#include <cmath>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_image_preprocess)
+
+using namespace megdnn;
+using namespace fallback;
+using namespace image_preprocess;
+
+namespace {
+
+//! number of output rows in a unit of work
+constexpr size_t ROW_BLOCK = 16;
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+size_t get_nr_units(const Shape& s) {
+    return s.n * ((s.oh + ROW_BLOCK - 1) / ROW_BLOCK);
+}
+
+size_t get_nr_tasks(Handle* handle, const Shape& s) {
+    return std::max<size_t>(1,
+                            std::min(get_nr_threads(handle), get_nr_units(s)));
+}
+
+//! floats of the workspace of each task: the horizontal taps, two resized
+//! rows and a converted source row
+size_t task_workspace_size(const Shape& s) {
+    static_assert(sizeof(Coord) == 3 * sizeof(float), "bad Coord size");
+    return s.ow * 3 + s.ow * 3 * 2 + (s.iw * 3 + 3) / 4;
+}
+
+template <typename ctype>
+struct Problem {
+    const uint8_t* src;
+    ctype* dst;
+    Param param;
+    Shape shape;
+    DType dtype;
+};
+
+/*!
+ * \brief source rows converted to BGR and resized horizontally, keyed by the
+ *      source row
+ */
+class RowCache {
+    const Param& m_param;
+    const Shape& m_shape;
+    const Coord* m_tab;
+    uint8_t* m_bgr;
+    float* m_rows[2];
+    int m_tag[2] = {-1, -1};
+
+public:
+    RowCache(const Param& param, const Shape& shape, float* ws)
+            : m_param{param}, m_shape{shape} {
+        auto tab = reinterpret_cast<Coord*>(ws);
+        for (size_t w = 0; w < shape.ow; ++w) {
+            tab[w] = get_coord(param.imode, shape.iw, shape.ow, w);
+        }
+        m_tab = tab;
+        m_rows[0] = ws + shape.ow * 3;
+        m_rows[1] = m_rows[0] + shape.ow * 3;
+        m_bgr = reinterpret_cast<uint8_t*>(m_rows[1] + shape.ow * 3);
+    }
+
+    void reset() { m_tag[0] = m_tag[1] = -1; }
+
+    //! get resized row \p y of image \p img without evicting row \p keep
+    const float* get(const uint8_t* img, int y, int keep) {
+        for (int i = 0; i < 2; ++i) {
+            if (m_tag[i] == y) {
+                return m_rows[i];
+            }
+        }
+        int i = m_tag[0] == keep ? 1
+                                 : (m_tag[1] == keep ? 0
+                                                     : m_tag[1] < m_tag[0]);
+        m_tag[i] = y;
+        cvt_row(m_param.src_format, img, m_shape.ih, m_shape.iw, y, m_bgr);
+        float* row = m_rows[i];
+        for (size_t w = 0; w < m_shape.ow; ++w) {
+            auto&& t = m_tab[w];
+            const uint8_t *p0 = m_bgr + t.i0 * 3, *p1 = m_bgr + t.i1 * 3;
+            for (size_t k = 0; k < 3; ++k) {
+                row[w * 3 + k] = p0[k] * (1 - t.alpha) + p1[k] * t.alpha;
+            }
+        }
+        return row;
+    }
+};
+
+template <typename ctype>
+void process_rows(const Problem<ctype>& p, RowCache& cache, size_t b,
+                  size_t h_begin, size_t h_end) {
+    auto&& s = p.shape;
+    OutputCvt<ctype> cvt{p.dtype};
+    Normalize norm{p.param};
+    ctype zero = cvt(0.f);
+    size_t src_img_size = is_yuv(p.param.src_format) ? s.ih / 2 * 3 * s.iw
+                                                     : s.ih * s.iw * 3;
+    const uint8_t* img = p.src + b * src_img_size;
+    for (size_t h = h_begin; h < h_end; ++h) {
+        auto ch = get_coord(p.param.imode, s.ih, s.oh, h);
+        const float* r0 = cache.get(img, ch.i0, ch.i1);
+        const float* r1 = cache.get(img, ch.i1, ch.i0);
+        float a0 = 1 - ch.alpha, a1 = ch.alpha;
+        if (s.pack == 1) {
+            for (size_t c = 0; c < 3; ++c) {
+                size_t k = bgr_index(p.param, c);
+                ctype* out = p.dst + s.dst_offset(b, c, h, 0);
+                for (size_t w = 0; w < s.ow; ++w) {
+                    float v = std::round(r0[w * 3 + k] * a0 +
+                                         r1[w * 3 + k] * a1);
+                    out[w] = cvt(norm(v, c));
+                }
+            }
+        } else {
+            ctype* out = p.dst + s.dst_offset(b, 0, h, 0);
+            for (size_t w = 0; w < s.ow; ++w, out += s.pack) {
+                for (size_t c = 0; c < 3; ++c) {
+                    size_t k = bgr_index(p.param, c);
+                    float v = std::round(r0[w * 3 + k] * a0 +
+                                         r1[w * 3 + k] * a1);
+                    out[c] = cvt(norm(v, c));
+                }
+                for (size_t c = 3; c < s.pack; ++c) {
+                    out[c] = zero;
+                }
+            }
+        }
+    }
+}
+
+template <typename ctype>
+void dispatch(Handle* handle, const Problem<ctype>& p, float* wptr) {
+    auto&& s = p.shape;
+    size_t nr_tasks = get_nr_tasks(handle, s), nr_units = get_nr_units(s),
+           blocks = nr_units / s.n, ws_size = task_workspace_size(s);
+    // consecutive units of a task share the cached rows at their boundaries
+    auto kern = [=](size_t task_id, size_t) {
+        RowCache cache{p.param, p.shape, wptr + task_id * ws_size};
+        size_t end = nr_units * (task_id + 1) / nr_tasks, last_b = s.n;
+        for (size_t u = nr_units * task_id / nr_tasks; u < end; ++u) {
+            size_t b = u / blocks, h_begin = u % blocks * ROW_BLOCK;
+            if (b != last_b) {
+                cache.reset();
+                last_b = b;
+            }
+            process_rows(p, cache, b, h_begin,
+                         std::min(h_begin + ROW_BLOCK, s.oh));
+        }
+    };
+    MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(
+            static_cast<naive::HandleImpl*>(handle), nr_tasks, kern);
+}
+
+}  // anonymous namespace
+
+void ImagePreprocessForwardImpl::exec(_megdnn_tensor_in src,
+                                      _megdnn_tensor_out dst,
+                                      _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, workspace.size);
+    Shape shape{param(), src.layout, dst.layout};
+    auto wptr = workspace.ptr<dt_float32>();
+    if (dst.layout.dtype == dtype::Float32()) {
+        MIDOUT_BEGIN(megdnn_fallback_image_preprocess, midout_iv(0)) {
+            Problem<dt_float32> p{src.ptr<dt_uint8>(), dst.ptr<dt_float32>(),
+                                  param(), shape, dst.layout.dtype};
+            dispatch(handle(), p, wptr);
+        }
+        MIDOUT_END();
+    } else {
+        MIDOUT_BEGIN(megdnn_fallback_image_preprocess, midout_iv(1)) {
+            Problem<dt_qint8> p{src.ptr<dt_uint8>(), dst.ptr<dt_qint8>(),
+                                param(), shape, dst.layout.dtype};
+            dispatch(handle(), p, wptr);
+        }
+        MIDOUT_END();
+    }
+}
+
+size_t ImagePreprocessForwardImpl::get_workspace_in_bytes(
+        const TensorLayout& src, const TensorLayout& dst) {
+    Shape shape{param(), src, dst};
+    return get_nr_tasks(handle(), shape) * task_workspace_size(shape) *
+           sizeof(dt_float32);
+}
+
+// vim: syntax=cpp.doxygen
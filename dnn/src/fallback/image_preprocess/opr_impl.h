@@ -0,0 +1,39 @@
+/**
+ * \file dnn/src/fallback/image_preprocess/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/image_preprocess/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief image preprocess in a single pass over the output rows
+ *
+ * The output rows are split into blocks which are processed in parallel.
+ * Each task converts the source rows it needs to BGR and resizes them
+ * horizontally into a two-row cache, from which the output rows are blended,
+ * normalized and stored, so no intermediate image is written to memory.
+ */
+class ImagePreprocessForwardImpl : public naive::ImagePreprocessForwardImpl {
+public:
+    using naive::ImagePreprocessForwardImpl::ImagePreprocessForwardImpl;
+    void exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+              _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& src,
+                                  const TensorLayout& dst) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,408 @@
+/**
+ * \file dnn/src/fallback/indexing_multi_axis_vec/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/indexing_multi_axis_vec/opr_impl.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+#if MEGDNN_X86
+#include <immintrin.h>
+#include "src/x86/utils.h"
+#endif
+
+#include <cstring>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_indexing_multi_axis_vec)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+//! number of rows ahead to prefetch
+constexpr size_t PREFETCH_DIST = 8;
+//! minimal number of elements handled by a thread
+constexpr size_t MIN_TASK_SIZE = 4096;
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+/*!
+ * \brief value is viewed as (nr_outer, nr_idx, inner_size); the row at
+ *      (o, j) in value corresponds to inner_size elements in data starting
+ *      from outer_offset(o) + idx_offset[j]
+ */
+struct Plan {
+    size_t nr_outer, nr_idx, inner_size;
+    //! strides of the rows in data and value
+    ptrdiff_t inner_stride, value_stride;
+    size_t outer_ndim;
+    size_t outer_shape[TensorLayout::MAX_NDIM];
+    ptrdiff_t outer_stride[TensorLayout::MAX_NDIM];
+
+    ptrdiff_t outer_offset(size_t o) const {
+        ptrdiff_t offset = 0;
+        for (size_t i = outer_ndim; i; --i) {
+            offset += outer_stride[i - 1] * (o % outer_shape[i - 1]);
+            o /= outer_shape[i - 1];
+        }
+        return offset;
+    }
+
+    //! value offset of the first element in row (o, j)
+    ptrdiff_t value_offset(size_t o, size_t j) const {
+        return static_cast<ptrdiff_t>((o * nr_idx + j) * inner_size) *
+               value_stride;
+    }
+};
+
+//! return false if the rows can not be viewed as a single axis
+bool make_plan(const TensorLayout& data, const TensorLayout& value,
+               const IndexingMultiAxisVecBase::IndexDesc& index,
+               const IndexingMultiAxisVecBase::ExecInfo& info, Plan& plan) {
+    auto layout_axis =
+            IndexingMultiAxisVecBase::get_value_iter_optimized_layout(
+                    data, value, index, info.idx_axis);
+    auto&& layout = layout_axis.first;
+    size_t idx_axis = layout_axis.second;
+    if (layout.ndim > idx_axis + 2) {
+        return false;
+    }
+    plan.nr_idx = layout.shape[idx_axis];
+    plan.outer_ndim = idx_axis;
+    plan.nr_outer = 1;
+    for (size_t i = 0; i < idx_axis; ++i) {
+        plan.outer_shape[i] = layout.shape[i];
+        plan.outer_stride[i] = layout.stride[i];
+        plan.nr_outer *= layout.shape[i];
+    }
+    if (layout.ndim == idx_axis + 2) {
+        plan.inner_size = layout.shape[idx_axis + 1];
+        plan.inner_stride = layout.stride[idx_axis + 1];
+    } else {
+        plan.inner_size = 1;
+        plan.inner_stride = 1;
+    }
+    plan.value_stride = info.value_stride;
+    return true;
+}
+
+//! offset in data of each index position, with negative indices wrapped
+void compute_idx_offset(const TensorLayout& data,
+                        const IndexingMultiAxisVecBase::IndexDesc& index,
+                        size_t nr_idx, ptrdiff_t* idx_offset) {
+    std::fill(idx_offset, idx_offset + nr_idx, 0);
+    for (size_t i = 0; i < index.size(); ++i) {
+        auto&& s = index[i];
+        size_t axis = s.axis, data_shape = data.shape[axis];
+        ptrdiff_t data_stride = data.stride[axis],
+                  vec_stride = s.vec.layout.shape[0] == 1
+                                       ? 0
+                                       : s.vec.layout.stride[0];
+        auto vec = s.vec.ptr<dt_int32>();
+        for (size_t j = 0; j < nr_idx; ++j) {
+            dt_int32 data_idx = vec[vec_stride * j];
+            if (data_idx < 0)
+                data_idx += data_shape;
+            megdnn_assert(data_idx >= 0 &&
+                                  static_cast<size_t>(data_idx) < data_shape,
+                          "bad index value for index %zu at output %zu", i, j);
+            idx_offset[j] += data_stride * data_idx;
+        }
+    }
+}
+
+template <typename ctype>
+void gather_row(const ctype* src, ptrdiff_t src_stride, ctype* dst,
+                ptrdiff_t dst_stride, size_t n) {
+    if (src_stride == 1 && dst_stride == 1) {
+        memcpy(dst, src, n * sizeof(ctype));
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        dst[i * dst_stride] = src[i * src_stride];
+    }
+}
+
+template <typename ctype>
+void incr_row(ctype* dst, ptrdiff_t dst_stride, const ctype* src,
+              ptrdiff_t src_stride, size_t n) {
+    if (src_stride == 1 && dst_stride == 1) {
+        for (size_t i = 0; i < n; ++i) {
+            dst[i] += src[i];
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        dst[i * dst_stride] += src[i * src_stride];
+    }
+}
+
+//! dst[j * dst_stride] = base[idx_offset[j]] for j in [0, n)
+template <typename ctype>
+struct GatherScalar {
+    static void run(const ctype* base, const ptrdiff_t* idx_offset, size_t n,
+                    ctype* dst, ptrdiff_t dst_stride) {
+        for (size_t j = 0; j < n; ++j) {
+            if (j + PREFETCH_DIST < n) {
+                __builtin_prefetch(base + idx_offset[j + PREFETCH_DIST]);
+            }
+            dst[j * dst_stride] = base[idx_offset[j]];
+        }
+    }
+};
+
+#if MEGDNN_X86
+MEGDNN_ATTRIBUTE_TARGET("avx2")
+void gather_scalar_4byte_avx2(const int* base, const ptrdiff_t* idx_offset,
+                              size_t n, int* dst) {
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256i idx0 = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(idx_offset + j)),
+                idx1 = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(idx_offset + j + 4));
+        __m128i v0 = _mm256_i64gather_epi32(base, idx0, 4),
+                v1 = _mm256_i64gather_epi32(base, idx1, 4);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), v0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j + 4), v1);
+    }
+    for (; j < n; ++j) {
+        dst[j] = base[idx_offset[j]];
+    }
+}
+
+MEGDNN_ATTRIBUTE_TARGET("avx512f")
+void gather_scalar_4byte_avx512(const int* base, const ptrdiff_t* idx_offset,
+                                size_t n, int* dst) {
+    size_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m512i idx0 = _mm512_loadu_si512(idx_offset + j),
+                idx1 = _mm512_loadu_si512(idx_offset + j + 8);
+        __m256i v0 = _mm512_i64gather_epi32(idx0, base, 4),
+                v1 = _mm512_i64gather_epi32(idx1, base, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j), v0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j + 8), v1);
+    }
+    for (; j < n; ++j) {
+        dst[j] = base[idx_offset[j]];
+    }
+}
+
+#define INST(_ctype)                                                       \
+    template <>                                                            \
+    struct GatherScalar<_ctype> {                                          \
+        static void run(const _ctype* base, const ptrdiff_t* idx_offset,   \
+                        size_t n, _ctype* dst, ptrdiff_t dst_stride) {     \
+            static bool use_avx512 =                                       \
+                    x86::is_supported(x86::SIMDType::AVX512);              \
+            static bool use_avx2 = x86::is_supported(x86::SIMDType::AVX2); \
+            if (use_avx512 && dst_stride == 1) {                           \
+                gather_scalar_4byte_avx512(                                \
+                        reinterpret_cast<const int*>(base), idx_offset, n, \
+                        reinterpret_cast<int*>(dst));                      \
+                return;                                                    \
+            }                                                              \
+            if (use_avx2 && dst_stride == 1) {                             \
+                gather_scalar_4byte_avx2(                                  \
+                        reinterpret_cast<const int*>(base), idx_offset, n, \
+                        reinterpret_cast<int*>(dst));                      \
+                return;                                                    \
+            }                                                              \
+            for (size_t j = 0; j < n; ++j) {                               \
+                dst[j * dst_stride] = base[idx_offset[j]];                 \
+            }                                                              \
+        }                                                                  \
+    };
+INST(dt_float32)
+INST(dt_int32)
+#undef INST
+#endif
+
+template <typename ctype>
+void exec_gather(Handle* handle, const TensorND& src, const TensorND& dst,
+                 const Plan& plan, const ptrdiff_t* idx_offset) {
+    const ctype* src_ptr = src.ptr<ctype>();
+    ctype* dst_ptr = dst.ptr<ctype>();
+    size_t nr_rows = plan.nr_outer * plan.nr_idx,
+           rows_per_task = std::max<size_t>(
+                   1, MIN_TASK_SIZE / std::max<size_t>(plan.inner_size, 1));
+    size_t nr_tasks = std::max<size_t>(
+            1, std::min(get_nr_threads(handle) * 4,
+                        (nr_rows + rows_per_task - 1) / rows_per_task));
+    auto kern = [=](size_t task_id, size_t) {
+        size_t row = nr_rows * task_id / nr_tasks,
+               row_end = nr_rows * (task_id + 1) / nr_tasks;
+        while (row < row_end) {
+            size_t o = row / plan.nr_idx, j = row % plan.nr_idx,
+                   j_end = std::min(plan.nr_idx, j + row_end - row);
+            const ctype* base = src_ptr + plan.outer_offset(o);
+            ctype* out = dst_ptr + plan.value_offset(o, j);
+            if (plan.inner_size == 1) {
+                GatherScalar<ctype>::run(base, idx_offset + j, j_end - j, out,
+                                         plan.value_stride);
+            } else {
+                ptrdiff_t out_row_stride =
+                        plan.inner_size * plan.value_stride;
+                for (size_t jj = j; jj < j_end; ++jj) {
+                    if (jj + PREFETCH_DIST < j_end) {
+                        __builtin_prefetch(
+                                base + idx_offset[jj + PREFETCH_DIST]);
+                    }
+                    gather_row(base + idx_offset[jj], plan.inner_stride, out,
+                               plan.value_stride, plan.inner_size);
+                    out += out_row_stride;
+                }
+            }
+            row += j_end - j;
+        }
+    };
+    static_cast<naive::HandleImpl*>(handle)->dispatch_kern(kern, nr_tasks);
+}
+
+template <typename ctype, bool incr>
+void exec_scatter(Handle* handle, const TensorND& data, const TensorND& value,
+                  const Plan& plan, const ptrdiff_t* idx_offset) {
+    ctype* data_ptr = data.ptr<ctype>();
+    const ctype* value_ptr = value.ptr<ctype>();
+    size_t nr_threads = get_nr_threads(handle);
+    // each task owns an outer slice, or a range of columns of it
+    size_t nr_col_blocks = 1;
+    if (plan.nr_outer < nr_threads) {
+        nr_col_blocks = std::max<size_t>(
+                1, std::min((nr_threads + plan.nr_outer - 1) / plan.nr_outer,
+                            plan.inner_size * plan.nr_idx / MIN_TASK_SIZE));
+        nr_col_blocks = std::min(nr_col_blocks, plan.inner_size);
+    }
+    auto kern = [=](size_t task_id, size_t) {
+        size_t o = task_id / nr_col_blocks, blk = task_id % nr_col_blocks,
+               col = plan.inner_size * blk / nr_col_blocks,
+               col_end = plan.inner_size * (blk + 1) / nr_col_blocks;
+        ctype* base = data_ptr + plan.outer_offset(o) +
+                      static_cast<ptrdiff_t>(col) * plan.inner_stride;
+        for (size_t j = 0; j < plan.nr_idx; ++j) {
+            if (j + PREFETCH_DIST < plan.nr_idx) {
+                __builtin_prefetch(base + idx_offset[j + PREFETCH_DIST], 1);
+            }
+            const ctype* src = value_ptr + plan.value_offset(o, j) +
+                               static_cast<ptrdiff_t>(col) * plan.value_stride;
+            if (incr) {
+                incr_row(base + idx_offset[j], plan.inner_stride, src,
+                         plan.value_stride, col_end - col);
+            } else {
+                gather_row(src, plan.value_stride, base + idx_offset[j],
+                           plan.inner_stride, col_end - col);
+            }
+        }
+    };
+    static_cast<naive::HandleImpl*>(handle)->dispatch_kern(
+            kern, plan.nr_outer * nr_col_blocks);
+}
+
+/*!
+ * \brief run the gather (if fwd) or scatter kernel
+ * \return false if the layout is not supported
+ */
+template <bool fwd, bool incr>
+bool dispatch_exec(Handle* handle, const TensorND& data, const TensorND& value,
+                   const IndexingMultiAxisVecBase::IndexDesc& index,
+                   const IndexingMultiAxisVecBase::ExecInfo& info,
+                   const Workspace& workspace) {
+    Plan plan;
+    if (!make_plan(data.layout, value.layout, index, info, plan)) {
+        return false;
+    }
+    auto idx_offset = workspace.ptr<ptrdiff_t>();
+    auto data_layout = data.layout;
+    MEGDNN_DISPATCH_CPU_KERN(
+            static_cast<naive::HandleImpl*>(handle),
+            compute_idx_offset(data_layout, index, plan.nr_idx, idx_offset));
+#define cb(_dt)                                                              \
+    case DTypeTrait<_dt>::enumv: {                                           \
+        MIDOUT_BEGIN(megdnn_fallback_indexing_multi_axis_vec,                \
+                     midout_iv(fwd * 2 + incr), _dt) {                       \
+            using ctype = DTypeTrait<_dt>::ctype;                            \
+            if (fwd) {                                                       \
+                exec_gather<ctype>(handle, data, value, plan, idx_offset);   \
+            } else {                                                         \
+                exec_scatter<ctype, incr>(handle, data, value, plan,         \
+                                          idx_offset);                       \
+            }                                                                \
+            return true;                                                     \
+        }                                                                    \
+        MIDOUT_END();                                                        \
+        break;                                                               \
+    }
+    switch (data.layout.dtype.enumv()) {
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+        cb(::megdnn::dtype::Bool)
+        default:
+            megdnn_throw("bad dtype");
+    }
+#undef cb
+    return false;
+}
+}  // anonymous namespace
+
+size_t IndexingMultiAxisVecImpl::get_workspace_in_bytes(size_t dst_idx_size) {
+    return dst_idx_size * sizeof(ptrdiff_t);
+}
+
+void IndexingMultiAxisVecImpl::exec(_megdnn_tensor_in src,
+                                    const IndexDesc& index,
+                                    _megdnn_tensor_out dst,
+                                    _megdnn_workspace workspace) {
+    auto info = check_exec(src.layout, index, dst.layout, workspace.size);
+    if (!dispatch_exec<true, false>(handle(), src, dst, index, info,
+                                    workspace)) {
+        naive::IndexingMultiAxisVecImpl::exec(src, index, dst, workspace);
+    }
+}
+
+size_t IndexingSetMultiAxisVecImpl::get_workspace_in_bytes(
+        size_t value_idx_size) {
+    return value_idx_size * sizeof(ptrdiff_t);
+}
+
+void IndexingSetMultiAxisVecImpl::exec(_megdnn_tensor_inout data,
+                                       _megdnn_tensor_in value,
+                                       const IndexDesc& index,
+                                       _megdnn_workspace workspace) {
+    auto info = check_exec(data.layout, value.layout, index, workspace.size);
+    if (!dispatch_exec<false, false>(handle(), data, value, index, info,
+                                     workspace)) {
+        naive::IndexingSetMultiAxisVecImpl::exec(data, value, index,
+                                                 workspace);
+    }
+}
+
+size_t IndexingIncrMultiAxisVecImpl::get_workspace_in_bytes(
+        size_t value_idx_size) {
+    return value_idx_size * sizeof(ptrdiff_t);
+}
+
+void IndexingIncrMultiAxisVecImpl::exec(_megdnn_tensor_inout data,
+                                        _megdnn_tensor_in value,
+                                        const IndexDesc& index,
+                                        _megdnn_workspace workspace) {
+    auto info = check_exec(data.layout, value.layout, index, workspace.size);
+    if (!dispatch_exec<false, true>(handle(), data, value, index, info,
+                                    workspace)) {
+        naive::IndexingIncrMultiAxisVecImpl::exec(data, value, index,
+                                                  workspace);
+    }
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,68 @@
+/**
+ * \file dnn/src/fallback/indexing_multi_axis_vec/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/indexing_multi_axis_vec/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*
+ * The data offset of each index position is computed once into the
+ * workspace; then the rows of value, i.e. the elements on the axes after the
+ * indexed axis, are copied by memcpy when they are contiguous.
+ *
+ * Gather rows are split among the threads freely. For set and incr, each
+ * thread owns a disjoint part of data (an outer slice or a range of columns)
+ * and visits all index positions in order, so duplicated indices need no
+ * synchronization and the results are the same as the naive impl.
+ *
+ * Layouts whose rows can not be collapsed into one dim are handled by the
+ * naive impl.
+ */
+
+class IndexingMultiAxisVecImpl final : public naive::IndexingMultiAxisVecImpl {
+public:
+    using naive::IndexingMultiAxisVecImpl::IndexingMultiAxisVecImpl;
+
+    size_t get_workspace_in_bytes(size_t dst_idx_size) override;
+
+    void exec(_megdnn_tensor_in src, const IndexDesc& index,
+              _megdnn_tensor_out dst, _megdnn_workspace workspace) override;
+};
+
+class IndexingSetMultiAxisVecImpl final
+        : public naive::IndexingSetMultiAxisVecImpl {
+public:
+    using naive::IndexingSetMultiAxisVecImpl::IndexingSetMultiAxisVecImpl;
+
+    size_t get_workspace_in_bytes(size_t value_idx_size) override;
+
+    void exec(_megdnn_tensor_inout data, _megdnn_tensor_in value,
+              const IndexDesc& index, _megdnn_workspace workspace) override;
+};
+
+class IndexingIncrMultiAxisVecImpl final
+        : public naive::IndexingIncrMultiAxisVecImpl {
+public:
+    using naive::IndexingIncrMultiAxisVecImpl::IndexingIncrMultiAxisVecImpl;
+
+    size_t get_workspace_in_bytes(size_t value_idx_size) override;
+
+    void exec(_megdnn_tensor_inout data, _megdnn_tensor_in value,
+              const IndexDesc& index, _megdnn_workspace workspace) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,280 @@
+/**
+ * \file dnn/src/fallback/layer_norm/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/layer_norm/opr_impl.h"
+#include "src/common/utils.h"
+#include "src/fallback/float4_helper.h"
+#include "src/naive/handle.h"
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_layer_norm)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+using F4 = Float4;
+
+//! number of columns summed up by a task when reducing the partial gradients
+constexpr size_t REDUCE_BLOCK = 256;
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+size_t get_nr_tasks(Handle* handle, size_t nr_rows) {
+    return std::max<size_t>(1, std::min(get_nr_threads(handle), nr_rows));
+}
+
+/*!
+ * \brief mean and rstd of a row in a single pass
+ *
+ * The sums are taken over the values shifted by the first one, which keeps the
+ * variance accurate when the mean is large compared to the deviation.
+ */
+void row_stat(const float* x, size_t n, float eps, float& mean, float& rstd) {
+    float shift = x[0];
+    auto vshift = F4::set1(shift);
+    auto s0 = F4::set1(0.f), s1 = s0, q0 = s0, q1 = s0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto d0 = F4::sub(F4::load(x + i), vshift),
+             d1 = F4::sub(F4::load(x + i + 4), vshift);
+        s0 = F4::add(s0, d0);
+        s1 = F4::add(s1, d1);
+        q0 = F4::add(q0, F4::mul(d0, d0));
+        q1 = F4::add(q1, F4::mul(d1, d1));
+    }
+    float s = F4::reduce_add(F4::add(s0, s1)),
+          q = F4::reduce_add(F4::add(q0, q1));
+    for (; i < n; ++i) {
+        float d = x[i] - shift;
+        s += d;
+        q += d * d;
+    }
+    float m = s / n;
+    float var = std::max(q / n - m * m, 0.f);
+    mean = shift + m;
+    rstd = 1.f / std::sqrt(var + eps);
+}
+
+void forward_row(const float* x, const float* weight, const float* bias,
+                 float* y, size_t n, float eps, float& mean, float& rstd) {
+    row_stat(x, n, eps, mean, rstd);
+    auto vmean = F4::set1(mean), vrstd = F4::set1(rstd);
+    size_t i = 0;
+    if (weight) {
+        for (; i + 4 <= n; i += 4) {
+            auto v = F4::mul(F4::sub(F4::load(x + i), vmean), vrstd);
+            F4::store(y + i, F4::add(F4::mul(v, F4::load(weight + i)),
+                                     F4::load(bias + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = (x[i] - mean) * rstd * weight[i] + bias[i];
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            F4::store(y + i, F4::mul(F4::sub(F4::load(x + i), vmean), vrstd));
+        }
+        for (; i < n; ++i) {
+            y[i] = (x[i] - mean) * rstd;
+        }
+    }
+}
+
+/*!
+ * \brief gradient of a row
+ *
+ * The gradients of weight and bias of the row are added to dweight and dbias
+ * if weight is given.
+ */
+void backward_row(const float* dy, const float* x, const float* weight,
+                  float mean, float rstd, float* dx, float* dweight,
+                  float* dbias, size_t n) {
+    auto vmean = F4::set1(mean), vrstd = F4::set1(rstd);
+    auto sg = F4::set1(0.f), sgx = sg;
+    float sum_g = 0, sum_gx = 0;
+    size_t i = 0;
+    if (weight) {
+        for (; i + 4 <= n; i += 4) {
+            auto vdy = F4::load(dy + i);
+            auto xhat = F4::mul(F4::sub(F4::load(x + i), vmean), vrstd);
+            auto g = F4::mul(vdy, F4::load(weight + i));
+            sg = F4::add(sg, g);
+            sgx = F4::add(sgx, F4::mul(g, xhat));
+            F4::store(dweight + i,
+                      F4::add(F4::load(dweight + i), F4::mul(vdy, xhat)));
+            F4::store(dbias + i, F4::add(F4::load(dbias + i), vdy));
+        }
+        for (; i < n; ++i) {
+            float xhat = (x[i] - mean) * rstd, g = dy[i] * weight[i];
+            sum_g += g;
+            sum_gx += g * xhat;
+            dweight[i] += dy[i] * xhat;
+            dbias[i] += dy[i];
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            auto g = F4::load(dy + i);
+            auto xhat = F4::mul(F4::sub(F4::load(x + i), vmean), vrstd);
+            sg = F4::add(sg, g);
+            sgx = F4::add(sgx, F4::mul(g, xhat));
+        }
+        for (; i < n; ++i) {
+            float xhat = (x[i] - mean) * rstd;
+            sum_g += dy[i];
+            sum_gx += dy[i] * xhat;
+        }
+    }
+    sum_g += F4::reduce_add(sg);
+    sum_gx += F4::reduce_add(sgx);
+
+    // dx = (g - mean(g) - xhat * mean(g * xhat)) * rstd
+    float mean_g = sum_g / n, mean_gx = sum_gx / n;
+    auto vmean_g = F4::set1(mean_g), vmean_gx = F4::set1(mean_gx);
+    i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto g = F4::load(dy + i);
+        if (weight) {
+            g = F4::mul(g, F4::load(weight + i));
+        }
+        auto xhat = F4::mul(F4::sub(F4::load(x + i), vmean), vrstd);
+        auto v = F4::sub(F4::sub(g, vmean_g), F4::mul(xhat, vmean_gx));
+        F4::store(dx + i, F4::mul(v, vrstd));
+    }
+    for (; i < n; ++i) {
+        float g = weight ? dy[i] * weight[i] : dy[i];
+        float xhat = (x[i] - mean) * rstd;
+        dx[i] = (g - mean_g - xhat * mean_gx) * rstd;
+    }
+}
+
+}  // anonymous namespace
+
+void LayerNormForwardImpl::exec(_megdnn_tensor_in data,
+                                _megdnn_tensor_in weight,
+                                _megdnn_tensor_in bias, _megdnn_tensor_out dst,
+                                _megdnn_tensor_out mean,
+                                _megdnn_tensor_out rstd,
+                                _megdnn_workspace workspace) {
+    if (data.layout.dtype != dtype::Float32()) {
+        return naive::LayerNormForwardImpl::exec(data, weight, bias, dst, mean,
+                                                 rstd, workspace);
+    }
+    check_exec(data.layout, weight.layout, bias.layout, dst.layout,
+               mean.layout, rstd.layout, workspace.size);
+    size_t nr_rows = mean.layout.total_nr_elems(),
+           n = param().normalized_size;
+    size_t nr_tasks = get_nr_tasks(handle(), nr_rows);
+    MIDOUT_BEGIN(megdnn_fallback_layer_norm, midout_iv(0)) {
+        auto xptr = data.ptr<dt_float32>();
+        auto yptr = dst.ptr<dt_float32>();
+        auto wptr = param().affine ? weight.ptr<dt_float32>() : nullptr;
+        auto bptr = param().affine ? bias.ptr<dt_float32>() : nullptr;
+        auto mptr = mean.ptr<dt_float32>();
+        auto rptr = rstd.ptr<dt_float32>();
+        float eps = param().eps;
+        auto kern = [=](size_t task_id, size_t) {
+            size_t end = nr_rows * (task_id + 1) / nr_tasks;
+            for (size_t i = nr_rows * task_id / nr_tasks; i < end; ++i) {
+                forward_row(xptr + i * n, wptr, bptr, yptr + i * n, n, eps,
+                            mptr[i], rptr[i]);
+            }
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_tasks);
+    }
+    MIDOUT_END();
+}
+
+void LayerNormBackwardImpl::exec(_megdnn_tensor_in diff,
+                                 _megdnn_tensor_in data,
+                                 _megdnn_tensor_in weight,
+                                 _megdnn_tensor_in mean,
+                                 _megdnn_tensor_in rstd,
+                                 _megdnn_tensor_out ddata,
+                                 _megdnn_tensor_out dweight,
+                                 _megdnn_tensor_out dbias,
+                                 _megdnn_workspace workspace) {
+    if (data.layout.dtype != dtype::Float32()) {
+        return naive::LayerNormBackwardImpl::exec(diff, data, weight, mean,
+                                                  rstd, ddata, dweight, dbias,
+                                                  workspace);
+    }
+    check_exec(diff.layout, data.layout, weight.layout, mean.layout,
+               rstd.layout, ddata.layout, dweight.layout, dbias.layout,
+               workspace.size);
+    size_t nr_rows = mean.layout.total_nr_elems(),
+           n = param().normalized_size;
+    size_t nr_tasks = get_nr_tasks(handle(), nr_rows);
+    bool affine = param().affine;
+    MIDOUT_BEGIN(megdnn_fallback_layer_norm, midout_iv(1)) {
+        auto dyptr = diff.ptr<dt_float32>();
+        auto xptr = data.ptr<dt_float32>();
+        auto wptr = affine ? weight.ptr<dt_float32>() : nullptr;
+        auto mptr = mean.ptr<dt_float32>();
+        auto rptr = rstd.ptr<dt_float32>();
+        auto dxptr = ddata.ptr<dt_float32>();
+        // partial dweight and dbias of each task
+        auto partial = workspace.ptr<dt_float32>();
+        auto kern = [=](size_t task_id, size_t) {
+            float *dw = nullptr, *db = nullptr;
+            if (affine) {
+                dw = partial + task_id * 2 * n;
+                db = dw + n;
+                std::fill(dw, dw + 2 * n, 0.f);
+            }
+            size_t end = nr_rows * (task_id + 1) / nr_tasks;
+            for (size_t i = nr_rows * task_id / nr_tasks; i < end; ++i) {
+                backward_row(dyptr + i * n, xptr + i * n, wptr, mptr[i],
+                             rptr[i], dxptr + i * n, dw, db, n);
+            }
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_tasks);
+
+        if (affine) {
+            auto dwptr = dweight.ptr<dt_float32>();
+            auto dbptr = dbias.ptr<dt_float32>();
+            size_t nr_blocks = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+            auto reduce_kern = [=](size_t index, size_t) {
+                size_t begin = index * REDUCE_BLOCK,
+                       end = std::min(begin + REDUCE_BLOCK, n);
+                std::copy(partial + begin, partial + end, dwptr + begin);
+                std::copy(partial + n + begin, partial + n + end,
+                          dbptr + begin);
+                for (size_t t = 1; t < nr_tasks; ++t) {
+                    const float* dw = partial + t * 2 * n;
+                    for (size_t j = begin; j < end; ++j) {
+                        dwptr[j] += dw[j];
+                        dbptr[j] += dw[n + j];
+                    }
+                }
+            };
+            MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(reduce_kern, nr_blocks);
+        }
+    }
+    MIDOUT_END();
+}
+
+size_t LayerNormBackwardImpl::get_workspace_in_bytes(
+        const TensorLayout&, const TensorLayout& data, const TensorLayout&,
+        const TensorLayout& mean, const TensorLayout&, const TensorLayout&,
+        const TensorLayout&, const TensorLayout&) {
+    if (data.dtype != dtype::Float32() || !param().affine) {
+        return 0;
+    }
+    size_t nr_tasks = get_nr_tasks(handle(), mean.total_nr_elems());
+    return nr_tasks * 2 * param().normalized_size * sizeof(dt_float32);
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,62 @@
+/**
+ * \file dnn/src/fallback/layer_norm/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/layer_norm/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief float32 layer norm whose statistics are computed in a single pass
+ *
+ * Rows are distributed among threads; other dtypes are handled by the naive
+ * impl.
+ */
+class LayerNormForwardImpl : public naive::LayerNormForwardImpl {
+public:
+    using naive::LayerNormForwardImpl::LayerNormForwardImpl;
+    void exec(_megdnn_tensor_in data, _megdnn_tensor_in weight,
+              _megdnn_tensor_in bias, _megdnn_tensor_out dst,
+              _megdnn_tensor_out mean, _megdnn_tensor_out rstd,
+              _megdnn_workspace workspace) override;
+};
+
+/*!
+ * \brief float32 layer norm backward
+ *
+ * Each thread accumulates the gradients of weight and bias of its rows in the
+ * workspace while computing the gradient of data, and the partial sums are
+ * added up afterwards.
+ */
+class LayerNormBackwardImpl : public naive::LayerNormBackwardImpl {
+public:
+    using naive::LayerNormBackwardImpl::LayerNormBackwardImpl;
+    void exec(_megdnn_tensor_in diff, _megdnn_tensor_in data,
+              _megdnn_tensor_in weight, _megdnn_tensor_in mean,
+              _megdnn_tensor_in rstd, _megdnn_tensor_out ddata,
+              _megdnn_tensor_out dweight, _megdnn_tensor_out dbias,
+              _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& diff,
+                                  const TensorLayout& data,
+                                  const TensorLayout& weight,
+                                  const TensorLayout& mean,
+                                  const TensorLayout& rstd,
+                                  const TensorLayout& ddata,
+                                  const TensorLayout& dweight,
+                                  const TensorLayout& dbias) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
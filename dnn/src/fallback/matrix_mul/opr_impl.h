@@ -124,6 +124,8 @@ public:
             X86_F32_MK8_8X8,
             X86_INT8X8X32_VNNI,
             X86_INT8X8X32_MKLDNN,
+            X86_F32_AVX2_6X16,
+            X86_F32_AVX512_12X32,
 #elif MEGDNN_AARCH64 || MEGDNN_ARMV7
             ARM_COMMON_INT8X8X16 = 1 << 8,
             ARM_COMMON_INT8X8X32_GEMV,
@@ -0,0 +1,442 @@
+/**
+ * \file dnn/src/fallback/mesh_indexing/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/mesh_indexing/opr_impl.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_mesh_indexing)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+//! number of elements ahead to prefetch in a row
+constexpr size_t PREFETCH_DIST = 8;
+//! minimal number of elements handled by a thread
+constexpr size_t MIN_TASK_SIZE = 4096;
+
+using IndexDesc = MeshBase::IndexDesc;
+
+enum class Mode { GATHER, SET, INCR };
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+/*!
+ * \brief value (the indexed tensor) is walked by rows along its last axis;
+ *      element idx of value corresponds to the element at
+ *      sum(offset(k, idx[0])[idx[k]]) in data
+ */
+struct Plan {
+    size_t ndim, nr_rows;
+    size_t shape[TensorLayout::MAX_NDIM];
+    ptrdiff_t value_stride[TensorLayout::MAX_NDIM];
+    //! whether the offsets of an axis depend on the batch
+    bool batched[TensorLayout::MAX_NDIM];
+    //! whether the last axis is not indexed and contiguous in both tensors
+    bool contig_row;
+    //! whether writes to different slices of axis 0 are disjoint
+    bool disjoint_slices;
+    //! data offset of each position on each axis, which are in the
+    //! workspace and filled by compute_offset()
+    ptrdiff_t* offset[TensorLayout::MAX_NDIM];
+
+    const ptrdiff_t* axis_offset(size_t axis, size_t batch) const {
+        return offset[axis] + (batched[axis] ? batch * shape[axis] : 0);
+    }
+};
+
+//! number of offsets stored for an axis, which are per batch if the axis is
+//! batched
+size_t nr_axis_offset(size_t size, size_t nr_batch, bool batched) {
+    return batched ? nr_batch * size : size;
+}
+
+size_t get_workspace(const TensorShape& indexed, const size_t* axes,
+                     size_t nr_axes, bool batched) {
+    size_t nr = 0;
+    for (size_t i = 0; i < indexed.ndim; ++i) {
+        bool is_indexed = std::find(axes, axes + nr_axes, i) != axes + nr_axes;
+        nr += nr_axis_offset(indexed.shape[i], indexed.shape[0],
+                             batched && is_indexed);
+    }
+    return nr * sizeof(ptrdiff_t);
+}
+
+/*!
+ * \return false if the workspace is too small, which happens when it is
+ *      allocated by a caller unaware of this impl
+ */
+bool make_plan(const TensorLayout& data, const TensorLayout& value,
+               const IndexDesc& desc, bool batched, const Workspace& workspace,
+               Plan& plan) {
+    plan.ndim = value.ndim;
+    plan.nr_rows = 1;
+    for (size_t i = 0; i < value.ndim; ++i) {
+        plan.shape[i] = value.shape[i];
+        plan.value_stride[i] = value.stride[i];
+        plan.batched[i] = false;
+        if (i + 1 < value.ndim) {
+            plan.nr_rows *= value.shape[i];
+        }
+    }
+    bool last_indexed = false, first_indexed = false;
+    for (auto&& i : desc) {
+        plan.batched[i.axis] = batched;
+        last_indexed |= i.axis + 1 == value.ndim;
+        first_indexed |= i.axis == 0;
+    }
+    size_t last = value.ndim - 1;
+    plan.contig_row = !last_indexed && data.stride[last] == 1 &&
+                      value.stride[last] == 1;
+    plan.disjoint_slices = value.ndim > 1 && !first_indexed;
+
+    size_t axes[TensorLayout::MAX_NDIM], nr_axes = 0;
+    for (auto&& i : desc) {
+        axes[nr_axes++] = i.axis;
+    }
+    if (workspace.size < get_workspace(value, axes, nr_axes, batched)) {
+        return false;
+    }
+    auto ptr = workspace.ptr<ptrdiff_t>();
+    for (size_t i = 0; i < value.ndim; ++i) {
+        plan.offset[i] = ptr;
+        ptr += nr_axis_offset(plan.shape[i], plan.shape[0], plan.batched[i]);
+    }
+    return true;
+}
+
+//! offset in data of each position, with negative indices wrapped
+void compute_offset(const Plan& plan, const TensorLayout& data,
+                    const IndexDesc& desc) {
+    for (size_t axis = 0; axis < plan.ndim; ++axis) {
+        auto offset = plan.offset[axis];
+        for (size_t i = 0; i < plan.shape[axis]; ++i) {
+            offset[i] = data.stride[axis] * static_cast<ptrdiff_t>(i);
+        }
+    }
+    for (auto&& s : desc) {
+        size_t axis = s.axis, size = plan.shape[axis],
+               data_shape = data.shape[axis],
+               nr_batch = plan.batched[axis] ? plan.shape[0] : 1;
+        auto&& vec_layout = s.vec.layout;
+        ptrdiff_t batch_stride = plan.batched[axis] ? vec_layout.stride[0] : 0,
+                  vec_stride = vec_layout.stride[vec_layout.ndim - 1];
+        auto vec = s.vec.ptr<dt_int32>();
+        auto offset = plan.offset[axis];
+        for (size_t b = 0; b < nr_batch; ++b) {
+            for (size_t j = 0; j < size; ++j) {
+                dt_int32 data_idx = vec[batch_stride * b + vec_stride * j];
+                if (data_idx < 0)
+                    data_idx += data_shape;
+                megdnn_assert(data_idx >= 0 &&
+                                      static_cast<size_t>(data_idx) <
+                                              data_shape,
+                              "bad index value on axis %zu at position %zu",
+                              axis, j);
+                offset[b * size + j] = data.stride[axis] * data_idx;
+            }
+        }
+    }
+}
+
+template <Mode mode>
+struct RowOp;
+
+template <>
+struct RowOp<Mode::GATHER> {
+    template <typename ctype>
+    static void contig(ctype* data, ctype* value, size_t n) {
+        memcpy(value, data, n * sizeof(ctype));
+    }
+    template <typename ctype>
+    static void elem(ctype* data, ctype* value) {
+        *value = *data;
+    }
+};
+
+template <>
+struct RowOp<Mode::SET> {
+    template <typename ctype>
+    static void contig(ctype* data, ctype* value, size_t n) {
+        memcpy(data, value, n * sizeof(ctype));
+    }
+    template <typename ctype>
+    static void elem(ctype* data, ctype* value) {
+        *data = *value;
+    }
+};
+
+template <>
+struct RowOp<Mode::INCR> {
+    template <typename ctype>
+    static void contig(ctype* data, ctype* value, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            data[i] += value[i];
+        }
+    }
+    template <typename ctype>
+    static void elem(ctype* data, ctype* value) {
+        *data += *value;
+    }
+};
+
+template <typename ctype, Mode mode>
+void run_row(ctype* data, const ptrdiff_t* offset, ctype* value,
+             ptrdiff_t value_stride, size_t n, bool contig) {
+    if (contig) {
+        RowOp<mode>::contig(data, value, n);
+        return;
+    }
+    for (size_t j = 0; j < n; ++j) {
+        if (j + PREFETCH_DIST < n) {
+            __builtin_prefetch(data + offset[j + PREFETCH_DIST],
+                               mode != Mode::GATHER);
+        }
+        RowOp<mode>::elem(data + offset[j], value + j * value_stride);
+    }
+}
+
+template <typename ctype, Mode mode>
+void exec_mesh(Handle* handle, const TensorND& data, const TensorND& value,
+               const IndexDesc& desc, const Plan& plan) {
+    auto handle_impl = static_cast<naive::HandleImpl*>(handle);
+    auto data_layout = data.layout;
+    MEGDNN_DISPATCH_CPU_KERN(handle_impl,
+                             compute_offset(plan, data_layout, desc));
+
+    // gather rows are split freely; a modifying task owns whole slices of
+    // axis 0 so that duplicated indices are visited in order by one thread
+    size_t unit = 1, nr_units = plan.nr_rows;
+    if (mode != Mode::GATHER) {
+        if (plan.disjoint_slices) {
+            nr_units = plan.shape[0];
+            unit = plan.nr_rows / nr_units;
+        } else {
+            unit = plan.nr_rows;
+            nr_units = 1;
+        }
+    }
+    size_t last = plan.ndim - 1, row_len = plan.shape[last],
+           units_per_task =
+                   std::max<size_t>(1, MIN_TASK_SIZE / (unit * row_len));
+    size_t nr_tasks = std::max<size_t>(
+            1, std::min(get_nr_threads(handle) * 4,
+                        (nr_units + units_per_task - 1) / units_per_task));
+    ctype* data_ptr = data.ptr<ctype>();
+    ctype* value_ptr = value.ptr<ctype>();
+    auto kern = [=](size_t task_id, size_t) {
+        size_t row = nr_units * task_id / nr_tasks * unit,
+               row_end = nr_units * (task_id + 1) / nr_tasks * unit;
+        size_t outer_ndim = last, idx[TensorLayout::MAX_NDIM];
+        for (size_t i = outer_ndim, r = row; i; --i) {
+            idx[i - 1] = r % plan.shape[i - 1];
+            r /= plan.shape[i - 1];
+        }
+        auto batch_of = [&]() -> size_t { return outer_ndim ? idx[0] : 0; };
+        ptrdiff_t data_off, value_off;
+        auto get_offset = [&]() {
+            data_off = value_off = 0;
+            for (size_t i = 0; i < outer_ndim; ++i) {
+                data_off += plan.axis_offset(i, batch_of())[idx[i]];
+                value_off += static_cast<ptrdiff_t>(idx[i]) *
+                             plan.value_stride[i];
+            }
+        };
+        get_offset();
+        for (; row < row_end; ++row) {
+            ptrdiff_t cur_data_off = data_off, cur_value_off = value_off;
+            const ptrdiff_t* offset = plan.axis_offset(last, batch_of());
+            for (size_t i = outer_ndim; i; --i) {
+                if (++idx[i - 1] < plan.shape[i - 1])
+                    break;
+                idx[i - 1] = 0;
+            }
+            if (row + 1 < row_end) {
+                // rows are scattered in data, so fetch the next one early
+                get_offset();
+                __builtin_prefetch(
+                        data_ptr + data_off +
+                                plan.axis_offset(last, batch_of())[0],
+                        mode != Mode::GATHER);
+            }
+            run_row<ctype, mode>(data_ptr + cur_data_off, offset,
+                                 value_ptr + cur_value_off,
+                                 plan.value_stride[last], row_len,
+                                 plan.contig_row);
+        }
+    };
+    handle_impl->dispatch_kern(kern, nr_tasks);
+}
+
+#define cb(_dt)                                                             \
+    case DTypeTrait<_dt>::enumv: {                                          \
+        MIDOUT_BEGIN(megdnn_fallback_mesh_indexing,                         \
+                     midout_iv(static_cast<int>(mode)), _dt) {              \
+            exec_mesh<DTypeTrait<_dt>::ctype, mode>(handle, data, value,    \
+                                                    desc, plan);            \
+            return true;                                                    \
+        }                                                                   \
+        MIDOUT_END();                                                       \
+        break;                                                              \
+    }
+
+//! quantized dtypes are only gathered and set, as in the naive impl
+template <Mode mode>
+bool dispatch_quantized(Handle* handle, const TensorND& data,
+                        const TensorND& value, const IndexDesc& desc,
+                        const Plan& plan) {
+    switch (data.layout.dtype.enumv()) {
+        MEGDNN_FOREACH_QUANTIZED_DTYPE(cb)
+        default:
+            break;
+    }
+    return false;
+}
+
+template <>
+bool dispatch_quantized<Mode::INCR>(Handle*, const TensorND&, const TensorND&,
+                                    const IndexDesc&, const Plan&) {
+    return false;
+}
+
+//! \return false if the dtype is not supported or the workspace is too small
+template <Mode mode>
+bool dispatch_exec(Handle* handle, const TensorND& data,
+                   const TensorND& value, const IndexDesc& desc, bool batched,
+                   const Workspace& workspace) {
+    if (!value.layout.total_nr_elems()) {
+        return true;
+    }
+    Plan plan;
+    if (!make_plan(data.layout, value.layout, desc, batched, workspace,
+                   plan)) {
+        return false;
+    }
+    switch (data.layout.dtype.enumv()) {
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb)
+        default:
+            break;
+    }
+    return dispatch_quantized<mode>(handle, data, value, desc, plan);
+}
+#undef cb
+
+}  // anonymous namespace
+
+/* =========================== MeshIndexing ============================ */
+
+size_t MeshIndexingImpl::get_workspace_in_bytes(const TensorShape& indexed,
+                                                const size_t* axes,
+                                                size_t nr_axes) {
+    return get_workspace(indexed, axes, nr_axes, false);
+}
+
+void MeshIndexingImpl::exec(_megdnn_tensor_in src, const IndexDesc& desc,
+                            _megdnn_tensor_out dst,
+                            _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, desc);
+    if (!dispatch_exec<Mode::GATHER>(handle(), src, dst, desc, false,
+                                     workspace)) {
+        naive::MeshIndexingImpl::exec(src, desc, dst, workspace);
+    }
+}
+
+size_t IncrMeshIndexingImpl::get_workspace_in_bytes(
+        const TensorShape& indexed, const size_t* axes, size_t nr_axes) {
+    return get_workspace(indexed, axes, nr_axes, false);
+}
+
+void IncrMeshIndexingImpl::exec(_megdnn_tensor_inout data,
+                                _megdnn_tensor_in value, const IndexDesc& desc,
+                                _megdnn_workspace workspace) {
+    check_exec(data.layout, value.layout, desc);
+    if (!dispatch_exec<Mode::INCR>(handle(), data, value, desc, false,
+                                   workspace)) {
+        naive::IncrMeshIndexingImpl::exec(data, value, desc, workspace);
+    }
+}
+
+size_t SetMeshIndexingImpl::get_workspace_in_bytes(const TensorShape& indexed,
+                                                   const size_t* axes,
+                                                   size_t nr_axes) {
+    return get_workspace(indexed, axes, nr_axes, false);
+}
+
+void SetMeshIndexingImpl::exec(_megdnn_tensor_inout data,
+                               _megdnn_tensor_in value, const IndexDesc& desc,
+                               _megdnn_workspace workspace) {
+    check_exec(data.layout, value.layout, desc);
+    if (!dispatch_exec<Mode::SET>(handle(), data, value, desc, false,
+                                  workspace)) {
+        naive::SetMeshIndexingImpl::exec(data, value, desc, workspace);
+    }
+}
+
+/* ========================= BatchedMeshIndexing =========================== */
+
+size_t BatchedMeshIndexingImpl::get_workspace_in_bytes(
+        const TensorShape& indexed, const size_t* axes, size_t nr_axes) {
+    return get_workspace(indexed, axes, nr_axes, true);
+}
+
+void BatchedMeshIndexingImpl::exec(_megdnn_tensor_in src, const IndexDesc& desc,
+                                   _megdnn_tensor_out dst,
+                                   _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, desc);
+    if (!dispatch_exec<Mode::GATHER>(handle(), src, dst, desc, true,
+                                     workspace)) {
+        naive::BatchedMeshIndexingImpl::exec(src, desc, dst, workspace);
+    }
+}
+
+size_t BatchedIncrMeshIndexingImpl::get_workspace_in_bytes(
+        const TensorShape& indexed, const size_t* axes, size_t nr_axes) {
+    return get_workspace(indexed, axes, nr_axes, true);
+}
+
+void BatchedIncrMeshIndexingImpl::exec(_megdnn_tensor_inout data,
+                                       _megdnn_tensor_in value,
+                                       const IndexDesc& desc,
+                                       _megdnn_workspace workspace) {
+    check_exec(data.layout, value.layout, desc);
+    if (!dispatch_exec<Mode::INCR>(handle(), data, value, desc, true,
+                                   workspace)) {
+        naive::BatchedIncrMeshIndexingImpl::exec(data, value, desc, workspace);
+    }
+}
+
+size_t BatchedSetMeshIndexingImpl::get_workspace_in_bytes(
+        const TensorShape& indexed, const size_t* axes, size_t nr_axes) {
+    return get_workspace(indexed, axes, nr_axes, true);
+}
+
+void BatchedSetMeshIndexingImpl::exec(_megdnn_tensor_inout data,
+                                      _megdnn_tensor_in value,
+                                      const IndexDesc& desc,
+                                      _megdnn_workspace workspace) {
+    check_exec(data.layout, value.layout, desc);
+    if (!dispatch_exec<Mode::SET>(handle(), data, value, desc, true,
+                                  workspace)) {
+        naive::BatchedSetMeshIndexingImpl::exec(data, value, desc, workspace);
+    }
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,102 @@
+/**
+ * \file dnn/src/fallback/mesh_indexing/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/mesh_indexing/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*
+ * The data offset of each position on each axis is computed once (per batch
+ * for the batched oprs) into the workspace; then the indexed tensor is walked
+ * row by row, a row being its last axis, which is copied by memcpy when it is
+ * not indexed and contiguous on both sides.
+ *
+ * Gather rows are split among the threads freely. For set and incr, the rows
+ * are split by the first axis only when it is not indexed, so each thread
+ * owns a disjoint slice of data and the results are the same as the naive
+ * impl; otherwise they run on a single thread.
+ */
+
+class MeshIndexingImpl final : public naive::MeshIndexingImpl {
+public:
+    using naive::MeshIndexingImpl::MeshIndexingImpl;
+
+    size_t get_workspace_in_bytes(const TensorShape& indexed,
+                                  const size_t* axes,
+                                  size_t nr_axes) override;
+    void exec(_megdnn_tensor_in src, const IndexDesc& desc,
+              _megdnn_tensor_out dst, _megdnn_workspace workspace) override;
+};
+
+class IncrMeshIndexingImpl final : public naive::IncrMeshIndexingImpl {
+public:
+    using naive::IncrMeshIndexingImpl::IncrMeshIndexingImpl;
+
+    size_t get_workspace_in_bytes(const TensorShape& indexed,
+                                  const size_t* axes,
+                                  size_t nr_axes) override;
+    void exec(_megdnn_tensor_inout data, _megdnn_tensor_in value,
+              const IndexDesc& desc, _megdnn_workspace workspace) override;
+};
+
+class SetMeshIndexingImpl final : public naive::SetMeshIndexingImpl {
+public:
+    using naive::SetMeshIndexingImpl::SetMeshIndexingImpl;
+
+    size_t get_workspace_in_bytes(const TensorShape& indexed,
+                                  const size_t* axes,
+                                  size_t nr_axes) override;
+    void exec(_megdnn_tensor_inout data, _megdnn_tensor_in value,
+              const IndexDesc& desc, _megdnn_workspace workspace) override;
+};
+
+class BatchedMeshIndexingImpl final : public naive::BatchedMeshIndexingImpl {
+public:
+    using naive::BatchedMeshIndexingImpl::BatchedMeshIndexingImpl;
+
+    size_t get_workspace_in_bytes(const TensorShape& indexed,
+                                  const size_t* axes,
+                                  size_t nr_axes) override;
+    void exec(_megdnn_tensor_in src, const IndexDesc& desc,
+              _megdnn_tensor_out dst, _megdnn_workspace workspace) override;
+};
+
+class BatchedIncrMeshIndexingImpl final
+        : public naive::BatchedIncrMeshIndexingImpl {
+public:
+    using naive::BatchedIncrMeshIndexingImpl::BatchedIncrMeshIndexingImpl;
+
+    size_t get_workspace_in_bytes(const TensorShape& indexed,
+                                  const size_t* axes,
+                                  size_t nr_axes) override;
+    void exec(_megdnn_tensor_inout data, _megdnn_tensor_in value,
+              const IndexDesc& desc, _megdnn_workspace workspace) override;
+};
+
+class BatchedSetMeshIndexingImpl final
+        : public naive::BatchedSetMeshIndexingImpl {
+public:
+    using naive::BatchedSetMeshIndexingImpl::BatchedSetMeshIndexingImpl;
+
+    size_t get_workspace_in_bytes(const TensorShape& indexed,
+                                  const size_t* axes,
+                                  size_t nr_axes) override;
+    void exec(_megdnn_tensor_inout data, _megdnn_tensor_in value,
+              const IndexDesc& desc, _megdnn_workspace workspace) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
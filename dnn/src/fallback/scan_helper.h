@@ -0,0 +1,207 @@
+/**
+ * \file dnn/src/fallback/scan_helper.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "megdnn/dtype.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEGDNN_FALLBACK_SCAN_SSE 1
+#include <emmintrin.h>
+#else
+#define MEGDNN_FALLBACK_SCAN_SSE 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MEGDNN_FALLBACK_SCAN_NEON 1
+#include <arm_neon.h>
+#else
+#define MEGDNN_FALLBACK_SCAN_NEON 0
+#endif
+
+/*
+ * Building blocks of the two-pass parallel prefix sum: the input is split
+ * into blocks; the sum of each block is computed in parallel, the block sums
+ * are scanned serially to get the offset of each block, and then each block
+ * is scanned in parallel starting from its offset.
+ */
+
+namespace megdnn {
+namespace fallback {
+namespace scan {
+
+//! minimal number of elements in a block of the parallel scan
+constexpr size_t MIN_BLOCK_SIZE = 16384;
+
+//! number of blocks to split \p n elements into
+static inline size_t get_nr_blocks(size_t n, size_t nr_threads) {
+    return std::max<size_t>(1, std::min(nr_threads, n / MIN_BLOCK_SIZE));
+}
+
+//! begin of the \p i-th block when splitting \p n elements into \p nr_blocks
+static inline size_t block_begin(size_t n, size_t nr_blocks, size_t i) {
+    return n * i / nr_blocks;
+}
+
+//! sum of n contiguous values
+template <typename T>
+T contig_sum(const T* src, size_t n) {
+    // independent partial sums to hide the latency of the adds
+    T s0 = T(0), s1 = T(0), s2 = T(0), s3 = T(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += src[i];
+        s1 += src[i + 1];
+        s2 += src[i + 2];
+        s3 += src[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += src[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+/*!
+ * \brief scan the values in [begin, n) one by one
+ * \param carry sum of the values before src + begin
+ * \return carry plus the sum of the scanned values
+ */
+template <typename T>
+T scan_serial(const T* src, T* dst, size_t begin, size_t n, T carry,
+              bool exclusive) {
+    if (exclusive) {
+        for (size_t i = begin; i < n; ++i) {
+            T x = src[i];
+            dst[i] = carry;
+            carry += x;
+        }
+    } else {
+        for (size_t i = begin; i < n; ++i) {
+            carry += src[i];
+            dst[i] = carry;
+        }
+    }
+    return carry;
+}
+
+//! scan n contiguous values from the first one; see scan_serial()
+template <typename T>
+struct ContigScan {
+    static T run(const T* src, T* dst, size_t n, T carry, bool exclusive) {
+        return scan_serial(src, dst, 0, n, carry, exclusive);
+    }
+};
+
+/*
+ * The SIMD scans compute the prefix sums in a vector by two shift-and-add
+ * steps and add the carry broadcast from the last lane of the previous
+ * vector; the exclusive result is the inclusive one shifted by one lane.
+ */
+#if MEGDNN_FALLBACK_SCAN_SSE
+template <>
+struct ContigScan<dt_float32> {
+    static dt_float32 run(const dt_float32* src, dt_float32* dst, size_t n,
+                          dt_float32 carry, bool exclusive) {
+        __m128 vcarry = _mm_set1_ps(carry);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 x = _mm_loadu_ps(src + i);
+            __m128 s = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(
+                                             _mm_castps_si128(x), 4)));
+            s = _mm_add_ps(s, _mm_castsi128_ps(
+                                      _mm_slli_si128(_mm_castps_si128(s), 8)));
+            s = _mm_add_ps(s, vcarry);
+            if (exclusive) {
+                __m128 shifted = _mm_castsi128_ps(
+                        _mm_slli_si128(_mm_castps_si128(s), 4));
+                _mm_storeu_ps(dst + i, _mm_move_ss(shifted, vcarry));
+            } else {
+                _mm_storeu_ps(dst + i, s);
+            }
+            vcarry = _mm_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        return scan_serial(src, dst, i, n, _mm_cvtss_f32(vcarry), exclusive);
+    }
+};
+
+template <>
+struct ContigScan<dt_int32> {
+    static dt_int32 run(const dt_int32* src, dt_int32* dst, size_t n,
+                        dt_int32 carry, bool exclusive) {
+        __m128i vcarry = _mm_set1_epi32(carry);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128i x =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i s = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            s = _mm_add_epi32(s, _mm_slli_si128(s, 8));
+            s = _mm_add_epi32(s, vcarry);
+            __m128i out = s;
+            if (exclusive) {
+                out = _mm_or_si128(_mm_slli_si128(s, 4),
+                                   _mm_srli_si128(vcarry, 12));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+            vcarry = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        return scan_serial(src, dst, i, n,
+                           static_cast<dt_int32>(_mm_cvtsi128_si32(vcarry)),
+                           exclusive);
+    }
+};
+#elif MEGDNN_FALLBACK_SCAN_NEON
+template <>
+struct ContigScan<dt_float32> {
+    static dt_float32 run(const dt_float32* src, dt_float32* dst, size_t n,
+                          dt_float32 carry, bool exclusive) {
+        float32x4_t vcarry = vdupq_n_f32(carry), zero = vdupq_n_f32(0.f);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t x = vld1q_f32(src + i);
+            float32x4_t s = vaddq_f32(x, vextq_f32(zero, x, 3));
+            s = vaddq_f32(s, vextq_f32(zero, s, 2));
+            s = vaddq_f32(s, vcarry);
+            vst1q_f32(dst + i, exclusive ? vextq_f32(vcarry, s, 3) : s);
+            vcarry = vdupq_n_f32(vgetq_lane_f32(s, 3));
+        }
+        return scan_serial(src, dst, i, n, vgetq_lane_f32(vcarry, 0),
+                           exclusive);
+    }
+};
+
+template <>
+struct ContigScan<dt_int32> {
+    static dt_int32 run(const dt_int32* src, dt_int32* dst, size_t n,
+                        dt_int32 carry, bool exclusive) {
+        int32x4_t vcarry = vdupq_n_s32(carry), zero = vdupq_n_s32(0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            int32x4_t x = vld1q_s32(src + i);
+            int32x4_t s = vaddq_s32(x, vextq_s32(zero, x, 3));
+            s = vaddq_s32(s, vextq_s32(zero, s, 2));
+            s = vaddq_s32(s, vcarry);
+            vst1q_s32(dst + i, exclusive ? vextq_s32(vcarry, s, 3) : s);
+            vcarry = vdupq_n_s32(vgetq_lane_s32(s, 3));
+        }
+        return scan_serial(src, dst, i, n, vgetq_lane_s32(vcarry, 0),
+                           exclusive);
+    }
+};
+#endif
+
+}  // namespace scan
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,318 @@
+/**
+ * \file dnn/src/fallback/softmax/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/softmax/opr_impl.h"
+#include "src/common/reduce_helper.h"
+#include "src/common/utils.h"
+#include "src/fallback/float4_helper.h"
+#include "src/naive/handle.h"
+
+#include <limits>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_softmax)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+using F4 = Float4;
+
+/*
+ * The softmax axis has B values; it is contiguous if C == 1, and otherwise
+ * the C values of the inner dims are processed side by side in blocks of
+ * COL_BLOCK columns, each column keeping its own running max and sum.
+ */
+constexpr size_t COL_BLOCK = 16;
+
+constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+
+/*!
+ * \brief add exp(x - max) to the running sum, rescaling the sum if x is
+ *      larger than the running max
+ *
+ * A masked value x == -inf adds nothing; it is skipped since exp(x - max)
+ * would be NaN while the running max is still -inf.
+ */
+inline void online_update(float& max, float& sum, float x) {
+    if (x > max) {
+        sum = sum * std::exp(max - x) + 1.f;
+        max = x;
+    } else if (x != NEG_INF) {
+        sum += std::exp(x - max);
+    }
+}
+
+//! vector version of online_update(); exp of the rescale is only computed if
+//! the max of some lane grows, which is rare after the first few values
+inline void online_update(F4::vec& max, F4::vec& sum, F4::vec x) {
+    // lanes whose values are all -inf so far are shifted by the lowest finite
+    // float instead of their max, so they give exp(-inf) rather than NaN
+    auto lowest = F4::set1(std::numeric_limits<float>::lowest());
+    if (F4::any_gt(x, max)) {
+        auto new_max = F4::max(max, x), ref = F4::max(new_max, lowest);
+        sum = F4::add(F4::mul(sum, F4::exp(F4::sub(max, ref))),
+                      F4::exp(F4::sub(x, ref)));
+        max = new_max;
+    } else {
+        sum = F4::add(sum, F4::exp(F4::sub(x, F4::max(max, lowest))));
+    }
+}
+
+/*!
+ * \brief 1 / sum, or NaN if all the values are masked
+ *
+ * The naive impl gives exp(-inf - (-inf)) = NaN for such rows; the exp of
+ * F4 does not propagate NaN, so the scale carries it instead.
+ */
+inline float get_scale(float max, float sum) {
+    return max == NEG_INF ? std::numeric_limits<float>::quiet_NaN()
+                          : 1.f / sum;
+}
+
+//! max and sum of exp(x - max) of n contiguous values
+void contig_max_sum(const float* src, size_t n, float& max, float& sum) {
+    size_t i;
+    if (n >= 4) {
+        auto vmax = F4::load(src), vsum = F4::set1(1.f);
+        for (i = 4; i + 4 <= n; i += 4) {
+            online_update(vmax, vsum, F4::load(src + i));
+        }
+        max = F4::reduce_max(vmax);
+        sum = F4::reduce_add(
+                F4::mul(vsum, F4::exp(F4::sub(vmax, F4::set1(max)))));
+    } else {
+        max = src[0];
+        sum = 1.f;
+        i = 1;
+    }
+    for (; i < n; ++i) {
+        online_update(max, sum, src[i]);
+    }
+}
+
+void forward_contig(const float* src, float* dst, size_t n) {
+    float max, sum;
+    contig_max_sum(src, n, max, sum);
+    float scale = get_scale(max, sum);
+    auto vmax = F4::set1(max), vscale = F4::set1(scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        F4::store(dst + i,
+                  F4::mul(F4::exp(F4::sub(F4::load(src + i), vmax)), vscale));
+    }
+    for (; i < n; ++i) {
+        dst[i] = std::exp(src[i] - max) * scale;
+    }
+}
+
+/*!
+ * \brief softmax of the columns [c_begin, c_end) of a (B, C) slice along B
+ */
+void forward_cols(const float* src, float* dst, size_t B, size_t C,
+                  size_t c_begin, size_t c_end) {
+    float max[COL_BLOCK], sum[COL_BLOCK];
+    size_t w = c_end - c_begin;
+    src += c_begin;
+    dst += c_begin;
+    for (size_t k = 0; k < w; ++k) {
+        max[k] = src[k];
+        sum[k] = 1.f;
+    }
+    for (size_t b = 1; b < B; ++b) {
+        const float* row = src + b * C;
+        size_t k = 0;
+        for (; k + 4 <= w; k += 4) {
+            auto vmax = F4::load(max + k), vsum = F4::load(sum + k);
+            online_update(vmax, vsum, F4::load(row + k));
+            F4::store(max + k, vmax);
+            F4::store(sum + k, vsum);
+        }
+        for (; k < w; ++k) {
+            online_update(max[k], sum[k], row[k]);
+        }
+    }
+    for (size_t k = 0; k < w; ++k) {
+        sum[k] = get_scale(max[k], sum[k]);
+    }
+    for (size_t b = 0; b < B; ++b) {
+        const float* row = src + b * C;
+        float* out = dst + b * C;
+        size_t k = 0;
+        for (; k + 4 <= w; k += 4) {
+            F4::store(out + k,
+                      F4::mul(F4::exp(F4::sub(F4::load(row + k),
+                                              F4::load(max + k))),
+                              F4::load(sum + k)));
+        }
+        for (; k < w; ++k) {
+            out[k] = std::exp(row[k] - max[k]) * sum[k];
+        }
+    }
+}
+
+float contig_dot(const float* x, const float* y, size_t n) {
+    auto s0 = F4::set1(0.f), s1 = F4::set1(0.f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = F4::add(s0, F4::mul(F4::load(x + i), F4::load(y + i)));
+        s1 = F4::add(s1, F4::mul(F4::load(x + i + 4), F4::load(y + i + 4)));
+    }
+    float s = F4::reduce_add(F4::add(s0, s1));
+    for (; i < n; ++i) {
+        s += x[i] * y[i];
+    }
+    return s;
+}
+
+void backward_contig(const float* y, const float* diff, float* grad,
+                     size_t n) {
+    float dot = contig_dot(y, diff, n);
+    auto vdot = F4::set1(dot);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        F4::store(grad + i, F4::mul(F4::sub(F4::load(diff + i), vdot),
+                                    F4::load(y + i)));
+    }
+    for (; i < n; ++i) {
+        grad[i] = (diff[i] - dot) * y[i];
+    }
+}
+
+void backward_cols(const float* y, const float* diff, float* grad, size_t B,
+                   size_t C, size_t c_begin, size_t c_end) {
+    float dot[COL_BLOCK];
+    size_t w = c_end - c_begin;
+    y += c_begin;
+    diff += c_begin;
+    grad += c_begin;
+    std::fill(dot, dot + w, 0.f);
+    for (size_t b = 0; b < B; ++b) {
+        for (size_t k = 0; k < w; ++k) {
+            dot[k] += y[b * C + k] * diff[b * C + k];
+        }
+    }
+    for (size_t b = 0; b < B; ++b) {
+        size_t k = 0, off = b * C;
+        for (; k + 4 <= w; k += 4) {
+            F4::store(grad + off + k,
+                      F4::mul(F4::sub(F4::load(diff + off + k),
+                                      F4::load(dot + k)),
+                              F4::load(y + off + k)));
+        }
+        for (; k < w; ++k) {
+            grad[off + k] = (diff[off + k] - dot[k]) * y[off + k];
+        }
+    }
+}
+
+/*!
+ * \brief split the A * C independent softmax rows among tasks and call
+ *      func(a, c_begin, c_end) for each contiguous group of them
+ */
+template <typename Func>
+void for_each_group(size_t A, size_t C, size_t nr_tasks, size_t task_id,
+                    Func&& func) {
+    if (C == 1) {
+        size_t begin = A * task_id / nr_tasks,
+               end = A * (task_id + 1) / nr_tasks;
+        for (size_t a = begin; a < end; ++a) {
+            func(a, 0, 1);
+        }
+        return;
+    }
+    size_t nr_col_blocks = (C + COL_BLOCK - 1) / COL_BLOCK,
+           nr_units = A * nr_col_blocks;
+    size_t begin = nr_units * task_id / nr_tasks,
+           end = nr_units * (task_id + 1) / nr_tasks;
+    for (size_t i = begin; i < end; ++i) {
+        size_t a = i / nr_col_blocks, c = i % nr_col_blocks * COL_BLOCK;
+        func(a, c, std::min(c + COL_BLOCK, C));
+    }
+}
+
+size_t get_nr_tasks(Handle* handle, size_t A, size_t C) {
+    size_t nr_units = C == 1 ? A : A * ((C + COL_BLOCK - 1) / COL_BLOCK);
+    return std::max<size_t>(1, std::min(get_nr_threads(handle), nr_units));
+}
+
+}  // anonymous namespace
+
+void SoftmaxForwardImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                              _megdnn_workspace workspace) {
+    if (src.layout.dtype != dtype::Float32()) {
+        return naive::SoftmaxForwardImpl::exec(src, dst, workspace);
+    }
+    check_exec(src.layout, dst.layout, workspace.size);
+    size_t A, B, C;
+    reduce::get_ABC(src.layout, A, B, C, get_axis(src.layout));
+    size_t nr_tasks = get_nr_tasks(handle(), A, C);
+    MIDOUT_BEGIN(megdnn_fallback_softmax, midout_iv(0)) {
+        auto sptr = src.ptr<dt_float32>();
+        auto dptr = dst.ptr<dt_float32>();
+        auto kern = [=](size_t task_id, size_t) {
+            for_each_group(A, C, nr_tasks, task_id,
+                           [&](size_t a, size_t c_begin, size_t c_end) {
+                               size_t off = a * B * C;
+                               if (C == 1) {
+                                   forward_contig(sptr + off, dptr + off, B);
+                               } else {
+                                   forward_cols(sptr + off, dptr + off, B, C,
+                                                c_begin, c_end);
+                               }
+                           });
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_tasks);
+    }
+    MIDOUT_END();
+}
+
+void SoftmaxBackwardImpl::exec(_megdnn_tensor_in dst, _megdnn_tensor_in diff,
+                               _megdnn_tensor_out grad,
+                               _megdnn_workspace workspace) {
+    if (dst.layout.dtype != dtype::Float32()) {
+        return naive::SoftmaxBackwardImpl::exec(dst, diff, grad, workspace);
+    }
+    check_exec(dst.layout, diff.layout, grad.layout, workspace.size);
+    size_t A, B, C;
+    reduce::get_ABC(dst.layout, A, B, C, get_axis(dst.layout));
+    size_t nr_tasks = get_nr_tasks(handle(), A, C);
+    MIDOUT_BEGIN(megdnn_fallback_softmax, midout_iv(1)) {
+        auto yptr = dst.ptr<dt_float32>();
+        auto dptr = diff.ptr<dt_float32>();
+        auto gptr = grad.ptr<dt_float32>();
+        auto kern = [=](size_t task_id, size_t) {
+            for_each_group(A, C, nr_tasks, task_id,
+                           [&](size_t a, size_t c_begin, size_t c_end) {
+                               size_t off = a * B * C;
+                               if (C == 1) {
+                                   backward_contig(yptr + off, dptr + off,
+                                                   gptr + off, B);
+                               } else {
+                                   backward_cols(yptr + off, dptr + off,
+                                                 gptr + off, B, C, c_begin,
+                                                 c_end);
+                               }
+                           });
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, nr_tasks);
+    }
+    MIDOUT_END();
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,42 @@
+/**
+ * \file dnn/src/fallback/softmax/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "src/naive/softmax/opr_impl.h"
+
+namespace megdnn {
+namespace fallback {
+
+/*!
+ * \brief float32 softmax with the max and the sum of exp computed in a single
+ *      online pass, so each value is read twice and written once
+ *
+ * Other dtypes are handled by the naive impl.
+ */
+class SoftmaxForwardImpl : public naive::SoftmaxForwardImpl {
+public:
+    using naive::SoftmaxForwardImpl::SoftmaxForwardImpl;
+    void exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+              _megdnn_workspace workspace) override;
+};
+
+class SoftmaxBackwardImpl : public naive::SoftmaxBackwardImpl {
+public:
+    using naive::SoftmaxBackwardImpl::SoftmaxBackwardImpl;
+    void exec(_megdnn_tensor_in dst, _megdnn_tensor_in diff,
+              _megdnn_tensor_out grad, _megdnn_workspace workspace) override;
+};
+
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
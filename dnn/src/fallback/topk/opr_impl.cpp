@@ -0,0 +1,193 @@
+/**
+ * \file dnn/src/fallback/topk/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/fallback/topk/opr_impl.h"
+#include "src/common/utils.h"
+#include "src/fallback/topk/radix_helper.h"
+#include "src/naive/handle.h"
+
+#include <limits>
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_fallback_topk)
+
+using namespace megdnn;
+using namespace fallback;
+
+namespace {
+//! rows with at least this many times k elements are selected by a heap
+constexpr size_t SMALL_K_RATIO = 64;
+
+size_t get_nr_threads(Handle* handle) {
+    return static_cast<naive::HandleImpl*>(handle)
+            ->megcore_dispatcher()
+            ->nr_threads();
+}
+}  // anonymous namespace
+
+template <typename ctype>
+void TopKImpl::dispatch_with_ctype(int k, size_t m, size_t n, ptrdiff_t lda,
+                                   const ctype* data, ctype* values,
+                                   int* indices, void* workspace) {
+    using Mode = Param::Mode;
+    megdnn_assert(n <= std::numeric_limits<uint32_t>::max());
+    auto mode = param().mode;
+    auto kern = [=](size_t row_id, size_t thread_id) {
+        auto buf = static_cast<uint64_t*>(workspace) + thread_id * n * 2;
+        const ctype* row = data + row_id * lda;
+        bool largest = k < 0;
+        size_t ow = std::abs(k);
+        // the largest values are the smallest complemented keys
+        auto get_key = [row, largest](size_t i) {
+            uint32_t key = radix::KeyTrait<ctype>::to_key(row[i]);
+            return largest ? ~key : key;
+        };
+        ctype* out_val = values + row_id * ow;
+        int* out_idx = indices + row_id * ow;
+        auto write_items = [&](const uint64_t* items) {
+            for (size_t i = 0; i < ow; ++i) {
+                uint32_t tie = radix::item_tie(items[i]);
+                uint32_t idx = largest ? ~tie : tie;
+                out_val[i] = row[idx];
+                out_idx[i] = idx;
+            }
+        };
+
+        if (ow * SMALL_K_RATIO <= n) {
+            // keep the ow smallest items in a max-heap; most elements are
+            // rejected by a single comparison with the top
+            uint64_t* heap = buf;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t item = static_cast<uint64_t>(get_key(i)) << 32 |
+                                (largest ? static_cast<uint32_t>(~i) : i);
+                if (i < ow) {
+                    heap[i] = item;
+                    if (i + 1 == ow) {
+                        std::make_heap(heap, heap + ow);
+                    }
+                } else if (item < heap[0]) {
+                    std::pop_heap(heap, heap + ow);
+                    heap[ow - 1] = item;
+                    std::push_heap(heap, heap + ow);
+                }
+            }
+            if (mode == Mode::KTH_ONLY) {
+                uint32_t tie = radix::item_tie(heap[0]);
+                values[row_id] = row[largest ? ~tie : tie];
+                return;
+            }
+            if (mode == Mode::VALUE_IDX_SORTED) {
+                std::sort_heap(heap, heap + ow);
+            }
+            write_items(heap);
+            return;
+        }
+
+        size_t nr_equal, nr_equal_taken;
+        uint32_t kth = radix::select_kth(n, ow, get_key, buf, nr_equal,
+                                         nr_equal_taken);
+        if (mode == Mode::KTH_ONLY) {
+            for (size_t i = 0; i < n; ++i) {
+                if (get_key(i) == kth) {
+                    values[row_id] = row[i];
+                    return;
+                }
+            }
+            megdnn_assert_internal(0);
+        }
+
+        // break ties by index as comparing std::pair<ctype, uint32_t>:
+        // smaller indices for the smallest values and larger indices for the
+        // largest values
+        size_t equal_to_skip = largest ? nr_equal - nr_equal_taken : 0,
+               equal_to_take = nr_equal_taken;
+        auto selected = [&](uint32_t key) {
+            if (key != kth) {
+                return key < kth;
+            }
+            if (equal_to_skip) {
+                --equal_to_skip;
+                return false;
+            }
+            if (equal_to_take) {
+                --equal_to_take;
+                return true;
+            }
+            return false;
+        };
+        size_t pos = 0;
+        if (mode == Mode::VALUE_IDX_NOSORT) {
+            for (size_t i = 0; i < n && pos < ow; ++i) {
+                if (selected(get_key(i))) {
+                    out_val[pos] = row[i];
+                    out_idx[pos++] = i;
+                }
+            }
+            megdnn_assert_internal(pos == ow);
+            return;
+        }
+
+        // the items of equal keys should be in the order of their ties
+        uint64_t *items = buf, *tmp = buf + ow;
+        for (size_t i = 0; i < n && pos < ow; ++i) {
+            uint32_t key = get_key(i);
+            if (selected(key)) {
+                uint64_t item = static_cast<uint64_t>(key) << 32;
+                if (largest) {
+                    items[ow - 1 - pos] = item | static_cast<uint32_t>(~i);
+                } else {
+                    items[pos] = item | i;
+                }
+                ++pos;
+            }
+        }
+        megdnn_assert_internal(pos == ow);
+        write_items(radix::sort_items(items, tmp, ow));
+    };
+    MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, m);
+}
+
+void TopKImpl::do_exec(int k, _megdnn_tensor_in data, _megdnn_tensor_out values,
+                       int32_t* indices, _megdnn_workspace workspace) {
+    size_t m = data.layout[0], n = data.layout[1];
+    ptrdiff_t lda = data.layout.stride[0];
+    switch (data.layout.dtype.enumv()) {
+#define cb(t)                                                    \
+    case DTypeTrait<t>::enumv:                                   \
+        MIDOUT_BEGIN(megdnn_fallback_topk, midout_iv(0), t) {    \
+            using ct = DTypeTrait<t>::ctype;                     \
+            dispatch_with_ctype<ct>(k, m, n, lda, data.ptr<ct>(), \
+                                    values.ptr<ct>(), indices,   \
+                                    workspace.raw_ptr);          \
+            return;                                              \
+        }                                                        \
+        MIDOUT_END();                                            \
+        break;
+        MEGDNN_FOREACH_COMPUTING_DTYPE(cb);
+#undef cb
+        default:
+            break;
+    }
+    megdnn_throw("unsupported dtype in fallback TopKImpl");
+}
+
+size_t TopKImpl::get_workspace_in_bytes(int k, const TensorLayout& data,
+                                        const TensorLayout& values,
+                                        const TensorLayout& indices) {
+    MEGDNN_MARK_USED_VAR(k);
+    MEGDNN_MARK_USED_VAR(values);
+    MEGDNN_MARK_USED_VAR(indices);
+    // candidates of radix select, then the selected items and sort buffer
+    return sizeof(uint64_t) * 2 * data[1] * get_nr_threads(handle());
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,203 @@
+/**
+ * \file dnn/src/fallback/topk/radix_helper.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include "megdnn/dtype.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace megdnn {
+namespace fallback {
+namespace radix {
+
+/*!
+ * \brief map a value to uint32 so that unsigned comparison of the keys
+ *      matches comparison of the values
+ *
+ * Sort items are packed as (key << 32 | tie), where tie is the index or the
+ * complement of the index, so an item is a single uint64 and ties are broken
+ * the same way as comparing std::pair<ctype, int>.
+ */
+template <typename ctype>
+struct KeyTrait {
+    static uint32_t to_key(ctype v) {
+        return static_cast<uint32_t>(static_cast<int32_t>(v)) ^ 0x80000000u;
+    }
+};
+
+template <>
+struct KeyTrait<dt_float32> {
+    static uint32_t to_key(dt_float32 v) {
+        // make -0 and +0 the same key
+        if (v == 0.f)
+            v = 0.f;
+        uint32_t u;
+        memcpy(&u, &v, sizeof(u));
+        return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+    }
+};
+
+#if !MEGDNN_DISABLE_FLOAT16
+template <>
+struct KeyTrait<dt_float16> {
+    static uint32_t to_key(dt_float16 v) {
+        return KeyTrait<dt_float32>::to_key(static_cast<dt_float32>(v));
+    }
+};
+
+template <>
+struct KeyTrait<dt_bfloat16> {
+    static uint32_t to_key(dt_bfloat16 v) {
+        return KeyTrait<dt_float32>::to_key(static_cast<dt_float32>(v));
+    }
+};
+#endif
+
+//! rows shorter than this are sorted by comparison
+constexpr size_t SMALL_SORT_SIZE = 256;
+
+static inline uint32_t item_key(uint64_t item) {
+    return static_cast<uint32_t>(item >> 32);
+}
+
+static inline uint32_t item_tie(uint64_t item) {
+    return static_cast<uint32_t>(item);
+}
+
+/*!
+ * \brief sort items by key, keeping the original order of items with equal
+ *      keys
+ *
+ * Items with equal keys must already be in the order of their ties, so that
+ * the result is ordered by the full 64-bit items.
+ *
+ * \param tmp buffer of at least n items
+ * \return pointer to the sorted items, which is either items or tmp
+ */
+static inline uint64_t* sort_items(uint64_t* items, uint64_t* tmp, size_t n) {
+    if (n < SMALL_SORT_SIZE) {
+        std::sort(items, items + n);
+        return items;
+    }
+    // LSD radix sort with 8-bit digits on the key
+    size_t hist[4][256];
+    memset(hist, 0, sizeof(hist));
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t key = item_key(items[i]);
+        ++hist[0][key & 255];
+        ++hist[1][(key >> 8) & 255];
+        ++hist[2][(key >> 16) & 255];
+        ++hist[3][key >> 24];
+    }
+    uint64_t *src = items, *dst = tmp;
+    for (int pass = 0; pass < 4; ++pass) {
+        size_t* h = hist[pass];
+        int shift = pass * 8 + 32;
+        // skip the pass if all items have the same digit
+        if (h[(src[0] >> shift) & 255] == n)
+            continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t cnt = h[d];
+            h[d] = offset;
+            offset += cnt;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            dst[h[(src[i] >> shift) & 255]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    return src;
+}
+
+/*!
+ * \brief find the k-th smallest key (k is 1-based) by MSB radix select
+ *
+ * The bits above the highest bit that differs among all keys are skipped, so
+ * values in a narrow range do not cost extra passes.
+ *
+ * \param get_key get_key(i) returns the key of the i-th element
+ * \param buf buffer of at least n items to hold the candidates
+ * \param[out] nr_equal number of elements whose keys equal the result
+ * \param[out] nr_equal_taken number of elements equal to the result that
+ *      are among the k smallest
+ */
+template <typename GetKey>
+uint32_t select_kth(size_t n, size_t k, GetKey&& get_key, uint64_t* buf,
+                    size_t& nr_equal, size_t& nr_equal_taken) {
+    uint32_t kmin = ~0u, kmax = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t key = get_key(i);
+        kmin = std::min(kmin, key);
+        kmax = std::max(kmax, key);
+    }
+    int hi = 32;
+    while (hi && !(((kmin ^ kmax) >> (hi - 1)) & 1)) {
+        --hi;
+    }
+    // bits at and above hi are the same for all keys
+    uint32_t prefix = hi == 32 ? 0 : (kmin >> hi) << hi;
+
+    size_t cnt = n, rank = k;
+    bool in_buf = false;
+    while (hi > 0) {
+        int lo = std::max(hi - 8, 0);
+        uint32_t digit_mask = (1u << (hi - lo)) - 1;
+        size_t hist[256];
+        memset(hist, 0, sizeof(hist));
+        if (in_buf) {
+            for (size_t i = 0; i < cnt; ++i) {
+                ++hist[(item_key(buf[i]) >> lo) & digit_mask];
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                ++hist[(get_key(i) >> lo) & digit_mask];
+            }
+        }
+        uint32_t digit = 0;
+        while (rank > hist[digit]) {
+            rank -= hist[digit++];
+        }
+        prefix |= digit << lo;
+        if (hist[digit] != cnt) {
+            // compact the candidates with the selected digit
+            size_t nr = 0;
+            if (in_buf) {
+                for (size_t i = 0; i < cnt; ++i) {
+                    if (((item_key(buf[i]) >> lo) & digit_mask) == digit) {
+                        buf[nr++] = buf[i];
+                    }
+                }
+            } else {
+                for (size_t i = 0; i < n; ++i) {
+                    uint32_t key = get_key(i);
+                    if ((key >> lo) == (prefix >> lo)) {
+                        buf[nr++] = static_cast<uint64_t>(key) << 32;
+                    }
+                }
+                in_buf = true;
+            }
+            cnt = nr;
+        }
+        hi = lo;
+    }
+    nr_equal = cnt;
+    nr_equal_taken = rank;
+    return prefix;
+}
+
+}  // namespace radix
+}  // namespace fallback
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,110 @@
+/**
+ * \file dnn/src/naive/attention/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "src/naive/attention/opr_impl.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "src/common/attention_helper.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+using namespace megdnn;
+using namespace naive;
+
+namespace {
+
+//! rows whose keys are all masked out produce NaN, as the softmax of the
+//! unfused graph does
+template <typename T>
+void forward(const T* q, const T* k, const T* v, const T* mask,
+             const TensorLayout& bmask, T* dst, const attention::Shape& s,
+             float scale, bool causal) {
+    std::vector<double> score(s.sk);
+    for (size_t b = 0; b < s.batch; ++b) {
+        const T* mask_b =
+                mask ? mask + attention::mask_batch_offset(bmask, b) : nullptr;
+        for (size_t i = 0; i < s.sq; ++i) {
+            const T* qi = q + (b * s.sq + i) * s.d;
+            double max = -std::numeric_limits<double>::infinity();
+            for (size_t j = 0; j < s.sk; ++j) {
+                if (causal && s.causal_masked(i, j)) {
+                    score[j] = -std::numeric_limits<double>::infinity();
+                    continue;
+                }
+                const T* kj = k + (b * s.sk + j) * s.d;
+                double dot = 0;
+                for (size_t x = 0; x < s.d; ++x) {
+                    dot += static_cast<double>(qi[x]) *
+                           static_cast<double>(kj[x]);
+                }
+                score[j] = dot * scale;
+                if (mask_b) {
+                    score[j] += static_cast<double>(
+                            mask_b[i * bmask.stride[bmask.ndim - 2] +
+                                   j * bmask.stride[bmask.ndim - 1]]);
+                }
+                max = std::max(max, score[j]);
+            }
+            T* oi = dst + (b * s.sq + i) * s.dv;
+            if (max == -std::numeric_limits<double>::infinity()) {
+                std::fill(oi, oi + s.dv,
+                          static_cast<T>(
+                                  std::numeric_limits<float>::quiet_NaN()));
+                continue;
+            }
+            double sum = 0;
+            for (size_t j = 0; j < s.sk; ++j) {
+                score[j] = std::exp(score[j] - max);
+                sum += score[j];
+            }
+            for (size_t x = 0; x < s.dv; ++x) {
+                double acc = 0;
+                for (size_t j = 0; j < s.sk; ++j) {
+                    acc += score[j] *
+                           static_cast<double>(v[(b * s.sk + j) * s.dv + x]);
+                }
+                oi[x] = static_cast<T>(acc / sum);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+void AttentionForwardImpl::exec(_megdnn_tensor_in q, _megdnn_tensor_in k,
+                                _megdnn_tensor_in v, _megdnn_tensor_in mask,
+                                _megdnn_tensor_out dst,
+                                _megdnn_workspace workspace) {
+    check_exec(q.layout, k.layout, v.layout, mask.layout, dst.layout,
+               workspace.size);
+    attention::Shape shape{q.layout, k.layout, v.layout};
+    TensorLayout bmask;
+    if (mask.layout.ndim) {
+        bmask = attention::broadcast_mask(mask.layout, q.layout, k.layout);
+    }
+    float scale = param().scale;
+    bool causal = param().causal;
+#define cb(DType)                                                           \
+    if (q.layout.dtype == DType()) {                                        \
+        using T = typename DTypeTrait<DType>::ctype;                        \
+        const T* mptr = mask.layout.ndim ? mask.ptr<T>() : nullptr;         \
+        MEGDNN_DISPATCH_CPU_KERN_OPR(forward<T>(                            \
+                q.ptr<T>(), k.ptr<T>(), v.ptr<T>(), mptr, bmask,            \
+                dst.ptr<T>(), shape, scale, causal));                       \
+        return;                                                             \
+    }
+    MEGDNN_FOREACH_COMPUTING_DTYPE_FLOAT(cb)
+#undef cb
+    megdnn_throw("bad dtype");
+}
+
+// vim: syntax=cpp.doxygen
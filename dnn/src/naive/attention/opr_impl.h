@@ -0,0 +1,36 @@
+/**
+ * \file dnn/src/naive/attention/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+#include "megdnn/oprs.h"
+
+namespace megdnn {
+namespace naive {
+
+class AttentionForwardImpl : public AttentionForward {
+public:
+    using AttentionForward::AttentionForward;
+    void exec(_megdnn_tensor_in q, _megdnn_tensor_in k, _megdnn_tensor_in v,
+              _megdnn_tensor_in mask, _megdnn_tensor_out dst,
+              _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& /* q */,
+                                  const TensorLayout& /* k */,
+                                  const TensorLayout& /* v */,
+                                  const TensorLayout& /* mask */,
+                                  const TensorLayout& /* dst */) override {
+        return 0;
+    }
+};
+
+}  // namespace naive
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,81 @@
+/**
+ * \file dnn/src/naive/image_preprocess/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "src/naive/image_preprocess/opr_impl.h"
+#include <cmath>
+#include <vector>
+#include "src/common/image_preprocess_helper.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+using namespace megdnn;
+using namespace naive;
+using namespace image_preprocess;
+
+namespace {
+
+template <typename ctype>
+void forward(const uint8_t* src, ctype* dst, const Param& param,
+             const Shape& s, DType dtype) {
+    OutputCvt<ctype> cvt{dtype};
+    Normalize norm{param};
+    size_t src_img_size =
+            is_yuv(param.src_format) ? s.ih / 2 * 3 * s.iw : s.ih * s.iw * 3;
+    std::vector<uint8_t> bgr(s.ih * s.iw * 3);
+    for (size_t b = 0; b < s.n; ++b) {
+        const uint8_t* img = src + b * src_img_size;
+        for (size_t y = 0; y < s.ih; ++y) {
+            cvt_row(param.src_format, img, s.ih, s.iw, y,
+                    bgr.data() + y * s.iw * 3);
+        }
+        for (size_t h = 0; h < s.oh; ++h) {
+            auto ch = get_coord(param.imode, s.ih, s.oh, h);
+            for (size_t w = 0; w < s.ow; ++w) {
+                auto cw = get_coord(param.imode, s.iw, s.ow, w);
+                for (size_t c = 0; c < 3; ++c) {
+                    size_t k = bgr_index(param, c);
+                    auto at = [&](int y, int x) {
+                        return static_cast<float>(bgr[(y * s.iw + x) * 3 + k]);
+                    };
+                    float h0 = at(ch.i0, cw.i0) * (1 - cw.alpha) +
+                               at(ch.i0, cw.i1) * cw.alpha;
+                    float h1 = at(ch.i1, cw.i0) * (1 - cw.alpha) +
+                               at(ch.i1, cw.i1) * cw.alpha;
+                    float v = std::round(h0 * (1 - ch.alpha) + h1 * ch.alpha);
+                    dst[s.dst_offset(b, c, h, w)] = cvt(norm(v, c));
+                }
+                for (size_t c = 3; c < s.pack; ++c) {
+                    dst[s.dst_offset(b, c, h, w)] = cvt(0.f);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
+
+void ImagePreprocessForwardImpl::exec(_megdnn_tensor_in src,
+                                      _megdnn_tensor_out dst,
+                                      _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, workspace.size);
+    Shape shape{param(), src.layout, dst.layout};
+    auto p = param();
+    auto dtype = dst.layout.dtype;
+    if (dtype == dtype::Float32()) {
+        MEGDNN_DISPATCH_CPU_KERN_OPR(forward<dt_float32>(
+                src.ptr<dt_uint8>(), dst.ptr<dt_float32>(), p, shape, dtype));
+    } else {
+        MEGDNN_DISPATCH_CPU_KERN_OPR(forward<dt_qint8>(
+                src.ptr<dt_uint8>(), dst.ptr<dt_qint8>(), p, shape, dtype));
+    }
+}
+
+// vim: syntax=cpp.doxygen
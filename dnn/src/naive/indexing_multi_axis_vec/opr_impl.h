@@ -16,7 +16,7 @@
 namespace megdnn {
 namespace naive {
 
-    class IndexingMultiAxisVecImpl final: public IndexingMultiAxisVec {
+    class IndexingMultiAxisVecImpl: public IndexingMultiAxisVec {
         public:
             using IndexingMultiAxisVec::IndexingMultiAxisVec;
 
@@ -29,7 +29,7 @@ namespace naive {
                     _megdnn_workspace workspace) override;
     };
 
-    class IndexingSetMultiAxisVecImpl final: public IndexingSetMultiAxisVec {
+    class IndexingSetMultiAxisVecImpl: public IndexingSetMultiAxisVec {
         public:
             using IndexingSetMultiAxisVec::IndexingSetMultiAxisVec;
 
@@ -42,7 +42,7 @@ namespace naive {
                     _megdnn_workspace workspace) override;
     };
 
-    class IndexingIncrMultiAxisVecImpl final: public IndexingIncrMultiAxisVec {
+    class IndexingIncrMultiAxisVecImpl: public IndexingIncrMultiAxisVec {
         public:
             using IndexingIncrMultiAxisVec::IndexingIncrMultiAxisVec;
 
@@ -0,0 +1,154 @@
+/**
+ * \file dnn/src/naive/layer_norm/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "src/naive/layer_norm/opr_impl.h"
+#include <cmath>
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+using namespace megdnn;
+using namespace naive;
+
+namespace {
+
+using Param = megdnn::LayerNorm::Param;
+
+template <typename T>
+void forward(const T* data, const T* weight, const T* bias, T* dst,
+             dt_float32* mean, dt_float32* rstd, size_t nr_rows,
+             const Param& param) {
+    size_t n = param.normalized_size;
+    for (size_t i = 0; i < nr_rows; ++i) {
+        const T* x = data + i * n;
+        T* y = dst + i * n;
+        double sum = 0;
+        for (size_t j = 0; j < n; ++j) {
+            sum += static_cast<double>(x[j]);
+        }
+        double mu = sum / n, var = 0;
+        for (size_t j = 0; j < n; ++j) {
+            double d = static_cast<double>(x[j]) - mu;
+            var += d * d;
+        }
+        var /= n;
+        double r = 1.0 / std::sqrt(var + param.eps);
+        for (size_t j = 0; j < n; ++j) {
+            double v = (static_cast<double>(x[j]) - mu) * r;
+            if (param.affine) {
+                v = v * static_cast<double>(weight[j]) +
+                    static_cast<double>(bias[j]);
+            }
+            y[j] = static_cast<T>(v);
+        }
+        mean[i] = mu;
+        rstd[i] = r;
+    }
+}
+
+template <typename T>
+void backward(const T* diff, const T* data, const T* weight,
+              const dt_float32* mean, const dt_float32* rstd, T* ddata,
+              T* dweight, T* dbias, size_t nr_rows, const Param& param) {
+    size_t n = param.normalized_size;
+    if (param.affine) {
+        for (size_t j = 0; j < n; ++j) {
+            double dw = 0, db = 0;
+            for (size_t i = 0; i < nr_rows; ++i) {
+                double dy = diff[i * n + j];
+                double xhat = (static_cast<double>(data[i * n + j]) - mean[i]) *
+                              rstd[i];
+                dw += dy * xhat;
+                db += dy;
+            }
+            dweight[j] = static_cast<T>(dw);
+            dbias[j] = static_cast<T>(db);
+        }
+    }
+    for (size_t i = 0; i < nr_rows; ++i) {
+        const T *x = data + i * n, *dy = diff + i * n;
+        T* dx = ddata + i * n;
+        double sum_g = 0, sum_gx = 0;
+        for (size_t j = 0; j < n; ++j) {
+            double g = static_cast<double>(dy[j]);
+            if (param.affine)
+                g *= static_cast<double>(weight[j]);
+            double xhat = (static_cast<double>(x[j]) - mean[i]) * rstd[i];
+            sum_g += g;
+            sum_gx += g * xhat;
+        }
+        double mean_g = sum_g / n, mean_gx = sum_gx / n;
+        for (size_t j = 0; j < n; ++j) {
+            double g = static_cast<double>(dy[j]);
+            if (param.affine)
+                g *= static_cast<double>(weight[j]);
+            double xhat = (static_cast<double>(x[j]) - mean[i]) * rstd[i];
+            dx[j] = static_cast<T>((g - mean_g - xhat * mean_gx) * rstd[i]);
+        }
+    }
+}
+
+}  // namespace
+
+void LayerNormForwardImpl::exec(_megdnn_tensor_in data,
+                                _megdnn_tensor_in weight,
+                                _megdnn_tensor_in bias, _megdnn_tensor_out dst,
+                                _megdnn_tensor_out mean,
+                                _megdnn_tensor_out rstd,
+                                _megdnn_workspace workspace) {
+    check_exec(data.layout, weight.layout, bias.layout, dst.layout,
+               mean.layout, rstd.layout, workspace.size);
+    size_t nr_rows = mean.layout.total_nr_elems();
+    auto p = param();
+#define cb(DType)                                                            \
+    if (data.layout.dtype == DType()) {                                      \
+        using T = typename DTypeTrait<DType>::ctype;                         \
+        MEGDNN_DISPATCH_CPU_KERN_OPR(forward<T>(                             \
+                data.ptr<T>(), p.affine ? weight.ptr<T>() : nullptr,         \
+                p.affine ? bias.ptr<T>() : nullptr, dst.ptr<T>(),            \
+                mean.ptr<dt_float32>(), rstd.ptr<dt_float32>(), nr_rows, p)); \
+        return;                                                              \
+    }
+    MEGDNN_FOREACH_COMPUTING_DTYPE_FLOAT(cb)
+#undef cb
+    megdnn_throw("bad dtype");
+}
+
+void LayerNormBackwardImpl::exec(_megdnn_tensor_in diff,
+                                 _megdnn_tensor_in data,
+                                 _megdnn_tensor_in weight,
+                                 _megdnn_tensor_in mean,
+                                 _megdnn_tensor_in rstd,
+                                 _megdnn_tensor_out ddata,
+                                 _megdnn_tensor_out dweight,
+                                 _megdnn_tensor_out dbias,
+                                 _megdnn_workspace workspace) {
+    check_exec(diff.layout, data.layout, weight.layout, mean.layout,
+               rstd.layout, ddata.layout, dweight.layout, dbias.layout,
+               workspace.size);
+    size_t nr_rows = mean.layout.total_nr_elems();
+    auto p = param();
+#define cb(DType)                                                           \
+    if (data.layout.dtype == DType()) {                                     \
+        using T = typename DTypeTrait<DType>::ctype;                        \
+        MEGDNN_DISPATCH_CPU_KERN_OPR(backward<T>(                           \
+                diff.ptr<T>(), data.ptr<T>(),                               \
+                p.affine ? weight.ptr<T>() : nullptr,                       \
+                mean.ptr<dt_float32>(), rstd.ptr<dt_float32>(),             \
+                ddata.ptr<T>(), p.affine ? dweight.ptr<T>() : nullptr,      \
+                p.affine ? dbias.ptr<T>() : nullptr, nr_rows, p));          \
+        return;                                                             \
+    }
+    MEGDNN_FOREACH_COMPUTING_DTYPE_FLOAT(cb)
+#undef cb
+    megdnn_throw("bad dtype");
+}
+
+// vim: syntax=cpp.doxygen
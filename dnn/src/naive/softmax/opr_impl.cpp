@@ -0,0 +1,113 @@
+/**
+ * \file dnn/src/naive/softmax/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "src/naive/softmax/opr_impl.h"
+#include <cmath>
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+
+using namespace megdnn;
+using namespace naive;
+
+namespace {
+
+//! the layout is viewed as (A, C, B) with softmax computed along C
+template <typename T>
+void forward(const T* src, T* dst, size_t A, size_t C, size_t B) {
+    for (size_t a = 0; a < A; ++a) {
+        for (size_t b = 0; b < B; ++b) {
+            size_t base = a * C * B + b;
+            double max = static_cast<double>(src[base]);
+            for (size_t c = 1; c < C; ++c) {
+                max = std::max(max, static_cast<double>(src[base + c * B]));
+            }
+            double sum = 0;
+            for (size_t c = 0; c < C; ++c) {
+                sum += std::exp(static_cast<double>(src[base + c * B]) - max);
+            }
+            for (size_t c = 0; c < C; ++c) {
+                dst[base + c * B] = static_cast<T>(
+                        std::exp(static_cast<double>(src[base + c * B]) - max) /
+                        sum);
+            }
+        }
+    }
+}
+
+template <typename T>
+void backward(const T* dst, const T* diff, T* grad, size_t A, size_t C,
+              size_t B) {
+    for (size_t a = 0; a < A; ++a) {
+        for (size_t b = 0; b < B; ++b) {
+            size_t base = a * C * B + b;
+            double sum = 0;
+            for (size_t c = 0; c < C; ++c) {
+                sum += static_cast<double>(diff[base + c * B]) *
+                       static_cast<double>(dst[base + c * B]);
+            }
+            for (size_t c = 0; c < C; ++c) {
+                grad[base + c * B] = static_cast<T>(
+                        (static_cast<double>(diff[base + c * B]) - sum) *
+                        static_cast<double>(dst[base + c * B]));
+            }
+        }
+    }
+}
+
+void get_ACB(const TensorLayout& layout, size_t axis, size_t& A, size_t& C,
+             size_t& B) {
+    A = 1;
+    B = 1;
+    for (size_t i = 0; i < axis; ++i)
+        A *= layout.shape[i];
+    C = layout.shape[axis];
+    for (size_t i = axis + 1; i < layout.ndim; ++i)
+        B *= layout.shape[i];
+}
+
+}  // namespace
+
+void SoftmaxForwardImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                              _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, workspace.size);
+    size_t A, C, B;
+    get_ACB(src.layout, get_axis(src.layout), A, C, B);
+#define cb(DType)                                                         \
+    if (src.layout.dtype == DType()) {                                    \
+        using T = typename DTypeTrait<DType>::ctype;                      \
+        MEGDNN_DISPATCH_CPU_KERN_OPR(                                     \
+                forward<T>(src.ptr<T>(), dst.ptr<T>(), A, C, B));         \
+        return;                                                           \
+    }
+    MEGDNN_FOREACH_COMPUTING_DTYPE_FLOAT(cb)
+#undef cb
+    megdnn_throw("bad dtype");
+}
+
+void SoftmaxBackwardImpl::exec(_megdnn_tensor_in dst, _megdnn_tensor_in diff,
+                               _megdnn_tensor_out grad,
+                               _megdnn_workspace workspace) {
+    check_exec(dst.layout, diff.layout, grad.layout, workspace.size);
+    size_t A, C, B;
+    get_ACB(dst.layout, get_axis(dst.layout), A, C, B);
+#define cb(DType)                                                           \
+    if (dst.layout.dtype == DType()) {                                      \
+        using T = typename DTypeTrait<DType>::ctype;                        \
+        MEGDNN_DISPATCH_CPU_KERN_OPR(backward<T>(                           \
+                dst.ptr<T>(), diff.ptr<T>(), grad.ptr<T>(), A, C, B));      \
+        return;                                                             \
+    }
+    MEGDNN_FOREACH_COMPUTING_DTYPE_FLOAT(cb)
+#undef cb
+    megdnn_throw("bad dtype");
+}
+
+// vim: syntax=cpp.doxygen
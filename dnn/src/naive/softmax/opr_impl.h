@@ -0,0 +1,44 @@
+/**
+ * \file dnn/src/naive/softmax/opr_impl.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+#include "megdnn/oprs.h"
+
+namespace megdnn {
+namespace naive {
+
+class SoftmaxForwardImpl : public SoftmaxForward {
+public:
+    using SoftmaxForward::SoftmaxForward;
+    void exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+              _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& /* src */,
+                                  const TensorLayout& /* dst */) override {
+        return 0;
+    }
+};
+
+class SoftmaxBackwardImpl : public SoftmaxBackward {
+public:
+    using SoftmaxBackward::SoftmaxBackward;
+    void exec(_megdnn_tensor_in dst, _megdnn_tensor_in diff,
+              _megdnn_tensor_out grad, _megdnn_workspace workspace) override;
+    size_t get_workspace_in_bytes(const TensorLayout& /* dst */,
+                                  const TensorLayout& /* diff */,
+                                  const TensorLayout& /* grad */) override {
+        return 0;
+    }
+};
+
+}  // namespace naive
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,172 @@
+/**
+ * \file dnn/src/x86/conv_bias/f32/channel_wise_nchw88_algo.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megdnn/oprs.h"
+#include "src/x86/conv_bias/f32/algos.h"
+#include "src/x86/conv_bias/f32/nchw88_kern.h"
+#include "src/x86/utils.h"
+
+#include "midout.h"
+
+using namespace megdnn;
+using namespace x86;
+using namespace nchw88;
+using conv_fun = std::function<void(
+        const WorkspaceBundle& bundle,
+        const ConvBiasImpl::NCBKernParam& kern_param,
+        const ConvBiasImpl::NCBKernIndex& ncb_index)>;
+MIDOUT_DECL(megdnn_x86_conv_bias_fp32_channel_wise_nchw88)
+
+namespace {
+
+//! the whole padded image of one pack of groups is [ih2][iw2][8]
+void get_rectified_size(const ConvBiasImpl::NCBKernSizeParam& param, int& ih2,
+                        int& iw2) {
+    auto&& fm = param.filter_meta;
+    const int stride = fm.stride[0];
+    ih2 = (static_cast<int>(param.osz[0]) - 1) * stride + fm.spatial[0];
+    iw2 = std::max<int>(
+            param.isz[1] + 2 * fm.padding[1],
+            (round_up<int>(param.osz[1], CHANWISE_OW_BLOCK) - 1) * stride +
+                    fm.spatial[1]);
+}
+
+WorkspaceBundle get_bundle(const ConvBiasImpl::NCBKernSizeParam& param) {
+    int ih2, iw2;
+    get_rectified_size(param, ih2, iw2);
+    size_t src_size = ih2 * iw2 * PACK * sizeof(float);
+    return {nullptr, {src_size * param.nr_threads}};
+}
+
+template <BiasMode bias_mode, typename Op>
+void do_conv_kern(const WorkspaceBundle& bundle,
+                  const ConvBiasImpl::NCBKernParam& kern_param,
+                  const ConvBiasImpl::NCBKernIndex& ncb_index) {
+    auto&& fm = kern_param.filter_meta;
+    const int ih = kern_param.isz[0];
+    const int iw = kern_param.isz[1];
+    const int oh = kern_param.osz[0];
+    const int ow = kern_param.osz[1];
+    int ih2, iw2;
+    get_rectified_size(kern_param, ih2, iw2);
+
+    const size_t batch_id = ncb_index.ndrange_id[0];
+    const size_t group_id = ncb_index.ndrange_id[1];
+    float* sptr = static_cast<float*>(bundle.get(0)) +
+                  ncb_index.thread_id * ih2 * iw2 * PACK;
+    pad_src(sptr, kern_param.src<float>(batch_id, group_id, 0, PACK), 1, PACK,
+            ih, iw, -static_cast<int>(fm.padding[0]), ih2, fm.padding[1],
+            iw2);
+    conv_chanwise<bias_mode, Op>(
+            sptr, kern_param.filter<float>(group_id, PACK),
+            kern_param.bias<float>(batch_id, group_id, 0, PACK),
+            kern_param.dst<float>(batch_id, group_id, 0, PACK), oh, ow,
+            fm.spatial[0], fm.spatial[1], fm.stride[0], iw2);
+}
+
+}  // namespace
+
+bool ConvBiasImpl::AlgoF32ChannelWiseNCHW88::usable(
+        const NCBKernSizeParam& param, AlgoSelectionStrategy) const {
+    auto&& fm = param.filter_meta;
+    auto fh = fm.spatial[0];
+    bool ok_type = param.src_type.enumv() == DTypeEnum::Float32 &&
+                   param.filter_type.enumv() == DTypeEnum::Float32 &&
+                   param.dst_type.enumv() == DTypeEnum::Float32;
+    bool ok_format = fm.ocpg == 1 && fm.icpg == 1 && fm.group % PACK == 0 &&
+                     fm.format == param::ConvBias::Format::NCHW88;
+    bool ok_filter = fm.spatial_ndim == 2 && fh == fm.spatial[1] &&
+                     (fh == 2 || fh == 3 || fh == 5 || fh == 7);
+    bool ok_slide = fm.dilation[0] == 1 && fm.dilation[1] == 1 &&
+                    fm.stride[0] == fm.stride[1] &&
+                    (fm.stride[0] == 1 || fm.stride[0] == 2);
+    bool ok_nonline = param.nonlineMode == NonlineMode::IDENTITY ||
+                      param.nonlineMode == NonlineMode::RELU ||
+                      param.nonlineMode == NonlineMode::H_SWISH ||
+                      param.nonlineMode == NonlineMode::SIGMOID;
+    bool ok_conv = !fm.should_flip;
+    return ok_type && ok_format && ok_filter && ok_slide && ok_nonline &&
+           ok_conv && is_supported(SIMDType::AVX2) &&
+           is_supported(SIMDType::FMA);
+}
+
+size_t ConvBiasImpl::AlgoF32ChannelWiseNCHW88::get_workspace(
+        const NCBKernSizeParam& param) const {
+    MIDOUT_BEGIN(megdnn_x86_conv_bias_fp32_channel_wise_nchw88,
+                 midout_iv("AlgoF32ChannelWiseNCHW88::get_workspace"_hash)) {
+        return get_bundle(param).total_size_in_bytes();
+    }
+    MIDOUT_END();
+    return 0;
+}
+
+SmallVector<ConvBiasImpl::NCBKern>
+ConvBiasImpl::AlgoF32ChannelWiseNCHW88::dispatch_kerns(
+        const NCBKernSizeParam& param) const {
+    WorkspaceBundle bundle = get_bundle(param);
+    conv_fun do_conv_fun = nullptr;
+
+#define DO_CONV_KERN_FUN(bias_mode, op)                                        \
+    MIDOUT_BEGIN(megdnn_x86_conv_bias_fp32_channel_wise_nchw88,                \
+                 midout_iv(#bias_mode #op##_hash)) {                           \
+        do_conv_fun = do_conv_kern<bias_mode, op<SIMDType::AVX2, dt_float32>>; \
+    }                                                                          \
+    MIDOUT_END();
+
+#define GET_OP_PARAM(bias_mode)                                                \
+    switch (param.nonlineMode) {                                               \
+        case NonlineMode::IDENTITY:                                            \
+            DO_CONV_KERN_FUN(bias_mode, NoneOp)                                \
+            break;                                                             \
+        case NonlineMode::RELU:                                                \
+            DO_CONV_KERN_FUN(bias_mode, ReluOp)                                \
+            break;                                                             \
+        case NonlineMode::H_SWISH:                                             \
+            DO_CONV_KERN_FUN(bias_mode, HSwishOp)                              \
+            break;                                                             \
+        case NonlineMode::SIGMOID:                                             \
+            DO_CONV_KERN_FUN(bias_mode, SigmoidOp)                             \
+            break;                                                             \
+        default:                                                               \
+            megdnn_assert(0);                                                  \
+            break;                                                             \
+    }
+
+    switch (param.bias_mode) {
+        case BiasMode::NO_BIAS:
+            GET_OP_PARAM(BiasMode::NO_BIAS)
+            break;
+        case BiasMode::BROADCAST_CHANNEL_BIAS:
+            GET_OP_PARAM(BiasMode::BROADCAST_CHANNEL_BIAS)
+            break;
+        case BiasMode::BIAS:
+            GET_OP_PARAM(BiasMode::BIAS)
+            break;
+        default:
+            megdnn_assert(0);
+            break;
+    }
+#undef DO_CONV_KERN_FUN
+#undef GET_OP_PARAM
+
+    megdnn_assert(do_conv_fun);
+    CpuNDRange ncb_range = {param.n, param.filter_meta.group / PACK};
+    auto do_conv = [bundle, do_conv_fun](
+                           const NCBKernParam& kern_param,
+                           const NCBKernIndex& ncb_index) mutable {
+        bundle.set(kern_param.workspace_ptr);
+        do_conv_fun(bundle, kern_param, ncb_index);
+    };
+    return {{do_conv, ncb_range}};
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,214 @@
+/**
+ * \file dnn/src/x86/conv_bias/f32/direct_nchw88_algo.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megdnn/oprs.h"
+#include "src/x86/conv_bias/f32/algos.h"
+#include "src/x86/conv_bias/f32/nchw88_kern.h"
+#include "src/x86/utils.h"
+
+#include "midout.h"
+
+using namespace megdnn;
+using namespace x86;
+using namespace nchw88;
+using conv_fun = std::function<void(
+        const WorkspaceBundle& bundle,
+        const ConvBiasImpl::NCBKernParam& kern_param,
+        const ConvBiasImpl::NCBKernIndex& ncb_index)>;
+MIDOUT_DECL(megdnn_x86_conv_bias_fp32_nchw88)
+
+namespace {
+
+//! the padded src of a task is [ic / 8][ih2][iw2][8]
+void get_rectified_size(const ConvBiasImpl::NCBKernSizeParam& param,
+                        int& oh_block, int& ih2, int& iw2) {
+    auto&& fm = param.filter_meta;
+    const int ic = fm.icpg;
+    const int iw = param.isz[1];
+    const int oh = param.osz[0];
+    const int ow = param.osz[1];
+    const int stride = fm.stride[0];
+    const int fh = fm.spatial[0];
+    const int fw = fm.spatial[1];
+    const int pw = fm.padding[1];
+
+    //! the last micro kernel of a row reads a whole OW_BLOCK
+    iw2 = std::max<int>(iw + 2 * pw,
+                        (round_up(ow, OW_BLOCK) - 1) * stride + fw);
+    oh_block = l2_block_helper(param.nr_threads, oh,
+                               ic * iw2 * stride * sizeof(float));
+    ih2 = (oh_block - 1) * stride + fh;
+}
+
+WorkspaceBundle get_bundle(const ConvBiasImpl::NCBKernSizeParam& param) {
+    int oh_block, ih2, iw2;
+    get_rectified_size(param, oh_block, ih2, iw2);
+    size_t src_size = param.filter_meta.icpg * ih2 * iw2 * sizeof(float);
+    return {nullptr, {src_size * param.nr_threads}};
+}
+
+template <BiasMode bias_mode, typename Op>
+void do_conv_kern(const WorkspaceBundle& bundle,
+                  const ConvBiasImpl::NCBKernParam& kern_param,
+                  const ConvBiasImpl::NCBKernIndex& ncb_index) {
+    auto&& fm = kern_param.filter_meta;
+    const int ih = kern_param.isz[0];
+    const int iw = kern_param.isz[1];
+    const int oh = kern_param.osz[0];
+    const int ow = kern_param.osz[1];
+    const int ic = fm.icpg;
+    const int oc = fm.ocpg;
+    const int fh = fm.spatial[0];
+    const int fw = fm.spatial[1];
+    const int stride = fm.stride[0];
+    const int ph = fm.padding[0];
+    const int pw = fm.padding[1];
+    int oh_block, ih2, iw2;
+    get_rectified_size(kern_param, oh_block, ih2, iw2);
+
+    const size_t batch_id = ncb_index.ndrange_id[0];
+    const size_t group_id = ncb_index.ndrange_id[1];
+    const int oh_start = ncb_index.ndrange_id[2] * oh_block;
+    const int oh_real = std::min(oh - oh_start, oh_block);
+    const int ih_real = (oh_real - 1) * stride + fh;
+
+    float* sptr = static_cast<float*>(bundle.get(0)) +
+                  ncb_index.thread_id * ic * ih2 * iw2;
+    pad_src(sptr, kern_param.src<float>(batch_id, group_id), ic / PACK, PACK,
+            ih, iw, oh_start * stride - ph, ih_real, pw, iw2);
+
+    DirectParam p;
+    p.ic_packs = ic / PACK;
+    p.pack = PACK;
+    p.fh = fh;
+    p.fw = fw;
+    p.stride = stride;
+    p.src_pack_stride = static_cast<size_t>(ih_real) * iw2 * PACK;
+    p.src_h_stride = iw2 * PACK;
+    p.src_w_stride = PACK;
+    p.src_c_stride = 1;
+    p.flt_oc_stride = static_cast<size_t>(ic) * fh * fw * PACK;
+
+    const size_t row_offset = static_cast<size_t>(oh_start) * ow * PACK;
+    const float* bptr = kern_param.bias<float>(batch_id, group_id);
+    if (bias_mode == BiasMode::BIAS) {
+        bptr += row_offset;
+    }
+    conv_direct<bias_mode, Op>(
+            sptr, kern_param.filter<float>(group_id), bptr,
+            kern_param.dst<float>(batch_id, group_id) + row_offset, p,
+            oc / PACK, oh_real, ow, static_cast<size_t>(oh) * ow * PACK,
+            stride * p.src_h_stride);
+}
+
+}  // namespace
+
+bool ConvBiasImpl::AlgoF32DirectNCHW88::usable(const NCBKernSizeParam& param,
+                                               AlgoSelectionStrategy) const {
+    auto&& fm = param.filter_meta;
+    auto fh = fm.spatial[0];
+    bool ok_type = param.src_type.enumv() == DTypeEnum::Float32 &&
+                   param.filter_type.enumv() == DTypeEnum::Float32 &&
+                   param.dst_type.enumv() == DTypeEnum::Float32 &&
+                   fm.format == param::ConvBias::Format::NCHW88;
+    bool ok_src_dst = fm.icpg % PACK == 0 && fm.ocpg % PACK == 0 &&
+                      fm.icpg >= PACK && fm.ocpg >= PACK;
+    bool ok_filter = fm.spatial_ndim == 2 && fh == fm.spatial[1] &&
+                     (fh == 1 || fh == 2 || fh == 3 || fh == 5 || fh == 7);
+    bool ok_slide = fm.dilation[0] == 1 && fm.dilation[1] == 1 &&
+                    fm.stride[0] == fm.stride[1] &&
+                    (fm.stride[0] == 1 || fm.stride[0] == 2);
+    bool ok_nonline = param.nonlineMode == NonlineMode::IDENTITY ||
+                      param.nonlineMode == NonlineMode::RELU ||
+                      param.nonlineMode == NonlineMode::H_SWISH ||
+                      param.nonlineMode == NonlineMode::SIGMOID;
+    bool ok_conv = !fm.should_flip;
+    return ok_type && ok_src_dst && ok_filter && ok_slide && ok_nonline &&
+           ok_conv && is_supported(SIMDType::AVX2) &&
+           is_supported(SIMDType::FMA);
+}
+
+size_t ConvBiasImpl::AlgoF32DirectNCHW88::get_workspace(
+        const NCBKernSizeParam& param) const {
+    MIDOUT_BEGIN(megdnn_x86_conv_bias_fp32_nchw88,
+                 midout_iv("AlgoF32DirectNCHW88::get_workspace"_hash)) {
+        return get_bundle(param).total_size_in_bytes();
+    }
+    MIDOUT_END();
+    return 0;
+}
+
+SmallVector<ConvBiasImpl::NCBKern>
+ConvBiasImpl::AlgoF32DirectNCHW88::dispatch_kerns(
+        const NCBKernSizeParam& param) const {
+    auto&& fm = param.filter_meta;
+    WorkspaceBundle bundle = get_bundle(param);
+    conv_fun do_conv_fun = nullptr;
+
+#define DO_CONV_KERN_FUN(bias_mode, op)                                        \
+    MIDOUT_BEGIN(megdnn_x86_conv_bias_fp32_nchw88,                             \
+                 midout_iv(#bias_mode #op##_hash)) {                           \
+        do_conv_fun = do_conv_kern<bias_mode, op<SIMDType::AVX2, dt_float32>>; \
+    }                                                                          \
+    MIDOUT_END();
+
+#define GET_OP_PARAM(bias_mode)                                                \
+    switch (param.nonlineMode) {                                               \
+        case NonlineMode::IDENTITY:                                            \
+            DO_CONV_KERN_FUN(bias_mode, NoneOp)                                \
+            break;                                                             \
+        case NonlineMode::RELU:                                                \
+            DO_CONV_KERN_FUN(bias_mode, ReluOp)                                \
+            break;                                                             \
+        case NonlineMode::H_SWISH:                                             \
+            DO_CONV_KERN_FUN(bias_mode, HSwishOp)                              \
+            break;                                                             \
+        case NonlineMode::SIGMOID:                                             \
+            DO_CONV_KERN_FUN(bias_mode, SigmoidOp)                             \
+            break;                                                             \
+        default:                                                               \
+            megdnn_assert(0);                                                  \
+            break;                                                             \
+    }
+
+    switch (param.bias_mode) {
+        case BiasMode::NO_BIAS:
+            GET_OP_PARAM(BiasMode::NO_BIAS)
+            break;
+        case BiasMode::BROADCAST_CHANNEL_BIAS:
+            GET_OP_PARAM(BiasMode::BROADCAST_CHANNEL_BIAS)
+            break;
+        case BiasMode::BIAS:
+            GET_OP_PARAM(BiasMode::BIAS)
+            break;
+        default:
+            megdnn_assert(0);
+            break;
+    }
+#undef DO_CONV_KERN_FUN
+#undef GET_OP_PARAM
+
+    megdnn_assert(do_conv_fun);
+    int oh_block, ih2, iw2;
+    get_rectified_size(param, oh_block, ih2, iw2);
+    CpuNDRange ncb_range = {param.n, fm.group,
+                            div_ceil<size_t>(param.osz[0], oh_block)};
+    auto do_conv = [bundle, do_conv_fun](
+                           const NCBKernParam& kern_param,
+                           const NCBKernIndex& ncb_index) mutable {
+        bundle.set(kern_param.workspace_ptr);
+        do_conv_fun(bundle, kern_param, ncb_index);
+    };
+    return {{do_conv, ncb_range}};
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,283 @@
+/**
+ * \file dnn/src/x86/conv_bias/f32/nchw88_kern.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include <immintrin.h>
+#ifdef WIN32
+#include <avx2intrin.h>
+#include <avxintrin.h>
+#include <fmaintrin.h>
+#endif
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "src/common/unroll_macro.h"
+#include "src/common/utils.h"
+#include "src/fallback/conv_bias/common.h"
+#include "src/x86/elemwise_op.h"
+
+namespace megdnn {
+namespace x86 {
+namespace nchw88 {
+
+//! channels in one pack, which is also the width of a ymm register
+constexpr int PACK = 8;
+//! output pixels computed by one dense micro kernel
+constexpr int OW_BLOCK = 6;
+//! output pixels computed by one channel-wise micro kernel
+constexpr int CHANWISE_OW_BLOCK = 8;
+
+//! choose the number of output rows of a task, so that the padded src of a
+//! task fits in L2 and the rows are evenly split among the threads
+static inline int l2_block_helper(const int nthread, const int amount,
+                                  const int size_per_unit) {
+    constexpr int l2_cache_size = 256 * 1024;
+    const int block_per_thread = div_ceil(amount, nthread);
+    const int best_block = std::max(
+            1, std::min(amount,
+                        (l2_cache_size + size_per_unit / 2) / size_per_unit));
+    const int max_block_num = div_ceil(block_per_thread, best_block);
+    const int min_block_num = std::max(max_block_num - 1, 1);
+    const int max_block = div_ceil(block_per_thread, max_block_num);
+    const int min_block = div_ceil(block_per_thread, min_block_num);
+    const int max_loss = std::abs(max_block_num * max_block - block_per_thread);
+    const int min_loss = std::abs(min_block_num * min_block - block_per_thread);
+    return max_loss > min_loss ? min_block : max_block;
+}
+
+/*!
+ * \brief copy rows [ih_start, ih_start + ih_real) of src into a zero padded
+ * buffer of width iw2
+ *
+ * src is laid out as [nr_packs][IH][IW][pack], and the rows out of [0, IH)
+ * are filled with zero; dst is laid out as [nr_packs][ih_real][iw2][pack].
+ */
+static inline void pad_src(float* dst, const float* src, int nr_packs,
+                           int pack, int ih, int iw, int ih_start, int ih_real,
+                           int pw, int iw2) {
+    megdnn_assert(iw2 >= iw + pw);
+    const size_t row_bytes = iw2 * pack * sizeof(float);
+    for (int p = 0; p < nr_packs; ++p) {
+        const float* sptr = src + static_cast<size_t>(p) * ih * iw * pack;
+        for (int r = 0; r < ih_real; ++r) {
+            int y = ih_start + r;
+            if (y < 0 || y >= ih) {
+                memset(dst, 0, row_bytes);
+            } else {
+                memset(dst, 0, pw * pack * sizeof(float));
+                memcpy(dst + pw * pack,
+                       sptr + static_cast<size_t>(y) * iw * pack,
+                       iw * pack * sizeof(float));
+                memset(dst + (pw + iw) * pack, 0,
+                       (iw2 - pw - iw) * pack * sizeof(float));
+            }
+            dst += iw2 * pack;
+        }
+    }
+}
+
+/*!
+ * \brief add the bias, apply the nonlinearity and store the first ow_cnt
+ * pixels of a block of accumulators
+ *
+ * \param bias_oc_stride distance between two oc packs of the bias, which is
+ *      PACK for BROADCAST_CHANNEL_BIAS and the dst oc stride for BIAS
+ */
+template <BiasMode bias_mode, typename Op, int ocb, int owb>
+MEGDNN_ATTRIBUTE_TARGET("avx2,fma")
+static inline void store_block(__m256 (&c)[ocb][owb], float* dst,
+                               size_t dst_oc_stride, const float* bias,
+                               size_t bias_oc_stride, int ow_cnt,
+                               const Op& op) {
+    for (int i = 0; i < ocb; ++i) {
+        __m256 vbias = _mm256_setzero_ps();
+        if (bias_mode == BiasMode::BROADCAST_CHANNEL_BIAS) {
+            vbias = _mm256_loadu_ps(bias + i * bias_oc_stride);
+        }
+        for (int j = 0; j < owb; ++j) {
+            if (j >= ow_cnt)
+                break;
+            __m256 v = c[i][j];
+            if (bias_mode == BiasMode::BROADCAST_CHANNEL_BIAS) {
+                v = _mm256_add_ps(v, vbias);
+            } else if (bias_mode == BiasMode::BIAS) {
+                v = _mm256_add_ps(v, _mm256_loadu_ps(bias + i * bias_oc_stride +
+                                                     j * PACK));
+            }
+            _mm256_storeu_ps(dst + i * dst_oc_stride + j * PACK, op(v));
+        }
+    }
+}
+
+/*!
+ * \brief strides of the padded src and the filter seen by the dense kernel
+ *
+ * The filter of one oc pack is [ic_packs][FH][FW][pack][PACK], which covers
+ * both {oc/8, ic/8, fh, fw, 8, 8} (pack = 8) and the {oc/8, fh, fw, ic, 8}
+ * filter of the first layer (ic_packs = 1, pack = ic).
+ */
+struct DirectParam {
+    int ic_packs, pack, fh, fw, stride;
+    size_t src_pack_stride, src_h_stride, src_w_stride, src_c_stride;
+    size_t flt_oc_stride;
+};
+
+/*!
+ * \brief ocb x OW_BLOCK block of the output, one ymm of 8 output channels per
+ * pixel; the src value is broadcast and multiplied with the filter vector
+ */
+template <int ocb>
+MEGDNN_ATTRIBUTE_TARGET("avx2,fma")
+static inline void direct_block(const float* src, const float* filter,
+                                const DirectParam& p,
+                                __m256 (&c)[ocb][OW_BLOCK]) {
+#define cb(j)                                                                  \
+    for (int i = 0; i < ocb; ++i) {                                            \
+        c[i][j] = _mm256_setzero_ps();                                         \
+    }
+    UNROLL_CALL_RAW(6, cb);
+#undef cb
+    const size_t ow_step = p.stride * p.src_w_stride;
+    const float* wptr = filter;
+    for (int icp = 0; icp < p.ic_packs; ++icp) {
+        for (int y = 0; y < p.fh; ++y) {
+            for (int x = 0; x < p.fw; ++x) {
+                const float* sptr = src + icp * p.src_pack_stride +
+                                    y * p.src_h_stride + x * p.src_w_stride;
+                for (int k = 0; k < p.pack; ++k) {
+                    __m256 w[ocb];
+                    for (int i = 0; i < ocb; ++i) {
+                        w[i] = _mm256_loadu_ps(wptr + i * p.flt_oc_stride);
+                    }
+                    __m256 v;
+#define cb(j)                                                                  \
+    v = _mm256_broadcast_ss(sptr + j * ow_step);                               \
+    for (int i = 0; i < ocb; ++i) {                                            \
+        c[i][j] = _mm256_fmadd_ps(v, w[i], c[i][j]);                           \
+    }
+                    UNROLL_CALL_RAW(6, cb);
+#undef cb
+                    sptr += p.src_c_stride;
+                    wptr += PACK;
+                }
+            }
+        }
+    }
+}
+
+template <BiasMode bias_mode, typename Op, int ocb>
+MEGDNN_ATTRIBUTE_TARGET("avx2,fma")
+static void conv_direct_oc_block(const float* src, const float* filter,
+                                 const float* bias, float* dst,
+                                 const DirectParam& p, int oh_real, int ow,
+                                 size_t dst_oc_stride, size_t src_row_stride,
+                                 const Op& op) {
+    const size_t bias_oc_stride =
+            bias_mode == BiasMode::BIAS ? dst_oc_stride : PACK;
+    const size_t src_ow_stride = OW_BLOCK * p.stride * p.src_w_stride;
+    __m256 c[ocb][OW_BLOCK];
+    for (int r = 0; r < oh_real; ++r) {
+        for (int ow0 = 0; ow0 < ow; ow0 += OW_BLOCK) {
+            size_t dst_offset = (static_cast<size_t>(r) * ow + ow0) * PACK;
+            direct_block<ocb>(
+                    src + r * src_row_stride + ow0 / OW_BLOCK * src_ow_stride,
+                    filter, p, c);
+            store_block<bias_mode, Op, ocb, OW_BLOCK>(
+                    c, dst + dst_offset, dst_oc_stride,
+                    bias_mode == BiasMode::BIAS ? bias + dst_offset : bias,
+                    bias_oc_stride, std::min(OW_BLOCK, ow - ow0), op);
+        }
+    }
+}
+
+/*!
+ * \brief dense conv of oh_real output rows from a padded src tile
+ *
+ * Two oc packs share each broadcast of src; an odd oc pack at the end is
+ * computed alone.
+ *
+ * \param dst dst of the first oc pack at the first row of the tile
+ * \param bias bias of the first oc pack, at the first row of the tile for
+ *      BiasMode::BIAS
+ * \param src_row_stride distance of two output rows in the padded src
+ */
+template <BiasMode bias_mode, typename Op>
+static void conv_direct(const float* src, const float* filter,
+                        const float* bias, float* dst, const DirectParam& p,
+                        int oc_packs, int oh_real, int ow,
+                        size_t dst_oc_stride, size_t src_row_stride) {
+    Op op;
+    const size_t bias_oc_stride =
+            bias_mode == BiasMode::BIAS ? dst_oc_stride : PACK;
+    int ocp = 0;
+    for (; ocp + 2 <= oc_packs; ocp += 2) {
+        conv_direct_oc_block<bias_mode, Op, 2>(
+                src, filter + ocp * p.flt_oc_stride,
+                bias + ocp * bias_oc_stride, dst + ocp * dst_oc_stride, p,
+                oh_real, ow, dst_oc_stride, src_row_stride, op);
+    }
+    if (ocp < oc_packs) {
+        conv_direct_oc_block<bias_mode, Op, 1>(
+                src, filter + ocp * p.flt_oc_stride,
+                bias + ocp * bias_oc_stride, dst + ocp * dst_oc_stride, p,
+                oh_real, ow, dst_oc_stride, src_row_stride, op);
+    }
+}
+
+/*!
+ * \brief channel-wise conv of one pack of 8 groups
+ *
+ * src is the whole padded image [IH2][IW2][8] and filter is [FH][FW][8];
+ * every pixel is an element-wise multiply of two vectors, so no broadcast is
+ * needed.
+ */
+template <BiasMode bias_mode, typename Op>
+MEGDNN_ATTRIBUTE_TARGET("avx2,fma")
+static void conv_chanwise(const float* src, const float* filter,
+                          const float* bias, float* dst, int oh, int ow,
+                          int fh, int fw, int stride, int iw2) {
+    Op op;
+    __m256 c[1][CHANWISE_OW_BLOCK];
+    for (int r = 0; r < oh; ++r) {
+        for (int ow0 = 0; ow0 < ow; ow0 += CHANWISE_OW_BLOCK) {
+#define cb(j) c[0][j] = _mm256_setzero_ps();
+            UNROLL_CALL_RAW(8, cb);
+#undef cb
+            for (int y = 0; y < fh; ++y) {
+                const float* sptr =
+                        src + (static_cast<size_t>(r * stride + y) * iw2 +
+                               ow0 * stride) *
+                                      PACK;
+                for (int x = 0; x < fw; ++x) {
+                    __m256 w = _mm256_loadu_ps(filter + (y * fw + x) * PACK);
+#define cb(j)                                                                  \
+    c[0][j] = _mm256_fmadd_ps(                                                 \
+            _mm256_loadu_ps(sptr + (j * stride + x) * PACK), w, c[0][j]);
+                    UNROLL_CALL_RAW(8, cb);
+#undef cb
+                }
+            }
+            size_t dst_offset = (static_cast<size_t>(r) * ow + ow0) * PACK;
+            store_block<bias_mode, Op, 1, CHANWISE_OW_BLOCK>(
+                    c, dst + dst_offset, 0,
+                    bias_mode == BiasMode::BIAS ? bias + dst_offset : bias, 0,
+                    std::min(CHANWISE_OW_BLOCK, ow - ow0), op);
+        }
+    }
+}
+
+}  // namespace nchw88
+}  // namespace x86
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -38,6 +38,9 @@ class ConvBiasImpl::AlgoPack : NonCopyableObj {
     AlgoAVX2DirectConvStride2 avx2_stride2_direct;
     AlgoChanWiseAvx2Stride1Qint8 avx2_stride1_chanwsie_qint8;
     AlgoChanWiseAvx2Stride2Qint8 avx2_stride2_chanwsie_qint8;
+    AlgoF32DirectNCHW88 f32_direct_nchw88;
+    AlgoF32ChannelWiseNCHW88 f32_chanwise_nchw88;
+    AlgoF32DirectNCHWNCHW88 f32_direct_nchw_nchw88;
 #if MEGDNN_X86_WITH_MKL_DNN
     AlgoMkldnnMatmulQint8 mkldnn_matmul_qint8;
     //! Because the mkldnnconv need handle
@@ -59,6 +62,9 @@ public:
         m_all_no_winograd_algo.emplace_back(&mkldnn_matmul_qint8);
         m_all_no_winograd_algo.emplace_back(&mkldnn_qint8);
 #endif
+        m_all_no_winograd_algo.emplace_back(&f32_chanwise_nchw88);
+        m_all_no_winograd_algo.emplace_back(&f32_direct_nchw_nchw88);
+        m_all_no_winograd_algo.emplace_back(&f32_direct_nchw88);
         m_all_no_winograd_algo.emplace_back(&stride1_direct);
         m_all_no_winograd_algo.emplace_back(&stride2_direct);
         m_all_no_winograd_algo.emplace_back(&avx2_stride1_chanwsie_qint8);
@@ -59,6 +59,9 @@ private:
     class AlgoAVX2DirectConvStride2;
     class AlgoChanWiseAvx2Stride1Qint8;
     class AlgoChanWiseAvx2Stride2Qint8;
+    class AlgoF32DirectNCHW88;
+    class AlgoF32ChannelWiseNCHW88;
+    class AlgoF32DirectNCHWNCHW88;
 #if MEGDNN_X86_WITH_MKL_DNN
     class AlgoMkldnnConv;
     class AlgoMkldnnQint8;
@@ -24,6 +24,8 @@
 #include "src/x86/lrn/opr_impl.h"
 #include "src/x86/matrix_mul/opr_impl.h"
 #include "src/x86/pooling/opr_impl.h"
+#include "src/x86/reduce/opr_impl.h"
+#include "src/x86/relayout/opr_impl.h"
 #include "src/x86/resize/opr_impl.h"
 #include "src/x86/separable_conv/opr_impl.h"
 #include "src/x86/separable_filter/opr_impl.h"
@@ -88,6 +90,8 @@ MEGDNN_SPECIALIZE_CREATE_OPERATOR(WarpPerspective)
 MEGDNN_SPECIALIZE_CREATE_OPERATOR(AddUpdate)
 MEGDNN_SPECIALIZE_CREATE_OPERATOR(TypeCvt)
 MEGDNN_SPECIALIZE_CREATE_OPERATOR(ConvBias)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(Reduce)
+MEGDNN_SPECIALIZE_CREATE_OPERATOR(RelayoutForward)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
@@ -21,6 +21,7 @@
 MIDOUT_DECL(megdnn_x86_matmul_kern)
 MIDOUT_DECL(megdnn_x86_matmul_kern_mk8_8x8)
 MIDOUT_DECL(megdnn_x86_matmul_kern_mkldnn)
+MIDOUT_DECL(megdnn_x86_matmul_kern_f32_packed)
 using namespace megdnn;
 using namespace x86;
 
@@ -662,4 +663,104 @@ size_t MatrixMulImpl::AlgoF32MK8_8x8::get_workspace(
     MIDOUT_END();
 }
 
+/*************************AlgoF32AVX2M6N16********************/
+namespace {
+template <typename Strategy>
+void f32_packed_kern(const MatrixMulImpl::KernParam& kern_param) {
+    auto M = kern_param.M, N = kern_param.N, K = kern_param.K;
+    auto trA = kern_param.trA, trB = kern_param.trB;
+    auto LDA = kern_param.LDA, LDB = kern_param.LDB, LDC = kern_param.LDC;
+    auto A_type = kern_param.A_type, B_type = kern_param.B_type,
+         C_type = kern_param.C_type;
+    const auto Aptr = kern_param.A<float>(), Bptr = kern_param.B<float>();
+    auto Cptr = kern_param.C<float>();
+    constexpr int cacheline = 64;
+    Strategy strategy(M, N, K, A_type, B_type, C_type);
+    megdnn::matmul::GemmInterleaved<Strategy>(M, N, K, trA, trB, strategy,
+                                              cacheline)
+            .execute(Aptr, LDA, Bptr, LDB, Cptr, LDC,
+                     kern_param.workspace_ptr);
+}
+
+template <typename Strategy>
+size_t f32_packed_workspace(const MatrixMulImpl::KernSizeParam& kern_param) {
+    constexpr int cacheline = 64;
+    Strategy strategy(kern_param.M, kern_param.N, kern_param.K,
+                      kern_param.A_type, kern_param.B_type, kern_param.C_type);
+    return megdnn::matmul::GemmInterleaved<Strategy>(
+                   kern_param.M, kern_param.N, kern_param.K, kern_param.trA,
+                   kern_param.trB, strategy, cacheline)
+            .get_workspace_size();
+}
+
+bool f32_packed_usable(const MatrixMulImpl::KernSizeParam& kern_size_param) {
+    using Param = param::MatrixMul;
+    return kern_size_param.compute_mode == Param::ComputeMode::DEFAULT &&
+           kern_size_param.format == Param::Format::DEFAULT &&
+           kern_size_param.B_type.enumv() == kern_size_param.A_type.enumv() &&
+           kern_size_param.C_type.enumv() == kern_size_param.A_type.enumv() &&
+           kern_size_param.A_type.enumv() == DTypeEnum::Float32;
+}
+}  // anonymous namespace
+
+MatrixMulImpl::kern_t MatrixMulImpl::AlgoF32AVX2M6N16::get_kern(
+        const KernSizeParam&) const {
+    auto kern = [](const MatrixMulImpl::KernParam& kern_param) {
+        MIDOUT_BEGIN(megdnn_x86_matmul_kern_f32_packed, midout_iv(0)) {
+            f32_packed_kern<x86::matmul::sgemm_pack_6x16_avx2>(kern_param);
+        }
+        MIDOUT_END();
+    };
+    return kern;
+}
+
+bool MatrixMulImpl::AlgoF32AVX2M6N16::usable(
+        const KernSizeParam& kern_size_param) const {
+    return f32_packed_usable(kern_size_param) &&
+           is_supported(SIMDType::AVX2) && is_supported(SIMDType::FMA);
+}
+
+size_t MatrixMulImpl::AlgoF32AVX2M6N16::get_workspace(
+        const KernSizeParam& kern_param) const {
+    return f32_packed_workspace<x86::matmul::sgemm_pack_6x16_avx2>(
+            kern_param);
+}
+
+MEGDNN_REG_GEMM_FUNC_FOR_IM2COL_IMPL(AlgoF32AVX2M6N16,
+                                     megdnn_x86_matmul_kern_f32_packed,
+                                     "AlgoF32AVX2M6N16"_hash,
+                                     x86::matmul::sgemm_pack_6x16_avx2, float,
+                                     float, AlgoDataType::FLOAT32, DEFAULT);
+
+/*************************AlgoF32AVX512M12N32********************/
+MatrixMulImpl::kern_t MatrixMulImpl::AlgoF32AVX512M12N32::get_kern(
+        const KernSizeParam&) const {
+    auto kern = [](const MatrixMulImpl::KernParam& kern_param) {
+        MIDOUT_BEGIN(megdnn_x86_matmul_kern_f32_packed, midout_iv(1)) {
+            f32_packed_kern<x86::matmul::sgemm_pack_12x32_avx512>(kern_param);
+        }
+        MIDOUT_END();
+    };
+    return kern;
+}
+
+bool MatrixMulImpl::AlgoF32AVX512M12N32::usable(
+        const KernSizeParam& kern_size_param) const {
+    return f32_packed_usable(kern_size_param) &&
+           is_supported(SIMDType::AVX512);
+}
+
+size_t MatrixMulImpl::AlgoF32AVX512M12N32::get_workspace(
+        const KernSizeParam& kern_param) const {
+    return f32_packed_workspace<x86::matmul::sgemm_pack_12x32_avx512>(
+            kern_param);
+}
+
+MEGDNN_REG_GEMM_FUNC_FOR_IM2COL_IMPL(AlgoF32AVX512M12N32,
+                                     megdnn_x86_matmul_kern_f32_packed,
+                                     "AlgoF32AVX512M12N32"_hash,
+                                     x86::matmul::sgemm_pack_12x32_avx512,
+                                     float, float, AlgoDataType::FLOAT32,
+                                     DEFAULT);
+
 // vim: syntax=cpp.doxygen
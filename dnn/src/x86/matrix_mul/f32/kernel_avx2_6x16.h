@@ -0,0 +1,112 @@
+/**
+ * \file dnn/src/x86/matrix_mul/f32/kernel_avx2_6x16.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include <immintrin.h>
+#ifdef WIN32
+#include <avx2intrin.h>
+#include <avxintrin.h>
+#include <fmaintrin.h>
+#endif
+
+#include "src/common/unroll_macro.h"
+#include "src/x86/matrix_mul/f32/packed_helper.h"
+
+namespace megdnn {
+namespace x86 {
+namespace matmul_avx2_6x16 {
+
+constexpr size_t MR = 6;
+constexpr size_t NR = 16;
+//! a 256 x 16 panel of B takes 16KB of L1
+constexpr size_t KC = 256;
+//! a 120 x 256 block of A takes 120KB of L2
+constexpr size_t MC = 120;
+
+/*!
+ * \brief 6x16 micro kernel, 12 ymm accumulators, one broadcast of A and two
+ * loads of B per k
+ */
+MEGDNN_ATTRIBUTE_TARGET("avx2,fma")
+static inline void kern_6x16(const float* a_ptr, const float* b_ptr, size_t K,
+                             float* c_ptr, size_t ldc, size_t m, size_t n,
+                             bool accumulate) {
+    __m256 c[MR][2];
+#define cb(i)                                                                  \
+    c[i][0] = _mm256_setzero_ps();                                             \
+    c[i][1] = _mm256_setzero_ps();
+    UNROLL_CALL_RAW(6, cb);
+#undef cb
+
+    for (size_t k = 0; k < K; ++k) {
+        __m256 b0 = _mm256_loadu_ps(b_ptr);
+        __m256 b1 = _mm256_loadu_ps(b_ptr + 8);
+        __m256 a;
+#define cb(i)                                                                  \
+    a = _mm256_broadcast_ss(a_ptr + i);                                        \
+    c[i][0] = _mm256_fmadd_ps(a, b0, c[i][0]);                                 \
+    c[i][1] = _mm256_fmadd_ps(a, b1, c[i][1]);
+        UNROLL_CALL_RAW(6, cb);
+#undef cb
+        a_ptr += MR;
+        b_ptr += NR;
+    }
+
+    if (m == MR && n == NR) {
+        if (accumulate) {
+#define cb(i)                                                                  \
+    c[i][0] = _mm256_add_ps(c[i][0], _mm256_loadu_ps(c_ptr + i * ldc));        \
+    c[i][1] = _mm256_add_ps(c[i][1], _mm256_loadu_ps(c_ptr + i * ldc + 8));
+            UNROLL_CALL_RAW(6, cb);
+#undef cb
+        }
+#define cb(i)                                                                  \
+    _mm256_storeu_ps(c_ptr + i * ldc, c[i][0]);                                \
+    _mm256_storeu_ps(c_ptr + i * ldc + 8, c[i][1]);
+        UNROLL_CALL_RAW(6, cb);
+#undef cb
+    } else {
+        alignas(32) float tile[MR * NR];
+#define cb(i)                                                                  \
+    _mm256_store_ps(tile + i * NR, c[i][0]);                                   \
+    _mm256_store_ps(tile + i * NR + 8, c[i][1]);
+        UNROLL_CALL_RAW(6, cb);
+#undef cb
+        matmul::packed_f32::store_partial_tile<NR>(tile, c_ptr, ldc, m, n,
+                                                   accumulate);
+    }
+}
+
+static inline void gemm_packa(float* out, const float* in, int ldin, int y0,
+                              int ymax, int k0, int kmax, bool transpose) {
+    matmul::packed_f32::pack_a<MR>(out, in, ldin, y0, ymax, k0, kmax,
+                                   transpose);
+}
+
+static inline void gemm_packb(float* out, const float* in, int ldin, int x0,
+                              int xmax, int k0, int kmax, bool transpose) {
+    matmul::packed_f32::pack_b<NR>(out, in, ldin, x0, xmax, k0, kmax,
+                                   transpose);
+}
+
+static inline void gemm_kern(const float* pack_a, const float* pack_b,
+                             size_t M, size_t N, size_t K, float* C,
+                             size_t LDC, bool is_first_k) {
+    matmul::packed_f32::gemm_blocked<MR, NR, KC, MC>(
+            pack_a, pack_b, M, N, K, C, LDC, is_first_k, kern_6x16);
+}
+
+}  // namespace matmul_avx2_6x16
+}  // namespace x86
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
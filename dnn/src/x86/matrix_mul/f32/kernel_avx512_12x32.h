@@ -0,0 +1,107 @@
+/**
+ * \file dnn/src/x86/matrix_mul/f32/kernel_avx512_12x32.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include <immintrin.h>
+
+#include "src/common/unroll_macro.h"
+#include "src/x86/matrix_mul/f32/packed_helper.h"
+
+namespace megdnn {
+namespace x86 {
+namespace matmul_avx512_12x32 {
+
+constexpr size_t MR = 12;
+constexpr size_t NR = 32;
+//! a 128 x 32 panel of B takes 16KB of L1
+constexpr size_t KC = 128;
+//! a 480 x 128 block of A takes 240KB of L2
+constexpr size_t MC = 480;
+
+/*!
+ * \brief 12x32 micro kernel, 24 zmm accumulators, one broadcast of A and two
+ * loads of B per k
+ */
+MEGDNN_ATTRIBUTE_TARGET("avx512f")
+static inline void kern_12x32(const float* a_ptr, const float* b_ptr, size_t K,
+                             float* c_ptr, size_t ldc, size_t m, size_t n,
+                             bool accumulate) {
+    __m512 c[MR][2];
+#define cb(i)                                                                  \
+    c[i][0] = _mm512_setzero_ps();                                             \
+    c[i][1] = _mm512_setzero_ps();
+    UNROLL_CALL_RAW(12, cb);
+#undef cb
+
+    for (size_t k = 0; k < K; ++k) {
+        __m512 b0 = _mm512_loadu_ps(b_ptr);
+        __m512 b1 = _mm512_loadu_ps(b_ptr + 16);
+        __m512 a;
+#define cb(i)                                                                  \
+    a = _mm512_set1_ps(a_ptr[i]);                                              \
+    c[i][0] = _mm512_fmadd_ps(a, b0, c[i][0]);                                 \
+    c[i][1] = _mm512_fmadd_ps(a, b1, c[i][1]);
+        UNROLL_CALL_RAW(12, cb);
+#undef cb
+        a_ptr += MR;
+        b_ptr += NR;
+    }
+
+    if (m == MR && n == NR) {
+        if (accumulate) {
+#define cb(i)                                                                  \
+    c[i][0] = _mm512_add_ps(c[i][0], _mm512_loadu_ps(c_ptr + i * ldc));        \
+    c[i][1] = _mm512_add_ps(c[i][1], _mm512_loadu_ps(c_ptr + i * ldc + 16));
+            UNROLL_CALL_RAW(12, cb);
+#undef cb
+        }
+#define cb(i)                                                                  \
+    _mm512_storeu_ps(c_ptr + i * ldc, c[i][0]);                                \
+    _mm512_storeu_ps(c_ptr + i * ldc + 16, c[i][1]);
+        UNROLL_CALL_RAW(12, cb);
+#undef cb
+    } else {
+        alignas(64) float tile[MR * NR];
+#define cb(i)                                                                  \
+    _mm512_store_ps(tile + i * NR, c[i][0]);                                   \
+    _mm512_store_ps(tile + i * NR + 16, c[i][1]);
+        UNROLL_CALL_RAW(12, cb);
+#undef cb
+        matmul::packed_f32::store_partial_tile<NR>(tile, c_ptr, ldc, m, n,
+                                                   accumulate);
+    }
+}
+
+static inline void gemm_packa(float* out, const float* in, int ldin, int y0,
+                              int ymax, int k0, int kmax, bool transpose) {
+    matmul::packed_f32::pack_a<MR>(out, in, ldin, y0, ymax, k0, kmax,
+                                   transpose);
+}
+
+static inline void gemm_packb(float* out, const float* in, int ldin, int x0,
+                              int xmax, int k0, int kmax, bool transpose) {
+    matmul::packed_f32::pack_b<NR>(out, in, ldin, x0, xmax, k0, kmax,
+                                   transpose);
+}
+
+static inline void gemm_kern(const float* pack_a, const float* pack_b,
+                             size_t M, size_t N, size_t K, float* C,
+                             size_t LDC, bool is_first_k) {
+    matmul::packed_f32::gemm_blocked<MR, NR, KC, MC>(
+            pack_a, pack_b, M, N, K, C, LDC, is_first_k, kern_12x32);
+}
+
+}  // namespace matmul_avx512_12x32
+}  // namespace x86
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
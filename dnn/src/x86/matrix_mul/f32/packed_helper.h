@@ -0,0 +1,155 @@
+/**
+ * \file dnn/src/x86/matrix_mul/f32/packed_helper.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include "src/common/utils.h"
+
+namespace megdnn {
+namespace x86 {
+namespace matmul {
+namespace packed_f32 {
+
+/*!
+ * \brief pack rows [y0, ymax) of A into panels of MR rows
+ *
+ * Each panel holds (kmax - k0) x MR elements with the MR elements of one k
+ * adjacent, and rows beyond ymax are filled with zero, so the kernel never
+ * needs to handle partial panels when loading A.
+ */
+template <size_t MR>
+static inline void pack_a(float* out, const float* in, int ldin, int y0,
+                          int ymax, int k0, int kmax, bool transpose) {
+    const int ksize = kmax - k0;
+    for (int y = y0; y < ymax; y += MR) {
+        const int rows = std::min<int>(MR, ymax - y);
+        if (!transpose) {
+            for (int r = 0; r < rows; ++r) {
+                const float* inptr = in + (y + r) * ldin + k0;
+                float* outptr = out + r;
+                for (int k = 0; k < ksize; ++k) {
+                    outptr[k * MR] = inptr[k];
+                }
+            }
+            for (int r = rows; r < static_cast<int>(MR); ++r) {
+                for (int k = 0; k < ksize; ++k) {
+                    out[k * MR + r] = 0.f;
+                }
+            }
+        } else {
+            for (int k = 0; k < ksize; ++k) {
+                const float* inptr = in + (k0 + k) * ldin + y;
+                float* outptr = out + k * MR;
+                memcpy(outptr, inptr, sizeof(float) * rows);
+                std::fill(outptr + rows, outptr + MR, 0.f);
+            }
+        }
+        out += ksize * MR;
+    }
+}
+
+/*!
+ * \brief pack columns [x0, xmax) of B into panels of NR columns, in the same
+ * layout as pack_a()
+ */
+template <size_t NR>
+static inline void pack_b(float* out, const float* in, int ldin, int x0,
+                          int xmax, int k0, int kmax, bool transpose) {
+    const int ksize = kmax - k0;
+    for (int x = x0; x < xmax; x += NR) {
+        const int cols = std::min<int>(NR, xmax - x);
+        if (!transpose) {
+            for (int k = 0; k < ksize; ++k) {
+                const float* inptr = in + (k0 + k) * ldin + x;
+                float* outptr = out + k * NR;
+                memcpy(outptr, inptr, sizeof(float) * cols);
+                std::fill(outptr + cols, outptr + NR, 0.f);
+            }
+        } else {
+            for (int c = 0; c < cols; ++c) {
+                const float* inptr = in + (x + c) * ldin + k0;
+                float* outptr = out + c;
+                for (int k = 0; k < ksize; ++k) {
+                    outptr[k * NR] = inptr[k];
+                }
+            }
+            for (int c = cols; c < static_cast<int>(NR); ++c) {
+                for (int k = 0; k < ksize; ++k) {
+                    out[k * NR + c] = 0.f;
+                }
+            }
+        }
+        out += ksize * NR;
+    }
+}
+
+/*!
+ * \brief write back a MR x NR tile computed in \p tile to C when the tile is
+ * only partially inside C
+ */
+template <size_t NR>
+static inline void store_partial_tile(const float* tile, float* c, size_t ldc,
+                                      size_t m, size_t n, bool accumulate) {
+    for (size_t r = 0; r < m; ++r) {
+        float* cptr = c + r * ldc;
+        const float* tptr = tile + r * NR;
+        if (accumulate) {
+            for (size_t j = 0; j < n; ++j) {
+                cptr[j] += tptr[j];
+            }
+        } else {
+            memcpy(cptr, tptr, sizeof(float) * n);
+        }
+    }
+}
+
+/*!
+ * \brief run the micro kernel over packed panels with cache blocking
+ *
+ * The K dimension is split into blocks of KC, so that a KC x NR panel of B
+ * stays in L1 while it is multiplied with MC rows of A, which stay in L2.
+ * Partial sums of later K blocks are accumulated into C.
+ *
+ * \param kern micro kernel with signature (a, b, kc, c, ldc, m, n,
+ *      accumulate), computing a MR x NR tile of which the top-left m x n
+ *      part is written
+ */
+template <size_t MR, size_t NR, size_t KC, size_t MC, typename Kern>
+static inline void gemm_blocked(const float* pack_a, const float* pack_b,
+                                size_t M, size_t N, size_t K, float* C,
+                                size_t LDC, bool is_first_k, Kern kern) {
+    static_assert(MC % MR == 0, "MC must be multiple of MR");
+    for (size_t k0 = 0; k0 < K; k0 += KC) {
+        const size_t kc = std::min(KC, K - k0);
+        const bool accumulate = !is_first_k || k0 > 0;
+        for (size_t m0 = 0; m0 < M; m0 += MC) {
+            const size_t mmax = std::min(m0 + MC, M);
+            for (size_t n0 = 0; n0 < N; n0 += NR) {
+                const float* b_ptr = pack_b + n0 * K + k0 * NR;
+                const size_t n = std::min(NR, N - n0);
+                for (size_t m1 = m0; m1 < mmax; m1 += MR) {
+                    const float* a_ptr = pack_a + m1 * K + k0 * MR;
+                    kern(a_ptr, b_ptr, kc, C + m1 * LDC + n0, LDC,
+                         std::min(MR, M - m1), n, accumulate);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace packed_f32
+}  // namespace matmul
+}  // namespace x86
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
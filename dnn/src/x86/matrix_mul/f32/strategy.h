@@ -19,6 +19,12 @@ namespace matmul {
 MEGDNN_REG_GEMM_STRATEGY_NOPACK(float, float, float, 8, 8, 8, false, true,
                                 sgemm_nopack_8x8_avx2);
 
+MEGDNN_REG_GEMM_STRATEGY(float, float, float, 6, 16, 1, false, false,
+                         sgemm_pack_6x16_avx2);
+
+MEGDNN_REG_GEMM_STRATEGY(float, float, float, 12, 32, 1, false, false,
+                         sgemm_pack_12x32_avx512);
+
 }  // namespace matmul
 }  // namespace x86
 }  // namespace megdnn
\ No newline at end of file
@@ -0,0 +1,50 @@
+/**
+ * \file dnn/src/x86/matrix_mul/f32/strategy_6x16.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "src/common/utils.h"
+#include "src/x86/matrix_mul/f32/kernel_avx2_6x16.h"
+#include "src/x86/matrix_mul/f32/strategy.h"
+#include "src/x86/utils.h"
+
+using namespace megdnn;
+using namespace x86;
+using namespace x86::matmul;
+
+MEGDNN_REG_GEMM_STRATEGY_IMPL(sgemm_pack_6x16_avx2);
+
+void sgemm_pack_6x16_avx2::pack_A(float* out, const float* in, int ldin,
+                                  int y0, int ymax, int k0, int kmax,
+                                  bool transpose) const {
+    matmul_avx2_6x16::gemm_packa(out, in, ldin, y0, ymax, k0, kmax,
+                                 transpose);
+}
+
+void sgemm_pack_6x16_avx2::pack_B(float* out, const float* in, int ldin,
+                                  int x0, int xmax, int k0, int kmax,
+                                  bool transpose) const {
+    matmul_avx2_6x16::gemm_packb(out, in, ldin, x0, xmax, k0, kmax,
+                                 transpose);
+}
+
+void sgemm_pack_6x16_avx2::kern(const float* pack_a_ptr,
+                                const float* pack_b_ptr, size_t m,
+                                size_t n, size_t k, float* c_ptr,
+                                size_t ldc, bool is_first_k, const float*,
+                                float*) const {
+    megdnn_assert(A_dtype.enumv() == B_dtype.enumv() &&
+                          A_dtype.enumv() == C_dtype.enumv() &&
+                          A_dtype.enumv() == DTypeEnum::Float32);
+    matmul_avx2_6x16::gemm_kern(pack_a_ptr, pack_b_ptr, m, n, k, c_ptr,
+                                ldc, is_first_k);
+}
+
+// vim: syntax=cpp.doxygen
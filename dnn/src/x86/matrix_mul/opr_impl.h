@@ -68,6 +68,8 @@ private:
     class AlgoInt8x8x16SSE;
     class AlgoPack;
     class AlgoF32MK8_8x8;
+    class AlgoF32AVX2M6N16;
+    class AlgoF32AVX512M12N32;
 
 public:
     static const AlgoPack& algo_pack();
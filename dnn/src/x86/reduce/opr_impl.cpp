@@ -0,0 +1,448 @@
+/**
+ * \file dnn/src/x86/reduce/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "src/x86/reduce/opr_impl.h"
+
+#include <immintrin.h>
+#ifdef WIN32
+#include <avx2intrin.h>
+#include <avxintrin.h>
+#include <fmaintrin.h>
+#endif
+#include <algorithm>
+
+#include "src/common/reduce_helper.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+#include "src/x86/utils.h"
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_x86_reduce)
+
+using namespace megdnn;
+using namespace x86;
+
+namespace {
+
+using Mode = param::Reduce::Mode;
+
+//! number of src elements handled by one multi-thread task at least
+constexpr size_t TASK_ELEMS = 16384;
+
+/*!
+ * \brief scalar reduction in float, used for the tails and for folding the
+ * lanes of a vector accumulator
+ *
+ * MEAN is accumulated as SUM and scaled when writing the result.
+ */
+template <Mode mode>
+struct ScalarOp {
+    static float init() {
+        switch (mode) {
+            case Mode::PRODUCT:
+                return 1.f;
+            case Mode::MIN:
+                return DTypeTrait<dtype::Float32>::max();
+            case Mode::MAX:
+                return DTypeTrait<dtype::Float32>::min();
+            default:
+                return 0.f;
+        }
+    }
+    static float merge(float acc, float x) {
+        switch (mode) {
+            case Mode::PRODUCT:
+                return acc * x;
+            case Mode::MIN:
+                return std::min(acc, x);
+            case Mode::MAX:
+                return std::max(acc, x);
+            default:
+                return acc + x;
+        }
+    }
+    static float feed(float acc, float x) {
+        return merge(acc, mode == Mode::SUM_SQR ? x * x : x);
+    }
+};
+
+/*!
+ * \brief vector reduction with float accumulators
+ *
+ * load() converts float16 and int8 inputs to float, so the astype fused into
+ * reduce by CombineAstypeAndReducePass costs no extra pass over memory; the
+ * accumulation is always done in float32.
+ */
+template <SIMDType simd_type>
+struct SimdOp;
+
+template <>
+struct SimdOp<SIMDType::AVX2> {
+    using vtype = __m256;
+    static constexpr size_t SIMD_WIDTH = 8;
+
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype load(const dt_float32* src) { return _mm256_loadu_ps(src); }
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype load(const dt_int8* src) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+    }
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static void store(dt_float32* dst, vtype v) { _mm256_storeu_ps(dst, v); }
+#if !MEGDNN_DISABLE_FLOAT16
+    //! every cpu with avx2 supports f16c
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype load(const dt_float16* src) {
+        return _mm256_cvtph_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    }
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static void store(dt_float16* dst, vtype v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype set1(float v) { return _mm256_set1_ps(v); }
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype mul(vtype a, vtype b) { return _mm256_mul_ps(a, b); }
+
+    //! the accumulator is the second operand of min/max, so that nan in the
+    //! input is ignored like std::min/std::max in the fallback
+    template <Mode mode>
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype merge(vtype acc, vtype x) {
+        switch (mode) {
+            case Mode::PRODUCT:
+                return _mm256_mul_ps(acc, x);
+            case Mode::MIN:
+                return _mm256_min_ps(x, acc);
+            case Mode::MAX:
+                return _mm256_max_ps(x, acc);
+            default:
+                return _mm256_add_ps(acc, x);
+        }
+    }
+    template <Mode mode>
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static vtype feed(vtype acc, vtype x) {
+        if (mode == Mode::SUM_SQR)
+            return _mm256_fmadd_ps(x, x, acc);
+        return merge<mode>(acc, x);
+    }
+    template <Mode mode>
+    MEGDNN_ATTRIBUTE_TARGET("avx2,fma,f16c")
+    static float fold(vtype v) {
+        alignas(32) float buf[SIMD_WIDTH];
+        _mm256_store_ps(buf, v);
+        float res = buf[0];
+        for (size_t i = 1; i < SIMD_WIDTH; ++i) {
+            res = ScalarOp<mode>::merge(res, buf[i]);
+        }
+        return res;
+    }
+};
+
+template <>
+struct SimdOp<SIMDType::AVX512> {
+    using vtype = __m512;
+    static constexpr size_t SIMD_WIDTH = 16;
+
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype load(const dt_float32* src) { return _mm512_loadu_ps(src); }
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype load(const dt_int8* src) {
+        return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+    }
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static void store(dt_float32* dst, vtype v) { _mm512_storeu_ps(dst, v); }
+#if !MEGDNN_DISABLE_FLOAT16
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype load(const dt_float16* src) {
+        return _mm512_cvtph_ps(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+    }
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static void store(dt_float16* dst, vtype v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                            _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype set1(float v) { return _mm512_set1_ps(v); }
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype mul(vtype a, vtype b) { return _mm512_mul_ps(a, b); }
+
+    template <Mode mode>
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype merge(vtype acc, vtype x) {
+        switch (mode) {
+            case Mode::PRODUCT:
+                return _mm512_mul_ps(acc, x);
+            case Mode::MIN:
+                return _mm512_min_ps(x, acc);
+            case Mode::MAX:
+                return _mm512_max_ps(x, acc);
+            default:
+                return _mm512_add_ps(acc, x);
+        }
+    }
+    template <Mode mode>
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static vtype feed(vtype acc, vtype x) {
+        if (mode == Mode::SUM_SQR)
+            return _mm512_fmadd_ps(x, x, acc);
+        return merge<mode>(acc, x);
+    }
+    template <Mode mode>
+    MEGDNN_ATTRIBUTE_TARGET("avx512f")
+    static float fold(vtype v) {
+        alignas(64) float buf[SIMD_WIDTH];
+        _mm512_store_ps(buf, v);
+        float res = buf[0];
+        for (size_t i = 1; i < SIMD_WIDTH; ++i) {
+            res = ScalarOp<mode>::merge(res, buf[i]);
+        }
+        return res;
+    }
+};
+
+/*!
+ * \brief reduce kernels on a contiguous (A, B, C) tensor along B
+ *
+ * run_c1() handles C == 1: each row of B elements is reduced with 4
+ * independent accumulators to hide the latency of add/mul.
+ *
+ * run() handles C > 1: 4 vectors of C are kept in registers while walking
+ * down B, so each row of B is read contiguously and dst is written once.
+ */
+template <SIMDType simd_type, Mode mode, typename src_ctype,
+          typename dst_ctype>
+struct ReduceKern;
+
+#define REDUCE_KERN(_simd_type, _target)                                      \
+    template <Mode mode, typename src_ctype, typename dst_ctype>             \
+    struct ReduceKern<_simd_type, mode, src_ctype, dst_ctype> {              \
+        using Op = SimdOp<_simd_type>;                                       \
+        using SOp = ScalarOp<mode>;                                          \
+        using vtype = Op::vtype;                                             \
+        static constexpr size_t SIMD_WIDTH = Op::SIMD_WIDTH;                 \
+        static constexpr size_t UNROLL = 4;                                  \
+                                                                             \
+        MEGDNN_ATTRIBUTE_TARGET(_target)                                     \
+        static void run_c1(const src_ctype* src, dst_ctype* dst, size_t a0,  \
+                           size_t a1, size_t B) {                            \
+            const float coef = 1.f / B;                                      \
+            for (size_t a = a0; a < a1; ++a) {                               \
+                const src_ctype* sptr = src + a * B;                         \
+                vtype acc[UNROLL];                                           \
+                for (size_t i = 0; i < UNROLL; ++i) {                        \
+                    acc[i] = Op::set1(SOp::init());                          \
+                }                                                            \
+                size_t b = 0;                                                \
+                for (; b + UNROLL * SIMD_WIDTH <= B;                         \
+                     b += UNROLL * SIMD_WIDTH) {                             \
+                    for (size_t i = 0; i < UNROLL; ++i) {                    \
+                        acc[i] = Op::feed<mode>(                             \
+                                acc[i], Op::load(sptr + b + i * SIMD_WIDTH)); \
+                    }                                                        \
+                }                                                            \
+                for (; b + SIMD_WIDTH <= B; b += SIMD_WIDTH) {               \
+                    acc[0] = Op::feed<mode>(acc[0], Op::load(sptr + b));     \
+                }                                                            \
+                acc[0] = Op::merge<mode>(Op::merge<mode>(acc[0], acc[1]),    \
+                                         Op::merge<mode>(acc[2], acc[3]));   \
+                float res = Op::fold<mode>(acc[0]);                          \
+                for (; b < B; ++b) {                                         \
+                    res = SOp::feed(res, static_cast<float>(sptr[b]));       \
+                }                                                            \
+                if (mode == Mode::MEAN) {                                    \
+                    res *= coef;                                             \
+                }                                                            \
+                dst[a] = static_cast<dst_ctype>(res);                        \
+            }                                                                \
+        }                                                                    \
+                                                                             \
+        MEGDNN_ATTRIBUTE_TARGET(_target)                                     \
+        static void run(const src_ctype* src, dst_ctype* dst, size_t B,      \
+                        size_t C, size_t c0, size_t c1) {                    \
+            const float coef = 1.f / B;                                      \
+            const vtype vinit = Op::set1(SOp::init());                       \
+            const vtype vcoef = Op::set1(coef);                              \
+            size_t c = c0;                                                   \
+            for (; c + UNROLL * SIMD_WIDTH <= c1; c += UNROLL * SIMD_WIDTH) { \
+                vtype acc[UNROLL];                                           \
+                for (size_t i = 0; i < UNROLL; ++i) {                        \
+                    acc[i] = vinit;                                          \
+                }                                                            \
+                const src_ctype* sptr = src + c;                             \
+                for (size_t b = 0; b < B; ++b) {                             \
+                    for (size_t i = 0; i < UNROLL; ++i) {                    \
+                        acc[i] = Op::feed<mode>(                             \
+                                acc[i], Op::load(sptr + i * SIMD_WIDTH));    \
+                    }                                                        \
+                    sptr += C;                                               \
+                }                                                            \
+                for (size_t i = 0; i < UNROLL; ++i) {                        \
+                    if (mode == Mode::MEAN) {                                \
+                        acc[i] = Op::mul(acc[i], vcoef);                     \
+                    }                                                        \
+                    Op::store(dst + c + i * SIMD_WIDTH, acc[i]);             \
+                }                                                            \
+            }                                                                \
+            for (; c + SIMD_WIDTH <= c1; c += SIMD_WIDTH) {                  \
+                vtype acc = vinit;                                           \
+                const src_ctype* sptr = src + c;                             \
+                for (size_t b = 0; b < B; ++b) {                             \
+                    acc = Op::feed<mode>(acc, Op::load(sptr));               \
+                    sptr += C;                                               \
+                }                                                            \
+                if (mode == Mode::MEAN) {                                    \
+                    acc = Op::mul(acc, vcoef);                               \
+                }                                                            \
+                Op::store(dst + c, acc);                                     \
+            }                                                                \
+            for (; c < c1; ++c) {                                            \
+                float res = SOp::init();                                     \
+                const src_ctype* sptr = src + c;                             \
+                for (size_t b = 0; b < B; ++b) {                             \
+                    res = SOp::feed(res, static_cast<float>(*sptr));         \
+                    sptr += C;                                               \
+                }                                                            \
+                if (mode == Mode::MEAN) {                                    \
+                    res *= coef;                                             \
+                }                                                            \
+                dst[c] = static_cast<dst_ctype>(res);                        \
+            }                                                                \
+        }                                                                    \
+    };
+
+REDUCE_KERN(SIMDType::AVX2, "avx2,fma,f16c")
+REDUCE_KERN(SIMDType::AVX512, "avx512f")
+#undef REDUCE_KERN
+
+template <SIMDType simd_type, Mode mode, typename src_ctype,
+          typename dst_ctype>
+bool dispatch_reduce(naive::HandleImpl* handle, const TensorND& src,
+                     const TensorND& dst, size_t A, size_t B, size_t C) {
+    using Kern = ReduceKern<simd_type, mode, src_ctype, dst_ctype>;
+    MIDOUT_BEGIN(megdnn_x86_reduce, src_ctype, dst_ctype, midout_iv(simd_type),
+                 midout_iv(mode)) {
+        auto sptr = static_cast<const src_ctype*>(src.raw_ptr);
+        auto dptr = static_cast<dst_ctype*>(dst.raw_ptr);
+        if (C == 1) {
+            size_t rows_per_task = std::max<size_t>(1, TASK_ELEMS / B);
+            auto run = [=](size_t index, size_t) {
+                size_t a0 = index * rows_per_task;
+                Kern::run_c1(sptr, dptr, a0, std::min(A, a0 + rows_per_task),
+                             B);
+            };
+            MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(
+                    handle, div_ceil(A, rows_per_task), run);
+        } else {
+            //! split C into blocks of whole unrolled vectors
+            size_t c_block = round_up<size_t>(
+                    std::max<size_t>(1, TASK_ELEMS / B), 64);
+            size_t nr_c_blocks = div_ceil(C, c_block);
+            auto run = [=](size_t index, size_t) {
+                size_t a = index / nr_c_blocks;
+                size_t c0 = index % nr_c_blocks * c_block;
+                Kern::run(sptr + a * B * C, dptr + a * C, B, C, c0,
+                          std::min(C, c0 + c_block));
+            };
+            MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(handle, A * nr_c_blocks,
+                                                  run);
+        }
+        return true;
+    }
+    MIDOUT_END();
+    return false;
+}
+
+}  // anonymous namespace
+
+bool ReduceImpl::exec_simd(_megdnn_tensor_in src, _megdnn_tensor_out dst) {
+    SIMDType simd_type;
+    if (is_supported(SIMDType::AVX512)) {
+        simd_type = SIMDType::AVX512;
+    } else if (is_supported(SIMDType::AVX2) && is_supported(SIMDType::FMA)) {
+        simd_type = SIMDType::AVX2;
+    } else {
+        return false;
+    }
+    size_t A, B, C;
+    reduce::get_ABC(src.layout, A, B, C, param().axis);
+    auto handle = static_cast<naive::HandleImpl*>(this->handle());
+
+#define DISPATCH_MODE(_simd_type, _src_ctype, _dst_ctype)                   \
+    switch (param().mode) {                                                 \
+        case Mode::SUM:                                                     \
+            return dispatch_reduce<_simd_type, Mode::SUM, _src_ctype,       \
+                                   _dst_ctype>(handle, src, dst, A, B, C);  \
+        case Mode::SUM_SQR:                                                 \
+            return dispatch_reduce<_simd_type, Mode::SUM_SQR, _src_ctype,   \
+                                   _dst_ctype>(handle, src, dst, A, B, C);  \
+        case Mode::PRODUCT:                                                 \
+            return dispatch_reduce<_simd_type, Mode::PRODUCT, _src_ctype,   \
+                                   _dst_ctype>(handle, src, dst, A, B, C);  \
+        case Mode::MIN:                                                     \
+            return dispatch_reduce<_simd_type, Mode::MIN, _src_ctype,       \
+                                   _dst_ctype>(handle, src, dst, A, B, C);  \
+        case Mode::MAX:                                                     \
+            return dispatch_reduce<_simd_type, Mode::MAX, _src_ctype,       \
+                                   _dst_ctype>(handle, src, dst, A, B, C);  \
+        case Mode::MEAN:                                                    \
+            return dispatch_reduce<_simd_type, Mode::MEAN, _src_ctype,      \
+                                   _dst_ctype>(handle, src, dst, A, B, C);  \
+        default:                                                            \
+            return false;                                                   \
+    }
+
+#define DISPATCH_SIMD(_src_dt, _dst_dt)                                  \
+    if (src.layout.dtype.enumv() == DTypeTrait<_src_dt>::enumv &&        \
+        dst.layout.dtype.enumv() == DTypeTrait<_dst_dt>::enumv) {        \
+        using src_ctype = DTypeTrait<_src_dt>::ctype;                    \
+        using dst_ctype = DTypeTrait<_dst_dt>::ctype;                    \
+        if (simd_type == SIMDType::AVX512) {                             \
+            DISPATCH_MODE(SIMDType::AVX512, src_ctype, dst_ctype);       \
+        } else {                                                         \
+            DISPATCH_MODE(SIMDType::AVX2, src_ctype, dst_ctype);         \
+        }                                                                \
+    }
+
+    //! only the combinations computed in float32 are handled here: float32
+    //! with DEFAULT data type, and the float16/int8 inputs and float16
+    //! outputs of FLOAT_O32xC32 and FLOAT_O16xC32
+    DISPATCH_SIMD(dtype::Float32, dtype::Float32);
+    DISPATCH_SIMD(dtype::Int8, dtype::Float32);
+#if !MEGDNN_DISABLE_FLOAT16
+    DISPATCH_SIMD(dtype::Float16, dtype::Float32);
+    if (param().data_type == Param::DataType::FLOAT_O16xC32) {
+        DISPATCH_SIMD(dtype::Float16, dtype::Float16);
+        DISPATCH_SIMD(dtype::Float32, dtype::Float16);
+    }
+#endif
+#undef DISPATCH_SIMD
+#undef DISPATCH_MODE
+    return false;
+}
+
+void ReduceImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_out dst,
+                      _megdnn_workspace workspace) {
+    check_exec(src.layout, dst.layout, workspace.size);
+    if (!exec_simd(src, dst)) {
+        fallback::ReduceImpl::exec(src, dst, workspace);
+    }
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,482 @@
+/**
+ * \file dnn/src/x86/relayout/opr_impl.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "src/x86/relayout/opr_impl.h"
+
+#include <immintrin.h>
+#ifdef WIN32
+#include <avxintrin.h>
+#endif
+#include <algorithm>
+#include <cstring>
+
+#include "src/common/relayout_helper.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+#include "src/x86/utils.h"
+
+#include "midout.h"
+MIDOUT_DECL(megdnn_x86_relayout)
+
+using namespace megdnn;
+using namespace x86;
+using namespace relayout;
+
+namespace {
+
+//! rows of the source matrix handled by one task
+constexpr size_t TASK_ROWS = 64;
+//! columns of a cache tile; TASK_ROWS x TILE_COLS floats take 16KB on each
+//! side, so the dst cache lines are completed before they are evicted
+constexpr size_t TILE_COLS = 64;
+//! minimal number of elements handled by one task
+constexpr size_t TASK_ELEMS = 16384;
+//! minimal number of bytes copied by one task
+constexpr size_t TASK_BYTES = 64 * 1024;
+
+/* ============================ micro kernels ============================ */
+
+/*!
+ * After log2(N) rounds of interleaving row 2i with row 2i+1, register j
+ * holds column bit_reverse(j), so the kernels below store register j to
+ * that column.
+ */
+constexpr size_t BIT_REV_16[16] = {0, 8,  4, 12, 2, 10, 6, 14,
+                                   1, 9,  5, 13, 3, 11, 7, 15};
+constexpr size_t BIT_REV_8[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+#define INTERLEAVE(_n, _w)                                                     \
+    for (size_t i = 0; i < _n / 2; ++i) {                                      \
+        b[i] = _mm_unpacklo_##_w(a[2 * i], a[2 * i + 1]);                      \
+        b[i + _n / 2] = _mm_unpackhi_##_w(a[2 * i], a[2 * i + 1]);             \
+    }                                                                          \
+    std::copy(b, b + _n, a);
+
+void trans_16x16_u8(const uint8_t* src, uint8_t* dst, size_t src_step,
+                    size_t dst_step) {
+    __m128i a[16], b[16];
+    for (size_t i = 0; i < 16; ++i) {
+        a[i] = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + i * src_step));
+    }
+    INTERLEAVE(16, epi8);
+    INTERLEAVE(16, epi16);
+    INTERLEAVE(16, epi32);
+    INTERLEAVE(16, epi64);
+    for (size_t i = 0; i < 16; ++i) {
+        _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(dst + BIT_REV_16[i] * dst_step),
+                a[i]);
+    }
+}
+
+void trans_8x8_u16(const uint16_t* src, uint16_t* dst, size_t src_step,
+                   size_t dst_step) {
+    __m128i a[8], b[8];
+    for (size_t i = 0; i < 8; ++i) {
+        a[i] = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + i * src_step));
+    }
+    INTERLEAVE(8, epi16);
+    INTERLEAVE(8, epi32);
+    INTERLEAVE(8, epi64);
+    for (size_t i = 0; i < 8; ++i) {
+        _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(dst + BIT_REV_8[i] * dst_step),
+                a[i]);
+    }
+}
+#undef INTERLEAVE
+
+//! transpose 4 rows of 16 bytes, used for NCHW -> NCHW4 of int8
+void trans_4x16_u8(const uint8_t* src, uint8_t* dst, size_t src_step,
+                   size_t dst_step) {
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i a1 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + src_step));
+    __m128i a2 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + 2 * src_step));
+    __m128i a3 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + 3 * src_step));
+    __m128i lo01 = _mm_unpacklo_epi8(a0, a1), hi01 = _mm_unpackhi_epi8(a0, a1);
+    __m128i lo23 = _mm_unpacklo_epi8(a2, a3), hi23 = _mm_unpackhi_epi8(a2, a3);
+    //! each 32-bit lane of c[q] is row 4q + lane of dst
+    __m128i c[4] = {_mm_unpacklo_epi16(lo01, lo23),
+                    _mm_unpackhi_epi16(lo01, lo23),
+                    _mm_unpacklo_epi16(hi01, hi23),
+                    _mm_unpackhi_epi16(hi01, hi23)};
+    if (dst_step == 4) {
+        for (size_t q = 0; q < 4; ++q) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + q * 16), c[q]);
+        }
+    } else {
+        for (size_t q = 0; q < 4; ++q) {
+            alignas(16) int32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), c[q]);
+            for (size_t l = 0; l < 4; ++l) {
+                memcpy(dst + (q * 4 + l) * dst_step, lanes + l, 4);
+            }
+        }
+    }
+}
+
+void trans_4x4_u32(const uint32_t* src, uint32_t* dst, size_t src_step,
+                   size_t dst_step) {
+    auto sptr = reinterpret_cast<const float*>(src);
+    auto dptr = reinterpret_cast<float*>(dst);
+    __m128 r0 = _mm_loadu_ps(sptr), r1 = _mm_loadu_ps(sptr + src_step),
+           r2 = _mm_loadu_ps(sptr + 2 * src_step),
+           r3 = _mm_loadu_ps(sptr + 3 * src_step);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(dptr, r0);
+    _mm_storeu_ps(dptr + dst_step, r1);
+    _mm_storeu_ps(dptr + 2 * dst_step, r2);
+    _mm_storeu_ps(dptr + 3 * dst_step, r3);
+}
+
+//! 4-byte elements are moved through float registers, which keeps every bit
+MEGDNN_ATTRIBUTE_TARGET("avx")
+void trans_8x8_u32_avx(const uint32_t* src, uint32_t* dst, size_t src_step,
+                       size_t dst_step) {
+    auto sptr = reinterpret_cast<const float*>(src);
+    auto dptr = reinterpret_cast<float*>(dst);
+    __m256 r[8], t[8];
+    for (size_t i = 0; i < 8; ++i) {
+        r[i] = _mm256_loadu_ps(sptr + i * src_step);
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        t[2 * i] = _mm256_unpacklo_ps(r[2 * i], r[2 * i + 1]);
+        t[2 * i + 1] = _mm256_unpackhi_ps(r[2 * i], r[2 * i + 1]);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        r[4 * i] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2],
+                                     _MM_SHUFFLE(1, 0, 1, 0));
+        r[4 * i + 1] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2],
+                                         _MM_SHUFFLE(3, 2, 3, 2));
+        r[4 * i + 2] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3],
+                                         _MM_SHUFFLE(1, 0, 1, 0));
+        r[4 * i + 3] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3],
+                                         _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        _mm256_storeu_ps(dptr + i * dst_step,
+                         _mm256_permute2f128_ps(r[i], r[i + 4], 0x20));
+        _mm256_storeu_ps(dptr + (i + 4) * dst_step,
+                         _mm256_permute2f128_ps(r[i], r[i + 4], 0x31));
+    }
+}
+
+void trans_8x8_u32_sse(const uint32_t* src, uint32_t* dst, size_t src_step,
+                       size_t dst_step) {
+    for (size_t i = 0; i < 8; i += 4) {
+        for (size_t j = 0; j < 8; j += 4) {
+            trans_4x4_u32(src + i * src_step + j, dst + j * dst_step + i,
+                          src_step, dst_step);
+        }
+    }
+}
+
+/* ============================ blocked driver ============================ */
+
+/*!
+ * \brief block kernels of each element size
+ *
+ * kern() transposes a full block_size x block_size block, and partial()
+ * handles the h x w (h, w <= block_size) blocks on the border.
+ */
+template <typename T>
+struct TransposeKern;
+
+template <>
+struct TransposeKern<uint8_t> {
+    static constexpr size_t block_size = 16;
+    static void kern(const uint8_t* src, uint8_t* dst, size_t src_step,
+                     size_t dst_step) {
+        trans_16x16_u8(src, dst, src_step, dst_step);
+    }
+    static void partial(const uint8_t* src, uint8_t* dst, size_t src_step,
+                        size_t dst_step, size_t h, size_t w) {
+        size_t h4 = h & ~size_t(3);
+        if (w == block_size && h4) {
+            for (size_t i = 0; i < h4; i += 4) {
+                trans_4x16_u8(src + i * src_step, dst + i, src_step,
+                              dst_step);
+            }
+            src += h4 * src_step;
+            dst += h4;
+            h -= h4;
+        }
+        if (h) {
+            transpose_fallback::transpose_block_fallback(
+                    src, dst, src_step, dst_step, h, w);
+        }
+    }
+};
+
+template <>
+struct TransposeKern<uint16_t> {
+    static constexpr size_t block_size = 8;
+    static void kern(const uint16_t* src, uint16_t* dst, size_t src_step,
+                     size_t dst_step) {
+        trans_8x8_u16(src, dst, src_step, dst_step);
+    }
+    static void partial(const uint16_t* src, uint16_t* dst, size_t src_step,
+                        size_t dst_step, size_t h, size_t w) {
+        transpose_fallback::transpose_block_fallback(src, dst, src_step,
+                                                     dst_step, h, w);
+    }
+};
+
+template <>
+struct TransposeKern<uint32_t> {
+    static constexpr size_t block_size = 8;
+    static void kern(const uint32_t* src, uint32_t* dst, size_t src_step,
+                     size_t dst_step) {
+        if (is_supported(SIMDType::AVX)) {
+            trans_8x8_u32_avx(src, dst, src_step, dst_step);
+        } else {
+            trans_8x8_u32_sse(src, dst, src_step, dst_step);
+        }
+    }
+    //! NCHW <-> NCHW4 of float gives blocks of 4 rows or columns, which are
+    //! covered by 4x4 kernels
+    static void partial(const uint32_t* src, uint32_t* dst, size_t src_step,
+                        size_t dst_step, size_t h, size_t w) {
+        size_t h4 = h & ~size_t(3), w4 = w & ~size_t(3);
+        for (size_t i = 0; i < h4; i += 4) {
+            for (size_t j = 0; j < w4; j += 4) {
+                trans_4x4_u32(src + i * src_step + j, dst + j * dst_step + i,
+                              src_step, dst_step);
+            }
+        }
+        if (w4 < w) {
+            transpose_fallback::transpose_block_fallback(
+                    src + w4, dst + w4 * dst_step, src_step, dst_step, h,
+                    w - w4);
+        }
+        if (h4 < h && w4) {
+            transpose_fallback::transpose_block_fallback(
+                    src + h4 * src_step, dst + h4, src_step, dst_step, h - h4,
+                    w4);
+        }
+    }
+};
+
+/*!
+ * \brief transpose rows [i0, i1) of a m x n matrix into the n x m dst
+ *
+ * The columns are walked in tiles of TILE_COLS, and all the rows of the
+ * task are finished inside a tile before moving to the next one.
+ */
+template <typename T>
+void transpose_rows(const T* src, T* dst, size_t m, size_t n, size_t i0,
+                    size_t i1) {
+    using Kern = TransposeKern<T>;
+    constexpr size_t B = Kern::block_size;
+    for (size_t j0 = 0; j0 < n; j0 += TILE_COLS) {
+        size_t j1 = std::min(n, j0 + TILE_COLS);
+        for (size_t i = i0; i < i1; i += B) {
+            size_t h = std::min(B, i1 - i);
+            for (size_t j = j0; j < j1; j += B) {
+                size_t w = std::min(B, j1 - j);
+                auto sptr = src + i * n + j;
+                auto dptr = dst + j * m + i;
+                if (h == B && w == B) {
+                    Kern::kern(sptr, dptr, n, m);
+                } else {
+                    Kern::partial(sptr, dptr, n, m, h, w);
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void dispatch_transpose(naive::HandleImpl* handle, const TransposeParam& p,
+                        const void* src, void* dst) {
+    auto sptr = static_cast<const T*>(src);
+    auto dptr = static_cast<T*>(dst);
+    size_t batch = p.batch, m = p.m, n = p.n;
+    size_t mat_size = m * n;
+    if (mat_size >= TASK_ELEMS) {
+        //! split each matrix into strips of rows
+        size_t nr_strips = div_ceil(m, TASK_ROWS);
+        auto run = [=](size_t index, size_t) {
+            size_t b = index / nr_strips;
+            size_t i0 = index % nr_strips * TASK_ROWS;
+            transpose_rows(sptr + b * mat_size, dptr + b * mat_size, m, n,
+                           i0, std::min(m, i0 + TASK_ROWS));
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(handle, batch * nr_strips, run);
+    } else {
+        //! small matrices, such as NCHW -> NCHW4 with small HW: put several
+        //! whole matrices into one task
+        size_t batch_per_task = std::max<size_t>(1, TASK_ELEMS / mat_size);
+        auto run = [=](size_t index, size_t) {
+            size_t b0 = index * batch_per_task;
+            size_t b1 = std::min(batch, b0 + batch_per_task);
+            for (size_t b = b0; b < b1; ++b) {
+                transpose_rows(sptr + b * mat_size, dptr + b * mat_size, m, n,
+                               0, m);
+            }
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(
+                handle, div_ceil(batch, batch_per_task), run);
+    }
+}
+
+/* ============================== copy driver ============================== */
+
+/*!
+ * \brief iterate the contiguous runs of the last dim of a layout
+ *
+ * The offsets of run \p begin are computed once by decomposing the index;
+ * later runs are reached by carrying through the shape.
+ */
+struct RunIter {
+    size_t ndim;
+    size_t shape[TensorLayout::MAX_NDIM], idx[TensorLayout::MAX_NDIM];
+    ptrdiff_t stride[TensorLayout::MAX_NDIM];
+    ptrdiff_t offset;
+
+    RunIter(const TensorLayout& layout, size_t begin)
+            : ndim(layout.ndim - 1), offset(0) {
+        for (size_t i = ndim; i--;) {
+            shape[i] = layout.shape[i];
+            stride[i] = layout.stride[i] * layout.dtype.size();
+            idx[i] = begin % shape[i];
+            begin /= shape[i];
+            offset += idx[i] * stride[i];
+        }
+    }
+
+    void next() {
+        for (size_t i = ndim; i--;) {
+            offset += stride[i];
+            if (++idx[i] < shape[i])
+                return;
+            offset -= stride[i] * shape[i];
+            idx[i] = 0;
+        }
+    }
+};
+
+}  // anonymous namespace
+
+bool RelayoutForwardImpl::exec_transpose(const TensorND& src,
+                                         const TensorND& dst,
+                                         const TransposeParam& param) {
+    auto dsize = src.layout.dtype.size() * param.c;
+    auto addr = reinterpret_cast<uintptr_t>(src.raw_ptr) |
+                reinterpret_cast<uintptr_t>(dst.raw_ptr);
+    auto handle = static_cast<naive::HandleImpl*>(this->handle());
+    if (dsize == 1) {
+        MIDOUT_BEGIN(megdnn_x86_relayout, midout_iv(0)) {
+            dispatch_transpose<uint8_t>(handle, param, src.raw_ptr,
+                                        dst.raw_ptr);
+            return true;
+        }
+        MIDOUT_END();
+    } else if (dsize == 2 && !(addr & (alignof(uint16_t) - 1))) {
+        MIDOUT_BEGIN(megdnn_x86_relayout, midout_iv(1)) {
+            dispatch_transpose<uint16_t>(handle, param, src.raw_ptr,
+                                         dst.raw_ptr);
+            return true;
+        }
+        MIDOUT_END();
+    } else if (dsize == 4 && !(addr & (alignof(uint32_t) - 1))) {
+        MIDOUT_BEGIN(megdnn_x86_relayout, midout_iv(2)) {
+            dispatch_transpose<uint32_t>(handle, param, src.raw_ptr,
+                                         dst.raw_ptr);
+            return true;
+        }
+        MIDOUT_END();
+    }
+    return false;
+}
+
+bool RelayoutForwardImpl::exec_copy(const TensorND& src, const TensorND& dst) {
+    auto handle = static_cast<naive::HandleImpl*>(this->handle());
+    auto sptr = static_cast<const uint8_t*>(src.raw_ptr);
+    auto dptr = static_cast<uint8_t*>(dst.raw_ptr);
+    size_t dsize = src.layout.dtype.size();
+
+    if (is_contig(src.layout) && is_contig(dst.layout)) {
+        size_t size = src.layout.total_nr_elems() * dsize;
+        size_t nr_tasks = div_ceil(size, TASK_BYTES);
+        auto run = [=](size_t index, size_t) {
+            size_t begin = index * TASK_BYTES;
+            memcpy(dptr + begin, sptr + begin,
+                   std::min(TASK_BYTES, size - begin));
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(handle, nr_tasks, run);
+        return true;
+    }
+
+    //! one side contiguous and the last dim of the other side contiguous:
+    //! copy the runs of the last dim with memcpy
+    bool src_cont = is_contig(src.layout);
+    const TensorLayout& nonc =
+            src_cont ? dst.layout : src.layout;
+    if (!(src_cont || is_contig(dst.layout)) || nonc.stride[nonc.ndim - 1] != 1)
+        return false;
+    for (size_t i = 0; i < nonc.ndim; ++i) {
+        if (nonc.stride[i] < 0)
+            return false;
+    }
+    size_t run_bytes = nonc.shape[nonc.ndim - 1] * dsize;
+    size_t nr_runs = nonc.total_nr_elems() / nonc.shape[nonc.ndim - 1];
+    size_t runs_per_task = std::max<size_t>(1, TASK_BYTES / run_bytes);
+    auto run = [=](size_t index, size_t) {
+        size_t begin = index * runs_per_task;
+        size_t end = std::min(nr_runs, begin + runs_per_task);
+        RunIter iter(nonc, begin);
+        for (size_t r = begin; r < end; ++r, iter.next()) {
+            if (src_cont) {
+                memcpy(dptr + iter.offset, sptr + r * run_bytes, run_bytes);
+            } else {
+                memcpy(dptr + r * run_bytes, sptr + iter.offset, run_bytes);
+            }
+        }
+    };
+    MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(
+            handle, div_ceil(nr_runs, runs_per_task), run);
+    return true;
+}
+
+void RelayoutForwardImpl::exec(_megdnn_tensor_in src0, _megdnn_tensor_out dst0,
+                               Handle* src_handle) {
+    check_cpu_handle(src_handle);
+    TensorND src = src0, dst = dst0;
+    check_layout_and_canonize(src.layout, dst.layout);
+
+    //! low-bit dtypes and negative strides are left to the fallback
+    bool simple_layout = src.layout.dtype.enumv() != DTypeEnum::QuantizedS4 &&
+                         src.layout.dtype.enumv() != DTypeEnum::Quantized4Asymm;
+    for (size_t i = 0; i < src.layout.ndim; ++i) {
+        simple_layout &= src.layout.stride[i] >= 0;
+    }
+    for (size_t i = 0; i < dst.layout.ndim; ++i) {
+        simple_layout &= dst.layout.stride[i] >= 0;
+    }
+    if (!simple_layout) {
+        fallback::RelayoutForwardImpl::exec(src0, dst0, src_handle);
+        return;
+    }
+
+    TransposeParam trans_param;
+    bool trans = is_transpose(src.layout, dst.layout, trans_param);
+    if (trans ? exec_transpose(src, dst, trans_param) : exec_copy(src, dst))
+        return;
+    exec_after_preprocess(src, dst, trans ? &trans_param : nullptr);
+}
+
+// vim: syntax=cpp.doxygen
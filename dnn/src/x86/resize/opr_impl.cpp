@@ -33,6 +33,10 @@ using namespace x86;
 void ResizeImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_in dst,
                       _megdnn_workspace workspace) {
     check_exec(src.layout, dst.layout, workspace.size);
+    if (is_avx2_usable(src.layout, dst.layout)) {
+        exec_avx2(src, dst);
+        return;
+    }
     if (param().format == param::Resize::Format::NCHW ||
         (src.layout[3] != 1 && src.layout[3] != 3) ||
         !is_supported(SIMDType::SSE4_2) || !is_nhwc_contig_wc(src.layout)) {
@@ -40,7 +44,20 @@ void ResizeImpl::exec(_megdnn_tensor_in src, _megdnn_tensor_in dst,
     } else {
         megdnn_assert(param().format == param::Resize::Format::NHWC,
                       "invalid resize format");
-        MEGDNN_DISPATCH_CPU_KERN_OPR(resize_cv_exec(src, dst, param().imode));
+        // the images are resized in parallel
+        auto imode = param().imode;
+        auto kern = [src, dst, imode](size_t index, size_t) {
+            TensorND src_img = src, dst_img = dst;
+            src_img.layout.shape[0] = dst_img.layout.shape[0] = 1;
+            src_img.raw_ptr = static_cast<dt_byte*>(src.raw_ptr) +
+                              index * src.layout.stride[0] *
+                                      src.layout.dtype.size();
+            dst_img.raw_ptr = static_cast<dt_byte*>(dst.raw_ptr) +
+                              index * dst.layout.stride[0] *
+                                      dst.layout.dtype.size();
+            resize_cv_exec(src_img, dst_img, imode);
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN_OPR(kern, src.layout.shape[0]);
     }
 }
 
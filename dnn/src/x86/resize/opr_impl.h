@@ -26,6 +26,14 @@ public:
                                   const TensorLayout&) override {
         return 0;
     }
+
+private:
+    //! whether exec_avx2 handles the resize with the same result as the
+    //! other paths
+    bool is_avx2_usable(const TensorLayout& src, const TensorLayout& dst);
+
+    //! separable resize by AVX2 kernels in blocks of dst rows on all threads
+    void exec_avx2(_megdnn_tensor_in src, _megdnn_tensor_out dst);
 };
 
 }  // namespace x86
@@ -0,0 +1,436 @@
+/**
+ * \file dnn/src/x86/resize/resize_avx2.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "src/x86/resize/opr_impl.h"
+#include "src/common/utils.h"
+#include "src/naive/handle.h"
+#include "src/x86/utils.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+using namespace megdnn;
+using namespace x86;
+
+namespace {
+
+using IMode = param::Resize::InterpolationMode;
+using Format = param::Resize::Format;
+
+//! number of tasks of each thread, to balance the load between threads
+constexpr size_t TASKS_PER_THREAD = 4;
+
+/*!
+ * \brief interpolation taps along an axis
+ *
+ * Tap k of dst coord i reads src coord ofs[k * size + i] with weight
+ * coef[k * size + i]. Dst coords with fewer taps are padded by zero weights.
+ */
+struct AxisTab {
+    size_t size = 0, ksize = 0;
+    std::vector<int> ofs;
+    std::vector<float> coef;
+
+    void init(size_t size_, size_t ksize_) {
+        size = size_;
+        ksize = ksize_;
+        ofs.assign(size * ksize, 0);
+        coef.assign(size * ksize, 0.f);
+    }
+
+    void set(size_t i, size_t k, int src, float weight) {
+        ofs[k * size + i] = src;
+        coef[k * size + i] = weight;
+    }
+};
+
+int clamp(int x, int size) {
+    return std::min(std::max(x, 0), size - 1);
+}
+
+//! bicubic taps in the same way as resize_cv.cpp
+void build_cubic(AxisTab& tab, int ssize, int dsize) {
+    constexpr float A = -0.75f;
+    double scale = 1.0 / (static_cast<double>(dsize) / ssize);
+    tab.init(dsize, 4);
+    for (int i = 0; i < dsize; ++i) {
+        float fx = static_cast<float>((i + 0.5) * scale - 0.5);
+        int sx = static_cast<int>(std::floor(fx));
+        fx -= sx;
+        float c[4];
+        c[0] = ((A * (fx + 1) - 5 * A) * (fx + 1) + 8 * A) * (fx + 1) - 4 * A;
+        c[1] = ((A + 2) * fx - (A + 3)) * fx * fx + 1;
+        c[2] = ((A + 2) * (1 - fx) - (A + 3)) * (1 - fx) * (1 - fx) + 1;
+        c[3] = 1.f - c[0] - c[1] - c[2];
+        for (int k = 0; k < 4; ++k) {
+            tab.set(i, k, clamp(sx - 1 + k, ssize), c[k]);
+        }
+    }
+}
+
+//! area taps when downsampling, in the same way as resize_cv.cpp
+void build_area(AxisTab& tab, int ssize, int dsize) {
+    double scale = static_cast<double>(ssize) / dsize;
+    std::vector<std::vector<std::pair<int, float>>> taps(dsize);
+    size_t ksize = 1;
+    for (int i = 0; i < dsize; ++i) {
+        double fsx1 = i * scale, fsx2 = fsx1 + scale,
+               cell_width = std::min(scale, ssize - fsx1);
+        int sx1 = static_cast<int>(std::ceil(fsx1)),
+            sx2 = static_cast<int>(std::floor(fsx2));
+        sx2 = std::min(sx2, ssize - 1);
+        sx1 = std::min(sx1, sx2);
+        auto&& cur = taps[i];
+        if (sx1 - fsx1 > 1e-3) {
+            cur.emplace_back(sx1 - 1,
+                             static_cast<float>((sx1 - fsx1) / cell_width));
+        }
+        for (int sx = sx1; sx < sx2; ++sx) {
+            cur.emplace_back(sx, static_cast<float>(1.0 / cell_width));
+        }
+        if (fsx2 - sx2 > 1e-3) {
+            double width = std::min(std::min(fsx2 - sx2, 1.), cell_width);
+            cur.emplace_back(sx2, static_cast<float>(width / cell_width));
+        }
+        megdnn_assert(!cur.empty());
+        ksize = std::max(ksize, cur.size());
+    }
+    tab.init(dsize, ksize);
+    for (int i = 0; i < dsize; ++i) {
+        auto&& cur = taps[i];
+        for (size_t k = 0; k < ksize; ++k) {
+            if (k < cur.size()) {
+                tab.set(i, k, cur[k].first, cur[k].second);
+            } else {
+                tab.set(i, k, cur.back().first, 0.f);
+            }
+        }
+    }
+}
+
+//! linear taps of area mode when upsampling, as in resize_cv.cpp
+void build_area_linear(AxisTab& tab, int ssize, int dsize) {
+    double inv_scale = static_cast<double>(dsize) / ssize,
+           scale = 1.0 / inv_scale;
+    tab.init(dsize, 2);
+    for (int i = 0; i < dsize; ++i) {
+        int sx = static_cast<int>(std::floor(i * scale));
+        float fx = static_cast<float>((i + 1) - (sx + 1) * inv_scale);
+        fx = fx <= 0 ? 0.f : fx - std::floor(fx);
+        tab.set(i, 0, clamp(sx, ssize), 1.f - fx);
+        tab.set(i, 1, clamp(sx + 1, ssize), fx);
+    }
+}
+
+//! everything shared by the tasks of a resize
+struct Plan {
+    AxisTab tab_h, tab_w;
+    //! taps of tab_w over the elements of a row with \p cn channels
+    std::vector<int> elem_ofs;
+    std::vector<float> elem_coef;
+    //! an NCHW image has C planes of one channel, and an NHWC image has one
+    //! plane of C channels
+    size_t nr_planes, planes_per_img, cn, IH, IW, OH, OW;
+    size_t rows_per_task, tasks_per_plane;
+    //! src strides of image, plane, row and element
+    ptrdiff_t s_n, s_c, s_h, s_w;
+
+    void init_elem_tab() {
+        size_t width = OW * cn, ksize = tab_w.ksize;
+        elem_ofs.resize(width * ksize);
+        elem_coef.resize(width * ksize);
+        for (size_t k = 0; k < ksize; ++k) {
+            for (size_t x = 0; x < OW; ++x) {
+                for (size_t c = 0; c < cn; ++c) {
+                    size_t src = k * OW + x, dst = k * width + x * cn + c;
+                    elem_ofs[dst] = tab_w.ofs[src] * cn + c;
+                    elem_coef[dst] = tab_w.coef[src];
+                }
+            }
+        }
+    }
+};
+
+MEGDNN_ATTRIBUTE_TARGET("avx2")
+void hresize(const float* src, float* dst, const int* ofs, const float* coef,
+             size_t ksize, size_t width) {
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t k = 0; k < ksize; ++k) {
+            __m256i idx = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(ofs + k * width + x));
+            __m256 val = _mm256_i32gather_ps(src, idx, 4);
+            sum = _mm256_add_ps(
+                    sum,
+                    _mm256_mul_ps(val, _mm256_loadu_ps(coef + k * width + x)));
+        }
+        _mm256_storeu_ps(dst + x, sum);
+    }
+    for (; x < width; ++x) {
+        float sum = 0;
+        for (size_t k = 0; k < ksize; ++k) {
+            sum += src[ofs[k * width + x]] * coef[k * width + x];
+        }
+        dst[x] = sum;
+    }
+}
+
+MEGDNN_ATTRIBUTE_TARGET("avx2")
+void vresize(const float* const* rows, const float* coef, size_t ksize,
+             float* dst, size_t width) {
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t k = 0; k < ksize; ++k) {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + x),
+                                                   _mm256_set1_ps(coef[k])));
+        }
+        _mm256_storeu_ps(dst + x, sum);
+    }
+    for (; x < width; ++x) {
+        float sum = 0;
+        for (size_t k = 0; k < ksize; ++k) {
+            sum += rows[k][x] * coef[k];
+        }
+        dst[x] = sum;
+    }
+}
+
+//! load a row as contiguous floats, converting into \p buf if needed
+MEGDNN_ATTRIBUTE_TARGET("avx2")
+const float* load_row(const float* src, ptrdiff_t stride, size_t width,
+                      float* buf) {
+    if (stride == 1) {
+        return src;
+    }
+    for (size_t x = 0; x < width; ++x) {
+        buf[x] = src[x * stride];
+    }
+    return buf;
+}
+
+MEGDNN_ATTRIBUTE_TARGET("avx2")
+const float* load_row(const uint8_t* src, ptrdiff_t stride, size_t width,
+                      float* buf) {
+    size_t x = 0;
+    if (stride == 1) {
+        for (; x + 8 <= width; x += 8) {
+            __m128i val = _mm_loadl_epi64(
+                    reinterpret_cast<const __m128i*>(src + x));
+            _mm256_storeu_ps(buf + x,
+                             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(val)));
+        }
+    }
+    for (; x < width; ++x) {
+        buf[x] = src[x * stride];
+    }
+    return buf;
+}
+
+void store_row(const float* src, float* dst, size_t width) {
+    if (src != dst) {
+        memcpy(dst, src, width * sizeof(float));
+    }
+}
+
+//! round half away from zero as RoundingConverter<uint8_t>
+MEGDNN_ATTRIBUTE_TARGET("avx2")
+void store_row(const float* src, uint8_t* dst, size_t width) {
+    size_t x = 0;
+    __m256 half = _mm256_set1_ps(0.5f), lo = _mm256_setzero_ps(),
+           hi = _mm256_set1_ps(255.f);
+    for (; x + 8 <= width; x += 8) {
+        __m256 val = _mm256_floor_ps(
+                _mm256_add_ps(_mm256_loadu_ps(src + x), half));
+        __m256i ival = _mm256_cvttps_epi32(
+                _mm256_min_ps(_mm256_max_ps(val, lo), hi));
+        __m128i i16 = _mm_packus_epi32(_mm256_castsi256_si128(ival),
+                                       _mm256_extracti128_si256(ival, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x),
+                         _mm_packus_epi16(i16, i16));
+    }
+    for (; x < width; ++x) {
+        dst[x] = static_cast<uint8_t>(
+                std::min(std::max(std::floor(src[x] + 0.5f), 0.f), 255.f));
+    }
+}
+
+/*!
+ * \brief compute dst rows [dy_begin, dy_end) of a plane
+ *
+ * The horizontally interpolated src rows are kept in tab_h.ksize slots and
+ * reused by the following dst rows.
+ */
+template <typename ctype>
+void resize_rows(const Plan& plan, const ctype* src, ctype* dst,
+                 size_t dy_begin, size_t dy_end) {
+    size_t ksize = plan.tab_h.ksize, src_width = plan.IW * plan.cn,
+           width = plan.OW * plan.cn;
+    std::vector<float> buf(width * (ksize + 1) + src_width);
+    float* out_buf = buf.data() + width * ksize;
+    float* src_buf = out_buf + width;
+    std::vector<int> slot_sy(ksize, -1);
+    std::vector<bool> slot_used(ksize);
+    std::vector<const float*> rows(ksize);
+    std::vector<float> coef(ksize);
+    for (size_t dy = dy_begin; dy < dy_end; ++dy) {
+        std::fill(slot_used.begin(), slot_used.end(), false);
+        for (size_t k = 0; k < ksize; ++k) {
+            int sy = plan.tab_h.ofs[k * plan.OH + dy];
+            coef[k] = plan.tab_h.coef[k * plan.OH + dy];
+            size_t slot = std::find(slot_sy.begin(), slot_sy.end(), sy) -
+                          slot_sy.begin();
+            if (slot == ksize) {
+                // evict the topmost row not used by current dst row
+                for (size_t i = 0; i < ksize; ++i) {
+                    if (!slot_used[i] &&
+                        (slot == ksize || slot_sy[i] < slot_sy[slot])) {
+                        slot = i;
+                    }
+                }
+                auto row = load_row(src + sy * plan.s_h, plan.s_w,
+                                    src_width, src_buf);
+                hresize(row, buf.data() + slot * width, plan.elem_ofs.data(),
+                        plan.elem_coef.data(), plan.tab_w.ksize, width);
+                slot_sy[slot] = sy;
+            }
+            slot_used[slot] = true;
+            rows[k] = buf.data() + slot * width;
+        }
+        float* out = std::is_same<ctype, float>::value
+                             ? reinterpret_cast<float*>(dst + dy * width)
+                             : out_buf;
+        vresize(rows.data(), coef.data(), ksize, out, width);
+        store_row(out, dst + dy * width, width);
+    }
+}
+
+template <typename ctype>
+void run_task(const Plan& plan, const void* sptr, void* dptr, size_t index) {
+    size_t plane = index / plan.tasks_per_plane,
+           blk = index % plan.tasks_per_plane,
+           dy_begin = blk * plan.rows_per_task,
+           dy_end = std::min(dy_begin + plan.rows_per_task, plan.OH);
+    auto src = static_cast<const ctype*>(sptr) +
+               plane / plan.planes_per_img * plan.s_n +
+               plane % plan.planes_per_img * plan.s_c;
+    auto dst = static_cast<ctype*>(dptr) + plane * plan.OH * plan.OW * plan.cn;
+    resize_rows(plan, src, dst, dy_begin, dy_end);
+}
+
+}  // anonymous namespace
+
+bool ResizeImpl::is_avx2_usable(const TensorLayout& src,
+                                const TensorLayout& dst) {
+    if (!is_supported(SIMDType::AVX2) || !dst.is_contiguous()) {
+        return false;
+    }
+    auto dtype = src.dtype.enumv();
+    if (dtype != DTypeEnum::Float32 && dtype != DTypeEnum::Uint8 &&
+        dtype != DTypeEnum::Quantized8Asymm) {
+        return false;
+    }
+    auto imode = param().imode;
+    if (param().format == Format::NCHW) {
+        // the other modes are left to the generic path
+        return imode == IMode::INTER_LINEAR;
+    }
+    if (param().format != Format::NHWC || !is_nhwc_contig_wc(src)) {
+        return false;
+    }
+    if (src[3] != 1 && src[3] != 3) {
+        return imode == IMode::INTER_LINEAR;
+    }
+    // keep resize_cv.cpp for the fixed-point uint8 kernels
+    return dtype == DTypeEnum::Float32 &&
+           (imode == IMode::INTER_LINEAR || imode == IMode::INTER_CUBIC ||
+            imode == IMode::INTER_AREA);
+}
+
+void ResizeImpl::exec_avx2(_megdnn_tensor_in src, _megdnn_tensor_out dst) {
+    auto plan = std::make_shared<Plan>();
+    bool nchw = param().format == Format::NCHW;
+    auto&& sl = src.layout;
+    size_t C = nchw ? sl[1] : sl[3];
+    plan->IH = nchw ? sl[2] : sl[1];
+    plan->IW = nchw ? sl[3] : sl[2];
+    plan->OH = nchw ? dst.layout[2] : dst.layout[1];
+    plan->OW = nchw ? dst.layout[3] : dst.layout[2];
+    plan->s_n = sl.stride[0];
+    plan->s_c = nchw ? sl.stride[1] : 0;
+    plan->s_h = nchw ? sl.stride[2] : sl.stride[1];
+    plan->s_w = nchw ? sl.stride[3] : 1;
+    plan->planes_per_img = nchw ? C : 1;
+    plan->nr_planes = sl[0] * plan->planes_per_img;
+    plan->cn = nchw ? 1 : C;
+
+    int IH = plan->IH, IW = plan->IW, OH = plan->OH, OW = plan->OW;
+    auto imode = param().imode;
+    if (imode == IMode::INTER_CUBIC) {
+        build_cubic(plan->tab_h, IH, OH);
+        build_cubic(plan->tab_w, IW, OW);
+    } else if (imode == IMode::INTER_AREA) {
+        if (IH >= OH && IW >= OW) {
+            build_area(plan->tab_h, IH, OH);
+            build_area(plan->tab_w, IW, OW);
+        } else {
+            build_area_linear(plan->tab_h, IH, OH);
+            build_area_linear(plan->tab_w, IW, OW);
+        }
+    } else {
+        megdnn_assert(imode == IMode::INTER_LINEAR);
+        auto build_linear = [this](AxisTab& tab, int ssize, int dsize) {
+            float scale = static_cast<float>(dsize) / ssize;
+            tab.init(dsize, 2);
+            for (int i = 0; i < dsize; ++i) {
+                auto coord = get_origin_coord(scale, ssize, i);
+                tab.set(i, 0, clamp(coord.second, ssize), 1.f - coord.first);
+                tab.set(i, 1, clamp(coord.second + 1, ssize), coord.first);
+            }
+        };
+        build_linear(plan->tab_h, IH, OH);
+        build_linear(plan->tab_w, IW, OW);
+    }
+    plan->init_elem_tab();
+
+    auto handle = static_cast<naive::HandleImpl*>(this->handle());
+    size_t nr_threads = handle->megcore_dispatcher()->nr_threads(),
+           nr_blk = 1;
+    if (nr_threads > 1) {
+        nr_blk = std::min<size_t>(
+                OH, div_ceil(nr_threads * TASKS_PER_THREAD, plan->nr_planes));
+    }
+    plan->rows_per_task = div_ceil<size_t>(OH, nr_blk);
+    plan->tasks_per_plane = div_ceil<size_t>(OH, plan->rows_per_task);
+    size_t nr_tasks = plan->nr_planes * plan->tasks_per_plane;
+
+    const void* sptr = src.raw_ptr;
+    void* dptr = dst.raw_ptr;
+    if (sl.dtype.enumv() == DTypeEnum::Float32) {
+        auto kern = [plan, sptr, dptr](size_t index, size_t) {
+            run_task<float>(*plan, sptr, dptr, index);
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(handle, nr_tasks, kern);
+    } else {
+        auto kern = [plan, sptr, dptr](size_t index, size_t) {
+            run_task<uint8_t>(*plan, sptr, dptr, index);
+        };
+        MEGDNN_DISPATCH_MULTI_THREAD_CPU_KERN(handle, nr_tasks, kern);
+    }
+}
+
+// vim: syntax=cpp.doxygen
@@ -39,6 +39,8 @@ enum class SIMDType {
     FMA,
     VNNI,
     NONE,
+    //! appended after NONE to keep the values of the older types
+    AVX512,
     __NR_SIMD_TYPE  //! total number of SIMD types; used for testing
 };
 
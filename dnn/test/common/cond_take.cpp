@@ -37,6 +37,12 @@ std::vector<CondTakeTestcase> CondTakeTestcase::make() {
                 TensorLayout{{1024}, dtype::Float32()},
                 TensorLayout{{1024}, dtype::Int32()},
                 });
+        // large enough to be split into blocks by multithreaded impls
+        ret.push_back({
+                Param{static_cast<Param::Mode>(mode), 100},
+                TensorLayout{{100003}, dtype::Float32()},
+                TensorLayout{{100003}, dtype::Int32()},
+                });
     }
 
     NormalRNG data_rng;
@@ -0,0 +1,105 @@
+/**
+ * \file dnn/test/fallback/argsort.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include "test/fallback/fixture.h"
+
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+#include "test/common/rng.h"
+#include "test/common/tensor.h"
+
+using namespace megdnn;
+using namespace test;
+
+namespace {
+//! values with many duplicates, to check that ties are broken by index
+class ArgsortRNG final : public RNG {
+    DType m_dtype;
+    size_t m_nr_distinct;
+
+    template <typename T>
+    void fill(T* ptr, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            ptr[i] = static_cast<T>(static_cast<int>(i % m_nr_distinct) -
+                                    static_cast<int>(m_nr_distinct / 2));
+        COMPAT_RANDOM(ptr, ptr + n);
+    }
+
+    void gen(const TensorND& tensor) override {
+        auto n = tensor.layout.total_nr_elems();
+        if (m_dtype == dtype::Float32{}) {
+            fill(tensor.ptr<dt_float32>(), n);
+        } else {
+            megdnn_assert(m_dtype == dtype::Int32{});
+            fill(tensor.ptr<dt_int32>(), n);
+        }
+    }
+
+public:
+    ArgsortRNG(DType dt, size_t nr_distinct)
+            : m_dtype{dt}, m_nr_distinct{nr_distinct} {}
+};
+
+void run_forward_test(Handle* handle, DType dtype) {
+    Checker<ArgsortForward> checker(handle);
+    using Param = Argsort::Param;
+    using Order = Param::Order;
+    checker.set_dtype(2, dtype::Int32()).set_dtype(0, dtype);
+    for (size_t nr_distinct : {7, 100000}) {
+        ArgsortRNG rng{dtype, nr_distinct};
+        checker.set_rng(0, &rng);
+        // rows shorter than 256 are sorted by comparison, longer by radix
+        for (size_t i = 3; i < 10240; i *= 2) {
+            Param param;
+            param.order = Order::ASCENDING;
+            checker.set_param(param).execs({{3, i + 1}, {}, {}});
+            param.order = Order::DESCENDING;
+            checker.set_param(param).execs({{3, i - 1}, {}, {}});
+            checker.set_param(param).execs({{13, i + 3}, {}, {}});
+        }
+    }
+}
+}  // anonymous namespace
+
+TEST_F(FALLBACK, ARGSORT_FORWARD_F32) {
+    run_forward_test(handle(), dtype::Float32{});
+}
+
+TEST_F(FALLBACK, ARGSORT_FORWARD_I32) {
+    run_forward_test(handle(), dtype::Int32{});
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, ARGSORT_FORWARD_F32) {
+    run_forward_test(handle(), dtype::Float32{});
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK, BENCHMARK_ARGSORT) {
+    auto naive_handle = create_cpu_handle(2);
+    Benchmarker<ArgsortForward> bencher(handle()),
+            bencher_naive(naive_handle.get());
+    constexpr size_t RUN = 10;
+    auto run = [&](size_t m, size_t n) {
+        TensorShape shape{m, n};
+        bencher.set_times(RUN).set_display(false);
+        bencher_naive.set_times(RUN).set_display(false);
+        auto t0 = bencher.execs({shape, {}, {}}) / RUN,
+             t1 = bencher_naive.execs({shape, {}, {}}) / RUN;
+        printf("%s: fallback=%.3fms naive=%.3fms speedup=%.2f\n",
+               shape.to_string().c_str(), t0, t1, t1 / t0);
+    };
+    run(1, 1000);
+    run(1, 100000);
+    run(64, 10000);
+    run(8, 1000000);
+}
+#endif
+
+// vim: syntax=cpp.doxygen
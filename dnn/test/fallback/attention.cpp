@@ -0,0 +1,167 @@
+/**
+ * \file dnn/test/fallback/attention.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+
+#include <cmath>
+#include <limits>
+
+namespace megdnn {
+namespace test {
+
+namespace {
+//! fill -inf into the mask: the keys of every third query are all masked out,
+//! and those of the next query partly
+class InfMaskRNG final : public RNG {
+    UniformFloatRNG m_rng{-5.f, 0.f};
+
+public:
+    void gen(const TensorND& tensor) override {
+        m_rng.gen(tensor);
+        auto&& layout = tensor.layout;
+        size_t sk = layout.shape[layout.ndim - 1],
+               nr_rows = layout.total_nr_elems() / sk;
+        auto ptr = tensor.ptr<dt_float32>();
+        for (size_t r = 0; r < nr_rows; ++r) {
+            for (size_t j = 0; j < sk; ++j) {
+                if (r % 3 == 0 || (r % 3 == 1 && j % 2 == 0)) {
+                    ptr[r * sk + j] = -std::numeric_limits<float>::infinity();
+                }
+            }
+        }
+    }
+};
+
+void run_attention_test(Handle* handle) {
+    Checker<Attention> checker(handle);
+    UniformFloatRNG rng(-2.f, 2.f), mask_rng(-5.f, 0.f);
+    checker.set_rng(0, &rng)
+            .set_rng(1, &rng)
+            .set_rng(2, &rng)
+            .set_rng(3, &mask_rng)
+            .set_epsilon(1e-4);
+    // fully masked queries are NaN, e.g. the first queries with the causal
+    // mask if Sq > Sk; map them and the masked inputs to a value that an
+    // average of v in [-2, 2] never gives
+    checker.set_output_canonizer(
+            [](const CheckerHelper::TensorValueArray& tensors) {
+                for (auto&& tensor : tensors) {
+                    if (tensor.layout.dtype != dtype::Float32())
+                        continue;
+                    auto ptr = tensor.ptr<dt_float32>();
+                    for (size_t i = 0; i < tensor.layout.total_nr_elems();
+                         ++i) {
+                        if (!std::isfinite(ptr[i]))
+                            ptr[i] = 100.f;
+                    }
+                }
+            });
+    // (batch, Sq, Sk, D, Dv); sizes that are not multiples of the blocks
+    // check the tails
+    struct Arg {
+        size_t b, sq, sk, d, dv;
+    };
+    for (auto&& arg : std::vector<Arg>{{1, 1, 1, 1, 1},
+                                       {2, 5, 7, 3, 4},
+                                       {3, 17, 70, 16, 8},
+                                       {2, 64, 130, 33, 31},
+                                       {1, 70, 20, 64, 64}}) {
+        TensorShape q{arg.b, arg.sq, arg.d}, k{arg.b, arg.sk, arg.d},
+                v{arg.b, arg.sk, arg.dv};
+        for (bool causal : {false, true}) {
+            param::Attention param{0.3f, causal};
+            checker.set_param(param).execs({q, k, v, {}, {}});
+            checker.execs({q, k, v, {arg.b, arg.sq, arg.sk}, {}});
+            checker.execs({q, k, v, {1, 1, arg.sk}, {}});
+            checker.execs({q, k, v, {arg.b, arg.sq, 1}, {}});
+        }
+    }
+
+    // multi-head layout (batch, head, seq, dim) with a padding mask per batch
+    checker.set_param(param::Attention{0.125f, false});
+    checker.execs({{2, 4, 33, 64}, {2, 4, 65, 64}, {2, 4, 65, 64}, {}, {}});
+    checker.execs({{2, 4, 33, 64},
+                   {2, 4, 65, 64},
+                   {2, 4, 65, 64},
+                   {2, 1, 1, 65},
+                   {}});
+    checker.set_param(param::Attention{0.125f, true});
+    checker.execs({{3, 2, 40, 32},
+                   {3, 2, 40, 32},
+                   {3, 2, 40, 16},
+                   {3, 2, 40, 40},
+                   {}});
+    checker.execs({{2, 3, 2, 9, 16}, {2, 3, 2, 9, 16}, {2, 3, 2, 9, 16}, {},
+                   {}});
+
+    // masks of -inf, with fully masked queries
+    InfMaskRNG inf_mask_rng;
+    checker.set_rng(3, &inf_mask_rng).set_param(param::Attention{0.3f, false});
+    checker.execs({{2, 10, 8}, {2, 70, 8}, {2, 70, 5}, {2, 10, 70}, {}});
+    checker.execs({{2, 4, 9, 16}, {2, 4, 130, 16}, {2, 4, 130, 16},
+                   {2, 1, 9, 130},
+                   {}});
+    checker.set_rng(3, &mask_rng);
+
+#if !MEGDNN_DISABLE_FLOAT16
+    // handled by the naive impl
+    checker.set_param(param::Attention{0.25f, false})
+            .set_dtype(0, dtype::Float16())
+            .set_dtype(1, dtype::Float16())
+            .set_dtype(2, dtype::Float16())
+            .set_dtype(3, dtype::Float16())
+            .set_dtype(4, dtype::Float16())
+            .set_epsilon(1e-2)
+            .execs({{2, 9, 16}, {2, 11, 16}, {2, 11, 8}, {1, 1, 11}, {}});
+#endif
+}
+}  // anonymous namespace
+
+TEST_F(FALLBACK, ATTENTION) {
+    run_attention_test(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, ATTENTION) {
+    run_attention_test(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK_MULTI_THREADS, BENCHMARK_ATTENTION) {
+    auto naive_handle = create_cpu_handle(2);
+    Benchmarker<Attention> bencher(handle()), bencher_naive(naive_handle.get());
+    constexpr size_t RUN = 10;
+    auto run = [&](size_t batch, size_t head, size_t seq, size_t dim,
+                   bool causal) {
+        TensorShape qkv{batch, head, seq, dim};
+        param::Attention param{1.f / std::sqrt(static_cast<float>(dim)),
+                               causal};
+        bencher.set_param(param).set_times(RUN).set_display(false);
+        bencher_naive.set_param(param).set_times(RUN).set_display(false);
+        auto t0 = bencher.execs({qkv, qkv, qkv, {}, {}}) / RUN,
+             t1 = bencher_naive.execs({qkv, qkv, qkv, {}, {}}) / RUN;
+        printf("%s causal=%d: fallback=%.3fms naive=%.3fms speedup=%.2f\n",
+               qkv.to_string().c_str(), causal, t0, t1, t1 / t0);
+    };
+    run(1, 12, 128, 64, false);
+    run(1, 12, 512, 64, false);
+    run(1, 12, 512, 64, true);
+    run(8, 8, 256, 64, false);
+}
+#endif
+
+}  // namespace test
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
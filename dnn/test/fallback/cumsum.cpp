@@ -0,0 +1,76 @@
+/**
+ * \file dnn/test/fallback/cumsum.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+
+namespace megdnn {
+namespace test {
+
+namespace {
+void run_cumsum_test(Handle* handle) {
+    Checker<Cumsum> checker(handle);
+    // long axes are split into blocks when there are more threads than
+    // slices before the axis
+    for (auto shape : TensorShapeArray{{1}, {10}, {1000}, {100003},
+                                       {3, 50001}, {50001, 3}, {1, 40000, 5},
+                                       {30, 30, 30, 30}}) {
+        for (size_t axis = 0; axis < shape.ndim; ++axis) {
+            for (bool exclusive : {true, false}) {
+                for (bool reverse : {true, false}) {
+                    checker.set_param(
+                            param::Cumsum(axis, exclusive, reverse));
+                    checker.set_epsilon(1e-2);
+                    checker.set_dtype(0, dtype::Float32())
+                            .execs({{shape}, {}});
+                    checker.set_dtype(0, dtype::Int16()).execs({{shape}, {}});
+                    checker.set_dtype(0, dtype::Int32()).execs({{shape}, {}});
+                }
+            }
+        }
+    }
+}
+}  // anonymous namespace
+
+TEST_F(FALLBACK, CUMSUM) {
+    run_cumsum_test(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, CUMSUM) {
+    run_cumsum_test(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK_MULTI_THREADS, BENCHMARK_CUMSUM) {
+    auto naive_handle = create_cpu_handle(2);
+    Benchmarker<Cumsum> bencher(handle()), bencher_naive(naive_handle.get());
+    constexpr size_t RUN = 10;
+    auto run = [&](const TensorShape& shape, size_t axis) {
+        param::Cumsum param(axis, false, false);
+        bencher.set_param(param).set_times(RUN).set_display(false);
+        bencher_naive.set_param(param).set_times(RUN).set_display(false);
+        auto t0 = bencher.execs({shape, {}}) / RUN,
+             t1 = bencher_naive.execs({shape, {}}) / RUN;
+        printf("%s axis=%zu: fallback=%.3fms naive=%.3fms speedup=%.2f\n",
+               shape.to_string().c_str(), axis, t0, t1, t1 / t0);
+    };
+    run({10000000}, 0);
+    run({64, 100000}, 1);
+    run({100000, 64}, 0);
+}
+#endif
+
+}  // namespace test
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
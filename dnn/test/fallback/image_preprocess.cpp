@@ -0,0 +1,114 @@
+/**
+ * \file dnn/test/fallback/image_preprocess.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+#include "test/common/rng.h"
+
+namespace megdnn {
+namespace test {
+
+namespace {
+void run_image_preprocess_test(Handle* handle) {
+    using Param = ImagePreprocess::Param;
+    Checker<ImagePreprocess> checker(handle);
+    UniformIntRNG rng{0, 255};
+    checker.set_rng(0, &rng).set_dtype(0, dtype::Uint8());
+    struct Arg {
+        size_t n, ih, iw, oh, ow;
+    };
+    // the heights span several row blocks and do not divide them
+    std::vector<Arg> args{{1, 2, 2, 0, 0},     {2, 8, 6, 1, 1},
+                          {1, 20, 30, 33, 17}, {3, 48, 64, 24, 32},
+                          {2, 100, 82, 37, 61}, {1, 36, 40, 90, 100}};
+    for (auto src_format : {Param::SrcFormat::BGR, Param::SrcFormat::RGB,
+                            Param::SrcFormat::NV21, Param::SrcFormat::NV12}) {
+        bool yuv = src_format == Param::SrcFormat::NV21 ||
+                   src_format == Param::SrcFormat::NV12;
+        for (auto format : {Param::Format::NCHW, Param::Format::NCHW44,
+                            Param::Format::NCHW88}) {
+            for (auto imode : {Param::InterpolationMode::LINEAR,
+                               Param::InterpolationMode::NEAREST}) {
+                Param param{src_format, format, imode, yuv,
+                            0,          0,      103.9f, 116.8f,
+                            123.7f,     0.017f, 0.018f, 0.019f};
+                for (auto&& arg : args) {
+                    param.oh = arg.oh;
+                    param.ow = arg.ow;
+                    TensorShape src{arg.n, yuv ? arg.ih / 2 * 3 : arg.ih,
+                                    arg.iw, yuv ? 1_z : 3_z};
+                    checker.set_param(param)
+                            .set_dtype(1, dtype::Float32())
+                            .set_epsilon(1e-4)
+                            .execs({src, {}});
+                    checker.set_dtype(1, dtype::QuantizedS8(0.02f))
+                            .set_epsilon(1)
+                            .execs({src, {}});
+                }
+            }
+        }
+    }
+}
+}  // anonymous namespace
+
+TEST_F(FALLBACK, IMAGE_PREPROCESS) {
+    run_image_preprocess_test(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, IMAGE_PREPROCESS) {
+    run_image_preprocess_test(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK_MULTI_THREADS, BENCHMARK_IMAGE_PREPROCESS) {
+    using Param = ImagePreprocess::Param;
+    auto naive_handle = create_cpu_handle(2);
+    Benchmarker<ImagePreprocess> bencher(handle()),
+            bencher_naive(naive_handle.get());
+    constexpr size_t RUN = 10;
+    auto run = [&](Param::SrcFormat src_format, Param::Format format,
+                   size_t ih, size_t iw, size_t oh, size_t ow) {
+        bool yuv = src_format == Param::SrcFormat::NV21 ||
+                   src_format == Param::SrcFormat::NV12;
+        TensorShape src{1, yuv ? ih / 2 * 3 : ih, iw, yuv ? 1_z : 3_z};
+        Param param;
+        param.src_format = src_format;
+        param.format = format;
+        param.oh = oh;
+        param.ow = ow;
+        for (auto&& b : {&bencher, &bencher_naive}) {
+            b->set_param(param)
+                    .set_dtype(0, dtype::Uint8())
+                    .set_dtype(1, dtype::Float32())
+                    .set_times(RUN)
+                    .set_display(false);
+        }
+        auto t0 = bencher.execs({src, {}}) / RUN,
+             t1 = bencher_naive.execs({src, {}}) / RUN;
+        printf("%s -> %zux%zu format=%d: fallback=%.3fms naive=%.3fms "
+               "speedup=%.2f\n",
+               src.to_string().c_str(), oh, ow, static_cast<int>(format), t0,
+               t1, t1 / t0);
+    };
+    run(Param::SrcFormat::NV21, Param::Format::NCHW, 1080, 1920, 224, 224);
+    run(Param::SrcFormat::NV21, Param::Format::NCHW44, 720, 1280, 320, 320);
+    run(Param::SrcFormat::BGR, Param::Format::NCHW88, 1080, 1920, 512, 512);
+    run(Param::SrcFormat::BGR, Param::Format::NCHW, 480, 640, 480, 640);
+}
+#endif
+
+}  // namespace test
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
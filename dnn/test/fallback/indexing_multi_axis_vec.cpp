@@ -0,0 +1,159 @@
+/**
+ * \file dnn/test/fallback/indexing_multi_axis_vec.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+#include "test/common/index.h"
+#include "test/common/indexing_multi_axis_vec.h"
+
+using namespace megdnn;
+using namespace test;
+
+namespace {
+
+template <class Opr>
+void run_check(Handle* handle) {
+    // see OprProxyIndexingMultiAxisVecHelper for more details
+    // set_proxy() sets the axes to index on
+    // execs() give input, output and index layouts
+    Checker<Opr> checker(handle);
+    size_t idx_size0, idx_size1;
+    IndexRNG rng0{idx_size0, 2}, rng1{idx_size1, 3};
+    checker.set_dtype(0, dtype::Float32())  // data
+            .set_dtype(1, dtype::Float32())  // value
+            .set_dtype(2, dtype::Int32())    // idx0
+            .set_dtype(3, dtype::Int32())    // idx1
+            .set_rng(2, &rng0)
+            .set_rng(3, &rng1);
+
+    // scalar rows, gathered element by element
+    idx_size0 = 23;
+    checker.set_proxy({{0}})
+            .execs({{23}, {100}, {100}})
+            .execs({{23}, {100003}, {100003}});
+
+    // embedding lookup: contiguous rows copied by memcpy
+    idx_size0 = 1000;
+    checker.set_proxy({{0}})
+            .execs({{1000, 64}, {10000, 64}, {10000}})
+            .execs({{1000, 3}, {20000, 3}, {20000}});
+
+    idx_size0 = 2;
+    idx_size1 = 3;
+    checker.set_proxy({{0, 1}})
+            .execs({{2, 3}, {10}, {10}, {10}})
+            .execs({{2, 3, 5}, {10, 5}, {10}, {10}});
+
+    // indexed axes in the middle, with outer slices
+    idx_size0 = 4;
+    idx_size1 = 5;
+    checker.set_proxy({{2, 3}})
+            .execs({{2, 3, 4, 5, 6, 7}, {2, 3, 10, 6, 7}, {10}, {10}});
+
+    // rows that are not contiguous in data
+    idx_size0 = 4;
+    idx_size1 = 6;
+    TensorLayout inp_layout{{3, 4, 5, 6}, dtype::Float32()};
+    inp_layout.stride[0] *= 8;
+    inp_layout.stride[1] *= 2;
+    checker.set_proxy({{1, 3}})
+            .execl({inp_layout,
+                    {{7, 3, 5}, dtype::Float32()},
+                    {{7}, dtype::Int32()},
+                    {{1}, dtype::Int32()}});
+
+    // a few long rows split into columns among the threads
+    idx_size0 = 4;
+    checker.set_proxy({{1}}).execs({{1, 4}, {1, 1024 * 1024}, {1024 * 1024}});
+    checker.set_proxy({{0}}).execs({{4, 100000}, {7, 100000}, {7}});
+
+    checker.set_dtype(0, dtype::Int32()).set_dtype(1, dtype::Int32());
+    idx_size0 = 1000;
+    checker.set_proxy({{0}})
+            .execs({{1000}, {10000}, {10000}})
+            .execs({{1000, 16}, {10000, 16}, {10000}});
+
+    if (std::is_same<Opr, IndexingIncrMultiAxisVec>::value) {
+        idx_size0 = 4;
+        TensorLayout val_layout{{23}, dtype::Float32()};
+        val_layout.stride[0] = 0;
+        checker.set_dtype(0, dtype::Float32())
+                .set_dtype(1, dtype::Float32())
+                .set_proxy({{0}})
+                .execl({{{4}, dtype::Float32()},
+                        val_layout,
+                        {{23}, dtype::Int32()}});
+    }
+}
+
+}  // anonymous namespace
+
+TEST_F(FALLBACK, INDEXING_MULTI_AXIS_VEC) {
+    run_check<IndexingMultiAxisVec>(handle());
+}
+
+TEST_F(FALLBACK, INDEXING_SET_MULTI_AXIS_VEC) {
+    run_check<IndexingSetMultiAxisVec>(handle());
+}
+
+TEST_F(FALLBACK, INDEXING_INCR_MULTI_AXIS_VEC) {
+    run_check<IndexingIncrMultiAxisVec>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, INDEXING_MULTI_AXIS_VEC) {
+    run_check<IndexingMultiAxisVec>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, INDEXING_SET_MULTI_AXIS_VEC) {
+    run_check<IndexingSetMultiAxisVec>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, INDEXING_INCR_MULTI_AXIS_VEC) {
+    run_check<IndexingIncrMultiAxisVec>(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK_MULTI_THREADS, BENCHMARK_INDEXING_MULTI_AXIS_VEC) {
+    auto naive_handle = create_cpu_handle(2);
+    size_t idx_size = 0;
+    IndexRNG rng{idx_size, 2};
+    constexpr size_t RUN = 10;
+    auto run = [&](size_t nr_emb, size_t dim, size_t nr_lookup) {
+        idx_size = nr_emb;
+        Benchmarker<IndexingMultiAxisVec> bencher(handle()),
+                bencher_naive(naive_handle.get());
+        for (auto b : {&bencher, &bencher_naive}) {
+            std::unique_ptr<OprProxy<IndexingMultiAxisVec>> proxy{
+                    new OprProxy<IndexingMultiAxisVec>{0}};
+            b->set_proxy(proxy)
+                    .set_dtype(2, dtype::Int32())
+                    .set_rng(2, &rng)
+                    .set_times(RUN)
+                    .set_display(false);
+        }
+        TensorShapeArray shapes{
+                {nr_emb, dim}, {nr_lookup, dim}, {nr_lookup}};
+        auto t0 = bencher.execs(shapes) / RUN,
+             t1 = bencher_naive.execs(shapes) / RUN;
+        printf("emb=%zux%zu lookup=%zu: fallback=%.3fms naive=%.3fms "
+               "speedup=%.2f\n",
+               nr_emb, dim, nr_lookup, t0, t1, t1 / t0);
+    };
+    run(100000, 1, 1000000);
+    run(100000, 16, 100000);
+    run(1000000, 64, 100000);
+}
+#endif
+
+// vim: syntax=cpp.doxygen
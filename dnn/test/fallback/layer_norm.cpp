@@ -0,0 +1,121 @@
+/**
+ * \file dnn/test/fallback/layer_norm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+
+namespace megdnn {
+namespace test {
+
+namespace {
+param::LayerNorm make_param(const TensorShape& shape, size_t normalized_dim,
+                            bool affine) {
+    param::LayerNorm param;
+    param.affine = affine;
+    param.normalized_dim = normalized_dim;
+    param.normalized_size = 1;
+    for (size_t i = shape.ndim - normalized_dim; i < shape.ndim; ++i) {
+        param.normalized_size *= shape[i];
+    }
+    return param;
+}
+
+TensorShape get_normalized_shape(const TensorShape& shape,
+                                 size_t normalized_dim) {
+    TensorShape ret;
+    ret.ndim = normalized_dim;
+    for (size_t i = 0; i < normalized_dim; ++i) {
+        ret[i] = shape[shape.ndim - normalized_dim + i];
+    }
+    return ret;
+}
+
+TensorShape get_unnormalized_shape(const TensorShape& shape,
+                                   size_t normalized_dim) {
+    TensorShape ret;
+    ret.ndim = shape.ndim - normalized_dim;
+    for (size_t i = 0; i < ret.ndim; ++i) {
+        ret[i] = shape[i];
+    }
+    return ret.ndim ? ret : TensorShape{1};
+}
+
+void run_layer_norm_test(Handle* handle) {
+    Checker<LayerNorm> checker(handle);
+    Checker<LayerNormBackward> checker_bwd(handle);
+    UniformFloatRNG rng(-2.f, 2.f), rstd_rng(0.1f, 2.f);
+    checker.set_rng(0, &rng).set_epsilon(1e-3);
+    checker_bwd.set_rng(4, &rstd_rng).set_epsilon(1e-3);
+    for (auto&& arg : std::vector<std::pair<TensorShape, size_t>>{
+                 {{1, 1}, 1},
+                 {{2, 3}, 1},
+                 {{5, 37}, 1},
+                 {{4, 8, 64}, 1},
+                 {{4, 8, 64}, 2},
+                 {{64, 1000}, 1},
+                 {{3, 5, 7}, 3}}) {
+        auto&& shape = arg.first;
+        size_t normalized_dim = arg.second;
+        auto normalized = get_normalized_shape(shape, normalized_dim),
+             unnormalized = get_unnormalized_shape(shape, normalized_dim);
+        for (bool affine : {true, false}) {
+            auto param = make_param(shape, normalized_dim, affine);
+            checker.set_param(param).execs(
+                    {shape, normalized, normalized, {}, {}, {}});
+            checker_bwd.set_param(param).execs({shape,
+                                                shape,
+                                                normalized,
+                                                unnormalized,
+                                                unnormalized,
+                                                shape,
+                                                normalized,
+                                                normalized});
+        }
+    }
+}
+}  // anonymous namespace
+
+TEST_F(FALLBACK, LAYER_NORM) {
+    run_layer_norm_test(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, LAYER_NORM) {
+    run_layer_norm_test(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK_MULTI_THREADS, BENCHMARK_LAYER_NORM) {
+    auto naive_handle = create_cpu_handle(2);
+    Benchmarker<LayerNorm> bencher(handle()), bencher_naive(naive_handle.get());
+    constexpr size_t RUN = 10;
+    auto run = [&](const TensorShape& shape) {
+        auto param = make_param(shape, 1, true);
+        TensorShape normalized{shape[shape.ndim - 1]};
+        bencher.set_param(param).set_times(RUN).set_display(false);
+        bencher_naive.set_param(param).set_times(RUN).set_display(false);
+        TensorShapeArray shapes{shape, normalized, normalized, {}, {}, {}};
+        auto t0 = bencher.execs(shapes) / RUN,
+             t1 = bencher_naive.execs(shapes) / RUN;
+        printf("%s: fallback=%.3fms naive=%.3fms speedup=%.2f\n",
+               shape.to_string().c_str(), t0, t1, t1 / t0);
+    };
+    run({64, 128, 768});
+    run({4096, 1024});
+}
+#endif
+
+}  // namespace test
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,164 @@
+/**
+ * \file dnn/test/fallback/mesh_indexing.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/checker.h"
+#include "test/common/index.h"
+#include "test/common/mesh_indexing.h"
+
+using namespace megdnn;
+using namespace test;
+
+namespace {
+
+template <class Opr, class RNG = IndexRNG>
+void run_check(Handle* handle) {
+    // set_proxy() sets the axes to index on; execs() give origin, indexed
+    // and index layouts
+    Checker<Opr> checker(handle);
+    size_t idx_size0, idx_size1;
+    RNG rng0{idx_size0, 2}, rng1{idx_size1, 3};
+    checker.set_dtype(0, dtype::Float32())
+            .set_dtype(1, dtype::Float32())
+            .set_dtype(2, dtype::Int32())
+            .set_dtype(3, dtype::Int32())
+            .set_rng(2, &rng0)
+            .set_rng(3, &rng1);
+
+    // the indexed axis is the row: gathered element by element
+    idx_size0 = 230;
+    checker.set_proxy({{0}}).execs({{230}, {100}, {100}});
+    idx_size0 = 30;
+    checker.set_proxy({{1}})
+            .execs({{2, 30}, {2, 10}, {10}})
+            .execs({{64, 30}, {64, 20}, {20}});
+
+    // contiguous rows copied by memcpy
+    idx_size0 = 230;
+    checker.set_proxy({{0}}).execs({{230, 64}, {100, 64}, {100}});
+    idx_size0 = 30;
+    checker.set_proxy({{1}})
+            .execs({{2, 30, 5}, {2, 20, 5}, {20}})
+            .execs({{2, 30, 5, 7}, {2, 25, 5, 7}, {25}})
+            .execs({{16, 30, 256}, {16, 25, 256}, {25}});
+
+    // two indexed axes, one of them the row
+    idx_size0 = 23;
+    idx_size1 = 17;
+    checker.set_proxy({{3, 1}})
+            .execs({{3, 17, 9, 23}, {3, 10, 9, 10}, {10}, {10}});
+
+    // rows that are not contiguous in data
+    idx_size0 = 30;
+    TensorLayout inp_layout{{4, 30, 6}, dtype::Float32()};
+    inp_layout.stride[0] *= 2;
+    inp_layout.stride[2] = 2;
+    inp_layout.stride[1] = 12;
+    checker.set_proxy({{1}}).execl({inp_layout,
+                                    {{4, 20, 6}, dtype::Float32()},
+                                    {{20}, dtype::Int32()}});
+
+    checker.set_dtype(0, dtype::Int32()).set_dtype(1, dtype::Int32());
+    idx_size0 = 100;
+    checker.set_proxy({{1}}).execs({{32, 100, 16}, {32, 50, 16}, {50}});
+}
+
+template <class Opr, class RNG = IndexRNG>
+void run_batched_check(Handle* handle) {
+    Checker<Opr> checker(handle);
+    size_t idx_size0, idx_size1;
+    RNG rng0{idx_size0, 2}, rng1{idx_size1, 3};
+    checker.set_dtype(0, dtype::Float32())
+            .set_dtype(1, dtype::Float32())
+            .set_dtype(2, dtype::Int32())
+            .set_dtype(3, dtype::Int32())
+            .set_rng(2, &rng0)
+            .set_rng(3, &rng1);
+
+    idx_size0 = 5;
+    checker.set_proxy({{1}})
+            .execs({{2, 5}, {2, 3}, {2, 3}})
+            .execs({{64, 5, 32}, {64, 3, 32}, {64, 3}});
+
+    idx_size0 = 23;
+    idx_size1 = 17;
+    checker.set_proxy({{3, 1}})
+            .execs({{3, 17, 9, 23}, {3, 10, 9, 10}, {3, 10}, {3, 10}})
+            .execs({{3, 17, 29, 30}, {3, 11, 29, 22}, {3, 22}, {3, 11}});
+
+    // the same indices for every batch; NoReplacementIndexRNG can not fill
+    // a broadcast index
+    if (std::is_same<RNG, IndexRNG>::value) {
+        idx_size0 = 5;
+        TensorLayout index_layout{TensorShape{1, 3}, dtype::Int32()};
+        index_layout = index_layout.broadcast({2, 3});
+        checker.set_proxy({{1}}).execl(
+                {TensorLayout{TensorShape{2, idx_size0}, dtype::Float32()},
+                 TensorLayout{TensorShape{2, 3}, dtype::Float32()},
+                 index_layout});
+    }
+}
+
+}  // anonymous namespace
+
+TEST_F(FALLBACK, MESH_INDEXING) {
+    run_check<MeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK, MESH_MODIFY_INCREMENT) {
+    run_check<IncrMeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK, MESH_MODIFY_SETTING) {
+    run_check<SetMeshIndexing, mesh_indexing::NoReplacementIndexRNG>(handle());
+}
+
+TEST_F(FALLBACK, BATCHED_MESH_INDEXING) {
+    run_batched_check<BatchedMeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK, BATCHED_MESH_MODIFY_INCREMENT) {
+    run_batched_check<BatchedIncrMeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK, BATCHED_MESH_MODIFY_SETTING) {
+    run_batched_check<BatchedSetMeshIndexing,
+                      mesh_indexing::NoReplacementIndexRNG>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, MESH_INDEXING) {
+    run_check<MeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, MESH_MODIFY_INCREMENT) {
+    run_check<IncrMeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, MESH_MODIFY_SETTING) {
+    run_check<SetMeshIndexing, mesh_indexing::NoReplacementIndexRNG>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, BATCHED_MESH_INDEXING) {
+    run_batched_check<BatchedMeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, BATCHED_MESH_MODIFY_INCREMENT) {
+    run_batched_check<BatchedIncrMeshIndexing>(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, BATCHED_MESH_MODIFY_SETTING) {
+    run_batched_check<BatchedSetMeshIndexing,
+                      mesh_indexing::NoReplacementIndexRNG>(handle());
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,152 @@
+/**
+ * \file dnn/test/fallback/softmax.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/fallback/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+
+#include <cmath>
+#include <limits>
+
+namespace megdnn {
+namespace test {
+
+namespace {
+void run_softmax_test(Handle* handle) {
+    Checker<Softmax> checker(handle);
+    Checker<SoftmaxBackward> checker_bwd(handle);
+    // a wide range makes the running max grow often
+    UniformFloatRNG rng(-20.f, 20.f), y_rng(0.f, 1.f);
+    checker.set_rng(0, &rng).set_epsilon(1e-4);
+    checker_bwd.set_rng(0, &y_rng).set_epsilon(1e-4);
+    for (auto&& shape : TensorShapeArray{
+                 {1}, {3}, {7, 9}, {2, 1000}, {16, 3, 35}, {5, 20, 6, 7}}) {
+        for (int axis = -1; axis < static_cast<int>(shape.ndim); ++axis) {
+            checker.set_param(param::Softmax{axis}).execs({shape, {}});
+            checker_bwd.set_param(param::Softmax{axis})
+                    .execs({shape, shape, shape});
+        }
+    }
+#if !MEGDNN_DISABLE_FLOAT16
+    // handled by the naive impl
+    checker.set_param(param::Softmax{-1})
+            .set_dtype(0, dtype::Float16())
+            .set_dtype(1, dtype::Float16())
+            .set_epsilon(1e-2)
+            .execs({{4, 33}, {}});
+#endif
+}
+
+/*!
+ * \brief fill -inf into the rows along the softmax axis: rows r % 3 == 0 are
+ *      fully masked, and rows r % 3 == 1 have pairs of masked values starting
+ *      from the first one
+ */
+class MaskedRNG final : public RNG {
+    UniformFloatRNG m_rng{-20.f, 20.f};
+    size_t m_axis = 0;
+
+public:
+    void set_axis(size_t axis) { m_axis = axis; }
+
+    void gen(const TensorND& tensor) override {
+        m_rng.gen(tensor);
+        auto&& layout = tensor.layout;
+        size_t A = 1, B = layout.shape[m_axis], C = 1;
+        for (size_t i = 0; i < m_axis; ++i)
+            A *= layout.shape[i];
+        for (size_t i = m_axis + 1; i < layout.ndim; ++i)
+            C *= layout.shape[i];
+        auto ptr = tensor.ptr<dt_float32>();
+        for (size_t a = 0; a < A; ++a) {
+            for (size_t b = 0; b < B; ++b) {
+                for (size_t c = 0; c < C; ++c) {
+                    size_t row = a * C + c;
+                    if (row % 3 == 0 || (row % 3 == 1 && b % 4 < 2)) {
+                        ptr[(a * B + b) * C + c] =
+                                -std::numeric_limits<float>::infinity();
+                    }
+                }
+            }
+        }
+    }
+};
+
+void run_masked_softmax_test(Handle* handle) {
+    Checker<Softmax> checker(handle);
+    MaskedRNG rng;
+    // fully masked rows are NaN in the naive impl; map the masked inputs and
+    // the NaN outputs to a value that softmax never gives
+    checker.set_rng(0, &rng).set_epsilon(1e-4).set_output_canonizer(
+            [](const CheckerHelper::TensorValueArray& tensors) {
+                for (auto&& tensor : tensors) {
+                    auto ptr = tensor.ptr<dt_float32>();
+                    for (size_t i = 0; i < tensor.layout.total_nr_elems();
+                         ++i) {
+                        if (!std::isfinite(ptr[i]))
+                            ptr[i] = -1.f;
+                    }
+                }
+            });
+    for (auto&& shape : TensorShapeArray{{6, 3}, {9, 37}, {5, 40, 7}}) {
+        for (size_t axis = 0; axis < shape.ndim; ++axis) {
+            rng.set_axis(axis);
+            checker.set_param(param::Softmax{static_cast<int32_t>(axis)})
+                    .execs({shape, {}});
+        }
+    }
+}
+}  // anonymous namespace
+
+TEST_F(FALLBACK, SOFTMAX) {
+    run_softmax_test(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, SOFTMAX) {
+    run_softmax_test(handle());
+}
+
+TEST_F(FALLBACK, SOFTMAX_MASKED) {
+    run_masked_softmax_test(handle());
+}
+
+TEST_F(FALLBACK_MULTI_THREADS, SOFTMAX_MASKED) {
+    run_masked_softmax_test(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(FALLBACK_MULTI_THREADS, BENCHMARK_SOFTMAX) {
+    auto naive_handle = create_cpu_handle(2);
+    Benchmarker<Softmax> bencher(handle()), bencher_naive(naive_handle.get());
+    constexpr size_t RUN = 10;
+    auto run = [&](const TensorShape& shape, int axis) {
+        bencher.set_param(param::Softmax{axis}).set_times(RUN).set_display(
+                false);
+        bencher_naive.set_param(param::Softmax{axis})
+                .set_times(RUN)
+                .set_display(false);
+        auto t0 = bencher.execs({shape, {}}) / RUN,
+             t1 = bencher_naive.execs({shape, {}}) / RUN;
+        printf("%s axis=%d: fallback=%.3fms naive=%.3fms speedup=%.2f\n",
+               shape.to_string().c_str(), axis, t0, t1, t1 / t0);
+    };
+    run({64, 12, 128, 128}, -1);
+    run({1024, 1000}, 1);
+    run({64, 1000, 64}, 1);
+}
+#endif
+
+}  // namespace test
+}  // namespace megdnn
+
+// vim: syntax=cpp.doxygen
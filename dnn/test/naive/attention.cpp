@@ -0,0 +1,85 @@
+/**
+ * \file dnn/test/naive/attention.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/naive/fixture.h"
+
+#include "megdnn/oprs/nn.h"
+#include "test/common/checker.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace megdnn;
+using namespace test;
+
+TEST_F(NAIVE, ATTENTION_FORWARD) {
+    Checker<Attention> checker(handle(), /* check_dispatch */ false);
+    // each Testcase frees its tensors
+    auto q = [] {
+        return TensorValue({1, 2, 2}, dtype::Float32(), {1, 0, 0, 1});
+    };
+    auto v = [] {
+        return TensorValue({1, 2, 2}, dtype::Float32(), {1, 2, 3, 4});
+    };
+    checker.set_param(param::Attention{1.f, false})
+            .exect(Testcase{q(), q(), v(), {}, {}},
+                   Testcase{{},
+                            {},
+                            {},
+                            {},
+                            TensorValue({1, 2, 2}, dtype::Float32(),
+                                        {1.5378828f, 2.5378828f, 2.4621172f,
+                                         3.4621172f})});
+    // the first query can only see the first key
+    checker.set_param(param::Attention{1.f, true})
+            .exect(Testcase{q(), q(), v(), {}, {}},
+                   Testcase{{},
+                            {},
+                            {},
+                            {},
+                            TensorValue({1, 2, 2}, dtype::Float32(),
+                                        {1.f, 2.f, 2.4621172f, 3.4621172f})});
+    // the mask is broadcast over the queries
+    checker.set_param(param::Attention{1.f, false})
+            .exect(Testcase{q(), q(), v(),
+                            TensorValue({1, 1, 2}, dtype::Float32(), {0, 1}),
+                            {}},
+                   Testcase{{},
+                            {},
+                            {},
+                            {},
+                            TensorValue({1, 2, 2}, dtype::Float32(),
+                                        {2.f, 3.f, 2.7615942f, 3.7615942f})});
+}
+
+TEST_F(NAIVE, ATTENTION_FORWARD_MASKED_QUERY) {
+    // like the softmax of the unfused graph, a query whose keys are all
+    // masked out gives NaN
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    auto q = TensorValue({1, 2, 2}, dtype::Float32(), {1, 0, 0, 1}),
+         k = TensorValue({1, 2, 2}, dtype::Float32(), {1, 0, 0, 1}),
+         v = TensorValue({1, 2, 2}, dtype::Float32(), {1, 2, 3, 4}),
+         mask = TensorValue({1, 2, 2}, dtype::Float32(),
+                            {-inf, 0.f, -inf, -inf}),
+         dst = TensorValue({1, 2, 2}, dtype::Float32(), {0, 0, 0, 0});
+    auto opr = handle()->create_operator<Attention>();
+    opr->param() = param::Attention{1.f, false};
+    opr->exec(q, k, v, mask, dst, {});
+    auto ptr = dst.ptr<dt_float32>();
+    ASSERT_EQ(3.f, ptr[0]);
+    ASSERT_EQ(4.f, ptr[1]);
+    ASSERT_TRUE(std::isnan(ptr[2]));
+    ASSERT_TRUE(std::isnan(ptr[3]));
+    for (auto&& tensor : {q, k, v, mask, dst})
+        free(tensor.raw_ptr);
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,57 @@
+/**
+ * \file dnn/test/naive/image_preprocess.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/naive/fixture.h"
+
+#include "megdnn/oprs/cv.h"
+#include "test/common/checker.h"
+
+using namespace megdnn;
+using namespace test;
+
+TEST_F(NAIVE, IMAGE_PREPROCESS) {
+    Checker<ImagePreprocess> checker(handle(), /* check_dispatch */ false);
+    using Param = ImagePreprocess::Param;
+
+    // BGR downsampled to a single RGB pixel, which is rounded before
+    // normalized
+    Param param;
+    param.rgb = true;
+    param.oh = param.ow = 1;
+    param.mean0 = 5.f;
+    param.scale0 = 2.f;
+    param.mean2 = 55.f;
+    param.scale2 = 0.5f;
+    checker.set_param(param).exect(
+            Testcase{TensorValue({1, 2, 2, 3}, dtype::Uint8{},
+                                 {10, 20, 30, 40, 50, 60, 70, 80, 90, 100,
+                                  110, 121}),
+                     {}},
+            Testcase{{},
+                     TensorValue({1, 3, 1, 1}, dtype::Float32{},
+                                 {140.f, 65.f, 0.f})});
+
+    // NV12 black and white pixels packed into NCHW44
+    param = {};
+    param.src_format = Param::SrcFormat::NV12;
+    param.format = Param::Format::NCHW44;
+    param.scale0 = param.scale1 = param.scale2 = 1.f / 255;
+    checker.set_param(param).exect(
+            Testcase{TensorValue({1, 3, 2, 1}, dtype::Uint8{},
+                                 {16, 235, 235, 16, 128, 128}),
+                     {}},
+            Testcase{{},
+                     TensorValue({1, 1, 2, 2, 4}, dtype::Float32{},
+                                 {0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 0.f,
+                                  1.f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f, 0.f})});
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,44 @@
+/**
+ * \file dnn/test/naive/layer_norm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/naive/fixture.h"
+
+#include "megdnn/oprs/nn.h"
+#include "test/common/checker.h"
+
+using namespace megdnn;
+using namespace test;
+
+TEST_F(NAIVE, LAYER_NORM_FORWARD) {
+    Checker<LayerNorm> checker(handle(), /* check_dispatch */ false);
+    param::LayerNorm param;
+    param.affine = true;
+    param.eps = 1e-5f;
+    param.normalized_dim = 1;
+    param.normalized_size = 4;
+    checker.set_param(param).exect(
+            Testcase{TensorValue({1, 4}, dtype::Float32(), {1, 2, 3, 4}),
+                     TensorValue({4}, dtype::Float32(), {2, 2, 2, 2}),
+                     TensorValue({4}, dtype::Float32(), {1, 1, 1, 1}),
+                     {},
+                     {},
+                     {}},
+            Testcase{{},
+                     {},
+                     {},
+                     TensorValue({1, 4}, dtype::Float32(),
+                                 {-1.683270f, 0.105576f, 1.894424f,
+                                  3.683270f}),
+                     TensorValue({1}, dtype::Float32(), {2.5f}),
+                     TensorValue({1}, dtype::Float32(), {0.894423f})});
+}
+
+// vim: syntax=cpp.doxygen
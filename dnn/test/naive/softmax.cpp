@@ -0,0 +1,53 @@
+/**
+ * \file dnn/test/naive/softmax.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/naive/fixture.h"
+
+#include "megdnn/oprs/nn.h"
+#include "test/common/checker.h"
+
+using namespace megdnn;
+using namespace test;
+
+TEST_F(NAIVE, SOFTMAX_FORWARD) {
+    Checker<Softmax> checker(handle(), /* check_dispatch */ false);
+    checker.set_param(param::Softmax{-1}).exect(
+            Testcase{TensorValue({2, 5}, dtype::Float32(),
+                                 {-5, -4, -3, -2, -1, 0, 1, 2, 3, 4}),
+                     {}},
+            Testcase{{},
+                     TensorValue({2, 5}, dtype::Float32(),
+                                 {0.0116562f, 0.0316849f, 0.0861285f,
+                                  0.2341217f, 0.6364086f, 0.0116562f,
+                                  0.0316849f, 0.0861285f, 0.2341217f,
+                                  0.6364086f})});
+    checker.set_param(param::Softmax{0}).exect(
+            Testcase{TensorValue({2, 2}, dtype::Float32(), {0, 1, 0, 3}), {}},
+            Testcase{{},
+                     TensorValue({2, 2}, dtype::Float32(),
+                                 {0.5f, 0.1192029f, 0.5f, 0.8807971f})});
+}
+
+TEST_F(NAIVE, SOFTMAX_BACKWARD) {
+    Checker<SoftmaxBackward> checker(handle(), /* check_dispatch */ false);
+    // grad = (diff - sum(diff * y)) * y
+    checker.set_param(param::Softmax{-1}).exect(
+            Testcase{TensorValue({1, 4}, dtype::Float32(),
+                                 {0.1f, 0.2f, 0.3f, 0.4f}),
+                     TensorValue({1, 4}, dtype::Float32(), {1, 0, 0, 1}),
+                     {}},
+            Testcase{{},
+                     {},
+                     TensorValue({1, 4}, dtype::Float32(),
+                                 {0.05f, -0.1f, -0.15f, 0.2f})});
+}
+
+// vim: syntax=cpp.doxygen
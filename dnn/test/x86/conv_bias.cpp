@@ -1833,6 +1833,127 @@ TEST_F(X86_MULTI_THREADS, CONV_BIAS_WINOGRAD_WEIGHT_PREPROCESS) {
 }
 
 /*********************************** End winograd ************************/
+/************************* Direct NCHW88 ****************************/
+namespace {
+std::vector<conv_bias::TestArg> get_nchw88_conv_bias_args(
+        std::vector<size_t> kernel_vec, size_t stride, bool is_input_nchw,
+        bool is_chanwise) {
+    using namespace conv_bias;
+    using NLMode = param::ConvBias::NonlineMode;
+    std::vector<TestArg> args;
+
+    auto pack = [&](size_t n, size_t oc, size_t ic, size_t h, size_t w,
+                    size_t kernel, size_t group, NLMode nlmode,
+                    megdnn::BiasMode bias_mode) {
+        constexpr size_t pack_c = 8;
+        const size_t pad = kernel / 2;
+        //! the first-layer conv is not fused with a full bias
+        if ((w + 2 * pad < kernel || h + 2 * pad < kernel) ||
+            (is_input_nchw && bias_mode == megdnn::BiasMode::BIAS))
+            return;
+        param::ConvBias param;
+        param.format = param::ConvBias::Format::NCHW88;
+        param.stride_h = stride;
+        param.stride_w = stride;
+        param.pad_h = pad;
+        param.pad_w = pad;
+        param.nonlineMode = nlmode;
+        param.sparse = group > 1 ? param::ConvBias::Sparse::GROUP
+                                 : param::ConvBias::Sparse::DENSE;
+
+        TensorShape src{n, ic / pack_c, h, w, pack_c};
+        TensorShape filter{oc / pack_c, ic / pack_c, kernel, kernel,
+                           pack_c,      pack_c};
+        if (is_input_nchw) {
+            src = {n, ic, h, w};
+            filter = {oc / pack_c, kernel, kernel, ic, pack_c};
+        } else if (is_chanwise) {
+            filter = {group / pack_c, 1, 1, kernel, kernel, pack_c};
+        } else if (group > 1) {
+            filter = {group,  oc / group / pack_c, ic / group / pack_c,
+                      kernel, kernel,              pack_c,
+                      pack_c};
+        }
+        TensorShape bias;
+        if (bias_mode == megdnn::BiasMode::BROADCAST_CHANNEL_BIAS) {
+            bias = {1, oc / pack_c, 1, 1, pack_c};
+        } else if (bias_mode == megdnn::BiasMode::BIAS) {
+            bias = {n, oc / pack_c, (h + 2 * pad - kernel) / stride + 1,
+                    (w + 2 * pad - kernel) / stride + 1, pack_c};
+        }
+        args.emplace_back(param, src, filter, bias);
+    };
+
+    for (auto bias_mode : {megdnn::BiasMode::NO_BIAS,
+                           megdnn::BiasMode::BROADCAST_CHANNEL_BIAS,
+                           megdnn::BiasMode::BIAS})
+        for (auto nlmode : {NLMode::IDENTITY, NLMode::RELU, NLMode::H_SWISH,
+                            NLMode::SIGMOID})
+            for (size_t kernel : kernel_vec)
+                for (size_t h : {3, 12})
+                    for (size_t w : {7, 16, 23}) {
+                        if (is_input_nchw) {
+                            for (size_t ic : {1, 3})
+                                for (size_t oc : {8, 24})
+                                    pack(2, oc, ic, h, w, kernel, 1, nlmode,
+                                         bias_mode);
+                        } else if (is_chanwise) {
+                            for (size_t group : {8, 24})
+                                pack(2, group, group, h, w, kernel, group,
+                                     nlmode, bias_mode);
+                        } else {
+                            for (size_t oc : {8, 24})
+                                for (size_t ic : {8, 16})
+                                    pack(2, oc, ic, h, w, kernel, 1, nlmode,
+                                         bias_mode);
+                            pack(1, 32, 32, h, w, kernel, 2, nlmode,
+                                 bias_mode);
+                        }
+                    }
+    return args;
+}
+
+void checker_conv_bias_nchw88(std::vector<conv_bias::TestArg> args,
+                              Handle* handle, const char* algo_name) {
+    Checker<ConvBiasForward> checker(handle);
+    checker.set_before_exec_callback(
+            conv_bias::ConvBiasAlgoChecker<ConvBiasForward>(algo_name));
+    checker.set_epsilon(1e-3);
+    for (auto&& arg : args) {
+        checker.set_param(arg.param).execs(
+                {arg.src, arg.filter, arg.bias, {}, {}});
+    }
+}
+}  // namespace
+
+TEST_F(X86_MULTI_THREADS, CONV_BIAS_DIRECT_NCHW88_F32_S1) {
+    checker_conv_bias_nchw88(
+            get_nchw88_conv_bias_args({1, 2, 3, 5, 7}, 1, false, false),
+            handle(), "X86_F32_DIRECT_NCHW88");
+}
+
+TEST_F(X86_MULTI_THREADS, CONV_BIAS_DIRECT_NCHW88_F32_S2) {
+    checker_conv_bias_nchw88(
+            get_nchw88_conv_bias_args({1, 2, 3, 5, 7}, 2, false, false),
+            handle(), "X86_F32_DIRECT_NCHW88");
+}
+
+TEST_F(X86_MULTI_THREADS, CONV_BIAS_CHANNEL_WISE_NCHW88_F32) {
+    for (size_t stride : {1, 2}) {
+        checker_conv_bias_nchw88(
+                get_nchw88_conv_bias_args({2, 3, 5, 7}, stride, false, true),
+                handle(), "X86_F32_CHANNEL_WISE_NCHW88");
+    }
+}
+
+TEST_F(X86_MULTI_THREADS, CONV_BIAS_DIRECT_NCHW_NCHW88_F32) {
+    for (size_t stride : {1, 2}) {
+        checker_conv_bias_nchw88(
+                get_nchw88_conv_bias_args({2, 3, 5, 7}, stride, true, false),
+                handle(), "X86_F32_DIRECT_NCHW_NCHW88");
+    }
+}
+/*********************************** End direct NCHW88 ********************/
 #if MEGDNN_X86_WITH_MKL_DNN
 static void x86_correctness_fp32_mkldnn_run(
         Checker<ConvBias>& checker, UniformIntRNG& rng, Handle* handle,
@@ -2557,6 +2678,63 @@ TEST_F(X86_BENCHMARK_MULTI_THREADS, BENCHMARK_CONVBIAS_DIRECTF32) {
                    {1, {4}}, data_type);
 }
 
+TEST_F(X86_BENCHMARK_MULTI_THREADS, BENCHMARK_CONVBIAS_DIRECT_NCHW88_F32) {
+    constexpr size_t RUNS = 50;
+
+    std::vector<DType> data_type = {dtype::Float32(), dtype::Float32(),
+                                    dtype::Float32(), dtype::Float32()};
+
+    auto bench_case = [&](size_t N, size_t IC, size_t OC, size_t H, size_t W,
+                          size_t FS, size_t S, size_t group) {
+        param::ConvBias param;
+        param.format = param::ConvBias::Format::NCHW88;
+        param.nonlineMode = param::ConvBias::NonlineMode::RELU;
+        param.pad_h = param.pad_w = FS / 2;
+        param.stride_h = param.stride_w = S;
+        param.sparse = group > 1 ? param::ConvBias::Sparse::GROUP
+                                 : param::ConvBias::Sparse::DENSE;
+        size_t OH = (H + FS / 2 * 2 - FS) / S + 1;
+        size_t OW = (W + FS / 2 * 2 - FS) / S + 1;
+        std::string algo_name = "X86_F32_DIRECT_NCHW88";
+        SmallVector<TensorShape> shapes{{N, IC / 8, H, W, 8},
+                                        {OC / 8, IC / 8, FS, FS, 8, 8},
+                                        {1, OC / 8, 1, 1, 8},
+                                        {},
+                                        {N, OC / 8, OH, OW, 8}};
+        if (IC < 8) {
+            algo_name = "X86_F32_DIRECT_NCHW_NCHW88";
+            shapes[0] = {N, IC, H, W};
+            shapes[1] = {OC / 8, FS, FS, IC, 8};
+        } else if (group > 1) {
+            algo_name = "X86_F32_CHANNEL_WISE_NCHW88";
+            shapes[1] = {group / 8, 1, 1, FS, FS, 8};
+        }
+        TensorShape dst{N, OC, OH, OW};
+        float computations = (IC / group * FS * FS * dst.total_nr_elems() * 2 +
+                              dst.total_nr_elems()) *
+                             1e-6;
+        std::vector<std::pair<SmallVector<TensorShape>, float>>
+                shapes_and_computation{{shapes, computations}};
+        printf("Benchmark %s algo\n", algo_name.c_str());
+        benchmark_impl(param, shapes_and_computation, algo_name, RUNS,
+                       {4, {4, 5, 6, 7}}, {1, {4}}, data_type);
+    };
+
+    bench_case(1, 64, 64, 56, 56, 3, 1, 1);
+    bench_case(1, 128, 128, 28, 28, 3, 1, 1);
+    bench_case(1, 256, 256, 14, 14, 3, 1, 1);
+    bench_case(1, 256, 64, 56, 56, 1, 1, 1);
+    bench_case(1, 64, 128, 56, 56, 3, 2, 1);
+    bench_case(1, 128, 256, 28, 28, 3, 2, 1);
+
+    bench_case(1, 3, 32, 224, 224, 3, 2, 1);
+    bench_case(1, 3, 64, 224, 224, 7, 2, 1);
+
+    bench_case(1, 144, 144, 56, 56, 3, 1, 144);
+    bench_case(1, 384, 384, 28, 28, 3, 1, 384);
+    bench_case(1, 576, 576, 14, 14, 3, 2, 576);
+}
+
 TEST_F(X86_BENCHMARK_MULTI_THREADS, BENCHMARK_CONVBIAS_IM2COL_F32) {
     constexpr size_t RUNS = 50;
 
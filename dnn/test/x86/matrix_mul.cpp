@@ -85,8 +85,50 @@ TEST_F(X86, MATRIX_MUL_AVX2_MK8_8X8) {
                                  param::MatrixMul::Format::MK8, 1, 1e-3, false);
 }
 
+TEST_F(X86, MATRIX_MUL_AVX2_F32_6X16) {
+    if (!is_supported(SIMDType::AVX2) || !is_supported(SIMDType::FMA)) {
+        std::cout << "skip X86_F32_AVX2_6X16 check for no avx2 support"
+                  << std::endl;
+        return;
+    }
+    matrix_mul::check_matrix_mul(dtype::Float32{}, dtype::Float32{},
+                                 dtype::Float32{}, handle(),
+                                 "X86_F32_AVX2_6X16");
+}
+
+TEST_F(X86, MATRIX_MUL_AVX512_F32_12X32) {
+    if (!is_supported(SIMDType::AVX512)) {
+        std::cout << "skip X86_F32_AVX512_12X32 check for no avx512 support"
+                  << std::endl;
+        return;
+    }
+    matrix_mul::check_matrix_mul(dtype::Float32{}, dtype::Float32{},
+                                 dtype::Float32{}, handle(),
+                                 "X86_F32_AVX512_12X32");
+}
+
 #if MEGDNN_WITH_BENCHMARK
 
+TEST_F(X86, BENCHMARK_MATRIX_MUL_AVX2_F32_6X16) {
+    auto args = matrix_mul::get_benchmark_matmul_args();
+    matrix_mul::benchmark_with_contrast(
+            handle(), args, dtype::Float32{}, dtype::Float32{},
+            dtype::Float32{}, "X86_F32_AVX2_6X16",
+            param::MatrixMul::Format::DEFAULT, dtype::Float32{},
+            dtype::Float32{}, dtype::Float32{}, "X86_F32_BLAS");
+}
+
+TEST_F(X86, BENCHMARK_MATRIX_MUL_AVX512_F32_12X32) {
+    if (!is_supported(SIMDType::AVX512))
+        return;
+    auto args = matrix_mul::get_benchmark_matmul_args();
+    matrix_mul::benchmark_with_contrast(
+            handle(), args, dtype::Float32{}, dtype::Float32{},
+            dtype::Float32{}, "X86_F32_AVX512_12X32",
+            param::MatrixMul::Format::DEFAULT, dtype::Float32{},
+            dtype::Float32{}, dtype::Float32{}, "X86_F32_BLAS");
+}
+
 TEST_F(X86, BENCHMARK_MATRIX_MUL_AVX2_MK8_8X8) {
     auto args = matrix_mul::get_benchmark_matmul_mk_packed_args(8);
     matrix_mul::benchmark_with_contrast(
@@ -0,0 +1,122 @@
+/**
+ * \file dnn/test/x86/reduce.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/x86/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+
+using namespace megdnn;
+using namespace test;
+
+TEST_F(X86, REDUCE) {
+    using Param = Reduce::Param;
+    using Mode = Param::Mode;
+    using DataType = Param::DataType;
+    Checker<Reduce> checker(handle());
+    UniformFloatRNG rng_float(-2, 2);
+    UniformFloatRNG rng_product(0.9, 1.1);
+    UniformIntRNG rng_int8(-100, 100);
+
+    for (auto mode : {Mode::SUM, Mode::MEAN, Mode::SUM_SQR, Mode::PRODUCT,
+                      Mode::MIN, Mode::MAX}) {
+        auto&& rng = mode == Mode::PRODUCT ? rng_product : rng_float;
+        struct Config {
+            DType dtype;
+            DataType data_type;
+            float eps;
+        };
+        std::vector<Config> configs{
+                {dtype::Float32(), DataType::DEFAULT, 1e-3f},
+                {dtype::Float32(), DataType::FLOAT_O32xC32, 1e-3f},
+                {dtype::Float32(), DataType::FLOAT_O16xC32, 1e-2f},
+                {dtype::Float16(), DataType::FLOAT_O32xC32, 1e-3f},
+                {dtype::Float16(), DataType::FLOAT_O16xC32, 1e-2f}};
+        if (mode != Mode::PRODUCT) {
+            configs.push_back({dtype::Int8(), DataType::FLOAT_O32xC32, 1e-3f});
+        }
+        for (auto&& config : configs) {
+            checker.set_dtype(0, config.dtype)
+                    .set_rng(0, config.dtype == dtype::Int8()
+                                        ? static_cast<RNG*>(&rng_int8)
+                                        : &rng)
+                    .set_epsilon(config.eps);
+            for (int32_t axis : {0, 1, 2}) {
+                for (size_t A : {1, 3}) {
+                    for (size_t B : {1, 5, 16, 33, 130}) {
+                        for (size_t C : {1, 7, 16, 70}) {
+                            Param param(mode, axis, config.data_type);
+                            checker.set_param(param).execs({{A, B, C}, {}});
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(X86, BENCHMARK_REDUCE) {
+    auto run = [&](size_t A, size_t B, size_t C, size_t axis,
+                   param::Reduce::Mode mode, param::Reduce::DataType data_type,
+                   DType dtype) {
+        auto handle_fallback = create_cpu_handle(1);
+        Benchmarker<Reduce> benchmarker(handle());
+        Benchmarker<Reduce> benchmarker_fallback(handle_fallback.get());
+        benchmarker_fallback.set_display(false);
+        benchmarker.set_display(false);
+        constexpr size_t RUNS = 50;
+        benchmarker_fallback.set_times(RUNS);
+        benchmarker.set_times(RUNS);
+        param::Reduce param(mode, axis, data_type);
+        benchmarker.set_param(param);
+        benchmarker_fallback.set_param(param);
+
+        TensorLayout src({A, B, C}, dtype), dst;
+        auto opr = handle()->create_operator<Reduce>();
+        opr->param() = param;
+        opr->deduce_layout(src, dst);
+
+        benchmarker_fallback.set_dtype(0, dtype).set_dtype(1, dst.dtype);
+        benchmarker.set_dtype(0, dtype).set_dtype(1, dst.dtype);
+        auto cur = benchmarker.execs({src, dst}) / RUNS;
+        auto fallback = benchmarker_fallback.execs({src, dst}) / RUNS;
+        float computation =
+                src.total_nr_elems() / 1024.0 / 1024.0 / 1024.0 * 1e3;
+        printf("run %s->%s: fallback: %fms %fGflops "
+               "cur: %fms %fGflops speedup=%f\n",
+               src.to_string().c_str(), dst.to_string().c_str(), fallback,
+               computation / fallback, cur, computation / cur, fallback / cur);
+    };
+
+    using Mode = param::Reduce::Mode;
+    using DataType = param::Reduce::DataType;
+    for (auto mode : {Mode::SUM, Mode::MEAN, Mode::MAX, Mode::SUM_SQR})
+        for (size_t axis : {1, 2}) {
+            printf("testcase mode %d %s\n", static_cast<int>(mode),
+                   axis == 2 ? "c == 1" : "c > 1");
+            for (auto dt : {std::make_pair(DType{dtype::Float32()},
+                                           DataType::DEFAULT),
+                            std::make_pair(DType{dtype::Float16()},
+                                           DataType::FLOAT_O32xC32),
+                            std::make_pair(DType{dtype::Int8()},
+                                           DataType::FLOAT_O32xC32)}) {
+                run(1, 1024, 49, axis, mode, dt.second, dt.first);
+                run(2, 10, 10000, axis, mode, dt.second, dt.first);
+                run(2, 100, 10000, axis, mode, dt.second, dt.first);
+                run(64, 1000, 1, axis, mode, dt.second, dt.first);
+            }
+        }
+}
+#endif
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,120 @@
+/**
+ * \file dnn/test/x86/relayout.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+#include "test/x86/fixture.h"
+
+#include "megdnn/oprs.h"
+#include "test/common/benchmarker.h"
+#include "test/common/checker.h"
+#include "test/common/relayout.h"
+
+using namespace megdnn;
+using namespace test;
+
+namespace {
+template <typename tag>
+class X86_RELAYOUT : public X86 {};
+TYPED_TEST_CASE(X86_RELAYOUT, relayout::test_types);
+TYPED_TEST(X86_RELAYOUT, run) {
+    relayout::run_test<TypeParam>(this->handle());
+}
+
+struct ReformatCase {
+    const char* name;
+    //! shape of the source before the dimshuffle
+    TensorShape shape;
+    std::vector<size_t> pattern;
+};
+
+//! layout conversions emitted by tensor_reformat, for N C H W
+std::vector<ReformatCase> reformat_cases(size_t N, size_t C, size_t H,
+                                         size_t W) {
+    return {{"nchw->nchw4", {N, C / 4, 4, H, W}, {0, 1, 3, 4, 2}},
+            {"nchw4->nchw", {N, C / 4, H, W, 4}, {0, 1, 4, 2, 3}},
+            {"nchw->nchw88", {N, C / 8, 8, H, W}, {0, 1, 3, 4, 2}},
+            {"nchw88->nchw", {N, C / 8, H, W, 8}, {0, 1, 4, 2, 3}},
+            {"nchw->nchw32", {N, C / 32, 32, H, W}, {0, 1, 3, 4, 2}},
+            {"nchw->nhwc", {N, C, H, W}, {0, 2, 3, 1}},
+            {"nhwc->nchw", {N, H, W, C}, {0, 3, 1, 2}}};
+}
+
+TensorLayoutArray make_reformat_layouts(const ReformatCase& rc, DType dtype) {
+    TensorLayout src = TensorLayout{rc.shape, dtype}.dimshuffle(rc.pattern);
+    TensorLayout dst{src, dtype};
+    return {src, dst};
+}
+}  // anonymous namespace
+
+TEST_F(X86, RELAYOUT_REFORMAT) {
+    Checker<Relayout> checker(handle());
+    for (DType dtype : std::vector<DType>{dtype::Float32(), dtype::Int8(),
+                                          dtype::Float16()}) {
+        for (size_t C : {32, 64})
+            for (size_t HW : {1, 3, 7, 16, 57}) {
+                for (auto&& rc : reformat_cases(2, C, HW, HW)) {
+                    checker.execl(make_reformat_layouts(rc, dtype));
+                }
+            }
+    }
+}
+
+TEST_F(X86, RELAYOUT_STRIDED_COPY) {
+    Checker<Relayout> checker(handle());
+    //! sub-tensors with contiguous last dim, in either direction
+    for (size_t W : {1, 5, 64, 1000}) {
+        TensorLayout noncont{{3, 4, 5, W}, dtype::Float32()};
+        noncont.stride[2] = W + 3;
+        noncont.stride[1] = noncont.stride[2] * 5 + 1;
+        noncont.stride[0] = noncont.stride[1] * 4;
+        TensorLayout cont{{3, 4, 5, W}, dtype::Float32()};
+        checker.execl({noncont, cont});
+        checker.execl({cont, noncont});
+    }
+    checker.execl({{{1024, 1024}, dtype::Float32()},
+                   {{1024, 1024}, dtype::Float32()}});
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(X86, BENCHMARK_RELAYOUT_CV) {
+    relayout::run_cv_benchmark(handle());
+}
+
+TEST_F(X86, BENCHMARK_RELAYOUT_REFORMAT) {
+    auto handle_fallback = create_cpu_handle(1);
+    constexpr size_t RUNS = 20;
+    Benchmarker<Relayout> benchmarker(handle());
+    Benchmarker<Relayout> benchmarker_fallback(handle_fallback.get());
+    benchmarker.set_display(false).set_times(RUNS);
+    benchmarker_fallback.set_display(false).set_times(RUNS);
+
+    auto run = [&](const ReformatCase& rc, DType dtype) {
+        auto layouts = make_reformat_layouts(rc, dtype);
+        auto cur = benchmarker.execl(layouts) / RUNS;
+        auto fallback = benchmarker_fallback.execl(layouts) / RUNS;
+        float bytes = 2.0 * layouts[0].total_nr_elems() * dtype.size();
+        float gbytes = bytes / (1024 * 1024 * 1024) * 1e3;
+        printf("%s %s %s: fallback: %fms %fGB/s cur: %fms %fGB/s "
+               "speedup=%f\n",
+               rc.name, dtype.name(), layouts[1].to_string().c_str(), fallback,
+               gbytes / fallback, cur, gbytes / cur, fallback / cur);
+    };
+    for (DType dtype : std::vector<DType>{dtype::Float32(), dtype::Int8()}) {
+        for (auto&& rc : reformat_cases(1, 64, 56, 56))
+            run(rc, dtype);
+        for (auto&& rc : reformat_cases(8, 256, 14, 14))
+            run(rc, dtype);
+        for (auto&& rc : reformat_cases(1, 32, 224, 224))
+            run(rc, dtype);
+    }
+}
+#endif
+
+// vim: syntax=cpp.doxygen
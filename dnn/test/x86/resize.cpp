@@ -10,7 +10,9 @@
  */
 #include "test/x86/fixture.h"
 #include "test/common/resize.h"
+#include "test/common/benchmarker.h"
 #include "test/common/checker.h"
+#include "test/common/rng.h"
 
 namespace megdnn {
 namespace test {
@@ -38,6 +40,118 @@ TEST_F(X86, RESIZE_CV)
 
 }
 
+namespace {
+void run_resize_avx2(Handle* handle) {
+    using namespace resize;
+    using IMode = param::Resize::InterpolationMode;
+    std::vector<TestArg> args = get_args();
+    param::Resize cur_param;
+    cur_param.format = param::Resize::Format::NCHW;
+    args.emplace_back(cur_param, TensorShape{2, 5, 37, 41},
+                      TensorShape{2, 5, 19, 83});
+    //! only linear NCHW is taken by the avx2 path
+    for (auto imode : {IMode::INTER_CUBIC, IMode::INTER_AREA}) {
+        cur_param.imode = imode;
+        args.emplace_back(cur_param, TensorShape{2, 5, 37, 41},
+                          TensorShape{2, 5, 19, 83});
+    }
+    //! NHWC with ch other than 1 or 3 only takes the avx2 path for linear
+    cur_param.format = param::Resize::Format::NHWC;
+    for (auto imode : {IMode::INTER_LINEAR, IMode::INTER_CUBIC,
+                       IMode::INTER_AREA}) {
+        cur_param.imode = imode;
+        for (size_t ch : {2, 4, 5, 16}) {
+            args.emplace_back(cur_param, TensorShape{2, 33, 27, ch},
+                              TensorShape{2, 16, 50, ch});
+        }
+    }
+    //! cubic and area with ch 1 or 3 follow resize_cv
+    for (auto imode : {IMode::INTER_CUBIC, IMode::INTER_AREA}) {
+        cur_param.imode = imode;
+        for (size_t ch : {1, 3}) {
+            args.emplace_back(cur_param, TensorShape{2, 33, 27, ch},
+                              TensorShape{2, 16, 50, ch});
+            args.emplace_back(cur_param, TensorShape{1, 48, 64, ch},
+                              TensorShape{1, 12, 16, ch});
+            args.emplace_back(cur_param, TensorShape{1, 50, 70, ch},
+                              TensorShape{1, 15, 22, ch});
+            args.emplace_back(cur_param, TensorShape{1, 7, 9, ch},
+                              TensorShape{1, 30, 31, ch});
+        }
+    }
+
+    Checker<Resize> checker(handle);
+    UniformIntRNG rng{0, 255};
+    for (auto&& arg : args) {
+        checker.set_param(arg.param)
+                .set_rng(0, &rng)
+                .set_dtype(0, dtype::Uint8())
+                .set_dtype(1, dtype::Uint8())
+                .set_epsilon(1 + 1e-3)
+                .execs({arg.src, arg.dst});
+    }
+    for (auto&& arg : args) {
+        checker.set_param(arg.param)
+                .set_dtype(0, dtype::Float32())
+                .set_dtype(1, dtype::Float32())
+                .set_epsilon(1e-3)
+                .execs({arg.src, arg.dst});
+    }
+}
+}  // anonymous namespace
+
+TEST_F(X86, RESIZE_AVX2) {
+    run_resize_avx2(handle());
+}
+
+TEST_F(X86_MULTI_THREADS, RESIZE_AVX2) {
+    run_resize_avx2(handle());
+}
+
+#if MEGDNN_WITH_BENCHMARK
+TEST_F(X86_BENCHMARK_MULTI_THREADS, BENCHMARK_RESIZE) {
+    constexpr size_t RUNS = 50;
+    using IMode = param::Resize::InterpolationMode;
+    TaskExecutorConfig single_thread_config{1, {0}},
+            multi_thread_config{4, {0, 1, 2, 3}};
+    auto single_thread_handle =
+            create_cpu_handle(0, true, &single_thread_config);
+    auto multi_thread_handle = create_cpu_handle(0, true, &multi_thread_config);
+    auto run = [&](param::Resize param, DType dtype, TensorShape src,
+                   TensorShape dst) {
+        Benchmarker<Resize> single(single_thread_handle.get()),
+                multi(multi_thread_handle.get());
+        for (auto bencher : {&single, &multi}) {
+            bencher->set_param(param)
+                    .set_dtype(0, dtype)
+                    .set_dtype(1, dtype)
+                    .set_times(RUNS)
+                    .set_display(false);
+        }
+        float single_time = single.execs({src, dst}) / RUNS,
+              multi_time = multi.execs({src, dst}) / RUNS;
+        printf("%s %s->%s imode=%d: single thread %.3fms, multi thread "
+               "%.3fms, speedup %.2f\n",
+               dtype.name(), src.to_string().c_str(), dst.to_string().c_str(),
+               static_cast<int>(param.imode), single_time, multi_time,
+               single_time / multi_time);
+    };
+    param::Resize param;
+    param.format = param::Resize::Format::NCHW;
+    run(param, dtype::Float32(), {1, 3, 1080, 1920}, {1, 3, 224, 224});
+    run(param, dtype::Uint8(), {1, 3, 1080, 1920}, {1, 3, 224, 224});
+    param.format = param::Resize::Format::NHWC;
+    for (auto imode : {IMode::INTER_LINEAR, IMode::INTER_CUBIC,
+                       IMode::INTER_AREA}) {
+        param.imode = imode;
+        run(param, dtype::Float32(), {1, 1080, 1920, 3}, {1, 224, 224, 3});
+        run(param, dtype::Float32(), {1, 1080, 1920, 4}, {1, 224, 224, 4});
+        run(param, dtype::Uint8(), {1, 1080, 1920, 4}, {1, 224, 224, 4});
+        run(param, dtype::Float32(), {1, 224, 224, 3}, {1, 512, 512, 3});
+    }
+}
+#endif
+
 } // namespace test
 } // namespace megdnn
 // vim: syntax=cpp.doxygen
@@ -268,6 +268,14 @@ def optimize_for_inference(dest_vars, **kwargs):
                 inference)
             * enable_fuse_preprocess: whether to fuse astype\pad channel\dimshuffle and
                 etc opr from h2d opr.
+            * enable_fuse_normalization: whether to fuse the subgraphs of softmax
+                and layer norm into single oprs for inference on cpu backend.
+            * enable_fuse_attention: whether to fuse the matmul-softmax-matmul
+                subgraph of attention into a single opr for inference on cpu
+                backend.
+            * enable_fuse_image_preprocess: whether to fuse cvt_color, resize,
+                normalization and layout transform of uint8 images into a
+                single opr for inference on cpu backend.
     """
     inference_options = GraphOptimizeOptions()
     inference_optimize_layout_transform_map = {
@@ -295,6 +303,12 @@ def optimize_for_inference(dest_vars, **kwargs):
         inference_options.fuse_conv_bias_with_z = True
     if kwargs.pop("enable_fuse_preprocess", False):
         inference_options.fuse_preprocess = True
+    if kwargs.pop("enable_fuse_normalization", False):
+        inference_options.fuse_normalization = True
+    if kwargs.pop("enable_fuse_attention", False):
+        inference_options.fuse_attention = True
+    if kwargs.pop("enable_fuse_image_preprocess", False):
+        inference_options.fuse_image_preprocess = True
 
     if kwargs:
         raise ValueError("unknown options: %s" % list(kwargs))
@@ -341,6 +355,12 @@ def deserialize_infer_option(x: int) -> Dict[str, bool]:
         ret["enable_fuse_conv_bias_with_z"] = True
     if inference_options.fuse_preprocess:
         ret["enable_fuse_preprocess"] = True
+    if inference_options.fuse_normalization:
+        ret["enable_fuse_normalization"] = True
+    if inference_options.fuse_attention:
+        ret["enable_fuse_attention"] = True
+    if inference_options.fuse_image_preprocess:
+        ret["enable_fuse_image_preprocess"] = True
 
     return ret
 
@@ -379,6 +399,8 @@ def dump_graph(
     keep_opr_name: bool = False,
     keep_param_name: bool = False,
     keep_opr_priority: bool = False,
+    param_codec: str = None,
+    param_encoding: str = None,
     strip_info_file=None,
     append_json=False,
     metadata=None
@@ -402,6 +424,11 @@ def dump_graph(
     :param keep_param_name: whether to keep param names, so param values can be
         easily manipulated after loading model
     :param keep_opr_priority: whether to keep priority setting for operators
+    :param param_codec: codec to compress param values with, currently only
+        ``"lz4"`` is supported; params are not compressed if it is None
+    :param param_encoding: weight-only encoding of float32 params, either
+        ``"float16"`` or ``"int8"``; the values are dequantized to float32 when
+        the model is loaded
     :param strip_info_file: a string for path or a file handler. if is not None,
         then the dump information for code strip would be written to ``strip_info_file``
     :param append_json: will be check when `strip_info_file` is not None. if set
@@ -443,6 +470,8 @@ def dump_graph(
         keep_opr_name,
         keep_param_name,
         keep_opr_priority,
+        param_codec or "",
+        param_encoding or "",
         metadata,
         stat,
         inputs,
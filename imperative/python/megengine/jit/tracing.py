@@ -689,6 +689,8 @@ class trace:
         keep_opr_name: bool = False,
         keep_param_name: bool = False,
         keep_opr_priority: bool = False,
+        param_codec: str = None,
+        param_encoding: str = None,
         strip_info_file=None,
         append_json=False,
         optimize_for_inference=True,
@@ -714,6 +716,11 @@ class trace:
         :param keep_param_name: whether to keep param names, so param values can be
             easily manipulated after loading model
         :param keep_opr_priority: whether to keep priority setting for operators
+        :param param_codec: codec to compress param values with, currently only
+            ``"lz4"`` is supported; params are not compressed if it is None
+        :param param_encoding: weight-only encoding of float32 params, either
+            ``"float16"`` or ``"int8"``; the values are dequantized to float32
+            when the model is loaded
         :param strip_info_file: a string for path or a file handler. if is not None,
             then the dump information for code strip would be written to ``strip_info_file``
         :param append_json: will be check when `strip_info_file` is not None. if set
@@ -903,6 +910,8 @@ class trace:
             keep_opr_name=keep_opr_name,
             keep_param_name=keep_param_name,
             keep_opr_priority=keep_opr_priority,
+            param_codec=param_codec,
+            param_encoding=param_encoding,
             strip_info_file=strip_info_file,
             append_json=append_json,
             metadata=metadata,
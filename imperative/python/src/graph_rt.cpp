@@ -259,6 +259,9 @@ void init_graph_rt(py::module m) {
         .def_readwrite("fuse_conv_bias_nonlinearity", &_OptimizeForInferenceOptions::fuse_conv_bias_nonlinearity)
         .def_readwrite("fuse_conv_bias_with_z", &_OptimizeForInferenceOptions::fuse_conv_bias_with_z)
         .def_readwrite("fuse_preprocess", &_OptimizeForInferenceOptions::fuse_preprocess)
+        .def_readwrite("fuse_normalization", &_OptimizeForInferenceOptions::fuse_normalization)
+        .def_readwrite("fuse_attention", &_OptimizeForInferenceOptions::fuse_attention)
+        .def_readwrite("fuse_image_preprocess", &_OptimizeForInferenceOptions::fuse_image_preprocess)
         .def_readwrite("layout_transform", &_OptimizeForInferenceOptions::layout_transform)
         ;
 
@@ -340,6 +343,8 @@ void init_graph_rt(py::module m) {
         bool keep_opr_name,
         bool keep_param_name,
         bool keep_opr_priority,
+        const std::string& param_codec,
+        const std::string& param_encoding,
         std::optional<_SerializationMetadata> metadata,
         py::list& stat,
         py::list& inputs,
@@ -352,6 +357,22 @@ void init_graph_rt(py::module m) {
 
         ser::GraphDumper::DumpConfig config{keep_var_name, keep_param_name,
                                        keep_opr_priority, keep_opr_name};
+        using ParamCompression = ser::GraphDumpConfig::ParamCompression;
+        auto&& compression = config.param_compression;
+        if (param_codec == "lz4") {
+            compression.codec = ParamCompression::Codec::LZ4;
+        } else {
+            mgb_assert(param_codec.empty(), "unknown param codec: %s",
+                       param_codec.c_str());
+        }
+        if (param_encoding == "float16") {
+            compression.encoding = ParamCompression::Encoding::FLOAT16;
+        } else if (param_encoding == "int8") {
+            compression.encoding = ParamCompression::Encoding::INT8;
+        } else {
+            mgb_assert(param_encoding.empty(), "unknown param encoding: %s",
+                       param_encoding.c_str());
+        }
 
         ser::GraphDumper::DumpResult rst;
         if (metadata)
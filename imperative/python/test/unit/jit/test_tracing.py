@@ -223,6 +223,34 @@ def test_capture_dump():
     np.testing.assert_equal(result[0], y)
 
 
+@pytest.mark.parametrize(
+    "param_codec, param_encoding, tol",
+    [("lz4", None, 0), (None, "float16", 1e-3), ("lz4", "int8", 5e-2)],
+)
+def test_dump_compressed_params(param_codec, param_encoding, tol):
+    a = tensor(np.random.randn(64, 32).astype("float32"))
+
+    @trace(symbolic=True, capture_as_const=True)
+    def f(x):
+        return x * a
+
+    x = tensor(np.random.randn(64, 32).astype("float32"))
+    y = f(x).numpy()
+
+    file = io.BytesIO()
+    raw_bytes = f.dump(file).tensor_value_bytes
+    file = io.BytesIO()
+    dump_info = f.dump(
+        file, param_codec=param_codec, param_encoding=param_encoding
+    )
+    if param_encoding is not None:
+        assert dump_info.tensor_value_bytes < raw_bytes
+    file.seek(0)
+    infer_cg = cgtools.GraphInference(file)
+    result = list((infer_cg.run(x)).values())[0]
+    np.testing.assert_allclose(result, y, atol=tol * 4, rtol=tol)
+
+
 def test_dump_volatile():
     p = tensor([2])
 
@@ -0,0 +1,274 @@
+/**
+ * \file imperative/src/impl/interpreter/command_queue.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "megbrain/common.h"
+#include "megbrain/exception.h"
+#include "megbrain/utils/metahelper.h"
+
+namespace mgb::imperative::interpreter::intl {
+
+/*!
+ * \brief bounded lock-free single-producer single-consumer queue served by a
+ *      worker thread
+ *
+ * The producer fills slots of a ring with push() and makes all the pushed
+ * tasks visible with a single release store in flush_push(), so a batch of
+ * commands costs one publication. The worker takes every published task at
+ * once and hands them to TaskImpl::dispatch_tasks(), a dispatch loop which
+ * may run several consecutive tasks; finished tasks are committed per call
+ * rather than per task.
+ *
+ * Neither side takes a lock on the fast path: the worker spins for a while
+ * before it parks, and the producer only touches the mutex if the worker has
+ * parked. When the ring is full, the producer publishes what it has pushed
+ * and waits for free slots.
+ *
+ * The worker is started when the first task is published.
+ *
+ * push() and flush_push() must not be called by two threads at the same time.
+ *
+ * \tparam Param a task
+ * \tparam TaskImpl a subclass that provides the following public method:
+ *
+ *      //! run tasks starting from begin one by one, and return the number
+ *      //! of finished tasks, which must be at least 1
+ *      size_t dispatch_tasks(Param* begin, Param* end);
+ */
+template <typename Param, class TaskImpl>
+class BatchedCommandQueue : public NonCopyableObj {
+public:
+    //! \param capacity_log2 the ring has (1 << capacity_log2) slots
+    //! \param max_spin rounds the worker polls before it parks
+    explicit BatchedCommandQueue(size_t capacity_log2 = 12,
+                                 size_t max_spin = 4096)
+            : m_capacity{size_t(1) << capacity_log2},
+              m_max_spin{max_spin},
+              m_slots{new Slot[m_capacity]} {}
+
+    //! fill a slot without making it visible to the worker
+    void push(Param&& param) {
+        if (m_write - m_head_cache >= m_capacity) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (m_write - m_head_cache >= m_capacity) {
+                flush_push();
+                wait_finish(m_write - m_capacity + 1);
+                m_head_cache = m_head.load(std::memory_order_acquire);
+            }
+        }
+        new (slot(m_write)) Param(std::move(param));
+        ++m_write;
+    }
+
+    //! publish the pushed tasks to the worker
+    void flush_push() {
+        if (m_write == m_published) {
+            return;
+        }
+        if (!m_worker.joinable()) {
+            m_worker = std::thread{&BatchedCommandQueue::worker_impl, this};
+        }
+        m_published = m_write;
+        m_tail.store(m_write, std::memory_order_release);
+        // pair with the fence in the worker before it parks
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_worker_parked.load(std::memory_order_relaxed)) {
+            MGB_LOCK_GUARD(m_mtx);
+            m_cv_task.notify_one();
+        }
+    }
+
+    void add_task(Param&& param) {
+        push(std::move(param));
+        flush_push();
+    }
+
+    /*!
+     * \brief wait for the worker to process all published tasks
+     *
+     * Note: an exception thrown by the worker would be rethrown here
+     */
+    void wait_all_task_finish() {
+        wait_finish(m_published);
+        check_exception();
+    }
+
+    //! rethrow the exception caught in the worker
+    void check_exception() {
+#if MGB_ENABLE_EXCEPTION
+        if (m_worker_exc) {
+            std::exception_ptr exc;
+            std::swap(m_worker_exc, exc);
+            std::rethrow_exception(exc);
+        }
+#endif
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+protected:
+    ~BatchedCommandQueue() noexcept {
+        if (m_worker.joinable()) {
+            {
+                MGB_LOCK_GUARD(m_mtx);
+                m_stop = true;
+                m_cv_task.notify_one();
+            }
+            m_worker.join();
+        }
+        // tasks pushed but never published
+        for (size_t i = m_head.load(); i != m_write; ++i) {
+            slot(i)->~Param();
+        }
+    }
+
+    /*!
+     * \brief callback when worker thread starts; this function is
+     *      invoked from the worker thread
+     */
+    virtual void on_async_queue_worker_thread_start() {}
+
+private:
+    using Slot = typename std::aligned_storage<sizeof(Param),
+                                               alignof(Param)>::type;
+    //! keep the indices written by different threads on different lines
+    static constexpr size_t CACHE_LINE = 64;
+
+    const size_t m_capacity;
+    const size_t m_max_spin;
+    std::unique_ptr<Slot[]> m_slots;
+
+    //! only accessed by the producer
+    size_t m_write = 0, m_published = 0, m_head_cache = 0;
+    //! end of the published tasks
+    alignas(CACHE_LINE) std::atomic_size_t m_tail{0};
+    //! end of the finished tasks
+    alignas(CACHE_LINE) std::atomic_size_t m_head{0};
+    alignas(CACHE_LINE) std::atomic_bool m_worker_parked{false};
+    std::atomic_bool m_producer_waiting{false};
+    bool m_stop = false;
+    std::mutex m_mtx;
+    std::condition_variable m_cv_task, m_cv_finished;
+    std::thread m_worker;
+#if MGB_ENABLE_EXCEPTION
+    std::exception_ptr m_worker_exc;
+#endif
+
+    Param* slot(size_t idx) {
+        return aliased_ptr<Param>(&m_slots[idx & (m_capacity - 1)]);
+    }
+
+    static void cpu_relax() {
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    //! wait until m_head reaches target
+    void wait_finish(size_t target) {
+        for (size_t spin = 0;
+             m_head.load(std::memory_order_acquire) < target; ++spin) {
+            if (spin < m_max_spin) {
+                cpu_relax();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_producer_waiting.store(true, std::memory_order_relaxed);
+            // pair with the fence in commit()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_cv_finished.wait(lock, [&]() {
+                return m_head.load(std::memory_order_acquire) >= target;
+            });
+            m_producer_waiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    //! wait for tasks after head; return head if the worker should exit
+    size_t wait_task(size_t head) {
+        for (size_t spin = 0;; ++spin) {
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            if (tail != head) {
+                return tail;
+            }
+            if (spin < m_max_spin) {
+                cpu_relax();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_worker_parked.store(true, std::memory_order_relaxed);
+            // pair with the fence in flush_push()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_cv_task.wait(lock, [&]() {
+                return m_stop ||
+                       m_tail.load(std::memory_order_acquire) != head;
+            });
+            m_worker_parked.store(false, std::memory_order_relaxed);
+            if (m_stop && m_tail.load(std::memory_order_acquire) == head) {
+                return head;
+            }
+            spin = 0;
+        }
+    }
+
+    void commit(size_t head) {
+        m_head.store(head, std::memory_order_release);
+        // pair with the fence in wait_finish()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producer_waiting.load(std::memory_order_relaxed)) {
+            MGB_LOCK_GUARD(m_mtx);
+            m_cv_finished.notify_all();
+        }
+    }
+
+    void worker_impl() {
+        on_async_queue_worker_thread_start();
+        size_t head = 0;
+        for (;;) {
+            size_t tail = wait_task(head);
+            if (tail == head) {
+                return;
+            }
+            while (head != tail) {
+                // tasks passed to dispatch_tasks() are contiguous in memory
+                size_t offset = head & (m_capacity - 1),
+                       nr = std::min(tail - head, m_capacity - offset);
+                Param* begin = slot(head);
+                size_t nr_done = 1;
+                MGB_TRY {
+                    nr_done = static_cast<TaskImpl*>(this)->dispatch_tasks(
+                            begin, begin + nr);
+                    mgb_assert(nr_done >= 1 && nr_done <= nr);
+                }
+                MGB_CATCH_ALL_EXCEPTION("BatchedCommandQueue", m_worker_exc);
+                for (size_t i = 0; i < nr_done; ++i) {
+                    begin[i].~Param();
+                }
+                head += nr_done;
+                commit(head);
+            }
+        }
+    }
+};
+
+}  // namespace mgb::imperative::interpreter::intl
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
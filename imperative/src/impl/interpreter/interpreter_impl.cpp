@@ -811,26 +811,32 @@ bool ChannelImpl::check_available() {
 }
 
 TensorPtr ChannelImpl::wait_tensor(TensorInfo* info, TensorProp prop) {
+    bool require_host = prop == TensorProp::HostValue;
+    auto value_fetched = [&]() {
+        return info->ptr && info->ptr->value_fetched();
+    };
+    if (require_host) {
+        bool fetched;
+        {
+            MGB_LOCK_GUARD(m_mutex);
+            fetched = value_fetched();
+        }
+        // enqueue without m_mutex, since the producer may wait for the
+        // worker when the command queue is full
+        if (!fetched) {
+            m_buffer.enqueue(GetValue{info});
+        }
+    }
     m_buffer.flush();
     std::unique_lock<decltype(m_mutex)> lock(m_mutex);
     mgb_assert(!m_waitee, "duplicate waitee");
     m_waitee = info;
     m_waitee_id = Profiler::next_id();
     RECORD_EVENT(TensorWaitPropEvent, info->id, m_waitee_id, prop);
-    bool require_host = prop == TensorProp::HostValue;
-    bool value_fetching = false;
     m_cv.wait(lock, [&]() {
         check_worker_exc_unsafe();
         if (require_host) {
-            if (info->ptr && info->ptr->value_fetched()) {
-                return true;
-            }
-            if (!value_fetching) {
-                m_buffer.enqueue(GetValue{info});
-                m_buffer.flush();
-                value_fetching = true;
-            }
-            return false;
+            return value_fetched();
         } else {
             return static_cast<bool>(info->ptr);
         }
@@ -1109,6 +1115,22 @@ void ChannelImpl::process_one_task(IdentifiedCommand& icmd) {
     }, icmd.second);
 }
 
+size_t ChannelImpl::dispatch_tasks(IdentifiedCommand* begin,
+                                   IdentifiedCommand* end) {
+    // a dispatch loop over the commands taken at once: each command still
+    // launches its own kernels, only the queue commits once per call rather
+    // than once per command
+    auto& state = get_worker_state();
+    auto iter = begin;
+    process_one_task(*iter++);
+    // a failing command must end the call when exceptions are not caught,
+    // so that the queue knows which commands have been processed
+    while (iter != end && state.options.catch_worker_execption) {
+        process_one_task(*iter++);
+    }
+    return iter - begin;
+}
+
 void ChannelImpl::check_worker_exc_unsafe() {
     if (m_worker_exc) {
         // for reuse interpreter_for_py after some exception tests
@@ -1138,8 +1160,10 @@ void ChannelImpl::CommandBuffer::flush(Handle pos) {
         if (Profiler::is_profiling()) {
             mgb_log_debug("%s Flushed", to_string(*iter).c_str());
         }
-        m_owner->m_worker.add_task(IdentifiedCommand{Profiler::next_id(), std::move(*iter)});
+        m_owner->m_worker.push(IdentifiedCommand{Profiler::next_id(), std::move(*iter)});
     }
+    // the flushed commands are handed to the worker as one batch
+    m_owner->m_worker.flush_push();
     m_commands.erase(m_commands.begin(), pos);
 }
 
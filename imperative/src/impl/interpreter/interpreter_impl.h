@@ -23,6 +23,7 @@
 #include "megbrain/imperative/interpreter.h"
 #include "megbrain/imperative/profiler.h"
 
+#include "./command_queue.h"
 #include "./commands.h"
 #include "./tensor_info.h"
 #include "./option_manager.h"
@@ -91,6 +92,8 @@ private:
     void notify_tensor_unsafe(TensorInfo* info);
 
     void process_one_task(IdentifiedCommand&);
+    //! run the commands taken by the worker at once, one by one
+    size_t dispatch_tasks(IdentifiedCommand* begin, IdentifiedCommand* end);
 
     void check_worker_exc_unsafe();
 
@@ -148,17 +151,19 @@ private:
 
     bool m_closed = false;
 
-    struct WorkQueue : AsyncQueueSC<IdentifiedCommand, WorkQueue> {
-        // set max_spin=0 to prevent Queue fetch task in busy wait manner.
-        // this won't affect throughput when python interpreter is sending enough task,
-        // but will significantly save CPU time when waiting for task, e.g. wait for data input
-        // limit pending tasks to 1000000
+    struct WorkQueue : BatchedCommandQueue<IdentifiedCommand, WorkQueue> {
+        // the worker polls for a short while before it parks, which keeps
+        // tiny ops from paying a wake-up each, but does not burn CPU time
+        // when waiting for task, e.g. wait for data input.
+        // at most 4096 pending commands, the producer waits when it is full
         WorkQueue(ChannelImpl* owner)
-                : AsyncQueueSC<IdentifiedCommand, WorkQueue>(0, 1000000), m_owner(owner) {
+                : BatchedCommandQueue<IdentifiedCommand, WorkQueue>(12),
+                  m_owner(owner) {
             sys::set_thread_name("interpreter");
         }
-        void process_one_task(IdentifiedCommand& icmd) {
-            m_owner->process_one_task(icmd);
+        size_t dispatch_tasks(IdentifiedCommand* begin,
+                              IdentifiedCommand* end) {
+            return m_owner->dispatch_tasks(begin, end);
         }
         void on_async_queue_worker_thread_start() override {
             sys::set_thread_name("worker");
@@ -16,15 +16,18 @@
 #include "megbrain/opr/basic_arith.h"
 #include "megbrain/opr/blas.h"
 #include "megbrain/opr/dnn/adaptive_pooling.h"
+#include "megbrain/opr/dnn/attention.h"
 #include "megbrain/opr/dnn/convolution.h"
 #include "megbrain/opr/dnn/correlation.h"
 #include "megbrain/opr/dnn/fake_quant.h"
 #include "megbrain/opr/dnn/images2neibs.h"
+#include "megbrain/opr/dnn/layer_norm.h"
 #include "megbrain/opr/dnn/local.h"
 #include "megbrain/opr/dnn/lsq.h"
 #include "megbrain/opr/dnn/pooling.h"
 #include "megbrain/opr/dnn/roi_align.h"
 #include "megbrain/opr/dnn/roi_pooling.h"
+#include "megbrain/opr/dnn/softmax.h"
 #include "megbrain/opr/dnn/tqt.h"
 #include "megbrain/opr/imgproc.h"
 #include "megbrain/opr/indexing.h"
@@ -673,4 +676,65 @@ OP_TRAIT_REG(SlidingWindowTranspose, SlidingWindowTranspose)
     .fallback();
 }} // sliding_window_transpose
 
+namespace { namespace layer_norm {
+cg::OperatorNodeBase* apply_on_var_node(
+        const OpDef& def,
+        const VarNodeArray& inputs) {
+    auto&& op = static_cast<const LayerNorm&>(def);
+    size_t nr_inp = inputs.size();
+    OperatorNodeConfig config{op.make_name()};
+    if (op.affine) {
+        mgb_assert(nr_inp == 3,
+                   "affine LayerNorm expects 3 inputs; got %lu actually",
+                   nr_inp);
+        return opr::LayerNorm::make(
+            inputs[0], inputs[1], inputs[2], op.param(), config)[0]
+            .node()->owner_opr();
+    } else {
+        mgb_assert(nr_inp == 1,
+                   "LayerNorm expects 1 input; got %lu actually", nr_inp);
+        return opr::LayerNorm::make(inputs[0], op.param(), config)[0]
+            .node()->owner_opr();
+    }
+}
+OP_TRAIT_REG(LayerNorm, LayerNorm)
+    .apply_on_var_node(apply_on_var_node)
+    .fallback();
+}} // layer_norm
+
+namespace { namespace softmax {
+auto apply_on_var_node(
+        const OpDef& def,
+        const VarNodeArray& inputs) {
+    auto&& op = static_cast<const Softmax&>(def);
+    mgb_assert(inputs.size() == 1);
+    OperatorNodeConfig config{op.make_name()};
+    return opr::Softmax::make(inputs[0], op.param(), config);
+}
+OP_TRAIT_REG(Softmax, Softmax)
+    .apply_on_var_node(apply_on_var_node)
+    .fallback();
+}} // softmax
+
+namespace { namespace attention {
+auto apply_on_var_node(
+        const OpDef& def,
+        const VarNodeArray& inputs) {
+    auto&& op = static_cast<const Attention&>(def);
+    size_t nr_inp = inputs.size();
+    OperatorNodeConfig config{op.make_name()};
+    if (nr_inp == 4) {
+        return opr::Attention::make(
+            inputs[0], inputs[1], inputs[2], inputs[3], op.param(), config);
+    }
+    mgb_assert(nr_inp == 3,
+               "Attention expects 3 or 4 inputs; got %lu actually", nr_inp);
+    return opr::Attention::make(
+        inputs[0], inputs[1], inputs[2], op.param(), config);
+}
+OP_TRAIT_REG(Attention, Attention)
+    .apply_on_var_node(apply_on_var_node)
+    .fallback();
+}} // attention
+
 } // namespace mgb::imperative
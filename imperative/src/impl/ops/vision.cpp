@@ -30,5 +30,22 @@ OP_TRAIT_REG(CvtColor, CvtColor)
     .apply_on_var_node(apply_on_var_node)
     .fallback();
 }
+
+namespace {
+namespace image_preprocess {
+auto apply_on_var_node(
+        const OpDef& def,
+        const VarNodeArray& inputs) {
+    auto&& op = static_cast<const ImagePreprocess&>(def);
+    mgb_assert(inputs.size() == 1);
+    OperatorNodeConfig config{op.dtype};
+    config.name(op.make_name());
+    return opr::ImagePreprocess::make(inputs[0], op.param(), config);
+}
+OP_TRAIT_REG(ImagePreprocess, ImagePreprocess)
+    .apply_on_var_node(apply_on_var_node)
+    .fallback();
+}  // namespace image_preprocess
+}  // namespace
 }
 }
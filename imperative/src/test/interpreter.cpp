@@ -0,0 +1,133 @@
+/**
+ * \file imperative/src/test/interpreter.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "./helper.h"
+#include "megbrain/imperative/interpreter.h"
+#include "megbrain/imperative/ops/autogen.h"
+#include "megbrain/utils/timer.h"
+
+#include "../impl/interpreter/command_queue.h"
+
+using namespace mgb;
+using namespace imperative;
+using namespace interpreter;
+
+namespace {
+class IntQueue final
+        : public intl::BatchedCommandQueue<std::unique_ptr<int>, IntQueue> {
+public:
+    IntQueue(size_t capacity_log2, size_t max_spin)
+            : BatchedCommandQueue(capacity_log2, max_spin) {}
+
+    //! take at most 3 tasks at a time, and throw on negative values
+    size_t dispatch_tasks(std::unique_ptr<int>* begin,
+                         std::unique_ptr<int>* end) {
+        size_t nr = std::min<size_t>(end - begin, 3);
+        for (size_t i = 0; i < nr; ++i) {
+            mgb_assert(*begin[i] >= 0);
+            values.push_back(*begin[i]);
+        }
+        return nr;
+    }
+
+    std::vector<int> values;
+};
+}  // anonymous namespace
+
+TEST(TestInterpreter, CommandQueue) {
+    constexpr int NR_TASK = 10000;
+    for (size_t max_spin : {0_z, 100_z}) {
+        // a ring of 4 slots is full most of the time
+        for (size_t capacity_log2 : {2_z, 12_z}) {
+            IntQueue queue{capacity_log2, max_spin};
+            for (int i = 0; i < NR_TASK;) {
+                for (int j = 0; j <= i % 7 && i < NR_TASK; ++j) {
+                    queue.push(std::make_unique<int>(i++));
+                }
+                queue.flush_push();
+            }
+            queue.wait_all_task_finish();
+            ASSERT_EQ(static_cast<size_t>(NR_TASK), queue.values.size());
+            for (int i = 0; i < NR_TASK; ++i) {
+                ASSERT_EQ(i, queue.values[i]);
+            }
+
+            // the worker goes on after a failed task
+            queue.add_task(std::make_unique<int>(-1));
+            queue.add_task(std::make_unique<int>(NR_TASK));
+            ASSERT_THROW(queue.wait_all_task_finish(), MegBrainError);
+            ASSERT_EQ(NR_TASK, queue.values.back());
+        }
+    }
+}
+
+TEST(TestInterpreter, ElemwiseChain) {
+    constexpr size_t NR_OP = 500;
+    auto cn = CompNode::load("xpux");
+    HostTensorGenerator<> gen;
+    auto host_x = gen({23}, cn);
+    auto channel = Interpreter::inst().create_channel();
+    auto op = std::shared_ptr<OpDef>(Elemwise::make(Elemwise::Mode::ADD));
+    auto x = channel->put(*host_x, false);
+    auto y = x;
+    // y = x * (NR_OP + 1), with the intermediate results deleted right away
+    for (size_t i = 0; i < NR_OP; ++i) {
+        auto z = channel->apply_op(op, {y, x})[0];
+        if (y != x) {
+            channel->del(y);
+        }
+        y = z;
+    }
+    auto host_y = channel->get_value(y);
+    auto px = host_x->ptr<float>(), py = host_y.ptr<float>();
+    for (size_t i = 0; i < 23; ++i) {
+        ASSERT_FLOAT_EQ(px[i] * (NR_OP + 1), py[i]);
+    }
+    channel->del(x);
+    channel->del(y);
+    channel->close();
+}
+
+TEST(TestInterpreter, BenchmarkDispatch) {
+    constexpr size_t NR_OP = 20000;
+    auto cn = CompNode::load("xpux");
+    HostTensorGenerator<> gen;
+    auto channel = Interpreter::inst().create_channel();
+    auto op = std::shared_ptr<OpDef>(Elemwise::make(Elemwise::Mode::ADD));
+    auto x = channel->put(*gen({1}, cn), false);
+    auto run = [&]() {
+        auto y = x;
+        for (size_t i = 0; i < NR_OP; ++i) {
+            auto z = channel->apply_op(op, {y, x})[0];
+            if (y != x) {
+                channel->del(y);
+            }
+            y = z;
+        }
+        return y;
+    };
+    // warm up
+    channel->del(run());
+    channel->sync();
+
+    RealTimer timer;
+    auto y = run();
+    auto dispatch = timer.get_msecs() * 1e3 / NR_OP;
+    channel->sync();
+    auto total = timer.get_msecs() * 1e3 / NR_OP;
+    mgb_log("%zu tiny elemwise ops: dispatch %.3fus/op, end-to-end %.3fus/op",
+            NR_OP, dispatch, total);
+    channel->del(y);
+    channel->del(x);
+    channel->close();
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -79,6 +79,17 @@ R"__usage__(
     will be the thread number. for example:--multi-thread-core-ids "0,1,2,3", the
     number thread if 4,the main thread binding the last core '3',
     for best performance, the main thread should binding to the fast core.
+  --work-stealing
+    Use the work stealing thread pool for multithread comp nodes. It must be
+    given before --multithread, --multithread-default and
+    --multi-thread-core-ids.
+  --hybrid-dispatch
+    Use the hybrid-core aware thread pool for multithread comp nodes, which
+    binds the threads to the fastest cores and splits the tasks by the
+    capacity of the cores (big.LITTLE or P/E-cores). When given together with
+    --multi-thread-core-ids, the threads are bound to the given cores and
+    weighted by their capacity. It must be given before --multithread,
+    --multithread-default and --multi-thread-core-ids.
   --profile|--profile-host <output>
     Write profiling result to given file. The output file is in JSON format and
     can be processed by scripts in MegHair/utils/debug.
@@ -123,6 +134,21 @@ R"__usage__(
   --disable-mem-opt
     Disable memory optimizations. This is used to check whether memory
     optimization is the cause for unexpected behavior.
+  --static-plan-cache <MiB>
+    Cache the static memory allocation plans of recently seen input shapes in
+    at most the given host memory, so switching back to a known shape skips
+    the allocation solver.
+  --static-mem-opt <msecs>
+    Spend up to the given time on improving each static memory allocation plan
+    by local search over the heuristic results. The peak memory of the
+    heuristics and the saving are shown by --get-static-mem-info.
+  --shape-switch <shapes>
+    Cycle through several input shape sets and report the latency of the
+    first run after each shape switch, compared to the steady run time. Sets
+    are separated by ';', and vars in a set by '@', e.g.
+    --shape-switch "data:1x3x224x224;data:8x3x224x224@im_info:8x3". Each set
+    is run --iter rounds; combine with --static-plan-cache to measure the
+    plan cache.
   --fake-first
     Enable fake exec for the first run. In fake exec mode, some initialization
     job would be done, but no actual computing is performed. This can be used in
@@ -135,6 +161,17 @@ R"__usage__(
   --share-param-mem
     Share the memory used by model params with model storage. This can be used
     to reduce memory usage when computing on CPU.
+  --mmap-model
+    Load the model through a memory mapping of the model file. Params that are
+    suitably aligned in the file are used in place, and processes loading the
+    same model share the physical pages. Ignored if --share-param-mem is given.
+  --load-threads <num>
+    Number of threads to decode compressed params, or to load params with
+    --parallel-load, while loading the model. The default value 0 means the
+    number of CPU cores.
+  --parallel-load
+    Index all params of the model first, and then read, decode and copy them
+    on worker threads while the operators are being constructed.
   --record-comp-seq | --record-comp-seq2
     Record the computing sequence, in level 1 or 2. It reduces overhead of API
     calls of some asynchronous computing devices, especially for OpenCL. In
@@ -165,6 +202,11 @@ R"__usage__(
 R"__usage__(
   --fast-run-algo-policy <path>
     It will read the cache file before profile, and save new fastrun in cache file.
+  --fast-run-shared-cache <path>
+    Like --fast-run-algo-policy, but the cache file is read lazily and new
+    fastrun results are appended immediately, so it can be shared by all
+    processes on a host. Entries are tagged with the version of MegEngine and
+    the CPU, and entries of other versions are ignored.
   --fast-run-shared-batch-size
     Set the batch size used during fastrun, Note that it may not be the same as the actual running batch size
   --binary-equal-between-batch
@@ -242,6 +284,18 @@ R"__usage__(
   --enable-fuse-preprocess
     Fusion astype\pad_channel\dimshuffle and etc opr from h2d op
 )__usage__"
+R"__usage__(
+  --enable-fuse-normalization
+    Fuse the subgraphs of softmax and layer norm into single oprs on CPU
+)__usage__"
+R"__usage__(
+  --enable-fuse-attention
+    Fuse the matmul-softmax-matmul subgraph of attention into a single opr on CPU
+)__usage__"
+R"__usage__(
+  --enable-fuse-image-preprocess
+    Fuse cvt_color\resize\normalization\layout transform of uint8 images into a single opr on CPU
+)__usage__"
 R"__usage__(
   --enable-nchw64
     Execute operators with kernels implemented in MegDNN with NCHW64 tensor format. Can only be used
@@ -536,12 +590,14 @@ struct Args {
     bool display_model_info = false;
     bool disable_assert_throw = false;
     bool share_param_mem = false;
+    bool mmap_model = false;
 #if MGB_ENABLE_FASTRUN
     bool use_full_run = false;
     bool use_fast_run = false;
 #endif
     bool reproducible = false;
     std::string fast_run_cache_path;
+    std::string fast_run_shared_cache_path;
 #ifndef __IN_TEE_ENV__
     std::string static_mem_svg_path;
 #endif
@@ -552,6 +608,7 @@ struct Args {
     int multithread_number = 1;
     size_t workspace_limit = SIZE_MAX;
     std::vector<std::string> data_files;
+    std::vector<std::vector<std::pair<std::string, TensorShape>>> shape_sets;
     serialization::GraphLoader::LoadResult load_ret;
 #if MGB_ENABLE_JSON
     std::unique_ptr<GraphProfiler> profiler;
@@ -680,21 +737,24 @@ void format_and_print(const std::string& tablename, const Args& env) {
 void run_test_st(Args &env) {
     std::unique_ptr<serialization::InputFile> inp_file;
 
+    FILE *fin = fopen(env.model_path.c_str(), "rb");
+    mgb_assert(fin, "failed to open %s: %s", env.model_path.c_str(),
+            strerror(errno));
+    auto model_size = get_file_size(fin);
     if (env.share_param_mem) {
-        FILE *fin = fopen(env.model_path.c_str(), "rb");
-        mgb_assert(fin, "failed to open %s: %s", env.model_path.c_str(),
-                strerror(errno));
-        auto size = get_file_size(fin);
+        auto size = model_size;
         void *ptr = malloc(size);
         std::shared_ptr<void> buf{ptr, free};
         auto nr = fread(buf.get(), 1, size, fin);
         mgb_assert(nr == size);
-        fclose(fin);
         inp_file = serialization::InputFile::make_mem_proxy(buf, size);
+    } else if (env.mmap_model) {
+        inp_file = serialization::InputFile::make_mmap(env.model_path.c_str());
     } else {
         inp_file = serialization::InputFile::make_fs(
                 env.model_path.c_str());
     }
+    fclose(fin);
     auto nr_test = read_nr_test(*inp_file);
 
     auto format =
@@ -710,7 +770,23 @@ void run_test_st(Args &env) {
     // graph is no longer needed; reset so memory can be reclaimed
     env.load_config.comp_graph.reset();
 
-    printf("load model: %.3fms\n", timer.get_msecs_reset());
+    auto load_time = timer.get_msecs_reset();
+    printf("load model: %.3fms\n", load_time);
+    printf("model size: %.3fMiB, load throughput: %.3fMiB/s\n",
+           model_size / 1048576.0,
+           model_size / 1048576.0 / std::max(load_time, 1e-3) * 1e3);
+    {
+        auto&& t = env.load_ret.phase_time;
+        printf("load phases: read graph %.3fms, index tensors %.3fms, load "
+               "oprs %.3fms, wait tensors %.3fms, copy to device %.3fms\n",
+               t.read_graph, t.index_tensors, t.load_oprs, t.wait_tensors,
+               t.copy_to_device);
+        if (env.load_config.parallel_tensor_load &&
+            !env.load_ret.parallel_tensor_load) {
+            printf("parallel tensor load not used; tensor values were loaded "
+                   "sequentially\n");
+        }
+    }
 
     // compile function to compute all outputs
     ComputingGraph::OutputSpec out_spec;
@@ -773,7 +849,14 @@ void run_test_st(Args &env) {
     strategy = S::HEURISTIC | strategy;
 #endif
     mgb::gopt::modify_opr_algo_strategy_inplace(vars, strategy);
-    if (!env.fast_run_cache_path.empty()) {
+    if (!env.fast_run_shared_cache_path.empty()) {
+        PersistentCache::set_impl(std::make_shared<FilePersistentCache>(
+                env.fast_run_shared_cache_path));
+#if MGB_ENABLE_FASTRUN
+        if (!env.use_full_run && !env.use_fast_run)
+#endif
+            mgb::gopt::enable_opr_use_profiling_cache_inplace(vars);
+    } else if (!env.fast_run_cache_path.empty()) {
 #if MGB_ENABLE_FASTRUN
         if (!access(env.fast_run_cache_path.c_str(), F_OK)) {
 #else
@@ -964,6 +1047,47 @@ void run_test_st(Args &env) {
         }
 
         printf("=== total time: %.3fms\n", tot_time);
+    } else if (!env.shape_sets.empty()) {
+        mgb_assert(!env.c_opr_args.is_run_c_opr_with_param,
+                   "run c opr with param only support dump_with_testcase!!");
+        auto& tensormap = env.load_ret.tensor_map;
+        auto set_shapes = [&](size_t set_idx) {
+            for (auto&& i : env.shape_sets[set_idx]) {
+                auto iter = tensormap.find(i.first);
+                mgb_assert(iter != tensormap.end(),
+                           "unknown input var for --shape-switch: %s",
+                           i.first.c_str());
+                auto&& tensor = *iter->second;
+                tensor.resize(i.second);
+                memset(tensor.raw_ptr(), 0, tensor.layout().span().dist_byte());
+            }
+        };
+        size_t nr_set = env.shape_sets.size();
+        std::vector<double> switch_time(nr_set), steady_time(nr_set);
+        set_shapes(0);
+        warmup();
+        printf("=== going to cycle through %zu shape sets for %d rounds\n",
+               nr_set, env.nr_run);
+        for (int run = 0; run < env.nr_run; ++run) {
+            for (size_t i = 0; i < nr_set; ++i) {
+                set_shapes(i);
+                timer.reset();
+                func->execute().wait();
+                auto first = timer.get_msecs_reset();
+                func->execute().wait();
+                auto steady = timer.get_msecs();
+                switch_time[i] += first;
+                steady_time[i] += steady;
+                printf("=== round #%d set #%zu: switch=%.3fms steady=%.3fms\n",
+                       run, i, first, steady);
+            }
+        }
+        for (size_t i = 0; i < nr_set && env.nr_run; ++i) {
+            printf("=== shape set #%zu: avg switch=%.3fms steady=%.3fms "
+                   "overhead=%.3fms\n",
+                   i, switch_time[i] / env.nr_run, steady_time[i] / env.nr_run,
+                   (switch_time[i] - steady_time[i]) / env.nr_run);
+        }
     } else if (not env.data_files.empty()) {
         mgb_assert(!env.c_opr_args.is_run_c_opr_with_param,
                    "run c opr with param only support dump_with_testcase!!");
@@ -1149,6 +1273,16 @@ Args Args::from_argv(int argc, char **argv) {
             };
             continue;
         }
+        if (!strcmp(argv[i], "--work-stealing")) {
+            mgb_log_warn("use work stealing thread pool");
+            CompNode::enable_work_stealing_for_cpu(true);
+            continue;
+        }
+        if (!strcmp(argv[i], "--hybrid-dispatch")) {
+            mgb_log_warn("use hybrid-core aware thread pool");
+            CompNode::enable_hybrid_dispatch_for_cpu(true);
+            continue;
+        }
         if (!strcmp(argv[i], "--multi-thread-core-ids")) {
             ++i;
             std::string core_id_string = argv[i];
@@ -1222,6 +1356,21 @@ Args Args::from_argv(int argc, char **argv) {
             graph_opt.graph_opt.enable_fuse_preprocess();
             continue;
         }
+        if (!strcmp(argv[i], "--enable-fuse-normalization")) {
+            mgb_log_warn("enable-fuse-normalization optimization");
+            graph_opt.graph_opt.enable_fuse_normalization();
+            continue;
+        }
+        if (!strcmp(argv[i], "--enable-fuse-attention")) {
+            mgb_log_warn("enable-fuse-attention optimization");
+            graph_opt.graph_opt.enable_fuse_attention();
+            continue;
+        }
+        if (!strcmp(argv[i], "--enable-fuse-image-preprocess")) {
+            mgb_log_warn("enable-fuse-image-preprocess optimization");
+            graph_opt.graph_opt.enable_fuse_image_preprocess();
+            continue;
+        }
         if (!strcmp(argv[i], "--enable-fuse-conv-bias-nonlinearity")) {
             mgb_log_warn("enable fuse-conv-bias-nonlinearity optimization");
             graph_opt.graph_opt.enable_fuse_conv_bias_nonlinearity();
@@ -1350,6 +1499,52 @@ Args Args::from_argv(int argc, char **argv) {
             graph_opt.seq_opt.enable_mem_plan_opt = false;
             continue;
         }
+        if (!strcmp(argv[i], "--static-plan-cache")) {
+            ++i;
+            mgb_assert(i < argc, "value not given for --static-plan-cache");
+            graph_opt.seq_opt.static_plan_cache_size =
+                    static_cast<size_t>(std::stod(argv[i]) * 1024 * 1024);
+            continue;
+        }
+        if (!strcmp(argv[i], "--static-mem-opt")) {
+            ++i;
+            mgb_assert(i < argc, "value not given for --static-mem-opt");
+            graph_opt.seq_opt.static_mem_alloc_time_budget = std::stod(argv[i]);
+            continue;
+        }
+        if (!strcmp(argv[i], "--shape-switch")) {
+            ++i;
+            mgb_assert(i < argc, "shapes not given for --shape-switch");
+            auto split = [](const std::string& str, char sep) {
+                std::vector<std::string> ret;
+                size_t start = 0;
+                for (;;) {
+                    auto end = str.find(sep, start);
+                    ret.emplace_back(str.substr(start, end - start));
+                    if (end == std::string::npos) {
+                        return ret;
+                    }
+                    start = end + 1;
+                }
+            };
+            for (auto&& set_str : split(argv[i], ';')) {
+                ret.shape_sets.emplace_back();
+                for (auto&& var_str : split(set_str, '@')) {
+                    auto colon = var_str.rfind(':');
+                    mgb_assert(colon != std::string::npos,
+                               "invalid var shape for --shape-switch: %s",
+                               var_str.c_str());
+                    TensorShape shape;
+                    for (auto&& dim : split(var_str.substr(colon + 1), 'x')) {
+                        mgb_assert(shape.ndim < TensorShape::MAX_NDIM);
+                        shape.shape[shape.ndim++] = std::stoul(dim);
+                    }
+                    ret.shape_sets.back().emplace_back(
+                            var_str.substr(0, colon), shape);
+                }
+            }
+            continue;
+        }
         if (!strcmp(argv[i], "--copy-to-host")) {
             ret.copy_to_host = true;
             continue;
@@ -1418,6 +1613,12 @@ Args Args::from_argv(int argc, char **argv) {
             ret.fast_run_cache_path = argv[i];
             continue;
         }
+        if (!strcmp(argv[i], "--fast-run-shared-cache")) {
+            ++i;
+            mgb_assert(i < argc, "value not given for --fast-run-shared-cache");
+            ret.fast_run_shared_cache_path = argv[i];
+            continue;
+        }
         if (!strcmp(argv[i], "--fast-run-shared-batch-size")) {
             ++i;
             mgb_assert(i < argc,
@@ -1444,6 +1645,20 @@ Args Args::from_argv(int argc, char **argv) {
             ret.share_param_mem = true;
             continue;
         }
+        if (!strcmp(argv[i], "--mmap-model")) {
+            ret.mmap_model = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--load-threads")) {
+            ++i;
+            mgb_assert(i < argc, "value not given for --load-threads");
+            ret.load_config.nr_load_threads = std::stoul(argv[i]);
+            continue;
+        }
+        if (!strcmp(argv[i], "--parallel-load")) {
+            ret.load_config.parallel_tensor_load = true;
+            continue;
+        }
         if (!strcmp(argv[i], "--disable-assert-throw")) {
             ret.disable_assert_throw = true;
             continue;
@@ -1531,11 +1746,17 @@ Args Args::from_argv(int argc, char **argv) {
 #if MGB_ENABLE_FASTRUN
     if (graph_opt.fast_run_config.shared_batch_size) {
         mgb_assert(ret.use_fast_run || ret.use_full_run ||
-                           !ret.fast_run_cache_path.empty(),
+                           !ret.fast_run_cache_path.empty() ||
+                           !ret.fast_run_shared_cache_path.empty(),
                    "--fast-run-shared-batch-size should be used with "
-                   "--fast-run/--full-run/--fast-run-algo-policy");
+                   "--fast-run/--full-run/--fast-run-algo-policy/"
+                   "--fast-run-shared-cache");
     }
 #endif
+    mgb_assert(ret.fast_run_cache_path.empty() ||
+                       ret.fast_run_shared_cache_path.empty(),
+               "--fast-run-algo-policy and --fast-run-shared-cache can not "
+               "be used together");
     return ret;
 }
 
@@ -12,6 +12,7 @@
 #include "./comp_node.h"
 
 #include "megbrain/common.h"
+#include "megbrain/comp_node/alloc.h"
 #include "megbrain/comp_node_env.h"
 #include "megbrain/system.h"
 #include "megbrain/utils/arith_helper.h"
@@ -20,8 +21,10 @@
 #include "megbrain/utils/timer.h"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 
 #include <stdlib.h>
@@ -33,6 +36,8 @@ using namespace mgb;
 
 namespace {
 bool enable_affinity = false;
+bool enable_work_stealing = false;
+bool enable_hybrid_dispatch = false;
 using Task = CompNodeEnv::CpuEnv::Task;
 using MultiThreadingTask = megcore::CPUDispatcher::MultiThreadingTask;
 
@@ -251,18 +256,34 @@ using CompNodeRecorderImpl = CpuCompNode::CompNodeRecorderImpl;
 class CpuCompNode::CompNodeBaseImpl : public CpuDispatchableBase {
 protected:
     Locator m_locator, m_locator_logical;
+    uint64_t m_uid;
 
 public:
     CompNodeBaseImpl(const Locator& locator, const Locator& locator_logical,
                      free_func_t fd, free_func_t fh)
             : CpuDispatchableBase(fd, fh),
               m_locator(locator),
-              m_locator_logical(locator_logical) {}
+              m_locator_logical(locator_logical) {
+#if defined(__linux__) || defined(TARGET_OS_MAC)
+        FILE* fp;
+        fp = fopen("/dev/urandom", "r");
+        mgb_assert(fread(&m_uid, sizeof(m_uid), 1, fp) == 1);
+        fclose(fp);
+#else
+        m_uid = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+#endif
+    }
 
     virtual ~CompNodeBaseImpl() {}
 
     void* mgb_aligned_alloc(size_t size) {
         auto alignment = get_mem_addr_alignment();
+        if (auto alloc = mem_alloc::CpuMemAlloc::inst()) {
+            mgb_assert(alignment <= alloc->alignment());
+            return alloc->alloc(size);
+        }
 #ifdef WIN32
         return _aligned_malloc(size, alignment);
 #elif defined(__ANDROID__) || defined(ANDROID)
@@ -277,6 +298,9 @@ public:
     }
 
     static void mgb_aligned_free(void* ptr) {
+        if (auto alloc = mem_alloc::CpuMemAlloc::inst()) {
+            return alloc->free(ptr);
+        }
 #ifdef WIN32
         _aligned_free(ptr);
 #else
@@ -332,6 +356,8 @@ public:
 
     Locator locator_logical() override { return m_locator_logical; }
 
+    uint64_t get_uid() override { return m_uid; }
+
     void add_callback(Task&& task) override {
         CpuDispatchableBase::add_callback(std::move(task));
     }
@@ -626,8 +652,16 @@ public:
               m_worker_queue(worker_queue) {
         auto cn = make_comp_node_from_impl(this);
         if (locator.type == DeviceType::MULTITHREAD) {
-            m_thread_pool = std::shared_ptr<ThreadPool>(
-                    new ThreadPool(static_cast<size_t>(locator.nr_threads)));
+            auto nr_threads = static_cast<size_t>(locator.nr_threads);
+            if (enable_hybrid_dispatch) {
+                m_thread_pool =
+                        std::make_shared<HybridThreadPool>(nr_threads);
+            } else if (enable_work_stealing) {
+                m_thread_pool =
+                        std::make_shared<WorkStealingThreadPool>(nr_threads);
+            } else {
+                m_thread_pool = std::make_shared<ThreadPool>(nr_threads);
+            }
             mgb_assert(m_thread_pool, "ThradPool create failed");
         }
         if (locator.type == DeviceType::CPU) {
@@ -993,6 +1027,18 @@ bool CompNode::enable_affinity_for_cpu(bool flag) {
     return old;
 }
 
+bool CompNode::enable_work_stealing_for_cpu(bool flag) {
+    bool old = enable_work_stealing;
+    enable_work_stealing = flag;
+    return old;
+}
+
+bool CompNode::enable_hybrid_dispatch_for_cpu(bool flag) {
+    bool old = enable_hybrid_dispatch;
+    enable_hybrid_dispatch = flag;
+    return old;
+}
+
 /* ======================== EventImpl ========================  */
 double CpuCompNode::CpuDispatchableBase::EventImpl::do_elapsed_time_until(
         EventImplHelper& end) {
@@ -0,0 +1,773 @@
+/**
+ * \file src/core/impl/comp_node/mem_alloc/cpu_alloc.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "megbrain/comp_node/alloc.h"
+#include "megbrain/utils/arith_helper.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__ANDROID__) || defined(ANDROID)
+#include <malloc.h>
+#endif
+
+using namespace mgb;
+using namespace mem_alloc;
+
+namespace {
+
+//! log2 of the smallest size class
+constexpr size_t MIN_CLASS_LOG = 6;
+//! requests larger than this are not cached
+constexpr size_t MAX_CLASS_SIZE = 64 * 1024 * 1024;
+//! number of size classes between two powers of two
+constexpr size_t NR_SUB_CLASS = 4;
+//! blocks larger than this are not kept in the thread caches
+constexpr size_t THREAD_CACHE_MAX_SIZE = 1024 * 1024;
+//! bytes that can be kept in the thread cache of each class
+constexpr size_t THREAD_CACHE_BYTES = 256 * 1024;
+constexpr size_t THREAD_CACHE_MAX_BLOCKS = 64;
+//! minimal size of an arena chunk
+constexpr size_t ARENA_MIN_CHUNK = 1024 * 1024;
+
+constexpr uint32_t MAGIC_CLASS = 0x4d474331, MAGIC_LARGE = 0x4d47434c,
+                   MAGIC_ARENA = 0x4d474341;
+
+/*!
+ * \brief index of the smallest size class that can hold \p size bytes
+ *
+ * The classes between 2^k (exclusive) and 2^(k+1) (inclusive) are
+ * 2^k * (1 + i / NR_SUB_CLASS) for i = 1 ... NR_SUB_CLASS.
+ */
+constexpr size_t size_class(size_t size) {
+    size_t log = 0;
+    while ((size - 1) >> (log + 1)) {
+        ++log;
+    }
+    return size <= (size_t(1) << MIN_CLASS_LOG)
+                   ? 0
+                   : (log - MIN_CLASS_LOG) * NR_SUB_CLASS +
+                             divup((size - (size_t(1) << log)) * NR_SUB_CLASS,
+                                   size_t(1) << log);
+}
+
+constexpr size_t class_size(size_t cls) {
+    return cls ? (size_t(1) << (MIN_CLASS_LOG + (cls - 1) / NR_SUB_CLASS)) /
+                         NR_SUB_CLASS *
+                         (NR_SUB_CLASS + 1 + (cls - 1) % NR_SUB_CLASS)
+               : size_t(1) << MIN_CLASS_LOG;
+}
+
+constexpr size_t NR_CLASSES = size_class(MAX_CLASS_SIZE) + 1;
+constexpr size_t NR_THREAD_CACHE_CLASSES =
+        size_class(THREAD_CACHE_MAX_SIZE) + 1;
+
+static_assert(class_size(size_class(MAX_CLASS_SIZE)) == MAX_CLASS_SIZE &&
+                      class_size(size_class(THREAD_CACHE_MAX_SIZE)) ==
+                              THREAD_CACHE_MAX_SIZE &&
+                      class_size(size_class(100)) == 112,
+              "bad size class");
+
+//! max number of blocks in the thread cache of a class
+constexpr size_t thread_cache_limit(size_t cls) {
+    return std::max<size_t>(2, std::min(THREAD_CACHE_MAX_BLOCKS,
+                                        THREAD_CACHE_BYTES / class_size(cls)));
+}
+
+//! header before each block; it occupies alignment bytes
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t cls;
+    //! size of the block excluding the header; for arena blocks it is the
+    //! offset of the header from the ArenaChunk
+    size_t size;
+};
+
+//! header of an arena chunk, which takes the place of a BlockHeader
+struct ArenaChunk {
+    //! size excluding the header, bytes taken by buffers (the bump offset)
+    //! and number of live buffers
+    size_t size, offset, nr_live;
+};
+
+//! increase a counter that is only written by a single thread
+template <typename T>
+void incr_owned(std::atomic<T>& cnt, T delta) {
+    cnt.store(cnt.load(std::memory_order_relaxed) + delta,
+              std::memory_order_relaxed);
+}
+
+struct ThreadCache {
+    std::array<std::vector<void*>, NR_THREAD_CACHE_CLASSES> blocks;
+    //! counters written by the owner thread and read by stats()
+    std::atomic_size_t nr_alloc{0}, nr_free{0}, nr_hit{0}, nr_pool_hit{0},
+            nr_cached{0}, cached{0};
+    //! blocks may be freed by another thread, so it can be negative
+    std::atomic<ptrdiff_t> used{0};
+};
+
+/*!
+ * \brief returns the thread caches to the allocators when a thread exits
+ *
+ * Allocators are looked up by id in the registry, so the hook does nothing
+ * for allocators that have been destructed.
+ */
+struct ThreadExitHook {
+    //! ids of the allocators that have a cache of this thread
+    std::vector<uint64_t> owners;
+
+    ~ThreadExitHook();
+};
+
+//! the thread cache last used on this thread and the id of its allocator;
+//! the ids are never reused, so the cache is only dereferenced when it
+//! belongs to the allocator
+struct CacheRef {
+    uint64_t owner_id;
+    ThreadCache* cache;
+};
+
+thread_local CacheRef t_cache_ref{0, nullptr};
+thread_local ThreadExitHook t_thread_exit_hook;
+//! set when t_thread_exit_hook is destructed; it is trivially destructible
+//! so it can still be read by later frees on the exiting thread
+thread_local bool t_thread_exited = false;
+
+class CpuMemAllocImpl;
+
+//! live allocators, so ThreadExitHook can find them
+struct AllocRegistry {
+    std::mutex mtx;
+    std::unordered_map<uint64_t, CpuMemAllocImpl*> allocs;
+
+    //! never destructed since threads may exit during global finalization
+    static AllocRegistry& inst() {
+        static auto ret = new AllocRegistry;
+        return *ret;
+    }
+};
+
+class CpuMemAllocImpl final : public CpuMemAlloc {
+    struct Pool {
+        std::mutex mtx;
+        std::vector<void*> blocks;
+    };
+
+    struct Arena {
+        std::mutex mtx;
+        //! chunks with live buffers; allocation happens in the last one
+        std::vector<ArenaChunk*> chunks;
+        //! bytes taken from the chunks, and its peak since the arena was
+        //! last empty
+        size_t used = 0, seq_peak = 0;
+        //! size of the chunk to be allocated after the arena is emptied
+        size_t next_chunk_size = 0;
+        size_t peak = 0, nr_reset = 0;
+    };
+
+    const size_t m_alignment, m_header_size;
+    const uint64_t m_id;
+
+    std::mutex m_thread_caches_mtx;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadCache>>
+            m_thread_caches;
+    //! counters of the caches returned by exited threads
+    ThreadCache m_exited_threads;
+    std::array<Pool, NR_CLASSES> m_pools;
+    Arena m_arena;
+
+    std::atomic_size_t m_nr_sys_alloc{0}, m_reserved{0}, m_peak_reserved{0},
+            m_huge_page{0}, m_nr_large_alloc{0}, m_nr_large_free{0},
+            m_large_used{0};
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> cnt{0};
+        return ++cnt;
+    }
+
+    static bool use_huge_page(size_t size) {
+#ifdef __linux__
+        return size >= huge_page_threshold();
+#else
+        MGB_MARK_USED_VAR(size);
+        return false;
+#endif
+    }
+
+#ifdef __linux__
+    //! bytes mapped before a huge-page block for its header; the block itself
+    //! starts at a huge page boundary
+    size_t huge_page_prefix() const {
+        static const size_t page_size = sysconf(_SC_PAGESIZE);
+        return get_aligned_power2(m_header_size, page_size);
+    }
+#endif
+
+    BlockHeader* header(void* ptr) const {
+        return reinterpret_cast<BlockHeader*>(static_cast<uint8_t*>(ptr) -
+                                              m_header_size);
+    }
+
+    /*!
+     * \brief allocate \p size bytes from the system, preceded by
+     *      m_header_size bytes for the header
+     * \return address after the header
+     */
+    uint8_t* sys_alloc(size_t size);
+    //! release memory returned by sys_alloc()
+    void sys_free(void* ptr, size_t size);
+
+    //! allocate a block of a class from the system
+    void* alloc_class_block(size_t cls);
+    void free_class_block(void* ptr);
+
+    ThreadCache* thread_cache();
+
+    void free_arena(void* ptr);
+    void free_arena_chunk(ArenaChunk* chunk);
+
+public:
+    explicit CpuMemAllocImpl(size_t alignment)
+            : m_alignment{alignment},
+              m_header_size{get_aligned_power2(
+                      std::max(sizeof(BlockHeader), sizeof(ArenaChunk)),
+                      alignment)},
+              m_id{next_id()} {
+        mgb_assert(alignment && !(alignment & (alignment - 1)) &&
+                           alignment <= 4096,
+                   "bad alignment: %zu", alignment);
+        auto&& reg = AllocRegistry::inst();
+        MGB_LOCK_GUARD(reg.mtx);
+        reg.allocs[m_id] = this;
+    }
+
+    ~CpuMemAllocImpl();
+
+    //! move the cache of a thread to the pools
+    void flush_thread_cache(std::thread::id tid);
+
+    void* alloc(size_t size) override;
+    void* alloc_arena(size_t size) override;
+    void free(void* ptr) override;
+    void trim() override;
+    Stats stats() override;
+
+    size_t alignment() const override { return m_alignment; }
+
+    void print_memory_state() override;
+    size_t get_used_memory() override;
+    FreeMemStat get_free_memory() override;
+    FreeMemStat get_free_memory_dev() override { return get_free_memory(); }
+};
+
+}  // anonymous namespace
+
+/* ===================== CpuMemAllocImpl ===================== */
+
+uint8_t* CpuMemAllocImpl::sys_alloc(size_t size) {
+    uint8_t* ptr = nullptr;
+    size_t sys_size = m_header_size + size;
+#ifdef __linux__
+    if (use_huge_page(size)) {
+        // map an extra huge page so the block can be aligned to huge pages,
+        // which is required for it to be backed by them; the header goes to
+        // the normal pages before the block, so it does not take another huge
+        // page when the size is a multiple of huge pages
+        constexpr size_t HUGE_PAGE = huge_page_threshold();
+        size_t prefix = huge_page_prefix(),
+               map_size = get_aligned_power2(size, HUGE_PAGE),
+               tot_size = prefix + map_size + HUGE_PAGE;
+        auto raw = mmap(nullptr, tot_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        mgb_throw_if(raw == MAP_FAILED, MemAllocError,
+                     "failed to map %zu bytes", map_size);
+        auto begin = reinterpret_cast<size_t>(raw),
+             aligned = get_aligned_power2(begin + prefix, HUGE_PAGE);
+        if (auto head = aligned - prefix - begin) {
+            munmap(raw, head);
+        }
+        if (auto tail = begin + tot_size - (aligned + map_size)) {
+            munmap(reinterpret_cast<void*>(aligned + map_size), tail);
+        }
+        ptr = reinterpret_cast<uint8_t*>(aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, map_size, MADV_HUGEPAGE);
+#endif
+        m_huge_page.fetch_add(map_size);
+        sys_size = prefix + map_size;
+    }
+#endif
+    if (!ptr) {
+        void* raw = nullptr;
+#ifdef WIN32
+        raw = _aligned_malloc(sys_size, m_alignment);
+#elif defined(__ANDROID__) || defined(ANDROID)
+        raw = memalign(m_alignment, sys_size);
+#else
+        if (posix_memalign(&raw, m_alignment, sys_size)) {
+            raw = nullptr;
+        }
+#endif
+        mgb_throw_if(!raw, MemAllocError, "failed to allocate %zu bytes",
+                     sys_size);
+        ptr = static_cast<uint8_t*>(raw) + m_header_size;
+    }
+    m_nr_sys_alloc.fetch_add(1, std::memory_order_relaxed);
+    auto reserved = m_reserved.fetch_add(sys_size) + sys_size;
+    auto peak = m_peak_reserved.load(std::memory_order_relaxed);
+    while (peak < reserved &&
+           !m_peak_reserved.compare_exchange_weak(peak, reserved)) {
+    }
+    return ptr;
+}
+
+void CpuMemAllocImpl::sys_free(void* ptr, size_t size) {
+#ifdef __linux__
+    if (use_huge_page(size)) {
+        size_t prefix = huge_page_prefix(),
+               map_size = get_aligned_power2(size, huge_page_threshold());
+        munmap(static_cast<uint8_t*>(ptr) - prefix, prefix + map_size);
+        m_huge_page.fetch_sub(map_size);
+        m_reserved.fetch_sub(prefix + map_size);
+        return;
+    }
+#endif
+    auto raw = static_cast<uint8_t*>(ptr) - m_header_size;
+#ifdef WIN32
+    _aligned_free(raw);
+#else
+    ::free(raw);
+#endif
+    m_reserved.fetch_sub(m_header_size + size);
+}
+
+void* CpuMemAllocImpl::alloc_class_block(size_t cls) {
+    size_t size = class_size(cls);
+    auto ptr = sys_alloc(size);
+    auto hdr = header(ptr);
+    hdr->magic = MAGIC_CLASS;
+    hdr->cls = cls;
+    hdr->size = size;
+    return ptr;
+}
+
+void CpuMemAllocImpl::free_class_block(void* ptr) {
+    sys_free(ptr, header(ptr)->size);
+}
+
+ThreadCache* CpuMemAllocImpl::thread_cache() {
+    auto&& ref = t_cache_ref;
+    if (ref.owner_id == m_id) {
+        return ref.cache;
+    }
+    if (!t_thread_exited) {
+        auto&& owners = t_thread_exit_hook.owners;
+        if (std::find(owners.begin(), owners.end(), m_id) == owners.end()) {
+            owners.push_back(m_id);
+        }
+    }
+    MGB_LOCK_GUARD(m_thread_caches_mtx);
+    auto&& cache = m_thread_caches[std::this_thread::get_id()];
+    if (!cache) {
+        cache = std::make_unique<ThreadCache>();
+    }
+    ref = {m_id, cache.get()};
+    return ref.cache;
+}
+
+void CpuMemAllocImpl::flush_thread_cache(std::thread::id tid) {
+    std::unique_ptr<ThreadCache> tc;
+    {
+        MGB_LOCK_GUARD(m_thread_caches_mtx);
+        auto iter = m_thread_caches.find(tid);
+        if (iter == m_thread_caches.end()) {
+            return;
+        }
+        tc = std::move(iter->second);
+        m_thread_caches.erase(iter);
+        auto&& dst = m_exited_threads;
+        dst.nr_alloc += tc->nr_alloc.load(std::memory_order_relaxed);
+        dst.nr_free += tc->nr_free.load(std::memory_order_relaxed);
+        dst.nr_hit += tc->nr_hit.load(std::memory_order_relaxed);
+        dst.nr_pool_hit += tc->nr_pool_hit.load(std::memory_order_relaxed);
+        dst.used += tc->used.load(std::memory_order_relaxed);
+    }
+    for (size_t cls = 0; cls < NR_THREAD_CACHE_CLASSES; ++cls) {
+        auto&& blocks = tc->blocks[cls];
+        if (!blocks.empty()) {
+            auto&& pool = m_pools[cls];
+            MGB_LOCK_GUARD(pool.mtx);
+            pool.blocks.insert(pool.blocks.end(), blocks.begin(),
+                               blocks.end());
+        }
+    }
+}
+
+void* CpuMemAllocImpl::alloc(size_t size) {
+    if (size > MAX_CLASS_SIZE) {
+        auto ptr = sys_alloc(size);
+        auto hdr = header(ptr);
+        hdr->magic = MAGIC_LARGE;
+        hdr->cls = 0;
+        hdr->size = size;
+        m_nr_large_alloc.fetch_add(1, std::memory_order_relaxed);
+        m_large_used.fetch_add(size, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    auto tc = thread_cache();
+    size_t cls = size_class(std::max<size_t>(size, 1));
+    incr_owned(tc->nr_alloc, 1_z);
+    incr_owned<ptrdiff_t>(tc->used, class_size(cls));
+    if (cls < NR_THREAD_CACHE_CLASSES) {
+        auto&& blocks = tc->blocks[cls];
+        if (!blocks.empty()) {
+            auto ptr = blocks.back();
+            blocks.pop_back();
+            incr_owned(tc->nr_hit, 1_z);
+            incr_owned(tc->nr_cached, -1_z);
+            incr_owned(tc->cached, -class_size(cls));
+            return ptr;
+        }
+    }
+
+    auto&& pool = m_pools[cls];
+    {
+        MGB_LOCK_GUARD(pool.mtx);
+        if (!pool.blocks.empty()) {
+            auto ptr = pool.blocks.back();
+            pool.blocks.pop_back();
+            if (cls < NR_THREAD_CACHE_CLASSES) {
+                // refill the thread cache to amortize the locking
+                size_t nr = std::min(thread_cache_limit(cls) / 2,
+                                     pool.blocks.size());
+                auto&& blocks = tc->blocks[cls];
+                blocks.insert(blocks.end(), pool.blocks.end() - nr,
+                              pool.blocks.end());
+                pool.blocks.resize(pool.blocks.size() - nr);
+                incr_owned(tc->nr_cached, nr);
+                incr_owned(tc->cached, nr * class_size(cls));
+            }
+            incr_owned(tc->nr_pool_hit, 1_z);
+            return ptr;
+        }
+    }
+    return alloc_class_block(cls);
+}
+
+void CpuMemAllocImpl::free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    auto hdr = header(ptr);
+    if (hdr->magic == MAGIC_ARENA) {
+        return free_arena(ptr);
+    }
+    if (hdr->magic == MAGIC_LARGE) {
+        m_nr_large_free.fetch_add(1, std::memory_order_relaxed);
+        m_large_used.fetch_sub(hdr->size, std::memory_order_relaxed);
+        return sys_free(ptr, hdr->size);
+    }
+    mgb_assert(hdr->magic == MAGIC_CLASS && hdr->cls < NR_CLASSES,
+               "releasing bad pointer: %p", ptr);
+
+    size_t cls = hdr->cls;
+    auto tc = thread_cache();
+    incr_owned(tc->nr_free, 1_z);
+    incr_owned<ptrdiff_t>(tc->used, -static_cast<ptrdiff_t>(class_size(cls)));
+    if (cls < NR_THREAD_CACHE_CLASSES) {
+        auto&& blocks = tc->blocks[cls];
+        blocks.push_back(ptr);
+        size_t limit = thread_cache_limit(cls);
+        if (blocks.size() <= limit) {
+            incr_owned(tc->nr_cached, 1_z);
+            incr_owned(tc->cached, class_size(cls));
+            return;
+        }
+        // move the older half to the pool
+        size_t nr = limit / 2 + 1;
+        {
+            auto&& pool = m_pools[cls];
+            MGB_LOCK_GUARD(pool.mtx);
+            pool.blocks.insert(pool.blocks.end(), blocks.begin(),
+                               blocks.begin() + nr);
+        }
+        blocks.erase(blocks.begin(), blocks.begin() + nr);
+        incr_owned(tc->nr_cached, 1 - nr);
+        incr_owned(tc->cached, (1 - nr) * class_size(cls));
+        return;
+    }
+    auto&& pool = m_pools[cls];
+    MGB_LOCK_GUARD(pool.mtx);
+    pool.blocks.push_back(ptr);
+}
+
+void* CpuMemAllocImpl::alloc_arena(size_t size) {
+    size_t need = m_header_size +
+                  get_aligned_power2(std::max<size_t>(size, 1), m_alignment);
+    incr_owned(thread_cache()->nr_alloc, 1_z);
+    auto&& arena = m_arena;
+    MGB_LOCK_GUARD(arena.mtx);
+    ArenaChunk* chunk = arena.chunks.empty() ? nullptr : arena.chunks.back();
+    if (!chunk || chunk->offset + need > chunk->size) {
+        size_t chunk_size = std::max(need, ARENA_MIN_CHUNK);
+        if (chunk) {
+            chunk_size = std::max(chunk_size, chunk->size * 2);
+            if (!chunk->nr_live) {
+                // rewound, so no free would release it later
+                arena.chunks.pop_back();
+                free_arena_chunk(chunk);
+            }
+        } else {
+            chunk_size = std::max(chunk_size, arena.next_chunk_size);
+        }
+        chunk = reinterpret_cast<ArenaChunk*>(sys_alloc(chunk_size) -
+                                              m_header_size);
+        chunk->size = chunk_size;
+        chunk->offset = 0;
+        chunk->nr_live = 0;
+        arena.chunks.push_back(chunk);
+    }
+    auto raw = reinterpret_cast<uint8_t*>(chunk) + m_header_size +
+               chunk->offset;
+    auto hdr = reinterpret_cast<BlockHeader*>(raw);
+    hdr->magic = MAGIC_ARENA;
+    hdr->cls = 0;
+    hdr->size = raw - reinterpret_cast<uint8_t*>(chunk);
+    chunk->offset += need;
+    ++chunk->nr_live;
+    arena.used += need;
+    arena.seq_peak = std::max(arena.seq_peak, arena.used);
+    arena.peak = std::max(arena.peak, arena.used);
+    return raw + m_header_size;
+}
+
+void CpuMemAllocImpl::free_arena_chunk(ArenaChunk* chunk) {
+    sys_free(reinterpret_cast<uint8_t*>(chunk) + m_header_size, chunk->size);
+}
+
+void CpuMemAllocImpl::free_arena(void* ptr) {
+    incr_owned(thread_cache()->nr_free, 1_z);
+    auto hdr = header(ptr);
+    auto chunk = reinterpret_cast<ArenaChunk*>(
+            reinterpret_cast<uint8_t*>(hdr) - hdr->size);
+    auto&& arena = m_arena;
+    MGB_LOCK_GUARD(arena.mtx);
+    mgb_assert(chunk->nr_live, "releasing bad arena pointer: %p", ptr);
+    if (--chunk->nr_live) {
+        return;
+    }
+    // each chunk is released (or rewound if it is the last one) as soon as
+    // its own buffers are, so a long-lived buffer only pins its chunk
+    arena.used -= chunk->offset;
+    if (chunk != arena.chunks.back()) {
+        arena.chunks.erase(
+                std::find(arena.chunks.begin(), arena.chunks.end(), chunk));
+        free_arena_chunk(chunk);
+    } else {
+        chunk->offset = 0;
+        ++arena.nr_reset;
+    }
+    if (arena.used) {
+        return;
+    }
+    // all buffers of the sequence are released; keep a single chunk that
+    // covers the usage of the sequence
+    chunk = arena.chunks.back();
+    if (chunk->size < arena.seq_peak) {
+        arena.chunks.clear();
+        free_arena_chunk(chunk);
+        arena.next_chunk_size = arena.seq_peak;
+    }
+    arena.seq_peak = 0;
+}
+
+void CpuMemAllocImpl::trim() {
+    auto tc = thread_cache();
+    for (size_t cls = 0; cls < NR_THREAD_CACHE_CLASSES; ++cls) {
+        for (auto ptr : tc->blocks[cls]) {
+            free_class_block(ptr);
+        }
+        tc->blocks[cls].clear();
+    }
+    tc->nr_cached.store(0, std::memory_order_relaxed);
+    tc->cached.store(0, std::memory_order_relaxed);
+
+    for (auto&& pool : m_pools) {
+        MGB_LOCK_GUARD(pool.mtx);
+        for (auto ptr : pool.blocks) {
+            free_class_block(ptr);
+        }
+        pool.blocks.clear();
+        pool.blocks.shrink_to_fit();
+    }
+
+    MGB_LOCK_GUARD(m_arena.mtx);
+    if (!m_arena.used) {
+        for (auto i : m_arena.chunks) {
+            free_arena_chunk(i);
+        }
+        m_arena.chunks.clear();
+        m_arena.next_chunk_size = 0;
+    }
+}
+
+CpuMemAllocImpl::~CpuMemAllocImpl() {
+    {
+        auto&& reg = AllocRegistry::inst();
+        MGB_LOCK_GUARD(reg.mtx);
+        reg.allocs.erase(m_id);
+    }
+    for (auto&& i : m_thread_caches) {
+        for (auto&& blocks : i.second->blocks) {
+            for (auto ptr : blocks) {
+                free_class_block(ptr);
+            }
+        }
+    }
+    for (auto&& pool : m_pools) {
+        for (auto ptr : pool.blocks) {
+            free_class_block(ptr);
+        }
+    }
+    for (auto i : m_arena.chunks) {
+        free_arena_chunk(i);
+    }
+}
+
+CpuMemAlloc::Stats CpuMemAllocImpl::stats() {
+    Stats ret;
+    ptrdiff_t used = 0;
+    {
+        auto add = [&](const ThreadCache& tc) {
+            ret.nr_alloc += tc.nr_alloc.load(std::memory_order_relaxed);
+            ret.nr_free += tc.nr_free.load(std::memory_order_relaxed);
+            ret.nr_thread_cache_hit +=
+                    tc.nr_hit.load(std::memory_order_relaxed);
+            ret.nr_pool_hit += tc.nr_pool_hit.load(std::memory_order_relaxed);
+            used += tc.used.load(std::memory_order_relaxed);
+        };
+        MGB_LOCK_GUARD(m_thread_caches_mtx);
+        for (auto&& i : m_thread_caches) {
+            add(*i.second);
+        }
+        add(m_exited_threads);
+    }
+    ret.nr_alloc += m_nr_large_alloc.load(std::memory_order_relaxed);
+    ret.nr_free += m_nr_large_free.load(std::memory_order_relaxed);
+    ret.used = std::max<ptrdiff_t>(used, 0) +
+               m_large_used.load(std::memory_order_relaxed);
+    ret.nr_sys_alloc = m_nr_sys_alloc.load(std::memory_order_relaxed);
+    ret.reserved = m_reserved.load();
+    ret.peak_reserved = m_peak_reserved.load();
+    ret.huge_page = m_huge_page.load();
+    {
+        MGB_LOCK_GUARD(m_arena.mtx);
+        for (auto i : m_arena.chunks) {
+            ret.arena_reserved += i->size;
+        }
+        ret.arena_peak = m_arena.peak;
+        ret.nr_arena_reset = m_arena.nr_reset;
+    }
+    ret.cached = get_free_memory().tot;
+    return ret;
+}
+
+size_t CpuMemAllocImpl::get_used_memory() {
+    return stats().used;
+}
+
+FreeMemStat CpuMemAllocImpl::get_free_memory() {
+    FreeMemStat ret{0, std::numeric_limits<size_t>::max(), 0, 0};
+    {
+        MGB_LOCK_GUARD(m_thread_caches_mtx);
+        for (auto&& i : m_thread_caches) {
+            ret.tot += i.second->cached.load(std::memory_order_relaxed);
+            ret.nr_blk += i.second->nr_cached.load(std::memory_order_relaxed);
+        }
+    }
+    for (size_t cls = 0; cls < NR_CLASSES; ++cls) {
+        auto&& pool = m_pools[cls];
+        MGB_LOCK_GUARD(pool.mtx);
+        if (auto nr = pool.blocks.size()) {
+            size_t size = class_size(cls);
+            ret.tot += nr * size;
+            ret.nr_blk += nr;
+            ret.min = std::min(ret.min, size);
+            ret.max = std::max(ret.max, size);
+        }
+    }
+    if (ret.min > ret.max) {
+        ret.min = 0;
+    }
+    return ret;
+}
+
+void CpuMemAllocImpl::print_memory_state() {
+    auto s = stats();
+    MGB_MARK_USED_VAR(s);
+    mgb_log("cpu memory allocator stats: used=%zu cached=%zu reserved=%zu "
+            "(peak %zu, huge page %zu) alloc=%zu free=%zu "
+            "hit={thread:%zu, pool:%zu} sys_alloc=%zu "
+            "arena={reserved:%zu, peak:%zu, reset:%zu}",
+            s.used, s.cached, s.reserved, s.peak_reserved, s.huge_page,
+            s.nr_alloc, s.nr_free, s.nr_thread_cache_hit, s.nr_pool_hit,
+            s.nr_sys_alloc, s.arena_reserved, s.arena_peak, s.nr_arena_reset);
+}
+
+/* ===================== ThreadExitHook ===================== */
+
+ThreadExitHook::~ThreadExitHook() {
+    t_thread_exited = true;
+    t_cache_ref = {0, nullptr};
+    auto&& reg = AllocRegistry::inst();
+    MGB_LOCK_GUARD(reg.mtx);
+    for (auto id : owners) {
+        auto iter = reg.allocs.find(id);
+        if (iter != reg.allocs.end()) {
+            iter->second->flush_thread_cache(std::this_thread::get_id());
+        }
+    }
+}
+
+/* ===================== CpuMemAlloc ===================== */
+
+std::unique_ptr<CpuMemAlloc> CpuMemAlloc::make(size_t alignment) {
+    return std::make_unique<CpuMemAllocImpl>(alignment);
+}
+
+CpuMemAlloc* CpuMemAlloc::inst() {
+    static CpuMemAlloc* ret = []() -> CpuMemAlloc* {
+        auto env = MGB_GETENV("MGB_CPU_MEM_ALLOC");
+        if (!env || !strcmp(env, "system")) {
+            return nullptr;
+        }
+        mgb_throw_if(strcmp(env, "size_class"), MegBrainError,
+                     "bad MGB_CPU_MEM_ALLOC: %s; expect system or size_class",
+                     env);
+        // 64 bytes is the largest alignment required by the CPU handles
+        return make(64).release();
+    }();
+    return ret;
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -13,6 +13,7 @@
 #include "./cg_impl_partial.h"
 #include "./cg_impl_seq.h"
 
+#include "megbrain/comp_node/alloc.h"
 #include "megbrain/gopt/framework.h"
 #include "megbrain/gopt/inference.h"
 #include "megbrain/gopt/basic_arith.h"
@@ -102,8 +103,21 @@ void DeviceMemoryAllocator::alloc_static(ComputingGraph*,
     dest.ensure_size(size);
 }
 
-void DeviceMemoryAllocator::alloc_dynamic(VarNode*, DeviceTensorStorage& dest,
+void DeviceMemoryAllocator::alloc_dynamic(VarNode* var,
+                                          DeviceTensorStorage& dest,
                                           size_t size) {
+    auto cpu_alloc = mem_alloc::CpuMemAlloc::inst();
+    if (cpu_alloc && var &&
+        var->contain_flag(VarNode::Flag::VOLATILE_CONTENT) &&
+        dest.comp_node().device_type() == CompNode::DeviceType::CPU) {
+        // workspaces are released right after their oprs, so they are taken
+        // from the bump arena; free_device() would release it after the
+        // kernels on the comp node
+        auto cn = dest.comp_node();
+        auto ptr = static_cast<dt_byte*>(cpu_alloc->alloc_arena(size));
+        dest.reset(cn, size, {ptr, [cn](dt_byte* p) { cn.free_device(p); }});
+        return;
+    }
     dest.ensure_size(size);
 }
 
@@ -542,6 +556,10 @@ ComputingGraphImpl::CompileState ComputingGraphImpl::compile_prepare(
                 optimizer.add_pass<gopt::PackAllReduceReplacePass>();
             }
 #endif
+            // these have been added by the preset passes before the arith
+            // passes, and would not match after them
+            options().graph_opt.disable_fuse_normalization()
+                    .disable_fuse_attention();
         }
         optimizer.apply_inplace(dest_vars);
     }
@@ -307,11 +307,33 @@ bool SeqMemOptimizer::run_static_mem_alloc_on_comp_node(
         StaticMemAllocLogger &static_mem_alloc_logger) {
 
     size_t size_ub = 0;
+    auto time_budget = m_graph->options().seq_opt.static_mem_alloc_time_budget;
+    auto algo = time_budget > 0 ? StaticMemAlloc::AllocatorAlgo::LOCAL_SEARCH
+                                : StaticMemAlloc::AllocatorAlgo::PUSHDOWN;
+    auto alignment = comp_node.get_mem_addr_alignment(),
+         padding = comp_node.get_mem_padding();
+
+    bool use_cache = m_graph->options().seq_opt.static_plan_cache_size;
+    std::string cache_key;
+    auto append_key = [&cache_key](size_t v) {
+        cache_key.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    };
+    if (use_cache) {
+        cache_key = comp_node.to_string();
+        cache_key.reserve(cache_key.size() +
+                          (chunks.size() + 2) * 3 * sizeof(size_t));
+        // plans of other allocator settings must not be reused
+        append_key(static_cast<size_t>(algo));
+        cache_key.append(reinterpret_cast<const char*>(&time_budget),
+                         sizeof(time_budget));
+        append_key(alignment);
+        append_key(padding);
+    }
 
-    auto allocator = StaticMemAlloc::make(
-            StaticMemAlloc::AllocatorAlgo::PUSHDOWN);
-    allocator->alignment(comp_node.get_mem_addr_alignment());
-    allocator->padding(comp_node.get_mem_padding());
+    auto allocator = StaticMemAlloc::make(algo);
+    allocator->time_budget(time_budget);
+    allocator->alignment(alignment);
+    allocator->padding(padding);
 #if MGB_ENABLE_DEBUG_UTIL
     allocator->dbg_key2varnode = [](StaticMemAlloc::UserKeyType key) {
         return static_cast<const MemChunkLifeInterval*>(key)->chunk->owner_var;
@@ -324,6 +346,11 @@ bool SeqMemOptimizer::run_static_mem_alloc_on_comp_node(
         auto ins_rst = chunk2allocatorid.emplace(chk.chunk, id);
         mgb_assert(ins_rst.second);
         size_ub += chk.chunk->size();
+        if (use_cache) {
+            append_key(chk.begin);
+            append_key(chk.end);
+            append_key(chk.chunk->size());
+        }
     }
 
     for (auto &&i: m_writable_fwd_mem_plans) {
@@ -336,6 +363,11 @@ bool SeqMemOptimizer::run_static_mem_alloc_on_comp_node(
 
             allocator->add_overwrite_spec(to_iter->second, from_iter->second,
                     i.first->offset_in_chunk_byte());
+            if (use_cache) {
+                append_key(to_iter->second);
+                append_key(from_iter->second);
+                append_key(i.first->offset_in_chunk_byte());
+            }
         }
     }
     {
@@ -343,21 +375,55 @@ bool SeqMemOptimizer::run_static_mem_alloc_on_comp_node(
         chunk2allocatorid.swap(v);
     }
 
-    allocator->solve();
-    size_t size = allocator->tot_alloc(),
-           size_lb = allocator->tot_alloc_lower_bound();
+    const CachedStaticPlan* cached = nullptr;
+    if (use_cache) {
+        cached = get_cached_plan(cache_key);
+    }
+    size_t size, size_lb, size_heuristic;
+    if (cached) {
+        mgb_assert(cached->offsets.size() == chunks.size());
+        size = cached->size;
+        size_lb = cached->size_lb;
+        size_heuristic = cached->size_heuristic;
+    } else {
+        allocator->solve();
+        size = allocator->tot_alloc();
+        size_lb = allocator->tot_alloc_lower_bound();
+        size_heuristic = allocator->tot_alloc_heuristic();
+    }
 
     static_mem_alloc_logger.push(comp_node, size, size_lb, size_ub);
 
     bool should_realloc = false;
     m_graph->event().signal_inplace<event::StaticMemAlloc>(
-            &should_realloc, comp_node, size);
+            &should_realloc, comp_node, size, cached != nullptr);
 
     if (!should_realloc) {
         m_static_mem_usage.val()[comp_node] = size;
-        for (auto&& chk : chunks) {
-            chk.chunk->mem_alloc_status.set_static_offset(
-                    allocator->get_start_addr(&chk));
+        if (cached) {
+            for (size_t i = 0; i < chunks.size(); ++i) {
+                chunks[i].chunk->mem_alloc_status.set_static_offset(
+                        cached->offsets[i]);
+            }
+        } else {
+            CachedStaticPlan plan;
+            if (use_cache) {
+                plan.offsets.reserve(chunks.size());
+            }
+            for (auto&& chk : chunks) {
+                auto offset = allocator->get_start_addr(&chk);
+                chk.chunk->mem_alloc_status.set_static_offset(offset);
+                if (use_cache) {
+                    plan.offsets.push_back(offset);
+                }
+            }
+            if (use_cache) {
+                plan.key = std::move(cache_key);
+                plan.size = size;
+                plan.size_lb = size_lb;
+                plan.size_heuristic = size_heuristic;
+                put_cached_plan(std::move(plan));
+            }
         }
 #ifndef __IN_TEE_ENV__
         auto& recorder = StaticMemRecorder::Instance();
@@ -367,6 +433,7 @@ bool SeqMemOptimizer::run_static_mem_alloc_on_comp_node(
                         i, chunks.at(i).chunk->owner_var->name());
             }
             recorder.regist_peak_mem_size(size);
+            recorder.regist_heuristic_peak_mem_size(size_heuristic);
         }
 #endif
     }
@@ -374,6 +441,35 @@ bool SeqMemOptimizer::run_static_mem_alloc_on_comp_node(
     return should_realloc;
 }
 
+const SeqMemOptimizer::CachedStaticPlan* SeqMemOptimizer::get_cached_plan(
+        const std::string& key) {
+    auto iter = m_plan_cache_index.find(key);
+    if (iter == m_plan_cache_index.end()) {
+        return nullptr;
+    }
+    m_plan_cache.splice(m_plan_cache.begin(), m_plan_cache, iter->second);
+    return &m_plan_cache.front();
+}
+
+void SeqMemOptimizer::put_cached_plan(CachedStaticPlan plan) {
+    auto limit = m_graph->options().seq_opt.static_plan_cache_size;
+    auto usage = plan.host_mem_usage();
+    if (usage > limit) {
+        return;
+    }
+    while (m_plan_cache_mem_usage + usage > limit) {
+        auto&& victim = m_plan_cache.back();
+        m_plan_cache_mem_usage -= victim.host_mem_usage();
+        m_plan_cache_index.erase(victim.key);
+        m_plan_cache.pop_back();
+    }
+    m_plan_cache.emplace_front(std::move(plan));
+    m_plan_cache_mem_usage += usage;
+    auto ins = m_plan_cache_index.emplace(m_plan_cache.front().key,
+                                          m_plan_cache.begin());
+    mgb_assert(ins.second);
+}
+
 void SeqMemOptimizer::reset_opr_seq(const OprNodeArray *seq,
                 const OprNodeArray *seq_sys_alloc,
                 const VarNodeSet *static_alloc_var,
@@ -13,6 +13,9 @@
 
 #include "../impl_common.h"
 
+#include <list>
+#include <unordered_map>
+
 namespace mgb {
 namespace cg {
 
@@ -48,6 +51,40 @@ class SeqMemOptimizer {
     std::vector<std::pair<MemAllocPlan*, MemAllocPlan*>>
         m_writable_fwd_mem_plans;
 
+    /*!
+     * \brief static allocation result on a comp node
+     *
+     * The key encodes the comp node, the allocator settings (algorithm,
+     * time budget, alignment and padding) and the life intervals, sizes and
+     * overwrite specs of all the chunks, i.e. the whole input of the
+     * allocator; so a plan can be reused whenever the shapes come back to a
+     * previously seen bucket, regardless of how the chunks were produced.
+     */
+    struct CachedStaticPlan {
+        std::string key;
+        size_t size, size_lb, size_heuristic;
+        //! offsets of the chunks, in the order they are given to allocator
+        std::vector<size_t> offsets;
+
+        size_t host_mem_usage() const {
+            return sizeof(CachedStaticPlan) + key.size() * 2 +
+                   offsets.size() * sizeof(size_t);
+        }
+    };
+
+    //! most recently used plans are at the front
+    std::list<CachedStaticPlan> m_plan_cache;
+    std::unordered_map<std::string, std::list<CachedStaticPlan>::iterator>
+            m_plan_cache_index;
+    size_t m_plan_cache_mem_usage = 0;
+
+    //! find a cached plan and move it to the front; return nullptr if absent
+    const CachedStaticPlan* get_cached_plan(const std::string& key);
+
+    //! insert a plan and evict the least recently used plans to respect
+    //! Options::SeqOpt::static_plan_cache_size
+    void put_cached_plan(CachedStaticPlan plan);
+
     bool should_static_alloc_var(VarNode *var);
 
     bool in_sys_alloc(OperatorNodeBase *opr) const {
@@ -39,6 +39,11 @@ class StaticMemAlloc {
 
             //! O(n log n) allocator with better performance
             PUSHDOWN,
+
+            //! run the heuristics above, and improve the best result by
+            //! local search over the placement order of the intervals within
+            //! a time budget
+            LOCAL_SEARCH,
         };
 
         static std::unique_ptr<StaticMemAlloc> make(AllocatorAlgo algo);
@@ -76,6 +81,15 @@ class StaticMemAlloc {
          */
         virtual size_t tot_alloc_lower_bound() const = 0;
 
+        /*!
+         * \brief get peak memory usage of the best heuristic, which is
+         *      different from tot_alloc() only for optimizers such as
+         *      LOCAL_SEARCH
+         */
+        virtual size_t tot_alloc_heuristic() const {
+            return tot_alloc();
+        }
+
         /*!
          * \brief get allocated address for an interval
          */
@@ -99,6 +113,17 @@ class StaticMemAlloc {
          */
         virtual StaticMemAlloc& padding(size_t padding) = 0;
 
+        /*!
+         * \brief set time budget of the optimizers; ignored by the heuristics
+         *
+         * Must be called before calling solve()
+         *
+         * \param msecs time budget in milliseconds
+         */
+        virtual StaticMemAlloc& time_budget(double /* msecs */) {
+            return *this;
+        }
+
 #if MGB_ENABLE_DEBUG_UTIL
         //! set by the caller to convert key to VarNode* for debug logging
         VarNode* (*dbg_key2varnode)(UserKeyType) = nullptr;
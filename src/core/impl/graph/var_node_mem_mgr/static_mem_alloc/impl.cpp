@@ -13,6 +13,7 @@
 #include "./interval_move.h"
 #include "./best_fit.h"
 #include "./pushdown.h"
+#include "./local_search.h"
 
 #include <map>
 
@@ -394,6 +395,8 @@ std::unique_ptr<StaticMemAlloc> StaticMemAlloc::make(AllocatorAlgo algo) {
 #endif
         case AllocatorAlgo::PUSHDOWN:
             return std::make_unique<StaticMemAllocPushdown>();
+        case AllocatorAlgo::LOCAL_SEARCH:
+            return std::make_unique<StaticMemAllocLocalSearch>();
         default:
             mgb_assert(0, "unknown mem allocator algorithm");
     }
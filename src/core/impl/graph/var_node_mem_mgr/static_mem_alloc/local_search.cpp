@@ -0,0 +1,295 @@
+/**
+ * \file src/core/impl/graph/var_node_mem_mgr/static_mem_alloc/local_search.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "./local_search.h"
+
+#include "megbrain/utils/timer.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace mgb;
+using namespace cg;
+
+namespace {
+//! INTERVAL_MOVE is O(n^2) and only tried on small problems
+constexpr size_t INTERVAL_MOVE_MAX_NR = 1000;
+//! give up the search if the conflict lists would be too large
+constexpr size_t MAX_NR_CONFLICT = 1 << 22;
+//! max number of moves for each group
+constexpr size_t MAX_ITER_PER_GROUP = 50;
+}  // anonymous namespace
+
+void StaticMemAllocLocalSearch::do_solve() {
+    RealTimer timer;
+
+    // run the heuristics on the same intervals and keep the best one
+    using Algo = AllocatorAlgo;
+    std::vector<Algo> algos{Algo::PUSHDOWN};
+#if !MGB_BUILD_SLIM_SERVING
+    algos.push_back(Algo::BEST_FIT);
+    if (m_interval.size() <= INTERVAL_MOVE_MAX_NR) {
+        algos.push_back(Algo::INTERVAL_MOVE);
+    }
+#endif
+    m_peak_heuristic = std::numeric_limits<size_t>::max();
+    for (auto algo : algos) {
+        auto heuristic = StaticMemAlloc::make(algo);
+        heuristic->alignment(addr_alignment());
+#if MGB_ENABLE_DEBUG_UTIL
+        heuristic->dbg_key2varnode = dbg_key2varnode;
+#endif
+        for (size_t i = 0; i < m_interval.size(); ++i) {
+            auto itrv = m_interval[i];
+            mgb_assert(itrv->id == i);
+            heuristic->add(itrv->time_begin_orig, itrv->time_end_orig,
+                           itrv->size_orig, itrv->key);
+        }
+        for (auto i : m_interval) {
+            if (auto dest = i->overwrite_dest()) {
+                heuristic->add_overwrite_spec(i->id, dest->id,
+                                              i->offset_in_overwrite_dest());
+            }
+        }
+        heuristic->solve();
+        if (heuristic->tot_alloc() < m_peak_heuristic) {
+            m_peak_heuristic = heuristic->tot_alloc();
+            for (auto i : m_interval) {
+                i->addr_begin = heuristic->get_start_addr(i->key);
+            }
+        }
+    }
+    m_peak = get_peak();
+
+    if (m_time_budget <= 0 || !init_groups()) {
+        return;
+    }
+
+    // lower bound of the peak, where an interval that overwrites another is
+    // counted after the overwritten one ends
+    size_t lower_bound = 0;
+    {
+        std::vector<std::pair<size_t, ptrdiff_t>> events;
+        for (auto i : m_interval) {
+            size_t begin = i->time_begin_orig;
+            if (auto dest = i->overwrite_dest()) {
+                begin = std::max(begin, dest->time_end_orig);
+            }
+            if (begin < i->time_end_orig) {
+                auto size = static_cast<ptrdiff_t>(i->size_orig);
+                events.emplace_back(begin, size);
+                events.emplace_back(i->time_end_orig, -size);
+            }
+        }
+        std::sort(events.begin(), events.end());
+        ptrdiff_t usage = 0;
+        for (auto&& i : events) {
+            usage += i.second;
+            update_max(lower_bound, static_cast<size_t>(usage));
+        }
+    }
+
+    // placing in the address order never increases the peak
+    size_t top, new_top;
+    std::vector<size_t> order = order_by_addr(), addr, new_addr;
+    size_t peak = place(order, addr, m_peak, top);
+    if (peak > m_peak) {
+        return;
+    }
+
+    // the search is deterministic unless the time budget is exhausted
+    std::mt19937 rng(0);
+    size_t nr_group = m_groups.size(), nr_iter = 0,
+           max_iter = MAX_ITER_PER_GROUP * nr_group;
+    std::vector<size_t> new_order;
+    while (peak > lower_bound && nr_iter < max_iter &&
+           timer.get_msecs() < m_time_budget) {
+        ++nr_iter;
+        new_order = order;
+        size_t pos = std::find(order.begin(), order.end(), top) - order.begin();
+        if (pos && rng() % 2) {
+            // place the group that reaches the peak earlier
+            size_t dest = rng() % pos;
+            std::rotate(new_order.begin() + dest, new_order.begin() + pos,
+                        new_order.begin() + pos + 1);
+        } else {
+            // swap a group with a conflicting one
+            size_t group = rng() % 2 ? top : order[rng() % nr_group];
+            auto&& conflicts = m_groups[group].conflicts;
+            if (conflicts.empty()) {
+                continue;
+            }
+            auto other = conflicts[rng() % conflicts.size()].other;
+            std::iter_swap(
+                    std::find(new_order.begin(), new_order.end(), group),
+                    std::find(new_order.begin(), new_order.end(), other));
+        }
+        auto new_peak = place(new_order, new_addr, peak, new_top);
+        if (new_peak <= peak) {
+            peak = new_peak;
+            top = new_top;
+            order.swap(new_order);
+            addr.swap(new_addr);
+        }
+    }
+
+    if (peak < m_peak) {
+        apply_addr(addr);
+        m_peak = get_peak();
+    }
+    mgb_log_debug(
+            "static mem local search: nr_interval=%zu heuristic=%zu "
+            "result=%zu lower_bound=%zu iter=%zu time=%.3fms",
+            m_interval.size(), m_peak_heuristic, m_peak, lower_bound, nr_iter,
+            timer.get_msecs());
+}
+
+bool StaticMemAllocLocalSearch::init_groups() {
+    m_groups.clear();
+    std::vector<size_t> group_of(m_interval.size());
+    for (auto i : m_interval) {
+        if (i->is_overwrite_root()) {
+            group_of[i->id] = m_groups.size();
+            m_groups.emplace_back();
+            m_groups.back().members.emplace_back(i, 0);
+        }
+    }
+    for (auto i : m_interval) {
+        if (!i->is_overwrite_root()) {
+            auto group = group_of[i->overwrite_dest_root()->id];
+            group_of[i->id] = group;
+            m_groups[group].members.emplace_back(
+                    i, i->offset_in_overwrite_dest_root());
+        }
+    }
+
+    struct Rect {
+        size_t begin, end, group, offset, size;
+    };
+    std::vector<Rect> rects;
+    rects.reserve(m_interval.size());
+    for (auto&& group : m_groups) {
+        for (auto&& i : group.members) {
+            update_max(group.extent, i.second + i.first->size_orig);
+        }
+    }
+    for (auto i : m_interval) {
+        if (i->size_orig) {
+            rects.push_back({i->time_begin_orig, i->time_end_orig,
+                             group_of[i->id],
+                             i->offset_in_overwrite_dest_root(),
+                             i->size_orig});
+        }
+    }
+    std::sort(rects.begin(), rects.end(), [](const Rect& a, const Rect& b) {
+        return a.begin < b.begin;
+    });
+
+    // with the base address of group b fixed, a conflicts with b if
+    // addr(a) - addr(b) is in (off_b - off_a - size_a, off_b + size_b - off_a)
+    size_t nr_conflict = 0;
+    for (size_t i = 0; i < rects.size(); ++i) {
+        auto&& a = rects[i];
+        for (size_t j = i + 1; j < rects.size() && rects[j].begin < a.end;
+             ++j) {
+            auto&& b = rects[j];
+            if (a.group == b.group) {
+                continue;
+            }
+            auto oa = static_cast<ptrdiff_t>(a.offset),
+                 sa = static_cast<ptrdiff_t>(a.size),
+                 ob = static_cast<ptrdiff_t>(b.offset),
+                 sb = static_cast<ptrdiff_t>(b.size);
+            m_groups[a.group].conflicts.push_back(
+                    {b.group, ob - oa - sa + 1, ob + sb - oa});
+            m_groups[b.group].conflicts.push_back(
+                    {a.group, oa - ob - sb + 1, oa + sa - ob});
+            nr_conflict += 2;
+            if (nr_conflict > MAX_NR_CONFLICT) {
+                m_groups.clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t StaticMemAllocLocalSearch::get_peak() const {
+    size_t peak = 0;
+    for (auto i : m_interval) {
+        update_max(peak, i->addr_end());
+    }
+    return peak;
+}
+
+size_t StaticMemAllocLocalSearch::place(const std::vector<size_t>& order,
+                                        std::vector<size_t>& addr,
+                                        size_t limit,
+                                        size_t& top_group) const {
+    addr.assign(m_groups.size(), INVALID);
+    top_group = order.at(0);
+    size_t peak = 0;
+    std::vector<std::pair<ptrdiff_t, ptrdiff_t>> forbidden;
+    for (auto group : order) {
+        auto&& grp = m_groups[group];
+        forbidden.clear();
+        for (auto&& i : grp.conflicts) {
+            auto base = addr[i.other];
+            if (base != INVALID) {
+                forbidden.emplace_back(base + i.lo, base + i.hi);
+            }
+        }
+        std::sort(forbidden.begin(), forbidden.end());
+        size_t cur = 0;
+        for (auto&& i : forbidden) {
+            if (i.first > static_cast<ptrdiff_t>(cur)) {
+                break;
+            }
+            if (i.second > static_cast<ptrdiff_t>(cur)) {
+                cur = align(static_cast<size_t>(i.second));
+            }
+        }
+        addr[group] = cur;
+        if (cur + grp.extent > peak) {
+            peak = cur + grp.extent;
+            top_group = group;
+            if (peak > limit) {
+                return peak;
+            }
+        }
+    }
+    return peak;
+}
+
+std::vector<size_t> StaticMemAllocLocalSearch::order_by_addr() const {
+    std::vector<size_t> order(m_groups.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    auto key = [this](size_t group) {
+        auto root = m_groups[group].members[0].first;
+        return std::make_pair(root->addr_begin, root->time_begin_orig);
+    };
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return key(a) < key(b); });
+    return order;
+}
+
+void StaticMemAllocLocalSearch::apply_addr(const std::vector<size_t>& addr) {
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+        for (auto&& j : m_groups[i].members) {
+            j.first->addr_begin = addr[i] + j.second;
+        }
+    }
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
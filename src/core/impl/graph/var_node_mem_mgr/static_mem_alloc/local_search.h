@@ -0,0 +1,87 @@
+/**
+ * \file src/core/impl/graph/var_node_mem_mgr/static_mem_alloc/local_search.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#pragma once
+
+#include "./impl.h"
+
+namespace mgb {
+namespace cg {
+
+/*!
+ * \brief improve the results of the heuristics by local search
+ *
+ * A solution is represented by an order of the intervals, which are placed
+ * one by one at the lowest address that does not conflict with placed ones.
+ * Placing in the address order of a heuristic solution never increases its
+ * peak, so the search starts from the best heuristic, and then moves the
+ * intervals that reach the peak earlier or swaps conflicting intervals,
+ * accepting moves that do not increase the peak.
+ *
+ * An interval and those overwriting it are placed together as a group.
+ */
+class StaticMemAllocLocalSearch final : public StaticMemAllocImplHelper {
+    //! base address of group \p other forbids [lo, hi) relative to it
+    struct Conflict {
+        size_t other;
+        ptrdiff_t lo, hi;
+    };
+
+    struct Group {
+        //! (interval, offset in the root), where the first one is the root
+        std::vector<std::pair<Interval*, size_t>> members;
+        //! max end address relative to the root
+        size_t extent = 0;
+        std::vector<Conflict> conflicts;
+    };
+
+    double m_time_budget = 100;
+    size_t m_peak = 0, m_peak_heuristic = 0;
+    std::vector<Group> m_groups;
+
+    //! initialize m_groups; return false if there are too many conflicts
+    bool init_groups();
+
+    //! peak usage of the intervals placed at their current addresses
+    size_t get_peak() const;
+
+    /*!
+     * \brief place the groups in given order
+     * \param[out] addr base address of each group
+     * \param limit stop and return a value above it if the peak exceeds it
+     * \param[out] top_group the group that reaches the peak
+     * \return peak usage
+     */
+    size_t place(const std::vector<size_t>& order, std::vector<size_t>& addr,
+                 size_t limit, size_t& top_group) const;
+
+    //! the groups in the address order of current addr_begin
+    std::vector<size_t> order_by_addr() const;
+
+    void apply_addr(const std::vector<size_t>& addr);
+
+public:
+    void do_solve() override;
+
+    size_t tot_alloc() const override { return m_peak; }
+
+    size_t tot_alloc_heuristic() const override { return m_peak_heuristic; }
+
+    StaticMemAlloc& time_budget(double msecs) override {
+        m_time_budget = msecs;
+        return *this;
+    }
+};
+
+}  // namespace cg
+}  // namespace mgb
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -22,6 +22,53 @@ int sys::get_cpu_count() {
     return std::max(std::thread::hardware_concurrency(), 1u);
 }
 
+namespace {
+#if defined(__linux__)
+//! read an integer from a sysfs file of the cpu, or 0 on failure
+long read_cpu_sysfs(int cpu, const char* name) {
+    auto path = ssprintf("/sys/devices/system/cpu/cpu%d/%s", cpu, name);
+    FILE* fin = fopen(path.c_str(), "r");
+    if (!fin)
+        return 0;
+    long val = 0;
+    if (fscanf(fin, "%ld", &val) != 1)
+        val = 0;
+    fclose(fin);
+    return val;
+}
+#endif
+
+std::vector<int> all_cpus() {
+    std::vector<int> ret(get_cpu_count());
+    for (size_t i = 0; i < ret.size(); ++i)
+        ret[i] = i;
+    return ret;
+}
+}  // anonymous namespace
+
+std::vector<float> sys::get_cpu_capacity() {
+    int nr = get_cpu_count();
+    std::vector<float> ret(nr, 1.f);
+#if defined(__linux__)
+    for (auto name : {"cpu_capacity", "cpufreq/cpuinfo_max_freq"}) {
+        std::vector<long> val(nr);
+        long max_val = 0;
+        bool ok = true;
+        for (int i = 0; i < nr && ok; ++i) {
+            val[i] = read_cpu_sysfs(i, name);
+            ok = val[i] > 0;
+            max_val = std::max(max_val, val[i]);
+        }
+        if (ok) {
+            for (int i = 0; i < nr; ++i)
+                ret[i] = static_cast<float>(val[i]) / max_val;
+            break;
+        }
+    }
+#endif
+    return ret;
+}
+
 #if defined(WIN32)
 
 #include <windows.h>
@@ -39,6 +86,10 @@ void sys::set_cpu_affinity(const std::vector<int> &cpuset) {
     }
 }
 
+std::vector<int> sys::get_cpu_affinity() {
+    return all_cpus();
+}
+
 std::pair<size_t, size_t> sys::get_ram_status_bytes() {
     MEMORYSTATUSEX statex;
     statex.dwLength = sizeof(statex);
@@ -81,6 +132,23 @@ void sys::set_cpu_affinity(const std::vector<int> &cpuset) {
 #endif
 }
 
+std::vector<int> sys::get_cpu_affinity() {
+#if defined(__APPLE__) || !MGB_HAVE_THREAD
+    return all_cpus();
+#else
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask))
+        return all_cpus();
+    std::vector<int> ret;
+    for (int i = 0, nr = get_cpu_count(); i < nr; ++i) {
+        if (CPU_ISSET(i, &mask))
+            ret.push_back(i);
+    }
+    return ret;
+#endif
+}
+
 #ifdef MGB_EXTERN_API_MEMSTAT
 extern "C" {
     void mgb_extern_api_memstat(size_t *tot, size_t *free);
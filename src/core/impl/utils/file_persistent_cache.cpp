@@ -0,0 +1,460 @@
+/**
+ * \file src/core/impl/utils/file_persistent_cache.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "megbrain/utils/persistent_cache.h"
+#include "megbrain/version.h"
+#include "megdnn/version.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace mgb;
+
+/*
+ * The file is shared by all versions: records of other version tags are
+ * neither visible to this cache nor dropped by its compaction.
+ *
+ * file format, all integers in local endian:
+ *
+ * <FILE_MAGIC|8 bytes><record>*
+ *
+ * record:
+ * <RECORD_MAGIC|uint32_t><payload_size|uint32_t><payload><xxhash|uint64_t>
+ *
+ * payload, each field is <size|uint32_t><data>:
+ * <version_tag><category><key><value>
+ */
+
+namespace {
+//! magic of the file, which also encodes the format version
+constexpr char FILE_MAGIC[8] = {'M', 'G', 'B', 'F', 'P', 'C', '0', '1'};
+constexpr uint32_t RECORD_MAGIC = 0x52435046;
+//! upper bound of a payload, to detect corrupted size fields
+constexpr uint32_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+//! compact only if there are at least this number of useless records
+constexpr size_t COMPACT_MIN_GARBAGE = 256;
+
+#ifndef WIN32
+uint64_t id_from_stat(int err, const struct stat& st) {
+    if (err)
+        return 0;
+    return (static_cast<uint64_t>(st.st_dev) << 32) ^
+           static_cast<uint64_t>(st.st_ino);
+}
+#endif
+
+void append_field(std::string& buf, const void* ptr, size_t size) {
+    uint32_t size32 = size;
+    mgb_assert(size32 == size);
+    buf.append(reinterpret_cast<const char*>(&size32), sizeof(size32));
+    buf.append(static_cast<const char*>(ptr), size);
+}
+
+std::string make_record(const std::string& version_tag,
+                        const std::string& category, const std::string& key,
+                        const std::string& value) {
+    std::string payload;
+    append_field(payload, version_tag.data(), version_tag.size());
+    append_field(payload, category.data(), category.size());
+    append_field(payload, key.data(), key.size());
+    append_field(payload, value.data(), value.size());
+    mgb_assert(payload.size() <= MAX_PAYLOAD_SIZE,
+               "persistent cache entry too large: %zu", payload.size());
+
+    uint32_t head[2] = {RECORD_MAGIC, static_cast<uint32_t>(payload.size())};
+    uint64_t checksum = XXHash{}.update(payload.data(), payload.size()).digest();
+    std::string ret;
+    ret.reserve(sizeof(head) + payload.size() + sizeof(checksum));
+    ret.append(reinterpret_cast<const char*>(head), sizeof(head));
+    ret.append(payload);
+    ret.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    return ret;
+}
+
+//! split a payload into its fields; return false if it is malformed
+bool parse_payload(const std::string& payload, std::string* fields,
+                   size_t nr_fields) {
+    size_t pos = 0;
+    for (size_t i = 0; i < nr_fields; ++i) {
+        uint32_t size;
+        if (payload.size() - pos < sizeof(size))
+            return false;
+        memcpy(&size, payload.data() + pos, sizeof(size));
+        pos += sizeof(size);
+        if (payload.size() - pos < size)
+            return false;
+        fields[i].assign(payload.data() + pos, size);
+        pos += size;
+    }
+    return pos == payload.size();
+}
+
+std::string cpu_model_name() {
+#if defined(__linux__) || defined(__ANDROID__)
+    std::ifstream fin{"/proc/cpuinfo"};
+    std::string line, ret;
+    while (std::getline(fin, line)) {
+        // x86 reports "model name", arm reports "Hardware" or "CPU part"
+        for (const char* name : {"model name", "Hardware", "CPU part"}) {
+            if (!line.compare(0, strlen(name), name)) {
+                auto pos = line.find(':');
+                if (pos != std::string::npos) {
+                    ret = line.substr(pos + 1);
+                    ret.erase(0, ret.find_first_not_of(" \t"));
+                    return ret;
+                }
+            }
+        }
+    }
+#endif
+    return "unknown";
+}
+
+std::string cpu_isa() {
+    std::string ret;
+#if (defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+#define cb(isa)                           \
+    if (__builtin_cpu_supports(isa)) {    \
+        ret.append(isa).push_back(',');   \
+    }
+    cb("sse4.2") cb("avx") cb("avx2") cb("fma") cb("avx512f")
+#undef cb
+#endif
+#if defined(__ARM_NEON)
+    ret.append("neon,");
+#endif
+#if defined(__ARM_FEATURE_DOTPROD)
+    ret.append("dot,");
+#endif
+#if defined(__ARM_FEATURE_FP16_VECTOR_ARITHMETIC)
+    ret.append("fp16,");
+#endif
+    if (!ret.empty())
+        ret.pop_back();
+    return ret;
+}
+}  // anonymous namespace
+
+// ================= FilePersistentCache::LockedFile ==================
+/*!
+ * \brief the cache file opened for read and append, holding an exclusive lock
+ *
+ * If the file has been replaced by a compaction in another process while
+ * waiting for the lock, it is reopened. The lock is released on close.
+ */
+class FilePersistentCache::LockedFile : public NonCopyableObj {
+    FILE* m_fp = nullptr;
+    uint64_t m_id = 0;
+#ifdef WIN32
+    HANDLE m_handle;
+    OVERLAPPED m_overlapped;
+#endif
+
+public:
+    explicit LockedFile(const std::string& path) {
+        for (;;) {
+            m_fp = fopen(path.c_str(), "a+b");
+            mgb_assert(m_fp, "failed to open %s: %s", path.c_str(),
+                       strerror(errno));
+#ifdef WIN32
+            // the file is never replaced on windows, see compact_locked()
+            m_handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(m_fp)));
+            memset(&m_overlapped, 0, sizeof(m_overlapped));
+            mgb_assert(LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0,
+                                  MAXDWORD, MAXDWORD, &m_overlapped),
+                       "failed to lock %s: error %lu", path.c_str(),
+                       static_cast<unsigned long>(GetLastError()));
+            break;
+#else
+            int err;
+            while ((err = flock(fileno(m_fp), LOCK_EX)) && errno == EINTR)
+                ;
+            mgb_assert(!err, "failed to lock %s: %s", path.c_str(),
+                       strerror(errno));
+            struct stat st_fd, st_path;
+            m_id = id_from_stat(fstat(fileno(m_fp), &st_fd), st_fd);
+            if (m_id && m_id == id_from_stat(stat(path.c_str(), &st_path),
+                                             st_path)) {
+                break;
+            }
+            fclose(m_fp);
+#endif
+        }
+    }
+
+    ~LockedFile() {
+#ifdef WIN32
+        UnlockFileEx(m_handle, 0, MAXDWORD, MAXDWORD, &m_overlapped);
+#endif
+        fclose(m_fp);
+    }
+
+    uint64_t id() const { return m_id; }
+
+    size_t size() {
+        auto err = fseek(m_fp, 0, SEEK_END);
+        mgb_assert(!err);
+        auto pos = ftell(m_fp);
+        mgb_assert(pos >= 0);
+        return pos;
+    }
+
+    bool read(size_t offset, void* dst, size_t size) {
+        return !fseek(m_fp, offset, SEEK_SET) &&
+               fread(dst, 1, size, m_fp) == size;
+    }
+
+    //! check that the file starts with FILE_MAGIC
+    bool check_magic() {
+        char magic[sizeof(FILE_MAGIC)];
+        return read(0, magic, sizeof(magic)) &&
+               !memcmp(magic, FILE_MAGIC, sizeof(magic));
+    }
+
+    /*!
+     * \brief read the payload of the record at \p offset
+     * \param end end of the readable part of the file
+     * \return size of the whole record, or 0 if it is truncated or corrupted
+     */
+    size_t read_record(size_t offset, size_t end, std::string& payload) {
+        uint32_t head[2];
+        uint64_t checksum;
+        auto remain = end - offset;
+        if (remain < sizeof(head) + sizeof(checksum) ||
+            !read(offset, head, sizeof(head)) || head[0] != RECORD_MAGIC ||
+            head[1] > MAX_PAYLOAD_SIZE ||
+            remain < sizeof(head) + head[1] + sizeof(checksum)) {
+            return 0;
+        }
+        payload.resize(head[1]);
+        if (!read(offset + sizeof(head), &payload[0], head[1]) ||
+            !read(offset + sizeof(head) + head[1], &checksum,
+                  sizeof(checksum)) ||
+            XXHash{}.update(payload.data(), payload.size()).digest() !=
+                    checksum) {
+            return 0;
+        }
+        return sizeof(head) + head[1] + sizeof(checksum);
+    }
+
+    void append(const std::string& buf) {
+        // the file is opened in append mode, so writes always go to the end;
+        // the seek is still needed when switching from reading to writing
+        auto err = fseek(m_fp, 0, SEEK_END);
+        mgb_assert(!err);
+        auto nr = fwrite(buf.data(), 1, buf.size(), m_fp);
+        mgb_assert(nr == buf.size() && !fflush(m_fp),
+                   "failed to write persistent cache: %s", strerror(errno));
+    }
+};
+
+// ================= FilePersistentCache ==================
+FilePersistentCache::FilePersistentCache(std::string path,
+                                         std::string version_tag)
+        : m_path{std::move(path)}, m_version_tag{std::move(version_tag)} {}
+
+bool FilePersistentCache::read_new_records(LockedFile& file) {
+    if (file.id() != m_file_id) {
+        // replaced by a compaction in another process; read from scratch
+        m_file_id = file.id();
+        m_read_offset = 0;
+        m_nr_record = 0;
+    }
+    size_t end = file.size();
+    if (!m_read_offset) {
+        if (!end) {
+            file.append({FILE_MAGIC, sizeof(FILE_MAGIC)});
+            m_read_offset = sizeof(FILE_MAGIC);
+            return true;
+        }
+        if (!file.check_magic()) {
+            mgb_log_warn("invalid persistent cache file %s; it is reset",
+                         m_path.c_str());
+            return false;
+        }
+        m_read_offset = sizeof(FILE_MAGIC);
+    }
+
+    std::string payload, fields[4];
+    while (m_read_offset < end) {
+        auto size = file.read_record(m_read_offset, end, payload);
+        if (!size || !parse_payload(payload, fields, 4)) {
+            return false;
+        }
+        m_read_offset += size;
+        if (fields[0] != m_version_tag) {
+            // owned by other versions
+            continue;
+        }
+        ++m_nr_record;
+        auto&& category = m_cache[fields[1]];
+        auto iter = category.find(fields[2]);
+        if (iter == category.end()) {
+            category.emplace(std::move(fields[2]), std::move(fields[3]));
+            ++m_nr_entry;
+        } else if (iter->second != fields[3]) {
+            iter->second = std::move(fields[3]);
+        }
+    }
+    return true;
+}
+
+void FilePersistentCache::compact_locked(LockedFile& file) {
+#ifdef WIN32
+    // a file opened by other processes can not be replaced on windows, and
+    // they would not notice the replacement without file identities
+    MGB_MARK_USED_VAR(file);
+    mgb_log_debug("persistent cache %s is not compacted on windows",
+                  m_path.c_str());
+#else
+    auto tmp_path = ssprintf("%s.%d.tmp", m_path.c_str(),
+                             static_cast<int>(getpid()));
+    std::string buf{FILE_MAGIC, sizeof(FILE_MAGIC)};
+
+    // keep the valid records of other versions as they are
+    if (file.check_magic()) {
+        size_t end = file.size(), offset = sizeof(FILE_MAGIC), size;
+        std::string payload, fields[4];
+        while (offset < end &&
+               (size = file.read_record(offset, end, payload)) &&
+               parse_payload(payload, fields, 4)) {
+            if (fields[0] != m_version_tag) {
+                buf.append(make_record(fields[0], fields[1], fields[2],
+                                       fields[3]));
+            }
+            offset += size;
+        }
+    }
+
+    size_t nr_record = 0;
+    for (auto&& category : m_cache) {
+        for (auto&& entry : category.second) {
+            buf.append(make_record(m_version_tag, category.first, entry.first,
+                                   entry.second));
+            ++nr_record;
+        }
+    }
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    mgb_assert(fp, "failed to open %s: %s", tmp_path.c_str(), strerror(errno));
+    auto nr = fwrite(buf.data(), 1, buf.size(), fp);
+    auto err = fclose(fp);
+    mgb_assert(nr == buf.size() && !err, "failed to write %s",
+               tmp_path.c_str());
+    // the old file stays locked until the rename is done, so waiting
+    // processes would find it replaced and reopen
+    err = rename(tmp_path.c_str(), m_path.c_str());
+    mgb_assert(!err, "failed to rename %s to %s: %s", tmp_path.c_str(),
+               m_path.c_str(), strerror(errno));
+    mgb_log_debug("persistent cache %s compacted: %zu records -> %zu",
+                  m_path.c_str(), m_nr_record, nr_record);
+
+    struct stat st;
+    m_file_id = id_from_stat(stat(m_path.c_str(), &st), st);
+    m_read_offset = buf.size();
+    m_nr_record = nr_record;
+#endif
+}
+
+void FilePersistentCache::ensure_loaded() {
+    if (m_loaded)
+        return;
+    m_loaded = true;
+    LockedFile file{m_path};
+    bool ok = read_new_records(file);
+    if (!ok || m_nr_record >= m_nr_entry * 2 + COMPACT_MIN_GARBAGE) {
+        compact_locked(file);
+    }
+}
+
+Maybe<PersistentCache::Blob> FilePersistentCache::get(
+        const std::string& category, const Blob& key) {
+    MGB_LOCK_GUARD(m_mtx);
+    ensure_loaded();
+    std::string key_str{static_cast<const char*>(key.ptr), key.size};
+    auto lookup = [&]() -> Maybe<Blob> {
+        auto iter0 = m_cache.find(category);
+        if (iter0 == m_cache.end())
+            return None;
+        auto iter1 = iter0->second.find(key_str);
+        if (iter1 == iter0->second.end())
+            return None;
+        return Blob{iter1->second.data(), iter1->second.size()};
+    };
+    auto ret = lookup();
+    if (!ret.valid()) {
+        // the entry may have been added by another process
+        LockedFile file{m_path};
+        if (!read_new_records(file)) {
+            compact_locked(file);
+        }
+        ret = lookup();
+    }
+    return ret;
+}
+
+void FilePersistentCache::put(const std::string& category, const Blob& key,
+                              const Blob& value) {
+    MGB_LOCK_GUARD(m_mtx);
+    ensure_loaded();
+    std::string key_str{static_cast<const char*>(key.ptr), key.size},
+            value_str{static_cast<const char*>(value.ptr), value.size};
+    auto&& cache = m_cache[category];
+    auto iter = cache.find(key_str);
+    if (iter != cache.end() && iter->second == value_str)
+        return;
+
+    LockedFile file{m_path};
+    // catch up first, so the offset can be moved past our own record
+    bool ok = read_new_records(file);
+    auto ins = cache.emplace(key_str, value_str);
+    if (ins.second) {
+        ++m_nr_entry;
+    } else {
+        ins.first->second = value_str;
+    }
+    if (ok) {
+        file.append(make_record(m_version_tag, category, key_str, value_str));
+        m_read_offset = file.size();
+        ++m_nr_record;
+    }
+    if (!ok || m_nr_record >= m_nr_entry * 2 + COMPACT_MIN_GARBAGE) {
+        compact_locked(file);
+    }
+}
+
+void FilePersistentCache::compact() {
+    MGB_LOCK_GUARD(m_mtx);
+    ensure_loaded();
+    LockedFile file{m_path};
+    read_new_records(file);
+    compact_locked(file);
+}
+
+std::string FilePersistentCache::default_version_tag() {
+    auto dnn = megdnn::get_version();
+    return ssprintf("mgb=%d.%d.%d;megdnn=%d.%d.%d;cpu=%s;isa=%s", MGB_MAJOR,
+                    MGB_MINOR, MGB_PATCH, dnn.major, dnn.minor, dnn.patch,
+                    cpu_model_name().c_str(), cpu_isa().c_str());
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
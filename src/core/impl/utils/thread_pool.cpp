@@ -10,7 +10,13 @@
  */
 
 #include "megbrain/utils/thread_pool.h"
+#include "megbrain/utils/thread.h"
+
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
 
 using namespace mgb;
 
@@ -70,6 +76,13 @@ ThreadPool::ThreadPool(size_t threads_num)
         }
     }
 }
+
+ThreadPool::ThreadPool(size_t threads_num, NoWorkerTag)
+        : m_nr_threads(threads_num),
+          m_main_affinity_flag{false},
+          m_stop{false},
+          m_active{false} {}
+
 void ThreadPool::add_task(const TaskElem& task_elem) {
     //! Make sure the main thread have bind
     if (m_main_affinity_flag &&
@@ -165,6 +178,524 @@ ThreadPool::~ThreadPool() {
         delete worker;
     }
 }
+
+/* ==================== WorkStealingThreadPool ==================== */
+namespace {
+//! bounds of the adaptive number of spin rounds before an idle worker parks
+constexpr size_t WS_SPIN_MIN = 32;
+constexpr size_t WS_SPIN_MAX = 1 << 13;
+//! each thread initially splits its block into about this many ranges
+constexpr size_t WS_RANGES_PER_THREAD = 4;
+
+inline void cpu_relax() {
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+    __builtin_ia32_pause();
+#elif (defined(__aarch64__) || defined(__arm__)) && defined(__GNUC__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+//! the pool and slot the current thread is working for
+struct WSThreadCtx {
+    const WorkStealingThreadPool* pool;
+    size_t slot_id;
+};
+MGB_THREAD_LOCAL_PTR(WSThreadCtx) ws_cur_ctx = nullptr;
+
+class WSThreadCtxGuard {
+    WSThreadCtx m_ctx;
+    WSThreadCtx* m_prev;
+
+public:
+    WSThreadCtxGuard(const WorkStealingThreadPool* pool, size_t slot_id)
+            : m_ctx{pool, slot_id}, m_prev{ws_cur_ctx} {
+        ws_cur_ctx = &m_ctx;
+    }
+    ~WSThreadCtxGuard() { ws_cur_ctx = m_prev; }
+};
+
+#if defined(__linux__) && !defined(ANDROID) && !defined(__ANDROID__)
+//! parse id list in the format of sysfs, such as "0-3,8,10-11"
+std::vector<int> parse_id_list(const char* str) {
+    std::vector<int> ret;
+    while (*str) {
+        char* end;
+        long first = strtol(str, &end, 10);
+        if (end == str)
+            break;
+        long last = first;
+        str = end;
+        if (*str == '-') {
+            last = strtol(str + 1, &end, 10);
+            str = end;
+        }
+        for (long i = first; i <= last; ++i) {
+            ret.push_back(static_cast<int>(i));
+        }
+        if (*str != ',')
+            break;
+        ++str;
+    }
+    return ret;
+}
+
+std::vector<int> read_id_list(const std::string& path) {
+    std::vector<int> ret;
+    FILE* fin = fopen(path.c_str(), "r");
+    if (!fin)
+        return ret;
+    char buf[4096];
+    if (fgets(buf, sizeof(buf), fin)) {
+        ret = parse_id_list(buf);
+    }
+    fclose(fin);
+    return ret;
+}
+
+//! cpus of each NUMA node which has cpus
+std::vector<std::vector<int>> read_numa_cpus() {
+    std::vector<std::vector<int>> ret;
+    int nr_cpu = sys::get_cpu_count();
+    for (int node : read_id_list("/sys/devices/system/node/online")) {
+        std::vector<int> cpus;
+        for (int cpu : read_id_list(ssprintf(
+                     "/sys/devices/system/node/node%d/cpulist", node))) {
+            if (cpu < nr_cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        //! memory-only nodes are skipped
+        if (!cpus.empty()) {
+            ret.emplace_back(std::move(cpus));
+        }
+    }
+    return ret;
+}
+#else
+std::vector<std::vector<int>> read_numa_cpus() {
+    return {};
+}
+#endif
+}  // anonymous namespace
+
+//! sub-tasks of one add_task() call
+struct WorkStealingThreadPool::Region {
+    const MultiThreadingTask* task;
+    //! number of unfinished sub-tasks
+    std::atomic_size_t nr_remain;
+    //! ranges not larger than this are not split
+    size_t grain;
+};
+
+struct WorkStealingThreadPool::Range {
+    Region* region;
+    size_t begin, end;
+};
+
+struct WorkStealingThreadPool::Slot {
+    Spinlock lock;
+    std::atomic<float> weight{1.f};
+    std::deque<Range> ranges;
+    //! number of ranges, read without lock to skip empty victims
+    std::atomic_size_t nr_ranges{0};
+    //! spin rounds before parking, only accessed by the owner worker
+    size_t spin_limit = WS_SPIN_MIN;
+    std::atomic_bool affinity_flag{false};
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(size_t nr_threads,
+                                               bool numa_aware)
+        : WorkStealingThreadPool(nr_threads,
+                                 numa_placement(nr_threads, numa_aware)) {}
+
+WorkStealingThreadPool::WorkStealingThreadPool(size_t nr_threads,
+                                               Placement placement)
+        : ThreadPool(nr_threads, NoWorkerTag{}),
+          m_nr_threads(nr_threads),
+          m_numa_node(std::move(placement.numa_node)),
+          m_thread_cpus(std::move(placement.cpus)),
+          m_cpu_capacity(std::move(placement.cpu_capacity)) {
+    mgb_assert(m_nr_threads >= 1, "invalid thread number: %zu", nr_threads);
+    if (m_nr_threads > static_cast<size_t>(sys::get_cpu_count())) {
+        mgb_log_debug(
+                "The number of threads is bigger than number of "
+                "physical cpu cores, got: %zu core_number: %zu",
+                m_nr_threads, static_cast<size_t>(sys::get_cpu_count()));
+    }
+    m_numa_node.resize(m_nr_threads, 0);
+    m_thread_cpus.resize(m_nr_threads);
+    auto&& weights = placement.weights;
+    mgb_assert(weights.empty() || weights.size() == m_nr_threads);
+    for (size_t i = 0; i < m_nr_threads; ++i) {
+        m_slots.emplace_back(std::make_unique<Slot>());
+        if (!weights.empty()) {
+            mgb_assert(weights[i] > 0, "thread weight must be positive");
+            m_slots[i]->weight = weights[i];
+        }
+    }
+    m_steal_order.resize(m_nr_threads);
+    for (size_t i = 0; i < m_nr_threads; ++i) {
+        auto&& order = m_steal_order[i];
+        for (int same_node = 1; same_node >= 0; --same_node) {
+            for (size_t d = 1; d < m_nr_threads; ++d) {
+                size_t j = (i + d) % m_nr_threads;
+                if ((m_numa_node[i] == m_numa_node[j]) == bool(same_node)) {
+                    order.push_back(j);
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i + 1 < m_nr_threads; ++i) {
+        m_threads.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+    {
+        MGB_LOCK_GUARD(m_mutex_task);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_cv.notify_all();
+    }
+    for (auto&& thread : m_threads) {
+        thread.join();
+    }
+}
+
+WorkStealingThreadPool::Placement WorkStealingThreadPool::numa_placement(
+        size_t nr_threads, bool numa_aware) {
+    Placement ret;
+    if (!numa_aware || nr_threads <= 1) {
+        return ret;
+    }
+    auto numa_cpus = read_numa_cpus();
+    size_t nr_node = numa_cpus.size();
+    if (nr_node > 1) {
+        //! neighbouring threads are placed on the same node, since they
+        //! initially get neighbouring sub-tasks
+        for (size_t i = 0; i < nr_threads; ++i) {
+            int node = static_cast<int>(i * nr_node / nr_threads);
+            ret.numa_node.push_back(node);
+            ret.cpus.push_back(numa_cpus[node]);
+        }
+        mgb_log_debug("work stealing thread pool spans %zu NUMA nodes",
+                      nr_node);
+    }
+    return ret;
+}
+
+std::vector<size_t> WorkStealingThreadPool::split_by_weights(
+        size_t parallelism, const std::vector<float>& weights) {
+    float total = 0;
+    for (float i : weights) {
+        total += i;
+    }
+    std::vector<size_t> ret(weights.size());
+    float acc = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        acc += weights[i];
+        size_t end = i + 1 == weights.size()
+                             ? parallelism
+                             : static_cast<size_t>(parallelism * acc / total);
+        begin = ret[i] = std::max(begin, std::min(end, parallelism));
+    }
+    return ret;
+}
+
+std::vector<float> WorkStealingThreadPool::thread_weights() const {
+    std::vector<float> ret;
+    for (auto&& slot : m_slots) {
+        ret.push_back(slot->weight.load(std::memory_order_relaxed));
+    }
+    return ret;
+}
+
+void WorkStealingThreadPool::apply_affinity(size_t slot_id) {
+    m_core_binding_function(slot_id);
+    if (m_cpu_capacity.empty()) {
+        return;
+    }
+    float sum = 0;
+    size_t nr = 0;
+    for (int cpu : sys::get_cpu_affinity()) {
+        if (static_cast<size_t>(cpu) < m_cpu_capacity.size()) {
+            sum += m_cpu_capacity[cpu];
+            ++nr;
+        }
+    }
+    if (nr) {
+        m_slots[slot_id]->weight.store(sum / nr, std::memory_order_relaxed);
+    }
+}
+
+void WorkStealingThreadPool::push_range(size_t slot_id, const Range& range) {
+    auto&& slot = *m_slots[slot_id];
+    MGB_LOCK_GUARD(slot.lock);
+    slot.ranges.push_back(range);
+    slot.nr_ranges.fetch_add(1, std::memory_order_relaxed);
+    m_nr_queued.fetch_add(1);
+}
+
+bool WorkStealingThreadPool::pop_range(size_t slot_id, const Region* region,
+                                       Range& range) {
+    auto&& slot = *m_slots[slot_id];
+    if (!slot.nr_ranges.load(std::memory_order_relaxed))
+        return false;
+    MGB_LOCK_GUARD(slot.lock);
+    //! the owner takes the newest range
+    for (auto iter = slot.ranges.rbegin(); iter != slot.ranges.rend();
+         ++iter) {
+        if (!region || iter->region == region) {
+            range = *iter;
+            slot.ranges.erase(std::next(iter).base());
+            slot.nr_ranges.fetch_sub(1, std::memory_order_relaxed);
+            m_nr_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingThreadPool::steal_range(size_t slot_id, const Region* region,
+                                         Range& range) {
+    for (size_t victim_id : m_steal_order[slot_id]) {
+        auto&& victim = *m_slots[victim_id];
+        if (!victim.nr_ranges.load(std::memory_order_relaxed))
+            continue;
+        MGB_LOCK_GUARD(victim.lock);
+        //! thieves take the oldest, and thus the largest, range
+        for (auto iter = victim.ranges.begin(); iter != victim.ranges.end();
+             ++iter) {
+            if (!region || iter->region == region) {
+                range = *iter;
+                victim.ranges.erase(iter);
+                victim.nr_ranges.fetch_sub(1, std::memory_order_relaxed);
+                m_nr_queued.fetch_sub(1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void WorkStealingThreadPool::run_range(size_t slot_id, Range range) {
+    auto region = range.region;
+    bool splitted = false;
+    while (range.end - range.begin > region->grain) {
+        size_t mid = range.begin + (range.end - range.begin) / 2;
+        push_range(slot_id, {region, mid, range.end});
+        range.end = mid;
+        splitted = true;
+    }
+    if (splitted) {
+        wake_workers();
+    }
+    auto&& task = *region->task;
+    for (size_t i = range.begin; i < range.end; ++i) {
+        task(i, slot_id);
+    }
+    region->nr_remain.fetch_sub(range.end - range.begin,
+                                std::memory_order_acq_rel);
+}
+
+void WorkStealingThreadPool::help_until_done(size_t slot_id, Region& region) {
+    Range range;
+    size_t nr_idle = 0;
+    while (region.nr_remain.load(std::memory_order_acquire)) {
+        if (pop_range(slot_id, &region, range) ||
+            steal_range(slot_id, &region, range)) {
+            run_range(slot_id, range);
+            nr_idle = 0;
+        } else if (++nr_idle < WS_SPIN_MAX) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void WorkStealingThreadPool::wake_workers() {
+    if (m_nr_parked.load()) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.notify_all();
+    }
+}
+
+void WorkStealingThreadPool::worker_loop(size_t slot_id) {
+    WSThreadCtxGuard ctx_guard{this, slot_id};
+    auto&& slot = *m_slots[slot_id];
+    if (!m_thread_cpus[slot_id].empty()) {
+        sys::set_cpu_affinity(m_thread_cpus[slot_id]);
+    }
+    Range range;
+    while (!m_stop.load(std::memory_order_acquire)) {
+        if (slot.affinity_flag.load(std::memory_order_acquire)) {
+            apply_affinity(slot_id);
+            slot.affinity_flag.store(false, std::memory_order_release);
+        }
+        bool found = false;
+        for (size_t round = 0; round < slot.spin_limit &&
+                               m_active.load(std::memory_order_acquire) &&
+                               !m_stop.load(std::memory_order_relaxed);
+             ++round) {
+            if (m_nr_queued.load() && (pop_range(slot_id, nullptr, range) ||
+                                       steal_range(slot_id, nullptr, range))) {
+                found = true;
+                break;
+            }
+            cpu_relax();
+        }
+        if (found) {
+            run_range(slot_id, range);
+            //! work came while spinning, so spin longer next time
+            slot.spin_limit = std::min(slot.spin_limit * 2, WS_SPIN_MAX);
+            continue;
+        }
+        slot.spin_limit = std::max(slot.spin_limit / 2, WS_SPIN_MIN);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_nr_parked.fetch_add(1);
+        m_cv.wait(lock, [this, &slot] {
+            return m_stop || slot.affinity_flag ||
+                   (m_active && m_nr_queued.load());
+        });
+        m_nr_parked.fetch_sub(1);
+    }
+}
+
+void WorkStealingThreadPool::add_task(const TaskElem& task_elem) {
+    size_t parallelism = task_elem.nr_parallelism;
+    WSThreadCtx* ctx = ws_cur_ctx;
+    bool nested = ctx && ctx->pool == this;
+    if (parallelism <= 1 || m_nr_threads == 1) {
+        //! thread id of a nested region must be the one of the caller
+        size_t thread_id = nested ? ctx->slot_id : 0;
+        for (size_t i = 0; i < parallelism; i++) {
+            task_elem.task(i, thread_id);
+        }
+        return;
+    }
+
+    Region region;
+    region.task = &task_elem.task;
+    region.nr_remain = parallelism;
+    region.grain = std::max<size_t>(
+            1, parallelism / (m_nr_threads * WS_RANGES_PER_THREAD));
+
+    if (nested) {
+        //! the nested region is spread by stealing from the caller
+        push_range(ctx->slot_id, {&region, 0, parallelism});
+        wake_workers();
+        help_until_done(ctx->slot_id, region);
+        return;
+    }
+
+    MGB_LOCK_GUARD(m_mutex_task);
+    size_t main_slot = m_nr_threads - 1;
+    if (m_main_affinity_flag && m_core_binding_function != nullptr) {
+        apply_affinity(main_slot);
+        m_main_affinity_flag = false;
+    }
+    active();
+    WSThreadCtxGuard ctx_guard{this, main_slot};
+    //! each thread gets a contiguous block of sub-tasks proportional to its
+    //! weight
+    auto ends = split_by_weights(parallelism, thread_weights());
+    for (size_t i = 0, begin = 0; i < m_nr_threads; begin = ends[i++]) {
+        if (begin < ends[i]) {
+            push_range(i, {&region, begin, ends[i]});
+        }
+    }
+    wake_workers();
+    help_until_done(main_slot, region);
+}
+
+void WorkStealingThreadPool::set_affinity(AffinityCallBack affinity_cb) {
+    mgb_assert(affinity_cb, "The affinity callback must not be nullptr");
+    MGB_LOCK_GUARD(m_mutex_task);
+    m_core_binding_function = affinity_cb;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i + 1 < m_nr_threads; ++i) {
+        m_slots[i]->affinity_flag.store(true, std::memory_order_release);
+    }
+    m_main_affinity_flag = true;
+    m_cv.notify_all();
+}
+
+void WorkStealingThreadPool::sync() {
+    while (m_nr_queued.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void WorkStealingThreadPool::active() {
+    if (!m_active) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_active = true;
+        m_cv.notify_all();
+    }
+}
+
+void WorkStealingThreadPool::deactive() {
+    MGB_LOCK_GUARD(m_mutex_task);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_active = false;
+}
+
+/* ==================== HybridThreadPool ==================== */
+namespace {
+//! the cores are considered equal above this ratio of min to max capacity
+constexpr float HYBRID_CAPACITY_RATIO = 0.9f;
+}  // anonymous namespace
+
+HybridThreadPool::HybridThreadPool(size_t nr_threads,
+                                   std::vector<float> capacity)
+        : WorkStealingThreadPool(nr_threads,
+                                 hybrid_placement(nr_threads,
+                                                  std::move(capacity))) {}
+
+WorkStealingThreadPool::Placement HybridThreadPool::hybrid_placement(
+        size_t nr_threads, std::vector<float> capacity) {
+    if (capacity.empty()) {
+        capacity = sys::get_cpu_capacity();
+    }
+    auto cap_range = std::minmax_element(capacity.begin(), capacity.end());
+    float min_cap = *cap_range.first, max_cap = *cap_range.second;
+    mgb_assert(min_cap > 0, "cpu capacity must be positive");
+    if (min_cap >= max_cap * HYBRID_CAPACITY_RATIO || !nr_threads) {
+        return numa_placement(nr_threads, true);
+    }
+
+    //! cpus from the fastest to the slowest
+    std::vector<int> order(capacity.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&capacity](int a, int b) {
+        return capacity[a] > capacity[b];
+    });
+    Placement ret;
+    ret.cpus.resize(nr_threads);
+    ret.weights.resize(nr_threads);
+    //! the calling thread is expected on the fastest cpu, the workers take
+    //! the following ones, and threads beyond the number of cpus are not
+    //! bound
+    for (size_t i = 0; i < nr_threads; ++i) {
+        size_t slot_id = (i + nr_threads - 1) % nr_threads;
+        int cpu = order[std::min(i, order.size() - 1)];
+        ret.weights[slot_id] = capacity[cpu];
+        if (i && i < order.size() && cpu < sys::get_cpu_count()) {
+            ret.cpus[slot_id] = {cpu};
+        }
+    }
+    ret.cpu_capacity = std::move(capacity);
+    mgb_log_debug("hybrid thread pool: %zu threads on cpus with capacity "
+                  "from %.2f to %.2f",
+                  nr_threads, min_cap, max_cap);
+    return ret;
+}
 #else
 void ThreadPool::add_task(const TaskElem& task_elem) {
     for (size_t i = 0; i < task_elem.nr_parallelism; i++) {
@@ -508,6 +508,32 @@ class CompNode {
          */
         static bool enable_affinity_for_cpu(bool flag);
 
+        /*!
+         * \brief set whether multithread CPU comp nodes created afterwards
+         *      use WorkStealingThreadPool instead of ThreadPool
+         *
+         * This is disabled by default.
+         *
+         * (implemented in comp_node/cpu/comp_node.cpp)
+         *
+         * \return original setting
+         */
+        static bool enable_work_stealing_for_cpu(bool flag);
+
+        /*!
+         * \brief set whether multithread CPU comp nodes created afterwards
+         *      use HybridThreadPool, which weights the threads by the
+         *      capacity of their cores
+         *
+         * This is disabled by default, and it takes precedence over
+         * enable_work_stealing_for_cpu().
+         *
+         * (implemented in comp_node/cpu/comp_node.cpp)
+         *
+         * \return original setting
+         */
+        static bool enable_hybrid_dispatch_for_cpu(bool flag);
+
 
     protected:
         //! ImplBase with env(); defined in CompNodeEnv
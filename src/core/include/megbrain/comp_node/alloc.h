@@ -395,6 +395,91 @@ public:
     };
 };
 
+/* ===================== CpuMemAlloc  ===================== */
+/*!
+ * \brief allocator for CPU memory that avoids locks and free lists on the
+ *      common path
+ *
+ * 1. Requests are rounded up to size classes (four classes per power of two),
+ *    and freed blocks are kept in a thread-local cache of their class; blocks
+ *    overflowing the thread caches go to a global pool of each class.
+ * 2. Blocks no smaller than huge_page_threshold() are mapped directly and
+ *    backed by transparent huge pages where available; blocks larger than
+ *    the largest size class are returned to the system on free.
+ * 3. alloc_arena() serves short-lived buffers such as workspaces from bump
+ *    arena chunks. A chunk is released as soon as all its buffers are freed,
+ *    except the last one, which is rewound; when the arena is empty (i.e. at
+ *    the end of a computing sequence) a single chunk that covers the peak
+ *    usage is kept.
+ *
+ * Memory returned by alloc() and alloc_arena() can both be released by
+ * free(). The cache of a thread is moved to the global pools when the thread
+ * exits. The memory cached by the calling thread and the global pools can be
+ * released by trim().
+ */
+class CpuMemAlloc : virtual public MemAllocBase {
+public:
+    struct Stats {
+        //! number of calls to alloc() and alloc_arena(), and to free()
+        size_t nr_alloc = 0, nr_free = 0;
+        //! allocations served by the thread cache and by the global pool
+        size_t nr_thread_cache_hit = 0, nr_pool_hit = 0;
+        //! number of blocks allocated from the system
+        size_t nr_sys_alloc = 0;
+        //! bytes of blocks in use, rounded up to the size classes
+        size_t used = 0;
+        //! bytes of free blocks kept in the thread caches and the pools
+        size_t cached = 0;
+        //! bytes allocated from the system (including the arena) and the peak
+        size_t reserved = 0, peak_reserved = 0;
+        //! bytes in blocks that are mapped with huge pages
+        size_t huge_page = 0;
+        //! bytes of arena chunks and peak bytes used by the arena
+        size_t arena_reserved = 0, arena_peak = 0;
+        //! number of times that the arena is rewound
+        size_t nr_arena_reset = 0;
+    };
+
+    virtual ~CpuMemAlloc() = default;
+
+    /*!
+     * \brief create a new allocator
+     * \param alignment alignment of returned addresses; it must be a power
+     *      of two no larger than the page size
+     */
+    static std::unique_ptr<CpuMemAlloc> make(size_t alignment);
+
+    /*!
+     * \brief the allocator used by the CPU comp nodes
+     *
+     * It is enabled by setting the MGB_CPU_MEM_ALLOC env var to size_class,
+     * and nullptr is returned if the system allocator should be used. The
+     * instance is never destructed, so it can be used during global
+     * finalization.
+     */
+    static CpuMemAlloc* inst();
+
+    //! blocks of at least this size are backed by huge pages
+    static constexpr size_t huge_page_threshold() { return 2 * 1024 * 1024; }
+
+    virtual void* alloc(size_t size) = 0;
+
+    /*!
+     * \brief allocate a short-lived buffer from the bump arena
+     */
+    virtual void* alloc_arena(size_t size) = 0;
+
+    //! release memory returned by alloc() or alloc_arena()
+    virtual void free(void* ptr) = 0;
+
+    //! release cached memory of the calling thread and the global pools
+    virtual void trim() = 0;
+
+    virtual Stats stats() = 0;
+
+    virtual size_t alignment() const = 0;
+};
+
 } // mem_alloc
 } // mgb
 
@@ -101,6 +101,17 @@ struct GraphCommonOptimizeOptions {
     bool weight_preprocess = false;
     //! fuse preprocess patten, like astype + pad_channel + dimshuffle
     bool fuse_preprocess = false;
+    //! fuse the reduce/elemwise subgraphs of softmax and layer norm to the
+    //! Softmax and LayerNorm oprs, which only take effect on CPU
+    bool fuse_normalization = false;
+    //! fuse matmul(softmax(matmul(q, k^T) * scale + mask), v) to the
+    //! Attention opr, which only takes effect on CPU
+    bool fuse_attention = false;
+    //! fuse cvt_color, resize, normalization and layout transform of uint8
+    //! images to the ImagePreprocess opr, which only takes effect on CPU;
+    //! a LINEAR resize in it rounds like the generic Resize, so the result
+    //! may differ by one uint8 step from the fixed-point x86/arm kernels
+    bool fuse_image_preprocess = false;
     enum LayoutTransform : uint32_t {
         DEFAULT,
         NCHW4,       ///< compute using NCHW4 tensor format
@@ -133,6 +144,9 @@ struct GraphCommonOptimizeOptions {
     SET(fuse_conv_bias_nonlinearity);
     SET(fuse_conv_bias_with_z);
     SET(fuse_preprocess);
+    SET(fuse_normalization);
+    SET(fuse_attention);
+    SET(fuse_image_preprocess);
     SET(weight_preprocess);
 #undef SET
 #define SET(_trans, _trans_capital)                                 \
@@ -330,6 +344,22 @@ class ComputingGraph : public std::enable_shared_from_this<ComputingGraph>,
                 //! whether to enable comp node optimization (e.g. using copy
                 //! stream for I/O operators)
                 bool enable_seq_comp_node_opt = true;
+
+                /*!
+                 * max host memory in bytes used to cache static memory
+                 * allocation plans of recently seen shapes, so switching
+                 * back to a known input shape skips the allocation solver;
+                 * least recently used plans are evicted first. 0 to disable
+                 */
+                size_t static_plan_cache_size = 0;
+
+                /*!
+                 * time budget in milliseconds to improve the static memory
+                 * allocation plan of each comp node by local search after the
+                 * heuristics; it reduces peak memory at the cost of graph
+                 * compiling time. 0 to only use the heuristic
+                 */
+                double static_mem_alloc_time_budget = 0;
             } seq_opt;
 
             //! graph optimization options
@@ -127,6 +127,8 @@ struct StaticMemAlloc {
     bool* need_realloc;
     CompNode comp_node;
     size_t alloc_size;
+    //! whether the plan is taken from the static plan cache
+    bool from_cache = false;
 
     MGB_TYPEINFO_OBJ_DECL;
 };
@@ -39,6 +39,19 @@ namespace sys {
     //! set cpu affinity for caller thread
     void set_cpu_affinity(const std::vector<int>& cpuset);
 
+    //! get cpus that the caller thread may run on; all cpus if unknown
+    std::vector<int> get_cpu_affinity();
+
+    /*!
+     * \brief relative compute capacity of each logical cpu, in (0, 1]
+     *
+     * It is read from cpu_capacity in sysfs, which the kernel provides on
+     * heterogeneous ARM parts, or else from the max frequency of cpufreq,
+     * which tells P-cores from E-cores on Intel hybrid parts. All the cpus
+     * are considered equal if neither is available.
+     */
+    std::vector<float> get_cpu_capacity();
+
     //! whether stderr supports ansi color code
     bool stderr_ansi_color();
 
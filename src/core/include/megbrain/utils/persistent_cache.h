@@ -86,6 +86,73 @@ namespace mgb {
         std::mutex m_mtx;
     };
 
+    /*!
+     * \brief persistent cache backed by an append-only file, which can be
+     *      shared by all processes on a host
+     *
+     * Every put() appends one record while holding an exclusive lock on the
+     * file, so concurrent writers never interleave. The file is read lazily
+     * on first access, and records appended by other processes are picked up
+     * when a lookup misses.
+     *
+     * Each record is tagged with a version string (default_version_tag() by
+     * default). Records with a different tag belong to other versions
+     * sharing the file: they are ignored on load and kept by compaction,
+     * which only drops the overwritten records of this version. It happens
+     * automatically once they dominate the records of this version.
+     * Compaction is disabled on windows, where the file can not be replaced
+     * while it is opened by other processes.
+     *
+     * The implementation is thread safe.
+     */
+    class FilePersistentCache final : public PersistentCache {
+        using CategoryMap = std::unordered_map<std::string, std::string>;
+
+        const std::string m_path, m_version_tag;
+        bool m_loaded = false;
+        //! identity of the file that m_read_offset refers to
+        uint64_t m_file_id = 0;
+        //! end of the last record that has been read
+        size_t m_read_offset = 0;
+        //! number of records of m_version_tag in the file, including
+        //! overwritten ones
+        size_t m_nr_record = 0;
+        //! number of live entries in m_cache
+        size_t m_nr_entry = 0;
+        std::unordered_map<std::string, CategoryMap> m_cache;
+        std::mutex m_mtx;
+
+        class LockedFile;
+
+        //! read records appended since the last read; return false if the
+        //! file is corrupted
+        bool read_new_records(LockedFile& file);
+        void ensure_loaded();
+        void compact_locked(LockedFile& file);
+
+    public:
+        /*!
+         * \param path path of the cache file; it would be created if not
+         *      exist
+         * \param version_tag version of entries visible to this cache
+         */
+        explicit FilePersistentCache(
+                std::string path,
+                std::string version_tag = default_version_tag());
+
+        Maybe<Blob> get(const std::string& category, const Blob& key) override;
+        void put(const std::string& category, const Blob& key,
+                 const Blob& value) override;
+
+        //! rewrite the file to drop the overwritten records of this
+        //! version
+        void compact();
+
+        //! version of the running binary and host: MegDNN and MegBrain
+        //! version, CPU model and supported instruction sets
+        static std::string default_version_tag();
+    };
+
     /*!
      * \brief proxy PersistentCache to be better suited for managing profiling
      *      results of operator impl algorithms
@@ -17,6 +17,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
@@ -64,20 +65,25 @@ public:
     ThreadPool(size_t nr_threads);
     //! The main thread set the task, parallelism and worker flag to
     //! notify other thread.
-    void add_task(const TaskElem& task_elem);
+    virtual void add_task(const TaskElem& task_elem);
 
-    size_t nr_threads() const;
+    virtual size_t nr_threads() const;
 
     //! Set the affinity of all the threads
-    void set_affinity(AffinityCallBack affinity_cb);
+    virtual void set_affinity(AffinityCallBack affinity_cb);
 
-    void sync();
+    virtual void sync();
     //! wake up all the threads from cv.wait(), when the thread pool is not
     //! active, all the threads will go to sleep.
-    void active();
+    virtual void active();
     //! all the threads go to sleep which will reduce CPU occupation
-    void deactive();
-    ~ThreadPool();
+    virtual void deactive();
+    virtual ~ThreadPool();
+
+protected:
+    //! used by subclasses which manage their own worker threads
+    struct NoWorkerTag {};
+    ThreadPool(size_t nr_threads, NoWorkerTag);
 
 private:
     const size_t m_nr_threads = 0;
@@ -100,6 +106,144 @@ private:
     std::mutex m_mutex;
     std::mutex m_mutex_task;
 };
+
+/**
+ * \brief a ThreadPool that distributes sub-tasks through per-thread deques
+ *
+ * Each thread (the nr_threads - 1 workers plus the calling thread) owns a
+ * deque of index ranges. A range is split lazily by its owner, and idle
+ * threads steal the oldest range of other threads, preferring threads on the
+ * same NUMA node. Compared with ThreadPool there is no single atomic counter
+ * shared by all the threads.
+ *
+ * The sub-tasks of a task are initially split into contiguous blocks
+ * proportional to the weights of the threads, which are all equal unless
+ * set by a subclass.
+ *
+ * Idle workers spin for an adaptively chosen number of rounds before they
+ * park on a condition variable, so short gaps between kernels do not cost a
+ * wake-up while long idle periods do not burn CPU.
+ *
+ * add_task() may be called from inside a running task, which starts a nested
+ * parallel region; the caller helps to execute the nested region and only
+ * runs sub-tasks of that region while waiting, so the thread id passed to the
+ * task is never used by two unfinished sub-tasks at the same time.
+ */
+class WorkStealingThreadPool : public ThreadPool {
+public:
+    //! \param numa_aware whether to bind workers to NUMA nodes when the
+    //!     host has more than one node
+    WorkStealingThreadPool(size_t nr_threads, bool numa_aware = true);
+    ~WorkStealingThreadPool();
+
+    void add_task(const TaskElem& task_elem) override;
+    size_t nr_threads() const override { return m_nr_threads; }
+    void set_affinity(AffinityCallBack affinity_cb) override;
+    void sync() override;
+    void active() override;
+    void deactive() override;
+
+    //! NUMA node of each thread; the last one is the calling thread
+    const std::vector<int>& thread_numa_nodes() const {
+        return m_numa_node;
+    }
+
+    //! weight of each thread; the last one is the calling thread
+    std::vector<float> thread_weights() const;
+
+    /*!
+     * \brief split [0, parallelism) into contiguous blocks proportional to
+     *      \p weights, as done for the sub-tasks of a task
+     * \return the end of each block
+     */
+    static std::vector<size_t> split_by_weights(
+            size_t parallelism, const std::vector<float>& weights);
+
+protected:
+    //! placement of the threads on the cpus
+    struct Placement {
+        //! NUMA node of each thread, or empty for a single node
+        std::vector<int> numa_node;
+        //! cpus each worker binds itself to when it starts, or empty for
+        //! no binding; the calling thread is never bound
+        std::vector<std::vector<int>> cpus;
+        //! initial weight of each thread, or empty for equal weights
+        std::vector<float> weights;
+        //! capacity of each cpu, by which a thread bound by set_affinity()
+        //! is reweighted; empty to keep the weights
+        std::vector<float> cpu_capacity;
+    };
+
+    WorkStealingThreadPool(size_t nr_threads, Placement placement);
+
+    //! bind the workers to NUMA nodes if the host has more than one node
+    static Placement numa_placement(size_t nr_threads, bool numa_aware);
+
+private:
+    struct Region;
+    struct Range;
+    struct Slot;
+
+    const size_t m_nr_threads;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    //! victims of each slot for stealing, same NUMA node first
+    std::vector<std::vector<size_t>> m_steal_order;
+    std::vector<int> m_numa_node;
+    std::vector<std::vector<int>> m_thread_cpus;
+    std::vector<float> m_cpu_capacity;
+    std::vector<std::thread> m_threads;
+
+    AffinityCallBack m_core_binding_function{nullptr};
+    bool m_main_affinity_flag = false;
+
+    //! number of ranges in all the deques
+    std::atomic_size_t m_nr_queued{0};
+    std::atomic_size_t m_nr_parked{0};
+    std::atomic_bool m_stop{false};
+    std::atomic_bool m_active{false};
+    std::condition_variable m_cv;
+    std::mutex m_mutex;
+    //! serialize the top-level regions submitted from outside the pool
+    std::mutex m_mutex_task;
+
+    void worker_loop(size_t slot_id);
+    //! run the affinity callback for the caller thread of the slot
+    void apply_affinity(size_t slot_id);
+    void push_range(size_t slot_id, const Range& range);
+    bool pop_range(size_t slot_id, const Region* region, Range& range);
+    bool steal_range(size_t slot_id, const Region* region, Range& range);
+    //! run a range, splitting it lazily so that others may steal it
+    void run_range(size_t slot_id, Range range);
+    //! execute sub-tasks of the region until it finishes
+    void help_until_done(size_t slot_id, Region& region);
+    void wake_workers();
+};
+
+/**
+ * \brief a WorkStealingThreadPool for CPUs whose cores differ in speed, such
+ * as ARM big.LITTLE and Intel hybrid (P-core/E-core) parts
+ *
+ * Every thread is weighted by the capacity of its core (see
+ * sys::get_cpu_capacity()), so a slow core initially gets a smaller block of
+ * the sub-tasks than a fast one, and stealing evens out the rest. When the
+ * cores differ, the workers are bound to the fastest cores except the very
+ * fastest one, which is left to the calling thread; the affinity of the
+ * calling thread itself is not changed. Otherwise the pool is placed like a
+ * WorkStealingThreadPool.
+ *
+ * set_affinity() overrides the default binding, and the weights are then
+ * taken from the cpus the callback binds each thread to.
+ */
+class HybridThreadPool final : public WorkStealingThreadPool {
+public:
+    //! \param capacity relative capacity of each cpu; it is read from the
+    //!     system if empty
+    HybridThreadPool(size_t nr_threads, std::vector<float> capacity = {});
+
+private:
+    static Placement hybrid_placement(size_t nr_threads,
+                                      std::vector<float> capacity);
+};
 #else
 /**
  * \brief ThreadPool execute the task in single thread mode
@@ -116,6 +260,19 @@ public:
     size_t nr_threads() const { return 1_z; }
 };
 
+//! without thread support all the tasks run in the caller thread
+class WorkStealingThreadPool final : public ThreadPool {
+public:
+    WorkStealingThreadPool(size_t nr_threads, bool = true)
+            : ThreadPool(nr_threads) {}
+};
+
+class HybridThreadPool final : public ThreadPool {
+public:
+    HybridThreadPool(size_t nr_threads, std::vector<float> = {})
+            : ThreadPool(nr_threads) {}
+};
+
 #endif
 }  // namespace mgb
    // vim: syntax=cpp.doxygen
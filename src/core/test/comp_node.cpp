@@ -313,6 +313,17 @@ TEST(TestCompNodeCuda, Uid) {
     ASSERT_NE(cn00.get_uid(), cn1.get_uid());
 }
 
+TEST(TestCompNodeCPU, Uid) {
+    auto cn00 = CompNode::load("cpu0"),
+         cn1 = CompNode::load("cpu1"),
+         cn01 = CompNode::load("cpu0:0"),
+         cn02 = CompNode::load("cpu0:2");
+    ASSERT_EQ(cn00, CompNode::load("cpu0"));
+    ASSERT_EQ(cn00.get_uid(), cn01.get_uid());
+    ASSERT_NE(cn00.get_uid(), cn02.get_uid());
+    ASSERT_NE(cn00.get_uid(), cn1.get_uid());
+}
+
 TEST(TestCompNodeCuda, set_prealloc_config) {
     CompNode::set_prealloc_config(
         1024, 1024, 256 * 1024 * 1024,
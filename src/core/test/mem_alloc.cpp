@@ -13,14 +13,18 @@
 
 #include "megbrain/comp_node/alloc.h"
 #include "megbrain/comp_node_env.h"
+#include "megbrain/opr/basic_arith_wrapper.h"
+#include "megbrain/opr/blas.h"
 #include "megbrain/opr/io.h"
 #include "megbrain/opr/utility.h"
 #include "megbrain/test/helper.h"
+#include "megbrain/utils/timer.h"
 
 #include <thread>
 #include <map>
 #include <random>
 #include <atomic>
+#include <cstring>
 
 using namespace mgb;
 using namespace mem_alloc;
@@ -543,6 +547,339 @@ TEST(TestSimpleCachingAlloc, Basic) {
     EXPECT_EQ(0u, raw_alloc->nr_free());
 };
 
+TEST(TestCpuMemAlloc, Basic) {
+    auto alloc = CpuMemAlloc::make(64);
+    auto ptr = alloc->alloc(100);
+    ASSERT_EQ(0u, reinterpret_cast<size_t>(ptr) % 64);
+    memset(ptr, 1, 100);
+    auto stats = alloc->stats();
+    EXPECT_EQ(1u, stats.nr_alloc);
+    EXPECT_EQ(1u, stats.nr_sys_alloc);
+    EXPECT_EQ(112u, stats.used);
+
+    alloc->free(ptr);
+    EXPECT_EQ(0u, alloc->get_used_memory());
+    EXPECT_EQ(112u, alloc->get_free_memory().tot);
+
+    // sizes of the same class share the cached block
+    ASSERT_EQ(ptr, alloc->alloc(112));
+    stats = alloc->stats();
+    EXPECT_EQ(1u, stats.nr_thread_cache_hit);
+    EXPECT_EQ(1u, stats.nr_sys_alloc);
+    EXPECT_EQ(0u, stats.cached);
+
+    auto ptr1 = alloc->alloc(113);
+    EXPECT_NE(ptr, ptr1);
+    EXPECT_EQ(2u, alloc->stats().nr_sys_alloc);
+    alloc->free(ptr);
+    alloc->free(ptr1);
+    EXPECT_EQ(2u, alloc->get_free_memory().nr_blk);
+
+    alloc->trim();
+    EXPECT_EQ(0u, alloc->get_free_memory().tot);
+    EXPECT_EQ(0u, alloc->stats().reserved);
+}
+
+TEST(TestCpuMemAlloc, Large) {
+    constexpr size_t MB = 1024 * 1024;
+    auto alloc = CpuMemAlloc::make(64);
+    auto ptr = static_cast<uint8_t*>(alloc->alloc(3 * MB));
+    ptr[0] = ptr[3 * MB - 1] = 1;
+#ifdef __linux__
+    EXPECT_EQ(4 * MB, alloc->stats().huge_page);
+    ASSERT_EQ(0u, reinterpret_cast<size_t>(ptr) % (2 * MB));
+    // the header does not take another huge page
+    auto ptr2 = static_cast<uint8_t*>(alloc->alloc(4 * MB));
+    ptr2[0] = ptr2[4 * MB - 1] = 1;
+    EXPECT_EQ(8 * MB, alloc->stats().huge_page);
+    alloc->free(ptr2);
+    alloc->trim();
+#endif
+
+    // larger than the max size class; returned to the system on free
+    auto ptr1 = static_cast<uint8_t*>(alloc->alloc(100 * MB));
+    ptr1[0] = ptr1[100 * MB - 1] = 1;
+    auto reserved = alloc->stats().reserved;
+    alloc->free(ptr1);
+    EXPECT_LE(alloc->stats().reserved, reserved - 100 * MB);
+
+    alloc->free(ptr);
+    EXPECT_EQ(3u * MB, alloc->get_free_memory().tot);
+    EXPECT_EQ(ptr, alloc->alloc(3 * MB - 1));
+    alloc->free(ptr);
+    alloc->trim();
+    auto stats = alloc->stats();
+    EXPECT_EQ(0u, stats.reserved);
+    EXPECT_EQ(0u, stats.huge_page);
+    EXPECT_EQ(stats.nr_alloc, stats.nr_free);
+}
+
+TEST(TestCpuMemAlloc, Arena) {
+    constexpr size_t MB = 1024 * 1024;
+    auto alloc = CpuMemAlloc::make(64);
+    auto run_seq = [&](size_t nr, size_t size) {
+        std::vector<void*> ptrs;
+        for (size_t i = 0; i < nr; ++i) {
+            auto ptr = alloc->alloc_arena(size);
+            EXPECT_EQ(0u, reinterpret_cast<size_t>(ptr) % 64);
+            memset(ptr, i, size);
+            ptrs.push_back(ptr);
+        }
+        for (size_t i = 0; i < nr; ++i) {
+            auto p = static_cast<uint8_t*>(ptrs[i]);
+            EXPECT_EQ(static_cast<uint8_t>(i), p[0]);
+            EXPECT_EQ(static_cast<uint8_t>(i), p[size - 1]);
+        }
+        for (auto i : ptrs) {
+            alloc->free(i);
+        }
+        return ptrs;
+    };
+
+    auto ptrs0 = run_seq(3, 1000);
+    EXPECT_EQ(1u, alloc->stats().nr_arena_reset);
+    // the arena is rewound at the end of the sequence
+    EXPECT_EQ(ptrs0, run_seq(3, 1000));
+
+    // grows beyond a chunk, and a single chunk is kept after the sequence
+    run_seq(8, MB / 2);
+    auto stats = alloc->stats();
+    EXPECT_EQ(3u, stats.nr_arena_reset);
+    EXPECT_EQ(0u, stats.arena_reserved);
+    EXPECT_GE(stats.arena_peak, 4 * MB);
+    run_seq(8, MB / 2);
+    stats = alloc->stats();
+    EXPECT_GE(stats.arena_reserved, 4 * MB);
+    EXPECT_LT(stats.arena_reserved, 5 * MB);
+    EXPECT_EQ(stats.nr_alloc, stats.nr_free);
+
+    // a long-lived buffer only pins its own chunk, so the arena does not
+    // grow over sequences
+    auto pinned = alloc->alloc_arena(1000);
+    run_seq(3, 2 * MB);
+    auto reserved = alloc->stats().arena_reserved;
+    for (int i = 0; i < 4; ++i) {
+        run_seq(3, 2 * MB);
+        EXPECT_EQ(reserved, alloc->stats().arena_reserved);
+    }
+    alloc->free(pinned);
+    stats = alloc->stats();
+    EXPECT_LT(stats.arena_reserved, reserved);
+    EXPECT_EQ(stats.nr_alloc, stats.nr_free);
+    alloc->trim();
+    EXPECT_EQ(0u, alloc->stats().reserved);
+}
+
+TEST(TestCpuMemAlloc, ThreadExit) {
+    auto alloc = CpuMemAlloc::make(64);
+    std::thread worker{[&]() {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 16; ++i) {
+            ptrs.push_back(alloc->alloc(1000));
+        }
+        for (auto i : ptrs) {
+            alloc->free(i);
+        }
+    }};
+    worker.join();
+
+    // the cache of the exited thread is moved to the pool
+    auto stats = alloc->stats();
+    EXPECT_EQ(16u, stats.nr_alloc);
+    EXPECT_EQ(16u, stats.nr_free);
+    EXPECT_EQ(16u * 1024, stats.cached);
+    auto ptr = alloc->alloc(1000);
+    EXPECT_EQ(1u, alloc->stats().nr_pool_hit);
+    alloc->free(ptr);
+    alloc->trim();
+    stats = alloc->stats();
+    EXPECT_EQ(0u, stats.cached);
+    EXPECT_EQ(0u, stats.reserved);
+}
+
+TEST(TestCpuMemAlloc, MultiThread) {
+    // blocks are allocated on the producers and freed on the consumers, as
+    // the CPU comp nodes release memory on their workers
+    constexpr size_t NR_THREAD = 4, NR_BLK = 5000;
+    auto alloc = CpuMemAlloc::make(64);
+    std::mutex mtx;
+    std::vector<std::pair<uint8_t*, size_t>> queue;
+    std::atomic_size_t nr_produced{0};
+    auto producer = [&](size_t seed) {
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < NR_BLK; ++i) {
+            size_t size = rng() % 3 ? rng() % 4096 + 1 : rng() % (1 << 21) + 1;
+            auto ptr = static_cast<uint8_t*>(alloc->alloc(size));
+            ptr[0] = ptr[size - 1] = size & 0xFF;
+            MGB_LOCK_GUARD(mtx);
+            queue.emplace_back(ptr, size);
+        }
+        nr_produced += NR_BLK;
+    };
+    auto consumer = [&]() {
+        for (;;) {
+            std::pair<uint8_t*, size_t> blk{nullptr, 0};
+            {
+                MGB_LOCK_GUARD(mtx);
+                if (!queue.empty()) {
+                    blk = queue.back();
+                    queue.pop_back();
+                }
+            }
+            if (!blk.first) {
+                if (nr_produced == NR_THREAD * NR_BLK) {
+                    MGB_LOCK_GUARD(mtx);
+                    if (queue.empty()) {
+                        return;
+                    }
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            auto expect = static_cast<uint8_t>(blk.second & 0xFF);
+            ASSERT_EQ(expect, blk.first[0]);
+            ASSERT_EQ(expect, blk.first[blk.second - 1]);
+            alloc->free(blk.first);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < NR_THREAD; ++i) {
+        workers.emplace_back(producer, i);
+        workers.emplace_back(consumer);
+    }
+    for (auto&& i : workers) {
+        i.join();
+    }
+    auto stats = alloc->stats();
+    EXPECT_EQ(NR_THREAD * NR_BLK, stats.nr_alloc);
+    EXPECT_EQ(NR_THREAD * NR_BLK, stats.nr_free);
+    EXPECT_EQ(0u, stats.used);
+    EXPECT_GT(stats.nr_pool_hit, 0u);
+    alloc->print_memory_state();
+}
+
+namespace {
+//! alloc (size > 0) and free (size == 0) events of dynamic memory
+struct AllocEvent {
+    size_t id, size;
+};
+
+//! record the dynamic allocations of a graph
+class AllocTraceRecorder final : public cg::DeviceMemoryAllocator {
+    std::mutex m_mtx;
+    size_t m_next_id = 0;
+    std::vector<AllocEvent> m_trace;
+
+public:
+    void alloc_dynamic(VarNode*, DeviceTensorStorage& dest,
+                       size_t size) override {
+        auto cn = dest.comp_node();
+        auto ptr = static_cast<dt_byte*>(cn.alloc_device(size));
+        MGB_LOCK_GUARD(m_mtx);
+        size_t id = m_next_id++;
+        m_trace.push_back({id, size});
+        auto del = [this, cn, id](dt_byte* ptr) {
+            cn.free_device(ptr);
+            MGB_LOCK_GUARD(m_mtx);
+            m_trace.push_back({id, 0});
+        };
+        dest.reset(cn, size, {ptr, del});
+    }
+
+    std::vector<AllocEvent> trace() {
+        MGB_LOCK_GUARD(m_mtx);
+        return m_trace;
+    }
+};
+
+//! run an MLP with dynamic batch sizes and record its allocations
+std::vector<AllocEvent> record_mlp_alloc_trace() {
+    constexpr size_t NR_LAYER = 6, HIDDEN = 256;
+    HostTensorGenerator<> gen;
+    auto recorder = std::make_shared<AllocTraceRecorder>();
+    auto graph = ComputingGraph::make();
+    graph->set_device_memory_allocator(recorder);
+    auto host_x = gen({1, HIDDEN});
+    auto y = opr::MarkDynamicVar::make(
+            opr::Host2DeviceCopy::make(*graph, host_x));
+    for (size_t i = 0; i < NR_LAYER; ++i) {
+        auto w = opr::SharedDeviceTensor::make(*graph, *gen({HIDDEN, HIDDEN})),
+             b = opr::SharedDeviceTensor::make(*graph, *gen({1, HIDDEN}));
+        y = opr::relu(opr::MatrixMul::make(y, w) + b);
+    }
+    y = opr::reduce_sum(y, y.make_scalar(1));
+    HostTensorND host_y;
+    auto func = graph->compile({make_callback_copy(y, host_y)});
+    for (size_t batch : {1, 16, 64, 7, 128, 33, 256, 2}) {
+        *host_x = *gen({batch, HIDDEN});
+        func->execute().wait();
+    }
+    return recorder->trace();
+}
+}  // anonymous namespace
+
+TEST(TestCpuMemAlloc, BenchmarkTrace) {
+    auto trace = record_mlp_alloc_trace();
+    size_t nr_id = 0;
+    for (auto&& i : trace) {
+        nr_id = std::max(nr_id, i.id + 1);
+    }
+    ASSERT_GT(nr_id, 0u);
+    constexpr size_t RUNS = 200;
+
+    using AllocFn = std::function<void*(size_t)>;
+    using FreeFn = std::function<void(void*)>;
+    auto replay = [&](size_t nr_thread, const AllocFn& alloc,
+                      const FreeFn& free) {
+        auto worker = [&]() {
+            std::vector<void*> ptrs(nr_id, nullptr);
+            for (size_t run = 0; run < RUNS; ++run) {
+                for (auto&& i : trace) {
+                    if (i.size) {
+                        ptrs[i.id] = alloc(i.size);
+                        static_cast<uint8_t*>(ptrs[i.id])[0] = 1;
+                    } else {
+                        free(ptrs[i.id]);
+                        ptrs[i.id] = nullptr;
+                    }
+                }
+            }
+            for (auto i : ptrs) {
+                if (i) {
+                    free(i);
+                }
+            }
+        };
+        RealTimer timer;
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < nr_thread; ++i) {
+            workers.emplace_back(worker);
+        }
+        for (auto&& i : workers) {
+            i.join();
+        }
+        return timer.get_msecs() * 1e3 / (RUNS * trace.size());
+    };
+
+    auto cpu_alloc = CpuMemAlloc::make(64);
+    AllocFn sys_alloc = [](size_t size) {
+        void* ptr = nullptr;
+        mgb_assert(!posix_memalign(&ptr, 64, size));
+        return ptr;
+    };
+    FreeFn sys_free = [](void* ptr) { ::free(ptr); };
+    AllocFn cls_alloc = [&](size_t size) { return cpu_alloc->alloc(size); };
+    FreeFn cls_free = [&](void* ptr) { cpu_alloc->free(ptr); };
+    for (size_t nr_thread : {1, 4}) {
+        auto t0 = replay(nr_thread, sys_alloc, sys_free),
+             t1 = replay(nr_thread, cls_alloc, cls_free);
+        mgb_log("trace: events=%zu threads=%zu: system %.3fus size_class "
+                "%.3fus speedup=%.2f",
+                trace.size(), nr_thread, t0, t1, t0 / t1);
+    }
+    cpu_alloc->print_memory_state();
+}
+
 namespace {
 class DevicePolicy {
 public:
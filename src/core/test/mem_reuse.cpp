@@ -345,4 +345,87 @@ TEST(TestMemReuse, FwdNoSysMemAlloc) {
     }
 }
 
+TEST(TestMemReuse, StaticPlanCache) {
+    HostTensorGenerator<> gen;
+    auto host_x = gen({2, 3});
+    size_t nr_miss, nr_hit;
+    auto run = [&](size_t cache_size) {
+        auto graph = ComputingGraph::make();
+        graph->options().seq_opt.static_plan_cache_size = cache_size;
+        nr_miss = nr_hit = 0;
+        auto hdl = graph->event().register_receiver<cg::event::StaticMemAlloc>(
+                [&](const cg::event::StaticMemAlloc& s) {
+                    if (s.comp_node.valid()) {
+                        ++(s.from_cache ? nr_hit : nr_miss);
+                    }
+                });
+        auto x = opr::Host2DeviceCopy::make(*graph, host_x),
+             y = (x + 1) * 2, z = y * y + x;
+        HostTensorND host_z;
+        auto func = graph->compile({make_callback_copy(z, host_z)});
+        TensorShape shapes[] = {{2, 3}, {5, 7}, {2, 3}, {8, 1},
+                                {5, 7}, {2, 3}, {5, 7}};
+        for (auto&& shp : shapes) {
+            *host_x = *gen(shp);
+            func->execute();
+            auto px = host_x->ptr<float>(), pz = host_z.ptr<float>();
+            for (size_t i = 0; i < shp.total_nr_elems(); ++i) {
+                float y = (px[i] + 1) * 2;
+                MGB_ASSERT_FLOAT_EQ(y * y + px[i], pz[i]);
+            }
+        }
+    };
+    // three buckets: each shape is planned once
+    run(1 << 20);
+    ASSERT_EQ(3u, nr_miss);
+    ASSERT_EQ(4u, nr_hit);
+    // too small to hold a plan
+    for (size_t cache_size : {0, 1}) {
+        run(cache_size);
+        ASSERT_EQ(7u, nr_miss);
+        ASSERT_EQ(0u, nr_hit);
+    }
+}
+
+TEST(TestMemReuse, StaticPlanCacheAllocatorSettings) {
+    HostTensorGenerator<> gen;
+    auto host_x = gen({2, 3});
+    auto graph = ComputingGraph::make();
+    graph->options().seq_opt.static_plan_cache_size = 1 << 20;
+    size_t nr_miss = 0, nr_hit = 0;
+    auto hdl = graph->event().register_receiver<cg::event::StaticMemAlloc>(
+            [&](const cg::event::StaticMemAlloc& s) {
+                if (s.comp_node.valid()) {
+                    ++(s.from_cache ? nr_hit : nr_miss);
+                }
+            });
+    auto x = opr::Host2DeviceCopy::make(*graph, host_x),
+         y = (x + 1) * 2, z = y * y + x;
+    HostTensorND host_z;
+    auto func = graph->compile({make_callback_copy(z, host_z)});
+    auto run = [&](const TensorShape& shp) {
+        *host_x = *gen(shp);
+        func->execute();
+        auto px = host_x->ptr<float>(), pz = host_z.ptr<float>();
+        for (size_t i = 0; i < shp.total_nr_elems(); ++i) {
+            float y = (px[i] + 1) * 2;
+            MGB_ASSERT_FLOAT_EQ(y * y + px[i], pz[i]);
+        }
+    };
+    run({2, 3});
+    run({5, 7});
+    ASSERT_EQ(2u, nr_miss);
+    // plans of the heuristic allocator are not used for local search, nor
+    // for another time budget
+    for (double budget : {1., 2.}) {
+        graph->options().seq_opt.static_mem_alloc_time_budget = budget;
+        nr_miss = nr_hit = 0;
+        run({2, 3});
+        run({5, 7});
+        run({2, 3});
+        ASSERT_EQ(2u, nr_miss);
+        ASSERT_EQ(1u, nr_hit);
+    }
+}
+
 // vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -26,7 +26,8 @@ using namespace cg;
 #define ITER_ALGO(cb) \
     cb(INTERVAL_MOVE) \
     cb(BEST_FIT) \
-    cb(PUSHDOWN)
+    cb(PUSHDOWN) \
+    cb(LOCAL_SEARCH)
 
 namespace {
 
@@ -243,6 +244,51 @@ TEST(TestStaticMemAllocAlgo, PushdownChain) {
     ASSERT_EQ(NR + NR - 1, allocator->tot_alloc());
 }
 
+TEST(TestStaticMemAllocAlgo, LocalSearchNotWorse) {
+    using Algo = StaticMemAlloc::AllocatorAlgo;
+    std::mt19937_64 rng(next_rand_seed());
+    constexpr size_t NR = 200;
+
+    // begin, end, size, overwrite dest (or NR), offset
+    std::vector<std::tuple<size_t, size_t, size_t, size_t, size_t>> reqs;
+    for (size_t i = 0; i < NR; ++ i) {
+        if (i && rng() % 5 == 0) {
+            // overwrite the previous interval at its last step
+            size_t end = std::get<1>(reqs[i - 1]),
+                   size = std::get<2>(reqs[i - 1]),
+                   offset = rng() % size;
+            reqs.emplace_back(end - 1, end + rng() % 20, size - offset, i - 1,
+                              offset);
+        } else {
+            size_t begin = rng() % NR;
+            reqs.emplace_back(begin, begin + 1 + rng() % 20,
+                              1 + rng() % 4096, NR, 0);
+        }
+    }
+    auto run = [&](Algo algo) {
+        auto allocator = StaticMemAlloc::make(algo);
+        allocator->alignment(64).time_budget(1000);
+        for (size_t i = 0; i < NR; ++ i) {
+            auto &&r = reqs[i];
+            allocator->add(std::get<0>(r), std::get<1>(r), std::get<2>(r),
+                           makeuk(i));
+            if (std::get<3>(r) != NR) {
+                allocator->add_overwrite_spec(i, std::get<3>(r),
+                                              std::get<4>(r));
+            }
+        }
+        allocator->solve();
+        return allocator;
+    };
+
+    auto ls = run(Algo::LOCAL_SEARCH);
+    ASSERT_GE(ls->tot_alloc(), ls->tot_alloc_lower_bound());
+    ASSERT_LE(ls->tot_alloc(), ls->tot_alloc_heuristic());
+    for (auto algo: {Algo::PUSHDOWN, Algo::BEST_FIT, Algo::INTERVAL_MOVE}) {
+        ASSERT_LE(ls->tot_alloc(), run(algo)->tot_alloc());
+    }
+}
+
 #endif // WIN32
 
 // vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -0,0 +1,161 @@
+/**
+ * \file src/core/test/utils/file_persistent_cache.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "megbrain/utils/persistent_cache.h"
+#include "megbrain/test/helper.h"
+
+#include <cstdio>
+#include <thread>
+
+using namespace mgb;
+
+namespace {
+PersistentCache::Blob make_blob(const std::string& s) {
+    return {s.data(), s.size()};
+}
+
+std::string get_str(PersistentCache& cache, const std::string& category,
+                    const std::string& key) {
+    auto ret = cache.get(category, make_blob(key));
+    if (!ret.valid())
+        return "<none>";
+    return {static_cast<const char*>(ret->ptr), ret->size};
+}
+}  // anonymous namespace
+
+TEST(TestFilePersistentCache, PutGet) {
+    auto fname = output_file("TestFilePersistentCache.PutGet");
+    remove(fname.c_str());
+    {
+        FilePersistentCache cache{fname, "v1"};
+        cache.put("c0", make_blob("k0"), make_blob("a"));
+        cache.put("c0", make_blob("k1"), make_blob("b"));
+        cache.put("c1", make_blob("k0"), make_blob("c"));
+        cache.put("c0", make_blob("k0"), make_blob("d"));
+        ASSERT_EQ("d", get_str(cache, "c0", "k0"));
+    }
+    FilePersistentCache cache{fname, "v1"};
+    ASSERT_EQ("d", get_str(cache, "c0", "k0"));
+    ASSERT_EQ("b", get_str(cache, "c0", "k1"));
+    ASSERT_EQ("c", get_str(cache, "c1", "k0"));
+    ASSERT_EQ("<none>", get_str(cache, "c1", "k1"));
+}
+
+TEST(TestFilePersistentCache, SharedFile) {
+    auto fname = output_file("TestFilePersistentCache.SharedFile");
+    remove(fname.c_str());
+    FilePersistentCache cache0{fname, "v1"}, cache1{fname, "v1"};
+    ASSERT_EQ("<none>", get_str(cache1, "c", "k"));
+    cache0.put("c", make_blob("k"), make_blob("v"));
+    // a miss picks up records appended by other writers
+    ASSERT_EQ("v", get_str(cache1, "c", "k"));
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i) {
+        workers.emplace_back([&fname, i]() {
+            FilePersistentCache cache{fname, "v1"};
+            for (int j = 0; j < 100; ++j) {
+                auto key = ssprintf("%d:%d", i, j);
+                cache.put("c", make_blob(key), make_blob(key));
+            }
+        });
+    }
+    for (auto&& i : workers)
+        i.join();
+    FilePersistentCache cache{fname, "v1"};
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 100; ++j) {
+            auto key = ssprintf("%d:%d", i, j);
+            ASSERT_EQ(key, get_str(cache, "c", key));
+        }
+    }
+}
+
+TEST(TestFilePersistentCache, Version) {
+    auto fname = output_file("TestFilePersistentCache.Version");
+    remove(fname.c_str());
+    {
+        FilePersistentCache cache{fname, "v1"};
+        cache.put("c", make_blob("k"), make_blob("old"));
+    }
+    {
+        FilePersistentCache cache{fname, "v2"};
+        ASSERT_EQ("<none>", get_str(cache, "c", "k"));
+        cache.put("c", make_blob("k"), make_blob("new"));
+        cache.compact();
+    }
+    // compaction keeps the records of other versions
+    FilePersistentCache cache_v1{fname, "v1"}, cache_v2{fname, "v2"};
+    ASSERT_EQ("old", get_str(cache_v1, "c", "k"));
+    ASSERT_EQ("new", get_str(cache_v2, "c", "k"));
+    ASSERT_FALSE(FilePersistentCache::default_version_tag().empty());
+}
+
+TEST(TestFilePersistentCache, CompactOtherVersion) {
+    auto fname = output_file("TestFilePersistentCache.CompactOtherVersion");
+    remove(fname.c_str());
+    {
+        FilePersistentCache cache{fname, "v1"};
+        for (int i = 0; i < 10; ++i) {
+            cache.put("c", make_blob("k0"), make_blob(ssprintf("%d", i)));
+        }
+    }
+    size_t size_v1;
+    {
+        FilePersistentCache cache{fname, "v2"};
+        // enough overwritten records to trigger an automatic compaction
+        for (int i = 0; i < 600; ++i) {
+            cache.put("c", make_blob("k"), make_blob(ssprintf("%d", i)));
+        }
+        cache.compact();
+        FILE* fp = fopen(fname.c_str(), "rb");
+        ASSERT_TRUE(fp);
+        fseek(fp, 0, SEEK_END);
+        size_v1 = ftell(fp);
+        fclose(fp);
+    }
+    FilePersistentCache cache_v1{fname, "v1"}, cache_v2{fname, "v2"};
+    ASSERT_EQ("9", get_str(cache_v1, "c", "k0"));
+    ASSERT_EQ("599", get_str(cache_v2, "c", "k"));
+#ifndef WIN32
+    // the 600 records of v2 are compacted into one; the 10 records of v1
+    // are kept
+    ASSERT_LT(size_v1, 1024u);
+#else
+    MGB_MARK_USED_VAR(size_v1);
+#endif
+}
+
+TEST(TestFilePersistentCache, Corrupted) {
+    auto fname = output_file("TestFilePersistentCache.Corrupted");
+    remove(fname.c_str());
+    {
+        FilePersistentCache cache{fname, "v1"};
+        cache.put("c", make_blob("k0"), make_blob("v0"));
+    }
+    {
+        // a truncated record, e.g. left by a crashed writer
+        FILE* fp = fopen(fname.c_str(), "ab");
+        ASSERT_TRUE(fp);
+        fwrite("\x46\x50\x43\x52\xff", 1, 5, fp);
+        fclose(fp);
+    }
+    {
+        FilePersistentCache cache{fname, "v1"};
+        ASSERT_EQ("v0", get_str(cache, "c", "k0"));
+        cache.put("c", make_blob("k1"), make_blob("v1"));
+    }
+    FilePersistentCache cache{fname, "v1"};
+    ASSERT_EQ("v0", get_str(cache, "c", "k0"));
+    ASSERT_EQ("v1", get_str(cache, "c", "k1"));
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -14,8 +14,11 @@
 #include "megbrain/test/helper.h"
 #include "megbrain/opr/io.h"
 #include "megbrain/opr/utility.h"
+#include "megbrain/utils/timer.h"
 #include <atomic>
+#include <chrono>
 #include <random>
+#include <thread>
 
 #if MGB_HAVE_THREAD
 using namespace mgb;
@@ -62,6 +65,197 @@ TEST(TestThreadPool, BASIC) {
     }
 }
 
+TEST(TestThreadPool, WorkStealingBasic) {
+    for (size_t nr_threads : {1_z, 2_z, 4_z}) {
+        WorkStealingThreadPool thread_pool{nr_threads};
+        ASSERT_EQ(thread_pool.nr_threads(), nr_threads);
+        for (size_t total_task : {1_z, 3_z, 50_z, 1000_z}) {
+            std::vector<std::atomic_size_t> visited(total_task);
+            for (auto&& i : visited) {
+                i = 0;
+            }
+            std::atomic_bool tid_ok{true};
+            auto func = [&](size_t index, size_t thread_id) {
+                ++visited[index];
+                if (thread_id >= nr_threads) {
+                    tid_ok = false;
+                }
+            };
+            thread_pool.active();
+            thread_pool.add_task({func, total_task});
+            thread_pool.deactive();
+            ASSERT_TRUE(tid_ok);
+            for (size_t i = 0; i < total_task; i++) {
+                ASSERT_EQ(visited[i], 1u);
+            }
+        }
+    }
+}
+
+TEST(TestThreadPool, WorkStealingNested) {
+    constexpr size_t NR_THREADS = 4, NR_OUTER = 13, NR_INNER = 37;
+    WorkStealingThreadPool thread_pool{NR_THREADS};
+    //! the thread id must not be shared by unfinished sub-tasks
+    std::vector<std::atomic_int> busy(NR_THREADS);
+    for (auto&& i : busy) {
+        i = 0;
+    }
+    std::atomic_size_t count{0};
+    std::atomic_bool tid_ok{true};
+    auto enter = [&](size_t thread_id) {
+        if (thread_id >= NR_THREADS || busy[thread_id]++) {
+            tid_ok = false;
+        }
+    };
+    auto inner = [&](size_t, size_t thread_id) {
+        enter(thread_id);
+        ++count;
+        --busy[thread_id];
+    };
+    auto outer = [&](size_t, size_t thread_id) {
+        enter(thread_id);
+        --busy[thread_id];
+        thread_pool.add_task({inner, NR_INNER});
+    };
+    thread_pool.active();
+    thread_pool.add_task({outer, NR_OUTER});
+    thread_pool.deactive();
+    ASSERT_TRUE(tid_ok);
+    ASSERT_EQ(count, NR_OUTER * NR_INNER);
+}
+
+TEST(TestThreadPool, WorkStealingCompNode) {
+    auto old = CompNode::enable_work_stealing_for_cpu(true);
+    auto cn = CompNode::load("multithread:4:0");
+    CompNode::enable_work_stealing_for_cpu(old);
+    HostTensorGenerator<> gen;
+    auto host_x = gen({1024}, cn);
+    HostTensorND host_y, y_expect;
+    y_expect.copy_from(*host_x);
+    {
+        auto py = y_expect.ptr<float>();
+        for (int i = 0; i < 1024; ++i) {
+            py[i] = py[i] * 2 + 3;
+        }
+    }
+    auto graph = ComputingGraph::make();
+    auto x = opr::Host2DeviceCopy::make(*graph, host_x), y = x * 2 + 3;
+    auto func = graph->compile({make_callback_copy(y, host_y)});
+    func->execute();
+    MGB_ASSERT_TENSOR_EQ(y_expect, host_y);
+}
+
+TEST(TestThreadPool, HybridBasic) {
+    //! the affinity of the calling thread is left alone
+    auto cpus = sys::get_cpu_affinity();
+    //! two fast and two slow cores, and the default capacity of the host
+    for (auto&& capacity :
+         {std::vector<float>{1.f, 1.f, .5f, .5f}, std::vector<float>{}}) {
+        for (size_t nr_threads : {1_z, 2_z, 4_z, 6_z}) {
+            HybridThreadPool thread_pool{nr_threads, capacity};
+            ASSERT_EQ(thread_pool.nr_threads(), nr_threads);
+            for (size_t total_task : {1_z, 3_z, 50_z, 1000_z}) {
+                std::vector<std::atomic_size_t> visited(total_task);
+                for (auto&& i : visited) {
+                    i = 0;
+                }
+                std::atomic_bool tid_ok{true};
+                auto func = [&](size_t index, size_t thread_id) {
+                    ++visited[index];
+                    if (thread_id >= nr_threads) {
+                        tid_ok = false;
+                    }
+                };
+                thread_pool.active();
+                thread_pool.add_task({func, total_task});
+                thread_pool.deactive();
+                ASSERT_TRUE(tid_ok);
+                for (size_t i = 0; i < total_task; i++) {
+                    ASSERT_EQ(visited[i], 1u);
+                }
+            }
+            ASSERT_EQ(cpus, sys::get_cpu_affinity());
+        }
+    }
+}
+
+TEST(TestThreadPool, HybridWeights) {
+    HybridThreadPool thread_pool{6, {.5f, 1.f, .25f, 1.f}};
+    //! the calling thread is expected on the fastest core, and the threads
+    //! beyond the number of cores are weighted as the slowest one
+    std::vector<float> expect{1.f, .5f, .25f, .25f, .25f, 1.f};
+    ASSERT_EQ(expect, thread_pool.thread_weights());
+
+    //! the sub-tasks are initially split by the weights
+    std::vector<size_t> expect_ends{40, 60, 70, 80, 90, 130};
+    ASSERT_EQ(expect_ends, WorkStealingThreadPool::split_by_weights(
+                                   130, thread_pool.thread_weights()));
+    //! the rounding leftover goes to the calling thread, which is the last
+    ASSERT_EQ(std::vector<size_t>({0, 1, 2}),
+              WorkStealingThreadPool::split_by_weights(2, {1.f, .1f, 1.f}));
+
+    //! equal cores get the same weight
+    HybridThreadPool uniform_pool{3, {1.f, .95f, 1.f}};
+    ASSERT_EQ(std::vector<float>(3, 1.f), uniform_pool.thread_weights());
+}
+
+TEST(TestThreadPool, HybridSetAffinity) {
+    auto cpus = sys::get_cpu_affinity();
+    //! cpu 0 is the slow one, so the threads bound to it are reweighted
+    //! from the fast cpus they were assigned
+    HybridThreadPool thread_pool{3, {.5f, 1.f, 1.f, 1.f}};
+    ASSERT_EQ(std::vector<float>(3, 1.f), thread_pool.thread_weights());
+    thread_pool.set_affinity([](size_t) { sys::set_cpu_affinity({0}); });
+    std::atomic_size_t nr_visited{0};
+    thread_pool.active();
+    thread_pool.add_task({[&](size_t, size_t) { ++nr_visited; }, 100});
+    ASSERT_EQ(100u, nr_visited);
+    ASSERT_EQ(.5f, thread_pool.thread_weights().back());
+    //! the workers apply the binding asynchronously
+    for (int i = 0; i < 10000; ++i) {
+        auto weights = thread_pool.thread_weights();
+        if (weights[0] == .5f && weights[1] == .5f)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(std::vector<float>(3, .5f), thread_pool.thread_weights());
+    thread_pool.deactive();
+    sys::set_cpu_affinity(cpus);
+}
+
+TEST(TestThreadPool, BenchmarkWorkStealing) {
+    constexpr size_t RUNS = 2000, SIZE = 1 << 16;
+    size_t nr_threads = std::max(2, sys::get_cpu_count());
+    std::vector<float> data(SIZE, 1.f);
+    auto run = [&](ThreadPool& thread_pool, size_t parallelism) {
+        size_t block = SIZE / parallelism;
+        auto func = [&](size_t index, size_t) {
+            auto ptr = data.data() + index * block;
+            for (size_t i = 0; i < block; ++i) {
+                ptr[i] = ptr[i] * 0.5f + 1.f;
+            }
+        };
+        thread_pool.active();
+        thread_pool.add_task({func, parallelism});
+        RealTimer timer;
+        for (size_t i = 0; i < RUNS; ++i) {
+            thread_pool.add_task({func, parallelism});
+        }
+        auto time = timer.get_msecs() * 1e3 / RUNS;
+        thread_pool.deactive();
+        return time;
+    };
+    ThreadPool thread_pool{nr_threads};
+    WorkStealingThreadPool ws_thread_pool{nr_threads};
+    for (size_t parallelism : {nr_threads, nr_threads * 4, 256_z, 4096_z}) {
+        auto t0 = run(thread_pool, parallelism),
+             t1 = run(ws_thread_pool, parallelism);
+        mgb_log("threads=%zu parallelism=%zu: ThreadPool %.2fus "
+                "WorkStealingThreadPool %.2fus speedup=%.2f",
+                nr_threads, parallelism, t0, t1, t0 / t1);
+    }
+}
+
 TEST(TestGraph, ParallelRunMultithreadMode) {
     // check race conditions when graphs are executed on multple threads
     std::atomic_size_t sync_counter{0};
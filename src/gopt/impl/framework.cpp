@@ -618,6 +618,20 @@ GraphOptimizer& GraphOptimizer::add_preset_passes(
         const ComputingGraph::Options* comp_graph_opt) {
     auto cv_type = inference_opt ? ConstVarType::IMMUTABLE_AND_PARAM
                                  : ConstVarType::IMMUTABLE;
+    {
+        // the normalization and attention subgraphs must be matched before
+        // they are rewritten by the arith passes
+        cg::GraphCommonOptimizeOptions pre_arith_opt;
+        const cg::GraphCommonOptimizeOptions* opt = inference_opt;
+        if (!opt && comp_graph_opt) {
+            opt = &comp_graph_opt->graph_opt;
+        }
+        if (opt) {
+            pre_arith_opt.fuse_normalization = opt->fuse_normalization;
+            pre_arith_opt.fuse_attention = opt->fuse_attention;
+        }
+        add_passes_for_optimize_options(pre_arith_opt, true);
+    }
     if (inference_opt) {
         add_pass<ConvertBatchNormToElemwisePass>();
     }
@@ -678,7 +692,9 @@ GraphOptimizer& GraphOptimizer::add_preset_passes(
 
     if (inference_opt) {
         add_pass<ParamFusePass>();
-        add_passes_for_optimize_options(*inference_opt);
+        auto opt = *inference_opt;
+        opt.disable_fuse_normalization().disable_fuse_attention();
+        add_passes_for_optimize_options(opt);
     }
 
     if (inference_opt) {
@@ -734,6 +750,14 @@ const GraphOptimizer& GraphOptimizer::add_passes_for_optimize_options(
         add_pass(FuseNCHW4Int8Preprocess::make());
         add_pass<FuseWarpPerspectiveDimshufflePass>();
     });
+    cb(fuse_normalization, {
+        add_pass<FuseSoftmaxPass>();
+        add_pass<FuseLayerNormPass>();
+    });
+    cb(fuse_attention, {
+        add_pass<FuseSoftmaxPass>();
+        add_pass<FuseAttentionPass>();
+    });
     cb(f16_io_comp, { add_pass(ConvertF32ToF16Pass::make(false)); });
     cb(f16_io_f32_comp, { add_pass(ConvertF32ToF16Pass::make(true)); });
 
@@ -803,6 +827,7 @@ const GraphOptimizer& GraphOptimizer::add_passes_for_optimize_options(
         add_pass<FuseConvBiasNonlinPass>();
         add_pass<FuseConvBiasZPass>();
     });
+    cb(fuse_image_preprocess, { add_pass<FuseImagePreprocessPass>(); });
 
 #undef cb
 
@@ -0,0 +1,274 @@
+/**
+ * \file src/gopt/impl/fuse_attention.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/gopt/inference.h"
+#include "megbrain/opr/basic_arith.h"
+#include "megbrain/opr/blas.h"
+#include "megbrain/opr/dnn/attention.h"
+#include "megbrain/opr/dnn/softmax.h"
+#include "megbrain/opr/tensor_manip.h"
+#include "megbrain/utils/hash_ct.h"
+
+#include "midout.h"
+
+MIDOUT_DECL(megbrain_fuse_attention)
+#define MIDOUT_B(tag)                         \
+    MIDOUT_BEGIN(megbrain_fuse_attention,     \
+                 midout_iv(MGB_HASH_STR(tag))) {
+#define MIDOUT_E \
+    }            \
+    MIDOUT_END();
+
+using namespace mgb;
+using namespace gopt;
+
+namespace {
+using Mode = opr::Elemwise::Mode;
+
+//! the fused kernel is only implemented on CPU
+bool is_fusable_var(VarNode* var) {
+    return var->comp_node().device_type() == CompNode::DeviceType::CPU &&
+           var->dtype().category() == DTypeCategory::FLOAT &&
+           var->shape().ndim > 0;
+}
+
+opr::Elemwise* try_cast_as_elemwise(VarNode* var, Mode mode) {
+    auto elem = try_cast_as_op<opr::Elemwise>(var->owner_opr());
+    if (elem && elem->param().mode == mode && elem->input().size() == 2) {
+        return elem;
+    }
+    return nullptr;
+}
+
+//! value of a float scalar constant; return false if \p var is not one
+bool get_scalar_const(VarNode* var, float& val) {
+    auto imm = SymbolVar{var}.as_immutable_scalar();
+    if (!imm.valid() || imm->dtype().category() != DTypeCategory::FLOAT) {
+        return false;
+    }
+    val = imm->get_cast<float>();
+    return true;
+}
+
+//! a BatchedMatrixMul with the default compute mode and format
+opr::BatchedMatrixMul* try_cast_as_bmm(VarNode* var) {
+    using Param = opr::BatchedMatrixMul::Param;
+    auto bmm = try_cast_as_op<opr::BatchedMatrixMul>(var->owner_opr());
+    if (bmm && bmm->output(0) == var && !bmm->param().transposeA &&
+        bmm->param().compute_mode == Param::ComputeMode::DEFAULT &&
+        bmm->param().format == Param::Format::DEFAULT) {
+        return bmm;
+    }
+    return nullptr;
+}
+
+//! skip a Reshape that only merges or splits the leading dims
+VarNode* skip_batch_reshape(VarNode* var) {
+    auto reshape = try_cast_as_op<opr::Reshape>(var->owner_opr());
+    if (!reshape) {
+        return var;
+    }
+    auto &&src = reshape->input(0)->shape(), &&dst = var->shape();
+    if (src.ndim >= 3 && dst.ndim >= 3 &&
+        src[src.ndim - 1] == dst[dst.ndim - 1] &&
+        src[src.ndim - 2] == dst[dst.ndim - 2]) {
+        return reshape->input(0);
+    }
+    return var;
+}
+
+/*!
+ * \brief match x with its last two dims swapped, optionally followed by a
+ *      reshape of the leading dims as done by matmul on more than 3 dims
+ * \return x or nullptr
+ */
+VarNode* match_transposed(VarNode* var) {
+    auto shuffle = try_cast_as_op<opr::Dimshuffle>(
+            skip_batch_reshape(var)->owner_opr());
+    if (!shuffle) {
+        return nullptr;
+    }
+    auto&& param = shuffle->param();
+    size_t n = param.pattern_len;
+    if (n < 3 || param.ndim != n || shuffle->input(0)->shape().ndim != n) {
+        return nullptr;
+    }
+    for (size_t i = 0; i + 2 < n; ++i) {
+        if (param.pattern[i] != static_cast<int>(i)) {
+            return nullptr;
+        }
+    }
+    if (param.pattern[n - 2] != static_cast<int>(n - 1) ||
+        param.pattern[n - 1] != static_cast<int>(n - 2)) {
+        return nullptr;
+    }
+    return shuffle->input(0);
+}
+
+//! reshape \p var to \p shape if their shapes differ
+SymbolVar reshape_to(VarNode* var, const TensorShape& shape) {
+    if (var->shape().eq_shape(shape)) {
+        return var;
+    }
+    return opr::Reshape::make(var, shape);
+}
+
+//! leading dims of \p lead followed by \p m and \p n
+TensorShape make_shape(const TensorShape& lead, size_t m, size_t n) {
+    TensorShape ret = lead;
+    ret[ret.ndim - 2] = m;
+    ret[ret.ndim - 1] = n;
+    return ret;
+}
+}  // anonymous namespace
+
+/* ================ FuseAttentionPass ================ */
+const char* FuseAttentionPass::name() const {
+    return mgb_cstr_log("fuse_attention");
+}
+
+void FuseAttentionPass::apply(OptState& state) const {
+    MIDOUT_B("FuseAttentionPass::apply")
+    auto rewriter = state.graph().make_rewriter();
+
+    /*
+     * match matmul(softmax(matmul(q, k^T) * scale + mask), v), where the
+     * softmax is on the last axis, the scale and the mask are optional and
+     * scores / c is taken as a scale of 1 / c; matmul on more than 3 dims is
+     * the BatchedMatrixMul between the reshapes that merge and split the
+     * leading dims, in which case the attention is computed on the shape of
+     * the scores
+     */
+    auto try_fuse = [&](opr::BatchedMatrixMul* bmm_pv) -> VarNode* {
+        if (bmm_pv->param().transposeB ||
+            !is_fusable_var(bmm_pv->output(0))) {
+            return nullptr;
+        }
+        auto softmax = try_cast_as_op<opr::Softmax>(
+                skip_batch_reshape(bmm_pv->input(0))->owner_opr());
+        if (!softmax) {
+            return nullptr;
+        }
+        VarNode* scores = softmax->output(0);
+        size_t ndim = scores->shape().ndim;
+        int axis = softmax->param().axis;
+        if (ndim < 3 || (axis != -1 && axis != static_cast<int>(ndim) - 1)) {
+            return nullptr;
+        }
+
+        VarNode *var = softmax->input(0), *mask = nullptr;
+        if (auto add = try_cast_as_elemwise(var, Mode::ADD)) {
+            for (size_t i = 0; i < 2; ++i) {
+                VarNode *x = add->input(i), *m = add->input(1 - i);
+                if (x->shape().eq_shape(scores->shape()) &&
+                    m->shape().ndim && m->shape().ndim <= ndim &&
+                    m->dtype() == scores->dtype()) {
+                    var = x;
+                    mask = m;
+                    break;
+                }
+            }
+        }
+        float scale = 1.f, c;
+        if (auto mul = try_cast_as_elemwise(var, Mode::MUL)) {
+            if (get_scalar_const(mul->input(1), c)) {
+                var = mul->input(0);
+                scale = c;
+            } else if (get_scalar_const(mul->input(0), c)) {
+                var = mul->input(1);
+                scale = c;
+            }
+        } else if (auto div = try_cast_as_elemwise(var, Mode::TRUE_DIV)) {
+            if (get_scalar_const(div->input(1), c) && c != 0.f) {
+                var = div->input(0);
+                scale = 1.f / c;
+            }
+        }
+        if (!var->shape().eq_shape(scores->shape())) {
+            return nullptr;
+        }
+        auto bmm_qk = try_cast_as_bmm(skip_batch_reshape(var));
+        if (!bmm_qk) {
+            return nullptr;
+        }
+
+        // the shape of the scores gives the leading dims of the attention
+        auto&& lead = scores->shape();
+        size_t sq = lead[ndim - 2], sk = lead[ndim - 1];
+        VarNode *q = bmm_qk->input(0), *k = bmm_qk->input(1),
+                *v = bmm_pv->input(1);
+        size_t d = q->shape()[q->shape().ndim - 1],
+               dv = v->shape()[v->shape().ndim - 1];
+        if (!bmm_qk->param().transposeB) {
+            k = match_transposed(k);
+            if (!k) {
+                return nullptr;
+            }
+        }
+        if (!is_fusable_var(q) || q->dtype() != scores->dtype() ||
+            k->shape().total_nr_elems() != lead.total_nr_elems() / sq * d ||
+            k->shape()[k->shape().ndim - 1] != d ||
+            v->shape().total_nr_elems() != lead.total_nr_elems() / sq * dv) {
+            return nullptr;
+        }
+
+        SymbolVarArray inputs{
+                reshape_to(rewriter.get_var(q), make_shape(lead, sq, d)),
+                reshape_to(rewriter.get_var(k), make_shape(lead, sk, d)),
+                reshape_to(rewriter.get_var(v), make_shape(lead, sk, dv))};
+        if (mask) {
+            // prepend the broadcast dims so the mask has the ndim of scores
+            auto&& mshp = mask->shape();
+            TensorShape shape;
+            shape.ndim = ndim;
+            for (size_t i = 0; i < ndim; ++i) {
+                size_t j = i + mshp.ndim;
+                shape[i] = j < ndim ? 1 : mshp[j - ndim];
+                if (shape[i] != 1 && shape[i] != lead[i]) {
+                    return nullptr;
+                }
+            }
+            inputs.push_back(reshape_to(rewriter.get_var(mask), shape));
+        }
+
+        opr::Attention::Param param;
+        param.scale = scale;
+        param.causal = false;
+        SymbolVar fused;
+        if (mask) {
+            fused = opr::Attention::make(inputs[0], inputs[1], inputs[2],
+                                         inputs[3], param, bmm_pv->config());
+        } else {
+            fused = opr::Attention::make(inputs[0], inputs[1], inputs[2],
+                                         param, bmm_pv->config());
+        }
+        return reshape_to(fused.node(), bmm_pv->output(0)->shape()).node();
+    };
+
+    auto on_opr = [&](OperatorNodeBase* opr) {
+        if (auto bmm = try_cast_as_bmm(opr->output(0))) {
+            if (auto fused = try_fuse(bmm)) {
+                rewriter.replace_var(
+                        opr->output(0), fused,
+                        mgb_cstr_log("replace matmul(softmax(matmul(q, k^T) * "
+                                     "scale + mask), v) -> attention"));
+                return;
+            }
+        }
+        rewriter.auto_replace_outputs(opr);
+    };
+    state.graph().iter(on_opr);
+    rewriter.apply_inplace();
+    MIDOUT_E
+}
+
+// vim: syntax=cpp.doxygen
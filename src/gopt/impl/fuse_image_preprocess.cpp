@@ -0,0 +1,346 @@
+/**
+ * \file src/gopt/impl/fuse_image_preprocess.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/gopt/inference.h"
+#include "megbrain/opr/basic_arith.h"
+#include "megbrain/opr/imgproc.h"
+#include "megbrain/opr/io.h"
+#include "megbrain/opr/tensor_manip.h"
+#include "megbrain/utils/hash_ct.h"
+
+#include "midout.h"
+
+MIDOUT_DECL(megbrain_fuse_image_preprocess)
+#define MIDOUT_B(tag)                                \
+    MIDOUT_BEGIN(megbrain_fuse_image_preprocess,     \
+                 midout_iv(MGB_HASH_STR(tag))) {
+#define MIDOUT_E \
+    }            \
+    MIDOUT_END();
+
+using namespace mgb;
+using namespace gopt;
+
+namespace {
+using Mode = opr::Elemwise::Mode;
+using Param = opr::ImagePreprocess::Param;
+
+/*!
+ * \brief values of a float32 constant that broadcasts along the channels of
+ *      an NHWC image with 3 channels
+ * \return false if \p var is not such a constant
+ */
+bool get_channel_const(VarNode* var, float* val) {
+    HostTensorND hv;
+    if (cg::is_static_var_value(var)) {
+        hv.copy_from(var->owner_graph()->static_infer_manager().infer_value(
+                var));
+    } else if (auto sdt = try_cast_as_op<opr::SharedDeviceTensor>(
+                       var->owner_opr())) {
+        if (!sdt->const_value()) {
+            return false;
+        }
+        hv.copy_from(sdt->get_dev_tensor());
+    } else {
+        return false;
+    }
+    hv.sync();
+    auto&& shape = hv.shape();
+    if (hv.dtype() != dtype::Float32() || !shape.ndim || shape.ndim > 4 ||
+        (shape[shape.ndim - 1] != 1 && shape[shape.ndim - 1] != 3) ||
+        shape.total_nr_elems() != shape[shape.ndim - 1]) {
+        return false;
+    }
+    auto ptr = hv.ptr<float>();
+    for (size_t c = 0; c < 3; ++c) {
+        val[c] = ptr[shape[shape.ndim - 1] == 1 ? 0 : c];
+    }
+    return true;
+}
+
+//! per-channel affine transform a * x + b
+struct Affine {
+    float a[3] = {1.f, 1.f, 1.f}, b[3] = {0.f, 0.f, 0.f};
+};
+
+/*!
+ * \brief match an elemwise opr whose operands other than \p var's producer
+ *      input are channel constants, and apply it after \p affine
+ * \return the non-constant input, or nullptr if not matched
+ */
+VarNode* match_affine_step(VarNode* var, Affine& affine) {
+    auto elem = try_cast_as_op<opr::Elemwise>(var->owner_opr());
+    if (!elem || var->dtype() != dtype::Float32()) {
+        return nullptr;
+    }
+    auto&& inp = elem->input();
+    auto mode = elem->param().mode;
+    float k0[3], k1[3];
+    auto is_x = [&](VarNode* x) { return x->shape().eq_shape(var->shape()); };
+    if (mode == Mode::FUSE_MUL_ADD3) {
+        // i0 * i1 + i2
+        for (size_t i = 0; i < 2; ++i) {
+            if (is_x(inp[i]) && get_channel_const(inp[1 - i], k0) &&
+                get_channel_const(inp[2], k1)) {
+                for (size_t c = 0; c < 3; ++c) {
+                    affine.a[c] *= k0[c];
+                    affine.b[c] = affine.b[c] * k0[c] + k1[c];
+                }
+                return inp[i];
+            }
+        }
+        return nullptr;
+    }
+    if (inp.size() != 2 || (mode != Mode::ADD && mode != Mode::SUB &&
+                            mode != Mode::MUL && mode != Mode::TRUE_DIV)) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        if (!is_x(inp[i]) || !get_channel_const(inp[1 - i], k0)) {
+            continue;
+        }
+        for (size_t c = 0; c < 3; ++c) {
+            float &a = affine.a[c], &b = affine.b[c], k = k0[c];
+            switch (mode) {
+                case Mode::ADD:
+                    b += k;
+                    break;
+                case Mode::SUB:
+                    // k - x negates the transform
+                    if (i) {
+                        a = -a;
+                        b = k - b;
+                    } else {
+                        b -= k;
+                    }
+                    break;
+                case Mode::MUL:
+                    a *= k;
+                    b *= k;
+                    break;
+                default:
+                    if (i || k == 0.f) {
+                        return nullptr;
+                    }
+                    a /= k;
+                    b /= k;
+            }
+        }
+        return inp[i];
+    }
+    return nullptr;
+}
+
+//! src format and output channel order of a CvtColor mode
+bool get_cvt_color_mode(opr::CvtColor::Param::Mode mode,
+                        Param::SrcFormat& src_format, bool& rgb) {
+    using CvtMode = opr::CvtColor::Param::Mode;
+    switch (mode) {
+        case CvtMode::BGR2RGB:
+        case CvtMode::RGB2BGR:
+            src_format = Param::SrcFormat::BGR;
+            rgb = true;
+            return true;
+        case CvtMode::BT601_YUV2RGB_NV21:
+        case CvtMode::BT601_YUV2BGR_NV21:
+            src_format = Param::SrcFormat::NV21;
+            rgb = mode == CvtMode::BT601_YUV2RGB_NV21;
+            return true;
+        case CvtMode::BT601_YUV2RGB_NV12:
+        case CvtMode::BT601_YUV2BGR_NV12:
+            src_format = Param::SrcFormat::NV12;
+            rgb = mode == CvtMode::BT601_YUV2RGB_NV12;
+            return true;
+        default:
+            return false;
+    }
+}
+}  // anonymous namespace
+
+/* ================ FuseImagePreprocessPass ================ */
+const char* FuseImagePreprocessPass::name() const {
+    return mgb_cstr_log("fuse_image_preprocess");
+}
+
+void FuseImagePreprocessPass::apply(OptState& state) const {
+    MIDOUT_B("FuseImagePreprocessPass::apply")
+    auto rewriter = state.graph().make_rewriter();
+
+    /*
+     * match, from the end,
+     *   [CvtColor] -> [Resize] -> TypeCvt(float32) -> normalize -> Dimshuffle
+     *   (NHWC to NCHW) -> [RelayoutFormat] -> [TypeCvt(qint8)]
+     * on a uint8 NHWC image, where the CvtColor can also come after the Resize
+     * if it only swaps channels, the normalization is a chain
+     * of elemwise oprs with per-channel constants, and the RelayoutFormat
+     * packs the channels to NCHW44 or NCHW88
+     */
+    auto try_fuse = [&](OperatorNodeBase* end) -> VarNode* {
+        VarNode* out = end->output(0);
+        if (out->comp_node().device_type() != CompNode::DeviceType::CPU ||
+            !out->shape().ndim) {
+            return nullptr;
+        }
+        Param param;
+        DType dtype = dtype::Float32();
+        VarNode* var = out;
+        auto match_qint8 = [&]() {
+            auto cvt = try_cast_as_op<opr::TypeCvt>(var->owner_opr());
+            if (cvt && dtype == dtype::Float32() &&
+                var->dtype().enumv() == DTypeEnum::QuantizedS8 &&
+                cvt->input(0)->dtype() == dtype::Float32()) {
+                dtype = var->dtype();
+                var = cvt->input(0);
+            }
+        };
+        match_qint8();
+        if (auto relayout =
+                    try_cast_as_op<opr::RelayoutFormat>(var->owner_opr())) {
+            using RMode = opr::RelayoutFormat::Param::Mode;
+            auto rmode = relayout->param().mode;
+            if (rmode == RMode::NCHW_NCHW88) {
+                param.format = Param::Format::NCHW88;
+            } else if (rmode == RMode::NCHW_NCHW4_IC_SMALL ||
+                       (rmode == RMode::NCHW_NCHW4 &&
+                        relayout->param().group == 1)) {
+                param.format = Param::Format::NCHW44;
+            } else {
+                return nullptr;
+            }
+            if (relayout->input(0)->dtype() != var->dtype()) {
+                return nullptr;
+            }
+            var = relayout->input(0);
+            match_qint8();
+        }
+
+        auto shuffle = try_cast_as_op<opr::Dimshuffle>(var->owner_opr());
+        if (!shuffle) {
+            return nullptr;
+        }
+        auto&& sparam = shuffle->param();
+        if (sparam.pattern_len != 4 || sparam.ndim != 4 ||
+            sparam.pattern[0] != 0 || sparam.pattern[1] != 3 ||
+            sparam.pattern[2] != 1 || sparam.pattern[3] != 2) {
+            return nullptr;
+        }
+        var = shuffle->input(0);
+        if (var->shape().ndim != 4 || var->shape()[3] != 3 ||
+            var->dtype() != dtype::Float32()) {
+            return nullptr;
+        }
+
+        Affine affine;
+        SmallVector<Affine> steps;
+        for (;;) {
+            Affine step;
+            auto x = match_affine_step(var, step);
+            if (!x) {
+                break;
+            }
+            steps.push_back(step);
+            var = x;
+        }
+        // compose the steps from the first one applied
+        for (size_t i = steps.size(); i--;) {
+            for (size_t c = 0; c < 3; ++c) {
+                affine.a[c] *= steps[i].a[c];
+                affine.b[c] = affine.b[c] * steps[i].a[c] + steps[i].b[c];
+            }
+        }
+        float* mean[3] = {&param.mean0, &param.mean1, &param.mean2};
+        float* scale[3] = {&param.scale0, &param.scale1, &param.scale2};
+        for (size_t c = 0; c < 3; ++c) {
+            if (affine.a[c] == 0.f) {
+                return nullptr;
+            }
+            *scale[c] = affine.a[c];
+            *mean[c] = -affine.b[c] / affine.a[c];
+        }
+
+        auto tocvt = try_cast_as_op<opr::TypeCvt>(var->owner_opr());
+        if (!tocvt || tocvt->input(0)->dtype() != dtype::Uint8()) {
+            return nullptr;
+        }
+        var = tocvt->input(0);
+
+        bool resized = false, converted = false;
+        for (;;) {
+            if (auto resize = try_cast_as_op<opr::Resize>(var->owner_opr())) {
+                auto&& rparam = resize->param();
+                // a CvtColor after the Resize can only swap channels
+                if (resized ||
+                    (converted &&
+                     param.src_format != Param::SrcFormat::BGR) ||
+                    rparam.format != opr::Resize::Param::Format::NHWC ||
+                    (rparam.imode != Param::InterpolationMode::LINEAR &&
+                     rparam.imode != Param::InterpolationMode::NEAREST) ||
+                    !cg::is_static_var_value(resize->input(1))) {
+                    break;
+                }
+                param.imode = rparam.imode;
+                param.oh = var->shape()[1];
+                param.ow = var->shape()[2];
+                resized = true;
+                var = resize->input(0);
+                continue;
+            }
+            if (auto cvt = try_cast_as_op<opr::CvtColor>(var->owner_opr())) {
+                Param::SrcFormat src_format;
+                bool rgb;
+                if (converted ||
+                    !get_cvt_color_mode(cvt->param().mode, src_format, rgb)) {
+                    break;
+                }
+                param.src_format = src_format;
+                param.rgb = rgb;
+                converted = true;
+                var = cvt->input(0);
+                continue;
+            }
+            break;
+        }
+        if (var->dtype() != dtype::Uint8()) {
+            return nullptr;
+        }
+
+        OperatorNodeConfig config = end->config();
+        config.output_dtype(dtype);
+        auto fused = opr::ImagePreprocess::make(rewriter.get_var(var), param,
+                                                config);
+        if (!fused.shape().eq_shape(out->shape())) {
+            return nullptr;
+        }
+        return fused.node();
+    };
+
+    auto on_opr = [&](OperatorNodeBase* opr) {
+        if (opr->same_type<opr::Dimshuffle>() ||
+            opr->same_type<opr::RelayoutFormat>() ||
+            opr->same_type<opr::TypeCvt>()) {
+            if (auto fused = try_fuse(opr)) {
+                rewriter.replace_var(
+                        opr->output(0), fused,
+                        mgb_cstr_log("replace cvt_color, resize, normalize "
+                                     "and layout transform of uint8 images "
+                                     "-> image_preprocess"));
+                return;
+            }
+        }
+        rewriter.auto_replace_outputs(opr);
+    };
+    state.graph().iter(on_opr);
+    rewriter.apply_inplace();
+    MIDOUT_E
+}
+
+// vim: syntax=cpp.doxygen
@@ -0,0 +1,333 @@
+/**
+ * \file src/gopt/impl/fuse_normalization.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/gopt/gtrans.h"
+#include "megbrain/gopt/inference.h"
+#include "megbrain/opr/basic_arith.h"
+#include "megbrain/opr/dnn/layer_norm.h"
+#include "megbrain/opr/dnn/softmax.h"
+#include "megbrain/opr/tensor_manip.h"
+#include "megbrain/utils/hash_ct.h"
+
+#include "midout.h"
+
+MIDOUT_DECL(megbrain_fuse_normalization)
+#define MIDOUT_B(tag)                             \
+    MIDOUT_BEGIN(megbrain_fuse_normalization,     \
+                 midout_iv(MGB_HASH_STR(tag))) {
+#define MIDOUT_E \
+    }            \
+    MIDOUT_END();
+
+using namespace mgb;
+using namespace gopt;
+
+namespace {
+using Mode = opr::Elemwise::Mode;
+
+//! the fused kernels are only implemented on CPU
+bool is_fusable_var(VarNode* var) {
+    return var->comp_node().device_type() == CompNode::DeviceType::CPU &&
+           var->dtype().category() == DTypeCategory::FLOAT &&
+           var->shape().ndim > 0;
+}
+
+opr::Elemwise* try_cast_as_elemwise(VarNode* var, Mode mode, size_t nr_inp) {
+    auto elem = try_cast_as_op<opr::Elemwise>(var->owner_opr());
+    if (elem && elem->param().mode == mode && elem->input().size() == nr_inp) {
+        return elem;
+    }
+    return nullptr;
+}
+
+//! match a reduce on \p var along a single axis; return the axis or -1
+int match_reduce(VarNode* var, opr::Reduce::Mode mode, VarNode* inp) {
+    auto reduce = try_cast_as_op<opr::Reduce>(var->owner_opr());
+    if (!reduce || reduce->param().mode != mode ||
+        reduce->input().size() != 1 ||
+        reduce->param().data_type != opr::Reduce::Param::DataType::DEFAULT ||
+        (inp && reduce->input(0) != inp)) {
+        return -1;
+    }
+    int ndim = reduce->input(0)->shape().ndim;
+    int axis = reduce->param().axis;
+    if (axis < 0) {
+        axis += ndim;
+    }
+    return axis >= 0 && axis < ndim ? axis : -1;
+}
+
+//! value of a float scalar constant; return false if \p var is not one
+bool get_scalar_const(VarNode* var, float& val) {
+    auto imm = SymbolVar{var}.as_immutable_scalar();
+    if (!imm.valid() || imm->dtype().category() != DTypeCategory::FLOAT) {
+        return false;
+    }
+    val = imm->get_cast<float>();
+    return true;
+}
+
+//! whether \p var is a scalar constant equal to \p val
+bool is_scalar_const(VarNode* var, float val) {
+    float v;
+    return get_scalar_const(var, v) && v == val;
+}
+
+//! match x ** exp, as an elemwise POW or a PowC; return x or nullptr
+VarNode* match_pow(VarNode* var, float exp) {
+    if (auto pow = try_cast_as_elemwise(var, Mode::POW, 2)) {
+        return is_scalar_const(pow->input(1), exp) ? pow->input(0) : nullptr;
+    }
+    if (auto powc = try_cast_as_op<opr::PowC>(var->owner_opr())) {
+        return powc->param().exp == exp ? powc->input(0) : nullptr;
+    }
+    return nullptr;
+}
+
+//! x * x or x ** 2
+bool is_square_of(VarNode* var, VarNode* x) {
+    if (auto mul = try_cast_as_elemwise(var, Mode::MUL, 2)) {
+        return mul->input(0) == x && mul->input(1) == x;
+    }
+    return match_pow(var, 2.f) == x;
+}
+}  // anonymous namespace
+
+/* ================ FuseSoftmaxPass ================ */
+const char* FuseSoftmaxPass::name() const {
+    return mgb_cstr_log("fuse_softmax");
+}
+
+void FuseSoftmaxPass::apply(OptState& state) const {
+    MIDOUT_B("FuseSoftmaxPass::apply")
+    auto rewriter = state.graph().make_rewriter();
+
+    /*
+     * match exp(x - max(x, axis)) / sum(exp(x - max(x, axis)), axis), which is
+     * how softmax is written in python, and the variant without subtracting
+     * the max
+     */
+    auto try_fuse = [&](opr::Elemwise* div) -> VarNode* {
+        VarNode *exp_var = div->input(0), *sum_var = div->input(1);
+        auto exp = try_cast_as_elemwise(exp_var, Mode::EXP, 1);
+        if (!exp) {
+            return nullptr;
+        }
+        int axis = match_reduce(sum_var, opr::Reduce::Mode::SUM, exp_var);
+        if (axis < 0) {
+            return nullptr;
+        }
+        VarNode* x = exp->input(0);
+        if (auto sub = try_cast_as_elemwise(x, Mode::SUB, 2)) {
+            if (match_reduce(sub->input(1), opr::Reduce::Mode::MAX,
+                             sub->input(0)) == axis) {
+                x = sub->input(0);
+            }
+        }
+        if (!is_fusable_var(x) ||
+            !x->shape().eq_shape(div->output(0)->shape())) {
+            return nullptr;
+        }
+        opr::Softmax::Param param;
+        param.axis = axis;
+        return opr::Softmax::make(rewriter.get_var(x), param, div->config())
+                .node();
+    };
+
+    auto on_opr = [&](OperatorNodeBase* opr) {
+        if (auto div = try_cast_as_elemwise(opr->output(0), Mode::TRUE_DIV,
+                                            2)) {
+            if (auto fused = try_fuse(div)) {
+                rewriter.replace_var(opr->output(0), fused,
+                                     mgb_cstr_log("replace exp(x) / sum(exp(x)) "
+                                                  "-> softmax(x)"));
+                return;
+            }
+        }
+        rewriter.auto_replace_outputs(opr);
+    };
+    state.graph().iter(on_opr);
+    rewriter.apply_inplace();
+    MIDOUT_E
+}
+
+/* ================ FuseLayerNormPass ================ */
+const char* FuseLayerNormPass::name() const {
+    return mgb_cstr_log("fuse_layer_norm");
+}
+
+void FuseLayerNormPass::apply(OptState& state) const {
+    MIDOUT_B("FuseLayerNormPass::apply")
+    auto rewriter = state.graph().make_rewriter();
+
+    //! normalized vars found so far: normalized var -> (x, eps)
+    ThinHashMap<VarNode*, std::pair<VarNode*, float>> normalized;
+
+    /*
+     * match (x - mean(x)) / (mean(x ** 2) - mean(x) * mean(x) + eps) ** 0.5,
+     * where mean is along the last axis, as written in the python LayerNorm
+     * module
+     */
+    auto try_fuse_norm = [&](opr::Elemwise* div) -> VarNode* {
+        auto sub = try_cast_as_elemwise(div->input(0), Mode::SUB, 2);
+        VarNode* std_in = match_pow(div->input(1), 0.5f);
+        if (!sub || !std_in) {
+            return nullptr;
+        }
+        VarNode *x = sub->input(0), *mean = sub->input(1);
+        if (!is_fusable_var(x) ||
+            match_reduce(mean, opr::Reduce::Mode::MEAN, x) !=
+                    static_cast<int>(x->shape().ndim) - 1) {
+            return nullptr;
+        }
+        auto add_eps = try_cast_as_elemwise(std_in, Mode::ADD, 2);
+        if (!add_eps) {
+            return nullptr;
+        }
+        float eps;
+        VarNode* var = add_eps->input(0);
+        if (!get_scalar_const(add_eps->input(1), eps)) {
+            var = add_eps->input(1);
+            if (!get_scalar_const(add_eps->input(0), eps)) {
+                return nullptr;
+            }
+        }
+        auto var_sub = try_cast_as_elemwise(var, Mode::SUB, 2);
+        if (!var_sub || !is_square_of(var_sub->input(1), mean)) {
+            return nullptr;
+        }
+        auto mean_sq = try_cast_as_op<opr::Reduce>(var_sub->input(0));
+        if (!mean_sq ||
+            match_reduce(var_sub->input(0), opr::Reduce::Mode::MEAN,
+                         mean_sq->input(0)) !=
+                    static_cast<int>(x->shape().ndim) - 1 ||
+            !is_square_of(mean_sq->input(0), x)) {
+            return nullptr;
+        }
+        opr::LayerNorm::Param param;
+        param.affine = false;
+        param.eps = eps;
+        param.normalized_dim = 1;
+        param.normalized_size = x->shape()[x->shape().ndim - 1];
+        normalized[div->output(0)] = {x, eps};
+        return opr::LayerNorm::make(rewriter.get_var(x), param,
+                                    div->config())[0]
+                .node();
+    };
+
+    //! find the normalized var before an optional reshape
+    auto find_normalized =
+            [&](VarNode* var) -> const std::pair<VarNode*, float>* {
+        auto iter = normalized.find(var);
+        if (iter == normalized.end()) {
+            if (auto reshape = try_cast_as_op<opr::Reshape>(var->owner_opr())) {
+                iter = normalized.find(reshape->input(0));
+            }
+        }
+        return iter == normalized.end() ? nullptr : &iter->second;
+    };
+
+    /*
+     * match weight * normalized + bias, where normalized may be reshaped from
+     * the flattened input; weight and bias must have the trailing shape of
+     * the output
+     */
+    auto try_fuse_affine = [&](VarNode* out, VarNode* mul0, VarNode* mul1,
+                               VarNode* bias) -> VarNode* {
+        auto&& oshp = out->shape();
+        VarNode* weight = mul0;
+        const std::pair<VarNode*, float>* norm = find_normalized(mul1);
+        if (!norm || !mul1->shape().eq_shape(oshp)) {
+            weight = mul1;
+            norm = find_normalized(mul0);
+            if (!norm || !mul0->shape().eq_shape(oshp)) {
+                return nullptr;
+            }
+        }
+        auto&& wshp = weight->shape();
+        if (!wshp.ndim || !wshp.eq_shape(bias->shape()) ||
+            wshp.ndim > oshp.ndim || weight->dtype() != out->dtype() ||
+            bias->dtype() != out->dtype()) {
+            return nullptr;
+        }
+        size_t normalized_size = 1;
+        for (size_t i = 0; i < wshp.ndim; ++i) {
+            if (wshp[i] != oshp[oshp.ndim - wshp.ndim + i]) {
+                return nullptr;
+            }
+            normalized_size *= wshp[i];
+        }
+        // the flattened input must keep the leading dims of the output and
+        // merge the normalized dims into its last axis
+        VarNode* x = norm->first;
+        auto&& fshp = x->shape();
+        size_t nr_leading = oshp.ndim - wshp.ndim;
+        if (fshp.ndim != nr_leading + 1 ||
+            fshp[nr_leading] != normalized_size) {
+            return nullptr;
+        }
+        for (size_t i = 0; i < nr_leading; ++i) {
+            if (fshp[i] != oshp[i]) {
+                return nullptr;
+            }
+        }
+        if (!fshp.eq_shape(oshp)) {
+            auto reshape = try_cast_as_op<opr::Reshape>(x->owner_opr());
+            if (!reshape || !reshape->input(0)->shape().eq_shape(oshp)) {
+                return nullptr;
+            }
+            x = reshape->input(0);
+        }
+        opr::LayerNorm::Param param;
+        param.affine = true;
+        param.eps = norm->second;
+        param.normalized_dim = wshp.ndim;
+        param.normalized_size = normalized_size;
+        return opr::LayerNorm::make(rewriter.get_var(x),
+                                    rewriter.get_var(weight),
+                                    rewriter.get_var(bias), param)[0]
+                .node();
+    };
+
+    auto on_opr = [&](OperatorNodeBase* opr) {
+        VarNode* fused = nullptr;
+        if (auto div = try_cast_as_elemwise(opr->output(0), Mode::TRUE_DIV,
+                                            2)) {
+            fused = try_fuse_norm(div);
+        } else if (auto add = try_cast_as_elemwise(opr->output(0), Mode::ADD,
+                                                   2)) {
+            for (size_t i = 0; i < 2 && !fused; ++i) {
+                if (auto mul = try_cast_as_elemwise(add->input(i), Mode::MUL,
+                                                    2)) {
+                    fused = try_fuse_affine(opr->output(0), mul->input(0),
+                                            mul->input(1), add->input(1 - i));
+                }
+            }
+        } else if (auto fma = try_cast_as_elemwise(
+                           opr->output(0), Mode::FUSE_MUL_ADD3, 3)) {
+            fused = try_fuse_affine(opr->output(0), fma->input(0),
+                                    fma->input(1), fma->input(2));
+        }
+        if (fused) {
+            rewriter.replace_var(opr->output(0), fused,
+                                 mgb_cstr_log("replace normalization subgraph "
+                                              "-> layer_norm(x)"));
+            return;
+        }
+        rewriter.auto_replace_outputs(opr);
+    };
+    state.graph().iter(on_opr);
+    rewriter.apply_inplace();
+    MIDOUT_E
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -187,6 +187,49 @@ namespace gopt {
     };
 
 
+    /*!
+     * \brief fuse the reduce/elemwise subgraph of softmax to a Softmax opr
+     */
+    class FuseSoftmaxPass final : public Pass {
+    public:
+        const char* name() const override;
+        void apply(OptState& opt) const override;
+    };
+
+    /*!
+     * \brief fuse the reduce/elemwise subgraph of layer normalization and the
+     * optional affine transform to a LayerNorm opr
+     */
+    class FuseLayerNormPass final : public Pass {
+    public:
+        const char* name() const override;
+        void apply(OptState& opt) const override;
+    };
+
+    /*!
+     * \brief fuse matmul(softmax(matmul(q, k^T) * scale + mask), v) to an
+     * Attention opr; softmax should have been fused by FuseSoftmaxPass
+     */
+    class FuseAttentionPass final : public Pass {
+    public:
+        const char* name() const override;
+        void apply(OptState& opt) const override;
+    };
+
+    /*!
+     * \brief fuse the color conversion, resize, normalization and layout
+     * transform of uint8 NHWC images to an ImagePreprocess opr on CPU
+     *
+     * The fused LINEAR resize rounds like the naive Resize, while x86 and arm
+     * resize 3-channel uint8 images in fixed point, so the normalized output
+     * may be off by one uint8 step (the scale of the channel) there.
+     */
+    class FuseImagePreprocessPass final : public Pass {
+    public:
+        const char* name() const override;
+        void apply(OptState& opt) const override;
+    };
+
     /*!
      * \brief fuse deconv and typecvt to a deconv opr
      */
@@ -336,6 +379,9 @@ namespace gopt {
             if (fuse_conv_bias_with_z) ret |= 1u << 3;
             if (weight_preprocess) ret |= 1u << 4;
             if (fuse_preprocess) ret |= 1u << 5;
+            if (fuse_normalization) ret |= 1u << 6;
+            if (fuse_attention) ret |= 1u << 7;
+            if (fuse_image_preprocess) ret |= 1u << 8;
             return ret;
         }
 
@@ -347,6 +393,9 @@ namespace gopt {
             ret.fuse_conv_bias_with_z = buf & 1u << 3;
             ret.weight_preprocess = buf & 1u << 4;
             ret.fuse_preprocess = buf & 1u << 5;
+            ret.fuse_normalization = buf & 1u << 6;
+            ret.fuse_attention = buf & 1u << 7;
+            ret.fuse_image_preprocess = buf & 1u << 8;
             ret.layout_transform = (LayoutTransform)(buf >> 32);
             return ret;
         }
@@ -19,9 +19,12 @@
 
 #include "megbrain/opr/basic_arith_wrapper.h"
 #include "megbrain/opr/blas.h"
+#include "megbrain/opr/dnn/attention.h"
 #include "megbrain/opr/dnn/batch_norm.h"
 #include "megbrain/opr/dnn/convolution.h"
+#include "megbrain/opr/dnn/layer_norm.h"
 #include "megbrain/opr/dnn/pooling.h"
+#include "megbrain/opr/dnn/softmax.h"
 #include "megbrain/opr/imgproc.h"
 #include "megbrain/opr/io.h"
 #include "megbrain/opr/nn_int.h"
@@ -4738,4 +4741,286 @@ TEST(TestGoptInference, PaddingChannelsWithWarpPerspective) {
 
 #endif
 
+TEST(TestGoptInference, FuseSoftmax) {
+    HostTensorGenerator<> gen;
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    auto host_x = gen({2, 5, 7}, cn);
+    auto x = opr::Host2DeviceCopy::make(*graph, host_x);
+
+    using RMode = opr::Reduce::Mode;
+    auto x_max = opr::Reduce::make(x, {RMode::MAX, 1});
+    auto e = opr::exp(x - x_max);
+    auto y = e / opr::Reduce::make(e, {RMode::SUM, 1});
+
+    SymbolVar y_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_normalization();
+    unpack_vector(gopt::optimize_for_inference({y}, options), y_opt);
+    ASSERT_TRUE(y_opt.node()->owner_opr()->same_type<opr::Softmax>());
+    ASSERT_EQ(1, y_opt.node()->owner_opr()->cast_final<opr::Softmax>()
+                         .param()
+                         .axis);
+
+    HostTensorND host_y, host_y_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt)});
+    func->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y, host_y_opt, 1e-5);
+}
+
+TEST(TestGoptInference, FuseLayerNorm) {
+    HostTensorGenerator<> gen;
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    auto host_x = gen({2, 3, 4, 5}, cn);
+    auto x = opr::Host2DeviceCopy::make(*graph, host_x);
+    auto w = opr::SharedDeviceTensor::make(*graph, *gen({4, 5}, cn)),
+         b = opr::SharedDeviceTensor::make(*graph, *gen({4, 5}, cn));
+
+    // the subgraph of the python LayerNorm module
+    using RMode = opr::Reduce::Mode;
+    auto xf = x.reshape({2, 3, 20});
+    auto mean = opr::Reduce::make(xf, {RMode::MEAN, -1});
+    auto var = opr::Reduce::make(opr::powf(xf, 2), {RMode::MEAN, -1}) -
+               mean * mean;
+    auto norm = (xf - mean) / opr::powf(var + 1e-5f, 0.5);
+    auto y_norm = norm.reshape({2, 3, 4, 5});
+    auto y = w * y_norm + b;
+
+    SymbolVar y_opt, y_norm_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_normalization();
+    unpack_vector(gopt::optimize_for_inference({y, norm}, options), y_opt,
+                  y_norm_opt);
+    auto opr = y_opt.node()->owner_opr();
+    ASSERT_TRUE(opr->same_type<opr::LayerNorm>());
+    auto&& param = opr->cast_final<opr::LayerNorm>().param();
+    ASSERT_TRUE(param.affine);
+    ASSERT_EQ(2u, param.normalized_dim);
+    ASSERT_EQ(20u, param.normalized_size);
+    ASSERT_EQ(x.node(), opr->input(0));
+    ASSERT_TRUE(y_norm_opt.node()->owner_opr()->same_type<opr::LayerNorm>());
+
+    HostTensorND host_y, host_y_opt, host_norm, host_norm_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt),
+                                make_callback_copy(norm, host_norm),
+                                make_callback_copy(y_norm_opt, host_norm_opt)});
+    func->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y, host_y_opt, 1e-4);
+    MGB_ASSERT_TENSOR_NEAR(host_norm, host_norm_opt, 1e-4);
+}
+
+TEST(TestGoptInference, FuseAttention) {
+    HostTensorGenerator<> gen;
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    auto mkvar = [&](const TensorShape& shp) {
+        return opr::Host2DeviceCopy::make(*graph, gen(shp, cn));
+    };
+    auto q = mkvar({6, 5, 8}), k = mkvar({6, 7, 8}), v = mkvar({6, 7, 4});
+
+    using RMode = opr::Reduce::Mode;
+    opr::BatchedMatrixMul::Param qk_param;
+    qk_param.transposeB = true;
+    auto s = opr::BatchedMatrixMul::make(q, k, qk_param) * 0.25f;
+    auto e = opr::exp(s - opr::Reduce::make(s, {RMode::MAX, 2}));
+    auto p = e / opr::Reduce::make(e, {RMode::SUM, 2});
+    auto y = opr::BatchedMatrixMul::make(p, v);
+
+    SymbolVar y_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_attention();
+    unpack_vector(gopt::optimize_for_inference({y}, options), y_opt);
+    ASSERT_EQ(0u, find_opr_num<opr::BatchedMatrixMul>(y_opt));
+    auto&& attn = find_opr<opr::Attention>(y_opt);
+    ASSERT_EQ(3u, attn.input().size());
+    ASSERT_EQ(0.25f, attn.param().scale);
+
+    HostTensorND host_y, host_y_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt)});
+    func->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y, host_y_opt, 1e-5);
+}
+
+TEST(TestGoptInference, FuseAttentionMultiHead) {
+    HostTensorGenerator<> gen;
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    auto mkvar = [&](const TensorShape& shp) {
+        return opr::Host2DeviceCopy::make(*graph, gen(shp, cn));
+    };
+    // (batch, head, seq, dim) with a padding mask per batch
+    auto q = mkvar({2, 3, 5, 8}), k = mkvar({2, 3, 7, 8}),
+         v = mkvar({2, 3, 7, 4}), mask = mkvar({2, 1, 1, 7});
+
+    // the subgraph of matmul on 4 dims, as in python
+    using RMode = opr::Reduce::Mode;
+    auto kt = opr::Dimshuffle::make(k, {0, 1, 3, 2});
+    auto s = opr::BatchedMatrixMul::make(q.reshape({6, 5, 8}),
+                                         kt.reshape({6, 8, 7}))
+                     .reshape({2, 3, 5, 7});
+    s = s / 2.f + mask;
+    auto e = opr::exp(s - opr::Reduce::make(s, {RMode::MAX, 3}));
+    auto p = e / opr::Reduce::make(e, {RMode::SUM, 3});
+    auto y = opr::BatchedMatrixMul::make(p.reshape({6, 5, 7}),
+                                         v.reshape({6, 7, 4}))
+                     .reshape({2, 3, 5, 4});
+
+    SymbolVar y_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_attention();
+    unpack_vector(gopt::optimize_for_inference({y}, options), y_opt);
+    ASSERT_EQ(0u, find_opr_num<opr::BatchedMatrixMul>(y_opt));
+    auto&& attn = find_opr<opr::Attention>(y_opt);
+    ASSERT_EQ(4u, attn.input().size());
+    ASSERT_EQ(0.5f, attn.param().scale);
+    ASSERT_EQ(TensorShape({2, 3, 5, 8}), attn.input(0)->shape());
+    ASSERT_EQ(TensorShape({2, 3, 7, 8}), attn.input(1)->shape());
+
+    HostTensorND host_y, host_y_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt)});
+    func->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y, host_y_opt, 1e-5);
+}
+
+TEST(TestGoptInference, FuseAttentionMaskedRow) {
+    HostTensorGenerator<> gen;
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    auto mkvar = [&](const std::shared_ptr<HostTensorND>& host) {
+        return opr::Host2DeviceCopy::make(*graph, host);
+    };
+    // the keys of the first query are all masked out and those of the second
+    // query partly
+    auto host_mask = gen({2, 5, 7}, cn);
+    auto mask_ptr = host_mask->ptr<float>();
+    std::fill(mask_ptr, mask_ptr + 2 * 5 * 7, 0.f);
+    std::fill(mask_ptr, mask_ptr + 7, -std::numeric_limits<float>::infinity());
+    std::fill(mask_ptr + 7, mask_ptr + 10,
+              -std::numeric_limits<float>::infinity());
+    auto q = mkvar(gen({2, 5, 8}, cn)), k = mkvar(gen({2, 7, 8}, cn)),
+         v = mkvar(gen({2, 7, 4}, cn)), mask = mkvar(host_mask);
+
+    using RMode = opr::Reduce::Mode;
+    opr::BatchedMatrixMul::Param qk_param;
+    qk_param.transposeB = true;
+    auto s = opr::BatchedMatrixMul::make(q, k, qk_param) * 0.25f + mask;
+    auto e = opr::exp(s - opr::Reduce::make(s, {RMode::MAX, 2}));
+    auto p = e / opr::Reduce::make(e, {RMode::SUM, 2});
+    auto y = opr::BatchedMatrixMul::make(p, v);
+
+    SymbolVar y_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_attention();
+    unpack_vector(gopt::optimize_for_inference({y}, options), y_opt);
+    ASSERT_EQ(1u, find_opr_num<opr::Attention>(y_opt));
+
+    HostTensorND host_y, host_y_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt)});
+    func->execute();
+    // the fully masked query gives NaN in both graphs
+    auto py = host_y.ptr<float>(), py_opt = host_y_opt.ptr<float>();
+    for (size_t i = 0; i < host_y.shape().total_nr_elems(); ++i) {
+        ASSERT_EQ(i < 4, std::isnan(py[i])) << i;
+        ASSERT_EQ(i < 4, std::isnan(py_opt[i])) << i;
+        if (i >= 4) {
+            ASSERT_NEAR(py[i], py_opt[i], 1e-5) << i;
+        }
+    }
+}
+
+TEST(TestGoptInference, FuseImagePreprocess) {
+    HostTensorGenerator<dtype::Uint8, RandomDistribution::UNIFORM> gen(0, 255);
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    // NV21 image of 16x20
+    auto x = opr::Host2DeviceCopy::make(*graph, gen({2, 24, 20, 1}, cn));
+    auto mkcst = [&](const std::vector<float>& v) {
+        HostTensorND val{cn, {1, 1, 1, 3}, dtype::Float32()};
+        std::copy(v.begin(), v.end(), val.ptr<float>());
+        return opr::ImmutableTensor::make(*graph, val);
+    };
+
+    opr::CvtColor::Param cvt_param;
+    cvt_param.mode = opr::CvtColor::Param::Mode::BT601_YUV2RGB_NV21;
+    opr::Resize::Param resize_param;
+    resize_param.format = opr::Resize::Param::Format::NHWC;
+    auto img = opr::Resize::make(opr::CvtColor::make(x, cvt_param), {8, 10},
+                                 resize_param);
+    auto f = opr::TypeCvt::make(img, dtype::Float32());
+    f = (f - mkcst({123.f, 117.f, 104.f})) / mkcst({58.f, 57.f, 57.f});
+    auto nchw = opr::Dimshuffle::make(f, {0, 3, 1, 2});
+    opr::RelayoutFormat::Param relayout_param;
+    relayout_param.mode = opr::RelayoutFormat::Param::Mode::NCHW_NCHW88;
+    auto y = opr::RelayoutFormat::make(nchw, relayout_param);
+
+    SymbolVar y_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_image_preprocess();
+    unpack_vector(gopt::optimize_for_inference({y}, options), y_opt);
+    auto&& fused = find_opr<opr::ImagePreprocess>(y_opt);
+    ASSERT_EQ(y_opt.node(), fused.output(0));
+    auto&& param = fused.param();
+    ASSERT_EQ(opr::ImagePreprocess::Param::SrcFormat::NV21, param.src_format);
+    ASSERT_EQ(opr::ImagePreprocess::Param::Format::NCHW88, param.format);
+    ASSERT_TRUE(param.rgb);
+    ASSERT_EQ(8u, param.oh);
+    ASSERT_EQ(10u, param.ow);
+    ASSERT_NEAR(117.f, param.mean1, 1e-3);
+    ASSERT_NEAR(1.f / 58.f, param.scale0, 1e-6);
+
+    HostTensorND host_y, host_y_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt)});
+    func->execute();
+    // both round the resized image to uint8, but the fixed-point x86/arm
+    // resize may differ by one step, which is the largest channel scale
+    // after normalization
+    MGB_ASSERT_TENSOR_NEAR(host_y, host_y_opt, 1.f / 57.f + 1e-4);
+}
+
+TEST(TestGoptInference, FuseImagePreprocessQuantized) {
+    HostTensorGenerator<dtype::Uint8, RandomDistribution::UNIFORM> gen(0, 255);
+    auto cn = CompNode::load("cpu0");
+    auto graph = ComputingGraph::make();
+    graph->options().graph_opt_level = 0;
+    auto x = opr::Host2DeviceCopy::make(*graph, gen({1, 9, 7, 3}, cn));
+
+    auto f = opr::TypeCvt::make(x, dtype::Float32());
+    auto nchw = opr::Dimshuffle::make(f * (1.f / 64) - 2.f, {0, 3, 1, 2});
+    opr::RelayoutFormat::Param relayout_param;
+    relayout_param.mode = opr::RelayoutFormat::Param::Mode::NCHW_NCHW4_IC_SMALL;
+    auto y = opr::TypeCvt::make(
+            opr::RelayoutFormat::make(nchw, relayout_param),
+            dtype::QuantizedS8(0.025f));
+
+    SymbolVar y_opt;
+    auto options = gopt::OptimizeForInferenceOptions{};
+    options.enable_fuse_image_preprocess();
+    unpack_vector(gopt::optimize_for_inference({y}, options), y_opt);
+    auto&& fused = find_opr<opr::ImagePreprocess>(y_opt);
+    ASSERT_EQ(y_opt.node(), fused.output(0));
+    ASSERT_EQ(opr::ImagePreprocess::Param::Format::NCHW44,
+              fused.param().format);
+    ASSERT_EQ(dtype::QuantizedS8(0.025f), y_opt.dtype());
+    ASSERT_EQ(TensorShape({1, 1, 9, 7, 4}), y_opt.shape());
+
+    HostTensorND host_y, host_y_opt;
+    auto func = graph->compile({make_callback_copy(y, host_y),
+                                make_callback_copy(y_opt, host_y_opt)});
+    func->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y, host_y_opt, 1);
+}
+
 // vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
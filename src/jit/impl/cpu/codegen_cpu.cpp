@@ -0,0 +1,220 @@
+/**
+ * \file src/jit/impl/cpu/codegen_cpu.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "./codegen_cpu.h"
+
+#include "megbrain/common.h"
+#include "megbrain/jit/ast_c.h"
+#include "megbrain/jit/placeholder_opr.h"
+#include "megbrain/jit/utils.h"
+#include "megbrain/opr/tensor_manip.h"
+#include "megbrain/utils/hash.h"
+
+#include <cinttypes>
+
+#if MGB_JIT
+
+using namespace mgb;
+using namespace jit;
+using namespace ast_c;
+
+namespace {
+
+using VarNode2AST = ThinHashMap<VarNode*, ASTPtr>;
+
+ASTPtr gen_opr_ast(cg::OperatorNodeBase* opr, const VarNode2AST& var2ast) {
+    ASTPtrArray cur_inputs;
+    for (auto inp_node : opr->input()) {
+        cur_inputs.push_back(var2ast.at(inp_node));
+    }
+    if (opr->same_type<opr::Reduce>() || opr->same_type<opr::GetVarShape>() ||
+        opr->same_type<opr::Dimshuffle>()) {
+        // Reduce and GetVarShape occur in grad and would be ignored
+        return {cur_inputs[0]};
+    }
+
+    return opr2AST(opr, cur_inputs).at(0);
+}
+}  // anonymous namespace
+
+std::string mgb::jit::codegen_cpu(const InternalGraph& internal_graph,
+                                  const JITExecutor::Args& args) {
+    mgb_assert(args.outputs.size() == 1 &&
+                       args.outputs[0].layout.dtype == dtype::Float32(),
+               "cpu JIT only supports a single float32 output");
+    for (auto&& i : args.inputs) {
+        mgb_assert(i.layout.dtype == dtype::Float32(),
+                   "cpu JIT only supports float32 inputs, got %s",
+                   i.layout.dtype.name());
+    }
+
+    // the math functions used by ast_c but missing in libm are defined in the
+    // prelude; the kernel walks the output row by row, so the innermost loop
+    // has no index computation and can be vectorized by the host compiler;
+    // the output may be forwarded from an input, so the loop is marked by
+    // ivdep rather than using restrict pointers
+    std::string cpu_kernel = R"(
+#include <cmath>
+#include <stddef.h>
+
+namespace {
+constexpr int NDIM = {{NDIM}};
+
+inline float rsqrtf(float x) {
+    return 1.f / sqrtf(x);
+}
+
+inline float rcbrtf(float x) {
+    return 1.f / cbrtf(x);
+}
+
+inline float mgb_log_sum_exp(float x, float y) {
+    float a = x < y ? x : y, b = x < y ? y : x;
+    return b + log1pf(expf(a - b));
+}
+
+//! unlike fmaxf and fminf, these do not block vectorization
+inline float mgb_fmaxf(float x, float y) {
+    return x < y ? y : x;
+}
+
+inline float mgb_fminf(float x, float y) {
+    return y < x ? y : x;
+}
+
+inline ptrdiff_t get_offset(const ptrdiff_t* idx, const ptrdiff_t* stride) {
+    ptrdiff_t ret = 0;
+    for (int i = 0; i < NDIM; ++i) {
+        ret += idx[i] * stride[i];
+    }
+    return ret;
+}
+}  // anonymous namespace
+
+#define fmaxf mgb_fmaxf
+#define fminf mgb_fminf
+
+extern "C" void {{KERNEL_NAME}}(const void* const* inputs, float* output,
+                                const ptrdiff_t* shape,
+                                const ptrdiff_t* strides, ptrdiff_t begin,
+                                ptrdiff_t end) {
+    ptrdiff_t idx[NDIM], rem = begin;
+    for (int i = NDIM - 1; i >= 0; --i) {
+        idx[i] = rem % shape[i];
+        rem /= shape[i];
+    }
+    while (begin < end) {
+        ptrdiff_t n = shape[NDIM - 1] - idx[NDIM - 1];
+        if (n > end - begin) {
+            n = end - begin;
+        }
+        float* dst = output + begin;
+        {{ROW_PTRS}}
+        {{HOIST_EXPRS}}
+#pragma GCC ivdep
+        for (ptrdiff_t j = 0; j < n; ++j) {
+            {{LOAD_EXPRS}}
+            {{INTERNAL_DECL_EXPRS}}
+            {{INTERNAL_ASSIGN_EXPRS}}
+            dst[j] = {{EXP}};
+        }
+        begin += n;
+        idx[NDIM - 1] = 0;
+        for (int i = NDIM - 2; i >= 0 && ++idx[i] == shape[i]; --i) {
+            idx[i] = 0;
+        }
+    }
+}
+)";
+
+    VarNode2AST var2ast;
+    auto&& placeholders = internal_graph.placeholders();
+    for (size_t i = 0; i < args.inputs.size(); i++) {
+        var2ast[placeholders[args.inputs[i].idx]->output(0)] =
+                ASTPtr::make<VariableAST>("x" + std::to_string(i));
+    }
+
+    std::string internal_decl_exps_str, internal_assign_exps_str;
+    size_t cur_opr_cnt = 0;
+    cg::DepOprIter{[&](cg::OperatorNodeBase* opr) {
+        ++cur_opr_cnt;
+        if (opr->same_type<JITPlaceholder>()) {
+            return;
+        }
+        ASTPtr elem_var =
+                ASTPtr::make<VariableAST>("y" + std::to_string(cur_opr_cnt));
+        ASTPtr elem_val = gen_opr_ast(opr, var2ast);
+        ASTPtr elem_decl = ASTPtr::make<DeclFloatAST>(elem_var);
+        ASTPtr elem_assign = ASTPtr::make<AssignAST>(elem_var, elem_val);
+        var2ast[opr->output(0)] = elem_var;
+        internal_decl_exps_str += elem_decl->code_gen();
+        internal_assign_exps_str += elem_assign->code_gen();
+    }}
+            .add(internal_graph.output());
+
+    str_util::replace_all_pairs_inplace(
+            cpu_kernel,
+            {{"{{NDIM}}", std::to_string(args.outputs[0].layout.ndim)},
+             {"{{INTERNAL_DECL_EXPRS}}", internal_decl_exps_str},
+             {"{{INTERNAL_ASSIGN_EXPRS}}", internal_assign_exps_str},
+             {"{{EXP}}", var2ast.at(internal_graph.output())->code_gen()}});
+    return cpu_kernel;
+}
+
+std::pair<std::string, std::string> mgb::jit::specialize_cpu_kernel(
+        const std::string& source_template,
+        const std::string& inner_stride_pattern, const std::string& extra_key) {
+    std::string row_ptrs, hoist_exps, load_exps;
+    for (size_t i = 0; i < inner_stride_pattern.size(); ++i) {
+        row_ptrs += ssprintf(
+                "const float* p%zu = static_cast<const float*>("
+                "inputs[%zu]) + get_offset(idx, strides + %zu * NDIM);\n",
+                i, i, i);
+        switch (inner_stride_pattern[i]) {
+            case '0':
+                hoist_exps += ssprintf("const float x%zu = p%zu[0];\n", i, i);
+                break;
+            case '1':
+                load_exps += ssprintf("const float x%zu = p%zu[j];\n", i, i);
+                break;
+            case 'g':
+                row_ptrs += ssprintf(
+                        "const ptrdiff_t s%zu = strides[%zu * NDIM + NDIM - "
+                        "1];\n",
+                        i, i);
+                load_exps +=
+                        ssprintf("const float x%zu = p%zu[j * s%zu];\n", i, i, i);
+                break;
+            default:
+                mgb_throw(InternalError, "bad inner stride pattern: %s",
+                          inner_stride_pattern.c_str());
+        }
+    }
+
+    std::string cpu_kernel = source_template;
+    str_util::replace_all_pairs_inplace(cpu_kernel,
+                                        {{"{{ROW_PTRS}}", row_ptrs},
+                                         {"{{HOIST_EXPRS}}", hoist_exps},
+                                         {"{{LOAD_EXPRS}}", load_exps}});
+
+    auto kernel_name = ssprintf(
+            "jit_cpu_%" PRIx64,
+            XXHash{}.update(cpu_kernel.data(), cpu_kernel.size())
+                    .update(extra_key.data(), extra_key.size())
+                    .digest());
+    str_util::replace_all_pairs_inplace(cpu_kernel,
+                                        {{"{{KERNEL_NAME}}", kernel_name}});
+    return {kernel_name, cpu_kernel};
+}
+
+#endif  // MGB_JIT
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
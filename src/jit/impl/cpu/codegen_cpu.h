@@ -0,0 +1,52 @@
+/**
+ * \file src/jit/impl/cpu/codegen_cpu.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#pragma once
+
+#include "megbrain_build_config.h"
+
+#if MGB_JIT
+
+#include "megbrain/jit/executor_opr.h"
+
+namespace mgb {
+namespace jit {
+
+/*!
+ * \brief generate the C++ source template of a cpu kernel
+ *
+ * The loads of the inputs in the innermost loop are left as placeholders,
+ * which are filled by specialize_cpu_kernel() according to the strides of the
+ * inputs on the innermost dim.
+ */
+std::string codegen_cpu(const InternalGraph& internal_graph,
+                        const JITExecutor::Args& args);
+
+/*!
+ * \brief fill the input loads of a kernel template
+ *
+ * \param inner_stride_pattern one char for each input: '0' if it is
+ *      broadcast on the innermost dim, '1' if it is contiguous and 'g' for
+ *      other strides
+ * \param extra_key extra string to be hashed into the kernel name, such as
+ *      the compiler options
+ * \return (kernel name, kernel source)
+ */
+std::pair<std::string, std::string> specialize_cpu_kernel(
+        const std::string& source_template,
+        const std::string& inner_stride_pattern, const std::string& extra_key);
+
+}  // namespace jit
+}  // namespace mgb
+
+#endif  // MGB_JIT
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
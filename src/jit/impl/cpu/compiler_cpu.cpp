@@ -0,0 +1,214 @@
+/**
+ * \file src/jit/impl/cpu/compiler_cpu.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "./compiler_cpu.h"
+#include "./codegen_cpu.h"
+
+#include "megbrain/common.h"
+#include "megbrain/comp_node_env.h"
+#include "megbrain/jit/utils.h"
+#include "megbrain/utils/hash.h"
+#include "megbrain/utils/persistent_cache.h"
+#include "megbrain/utils/timer.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+
+#if MGB_JIT
+
+using namespace mgb;
+using namespace jit;
+
+namespace {
+//! minimal number of elements computed by a task
+constexpr size_t MIN_TASK_SIZE = 16384;
+
+/*!
+ * \brief get the shared library of a kernel and load it
+ *
+ * The library is looked up in the workdir, then in the PersistentCache, and
+ * is compiled only if both miss.
+ */
+void* compile_and_load(const std::string& name, const std::string& source,
+                       const std::string& cache_category) {
+    auto&& helper = ExecutableHelper::get();
+    auto lib_name = name + ".so";
+    if (!helper.exists(lib_name)) {
+        auto&& cache = PersistentCache::inst();
+        PersistentCache::Blob key{source.data(), source.size()};
+        Maybe<PersistentCache::Blob> lib_cache;
+        if (!cache_category.empty()) {
+            lib_cache = cache.get(cache_category, key);
+        }
+        if (lib_cache.valid()) {
+            helper.write_file(
+                    lib_name,
+                    {static_cast<const char*>(lib_cache->ptr), lib_cache->size});
+        } else {
+            RealTimer timer;
+            auto obj_name = helper.compile_cpp_source_secondary(
+                    source.c_str(), name.c_str(), CpuCompiler::compile_flags());
+            helper.link({obj_name}, lib_name);
+            helper.remove_interm(obj_name);
+            auto lib = helper.read_file(lib_name);
+            if (!cache_category.empty()) {
+                cache.put(cache_category, key, {lib.data(), lib.size()});
+            }
+            mgb_log("CPU JIT: compile %s: source_len=%zu lib_len=%zu "
+                    "time=%.3fms",
+                    name.c_str(), source.size(), lib.size(),
+                    timer.get_msecs());
+        }
+    }
+    return helper.load_lib(lib_name);
+}
+}  // anonymous namespace
+
+/* =================== CpuExecutable ==================== */
+
+CpuExecutable::CpuExecutable(std::string source_template)
+        : m_source_template{std::move(source_template)} {}
+
+CpuExecutable::~CpuExecutable() {
+    for (auto&& i : m_pattern2func) {
+        ExecutableHelper::get().unload_lib(i.second.handle);
+    }
+}
+
+CpuExecutable::KernFunc CpuExecutable::get_func(
+        const std::string& inner_stride_pattern, CompNode cn) {
+    MGB_LOCK_GUARD(m_mtx);
+    auto&& func = m_pattern2func[inner_stride_pattern];
+    if (!func.func) {
+        auto&& flags = CpuCompiler::compile_flags();
+        auto&& host_cpu = CpuCompiler::host_cpu_id();
+        // natively tuned code is only valid on the same cpu model; it is
+        // not persisted if the cpu can not be identified
+        std::string target = ";flags=" + flags + ";cpu=" + host_cpu,
+                    cache_category;
+        if (!host_cpu.empty() || flags.find("native") == std::string::npos) {
+            cache_category = "jit:cpu:" +
+                             PersistentCache::make_category_from_comp_node(cn) +
+                             target;
+        }
+        std::string name, source;
+        std::tie(name, source) = specialize_cpu_kernel(
+                m_source_template, inner_stride_pattern, target);
+        func.handle = compile_and_load(name, source, cache_category);
+        ExecutableHelper::get().resolve_func(func.func, func.handle, name);
+    }
+    return func.func;
+}
+
+void CpuExecutable::execute(JITExecutor* fusion_opr) {
+    auto&& args = fusion_opr->args();
+    auto&& out = args.outputs[0];
+    size_t nr_elems = out.layout.total_nr_elems();
+    if (!nr_elems) {
+        return;
+    }
+    mgb_assert(out.layout.is_contiguous());
+
+    size_t ndim = out.layout.ndim, nr_inps = args.inputs.size();
+    std::string pattern(nr_inps, 'g');
+    SmallVector<const void*> inputs(nr_inps);
+    SmallVector<ptrdiff_t> shape(ndim), strides(nr_inps * ndim);
+    for (size_t i = 0; i < nr_inps; ++i) {
+        auto&& layout = args.inputs[i].layout;
+        mgb_assert(layout.ndim == ndim);
+        auto inner_stride = layout.stride[ndim - 1];
+        if (inner_stride == 0) {
+            pattern[i] = '0';
+        } else if (inner_stride == 1) {
+            pattern[i] = '1';
+        }
+        for (size_t j = 0; j < ndim; ++j) {
+            strides[i * ndim + j] = layout.stride[j];
+        }
+        inputs[i] = args.inputs[i].from->dev_tensor().raw_ptr();
+    }
+    for (size_t i = 0; i < ndim; ++i) {
+        shape[i] = out.layout.shape[i];
+    }
+
+    auto cn = fusion_opr->comp_node();
+    auto func = get_func(pattern, cn);
+    auto output = out.from->dev_tensor().ptr<float>();
+    auto&& env = CompNodeEnv::from_comp_node(cn).cpu_env();
+    size_t nr_tasks = std::max<size_t>(
+            1, std::min(env.dispatcher->nr_threads(), nr_elems / MIN_TASK_SIZE));
+    auto kern = [func, inputs, output, shape, strides, nr_elems, nr_tasks](
+                        size_t task_id, size_t) {
+        ptrdiff_t begin = nr_elems * task_id / nr_tasks,
+                  end = nr_elems * (task_id + 1) / nr_tasks;
+        func(inputs.data(), output, shape.data(), strides.data(), begin, end);
+    };
+    env.dispatch(std::move(kern), nr_tasks);
+}
+
+/* ==================== CpuCompiler ===================== */
+
+std::unique_ptr<Executable> CpuCompiler::do_compile(
+        const InternalGraph& graph, const JITExecutor::Args& args) {
+    return std::make_unique<CpuExecutable>(codegen_cpu(graph, args));
+}
+
+size_t CpuCompiler::get_nr_workspace_outputs(JITExecutor*) const {
+    return 0;
+}
+
+void CpuCompiler::init_workspace_size_infer(JITExecutor*) {}
+
+const std::string& CpuCompiler::compile_flags() {
+    static std::string ret = []() -> std::string {
+        if (auto set = MGB_GETENV("MGB_JIT_CPU_FLAGS")) {
+            return set;
+        }
+        std::string flags{"-O3 -fno-math-errno -fno-trapping-math"};
+#if defined(__x86_64__) || defined(__i386__)
+        flags += " -march=native";
+#elif defined(__aarch64__)
+        flags += " -mcpu=native";
+#endif
+        return flags;
+    }();
+    return ret;
+}
+
+const std::string& CpuCompiler::host_cpu_id() {
+    static std::string ret = []() -> std::string {
+        // the model and the feature flags of the first processor; the fields
+        // are named differently on x86 and arm
+        std::ifstream fin{"/proc/cpuinfo"};
+        std::string line, info;
+        const char* fields[] = {"vendor_id", "model name", "flags",
+                                "CPU implementer", "CPU part", "Features"};
+        while (std::getline(fin, line) && !line.empty()) {
+            for (auto i : fields) {
+                if (!line.compare(0, strlen(i), i)) {
+                    info += line;
+                    info += '\n';
+                }
+            }
+        }
+        if (info.empty()) {
+            return {};
+        }
+        return ssprintf("%" PRIx64,
+                        XXHash{}.update(info.data(), info.size()).digest());
+    }();
+    return ret;
+}
+
+#endif  // MGB_JIT
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -0,0 +1,100 @@
+/**
+ * \file src/jit/impl/cpu/compiler_cpu.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#pragma once
+
+#include "megbrain_build_config.h"
+
+#if MGB_JIT
+
+#include "megbrain/jit/compiler.h"
+
+namespace mgb {
+namespace jit {
+
+/*!
+ * \brief Executable class for CPU
+ *
+ * A kernel is compiled for each pattern of the strides of the inputs on the
+ * innermost dim, so the innermost loop only contains contiguous loads.
+ */
+class CpuExecutable final : public Executable {
+public:
+    //! (inputs, output, shape, input strides, begin, end)
+    using KernFunc = void (*)(const void* const*, float*, const ptrdiff_t*,
+                              const ptrdiff_t*, ptrdiff_t, ptrdiff_t);
+
+    explicit CpuExecutable(std::string source_template);
+    ~CpuExecutable();
+
+    void execute(JITExecutor* fusion_opr) override final;
+
+private:
+    struct Func {
+        void* handle = nullptr;
+        KernFunc func = nullptr;
+    };
+
+    KernFunc get_func(const std::string& inner_stride_pattern, CompNode cn);
+
+    const std::string m_source_template;
+    std::mutex m_mtx;
+    //! inner stride pattern => func
+    std::unordered_map<std::string, Func> m_pattern2func;
+};
+
+/*!
+ * \brief CPU compiler which generates C++ source and builds it with the host
+ *      compiler
+ *
+ * The compiled shared libraries are named by the hash of the source and kept
+ * in the JIT workdir (see MGB_JIT_WORKDIR), and are also stored in the
+ * PersistentCache under a key of the compile flags and the host cpu, so a
+ * kernel is only compiled once for each cpu model.
+ */
+class CpuCompiler final : public Compiler {
+    std::unique_ptr<Executable> do_compile(
+            const InternalGraph& graph, const JITExecutor::Args& args) override;
+
+public:
+    Property property() const override {
+        using F = Property::Flag;
+        return Property{F::NEED_INPUT_COLLAPSE | F::BIND_NDIM,
+                        JITFeatureBits::NONE, 64};
+    }
+
+    size_t get_nr_workspace_outputs(JITExecutor* opr) const override;
+
+    void init_workspace_size_infer(JITExecutor* opr) override;
+
+    /*!
+     * \brief options passed to the host compiler
+     *
+     * It can be overwritten by the MGB_JIT_CPU_FLAGS env var.
+     */
+    static const std::string& compile_flags();
+
+    /*!
+     * \brief a hash of the model and features of the host cpu, or empty if
+     *      they can not be read
+     *
+     * It is part of the key of the compiled libraries, as the default
+     * compile_flags() tune the code for the host cpu.
+     */
+    static const std::string& host_cpu_id();
+};
+
+}  // namespace jit
+}  // namespace mgb
+
+#endif  // MGB_JIT
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -35,6 +35,7 @@ class JITFusionPass::Impl final {
     JITFeatureBits m_feature_bits;
     OptState& m_opt_state;
     CompNode::UnorderedMap<size_t> m_cn2max_nr_input;
+    CompNode::UnorderedMap<JITFeatureBits> m_cn2feature_bits;
 
     SubGraph::Rewriter m_rewriter;
     SmallVector<std::unique_ptr<InternalGraphGenerator>> m_igraph_gen_storage;
@@ -53,6 +54,9 @@ class JITFusionPass::Impl final {
 
     size_t max_nr_input(CompNode cn);
 
+    //! the feature bits to be used on given comp node
+    JITFeatureBits feature_bits(CompNode cn);
+
     //! check whether all oprs which depend on the var are in i_graph
     bool test_all_readers_in_the_graph(VarNode* var,
                                        InternalGraphGenerator* i_graph);
@@ -68,7 +72,7 @@ class JITFusionPass::Impl final {
     void detect_fusion();
 
     //! check whether an opr can be fused
-    bool can_be_fused(cg::OperatorNodeBase* opr) const;
+    bool can_be_fused(cg::OperatorNodeBase* opr);
 
     static size_t nr_non_const_vars(const VarNodeArray& vars) {
         size_t num = 0;
@@ -176,31 +180,43 @@ bool JITFusionPass::Impl::check_shape(cg::OperatorNodeBase* opr,
         // currently we do not handle dynamic shape in JIT
         return false;
     }
-    if (!(m_feature_bits & JITFeatureBits::REDUCE)) {
-        // By requiring opr output shape to be the same as final output shape,
-        // we permit only one broadcast. If multiple broadcasts are fused,
-        // together, execution would be actually slower.
-        if ((m_feature_bits & JITFeatureBits::DIMSHUFFLE) &&
-            ig_gen->has_dimshuffle() &&
-            ig_gen->oprs_depended_by_dimshuffe().count(opr)) {
-            return opr->output(0)->shape().eq_shape(
-                    ig_gen->oprs_depended_by_dimshuffe()
-                            .at(opr)
-                            ->input(0)
-                            ->shape());
-        } else {
-            return opr->output(0)->shape().eq_shape(ig_gen->output()->shape());
+    auto feature_bits = this->feature_bits(ig_gen->output()->comp_node());
+    bool before_reduce = false;
+    auto is_before_reduce = [ig_gen](cg::OperatorNodeBase* opr) {
+        for (auto&& op_set : ig_gen->reduce_out_var_deps()) {
+            if (op_set.second.count(opr)) {
+                return true;
+            }
         }
+        return false;
+    };
+    if (feature_bits & JITFeatureBits::REDUCE) {
+        before_reduce = is_before_reduce(opr);
     }
 
-    bool before_reduce = false;
-    for (auto&& op_set : ig_gen->reduce_out_var_deps()) {
-        if (op_set.second.count(opr)) {
-            before_reduce = true;
-            break;
+    // the shapes expected for the outputs of the oprs before and after the
+    // reduce; an opr read by a dimshuffle on the same side of the reduce
+    // should have the input shape of the dimshuffle instead
+    const TensorShape* before_reduce_shape = &ig_gen->before_reduce_shape();
+    const TensorShape* after_reduce_shape = &ig_gen->output()->shape();
+    if ((feature_bits & JITFeatureBits::DIMSHUFFLE) &&
+        ig_gen->has_dimshuffle() &&
+        ig_gen->oprs_depended_by_dimshuffe().count(opr)) {
+        auto dimshuffle = ig_gen->oprs_depended_by_dimshuffe().at(opr);
+        if (!before_reduce) {
+            after_reduce_shape = &dimshuffle->input(0)->shape();
+        } else if (is_before_reduce(dimshuffle)) {
+            before_reduce_shape = &dimshuffle->input(0)->shape();
         }
     }
 
+    if (!(feature_bits & JITFeatureBits::REDUCE)) {
+        // By requiring opr output shape to be the same as final output shape,
+        // we permit only one broadcast. If multiple broadcasts are fused,
+        // together, execution would be actually slower.
+        return opr->output(0)->shape().eq_shape(*after_reduce_shape);
+    }
+
     if (opr->same_type<JITExecutor>()) {
         auto jit = &opr->cast_final<JITExecutor>();
         bool jit_has_reduce = jit->has_reduce();
@@ -214,8 +230,7 @@ bool JITFusionPass::Impl::check_shape(cg::OperatorNodeBase* opr,
                 if (ig_gen->has_reduce()) {
                     ret &= jit_inp_shp.eq_shape(ig_gen->before_reduce_shape());
                 }
-                ret &= jit->output(0)->shape().eq_shape(
-                        ig_gen->output()->shape());
+                ret &= jit->output(0)->shape().eq_shape(*after_reduce_shape);
                 return ret;
             }
         }
@@ -232,24 +247,22 @@ bool JITFusionPass::Impl::check_shape(cg::OperatorNodeBase* opr,
         if (before_reduce) {
             return reduce->input(0)->shape().eq_shape(
                            ig_gen->before_reduce_shape()) &&
-                   reduce->output(0)->shape().eq_shape(
-                           ig_gen->before_reduce_shape());
+                   reduce->output(0)->shape().eq_shape(*before_reduce_shape);
         } else {
             bool ret = true;
             if (ig_gen->has_reduce()) {
                 ret &= reduce->input(0)->shape().eq_shape(
                         ig_gen->before_reduce_shape());
             }
-            ret &= reduce->output(0)->shape().eq_shape(
-                    ig_gen->output()->shape());
+            ret &= reduce->output(0)->shape().eq_shape(*after_reduce_shape);
             return ret;
         }
     }
 
     if (before_reduce) {
-        return opr->output(0)->shape().eq_shape(ig_gen->before_reduce_shape());
+        return opr->output(0)->shape().eq_shape(*before_reduce_shape);
     } else {
-        return opr->output(0)->shape().eq_shape(ig_gen->output()->shape());
+        return opr->output(0)->shape().eq_shape(*after_reduce_shape);
     }
 }
 
@@ -340,7 +353,33 @@ size_t JITFusionPass::Impl::max_nr_input(CompNode cn) {
     return ret;
 }
 
-bool JITFusionPass::Impl::can_be_fused(cg::OperatorNodeBase* opr) const {
+JITFeatureBits JITFusionPass::Impl::feature_bits(CompNode cn) {
+    auto iter = m_cn2feature_bits.find(cn);
+    if (iter != m_cn2feature_bits.end()) {
+        return iter->second;
+    }
+    auto ret = m_feature_bits;
+    JITFeatureBits both = JITFeatureBits::REDUCE | JITFeatureBits::DIMSHUFFLE;
+    if (ret != JITFeatureBits::NONE) {
+        auto prop = Compiler::get(*m_opt_state.graph().comp_graph(), cn)
+                            ->property();
+        if (cn.device_type() == CompNode::DeviceType::CPU) {
+            // the cpu backends generate code for the fused reduce and
+            // dimshuffle only if they declare it; the C backend declares
+            // neither
+            ret = ret & prop.feature_bits;
+        } else if ((ret & both) == both &&
+                   (prop.feature_bits & both) != both) {
+            // reduce and dimshuffle can be fused into the same subgraph only
+            // if the compiler supports both; otherwise reduce is preferred
+            ret = JITFeatureBits::REDUCE;
+        }
+    }
+    m_cn2feature_bits[cn] = ret;
+    return ret;
+}
+
+bool JITFusionPass::Impl::can_be_fused(cg::OperatorNodeBase* opr) {
     if (!Compiler::is_supported_device(
                 opr->output(0)->comp_node().device_type())) {
         return false;
@@ -351,6 +390,22 @@ bool JITFusionPass::Impl::can_be_fused(cg::OperatorNodeBase* opr) const {
     if (!backend) {
         backend = "DEFAULT";
     }
+    //! the C backend on cpu only supports float32
+    bool only_float32 = opr->output(0)->comp_node().device_type() ==
+                        CompNode::DeviceType::CPU;
+#if MGB_JIT_MLIR
+    only_float32 = only_float32 && !strcmp(backend, "C");
+#endif
+    if (only_float32 && !opr->same_type<JITExecutor>()) {
+        for (auto i : opr->input()) {
+            if (i->dtype() != dtype::Float32()) {
+                return false;
+            }
+        }
+        if (opr->output(0)->dtype() != dtype::Float32()) {
+            return false;
+        }
+    }
     // float elemwise
     if (auto elem = gopt::try_cast_as_op<opr::Elemwise>(opr)) {
         bool ret = true;
@@ -394,6 +449,29 @@ bool JITFusionPass::Impl::can_be_fused(cg::OperatorNodeBase* opr) const {
                elem->output(0)->dtype().category() == DTypeCategory::FLOAT;
     }
 
+    auto feature_bits = this->feature_bits(opr->output(0)->comp_node());
+#if MGB_JIT_MLIR
+    //! the mlir backend fuses reduce and dimshuffle only on cpu
+    if (!strcmp(backend, "MLIR") && opr->output(0)->comp_node().device_type() ==
+                                            CompNode::DeviceType::CPU) {
+        // float reduce on an axis
+        if ((feature_bits & JITFeatureBits::REDUCE) &&
+            opr->same_type<opr::Reduce>()) {
+            auto&& param = opr->cast_final<opr::Reduce>().param();
+            return opr->input().size() == 1 && param.axis >= 0 &&
+                   param.data_type == opr::Reduce::Param::DataType::DEFAULT &&
+                   opr->output(0)->dtype() == dtype::Float32();
+        }
+
+        // dimshuffle
+        if ((feature_bits & JITFeatureBits::DIMSHUFFLE) &&
+            opr->same_type<opr::Dimshuffle>()) {
+            auto param = opr->cast_final_safe<opr::Dimshuffle>().param();
+            return param.pattern_len <= 5;
+        }
+    }
+#endif  // MGB_JIT_MLIR
+
     if (strcmp(backend, "MLIR")) {
         if (opr->same_type<opr::PowC>()) {
             return true;
@@ -408,13 +486,13 @@ bool JITFusionPass::Impl::can_be_fused(cg::OperatorNodeBase* opr) const {
         }
 
         // float reduce
-        if ((m_feature_bits & JITFeatureBits::REDUCE) &&
+        if ((feature_bits & JITFeatureBits::REDUCE) &&
             opr->same_type<opr::Reduce>()) {
             return opr->output(0)->dtype().category() == DTypeCategory::FLOAT;
         }
 
         // dimshuffle
-        if ((m_feature_bits & JITFeatureBits::DIMSHUFFLE) &&
+        if ((feature_bits & JITFeatureBits::DIMSHUFFLE) &&
             opr->same_type<opr::Dimshuffle>()) {
             auto param = opr->cast_final_safe<opr::Dimshuffle>().param();
             return param.pattern_len <= 4;
@@ -446,9 +524,8 @@ JITFusionPass::JITFusionPass(bool after_grad, int jit_opt_level,
     bool fuse_dimshuffle = config.fuse_dimshuffle == JITConfig::ON;
     bool fuse_reduce = config.fuse_reduce == JITConfig::ON;
 
-    if (fuse_dimshuffle && fuse_reduce) {
-        mgb_assert(false, "reduce and dimshuffle can not coexist now");
-    }
+    // if both are on, dimshuffle is only fused on the comp nodes whose
+    // compiler supports both
     if (fuse_dimshuffle) {
         m_feature_bits |= JITFeatureBits::DIMSHUFFLE;
     }
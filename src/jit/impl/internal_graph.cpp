@@ -247,7 +247,7 @@ void InternalGraphGenerator::add_opr(cg::OperatorNodeBase* opr) {
             find_reduce_opr_deps(opr);
         }
         if (jit->has_dimshuffle()) {
-            m_feature_bits |= JITFeatureBits::REDUCE;
+            m_feature_bits |= JITFeatureBits::DIMSHUFFLE;
             find_oprs_depended_by_dimshuffle(opr);
         }
     }
@@ -28,6 +28,7 @@
 #include <mlir/Conversion/GPUToNVVM/GPUToNVVMPass.h>
 #include <mlir/Conversion/SCFToStandard/SCFToStandard.h>
 #include <mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h>
+#include <mlir/Dialect/Affine/Passes.h>
 #include <mlir/Dialect/GPU/Passes.h>
 #include <mlir/IR/Dialect.h>
 #include <mlir/IR/MLIRContext.h>
@@ -125,7 +126,12 @@ std::unique_ptr<llvm::Module> translate_module_to_nvvm_ir_and_link_device(
 
 #endif
 
-void add_cpu_lowering_pass(mlir::PassManager& manager) {
+/*!
+ * \param tile_loops whether to run the affine loop tiling pass, which only
+ *      pays off for the loop nests of the reductions; the elemwise kernels are
+ *      a single pass over their operands and gain nothing from it
+ */
+void add_cpu_lowering_pass(mlir::PassManager& manager, bool tile_loops) {
     {
         mlir::OpPassManager& opt_pm = manager.nest<mlir::FuncOp>();
         opt_pm.addPass(mlir::createCanonicalizerPass());
@@ -138,6 +144,9 @@ void add_cpu_lowering_pass(mlir::PassManager& manager) {
         opt_pm.addPass(mlir::createCSEPass());
         opt_pm.addPass(mlir::createLoopFusionPass());
         opt_pm.addPass(mlir::createMemRefDataFlowOptPass());
+        if (tile_loops) {
+            opt_pm.addPass(mlir::createLoopTilingPass());
+        }
     }
     manager.addPass(create_lower_to_llvm_pass());
 }
@@ -191,9 +200,12 @@ void MLIRCompiler::run_lowering_pass(mlir::OwningModuleRef& module,
     mlir::PassManager manager(module->getContext());
     std::string target_chip;
     switch (m_device_type) {
-        case CompNode::DeviceType::CPU:
-            add_cpu_lowering_pass(manager);
+        case CompNode::DeviceType::CPU: {
+            bool has_reduce = false;
+            module->walk([&](dialect::Reduce) { has_reduce = true; });
+            add_cpu_lowering_pass(manager, has_reduce);
             break;
+        }
 #if MGB_CUDA
         case CompNode::DeviceType::CUDA: {
             auto&& prop =
@@ -33,8 +33,12 @@ public:
     MLIRCompiler(CompNode::DeviceType device_type = CompNode::DeviceType::CPU);
     Property property() const override {
         using F = Property::Flag;
-        return Property{F::BIND_NDIM | F::BIND_SHAPE,
-                        JITFeatureBits::DIMSHUFFLE, 64};
+        //! reduce is only lowered by the cpu pipeline
+        auto feature_bits =
+                m_device_type == CompNode::DeviceType::CPU
+                        ? JITFeatureBits::REDUCE | JITFeatureBits::DIMSHUFFLE
+                        : JITFeatureBits::DIMSHUFFLE;
+        return Property{F::BIND_NDIM | F::BIND_SHAPE, feature_bits, 64};
     }
 
     size_t get_nr_workspace_outputs(JITExecutor* opr) const override;
@@ -95,9 +95,12 @@ void MLIRCPUExecutable::execute(JITExecutor* fusion_opr) {
                                           args.outputs.size());
     size_t idx = 0;
     for (size_t i = 0; i < args.inputs.size(); i++) {
+        // the kernel is generated on the layouts of the input vars, and the
+        // fused Dimshuffle oprs are lowered into it, so the dimshuffled
+        // layouts in args must not be used
         args_array[idx] =
                 tensor2memref({args.inputs[i].from->dev_tensor().raw_ptr(),
-                               args.inputs[i].layout});
+                               args.inputs[i].from->layout()});
         args_array_pointer[idx] = &args_array[idx];
         idx++;
     }
@@ -27,6 +27,8 @@
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/DialectConversion.h>
 
+#include <limits>
+
 using namespace mgb;
 using namespace jit;
 
@@ -112,10 +114,13 @@ struct DimshuffleLowering : public ConversionPattern {
             : ConversionPattern(mgb::dialect::Dimshuffle::getOperationName(), 1,
                                 ctx) {}
 
+    //! the dims of the input discarded by the pattern must have shape 1, so
+    //! they are indexed by 0
     static mlir::AffineMap get_affinemap_from_pattern(
-            const std::vector<int32_t>& pattern, mlir::MLIRContext* ctx) {
-        size_t ndim = *std::max_element(pattern.begin(), pattern.end()) + 1;
-        std::vector<mlir::AffineExpr> exprs(ndim);
+            const std::vector<int32_t>& pattern, size_t ndim,
+            mlir::MLIRContext* ctx) {
+        std::vector<mlir::AffineExpr> exprs(
+                ndim, mlir::getAffineConstantExpr(0, ctx));
         for (size_t i = 0; i < pattern.size(); i++) {
             int32_t j = pattern[i];
             if (j >= 0) {
@@ -130,7 +135,9 @@ struct DimshuffleLowering : public ConversionPattern {
             ConversionPatternRewriter& rewriter) const final {
         auto loc = op->getLoc();
         auto pattern = llvm::dyn_cast<dialect::Dimshuffle>(op).pattern();
-        auto map = get_affinemap_from_pattern(pattern, op->getContext());
+        auto map = get_affinemap_from_pattern(
+                pattern, operands[0].getType().cast<MemRefType>().getRank(),
+                op->getContext());
         lower_op_to_loops(
                 op, operands, rewriter,
                 [loc, op, &map](OpBuilder& builder, ValueRange memref_operands,
@@ -142,6 +149,232 @@ struct DimshuffleLowering : public ConversionPattern {
     }
 };
 
+/*!
+ * \brief lower Reduce to affine loops
+ *
+ * When reducing on an outer axis, the loops follow the memory order of the
+ * input and the innermost loop is elementwise on a row of the output. When
+ * reducing on the innermost axis, NR_LANES partial results are accumulated by
+ * an elementwise loop over a tile of the input and folded at last. In both
+ * cases no reduction needs to be reassociated by LLVM to vectorize the
+ * innermost loop.
+ */
+struct ReduceLowering : public ConversionPattern {
+    using Mode = megdnn::param::Reduce::Mode;
+
+    //! number of partial results when reducing on the innermost axis
+    static constexpr int64_t NR_LANES = 8;
+
+    ReduceLowering(MLIRContext* ctx)
+            : ConversionPattern(mgb::dialect::Reduce::getOperationName(), 1,
+                                ctx) {}
+
+    static mlir::Value init_value(ValueBuilderHelper& helper, Mode mode) {
+        switch (mode) {
+            case Mode::PRODUCT:
+                return helper.const_f32(1.f);
+            case Mode::MIN:
+                return helper.const_f32(std::numeric_limits<float>::infinity());
+            case Mode::MAX:
+                return helper.const_f32(
+                        -std::numeric_limits<float>::infinity());
+            default:
+                return helper.const_f32(0.f);
+        }
+    }
+
+    //! accumulate an element of the input into a partial result
+    static mlir::Value accumulate(ValueBuilderHelper& helper, Mode mode,
+                                  mlir::Value acc, mlir::Value val) {
+        switch (mode) {
+            case Mode::SUM_SQR:
+                return helper.add(acc, helper.mul(val, val));
+            case Mode::PRODUCT:
+                return helper.mul(acc, val);
+            case Mode::MIN:
+                return helper.min(acc, val);
+            case Mode::MAX:
+                return helper.max(acc, val);
+            default:
+                return helper.add(acc, val);
+        }
+    }
+
+    //! combine two partial results
+    static mlir::Value combine(ValueBuilderHelper& helper, Mode mode,
+                               mlir::Value lhs, mlir::Value rhs) {
+        return accumulate(helper, mode == Mode::SUM_SQR ? Mode::SUM : mode,
+                          lhs, rhs);
+    }
+
+    LogicalResult matchAndRewrite(
+            Operation* op, ArrayRef<Value> operands,
+            ConversionPatternRewriter& rewriter) const final {
+        auto loc = op->getLoc();
+        auto ctx = op->getContext();
+        auto reduce = llvm::dyn_cast<dialect::Reduce>(op);
+        Mode mode = reduce.mode();
+        int64_t axis = reduce.axis();
+
+        mlir::Value src = operands[0];
+        auto src_shape = src.getType().cast<MemRefType>().getShape();
+        auto dst_type = (*op->result_type_begin()).cast<MemRefType>();
+        int64_t ndim = src_shape.size(), axis_len = src_shape[axis];
+        auto dst = jit::insert_alloc_and_dealloc(dst_type, loc, rewriter);
+
+        auto store_mean = [&](OpBuilder& builder, Location loc,
+                              mlir::Value memref, AffineMap map,
+                              ValueRange map_operands) {
+            if (mode != Mode::MEAN) {
+                return;
+            }
+            ValueBuilderHelper helper(builder, loc);
+            auto sum = builder.create<AffineLoadOp>(loc, memref, map,
+                                                    map_operands);
+            builder.create<AffineStoreOp>(
+                    loc, helper.div(sum, helper.const_f32(axis_len)), memref,
+                    map, map_operands);
+        };
+
+        if (axis + 1 < ndim) {
+            //! map the index of src to the index of dst
+            llvm::SmallVector<AffineExpr, 4> exprs;
+            for (int64_t i = 0; i < ndim; ++i) {
+                exprs.push_back(i == axis ? getAffineConstantExpr(0, ctx)
+                                          : getAffineDimExpr(i, ctx));
+            }
+            auto src2dst = AffineMap::get(ndim, 0, exprs, ctx);
+            auto identity = AffineMap::getMultiDimIdentityMap(ndim, ctx);
+
+            llvm::SmallVector<int64_t, 4> lower_bounds(ndim, 0),
+                    steps(ndim, 1);
+            buildAffineLoopNest(
+                    rewriter, loc, lower_bounds, dst_type.getShape(), steps,
+                    [&](OpBuilder& builder, Location loc, ValueRange ivs) {
+                        ValueBuilderHelper helper(builder, loc);
+                        builder.create<AffineStoreOp>(
+                                loc, init_value(helper, mode), dst, ivs);
+                    });
+            buildAffineLoopNest(
+                    rewriter, loc, lower_bounds, src_shape, steps,
+                    [&](OpBuilder& builder, Location loc, ValueRange ivs) {
+                        ValueBuilderHelper helper(builder, loc);
+                        auto acc = builder.create<AffineLoadOp>(loc, dst,
+                                                                src2dst, ivs);
+                        auto val = builder.create<AffineLoadOp>(loc, src, ivs);
+                        builder.create<AffineStoreOp>(
+                                loc, accumulate(helper, mode, acc, val), dst,
+                                src2dst, ivs);
+                    });
+            if (mode == Mode::MEAN) {
+                buildAffineLoopNest(
+                        rewriter, loc, lower_bounds, dst_type.getShape(),
+                        steps,
+                        [&](OpBuilder& builder, Location loc, ValueRange ivs) {
+                            store_mean(builder, loc, dst, identity, ivs);
+                        });
+            }
+            rewriter.replaceOp(op, dst);
+            return success();
+        }
+
+        auto lanes = jit::insert_alloc_and_dealloc(
+                MemRefType::get({NR_LANES}, dst_type.getElementType()), loc,
+                rewriter);
+        int64_t nr_outer = ndim - 1,
+                main_len = axis_len / NR_LANES * NR_LANES;
+
+        //! (outer ivs, tile iv, lane iv) => index of src
+        llvm::SmallVector<AffineExpr, 4> exprs;
+        for (int64_t i = 0; i < nr_outer; ++i) {
+            exprs.push_back(getAffineDimExpr(i, ctx));
+        }
+        exprs.push_back(getAffineDimExpr(nr_outer, ctx) +
+                        getAffineDimExpr(nr_outer + 1, ctx));
+        auto tile2src = AffineMap::get(nr_outer + 2, 0, exprs, ctx);
+        //! outer ivs => index of dst
+        exprs.back() = getAffineConstantExpr(0, ctx);
+        auto outer2dst = AffineMap::get(nr_outer, 0, exprs, ctx);
+        //! (outer ivs, iv on axis) => index of src
+        auto tail2src = AffineMap::getMultiDimIdentityMap(ndim, ctx);
+
+        llvm::SmallVector<int64_t, 4> outer_lbs(nr_outer, 0),
+                outer_steps(nr_outer, 1);
+        llvm::SmallVector<int64_t, 2> lane_lbs{0}, lane_ubs{NR_LANES},
+                lane_steps{1}, main_lbs{0, 0}, main_ubs{main_len, NR_LANES},
+                main_steps{NR_LANES, 1}, tail_lbs{main_len},
+                tail_ubs{axis_len};
+        buildAffineLoopNest(
+                rewriter, loc, outer_lbs, src_shape.drop_back(), outer_steps,
+                [&](OpBuilder& builder, Location loc, ValueRange outer_ivs) {
+                    ValueBuilderHelper helper(builder, loc);
+                    auto init = init_value(helper, mode);
+                    auto with_outer = [&outer_ivs](ValueRange ivs) {
+                        llvm::SmallVector<mlir::Value, 8> ret(
+                                outer_ivs.begin(), outer_ivs.end());
+                        ret.append(ivs.begin(), ivs.end());
+                        return ret;
+                    };
+
+                    buildAffineLoopNest(
+                            builder, loc, lane_lbs, lane_ubs, lane_steps,
+                            [&](OpBuilder& nested_builder, Location loc,
+                                ValueRange ivs) {
+                                nested_builder.create<AffineStoreOp>(
+                                        loc, init, lanes, ivs);
+                            });
+                    buildAffineLoopNest(
+                            builder, loc, main_lbs, main_ubs, main_steps,
+                            [&](OpBuilder& nested_builder, Location loc,
+                                ValueRange ivs) {
+                                ValueBuilderHelper helper(nested_builder, loc);
+                                auto lane = ivs.drop_front();
+                                auto acc = nested_builder.create<AffineLoadOp>(
+                                        loc, lanes, lane);
+                                auto val = nested_builder.create<AffineLoadOp>(
+                                        loc, src, tile2src, with_outer(ivs));
+                                nested_builder.create<AffineStoreOp>(
+                                        loc, accumulate(helper, mode, acc, val),
+                                        lanes, lane);
+                            });
+
+                    //! fold the lanes and the tail of the axis into dst
+                    builder.create<AffineStoreOp>(loc, init, dst, outer2dst,
+                                                  outer_ivs);
+                    buildAffineLoopNest(
+                            builder, loc, lane_lbs, lane_ubs, lane_steps,
+                            [&](OpBuilder& nested_builder, Location loc,
+                                ValueRange ivs) {
+                                ValueBuilderHelper helper(nested_builder, loc);
+                                auto acc = nested_builder.create<AffineLoadOp>(
+                                        loc, dst, outer2dst, outer_ivs);
+                                auto val = nested_builder.create<AffineLoadOp>(
+                                        loc, lanes, ivs);
+                                nested_builder.create<AffineStoreOp>(
+                                        loc, combine(helper, mode, acc, val),
+                                        dst, outer2dst, outer_ivs);
+                            });
+                    buildAffineLoopNest(
+                            builder, loc, tail_lbs, tail_ubs, lane_steps,
+                            [&](OpBuilder& nested_builder, Location loc,
+                                ValueRange ivs) {
+                                ValueBuilderHelper helper(nested_builder, loc);
+                                auto acc = nested_builder.create<AffineLoadOp>(
+                                        loc, dst, outer2dst, outer_ivs);
+                                auto val = nested_builder.create<AffineLoadOp>(
+                                        loc, src, tail2src, with_outer(ivs));
+                                nested_builder.create<AffineStoreOp>(
+                                        loc, accumulate(helper, mode, acc, val),
+                                        dst, outer2dst, outer_ivs);
+                            });
+                    store_mean(builder, loc, dst, outer2dst, outer_ivs);
+                });
+
+        rewriter.replaceOp(op, dst);
+        return success();
+    }
+};
+
 struct AssignOpLowering : public ConversionPattern {
     AssignOpLowering(MLIRContext* ctx)
             : ConversionPattern(dialect::AssignOp::getOperationName(), 1, ctx) {
@@ -210,7 +443,7 @@ public:
 
         OwningRewritePatternList patterns;
         patterns.insert<ElemwiseLowering, TypeCvtLowering, DimshuffleLowering,
-                        ReturnOpLowering, AssignOpLowering,
+                        ReduceLowering, ReturnOpLowering, AssignOpLowering,
                         ConstantScalarOpLowering>(&getContext());
 
         if (failed(applyPartialConversion(getFunction(), target,
@@ -171,6 +171,10 @@ private:
                 auto&& out = gen_typecvt(opr->cast_final<opr::TypeCvt>());
                 mgb_assert(
                         mlir::succeeded(declare(opr->output(0)->name(), out)));
+            } else if (opr->same_type<opr::Reduce>()) {
+                auto&& out = gen_reduce(opr->cast_final<opr::Reduce>());
+                mgb_assert(
+                        mlir::succeeded(declare(opr->output(0)->name(), out)));
             }
         }}
                 .add(internal_graph.output());
@@ -234,6 +238,28 @@ private:
                 pattern);
     }
 
+    mlir::Value gen_reduce(const opr::Reduce& opr) {
+        auto itype = get(opr.input(0))
+                             .getType()
+                             .dyn_cast_or_null<mlir::MemRefType>();
+        mgb_assert(itype, "the input type of Reduce must be MemRefType");
+        mgb_assert(opr.input().size() == 1,
+                   "Reduce to target shape is not supported by mlir backend");
+        auto param = opr.param();
+        int32_t axis = param.axis;
+        mgb_assert(axis >= 0 && axis < itype.getRank(), "bad reduce axis: %d",
+                   axis);
+
+        //! the reduced axis is kept with shape 1
+        std::vector<int64_t> oshape = itype.getShape();
+        oshape[axis] = 1;
+        auto res_type = mlir::MemRefType::get(oshape, itype.getElementType());
+
+        return m_builder.create<dialect::Reduce>(
+                m_builder.getUnknownLoc(), res_type, get(opr.input(0)),
+                param.mode, axis, param.data_type);
+    }
+
     mlir::Type get_type(const TensorLayout& layout) {
         return layout_to_mlir_type(layout, m_builder);
     }
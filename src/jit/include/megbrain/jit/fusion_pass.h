@@ -24,7 +24,7 @@ enum class JITFeatureBits : uint32_t {
     //! whether to fuse reduce oprs
     REDUCE = 1,
     //! whether to fuse dimshuffle oprs
-    //! DIMSHUFFLE and REDUCE can not coexsit
+    //! DIMSHUFFLE and REDUCE can coexist only if the compiler supports both
     DIMSHUFFLE = 2
 };
 
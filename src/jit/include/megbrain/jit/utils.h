@@ -86,11 +86,13 @@ public:
      *
      * \param out_name output filename template; it should not include the .cpp
      *      suffix
+     * \param extra_flags extra compiler options appended to the defaults
      *
      * \return object file name (without dir path)
      */
-    virtual std::string compile_cpp_source_secondary(const char* source,
-                                                     const char* out_name) = 0;
+    virtual std::string compile_cpp_source_secondary(
+            const char* source, const char* out_name,
+            const std::string& extra_flags = {}) = 0;
 
     //! link object files to shared library
     virtual void link(const SmallVector<std::string>& inp_names,
@@ -102,6 +104,9 @@ public:
     //! get real path of a file in the working dir
     virtual std::string realpath(const std::string& name) = 0;
 
+    //! whether a file exists in the working dir
+    virtual bool exists(const std::string& name) = 0;
+
     //! remove file if MGB_JIT_KEEP_INTERM is not set
     void remove_interm(const std::string& name) {
         if (!keep_interm()) {
@@ -125,6 +130,9 @@ public:
     //! write content to file
     void write_file(const std::string& name, const std::string& data);
 
+    //! read whole content of a file
+    std::string read_file(const std::string& name);
+
     //! whether MGB_JIT_KEEP_INTERM is set
     static bool keep_interm();
 
@@ -19,6 +19,7 @@
 #include "megbrain/jit/ast_c.h"
 #include "megbrain/jit/executor_opr.h"
 #include "megbrain/jit/fusion_pass.h"
+#include "megbrain/jit/utils.h"
 #include "megbrain/opr/basic_arith_wrapper.h"
 #include "megbrain/opr/blas.h"
 #include "megbrain/opr/tensor_manip.h"
@@ -29,6 +30,8 @@
 
 #include "../../core/impl/graph/cg_impl_seq.h"
 
+#include <set>
+
 #if MGB_JIT
 
 using namespace mgb;
@@ -1208,6 +1211,139 @@ TYPED_TEST(TestJITNvrtcFusion, run) {
     set_backend(Backend::NONE);
 }
 
+#define FOREACH_C_CASE(cb)                                                     \
+    cb(basic) cb(shape_change) cb(large_num_inps) cb(simple_exp)               \
+    cb(complex_exp) cb(exp_pow) cb(cache) cb(multi_device) cb(multi_shape)     \
+    cb(non_contig) cb(imm_scalar) cb(jit_grad)
+
+#define t(n) n,
+using c_test_types = ::testing::Types<FOREACH_C_CASE(t) void>;
+#undef t
+#undef FOREACH_C_CASE
+
+template <typename tag>
+class TestJITCFusion : public ::testing::Test {};
+TYPED_TEST_CASE(TestJITCFusion, c_test_types);
+TYPED_TEST(TestJITCFusion, run) {
+    set_backend(Backend::NONE);
+
+    run<TypeParam>(Backend::C, CompNode::load("cpu0"));
+
+    set_backend(Backend::NONE);
+}
+
+TEST(TestJITCFusion, MultiThread) {
+    set_backend(Backend::C);
+
+    FusionChecker checker{3,
+                          [](const SymbolVarArray& inp) -> SymbolVar {
+                              return opr::sigmoid(inp[0]) * inp[1] +
+                                     opr::max(inp[0], inp[2]);
+                          },
+                          CompNode::load("multithread4:0")};
+    checker.run({TensorShape{3, 5}, {3, 1}, {1, 5}})
+            .run({TensorShape{257, 1031}, {257, 1}, {1, 1031}})
+            .run({TensorShape{1031, 257}, {1031, 257}, {1, 1}});
+
+    set_backend(Backend::NONE);
+}
+
+TEST(TestJITCFusion, ReduceNotFused) {
+    // the C backend generates no code for reduce, so it must be kept out of
+    // the fused subgraphs even if jit level 2 asks for it
+    set_backend(Backend::C);
+
+    HostTensorGenerator<> gen;
+    auto cn = CompNode::load("cpu0");
+    auto host_x = gen({7, 9}, cn), host_y = gen({7, 1}, cn);
+    auto make_dst = [&](ComputingGraph& graph) {
+        auto x = opr::Host2DeviceCopy::make(graph, host_x),
+             y = opr::Host2DeviceCopy::make(graph, host_y),
+             s = opr::reduce_sum(opr::exp(x) * y + x,
+                                 opr::GetVarShape::make(y));
+        return opr::tanh(s) * y + s;
+    };
+    HostTensorND host_z1, host_z2;
+    auto funcs = make_func_pair(host_z1, host_z2, make_dst, 2);
+    funcs.first->execute();
+    funcs.second->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_z1, host_z2, 1e-5);
+    ASSERT_EQ(1u, find_oprs<opr::Reduce>(*funcs.second).size());
+    for (auto i : find_oprs<JITExecutor>(*funcs.second)) {
+        ASSERT_FALSE(i->has_reduce());
+        ASSERT_FALSE(i->has_dimshuffle());
+    }
+
+    set_backend(Backend::NONE);
+}
+
+TEST(TestJITCFusion, LibCache) {
+    set_backend(Backend::C);
+
+    std::vector<std::string> sources;
+    size_t nr_hit = 0, nr_put = 0;
+    auto on_cache_get = [&](const std::string& category, const void* key,
+                            size_t key_size, const void*, size_t val_size) {
+        ASSERT_EQ(0u, category.find("jit:cpu:"));
+        sources.push_back(std::string{static_cast<const char*>(key), key_size});
+        nr_hit += val_size != 0;
+    };
+    auto on_cache_set = [&](const std::string&, const void*, size_t,
+                            const void*, size_t) { ++nr_put; };
+    PersistentCacheHook cache_hook{on_cache_get, on_cache_set};
+
+    auto cn = CompNode::load("cpu0");
+
+    auto run = [cn]() {
+        HostTensorGenerator<> gen;
+        auto host_x = gen({2, 3}, cn);
+        auto make_dst = [&](ComputingGraph& graph) {
+            auto x = opr::Host2DeviceCopy::make(graph, host_x),
+                 y = jit_stop(x * opr::cos(x) + opr::exp(x)),
+                 z = y - opr::tanh(y) * y;
+            return z;
+        };
+        HostTensorND host_y1, host_y2;
+        auto funcs = make_func_pair(host_y1, host_y2, make_dst, 2);
+        ASSERT_EQ(2u, find_oprs<JITExecutor>(*funcs.second).size());
+        funcs.first->execute();
+        funcs.second->execute();
+        MGB_ASSERT_TENSOR_EQ(host_y1, host_y2);
+    };
+
+    // the JIT workdir is private to the process, so both kernels are looked
+    // up in the PersistentCache when they are compiled for the first time
+    run();
+    ASSERT_EQ(2u, sources.size());
+    size_t nr_put_first = nr_put;
+    ASSERT_EQ(2u, nr_hit + nr_put_first);
+
+    // the compiled libraries are then reused from the workdir
+    for (size_t i = 0; i < 3; ++i) {
+        run();
+        ASSERT_EQ(2u, sources.size());
+    }
+
+    // without them, both are exact hits of the PersistentCache
+    auto&& helper = ExecutableHelper::get();
+    for (auto&& i : sources) {
+        auto begin = i.find("jit_cpu_");
+        ASSERT_NE(std::string::npos, begin);
+        auto end = i.find_first_not_of("0123456789abcdef", begin + 8);
+        helper.remove(i.substr(begin, end - begin) + ".so");
+    }
+    size_t nr_hit_first = nr_hit;
+    run();
+    ASSERT_EQ(4u, sources.size());
+    ASSERT_EQ(nr_hit_first + 2, nr_hit);
+    ASSERT_EQ(nr_put_first, nr_put);
+    std::multiset<std::string> first{sources.begin(), sources.begin() + 2},
+            second{sources.begin() + 2, sources.end()};
+    ASSERT_EQ(first, second);
+
+    set_backend(Backend::NONE);
+}
+
 TEST(TestJITNvrtcFusion, SourceCache) {
     REQUIRE_GPU(1);
     set_backend(Backend::NVRTC);
@@ -1519,8 +1655,8 @@ TEST(TestJITNvrtc, JITConfig) {
         }
     }
 
-    // some test cases are commented because dimshuffle and reduce can not be
-    // fused at the same time
+    // nvrtc does not support fusing dimshuffle and reduce at the same time, so
+    // only reduce is fused if both are on
 
     for (int graph_opt_level : {0, 2}) {
         // jit_opt_level = 0, default = {OFF, OFF}
@@ -1532,33 +1668,33 @@ TEST(TestJITNvrtc, JITConfig) {
         run(graph_opt_level, 0, JITConfig{OFF, ON}, false, true, true);
         run(graph_opt_level, 0, JITConfig{ON, UNSET}, true, false, true);
         run(graph_opt_level, 0, JITConfig{ON, OFF}, true, false, true);
-        // run(graph_opt_level, 0, JITConfig{ON, ON}, true, true, true);
+        run(graph_opt_level, 0, JITConfig{ON, ON}, false, true, true);
     }
 
     {
         // graph_opt_level = 3, jit_opt_level = 0, default = {ON, OFF}
         run(3, 0, JITConfig{UNSET, UNSET}, true, false, true);
         run(3, 0, JITConfig{UNSET, OFF}, true, false, true);
-        // run(3, 0, JITConfig{UNSET, ON}, true, true, true);
+        run(3, 0, JITConfig{UNSET, ON}, false, true, true);
         run(3, 0, JITConfig{OFF, UNSET}, false, false, true);
         run(3, 0, JITConfig{OFF, OFF}, false, false, true);
         run(3, 0, JITConfig{OFF, ON}, false, true, true);
         run(3, 0, JITConfig{ON, UNSET}, true, false, true);
         run(3, 0, JITConfig{ON, OFF}, true, false, true);
-        // run(3, 0, JITConfig{ON, ON}, true, true, true);
+        run(3, 0, JITConfig{ON, ON}, false, true, true);
     }
 
     for (int graph_opt_level : {0, 2, 3}) {
         // jit_opt_level = 1, default = {ON, OFF}
         run(graph_opt_level, 1, JITConfig{UNSET, UNSET}, true, false, true);
         run(graph_opt_level, 1, JITConfig{UNSET, OFF}, true, false, true);
-        // run(graph_opt_level, 1, JITConfig{UNSET, ON}, true, true, true);
+        run(graph_opt_level, 1, JITConfig{UNSET, ON}, false, true, true);
         run(graph_opt_level, 1, JITConfig{OFF, UNSET}, false, false, true);
         run(graph_opt_level, 1, JITConfig{OFF, OFF}, false, false, true);
         run(graph_opt_level, 1, JITConfig{OFF, ON}, false, true, true);
         run(graph_opt_level, 1, JITConfig{ON, UNSET}, true, false, true);
         run(graph_opt_level, 1, JITConfig{ON, OFF}, true, false, true);
-        // run(graph_opt_level, 1, JITConfig{ON, ON}, true, true, true);
+        run(graph_opt_level, 1, JITConfig{ON, ON}, false, true, true);
 
         // jit_opt_level = 2, default = {OFF, ON}
         run(graph_opt_level, 2, JITConfig{UNSET, UNSET}, false, true, true);
@@ -1567,9 +1703,9 @@ TEST(TestJITNvrtc, JITConfig) {
         run(graph_opt_level, 2, JITConfig{OFF, UNSET}, false, true, true);
         run(graph_opt_level, 2, JITConfig{OFF, OFF}, false, false, true);
         run(graph_opt_level, 2, JITConfig{OFF, ON}, false, true, true);
-        // run(graph_opt_level, 2, JITConfig{ON, UNSET}, true, true, true);
+        run(graph_opt_level, 2, JITConfig{ON, UNSET}, false, true, true);
         run(graph_opt_level, 2, JITConfig{ON, OFF}, true, false, true);
-        // run(graph_opt_level, 2, JITConfig{ON, ON}, true, true, true);
+        run(graph_opt_level, 2, JITConfig{ON, ON}, false, true, true);
     }
 }
 
@@ -1717,6 +1853,100 @@ TEST(TestJITExecutor, TestJITMlirFusionGpu) {
     run_mlir(CompNode::load("gpu0"));
 }
 
+TEST(TestJITExecutor, TestJITMlirReduceFusion) {
+    set_backend(Backend::MLIR);
+    using ReduceMode = opr::Reduce::Param::Mode;
+
+    auto cn = CompNode::load("cpu0");
+    HostTensorGenerator<> gen;
+    auto host_x = gen({5, 23, 42}, cn), host_b = gen({1, 1, 42}, cn);
+    for (auto mode : {ReduceMode::SUM, ReduceMode::SUM_SQR, ReduceMode::PRODUCT,
+                      ReduceMode::MIN, ReduceMode::MAX, ReduceMode::MEAN}) {
+        // reduce on an outer axis and on the innermost axis
+        for (int axis : {1, 2}) {
+            auto make_dst = [&](ComputingGraph& graph) {
+                auto x = opr::Host2DeviceCopy::make(graph, host_x),
+                     b = opr::Host2DeviceCopy::make(graph, host_b);
+                auto y = opr::Reduce::make(x * 2 + b, {mode, axis});
+                return y * 3 + 1;
+            };
+            HostTensorND host_y1, host_y2;
+            auto funcs = make_func_pair(host_y1, host_y2, make_dst, 2);
+
+            funcs.first->execute();
+            funcs.second->execute();
+            MGB_ASSERT_TENSOR_NEAR(host_y1, host_y2, 1e-4);
+
+            JITExecutor* jit;
+            unpack_vector(find_oprs<JITExecutor>(*funcs.second), jit);
+            ASSERT_TRUE(jit->has_reduce());
+            ASSERT_EQ(0u, find_oprs<opr::Reduce>(*funcs.second).size());
+            ASSERT_EQ(0u, find_oprs<opr::Elemwise>(*funcs.second).size());
+        }
+    }
+}
+
+TEST(TestJITExecutor, TestJITMlirReduceNotFusedGpu) {
+    // reduce is only lowered by the cpu pipeline of the mlir backend
+    REQUIRE_GPU(1);
+    set_backend(Backend::MLIR);
+
+    auto cn = CompNode::load("gpu0");
+    HostTensorGenerator<> gen;
+    auto host_x = gen({5, 23, 42}, cn);
+    auto make_dst = [&](ComputingGraph& graph) {
+        auto x = opr::Host2DeviceCopy::make(graph, host_x);
+        auto y = opr::Reduce::make(x * 2 + 1,
+                                   {opr::Reduce::Param::Mode::SUM, 1});
+        return y * 3 + 1;
+    };
+    HostTensorND host_y1, host_y2;
+    auto funcs = make_func_pair(host_y1, host_y2, make_dst, 2);
+
+    funcs.first->execute();
+    funcs.second->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y1, host_y2, 1e-4);
+    ASSERT_EQ(1u, find_oprs<opr::Reduce>(*funcs.second).size());
+    for (auto i : find_oprs<JITExecutor>(*funcs.second)) {
+        ASSERT_FALSE(i->has_reduce());
+    }
+}
+
+TEST(TestJITExecutor, TestJITMlirDimshuffleReduceFusion) {
+    using JITConfig = cg::ComputingGraph::Options::GraphOpt::JITConfig;
+    set_backend(Backend::MLIR);
+
+    auto cn = CompNode::load("cpu0");
+    HostTensorGenerator<> gen;
+    auto host_x = gen({23, 42, 5}, cn);
+    auto make_dst = [&](ComputingGraph& graph) {
+        auto x = opr::Host2DeviceCopy::make(graph, host_x);
+        auto y = opr::Dimshuffle::make(x * 2 + 1, {2, 0, 1});
+        y = opr::Reduce::make(y * y, {opr::Reduce::Param::Mode::MEAN, 2});
+        return opr::Dimshuffle::make(y + 1, {1, 0, 2});
+    };
+
+    HostTensorND host_y1, host_y2;
+    auto g0 = ComputingGraph::make();
+    g0->options().graph_opt_level = 0;
+    auto f0 = g0->compile({make_callback_copy(make_dst(*g0), host_y1)});
+
+    auto g1 = ComputingGraph::make();
+    g1->options().graph_opt_level = 3;
+    g1->options().graph_opt.jit_config = {JITConfig::ON, JITConfig::ON};
+    auto f1 = g1->compile({make_callback_copy(make_dst(*g1), host_y2)});
+
+    f0->execute();
+    f1->execute();
+    MGB_ASSERT_TENSOR_NEAR(host_y1, host_y2, 1e-4);
+
+    JITExecutor* jit;
+    unpack_vector(find_oprs<JITExecutor>(*f1), jit);
+    ASSERT_TRUE(jit->has_reduce());
+    ASSERT_TRUE(jit->has_dimshuffle());
+    ASSERT_EQ(0u, find_oprs<opr::Reduce>(*f1).size());
+}
+
 #endif // MGB_JIT_MLIR
 
 #endif  // MGB_JIT
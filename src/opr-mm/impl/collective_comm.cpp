@@ -17,11 +17,14 @@
 #include "megbrain/opr/io.h"
 #include "megbrain/opr/tensor_manip.h"
 #include "megbrain/opr/basic_arith.h"
-#include "megbrain/opr/megray_helper.h"
 #include "megbrain/opr/group_manager.h"
 #include "megbrain/serialization/sereg.h"
 #include "megbrain/version_symbol.h"
 
+#if MGB_ENABLE_OPR_MM
+#include "megbrain/opr/megray_helper.h"
+#endif
+
 using namespace mgb;
 using namespace opr;
 
@@ -47,6 +50,21 @@ const char* get_param_name(CollectiveComm::Param param) {
     }
 }
 
+#if MGB_ENABLE_OPR_MM
+MegRay::ReduceOp get_megray_reduce_op(ShmCommunicator::ReduceOp op) {
+    switch (op) {
+        case ShmCommunicator::ReduceOp::SUM:
+            return MegRay::ReduceOp::MEGRAY_SUM;
+        case ShmCommunicator::ReduceOp::MAX:
+            return MegRay::ReduceOp::MEGRAY_MAX;
+        case ShmCommunicator::ReduceOp::MIN:
+            return MegRay::ReduceOp::MEGRAY_MIN;
+        default:
+            mgb_throw(MegBrainError, "bad CollectiveComm reduce op");
+    }
+}
+#endif
+
 }  // anonymous namespace
 
 /* ================= ModeTrait ================= */
@@ -77,6 +95,22 @@ protected:
         }
     }
 
+    /*!
+     * \brief run a ShmCommunicator call on the CPU dispatcher of the output
+     *      comp node, after the kernels that produce its input
+     *
+     * \param func called with the communicator; it must capture buffers by
+     *      value since it runs asynchronously
+     */
+    template <typename Func>
+    static void dispatch_shm(CollectiveComm* opr, Func&& func) {
+        auto comm = opr->m_shm_comm;
+        auto kern = [comm, func]() { func(comm.get()); };
+        CompNodeEnv::from_comp_node(opr->output(0)->comp_node())
+                .cpu_env()
+                .dispatch(kern);
+    }
+
 public:
     virtual ~ModeTrait() = default;
 
@@ -155,12 +189,23 @@ class CollectiveComm::ModeTrait::ALL_GATHER : public ModeTrait {
         auto &&iv = ivar->dev_tensor(), &&ov = ovar->dev_tensor();
         mgb_assert(ivar->comp_node().mem_node() ==
                    ovar->comp_node().mem_node());
+        if (opr->m_shm_comm) {
+            auto sendbuf = iv.raw_ptr(), recvbuf = ov.raw_ptr();
+            auto len = iv.shape().total_nr_elems();
+            auto dtype = iv.dtype();
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->all_gather(sendbuf, recvbuf, len, dtype);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->all_gather(
                 (void*)iv.raw_ptr(), (void*)ov.raw_ptr(),
                 iv.shape().total_nr_elems(),
                 get_megray_dtype(iv.dtype()),
                 opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay all_gather failed");
+#endif
     }
 
     Mode grad_mode() override { return Mode::REDUCE_SCATTER_SUM; }
@@ -199,11 +244,22 @@ class CollectiveComm::ModeTrait::REDUCE_SCATTER_SUM : public ModeTrait {
                    ovar->comp_node().mem_node());
 
         size_t buff_len = ov.shape().total_nr_elems();// * opr->m_nr_devices;
+        if (opr->m_shm_comm) {
+            auto sendbuf = iv.raw_ptr(), recvbuf = ov.raw_ptr();
+            auto dtype = ov.dtype();
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->reduce_scatter(sendbuf, recvbuf, buff_len, dtype,
+                                     ShmCommunicator::ReduceOp::SUM);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->reduce_scatter(
                 (void*)iv.raw_ptr(), (void*)ov.raw_ptr(), buff_len,
                 get_megray_dtype(ov.dtype()), MegRay::ReduceOp::MEGRAY_SUM,
                 opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay reduce_scatter failed");
+#endif
     }
 
     Mode grad_mode() override { return Mode::ALL_GATHER; }
@@ -229,7 +285,7 @@ class CollectiveComm::ModeTrait::ReducedBasedTrait {
 protected:
     ~ReducedBasedTrait() = default;
 
-    virtual MegRay::ReduceOp op() const = 0;
+    virtual ShmCommunicator::ReduceOp op() const = 0;
 };
 
 class CollectiveComm::ModeTrait::AllReduceBase : public ReducedBasedTrait,
@@ -246,12 +302,24 @@ class CollectiveComm::ModeTrait::AllReduceBase : public ReducedBasedTrait,
         auto &&iv = ivar->dev_tensor(), &&ov = ovar->dev_tensor();
         mgb_assert(ivar->comp_node().mem_node() ==
                    ovar->comp_node().mem_node());
+        if (opr->m_shm_comm) {
+            auto sendbuf = iv.raw_ptr(), recvbuf = ov.raw_ptr();
+            auto len = iv.shape().total_nr_elems();
+            auto dtype = iv.dtype();
+            auto rop = op();
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->all_reduce(sendbuf, recvbuf, len, dtype, rop);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->all_reduce(
                 (void*)iv.raw_ptr(), (void*)ov.raw_ptr(),
                 iv.shape().total_nr_elems(),
-                get_megray_dtype(iv.dtype()), op(),
+                get_megray_dtype(iv.dtype()), get_megray_reduce_op(op()),
                 opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay all_reduce failed");
+#endif
     }
 
     Mode grad_mode() override { return Mode::ALL_REDUCE_SUM; }
@@ -264,11 +332,15 @@ public:
 };
 
 class CollectiveComm::ModeTrait::ALL_REDUCE_SUM final : public AllReduceBase {
-    MegRay::ReduceOp op() const override { return MegRay::ReduceOp::MEGRAY_SUM; }
+    ShmCommunicator::ReduceOp op() const override {
+        return ShmCommunicator::ReduceOp::SUM;
+    }
 };
 
 class CollectiveComm::ModeTrait::ALL_REDUCE_MAX final : public AllReduceBase {
-    MegRay::ReduceOp op() const override { return MegRay::ReduceOp::MEGRAY_MAX; }
+    ShmCommunicator::ReduceOp op() const override {
+        return ShmCommunicator::ReduceOp::MAX;
+    }
 
     VarNode* grad(VarNode* out_grad, const CollectiveComm* opr) const override {
         VarNode* grad;
@@ -286,7 +358,9 @@ class CollectiveComm::ModeTrait::ALL_REDUCE_MAX final : public AllReduceBase {
 };
 
 class CollectiveComm::ModeTrait::ALL_REDUCE_MIN final : public AllReduceBase {
-    MegRay::ReduceOp op() const override { return MegRay::ReduceOp::MEGRAY_MIN; }
+    ShmCommunicator::ReduceOp op() const override {
+        return ShmCommunicator::ReduceOp::MIN;
+    }
 
     VarNode* grad(VarNode* out_grad, const CollectiveComm* opr) const override {
         VarNode* grad;
@@ -324,17 +398,32 @@ class CollectiveComm::ModeTrait::ReduceBase : public ReducedBasedTrait,
         if (opr->is_root()) {
             recvbuf = ovar->dev_tensor().raw_ptr();
         }
+        if (opr->m_shm_comm) {
+            auto sendbuf = iv.raw_ptr();
+            auto len = iv.shape().total_nr_elems();
+            auto dtype = iv.dtype();
+            auto rop = op();
+            uint32_t root = opr->m_root;
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->reduce(sendbuf, recvbuf, len, dtype, rop, root);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->reduce(
                 (void*)iv.raw_ptr(), recvbuf,
                 iv.shape().total_nr_elems(),
-                get_megray_dtype(iv.dtype()), op(),
+                get_megray_dtype(iv.dtype()), get_megray_reduce_op(op()),
                 opr->m_root, opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay reduce failed");
+#endif
     }
 };
 
 class CollectiveComm::ModeTrait::REDUCE_SUM final : public ReduceBase {
-    MegRay::ReduceOp op() const override { return MegRay::ReduceOp::MEGRAY_SUM; }
+    ShmCommunicator::ReduceOp op() const override {
+        return ShmCommunicator::ReduceOp::SUM;
+    }
 
     VarNode* grad(VarNode* out_grad, const CollectiveComm* opr) const override {
         VarNode* input = opr->is_root() ? out_grad : nullptr;
@@ -370,11 +459,21 @@ class CollectiveComm::ModeTrait::BROADCAST : public ModeTrait {
             datatype = ov.dtype();
             length = ov.shape().total_nr_elems();
         }
+        if (opr->m_shm_comm) {
+            auto recvbuf = ov.raw_ptr();
+            uint32_t root = opr->m_root;
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->broadcast(buff, recvbuf, length, datatype, root);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->broadcast(
                 buff, (void*)ov.raw_ptr(), length,
                 get_megray_dtype(datatype), opr->m_root,
                 opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay broadcast failed");
+#endif
     }
 
     Mode grad_mode() override { return Mode::REDUCE_SUM; }
@@ -400,10 +499,22 @@ class CollectiveComm::ModeTrait::GATHER : public ModeTrait {
         if (opr->is_root()) {
             recvbuf = opr->output(0)->dev_tensor().raw_ptr();
         }
+        if (opr->m_shm_comm) {
+            auto sendbuf = iv.raw_ptr();
+            auto len = iv.shape().total_nr_elems();
+            auto dtype = iv.dtype();
+            uint32_t root = opr->m_root;
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->gather(sendbuf, recvbuf, len, dtype, root);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->gather(
                 (void*)iv.raw_ptr(), recvbuf, iv.shape().total_nr_elems(),
                 get_megray_dtype(iv.dtype()), opr->m_root, opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay gather failed");
+#endif
     }
 
     VarNode* grad(VarNode* out_grad, const CollectiveComm* opr) const override {
@@ -428,10 +539,21 @@ class CollectiveComm::ModeTrait::SCATTER : public ModeTrait {
         if (opr->is_root()) {
             sendbuf = opr->input(0)->dev_tensor().raw_ptr();
         }
+        if (opr->m_shm_comm) {
+            auto len = ov.shape().total_nr_elems();
+            auto dtype = ov.dtype();
+            uint32_t root = opr->m_root;
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->scatter(sendbuf, recvbuf, len, dtype, root);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->scatter(
                 sendbuf, recvbuf, ov.shape().total_nr_elems(),
                 get_megray_dtype(ov.dtype()), opr->m_root, opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay scatter failed");
+#endif
     }
 
     Mode grad_mode() override { return Mode::GATHER; }
@@ -448,11 +570,22 @@ class CollectiveComm::ModeTrait::ALL_TO_ALL : public ModeTrait {
     void exec(CollectiveComm* opr) override {
         auto&& iv = opr->input(0)->dev_tensor();
         auto&& ov = opr->output(0)->dev_tensor();
+        if (opr->m_shm_comm) {
+            auto sendbuf = iv.raw_ptr(), recvbuf = ov.raw_ptr();
+            auto len = iv.shape().total_nr_elems() / opr->nr_devices();
+            auto dtype = iv.dtype();
+            dispatch_shm(opr, [=](ShmCommunicator* comm) {
+                comm->all_to_all(sendbuf, recvbuf, len, dtype);
+            });
+            return;
+        }
+#if MGB_ENABLE_OPR_MM
         auto status = opr->m_megray_comm->all_to_all(
                 (void*)iv.raw_ptr(), (void*)ov.raw_ptr(),
                 iv.shape().total_nr_elems() / opr->nr_devices(),
                 get_megray_dtype(iv.dtype()), opr->megray_ctx());
         mgb_assert(status == MegRay::MEGRAY_OK, "MegRay all_to_all failed");
+#endif
     }
 
     Mode grad_mode() override { return Mode::ALL_TO_ALL; }
@@ -598,6 +731,15 @@ void CollectiveComm::opr_register() {
     m_rank = reg_info.rank;
     m_root = reg_info.root_rank;
 
+    if (comp_node.device_type() == CompNode::DeviceType::CPU) {
+        // NCCL, RCCL and UCX can not run on CPU comp nodes
+        m_shm_comm = ShmCommBuilder::get_shm_comm(
+                reg_info.hash, m_key, m_nr_devices, m_rank, m_group_client);
+        m_init = true;
+        return;
+    }
+
+#if MGB_ENABLE_OPR_MM
     m_megray_comm = MegRayCommBuilder::get_megray_comm(
             reg_info.hash, m_key, m_nr_devices, m_rank,
             get_megray_backend(m_backend), m_group_client);
@@ -605,6 +747,11 @@ void CollectiveComm::opr_register() {
     m_megray_ctx = get_megray_context(output(0)->comp_node());
 
     m_init = true;
+#else
+    mgb_throw(MegBrainError,
+              "CollectiveComm on %s requires MegRay, which is not built",
+              comp_node.to_string().c_str());
+#endif
 }
 
 void CollectiveComm::add_input_layout_constraint() {
@@ -654,8 +801,16 @@ cg::OperatorNodeBase::NodeProp* CollectiveComm::do_make_node_prop() const {
 
 void CollectiveComm::do_execute(ExecEnv& env) {
     auto&& trait = ModeTrait::from_mode(m_param.mode);
-    mgb_assert(owner_graph()->options().async_exec_level,
+    auto cn = output(0)->comp_node();
+    auto async_level = owner_graph()->options().async_exec_level;
+    mgb_assert(async_level,
                "collective comm must be used with async dispatch");
+    // registration blocks until all ranks arrive, so CPU comp nodes must not
+    // share one dispatch thread
+    mgb_assert(cn.device_type() != CompNode::DeviceType::CPU ||
+                       (async_level & 0b10),
+               "collective comm on CPU comp nodes needs async_exec_level "
+               "with mask 0b10");
     mgb_assert(output().size() == 1,
                "collective comm only support exactly one output");
 
@@ -667,7 +822,6 @@ void CollectiveComm::do_execute(ExecEnv& env) {
                " got %d actually.",
                disable);
 
-    auto cn = output(0)->comp_node();
     auto runner = [this, cn, &trait] {
         opr_register();
         cn.activate();
@@ -0,0 +1,620 @@
+/**
+ * \file src/opr-mm/impl/shm_comm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "megbrain/opr/shm_comm.h"
+#include "megbrain/exception.h"
+#include "megbrain/utils/metahelper.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace mgb;
+using namespace opr;
+
+namespace {
+
+using ReduceOp = ShmCommunicator::ReduceOp;
+
+constexpr uint64_t SHM_COMM_MAGIC = 0x6d67625f73686d31ULL;  // "mgb_shm1"
+constexpr size_t SHM_COMM_ALIGN = 4096;
+//! spins before waiting on the futex in a barrier
+constexpr int BARRIER_SPIN = 4096;
+
+size_t align_up(size_t x, size_t align) {
+    return (x + align - 1) / align * align;
+}
+
+void cpu_relax() {
+#if defined(__SSE2__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+void futex_wait(std::atomic<uint32_t>* addr, uint32_t val) {
+#if defined(__linux__)
+    // the segment is shared between processes, so FUTEX_PRIVATE_FLAG must
+    // not be used
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, val,
+            nullptr, nullptr, 0);
+#else
+    MGB_MARK_USED_VAR(addr);
+    MGB_MARK_USED_VAR(val);
+    std::this_thread::yield();
+#endif
+}
+
+void futex_wake_all(std::atomic<uint32_t>* addr) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE,
+            INT32_MAX, nullptr, nullptr, 0);
+#else
+    MGB_MARK_USED_VAR(addr);
+#endif
+}
+
+/* ================= reduction kernels ================= */
+
+template <ReduceOp op>
+struct ScalarOp;
+
+template <>
+struct ScalarOp<ReduceOp::SUM> {
+    template <typename T>
+    static T apply(T a, T b) {
+        return a + b;
+    }
+};
+
+template <>
+struct ScalarOp<ReduceOp::MAX> {
+    template <typename T>
+    static T apply(T a, T b) {
+        return a < b ? b : a;
+    }
+};
+
+template <>
+struct ScalarOp<ReduceOp::MIN> {
+    template <typename T>
+    static T apply(T a, T b) {
+        return b < a ? b : a;
+    }
+};
+
+//! dst[i] = op(dst[i], src[i])
+template <ReduceOp op, typename T>
+void reduce_scalar(T* dst, const T* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = ScalarOp<op>::apply(dst[i], src[i]);
+    }
+}
+
+#if defined(__AVX__)
+struct VecF32 {
+    using vec = __m256;
+    static constexpr size_t width = 8;
+    static vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, vec x) { _mm256_storeu_ps(p, x); }
+    static vec sum(vec a, vec b) { return _mm256_add_ps(a, b); }
+    static vec max(vec a, vec b) { return _mm256_max_ps(a, b); }
+    static vec min(vec a, vec b) { return _mm256_min_ps(a, b); }
+};
+#elif defined(__SSE2__)
+struct VecF32 {
+    using vec = __m128;
+    static constexpr size_t width = 4;
+    static vec load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, vec x) { _mm_storeu_ps(p, x); }
+    static vec sum(vec a, vec b) { return _mm_add_ps(a, b); }
+    static vec max(vec a, vec b) { return _mm_max_ps(a, b); }
+    static vec min(vec a, vec b) { return _mm_min_ps(a, b); }
+};
+#elif defined(__ARM_NEON)
+struct VecF32 {
+    using vec = float32x4_t;
+    static constexpr size_t width = 4;
+    static vec load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, vec x) { vst1q_f32(p, x); }
+    static vec sum(vec a, vec b) { return vaddq_f32(a, b); }
+    static vec max(vec a, vec b) { return vmaxq_f32(a, b); }
+    static vec min(vec a, vec b) { return vminq_f32(a, b); }
+};
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(__ARM_NEON)
+template <ReduceOp op>
+typename VecF32::vec vec_apply(typename VecF32::vec a,
+                               typename VecF32::vec b) {
+    switch (op) {
+        case ReduceOp::SUM:
+            return VecF32::sum(a, b);
+        case ReduceOp::MAX:
+            return VecF32::max(a, b);
+        default:
+            return VecF32::min(a, b);
+    }
+}
+
+template <ReduceOp op>
+void reduce_f32(float* dst, const float* src, size_t n) {
+    constexpr size_t W = VecF32::width;
+    size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        auto a0 = VecF32::load(dst + i), a1 = VecF32::load(dst + i + W);
+        auto b0 = VecF32::load(src + i), b1 = VecF32::load(src + i + W);
+        VecF32::store(dst + i, vec_apply<op>(a0, b0));
+        VecF32::store(dst + i + W, vec_apply<op>(a1, b1));
+    }
+    reduce_scalar<op>(dst + i, src + i, n - i);
+}
+#else
+template <ReduceOp op>
+void reduce_f32(float* dst, const float* src, size_t n) {
+    reduce_scalar<op>(dst, src, n);
+}
+#endif
+
+template <ReduceOp op>
+void reduce_typed(void* dst, const void* src, size_t n, DType dtype) {
+    switch (dtype.enumv()) {
+        case DTypeEnum::Float32:
+            return reduce_f32<op>(static_cast<float*>(dst),
+                                  static_cast<const float*>(src), n);
+#define cb(_dt)                                                        \
+    case DTypeTrait<_dt>::enumv: {                                     \
+        using ctype = DTypeTrait<_dt>::ctype;                          \
+        return reduce_scalar<op>(static_cast<ctype*>(dst),             \
+                                 static_cast<const ctype*>(src), n);   \
+    }
+            cb(dtype::Int8) cb(dtype::Int32)
+#ifndef MEGDNN_DISABLE_FLOAT16
+            cb(dtype::Float16)
+#endif
+#undef cb
+        default:
+            mgb_throw(MegBrainError, "bad dtype for shm CollectiveComm: %s",
+                      dtype.name());
+    }
+}
+
+//! dst[i] = op(dst[i], src[i]) for \p n elements
+void reduce_to(void* dst, const void* src, size_t n, DType dtype,
+               ReduceOp op) {
+    switch (op) {
+        case ReduceOp::SUM:
+            return reduce_typed<ReduceOp::SUM>(dst, src, n, dtype);
+        case ReduceOp::MAX:
+            return reduce_typed<ReduceOp::MAX>(dst, src, n, dtype);
+        case ReduceOp::MIN:
+            return reduce_typed<ReduceOp::MIN>(dst, src, n, dtype);
+    }
+}
+
+void copy(void* dst, const void* src, size_t bytes) {
+    if (dst != src && bytes) {
+        memcpy(dst, src, bytes);
+    }
+}
+
+}  // anonymous namespace
+
+/* ================= ShmCommunicator ================= */
+
+struct ShmCommunicator::Header {
+    uint64_t magic;
+    uint64_t slot_size;
+    uint32_t size;
+    //! ranks arrived at the current barrier
+    alignas(64) std::atomic<uint32_t> nr_arrived;
+    //! bumped by the last rank arriving at a barrier; also the futex word
+    alignas(64) std::atomic<uint32_t> generation;
+};
+
+ShmCommunicator::ShmCommunicator(const std::string& name, uint32_t size,
+                                 uint32_t rank, bool create, size_t slot_size)
+        : m_name{name}, m_size{size}, m_rank{rank} {
+    mgb_assert(size && rank < size, "invalid rank %u of %u", rank, size);
+    size_t header_size = align_up(sizeof(Header), SHM_COMM_ALIGN);
+    if (create) {
+        m_slot_size = align_up(std::max<size_t>(slot_size, 64), 64);
+        m_map_size = header_size + m_slot_size * size;
+        m_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        mgb_throw_if(m_fd < 0, SystemError,
+                     "failed to create shared memory %s: %s", name.c_str(),
+                     strerror(errno));
+        mgb_throw_if(ftruncate(m_fd, m_map_size), SystemError,
+                     "failed to resize shared memory %s to %zu: %s",
+                     name.c_str(), m_map_size, strerror(errno));
+    } else {
+        m_fd = shm_open(name.c_str(), O_RDWR, 0600);
+        mgb_throw_if(m_fd < 0, SystemError,
+                     "failed to open shared memory %s: %s", name.c_str(),
+                     strerror(errno));
+        struct stat st;
+        mgb_throw_if(fstat(m_fd, &st), SystemError,
+                     "failed to stat shared memory %s: %s", name.c_str(),
+                     strerror(errno));
+        m_map_size = st.st_size;
+    }
+    m_addr = mmap(nullptr, m_map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  m_fd, 0);
+    mgb_throw_if(m_addr == MAP_FAILED, SystemError,
+                 "failed to map shared memory %s: %s", name.c_str(),
+                 strerror(errno));
+    m_header = static_cast<Header*>(m_addr);
+    m_slots = static_cast<uint8_t*>(m_addr) + header_size;
+    if (create) {
+        new (m_header) Header;
+        m_header->slot_size = m_slot_size;
+        m_header->size = size;
+        m_header->nr_arrived.store(0);
+        m_header->generation.store(0);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_header->magic = SHM_COMM_MAGIC;
+    } else {
+        mgb_throw_if(m_map_size < header_size ||
+                             m_header->magic != SHM_COMM_MAGIC ||
+                             m_header->size != size,
+                     MegBrainError,
+                     "shared memory %s is not a communicator of %u ranks",
+                     name.c_str(), size);
+        m_slot_size = m_header->slot_size;
+        mgb_assert(m_map_size >= header_size + m_slot_size * size);
+    }
+
+    const char* algo = MGB_GETENV("MGB_SHM_COMM_ALLREDUCE_ALGO");
+    if (algo && !strcmp(algo, "ring")) {
+        m_algo = AllReduceAlgo::RING;
+    } else if (algo && !strcmp(algo, "recursive_halving")) {
+        m_algo = AllReduceAlgo::RECURSIVE_HALVING;
+    }
+}
+
+ShmCommunicator::~ShmCommunicator() {
+    if (m_addr && m_addr != MAP_FAILED) {
+        munmap(m_addr, m_map_size);
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+void ShmCommunicator::unlink() {
+    shm_unlink(m_name.c_str());
+}
+
+void ShmCommunicator::barrier() {
+    auto&& gen = m_header->generation;
+    uint32_t cur = gen.load(std::memory_order_acquire);
+    if (m_header->nr_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+        m_size) {
+        m_header->nr_arrived.store(0, std::memory_order_relaxed);
+        gen.fetch_add(1, std::memory_order_release);
+        futex_wake_all(&gen);
+        return;
+    }
+    for (int i = 0; i < BARRIER_SPIN; ++i) {
+        if (gen.load(std::memory_order_acquire) != cur) {
+            return;
+        }
+        cpu_relax();
+    }
+    while (gen.load(std::memory_order_acquire) == cur) {
+        futex_wait(&gen, cur);
+    }
+}
+
+uint32_t ShmCommunicator::reduce_slots(size_t nr_elems, DType dtype,
+                                       ReduceOp op) {
+    bool pow2 = !(m_size & (m_size - 1));
+    auto algo = m_algo;
+    if (algo == AllReduceAlgo::AUTO) {
+        // the same bytes are moved by both, but recursive halving needs
+        // log(n) barriers instead of n - 1
+        algo = pow2 ? AllReduceAlgo::RECURSIVE_HALVING : AllReduceAlgo::RING;
+    }
+    if (algo == AllReduceAlgo::RECURSIVE_HALVING && pow2) {
+        return reduce_slots_recursive_halving(nr_elems, dtype, op);
+    }
+    return reduce_slots_ring(nr_elems, dtype, op);
+}
+
+uint32_t ShmCommunicator::reduce_slots_ring(size_t nr_elems, DType dtype,
+                                            ReduceOp op) {
+    // in step s, rank r accumulates segment r - 1 - s from the slot of rank
+    // r - 1, which has been accumulated by r - 1 in the previous step; no
+    // segment is read and written by different ranks in the same step
+    size_t esize = dtype.size();
+    uint32_t prev = (m_rank + m_size - 1) % m_size;
+    for (uint32_t s = 0; s + 1 < m_size; ++s) {
+        uint32_t seg = (m_rank + 2 * m_size - 1 - s) % m_size;
+        size_t begin = seg_begin(nr_elems, seg),
+               end = seg_begin(nr_elems, seg + 1);
+        reduce_to(slot(m_rank) + begin * esize, slot(prev) + begin * esize,
+                  end - begin, dtype, op);
+        barrier();
+    }
+    // segment j is completed by rank j - 1
+    return m_size - 1;
+}
+
+uint32_t ShmCommunicator::reduce_slots_recursive_halving(size_t nr_elems,
+                                                         DType dtype,
+                                                         ReduceOp op) {
+    // rank r and its partner r ^ d split their common range of segments and
+    // each accumulates the half it keeps from the slot of the other
+    size_t esize = dtype.size();
+    uint32_t lo = 0, hi = m_size;
+    for (uint32_t d = m_size / 2; d; d /= 2) {
+        uint32_t partner = m_rank ^ d, mid = (lo + hi) / 2;
+        if (m_rank & d) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+        size_t begin = seg_begin(nr_elems, lo), end = seg_begin(nr_elems, hi);
+        reduce_to(slot(m_rank) + begin * esize, slot(partner) + begin * esize,
+                  end - begin, dtype, op);
+        barrier();
+    }
+    // segment j is completed by rank j
+    return 0;
+}
+
+void ShmCommunicator::all_reduce(const void* sendbuff, void* recvbuff,
+                                 size_t len, DType dtype, ReduceOp op) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize;
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t nr = std::min(cap, len - off);
+        copy(slot(m_rank), src + off * esize, nr * esize);
+        barrier();
+        uint32_t shift = reduce_slots(nr, dtype, op);
+        for (uint32_t j = 0; j < m_size; ++j) {
+            size_t begin = seg_begin(nr, j), end = seg_begin(nr, j + 1);
+            copy(dst + (off + begin) * esize,
+                 slot((j + shift) % m_size) + begin * esize,
+                 (end - begin) * esize);
+        }
+        barrier();
+    }
+}
+
+void ShmCommunicator::reduce(const void* sendbuff, void* recvbuff,
+                             size_t len, DType dtype, ReduceOp op,
+                             uint32_t root) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize;
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t nr = std::min(cap, len - off);
+        copy(slot(m_rank), src + off * esize, nr * esize);
+        barrier();
+        uint32_t shift = reduce_slots(nr, dtype, op);
+        if (m_rank == root) {
+            for (uint32_t j = 0; j < m_size; ++j) {
+                size_t begin = seg_begin(nr, j), end = seg_begin(nr, j + 1);
+                copy(dst + (off + begin) * esize,
+                     slot((j + shift) % m_size) + begin * esize,
+                     (end - begin) * esize);
+            }
+        }
+        barrier();
+    }
+}
+
+void ShmCommunicator::broadcast(const void* sendbuff, void* recvbuff,
+                                size_t len, DType dtype, uint32_t root) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize;
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t bytes = std::min(cap, len - off) * esize;
+        if (m_rank == root) {
+            copy(slot(root), src + off * esize, bytes);
+        }
+        barrier();
+        copy(dst + off * esize, slot(root), bytes);
+        barrier();
+    }
+}
+
+void ShmCommunicator::all_gather(const void* sendbuff, void* recvbuff,
+                                 size_t len, DType dtype) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize;
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t bytes = std::min(cap, len - off) * esize;
+        copy(slot(m_rank), src + off * esize, bytes);
+        barrier();
+        for (uint32_t j = 0; j < m_size; ++j) {
+            copy(dst + (j * len + off) * esize, slot(j), bytes);
+        }
+        barrier();
+    }
+}
+
+void ShmCommunicator::reduce_scatter(const void* sendbuff, void* recvbuff,
+                                     size_t len, DType dtype, ReduceOp op) {
+    // stage the same part of the block for every rank, so that the segments
+    // of reduce_slots are exactly the blocks
+    size_t esize = dtype.size(), cap = m_slot_size / esize / m_size;
+    mgb_assert(cap, "slot of shm CollectiveComm is too small");
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t nr = std::min(cap, len - off);
+        for (uint32_t j = 0; j < m_size; ++j) {
+            copy(slot(m_rank) + j * nr * esize, src + (j * len + off) * esize,
+                 nr * esize);
+        }
+        barrier();
+        uint32_t shift = reduce_slots(nr * m_size, dtype, op);
+        copy(dst + off * esize,
+             slot((m_rank + shift) % m_size) + m_rank * nr * esize,
+             nr * esize);
+        barrier();
+    }
+}
+
+void ShmCommunicator::gather(const void* sendbuff, void* recvbuff, size_t len,
+                             DType dtype, uint32_t root) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize;
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t bytes = std::min(cap, len - off) * esize;
+        copy(slot(m_rank), src + off * esize, bytes);
+        barrier();
+        if (m_rank == root) {
+            for (uint32_t j = 0; j < m_size; ++j) {
+                copy(dst + (j * len + off) * esize, slot(j), bytes);
+            }
+        }
+        barrier();
+    }
+}
+
+void ShmCommunicator::scatter(const void* sendbuff, void* recvbuff,
+                              size_t len, DType dtype, uint32_t root) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize / m_size;
+    mgb_assert(cap, "slot of shm CollectiveComm is too small");
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t nr = std::min(cap, len - off);
+        if (m_rank == root) {
+            for (uint32_t j = 0; j < m_size; ++j) {
+                copy(slot(root) + j * nr * esize,
+                     src + (j * len + off) * esize, nr * esize);
+            }
+        }
+        barrier();
+        copy(dst + off * esize, slot(root) + m_rank * nr * esize, nr * esize);
+        barrier();
+    }
+}
+
+void ShmCommunicator::all_to_all(const void* sendbuff, void* recvbuff,
+                                 size_t len, DType dtype) {
+    size_t esize = dtype.size(), cap = m_slot_size / esize / m_size;
+    mgb_assert(cap, "slot of shm CollectiveComm is too small");
+    auto src = static_cast<const uint8_t*>(sendbuff);
+    auto dst = static_cast<uint8_t*>(recvbuff);
+    for (size_t off = 0; off < len; off += cap) {
+        size_t nr = std::min(cap, len - off);
+        for (uint32_t j = 0; j < m_size; ++j) {
+            copy(slot(m_rank) + j * nr * esize, src + (j * len + off) * esize,
+                 nr * esize);
+        }
+        barrier();
+        for (uint32_t j = 0; j < m_size; ++j) {
+            copy(dst + (j * len + off) * esize,
+                 slot(j) + m_rank * nr * esize, nr * esize);
+        }
+        barrier();
+    }
+}
+
+/* ================= ShmCommBuilder ================= */
+
+bool ShmCommBuilder::find(uint64_t hash,
+                          std::shared_ptr<ShmCommunicator>& comm) {
+    std::unique_lock<std::mutex> lk(m_map_mtx);
+    auto it = m_shm_comms.find(hash);
+    if (it != m_shm_comms.end()) {
+        comm = it->second;
+        return true;
+    }
+    return false;
+}
+
+void ShmCommBuilder::emplace(uint64_t hash,
+                             std::shared_ptr<ShmCommunicator> comm) {
+    std::unique_lock<std::mutex> lk(m_map_mtx);
+    m_shm_comms.emplace(hash, comm);
+}
+
+std::shared_ptr<ShmCommunicator> ShmCommBuilder::get_shm_comm(
+        uint64_t hash, std::string key, uint32_t size, uint32_t rank,
+        std::shared_ptr<mgb::opr::GroupClient> group_client) {
+    {
+        // singleton pattern
+        std::unique_lock<std::mutex> lk(sm_instance_mtx);
+        if (sm_instance == nullptr) {
+            sm_instance = new ShmCommBuilder();
+        }
+    }
+
+    std::shared_ptr<ShmCommunicator> comm;
+    if (!sm_instance->find(hash, comm)) {
+        static std::atomic<size_t> nr_created{0};
+        const uint32_t root = 0;
+        std::string name;
+        int port = 0;
+        if (rank == root) {
+            size_t slot_size = 4 << 20;
+            if (auto env = MGB_GETENV("MGB_SHM_COMM_SLOT_SIZE")) {
+                slot_size = std::stoull(env);
+            }
+            name = ssprintf("/mgb_shm_comm_%d_%zu", static_cast<int>(getpid()),
+                            nr_created++);
+            comm = std::make_shared<ShmCommunicator>(name, size, rank, true,
+                                                     slot_size);
+        }
+        // the name of the segment is sent as the address
+        group_client->bcast_addr(name, port, key + ":shm", size, rank, root);
+        if (rank != root) {
+            comm = std::make_shared<ShmCommunicator>(name, size, rank, false,
+                                                     0);
+        }
+        // wait for all the ranks to map the segment before removing its name
+        std::string dummy;
+        group_client->bcast_addr(dummy, port, key + ":shm_mapped", size, rank,
+                                 root);
+        if (rank == root) {
+            comm->unlink();
+        }
+        sm_instance->emplace(hash, comm);
+    }
+    return comm;
+}
+
+ShmCommBuilder* ShmCommBuilder::sm_instance = nullptr;
+
+std::mutex ShmCommBuilder::sm_instance_mtx;
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
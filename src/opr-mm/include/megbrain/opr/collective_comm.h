@@ -14,12 +14,22 @@
 #include "megbrain/graph.h"
 #include "megbrain/opr/param_defs.h"
 #include "megbrain/opr/group_manager.h"
+#include "megbrain/opr/shm_comm.h"
+#if MGB_ENABLE_OPR_MM
 #include "megray.h"
+#endif
 
 namespace mgb {
 namespace opr {
 
-//! collective communication between multiple CompNode on localhost
+/*!
+ * \brief collective communication between multiple CompNode on localhost
+ *
+ * CPU comp nodes always use ShmCommunicator regardless of the backend; each
+ * of them must have its own worker thread, and the graph must set mask 0b10
+ * in async_exec_level. Without MGB_ENABLE_OPR_MM (i.e. MegRay) only CPU comp
+ * nodes are supported.
+ */
 MGB_DEFINE_OPR_CLASS(CollectiveComm, cg::OutshapePureByInshapeOpr<>) // {
 public:
     class ModeTrait;
@@ -89,9 +99,11 @@ public:
 
     uint64_t pack_hash() const { return m_pack_hash; }
 
+#if MGB_ENABLE_OPR_MM
     std::shared_ptr<MegRay::Context> megray_ctx() const {
         return m_megray_ctx;
     }
+#endif
 
     VarNode* grad(VarNode* out_grad) const;
 
@@ -136,8 +148,12 @@ private:
     //! set in PackAllReduceScanPass and used in PackAllReduceReplacePass
     uint64_t m_pack_hash = 0;
 
+#if MGB_ENABLE_OPR_MM
     std::shared_ptr<MegRay::Context> m_megray_ctx;
     std::shared_ptr<MegRay::Communicator> m_megray_comm;
+#endif
+    //! used instead of m_megray_comm on CPU comp nodes
+    std::shared_ptr<ShmCommunicator> m_shm_comm;
     bool m_init = false;
     bool m_debug_mode = false;
 
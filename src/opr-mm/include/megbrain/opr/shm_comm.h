@@ -0,0 +1,154 @@
+/**
+ * \file src/opr-mm/include/megbrain/opr/shm_comm.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "megbrain/dtype.h"
+#include "megbrain/opr/group_manager.h"
+
+namespace mgb {
+namespace opr {
+
+/*!
+ * \brief collective communication between CPU comp nodes on one host through
+ *      POSIX shared memory
+ *
+ * All ranks map one shared memory segment which holds a barrier and a staging
+ * slot for each rank; data larger than a slot are processed in chunks. Ranks
+ * may live in different processes, or be different comp nodes of the same
+ * process, but each rank must run on its own thread since the barrier blocks.
+ *
+ * It does not depend on MegRay, so it is also built on Unix when distributed
+ * support is off.
+ */
+class ShmCommunicator {
+public:
+    enum class ReduceOp : uint32_t { SUM, MAX, MIN };
+
+    enum class AllReduceAlgo : uint32_t {
+        //! recursive halving if the number of ranks is a power of two
+        AUTO,
+        RING,
+        //! reduce scatter by recursive halving; needs 2^k ranks
+        RECURSIVE_HALVING,
+    };
+
+    /*!
+     * \param name name of the segment passed to shm_open
+     * \param create whether to create the segment, which should be done by
+     *      exactly one rank before the others open it
+     * \param slot_size bytes of the staging slot of each rank, only used when
+     *      creating the segment
+     */
+    ShmCommunicator(const std::string& name, uint32_t size, uint32_t rank,
+                    bool create, size_t slot_size);
+    ~ShmCommunicator();
+
+    //! remove the name of the segment; the memory is kept until unmapped
+    void unlink();
+
+    void all_reduce(const void* sendbuff, void* recvbuff, size_t len,
+                    DType dtype, ReduceOp op);
+
+    void reduce(const void* sendbuff, void* recvbuff, size_t len, DType dtype,
+                ReduceOp op, uint32_t root);
+
+    void broadcast(const void* sendbuff, void* recvbuff, size_t len,
+                   DType dtype, uint32_t root);
+
+    //! \p len is the number of elements sent by each rank
+    void all_gather(const void* sendbuff, void* recvbuff, size_t len,
+                    DType dtype);
+
+    //! \p len is the number of elements received by each rank
+    void reduce_scatter(const void* sendbuff, void* recvbuff, size_t len,
+                        DType dtype, ReduceOp op);
+
+    void gather(const void* sendbuff, void* recvbuff, size_t len, DType dtype,
+                uint32_t root);
+
+    void scatter(const void* sendbuff, void* recvbuff, size_t len,
+                 DType dtype, uint32_t root);
+
+    //! \p len is the number of elements sent to each rank
+    void all_to_all(const void* sendbuff, void* recvbuff, size_t len,
+                    DType dtype);
+
+    void set_all_reduce_algo(AllReduceAlgo algo) { m_algo = algo; }
+
+    uint32_t size() const { return m_size; }
+    uint32_t rank() const { return m_rank; }
+    size_t slot_size() const { return m_slot_size; }
+
+private:
+    struct Header;
+
+    void barrier();
+
+    uint8_t* slot(uint32_t rank) const {
+        return m_slots + m_slot_size * rank;
+    }
+
+    /*!
+     * \brief reduce the first \p nr_elems elements of all the slots in place,
+     *      so that segment j is reduced in the slot of rank
+     *      (j + shift) % size, where the returned shift depends on the
+     *      algorithm
+     */
+    uint32_t reduce_slots(size_t nr_elems, DType dtype, ReduceOp op);
+
+    uint32_t reduce_slots_ring(size_t nr_elems, DType dtype, ReduceOp op);
+
+    uint32_t reduce_slots_recursive_halving(size_t nr_elems, DType dtype,
+                                            ReduceOp op);
+
+    size_t seg_begin(size_t nr_elems, uint32_t seg) const {
+        return nr_elems * seg / m_size;
+    }
+
+    const std::string m_name;
+    const uint32_t m_size, m_rank;
+    AllReduceAlgo m_algo = AllReduceAlgo::AUTO;
+    int m_fd = -1;
+    void* m_addr = nullptr;
+    size_t m_map_size = 0, m_slot_size = 0;
+    Header* m_header = nullptr;
+    uint8_t* m_slots = nullptr;
+};
+
+/*!
+ * create or open the shared memory communicators, using the GroupClient for
+ * rendezvous; use hash for deduplication
+ */
+class ShmCommBuilder {
+    private:
+        bool find(uint64_t hash, std::shared_ptr<ShmCommunicator>& comm);
+        void emplace(uint64_t hash, std::shared_ptr<ShmCommunicator> comm);
+
+        std::unordered_map<uint64_t, std::shared_ptr<ShmCommunicator>> m_shm_comms;
+        std::mutex m_map_mtx;
+
+        static ShmCommBuilder* sm_instance;
+        static std::mutex sm_instance_mtx;
+
+    public:
+        static std::shared_ptr<ShmCommunicator> get_shm_comm(
+                uint64_t hash, std::string key, uint32_t size, uint32_t rank,
+                std::shared_ptr<mgb::opr::GroupClient> group_client);
+};
+
+}  // namespace opr
+}  // namespace mgb
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
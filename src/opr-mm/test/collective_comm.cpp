@@ -1800,3 +1800,132 @@ TEST(TestOprCollectiveComm, AllToAllWithGradThisNodeOnly) {
     MGB_ASSERT_TENSOR_EQ(host_expect_grad0, host_grad0);
     MGB_ASSERT_TENSOR_EQ(host_expect_grad1, host_grad1);
 }
+
+TEST(TestOprCollectiveComm, AllReduceCPU) {
+    auto run_mode = [](const Mode mode) {
+        auto cn0 = CompNode::load("cpu0");
+        auto cn1 = CompNode::load("cpu1");
+        auto cn2 = CompNode::load("cpu2");
+
+        HostTensorGenerator<> gen;
+        auto host_x0 = gen({28, 28}), host_x1 = gen({28, 28}),
+             host_x2 = gen({28, 28});
+        HostTensorND host_y0, host_y1, host_y2, host_y_expect;
+
+        auto client = std::make_shared<test::MockGroupClient>();
+        auto graph = ComputingGraph::make();
+        graph->options().async_exec_level = 0b10;
+
+        auto x0 = opr::Host2DeviceCopy::make(*graph, host_x0, cn0);
+        auto x1 = opr::Host2DeviceCopy::make(*graph, host_x1, cn1);
+        auto x2 = opr::Host2DeviceCopy::make(*graph, host_x2, cn2);
+
+        SymbolVarArray ys;
+        for (auto x : {x0, x1, x2}) {
+            ys.push_back(opr::CollectiveComm::make(
+                    {x}, graph.get(), "all_reduce_cpu", 3, false, ys.size(),
+                    false, client, {mode}, dtype::Float32(), "nccl")[0]);
+        }
+        auto y_expect = make_all_reduce_output(
+                mode, {make_all_reduce_output(
+                               mode, {x0, opr::Copy::make(x1, cn0)}),
+                       opr::Copy::make(x2, cn0)});
+
+        auto func =
+                graph->compile({make_callback_copy(ys[0], host_y0),
+                                make_callback_copy(ys[1], host_y1),
+                                make_callback_copy(ys[2], host_y2),
+                                make_callback_copy(y_expect, host_y_expect)});
+        func->execute();
+
+        MGB_ASSERT_TENSOR_NEAR(host_y_expect, host_y0, 1e-6);
+        MGB_ASSERT_TENSOR_NEAR(host_y_expect, host_y1, 1e-6);
+        MGB_ASSERT_TENSOR_NEAR(host_y_expect, host_y2, 1e-6);
+    };
+
+    run_mode(Mode::ALL_REDUCE_MAX);
+    run_mode(Mode::ALL_REDUCE_MIN);
+    run_mode(Mode::ALL_REDUCE_SUM);
+}
+
+TEST(TestOprCollectiveComm, AllGatherAndReduceScatterSumCPU) {
+    auto cn0 = CompNode::load("cpu0");
+    auto cn1 = CompNode::load("cpu1");
+
+    HostTensorGenerator<> gen;
+    auto host_x0 = gen({28, 28});
+    auto host_x1 = gen({28, 28});
+    HostTensorND host_y0, host_y1, host_y_expect, host_z0, host_z1,
+            host_z0_expect, host_z1_expect;
+
+    auto client = std::make_shared<test::MockGroupClient>();
+    auto graph = ComputingGraph::make();
+    graph->options().async_exec_level = 0b10;
+
+    auto x0 = opr::Host2DeviceCopy::make(*graph, host_x0, cn0);
+    auto x1 = opr::Host2DeviceCopy::make(*graph, host_x1, cn1);
+    auto x1c = opr::Copy::make(x1, cn0);
+
+    auto y0 = opr::CollectiveComm::make(
+            {x0}, graph.get(), "all_gather_cpu", 2, false, 0, false, client,
+            {Mode::ALL_GATHER}, dtype::Float32(), "nccl")[0];
+    auto y1 = opr::CollectiveComm::make(
+            {x1}, graph.get(), "all_gather_cpu", 2, false, 1, false, client,
+            {Mode::ALL_GATHER}, dtype::Float32(), "nccl")[0];
+    auto y_expect = opr::Concat::make({x0, x1c}, 0);
+
+    auto z0 = opr::CollectiveComm::make(
+            {x0}, graph.get(), "reduce_scatter_sum_cpu", 2, false, 0, false,
+            client, {Mode::REDUCE_SCATTER_SUM}, dtype::Float32(), "nccl")[0];
+    auto z1 = opr::CollectiveComm::make(
+            {x1}, graph.get(), "reduce_scatter_sum_cpu", 2, false, 1, false,
+            client, {Mode::REDUCE_SCATTER_SUM}, dtype::Float32(), "nccl")[0];
+    auto z_expect = make_reduce_scatter_sum_output({x0, x1c});
+
+    auto func = graph->compile(
+            {make_callback_copy(y0, host_y0), make_callback_copy(y1, host_y1),
+             make_callback_copy(y_expect, host_y_expect),
+             make_callback_copy(z0, host_z0), make_callback_copy(z1, host_z1),
+             make_callback_copy(z_expect[0], host_z0_expect),
+             make_callback_copy(z_expect[1], host_z1_expect)});
+    func->execute();
+
+    MGB_ASSERT_TENSOR_EQ(host_y_expect, host_y0);
+    MGB_ASSERT_TENSOR_EQ(host_y_expect, host_y1);
+    MGB_ASSERT_TENSOR_EQ(host_z0_expect, host_z0);
+    MGB_ASSERT_TENSOR_EQ(host_z1_expect, host_z1);
+}
+
+TEST(TestOprCollectiveComm, BroadcastCPU) {
+    auto cn0 = CompNode::load("cpu0");
+    auto cn1 = CompNode::load("cpu1");
+
+    HostTensorGenerator<> gen;
+    auto host_x0 = gen({28, 28});
+    HostTensorND host_y0, host_y1;
+
+    auto client = std::make_shared<test::MockGroupClient>();
+    auto graph = ComputingGraph::make();
+    graph->options().async_exec_level = 0b10;
+
+    auto x0 = opr::Host2DeviceCopy::make(*graph, host_x0, cn0);
+    auto y0 = opr::CollectiveComm::make({x0}, graph.get(), "broadcast_cpu", 2,
+                                        true, 0, false, client,
+                                        {Mode::BROADCAST}, dtype::Float32(),
+                                        "nccl")[0];
+    auto y_dev =
+            std::make_shared<DeviceTensorND>(DeviceTensorND()
+                                                     .comp_node(cn1)
+                                                     .dtype(dtype::Float32())
+                                                     .resize(host_x0->shape()));
+    auto y1 = opr::CollectiveComm::make(
+            {}, graph.get(), "broadcast_cpu", 2, false, 1, false, client,
+            {y_dev}, {Mode::BROADCAST}, dtype::Float32(), "nccl", {cn1})[0];
+
+    auto func = graph->compile(
+            {make_callback_copy(y0, host_y0), make_callback_copy(y1, host_y1)});
+    func->execute();
+
+    MGB_ASSERT_TENSOR_EQ(*host_x0, host_y0);
+    MGB_ASSERT_TENSOR_EQ(*host_x0, host_y1);
+}
@@ -0,0 +1,187 @@
+/**
+ * \file src/opr-mm/test/shm_comm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include "megbrain/opr/shm_comm.h"
+#include "megbrain/test/helper.h"
+#include "mock_client.h"
+
+#include <unistd.h>
+#include <thread>
+
+using namespace mgb;
+using opr::ShmCommunicator;
+
+namespace {
+
+using Algo = ShmCommunicator::AllReduceAlgo;
+using ReduceOp = ShmCommunicator::ReduceOp;
+
+/*!
+ * run \p func on a thread for each rank of a new communicator
+ *
+ * \param func (communicator, rank)
+ */
+void run_ranks(uint32_t size, size_t slot_size,
+               thin_function<void(ShmCommunicator&, uint32_t)> func) {
+    static int nr_comms = 0;
+    auto name = ssprintf("/mgb_shm_comm_test_%d_%d",
+                         static_cast<int>(getpid()), nr_comms++);
+    std::vector<std::unique_ptr<ShmCommunicator>> comms;
+    comms.emplace_back(
+            new ShmCommunicator(name, size, 0, true, slot_size));
+    for (uint32_t i = 1; i < size; ++i) {
+        comms.emplace_back(new ShmCommunicator(name, size, i, false, 0));
+    }
+    comms[0]->unlink();
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < size; ++i) {
+        workers.emplace_back([&, i]() { func(*comms[i], i); });
+    }
+    for (auto&& i : workers) {
+        i.join();
+    }
+}
+
+std::vector<std::vector<float>> gen_data(uint32_t size, size_t len) {
+    HostTensorGenerator<> gen;
+    std::vector<std::vector<float>> ret(size);
+    for (auto&& i : ret) {
+        auto host = gen({len});
+        i.assign(host->ptr<float>(), host->ptr<float>() + len);
+    }
+    return ret;
+}
+
+}  // anonymous namespace
+
+TEST(TestShmCommunicator, AllReduce) {
+    // ring for 3 and 5 ranks, and both algorithms for 4; the small slots
+    // split the data into chunks
+    for (uint32_t size : {1u, 3u, 4u, 5u})
+        for (auto algo : {Algo::RING, Algo::RECURSIVE_HALVING})
+            for (size_t len : {1, 33, 1000})
+                for (auto op : {ReduceOp::SUM, ReduceOp::MAX}) {
+                    auto inp = gen_data(size, len);
+                    auto out = gen_data(size, len);
+                    run_ranks(size, 256, [&](ShmCommunicator& comm,
+                                             uint32_t rank) {
+                        comm.set_all_reduce_algo(algo);
+                        comm.all_reduce(inp[rank].data(), out[rank].data(),
+                                        len, dtype::Float32(), op);
+                    });
+                    for (size_t i = 0; i < len; ++i) {
+                        float expect = inp[0][i];
+                        for (uint32_t r = 1; r < size; ++r) {
+                            expect = op == ReduceOp::SUM
+                                             ? expect + inp[r][i]
+                                             : std::max(expect, inp[r][i]);
+                        }
+                        for (uint32_t r = 0; r < size; ++r) {
+                            ASSERT_NEAR(expect, out[r][i], 1e-5)
+                                    << "size=" << size << " len=" << len
+                                    << " rank=" << r << " i=" << i;
+                        }
+                    }
+                }
+}
+
+TEST(TestShmCommunicator, AllReduceInt32InPlace) {
+    constexpr uint32_t size = 4;
+    constexpr size_t len = 1001;
+    std::vector<std::vector<int>> data(size, std::vector<int>(len));
+    for (uint32_t r = 0; r < size; ++r) {
+        for (size_t i = 0; i < len; ++i) {
+            data[r][i] = static_cast<int>(i * (r + 1));
+        }
+    }
+    run_ranks(size, 512, [&](ShmCommunicator& comm, uint32_t rank) {
+        comm.all_reduce(data[rank].data(), data[rank].data(), len,
+                        dtype::Int32(), ReduceOp::SUM);
+    });
+    for (uint32_t r = 0; r < size; ++r) {
+        for (size_t i = 0; i < len; ++i) {
+            ASSERT_EQ(static_cast<int>(i * 10), data[r][i]);
+        }
+    }
+}
+
+TEST(TestShmCommunicator, ReduceScatterAndAllGather) {
+    for (uint32_t size : {2u, 3u}) {
+        constexpr size_t len = 100;
+        auto inp = gen_data(size, len * size);
+        auto scattered = gen_data(size, len);
+        auto gathered = gen_data(size, len * size);
+        run_ranks(size, 128, [&](ShmCommunicator& comm, uint32_t rank) {
+            comm.reduce_scatter(inp[rank].data(), scattered[rank].data(), len,
+                                dtype::Float32(), ReduceOp::SUM);
+            comm.all_gather(scattered[rank].data(), gathered[rank].data(),
+                            len, dtype::Float32());
+        });
+        for (size_t i = 0; i < len * size; ++i) {
+            float expect = 0;
+            for (uint32_t r = 0; r < size; ++r) {
+                expect += inp[r][i];
+            }
+            for (uint32_t r = 0; r < size; ++r) {
+                ASSERT_NEAR(expect, gathered[r][i], 1e-5);
+                if (i / len == r) {
+                    ASSERT_EQ(gathered[r][i], scattered[r][i % len]);
+                }
+            }
+        }
+    }
+}
+
+TEST(TestShmCommunicator, Broadcast) {
+    constexpr uint32_t size = 3, root = 2;
+    constexpr size_t len = 500;
+    auto data = gen_data(size, len);
+    auto expect = data[root];
+    run_ranks(size, 256, [&](ShmCommunicator& comm, uint32_t rank) {
+        comm.broadcast(data[rank].data(), data[rank].data(), len,
+                       dtype::Float32(), root);
+    });
+    for (uint32_t r = 0; r < size; ++r) {
+        ASSERT_EQ(expect, data[r]);
+    }
+}
+
+TEST(TestShmCommunicator, Builder) {
+    constexpr uint32_t size = 2;
+    constexpr size_t len = 300;
+    auto client = std::make_shared<test::MockGroupClient>();
+    auto data = gen_data(size, len);
+    std::vector<std::vector<float>> out(size, std::vector<float>(len));
+    std::vector<std::thread> workers;
+    for (uint32_t r = 0; r < size; ++r) {
+        workers.emplace_back([&, r]() {
+            // the ranks are in one process, so they need different hashes
+            uint64_t hash = 0x5a3c0 + r;
+            auto comm = opr::ShmCommBuilder::get_shm_comm(
+                    hash, "shm_builder", size, r, client);
+            ASSERT_EQ(r, comm->rank());
+            ASSERT_EQ(comm, opr::ShmCommBuilder::get_shm_comm(
+                                    hash, "shm_builder", size, r, client));
+            comm->all_reduce(data[r].data(), out[r].data(), len,
+                             dtype::Float32(), ReduceOp::SUM);
+        });
+    }
+    for (auto&& i : workers) {
+        i.join();
+    }
+    for (uint32_t r = 0; r < size; ++r) {
+        for (size_t i = 0; i < len; ++i) {
+            ASSERT_FLOAT_EQ(data[0][i] + data[1][i], out[r][i]);
+        }
+    }
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
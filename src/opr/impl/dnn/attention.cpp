@@ -0,0 +1,88 @@
+/**
+ * \file src/opr/impl/dnn/attention.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/opr/dnn/attention.h"
+
+#include "../internal/megdnn_opr_wrapper.inl"
+
+using namespace mgb;
+using namespace opr;
+
+/* ==================== AttentionForward  ==================== */
+MGB_DYN_TYPE_OBJ_FINAL_IMPL(AttentionForward);
+
+AttentionForward::AttentionForward(VarNode* q, VarNode* k, VarNode* v,
+                                   VarNode* mask, const Param& param,
+                                   const OperatorNodeConfig& config)
+        : Super{q->owner_graph(), config, "attention", {q, k, v, mask}} {
+    init_megdnn_opr(*this, param);
+    add_input({q, k, v, mask});
+}
+
+AttentionForward::AttentionForward(VarNode* q, VarNode* k, VarNode* v,
+                                   const Param& param,
+                                   const OperatorNodeConfig& config)
+        : Super{q->owner_graph(), config, "attention", {q, k, v}} {
+    init_megdnn_opr(*this, param);
+    add_input({q, k, v});
+}
+
+SymbolVar AttentionForward::make(SymbolVar q, SymbolVar k, SymbolVar v,
+                                 SymbolVar mask, const Param& param,
+                                 const OperatorNodeConfig& config) {
+    return q.insert_single_output_opr<AttentionForward>(
+            q.node(), k.node(), v.node(), mask.node(), param, config);
+}
+
+SymbolVar AttentionForward::make(SymbolVar q, SymbolVar k, SymbolVar v,
+                                 const Param& param,
+                                 const OperatorNodeConfig& config) {
+    return q.insert_single_output_opr<AttentionForward>(
+            q.node(), k.node(), v.node(), param, config);
+}
+
+void AttentionForward::get_output_var_shape(
+        const TensorShapeArray& inp_shape, TensorShapeArray& out_shape) const {
+    TensorLayout dst;
+    megdnn_opr()->deduce_layout({inp_shape[0], input(0)->dtype()},
+                                {inp_shape[1], input(1)->dtype()},
+                                {inp_shape[2], input(2)->dtype()}, {}, dst);
+    out_shape[0] = dst;
+}
+
+size_t AttentionForward::get_workspace_size_bytes(
+        const TensorShapeArray& input_shapes,
+        const TensorShapeArray& output_shapes) const {
+    TensorLayout mask;
+    if (input().size() == 4) {
+        mask = {input_shapes[3], input(3)->dtype()};
+    }
+    return megdnn_opr()->get_workspace_in_bytes(
+            {input_shapes[0], input(0)->dtype()},
+            {input_shapes[1], input(1)->dtype()},
+            {input_shapes[2], input(2)->dtype()}, mask,
+            {output_shapes[0], output(0)->dtype()});
+}
+
+void AttentionForward::scn_do_execute() {
+    megdnn::TensorND mask;
+    if (input().size() == 4) {
+        mask = input(3)->dev_tensor().as_megdnn();
+    }
+    megdnn_opr()->exec(input(0)->dev_tensor().as_megdnn(),
+                       input(1)->dev_tensor().as_megdnn(),
+                       input(2)->dev_tensor().as_megdnn(), mask,
+                       output(0)->dev_tensor().as_megdnn(),
+                       intl::get_megdnn_workspace_from_var(output().back()));
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
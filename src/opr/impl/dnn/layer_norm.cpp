@@ -0,0 +1,254 @@
+/**
+ * \file src/opr/impl/dnn/layer_norm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/opr/dnn/layer_norm.h"
+#include "megbrain/graph/grad_impl.h"
+
+#include "../internal/megdnn_opr_wrapper.inl"
+
+using namespace mgb;
+using namespace opr;
+
+/* ==================== LayerNormForward  ==================== */
+MGB_DYN_TYPE_OBJ_FINAL_IMPL(LayerNormForward);
+
+LayerNormForward::LayerNormForward(VarNode* data, VarNode* weight,
+                                   VarNode* bias, const Param& param,
+                                   const OperatorNodeConfig& config)
+        : Super{data->owner_graph(), config, "layer_norm",
+                {data, weight, bias}} {
+    mgb_assert(param.affine, "weight and bias are given without affine");
+    init_megdnn_opr(*this, param);
+    add_input({data, weight, bias});
+}
+
+LayerNormForward::LayerNormForward(VarNode* data, const Param& param,
+                                   const OperatorNodeConfig& config)
+        : Super{data->owner_graph(), config, "layer_norm", {data}} {
+    mgb_assert(!param.affine, "weight and bias are required by affine");
+    init_megdnn_opr(*this, param);
+    add_input({data});
+}
+
+SymbolVarArray LayerNormForward::make(SymbolVar data, SymbolVar weight,
+                                      SymbolVar bias, const Param& param,
+                                      const OperatorNodeConfig& config) {
+    return cg::to_symbol_var_array(
+            data.node()
+                    ->owner_graph()
+                    ->insert_opr(std::make_unique<LayerNormForward>(
+                            data.node(), weight.node(), bias.node(), param,
+                            config))
+                    ->output());
+}
+
+SymbolVarArray LayerNormForward::make(SymbolVar data, const Param& param,
+                                      const OperatorNodeConfig& config) {
+    return cg::to_symbol_var_array(
+            data.node()
+                    ->owner_graph()
+                    ->insert_opr(std::make_unique<LayerNormForward>(
+                            data.node(), param, config))
+                    ->output());
+}
+
+void LayerNormForward::get_output_var_shape(
+        const TensorShapeArray& inp_shape, TensorShapeArray& out_shape) const {
+    TensorLayout dst, mean, rstd;
+    TensorLayout data{inp_shape[0], input(0)->dtype()};
+    megdnn_opr()->deduce_layout(data, {}, {}, dst, mean, rstd);
+    out_shape[0] = dst;
+    out_shape[1] = mean;
+    out_shape[2] = rstd;
+}
+
+size_t LayerNormForward::get_workspace_size_bytes(
+        const TensorShapeArray& input_shapes,
+        const TensorShapeArray& output_shapes) const {
+    TensorLayout weight, bias;
+    if (param().affine) {
+        weight = {input_shapes[1], input(1)->dtype()};
+        bias = {input_shapes[2], input(2)->dtype()};
+    }
+    return megdnn_opr()->get_workspace_in_bytes(
+            {input_shapes[0], input(0)->dtype()}, weight, bias,
+            {output_shapes[0], output(0)->dtype()},
+            {output_shapes[1], output(1)->dtype()},
+            {output_shapes[2], output(2)->dtype()});
+}
+
+void LayerNormForward::init_output_dtype() {
+    output(0)->dtype(input(0)->dtype());
+    output(1)->dtype(dtype::Float32());
+    output(2)->dtype(dtype::Float32());
+}
+
+void LayerNormForward::scn_do_execute() {
+    megdnn::TensorND weight, bias;
+    if (param().affine) {
+        weight = input(1)->dev_tensor().as_megdnn();
+        bias = input(2)->dev_tensor().as_megdnn();
+    }
+    megdnn_opr()->exec(input(0)->dev_tensor().as_megdnn(), weight, bias,
+                       output(0)->dev_tensor().as_megdnn(),
+                       output(1)->dev_tensor().as_megdnn(),
+                       output(2)->dev_tensor().as_megdnn(),
+                       intl::get_megdnn_workspace_from_var(output().back()));
+}
+
+#if MGB_ENABLE_GRAD
+MGB_IMPL_OPR_GRAD(LayerNormForward) {
+    auto&& p = opr.param();
+    VarNodeArray ret(opr.input().size(), nullptr);
+    // mean and rstd are only saved for the backward pass, and their grads are
+    // not propagated
+    if (!out_grad[0]) {
+        return ret;
+    }
+    SymbolVarArray grad;
+    if (p.affine) {
+        grad = LayerNormBackward::make(out_grad[0], opr.input(0),
+                                       opr.input(1), opr.output(1),
+                                       opr.output(2), p);
+    } else {
+        grad = LayerNormBackward::make(out_grad[0], opr.input(0),
+                                       opr.output(1), opr.output(2), p);
+    }
+    for (size_t i = 0; i < ret.size(); ++i) {
+        ret[i] = grad[i].node();
+    }
+    return ret;
+}
+#endif
+
+/* ==================== LayerNormBackward  ==================== */
+MGB_DYN_TYPE_OBJ_FINAL_IMPL(LayerNormBackward);
+
+LayerNormBackward::LayerNormBackward(VarNode* diff, VarNode* data,
+                                     VarNode* weight, VarNode* mean,
+                                     VarNode* rstd, const Param& param,
+                                     const OperatorNodeConfig& config)
+        : Super({data->owner_graph(),
+                 config,
+                 "layer_norm_bwd",
+                 {diff, data, weight, mean, rstd}},
+                1, true) {
+    mgb_assert(param.affine, "weight is given without affine");
+    init_megdnn_opr(*this, param);
+    add_input({diff, data, weight, mean, rstd});
+}
+
+LayerNormBackward::LayerNormBackward(VarNode* diff, VarNode* data,
+                                     VarNode* mean, VarNode* rstd,
+                                     const Param& param,
+                                     const OperatorNodeConfig& config)
+        : Super({data->owner_graph(),
+                 config,
+                 "layer_norm_bwd",
+                 {diff, data, mean, rstd}},
+                1, true) {
+    mgb_assert(!param.affine, "weight is required by affine");
+    init_megdnn_opr(*this, param);
+    add_input({diff, data, mean, rstd});
+    auto mark_empty_var = [&](VarNode* var) {
+        var->add_flag(VarNode::Flag::ALLOW_EMPTY_SHAPE)
+                .add_flag(VarNode::Flag::VOLATILE_CONTENT);
+    };
+    mark_empty_var(output(1));
+    mark_empty_var(output(2));
+}
+
+SymbolVarArray LayerNormBackward::make(SymbolVar diff, SymbolVar data,
+                                       SymbolVar weight, SymbolVar mean,
+                                       SymbolVar rstd, const Param& param,
+                                       const OperatorNodeConfig& config) {
+    return cg::to_symbol_var_array(
+            data.node()
+                    ->owner_graph()
+                    ->insert_opr(std::make_unique<LayerNormBackward>(
+                            diff.node(), data.node(), weight.node(),
+                            mean.node(), rstd.node(), param, config))
+                    ->output());
+}
+
+SymbolVarArray LayerNormBackward::make(SymbolVar diff, SymbolVar data,
+                                       SymbolVar mean, SymbolVar rstd,
+                                       const Param& param,
+                                       const OperatorNodeConfig& config) {
+    return cg::to_symbol_var_array(
+            data.node()
+                    ->owner_graph()
+                    ->insert_opr(std::make_unique<LayerNormBackward>(
+                            diff.node(), data.node(), mean.node(), rstd.node(),
+                            param, config))
+                    ->output());
+}
+
+void LayerNormBackward::init_output_static_infer_desc() {
+    using namespace cg::static_infer;
+    auto&& mgr = owner_graph()->static_infer_manager();
+    mgr.register_shape_infer(output(0), ShapeInferDesc::make_identity(input(1)));
+    if (param().affine) {
+        mgr.register_shape_infer(output(1),
+                                 ShapeInferDesc::make_identity(input(2)));
+        mgr.register_shape_infer(output(2),
+                                 ShapeInferDesc::make_identity(input(2)));
+    } else {
+        mgr.register_shape_infer(output(1), ShapeInferDesc::make_const({0}));
+        mgr.register_shape_infer(output(2), ShapeInferDesc::make_const({0}));
+    }
+    this->init_output_static_infer_desc_workspace(
+            intl::AutoAddWorkspaceNeedLimitGetter<
+                    megdnn::LayerNormBackward>::val);
+}
+
+void LayerNormBackward::init_output_dtype() {
+    output(0)->dtype(input(1)->dtype());
+    output(1)->dtype(input(1)->dtype());
+    output(2)->dtype(input(1)->dtype());
+}
+
+size_t LayerNormBackward::get_workspace_size_bytes(
+        const TensorShapeArray& input_shapes,
+        const TensorShapeArray& output_shapes) const {
+    size_t stat_idx = param().affine ? 3 : 2;
+    TensorLayout weight, dweight, dbias;
+    if (param().affine) {
+        weight = {input_shapes[2], input(2)->dtype()};
+        dweight = {output_shapes[1], output(1)->dtype()};
+        dbias = {output_shapes[2], output(2)->dtype()};
+    }
+    return megdnn_opr()->get_workspace_in_bytes(
+            {input_shapes[0], input(0)->dtype()},
+            {input_shapes[1], input(1)->dtype()}, weight,
+            {input_shapes[stat_idx], input(stat_idx)->dtype()},
+            {input_shapes[stat_idx + 1], input(stat_idx + 1)->dtype()},
+            {output_shapes[0], output(0)->dtype()}, dweight, dbias);
+}
+
+void LayerNormBackward::scn_do_execute() {
+    size_t stat_idx = param().affine ? 3 : 2;
+    megdnn::TensorND weight, dweight, dbias;
+    if (param().affine) {
+        weight = input(2)->dev_tensor().as_megdnn();
+        dweight = output(1)->dev_tensor().as_megdnn();
+        dbias = output(2)->dev_tensor().as_megdnn();
+    }
+    megdnn_opr()->exec(input(0)->dev_tensor().as_megdnn(),
+                       input(1)->dev_tensor().as_megdnn(), weight,
+                       input(stat_idx)->dev_tensor().as_megdnn(),
+                       input(stat_idx + 1)->dev_tensor().as_megdnn(),
+                       output(0)->dev_tensor().as_megdnn(), dweight, dbias,
+                       intl::get_megdnn_workspace_from_var(output().back()));
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -625,4 +625,26 @@ SymbolVar DctChannelSelectForward::make(SymbolVar src, SymbolVar mask_offset,
 
 MEGDNN_OPR_INIT1(DctChannelSelectForward, "dct_channel_select")
 
+/* ======================= ImagePreprocessForward ======================= */
+
+namespace mgb {
+namespace opr {
+namespace intl {
+template <>
+struct MegDNNOprInitPostCtor<ImagePreprocessForward> {
+    static void apply(cg::OperatorNodeBase& opr) {
+        if (opr.config().output_dtype().valid()) {
+            opr.output(0)->dtype(opr.config().output_dtype());
+        } else {
+            opr.output(0)->dtype(dtype::Float32());
+        }
+    }
+};
+}  // namespace intl
+}  // namespace opr
+}  // namespace mgb
+
+MGB_DYN_TYPE_OBJ_FINAL_IMPL(ImagePreprocessForward);
+MEGDNN_OPR_INIT1(ImagePreprocessForward, "image_preprocess")
+
 // vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
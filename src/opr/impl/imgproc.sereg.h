@@ -194,6 +194,8 @@ MGB_SEREG_OPR(ResizeV2, 2);
 
 using DctChannelSelectV1 = opr::DctChannelSelect;
 MGB_SEREG_OPR(DctChannelSelectV1, 0);
+
+MGB_SEREG_OPR(ImagePreprocess, 1);
 }  // namespace opr
 
 
@@ -3,54 +3,233 @@
 #include <algorithm>
 #include <cstring>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MGB_NMS_AVX2 1
+#define MGB_NMS_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+#define MGB_NMS_AVX2 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MGB_NMS_SSE 1
+#include <emmintrin.h>
+#else
+#define MGB_NMS_SSE 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MGB_NMS_NEON 1
+#include <arm_neon.h>
+#else
+#define MGB_NMS_NEON 0
+#endif
+
 namespace {
-struct Box {
-    float x0, y0, x1, y1;
+//! the kept arrays start at multiples of this number of elements
+constexpr size_t KEPT_ALIGN = 16;
+
+//! boxes kept so far, in SoA layout
+struct KeptSet {
+    float *x0, *y0, *x1, *y1, *area;
+    int32_t* cls;
+    size_t size;
 };
 
-bool box_iou(Box a, Box b, float thresh) {
+struct Candidate {
+    float x0, y0, x1, y1, area;
+    int32_t cls;
+};
+
+size_t kept_capacity(size_t nr_boxes, size_t max_output) {
+    size_t cap = std::min(nr_boxes, max_output);
+    return (cap + KEPT_ALIGN - 1) / KEPT_ALIGN * KEPT_ALIGN;
+}
+
+//! whether any kept box starting from \p begin overlaps with \p c
+bool any_overlap_naive(const KeptSet& kept, const Candidate& c, float thresh,
+                       size_t begin) {
     using std::max;
     using std::min;
-    float left = max(a.x0, b.x0), right = min(a.x1, b.x1);
-    float top = max(a.y0, b.y0), bottom = min(a.y1, b.y1);
-    float width = max(right - left, 0.f),
-          height = max(bottom - top, 0.f);
-    float interS = width * height;
-    float Sa = (a.x1 - a.x0) * (a.y1 - a.y0);
-    float Sb = (b.x1 - b.x0) * (b.y1 - b.y0);
-    return interS > (Sa + Sb - interS) * thresh;
+    for (size_t i = begin; i < kept.size; ++i) {
+        float left = max(c.x0, kept.x0[i]), right = min(c.x1, kept.x1[i]);
+        float top = max(c.y0, kept.y0[i]), bottom = min(c.y1, kept.y1[i]);
+        float width = max(right - left, 0.f),
+              height = max(bottom - top, 0.f);
+        float interS = width * height;
+        if (interS > (c.area + kept.area[i] - interS) * thresh &&
+            c.cls == kept.cls[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if !MGB_NMS_SSE && !MGB_NMS_NEON
+bool any_overlap_scalar(const KeptSet& kept, const Candidate& c,
+                        float thresh) {
+    return any_overlap_naive(kept, c, thresh, 0);
+}
+#endif
+
+#if MGB_NMS_AVX2
+MGB_NMS_TARGET_AVX2 bool any_overlap_avx2(const KeptSet& kept,
+                                          const Candidate& c, float thresh) {
+    __m256 cx0 = _mm256_set1_ps(c.x0), cy0 = _mm256_set1_ps(c.y0),
+           cx1 = _mm256_set1_ps(c.x1), cy1 = _mm256_set1_ps(c.y1),
+           carea = _mm256_set1_ps(c.area), vthresh = _mm256_set1_ps(thresh),
+           zero = _mm256_setzero_ps();
+    __m256i ccls = _mm256_set1_epi32(c.cls);
+    size_t i = 0;
+    for (; i + 8 <= kept.size; i += 8) {
+        __m256 left = _mm256_max_ps(cx0, _mm256_loadu_ps(kept.x0 + i)),
+               right = _mm256_min_ps(cx1, _mm256_loadu_ps(kept.x1 + i)),
+               top = _mm256_max_ps(cy0, _mm256_loadu_ps(kept.y0 + i)),
+               bottom = _mm256_min_ps(cy1, _mm256_loadu_ps(kept.y1 + i));
+        __m256 width = _mm256_max_ps(_mm256_sub_ps(right, left), zero),
+               height = _mm256_max_ps(_mm256_sub_ps(bottom, top), zero);
+        __m256 inter = _mm256_mul_ps(width, height);
+        __m256 uni = _mm256_sub_ps(
+                _mm256_add_ps(carea, _mm256_loadu_ps(kept.area + i)), inter);
+        __m256 overlap = _mm256_cmp_ps(inter, _mm256_mul_ps(uni, vthresh),
+                                       _CMP_GT_OQ);
+        __m256i same_cls = _mm256_cmpeq_epi32(
+                ccls, _mm256_loadu_si256(
+                              reinterpret_cast<const __m256i*>(kept.cls + i)));
+        if (_mm256_movemask_ps(
+                    _mm256_and_ps(overlap, _mm256_castsi256_ps(same_cls)))) {
+            return true;
+        }
+    }
+    return any_overlap_naive(kept, c, thresh, i);
+}
+#endif
+
+#if MGB_NMS_SSE
+bool any_overlap_sse(const KeptSet& kept, const Candidate& c, float thresh) {
+    __m128 cx0 = _mm_set1_ps(c.x0), cy0 = _mm_set1_ps(c.y0),
+           cx1 = _mm_set1_ps(c.x1), cy1 = _mm_set1_ps(c.y1),
+           carea = _mm_set1_ps(c.area), vthresh = _mm_set1_ps(thresh),
+           zero = _mm_setzero_ps();
+    __m128i ccls = _mm_set1_epi32(c.cls);
+    size_t i = 0;
+    for (; i + 4 <= kept.size; i += 4) {
+        __m128 left = _mm_max_ps(cx0, _mm_loadu_ps(kept.x0 + i)),
+               right = _mm_min_ps(cx1, _mm_loadu_ps(kept.x1 + i)),
+               top = _mm_max_ps(cy0, _mm_loadu_ps(kept.y0 + i)),
+               bottom = _mm_min_ps(cy1, _mm_loadu_ps(kept.y1 + i));
+        __m128 width = _mm_max_ps(_mm_sub_ps(right, left), zero),
+               height = _mm_max_ps(_mm_sub_ps(bottom, top), zero);
+        __m128 inter = _mm_mul_ps(width, height);
+        __m128 uni = _mm_sub_ps(_mm_add_ps(carea, _mm_loadu_ps(kept.area + i)),
+                                inter);
+        __m128 overlap = _mm_cmpgt_ps(inter, _mm_mul_ps(uni, vthresh));
+        __m128i same_cls = _mm_cmpeq_epi32(
+                ccls, _mm_loadu_si128(
+                              reinterpret_cast<const __m128i*>(kept.cls + i)));
+        if (_mm_movemask_ps(_mm_and_ps(overlap, _mm_castsi128_ps(same_cls)))) {
+            return true;
+        }
+    }
+    return any_overlap_naive(kept, c, thresh, i);
+}
+#endif
+
+#if MGB_NMS_NEON
+bool any_overlap_neon(const KeptSet& kept, const Candidate& c, float thresh) {
+    float32x4_t cx0 = vdupq_n_f32(c.x0), cy0 = vdupq_n_f32(c.y0),
+                cx1 = vdupq_n_f32(c.x1), cy1 = vdupq_n_f32(c.y1),
+                carea = vdupq_n_f32(c.area), vthresh = vdupq_n_f32(thresh),
+                zero = vdupq_n_f32(0.f);
+    int32x4_t ccls = vdupq_n_s32(c.cls);
+    size_t i = 0;
+    for (; i + 4 <= kept.size; i += 4) {
+        float32x4_t left = vmaxq_f32(cx0, vld1q_f32(kept.x0 + i)),
+                    right = vminq_f32(cx1, vld1q_f32(kept.x1 + i)),
+                    top = vmaxq_f32(cy0, vld1q_f32(kept.y0 + i)),
+                    bottom = vminq_f32(cy1, vld1q_f32(kept.y1 + i));
+        float32x4_t width = vmaxq_f32(vsubq_f32(right, left), zero),
+                    height = vmaxq_f32(vsubq_f32(bottom, top), zero);
+        float32x4_t inter = vmulq_f32(width, height);
+        float32x4_t uni = vsubq_f32(
+                vaddq_f32(carea, vld1q_f32(kept.area + i)), inter);
+        uint32x4_t mask =
+                vandq_u32(vcgtq_f32(inter, vmulq_f32(uni, vthresh)),
+                          vceqq_s32(ccls, vld1q_s32(kept.cls + i)));
+#if defined(__aarch64__)
+        bool any = vmaxvq_u32(mask);
+#else
+        uint32x2_t half = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+        bool any = vget_lane_u32(vpmax_u32(half, half), 0);
+#endif
+        if (any) {
+            return true;
+        }
+    }
+    return any_overlap_naive(kept, c, thresh, i);
+}
+#endif
+
+using AnyOverlapFunc = bool (*)(const KeptSet&, const Candidate&, float);
+
+AnyOverlapFunc get_any_overlap_func() {
+#if MGB_NMS_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return any_overlap_avx2;
+    }
+#endif
+#if MGB_NMS_SSE
+    return any_overlap_sse;
+#elif MGB_NMS_NEON
+    return any_overlap_neon;
+#else
+    return any_overlap_scalar;
+#endif
 }
 }  // anonymous namespace
 
-size_t mgb::opr::standalone::nms::cpu_kern_workspace(size_t nr_boxes) {
-    return (((nr_boxes - 1) / sizeof(size_t)) + 1) * sizeof(size_t);
+size_t mgb::opr::standalone::nms::cpu_kern_workspace(size_t nr_boxes,
+                                                     size_t max_output) {
+    // x0, y0, x1, y1, area and class of the kept boxes
+    return kept_capacity(nr_boxes, max_output) * (sizeof(float) * 5 +
+                                                  sizeof(int32_t));
 }
 
 void mgb::opr::standalone::nms::cpu_kern(size_t nr_boxes, size_t max_output,
                                          float overlap_thresh,
-                                         const float* boxes, uint32_t* out_idx,
-                                         uint32_t* out_size, void* workspace) {
+                                         const float* boxes,
+                                         const int32_t* classes,
+                                         uint32_t* out_idx, uint32_t* out_size,
+                                         void* workspace) {
+    static const AnyOverlapFunc any_overlap = get_any_overlap_func();
+
+    size_t cap = kept_capacity(nr_boxes, max_output);
+    auto fptr = static_cast<float*>(workspace);
+    KeptSet kept{fptr,
+                 fptr + cap,
+                 fptr + cap * 2,
+                 fptr + cap * 3,
+                 fptr + cap * 4,
+                 reinterpret_cast<int32_t*>(fptr + cap * 5),
+                 0};
+
     size_t out_pos = 0, last_out = 0;
-    auto boxes_bptr = reinterpret_cast<const Box*>(boxes);
-    auto kept_mask = static_cast<size_t*>(workspace);
-    memset(kept_mask, 0, cpu_kern_workspace(nr_boxes));
-    for (size_t i = 0; i < nr_boxes; ++i) {
-        bool supressed = false;
-        auto ibox = boxes_bptr[i];
-        for (size_t j = 0; j < i; ++j) {
-            bool j_kept =
-                    (kept_mask[j / sizeof(size_t)] >> (j % sizeof(size_t))) & 1;
-            if (j_kept && box_iou(ibox, boxes_bptr[j], overlap_thresh)) {
-                supressed = true;
-                break;
-            }
-        }
-        if (!supressed) {
-            kept_mask[i / sizeof(size_t)] |= size_t(1) << (i % sizeof(size_t));
+    for (size_t i = 0; i < nr_boxes && out_pos < max_output; ++i) {
+        const float* ibox = boxes + i * 4;
+        Candidate c{ibox[0], ibox[1], ibox[2], ibox[3], 0.f,
+                    classes ? classes[i] : 0};
+        c.area = (c.x1 - c.x0) * (c.y1 - c.y0);
+        if (!any_overlap(kept, c, overlap_thresh)) {
+            size_t k = kept.size++;
+            kept.x0[k] = c.x0;
+            kept.y0[k] = c.y0;
+            kept.x1[k] = c.x1;
+            kept.y1[k] = c.y1;
+            kept.area[k] = c.area;
+            kept.cls[k] = c.cls;
             last_out = i;
             out_idx[out_pos++] = i;
-            if (out_pos == max_output)
-                break;
         }
     }
     *out_size = out_pos;
@@ -12,12 +12,19 @@ namespace nms {
  * \brief CPU single-batch nms kernel
  *
  * See nms_kern.cuh for explanation on the parameters.
+ *
+ * Each box is only tested against the boxes kept so far, which are stored in
+ * SoA layout in the workspace so that the IoU can be computed on a batch of
+ * kept boxes with SIMD instructions.
+ *
+ * \param classes class id of each box, or nullptr; if given, a box can only
+ *      be suppressed by boxes of the same class
  */
 void cpu_kern(size_t nr_boxes, size_t max_output, float overlap_thresh,
-              const float* boxes, uint32_t* out_idx, uint32_t* out_size,
-              void* workspace);
+              const float* boxes, const int32_t* classes, uint32_t* out_idx,
+              uint32_t* out_size, void* workspace);
 
-size_t cpu_kern_workspace(size_t nr_boxes);
+size_t cpu_kern_workspace(size_t nr_boxes, size_t max_output);
 
 }  // namespace nms
 }  // namespace standalone
@@ -113,12 +113,30 @@ void NMSKeep::CUDAKern::exec(const NMSKeep* opr, const DeviceTensorND& inp,
 
 // f{{{ cpu kernel begins
 class NMSKeep::CPUKern final : public Kern {
+    size_t m_workspace_per_thread = 0;
+
+    static size_t nr_threads(const NMSKeep* opr) {
+        return CompNodeEnv::from_comp_node(opr->comp_node())
+                .cpu_env()
+                .dispatcher->nr_threads();
+    }
+
+    void init(const NMSKeep* opr, const TensorShape& boxes) {
+        auto align = opr->comp_node().get_mem_addr_alignment();
+        m_workspace_per_thread = get_aligned_power2(
+                nms::cpu_kern_workspace(boxes[1], opr->param().max_output),
+                align);
+    }
+
 public:
     ~CPUKern() = default;
 
-    size_t get_workspace_size(const NMSKeep*,
+    //! each thread has its own workspace, since batches are processed in
+    //! parallel
+    size_t get_workspace_size(const NMSKeep* opr,
                               const TensorShape& boxes) override {
-        return nms::cpu_kern_workspace(boxes.shape[1]);
+        init(opr, boxes);
+        return m_workspace_per_thread * nr_threads(opr);
     }
 
     void exec(const NMSKeep* opr, const DeviceTensorND& inp,
@@ -133,31 +151,36 @@ void NMSKeep::CPUKern::exec(const NMSKeep* opr, const DeviceTensorND& inp,
     CompNode comp_node = out_idx.comp_node();
 
     auto inp_ptr = inp.ptr<float>();
+    const int32_t* cls_ptr = nullptr;
+    if (opr->input().size() == 2) {
+        cls_ptr = opr->input(1)->dev_tensor().ptr<int32_t>();
+    }
     auto out_idx_ptr = reinterpret_cast<uint32_t*>(out_idx.ptr<int32_t>()),
          out_size_ptr = reinterpret_cast<uint32_t*>(out_size.ptr<int32_t>());
     size_t batch = inp.shape(0), nr_boxes = inp.shape(1);
     auto param = opr->param();
 
+    init(opr, inp.shape());
     auto workspace_ptr = workspace.raw_ptr();
+    auto workspace_per_thread = m_workspace_per_thread;
 
     // NOTE: we must copy all the params into the kernel closure since it would
     // be dispatched on a different thread
-    auto kern = [=]() {
-        for (size_t i = 0; i < batch; ++i) {
-            nms::cpu_kern(nr_boxes, param.max_output, param.iou_thresh,
-                          inp_ptr + i * nr_boxes * 4,
-                          out_idx_ptr + i * param.max_output, out_size_ptr + i,
-                          workspace_ptr);
-        }
+    auto kern = [=](size_t i, size_t thread_id) {
+        nms::cpu_kern(nr_boxes, param.max_output, param.iou_thresh,
+                      inp_ptr + i * nr_boxes * 4,
+                      cls_ptr ? cls_ptr + i * nr_boxes : nullptr,
+                      out_idx_ptr + i * param.max_output, out_size_ptr + i,
+                      workspace_ptr + thread_id * workspace_per_thread);
     };
 
-    // The kernel should not be invoked
-    CompNodeEnv::from_comp_node(comp_node).cpu_env().dispatch(kern);
+    // batches are independent and dispatched to the threads of the comp node
+    CompNodeEnv::from_comp_node(comp_node).cpu_env().dispatch(kern, batch);
 }
 
 // f}}} cpu kernel ends
 
-NMSKeep::NMSKeep(VarNode* boxes, const Param& param,
+NMSKeep::NMSKeep(VarNode* boxes, VarNode* classes, const Param& param,
                  const OperatorNodeConfig& config)
         : Super(boxes->owner_graph(),  // owner graph
                 config,                // OperatorNodeConfig
@@ -171,6 +194,8 @@ NMSKeep::NMSKeep(VarNode* boxes, const Param& param,
     switch (boxes->comp_node().device_type()) {
 #if MGB_CUDA
         case CompNode::DeviceType::CUDA:
+            mgb_throw_if(classes, MegBrainError,
+                         "NMSKeep: class-aware NMS is only supported on CPU");
             m_kern = std::make_unique<CUDAKern>();
             break;
 #endif
@@ -182,7 +207,13 @@ NMSKeep::NMSKeep(VarNode* boxes, const Param& param,
                       boxes->comp_node().to_string().c_str());
     }
 
-    add_input({boxes});
+    if (classes) {
+        mgb_assert(classes->dtype() == dtype::Int32(),
+                   "classes should be int32; got %s", classes->dtype().name());
+        add_input({boxes, classes});
+    } else {
+        add_input({boxes});
+    }
     add_output("indices")->dtype(dtype::Int32());
     add_output("sizes")->dtype(dtype::Int32());
     cg::add_workspace_output(this);  // workspace is also an output var
@@ -201,7 +232,15 @@ mgb::SymbolVar NMSKeep::make(SymbolVar boxes, const Param& param,
     // operator+()
     auto bvar = boxes.node();
     // insert opr into the owner graph of boxes
-    return boxes.insert_single_output_opr<NMSKeep>(bvar, param, config);
+    return boxes.insert_single_output_opr<NMSKeep>(bvar, nullptr, param,
+                                                   config);
+}
+
+mgb::SymbolVar NMSKeep::make(SymbolVar boxes, SymbolVar classes,
+                             const Param& param,
+                             const OperatorNodeConfig& config) {
+    return boxes.insert_single_output_opr<NMSKeep>(boxes.node(), classes.node(),
+                                                   param, config);
 }
 
 void NMSKeep::get_output_var_shape(const TensorShapeArray& inp_shape,
@@ -209,6 +248,13 @@ void NMSKeep::get_output_var_shape(const TensorShapeArray& inp_shape,
     auto boxes = inp_shape.at(0);
     mgb_assert(boxes.ndim == 3 && boxes.shape[2] == 4, "invalid box shape: %s",
                boxes.to_string().c_str());
+    if (inp_shape.size() == 2) {
+        auto&& classes = inp_shape[1];
+        mgb_assert(classes.ndim == 2 && classes[0] == boxes[0] &&
+                           classes[1] == boxes[1],
+                   "invalid classes shape: %s (boxes: %s)",
+                   classes.to_string().c_str(), boxes.to_string().c_str());
+    }
 
     // out_shape should match the outputs added in the constructor
     mgb_assert(out_shape.size() == 3);
@@ -220,7 +266,9 @@ void NMSKeep::get_output_var_shape(const TensorShapeArray& inp_shape,
 }
 
 void NMSKeep::add_input_layout_constraint() {
-    input(0)->add_layout_constraint_contiguous();
+    for (auto i : input()) {
+        i->add_layout_constraint_contiguous();
+    }
 }
 
 void NMSKeep::scn_do_execute() {
@@ -262,12 +310,31 @@ namespace mgb {
 
 void _hack_pull_in_nms_opr_object() {}
 
+namespace serialization {
+//! the classes input is optional
+template <>
+struct OprMaker<NMSKeep, 0> {
+    using Param = NMSKeep::Param;
+    static cg::OperatorNodeBase* make(const Param& param,
+                                      const cg::VarNodeArray& i,
+                                      ComputingGraph&,
+                                      const OperatorNodeConfig& config) {
+        if (i.size() == 1) {
+            return NMSKeep::make(i[0], param, config).node()->owner_opr();
+        }
+        mgb_assert(i.size() == 2);
+        return NMSKeep::make(i[0], i[1], param, config).node()->owner_opr();
+    }
+};
+}  // namespace serialization
+
 }  // namespace mgb
 
 // register serialization: the default implementation uses Opr::Param; it
 // requires Param::TAG, Opr::param() and Opr::make(..., param) to exist
-// Note: the second param 1 here means that this operator has one input
+// Note: the second param 0 here means that OprMaker<NMSKeep, 0> above is used
+// since the number of inputs varies
 using NMSKeepMGB = NMSKeep;
-MGB_SEREG_OPR(NMSKeepMGB, 1);
+MGB_SEREG_OPR(NMSKeepMGB, 0);
 
 // vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -0,0 +1,58 @@
+/**
+ * \file src/opr/include/megbrain/opr/dnn/attention.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#pragma once
+
+#include "megbrain/opr/internal/megdnn_opr_wrapper.h"
+#include "megdnn/oprs/nn.h"
+
+namespace mgb {
+namespace opr {
+
+/* input:
+ *   q, k, v, [mask]
+ * output:
+ *   dst
+ *
+ * dst = softmax(param.scale * q * k^T + mask) * v over the last axis of the
+ * scores; see megdnn::AttentionForward for the shapes. Only the forward pass
+ * is implemented.
+ */
+MGB_DEFINE_OPR_CLASS(AttentionForward,
+                     intl::MegDNNOprWrapperFwd<megdnn::AttentionForward>)  // {
+public:
+AttentionForward(VarNode* q, VarNode* k, VarNode* v, VarNode* mask,
+                 const Param& param, const OperatorNodeConfig& config);
+AttentionForward(VarNode* q, VarNode* k, VarNode* v, const Param& param,
+                 const OperatorNodeConfig& config);
+
+static SymbolVar make(SymbolVar q, SymbolVar k, SymbolVar v, SymbolVar mask,
+                      const Param& param = {},
+                      const OperatorNodeConfig& config = {});
+static SymbolVar make(SymbolVar q, SymbolVar k, SymbolVar v,
+                      const Param& param = {},
+                      const OperatorNodeConfig& config = {});
+
+private:
+void get_output_var_shape(const TensorShapeArray& inp_shape,
+                          TensorShapeArray& out_shape) const override;
+size_t get_workspace_size_bytes(
+        const TensorShapeArray& input_shapes,
+        const TensorShapeArray& output_shapes) const override;
+void scn_do_execute() override;
+};
+using Attention = AttentionForward;
+
+}  // namespace opr
+}  // namespace mgb
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -0,0 +1,92 @@
+/**
+ * \file src/opr/include/megbrain/opr/dnn/layer_norm.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#pragma once
+
+#include "megbrain/opr/internal/megdnn_opr_wrapper.h"
+#include "megdnn/oprs/nn.h"
+
+namespace mgb {
+namespace opr {
+
+/* input:
+ *   data, [weight, bias]
+ * output:
+ *   dst, mean, rstd
+ *
+ * The trailing param.normalized_dim dims of data are normalized; weight and
+ * bias must be given iff param.affine is set. mean and rstd (reciprocal of
+ * the standard deviation) are float32 with the shape of the leading dims and
+ * are used by the backward opr.
+ */
+MGB_DEFINE_OPR_CLASS(LayerNormForward,
+                     intl::MegDNNOprWrapperFwd<megdnn::LayerNormForward>)  // {
+public:
+LayerNormForward(VarNode* data, VarNode* weight, VarNode* bias,
+                 const Param& param, const OperatorNodeConfig& config);
+LayerNormForward(VarNode* data, const Param& param,
+                 const OperatorNodeConfig& config);
+
+static SymbolVarArray make(SymbolVar data, SymbolVar weight, SymbolVar bias,
+                           const Param& param = {},
+                           const OperatorNodeConfig& config = {});
+static SymbolVarArray make(SymbolVar data, const Param& param = {},
+                           const OperatorNodeConfig& config = {});
+
+private:
+void get_output_var_shape(const TensorShapeArray& inp_shape,
+                          TensorShapeArray& out_shape) const override;
+size_t get_workspace_size_bytes(
+        const TensorShapeArray& input_shapes,
+        const TensorShapeArray& output_shapes) const override;
+void init_output_dtype() override;
+void scn_do_execute() override;
+};
+using LayerNorm = LayerNormForward;
+
+/* input:
+ *   diff, data, [weight], mean, rstd
+ * output:
+ *   ddata, dweight, dbias
+ *
+ * dweight and dbias are empty if param.affine is not set.
+ */
+MGB_DEFINE_OPR_CLASS(LayerNormBackward,
+                     intl::MegDNNOprWrapperBwd<megdnn::LayerNormBackward>)  // {
+public:
+LayerNormBackward(VarNode* diff, VarNode* data, VarNode* weight,
+                  VarNode* mean, VarNode* rstd, const Param& param,
+                  const OperatorNodeConfig& config);
+LayerNormBackward(VarNode* diff, VarNode* data, VarNode* mean, VarNode* rstd,
+                  const Param& param, const OperatorNodeConfig& config);
+
+static SymbolVarArray make(SymbolVar diff, SymbolVar data, SymbolVar weight,
+                           SymbolVar mean, SymbolVar rstd,
+                           const Param& param = {},
+                           const OperatorNodeConfig& config = {});
+static SymbolVarArray make(SymbolVar diff, SymbolVar data, SymbolVar mean,
+                           SymbolVar rstd, const Param& param = {},
+                           const OperatorNodeConfig& config = {});
+
+private:
+void init_output_static_infer_desc() override;
+void init_output_dtype() override;
+size_t get_workspace_size_bytes(
+        const TensorShapeArray& input_shapes,
+        const TensorShapeArray& output_shapes) const override;
+void scn_do_execute() override;
+};
+
+}  // namespace opr
+}  // namespace mgb
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
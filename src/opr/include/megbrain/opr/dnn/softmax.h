@@ -0,0 +1,41 @@
+/**
+ * \file src/opr/include/megbrain/opr/dnn/softmax.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#pragma once
+
+#include "megbrain/opr/internal/megdnn_opr_wrapper.h"
+#include "megdnn/oprs/nn.h"
+
+namespace mgb {
+namespace opr {
+
+MGB_DEFINE_MEGDNN_OPR_WRAPPER_FWD1(SoftmaxForward);
+using Softmax = SoftmaxForward;
+
+/*!
+ * \brief gradient of softmax computed from its output y and the gradient of
+ *      y
+ */
+MGB_DEFINE_OPR_CLASS(SoftmaxBackward,
+                     intl::MegDNNOprWrapperBwd<megdnn::SoftmaxBackward>)  // {
+public:
+SoftmaxBackward(VarNode* y, VarNode* y_grad, const Param& param,
+                const OperatorNodeConfig& config);
+
+static SymbolVar make(SymbolVar y, SymbolVar y_grad, const Param& param = {},
+                      const OperatorNodeConfig& config = {});
+};
+
+}  // namespace opr
+}  // namespace mgb
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -293,6 +293,25 @@ void valid_mask(const int* mask_offset, int mask_len, const int* mask_val,
 
 using DctChannelSelect = DctChannelSelectForward;
 
+/*!
+ * \brief convert, resize and normalize uint8 images into network inputs in a
+ *      single pass
+ *
+ * See megdnn::ImagePreprocess for details. The output dtype is given by the
+ * config, which defaults to Float32.
+ */
+MGB_DEFINE_OPR_CLASS(
+        ImagePreprocessForward,
+        intl::MegDNNOprWrapperFwd<megdnn::ImagePreprocessForward>)  // {
+public:
+ImagePreprocessForward(VarNode* src, const Param& param,
+                       const OperatorNodeConfig& config);
+static SymbolVar make(SymbolVar src, const Param& param = {},
+                      const OperatorNodeConfig& config = {});
+};
+
+using ImagePreprocess = ImagePreprocessForward;
+
 }  // opr
 }  // mgb
 
@@ -24,7 +24,12 @@ public:
     };
     
 
-    NMSKeep(VarNode * boxes, const Param& param,
+    /*!
+     * \param classes optional int32 class ids of shape (batch, nr_boxes);
+     *      if given, a box is only suppressed by boxes of the same class.
+     *      This is only supported on CPU.
+     */
+    NMSKeep(VarNode * boxes, VarNode * classes, const Param& param,
             const OperatorNodeConfig& config);
     ~NMSKeep() noexcept;
 
@@ -32,6 +37,11 @@ public:
     static SymbolVar make(SymbolVar boxes, const Param& param,
                           const OperatorNodeConfig& config = {});
 
+    //! class-aware NMS
+    static SymbolVar make(SymbolVar boxes, SymbolVar classes,
+                          const Param& param,
+                          const OperatorNodeConfig& config = {});
+
     const Param& param() const { return m_param; }
 
 private:
@@ -0,0 +1,89 @@
+/**
+ * \file src/opr/test/dnn/attention.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/opr/dnn/attention.h"
+#include "megbrain/test/autocheck.h"
+#include "megbrain/test/helper.h"
+#include "megbrain/test/megdnn_helper.h"
+
+using namespace mgb;
+
+namespace {
+using Param = opr::Attention::Param;
+
+void exec_naive(const Param& param, const megdnn::TensorND& q,
+                const megdnn::TensorND& k, const megdnn::TensorND& v,
+                const megdnn::TensorND& mask, HostTensorND& dest) {
+    auto opr = megdnn_naive_handle()->create_operator<megdnn::Attention>();
+    opr->param() = param;
+    TensorLayout dst_layout;
+    opr->deduce_layout(q.layout, k.layout, v.layout, mask.layout,
+                       dst_layout);
+    dest.resize(dst_layout);
+    opr->exec(q, k, v, mask, dest.as_megdnn(), {});
+}
+}  // anonymous namespace
+
+TEST(TestOprDNN, Attention) {
+    using Checker = AutoOprChecker<3, 1>;
+    Param param;
+
+    auto make_graph =
+            [&](const Checker::SymInpArray& inputs) -> Checker::SymOutArray {
+        return {opr::Attention::make(inputs[0], inputs[1], inputs[2], param)};
+    };
+
+    auto fwd = [&](Checker::NumOutArray& dest, Checker::NumInpArray inp) {
+        dest[0].dtype(dtype::Float32()).comp_node(inp[0]->comp_node());
+        exec_naive(param, inp[0]->as_megdnn(), inp[1]->as_megdnn(),
+                   inp[2]->as_megdnn(), {}, dest[0]);
+    };
+
+    Checker checker{make_graph, fwd};
+    checker.disable_grad_check();
+    for (bool causal : {false, true}) {
+        param.scale = 0.25f;
+        param.causal = causal;
+        checker.run({TensorShape{2, 5, 8}, {2, 7, 8}, {2, 7, 3}})
+                .run({TensorShape{1, 2, 17, 16}, {1, 2, 17, 16},
+                      {1, 2, 17, 16}})
+                .run({TensorShape{3, 1, 70, 4}, {3, 1, 70, 4},
+                      {3, 1, 70, 4}});
+    }
+}
+
+TEST(TestOprDNN, AttentionMask) {
+    using Checker = AutoOprChecker<4, 1>;
+    Param param{0.5f, false};
+
+    auto make_graph =
+            [&](const Checker::SymInpArray& inputs) -> Checker::SymOutArray {
+        return {opr::Attention::make(inputs[0], inputs[1], inputs[2],
+                                     inputs[3], param)};
+    };
+
+    auto fwd = [&](Checker::NumOutArray& dest, Checker::NumInpArray inp) {
+        dest[0].dtype(dtype::Float32()).comp_node(inp[0]->comp_node());
+        exec_naive(param, inp[0]->as_megdnn(), inp[1]->as_megdnn(),
+                   inp[2]->as_megdnn(), inp[3]->as_megdnn(), dest[0]);
+    };
+
+    Checker{make_graph, fwd}
+            .disable_grad_check()
+            .run({TensorShape{2, 5, 8}, {2, 7, 8}, {2, 7, 3}, {2, 5, 7}})
+            .run({TensorShape{2, 3, 9, 16}, {2, 3, 11, 16}, {2, 3, 11, 16},
+                  {2, 1, 1, 11}})
+            .run({TensorShape{1, 4, 6, 6}, {1, 4, 6, 6}, {1, 4, 6, 6},
+                  {1, 1, 6, 6}});
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
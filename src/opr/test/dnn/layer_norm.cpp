@@ -0,0 +1,101 @@
+/**
+ * \file src/opr/test/dnn/layer_norm.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/opr/dnn/layer_norm.h"
+#include "megbrain/test/autocheck.h"
+#include "megbrain/test/helper.h"
+#include "megbrain/test/megdnn_helper.h"
+
+using namespace mgb;
+
+namespace {
+using Param = opr::LayerNorm::Param;
+
+void exec_naive(const Param& param, const megdnn::TensorND& data,
+                const megdnn::TensorND& weight, const megdnn::TensorND& bias,
+                HostTensorND& dest) {
+    auto opr = megdnn_naive_handle()
+                       ->create_operator<megdnn::LayerNormForward>();
+    opr->param() = param;
+    TensorLayout dst_layout, mean_layout, rstd_layout;
+    opr->deduce_layout(data.layout, weight.layout, bias.layout, dst_layout,
+                       mean_layout, rstd_layout);
+    HostTensorND mean{dest.comp_node(), mean_layout},
+            rstd{dest.comp_node(), rstd_layout};
+    dest.resize(dst_layout);
+    opr->exec(data, weight, bias, dest.as_megdnn(), mean.as_megdnn(),
+              rstd.as_megdnn(), {});
+}
+
+Param make_param(bool affine, size_t normalized_dim,
+                 const TensorShape& normalized_shape) {
+    Param param;
+    param.affine = affine;
+    param.eps = 1e-3f;
+    param.normalized_dim = normalized_dim;
+    param.normalized_size = normalized_shape.total_nr_elems();
+    return param;
+}
+}  // anonymous namespace
+
+TEST(TestOprDNN, LayerNormAffine) {
+    using Checker = AutoOprChecker<3, 1>;
+    Param param;
+
+    auto make_graph =
+            [&](const Checker::SymInpArray& inputs) -> Checker::SymOutArray {
+        return {opr::LayerNorm::make(inputs[0], inputs[1], inputs[2],
+                                     param)[0]};
+    };
+
+    auto fwd = [&](Checker::NumOutArray& dest, Checker::NumInpArray inp) {
+        dest[0].dtype(dtype::Float32()).comp_node(inp[0]->comp_node());
+        exec_naive(param, inp[0]->as_megdnn(), inp[1]->as_megdnn(),
+                   inp[2]->as_megdnn(), dest[0]);
+    };
+
+    Checker::RunOptions opt;
+    opt.numdiff_eps = 1e-2;
+    opt.numdiff_max_err = 1e-2;
+    Checker checker{make_graph, fwd};
+    param = make_param(true, 1, {5});
+    checker.run({TensorShape{2, 3, 5}, {5}, {5}}, opt)
+            .run({TensorShape{7, 5}, {5}, {5}}, opt);
+    param = make_param(true, 2, {3, 4});
+    checker.run({TensorShape{2, 3, 4}, {3, 4}, {3, 4}}, opt)
+            .run({TensorShape{5, 3, 4}, {3, 4}, {3, 4}}, opt);
+}
+
+TEST(TestOprDNN, LayerNormNoAffine) {
+    using Checker = AutoOprChecker<1, 1>;
+    Param param = make_param(false, 1, {6});
+
+    auto make_graph =
+            [&](const Checker::SymInpArray& inputs) -> Checker::SymOutArray {
+        return {opr::LayerNorm::make(inputs[0], param)[0]};
+    };
+
+    auto fwd = [&](Checker::NumOutArray& dest, Checker::NumInpArray inp) {
+        dest[0].dtype(dtype::Float32()).comp_node(inp[0]->comp_node());
+        exec_naive(param, inp[0]->as_megdnn(), {}, {}, dest[0]);
+    };
+
+    Checker::RunOptions opt;
+    opt.numdiff_eps = 1e-2;
+    opt.numdiff_max_err = 1e-2;
+    Checker{make_graph, fwd}
+            .run({TensorShape{3, 6}}, opt)
+            .run({TensorShape{2, 4, 6}}, opt)
+            .run({TensorShape{1, 6}}, opt);
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
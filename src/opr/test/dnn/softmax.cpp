@@ -0,0 +1,60 @@
+/**
+ * \file src/opr/test/dnn/softmax.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.
+ */
+
+#include "megbrain/opr/dnn/softmax.h"
+#include "megbrain/test/autocheck.h"
+#include "megbrain/test/helper.h"
+#include "megbrain/test/megdnn_helper.h"
+
+using namespace mgb;
+
+namespace {
+void run_softmax(int axis) {
+    using Checker = AutoOprChecker<1, 1>;
+
+    opr::Softmax::Param param;
+    param.axis = axis;
+
+    auto make_graph =
+            [&](const Checker::SymInpArray& inputs) -> Checker::SymOutArray {
+        return {opr::Softmax::make(inputs[0], param)};
+    };
+
+    auto fwd = [&](Checker::NumOutArray& dest, Checker::NumInpArray inp) {
+        auto opr = megdnn_naive_handle()
+                           ->create_operator<megdnn::SoftmaxForward>();
+        opr->param() = param;
+        dest[0].dtype(dtype::Float32())
+                .comp_node(inp[0]->comp_node())
+                .resize(inp[0]->shape());
+        opr->exec(inp[0]->as_megdnn(), dest[0].as_megdnn(), {});
+    };
+
+    Checker::RunOptions opt;
+    opt.numdiff_eps = 1e-2;
+    opt.numdiff_max_err = 1e-2;
+    Checker{make_graph, fwd}
+            .run({TensorShape{2, 3, 4}}, opt)
+            .run({TensorShape{5, 7, 3}}, opt)
+            .run({TensorShape{3, 17, 2}}, opt);
+}
+}  // anonymous namespace
+
+TEST(TestOprDNN, SoftmaxLastAxis) {
+    run_softmax(-1);
+}
+
+TEST(TestOprDNN, SoftmaxMiddleAxis) {
+    run_softmax(1);
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
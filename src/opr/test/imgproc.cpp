@@ -853,4 +853,41 @@ TEST(TestOprImgproc, DCT_BAD_MASK) {
                                              mask_val_sym, param),
                  MegBrainError);
 }
+
+TEST(TestOprImgproc, ImagePreprocess) {
+    HostTensorGenerator<dtype::Uint8> gen;
+    auto graph = ComputingGraph::make();
+    auto host_x = gen({2, 5, 6, 3});
+    auto x = opr::Host2DeviceCopy::make(*graph, host_x);
+    opr::ImagePreprocess::Param param;
+    param.rgb = true;
+    param.mean0 = 128.f;
+    param.scale2 = 0.5f;
+    auto y = opr::ImagePreprocess::make(x, param);
+    ASSERT_EQ(dtype::Float32(), y.dtype());
+
+    HostTensorND host_y;
+    auto func = graph->compile({make_callback_copy(y, host_y)});
+    func->execute();
+    ASSERT_EQ(TensorShape({2, 3, 5, 6}), host_y.shape());
+    auto px = host_x->ptr<uint8_t>();
+    auto py = host_y.ptr<float>();
+    for (size_t n = 0; n < 2; ++n)
+        for (size_t h = 0; h < 5; ++h)
+            for (size_t w = 0; w < 6; ++w) {
+                auto src = px + ((n * 5 + h) * 6 + w) * 3;
+                auto dst = py + (n * 3 * 5 + h) * 6 + w;
+                ASSERT_EQ(src[2] - 128.f, dst[0]);
+                ASSERT_EQ(static_cast<float>(src[1]), dst[30]);
+                ASSERT_EQ(src[0] * 0.5f, dst[60]);
+            }
+
+    param.format = opr::ImagePreprocess::Param::Format::NCHW44;
+    param.oh = 3;
+    param.ow = 4;
+    y = opr::ImagePreprocess::make(x, param,
+                                   OperatorNodeConfig{dtype::QuantizedS8(1.f)});
+    ASSERT_EQ(TensorShape({2, 1, 3, 4, 4}), y.node()->shape());
+    ASSERT_EQ(dtype::QuantizedS8(1.f), y.dtype());
+}
 // vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
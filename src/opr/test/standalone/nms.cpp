@@ -9,6 +9,7 @@
 #include "megbrain/opr/io.h"
 #include "megbrain/opr/tensor_manip.h"
 #include "megbrain/opr/tensor_gen.h"
+#include "megbrain/utils/timer.h"
 #include <random>
 
 using namespace mgb;
@@ -55,6 +56,146 @@ void run_on_comp_node(const char* cn_name) {
     }
 }
 
+//! generate boxes whose centers are in [0, 100) and sizes in [5, 30)
+void gen_boxes(HostTensorND& boxes, HostTensorND& classes, size_t nr_class,
+               std::mt19937& rng) {
+    std::uniform_real_distribution<float> center{0.f, 100.f}, size{5.f, 30.f};
+    std::uniform_int_distribution<int> cls{0, static_cast<int>(nr_class) - 1};
+    auto pb = boxes.ptr<float>();
+    auto pc = classes.ptr<int32_t>();
+    for (size_t i = 0; i < classes.shape().total_nr_elems(); ++i) {
+        float cx = center(rng), cy = center(rng), w = size(rng), h = size(rng);
+        pb[i * 4] = cx - w / 2;
+        pb[i * 4 + 1] = cy - h / 2;
+        pb[i * 4 + 2] = cx + w / 2;
+        pb[i * 4 + 3] = cy + h / 2;
+        pc[i] = cls(rng);
+    }
+}
+
+//! test every box against all the previous kept boxes
+std::vector<int32_t> naive_nms(const float* boxes, const int32_t* classes,
+                               size_t nr_boxes, float thresh,
+                               size_t max_output) {
+    std::vector<int32_t> kept;
+    for (size_t i = 0; i < nr_boxes && kept.size() < max_output; ++i) {
+        auto a = boxes + i * 4;
+        bool suppressed = false;
+        for (auto j : kept) {
+            auto b = boxes + j * 4;
+            if (classes && classes[i] != classes[j]) {
+                continue;
+            }
+            float width = std::max(std::min(a[2], b[2]) -
+                                           std::max(a[0], b[0]), 0.f),
+                  height = std::max(std::min(a[3], b[3]) -
+                                            std::max(a[1], b[1]), 0.f);
+            float inter = width * height;
+            float sa = (a[2] - a[0]) * (a[3] - a[1]),
+                  sb = (b[2] - b[0]) * (b[3] - b[1]);
+            if (inter > (sa + sb - inter) * thresh) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            kept.push_back(i);
+        }
+    }
+    return kept;
+}
+
+}  // anonymous namespace
+
+TEST(TestOprNMS, CPUBatchedClassAware) {
+    constexpr size_t BATCH = 5, NR_BOXES = 700;
+    std::mt19937 rng{42};
+    for (auto cn_name : {"cpu0", "multithread2:0"}) {
+        auto cn = CompNode::load(cn_name);
+        auto host_boxes = std::make_shared<HostTensorND>(
+                cn, TensorShape{BATCH, NR_BOXES, 4}, dtype::Float32{});
+        auto host_cls = std::make_shared<HostTensorND>(
+                cn, TensorShape{BATCH, NR_BOXES}, dtype::Int32{});
+        gen_boxes(*host_boxes, *host_cls, 3, rng);
+        for (bool class_aware : {false, true}) {
+            for (uint32_t max_output : {20u, 1000u}) {
+                auto graph = ComputingGraph::make();
+                auto boxes = opr::Host2DeviceCopy::make(*graph, host_boxes),
+                     cls = opr::Host2DeviceCopy::make(*graph, host_cls);
+                opr::standalone::NMSKeep::Param param{0.3, max_output};
+                auto idx = class_aware
+                                   ? opr::standalone::NMSKeep::make(
+                                             boxes, cls, param)
+                                   : opr::standalone::NMSKeep::make(boxes,
+                                                                    param);
+                auto size = idx.node()->owner_opr()->output(1);
+                HostTensorND host_idx, host_size;
+                auto func =
+                        graph->compile({make_callback_copy(idx, host_idx),
+                                        make_callback_copy(size, host_size)});
+                func->execute().wait();
+                for (size_t b = 0; b < BATCH; ++b) {
+                    auto expect = naive_nms(
+                            host_boxes->ptr<float>() + b * NR_BOXES * 4,
+                            class_aware ? host_cls->ptr<int32_t>() +
+                                                  b * NR_BOXES
+                                        : nullptr,
+                            NR_BOXES, param.iou_thresh, max_output);
+                    auto pidx = host_idx.ptr<int32_t>() + b * max_output;
+                    ASSERT_EQ(static_cast<int32_t>(expect.size()),
+                              host_size.ptr<int32_t>()[b]);
+                    for (size_t i = 0; i < max_output; ++i) {
+                        ASSERT_EQ(i < expect.size() ? expect[i]
+                                                    : expect.back(),
+                                  pidx[i]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(TestOprNMS, BenchmarkCPU) {
+    constexpr uint32_t MAX_OUTPUT = 1000;
+    constexpr size_t RUNS = 10;
+    std::mt19937 rng{42};
+    auto cn = CompNode::load("cpu0");
+    for (size_t nr_boxes : {1000, 5000, 10000, 20000}) {
+        auto host_boxes = std::make_shared<HostTensorND>(
+                cn, TensorShape{1, nr_boxes, 4}, dtype::Float32{});
+        HostTensorND host_cls{cn, TensorShape{1, nr_boxes}, dtype::Int32{}};
+        gen_boxes(*host_boxes, host_cls, 1, rng);
+        // scale the boxes so that about MAX_OUTPUT boxes are kept
+        auto ptr = host_boxes->ptr<float>();
+        float scale = std::sqrt(static_cast<float>(nr_boxes));
+        for (size_t i = 0; i < nr_boxes * 4; ++i) {
+            ptr[i] *= scale;
+        }
+
+        auto graph = ComputingGraph::make();
+        auto boxes = opr::Host2DeviceCopy::make(*graph, host_boxes);
+        auto idx = opr::standalone::NMSKeep::make(boxes, {0.7, MAX_OUTPUT});
+        auto size = idx.node()->owner_opr()->output(1);
+        HostTensorND host_idx, host_size;
+        auto func = graph->compile({make_callback_copy(idx, host_idx),
+                                    make_callback_copy(size, host_size)});
+        func->execute().wait();
+        RealTimer timer;
+        for (size_t i = 0; i < RUNS; ++i) {
+            func->execute().wait();
+        }
+        auto time_opr = timer.get_msecs_reset() / RUNS;
+        size_t nr_kept = 0;
+        for (size_t i = 0; i < RUNS; ++i) {
+            nr_kept = naive_nms(ptr, nullptr, nr_boxes, 0.7, MAX_OUTPUT).size();
+        }
+        auto time_naive = timer.get_msecs() / RUNS;
+        ASSERT_EQ(static_cast<int32_t>(nr_kept), host_size.ptr<int32_t>()[0]);
+        mgb_log("nms on %zu boxes (%zu kept): opr %.3fms, naive %.3fms, "
+                "speedup %.2f",
+                nr_boxes, nr_kept, time_opr, time_naive,
+                time_naive / time_opr);
+    }
 }
 
 TEST(TestOprNMS, CPU) {
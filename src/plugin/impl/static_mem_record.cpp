@@ -12,6 +12,7 @@
 
 #include "megbrain/plugin/static_mem_record.h"
 #ifndef __IN_TEE_ENV__
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -259,6 +260,14 @@ void StaticMemRecorder::show(std::string svg_name) {
 
     // log peak memory size, where it is reached and which chunks constitute it.
     mgb_log("peak_mem_size = %zu\n", m_peak_mem_size);
+    if (m_heuristic_peak_mem_size) {
+        // gap between the plan and the heuristic it is improved from
+        size_t gap = m_heuristic_peak_mem_size -
+                     std::min(m_peak_mem_size, m_heuristic_peak_mem_size);
+        mgb_log("heuristic peak_mem_size = %zu, saved %zu (%.2f%%)\n",
+                m_heuristic_peak_mem_size, gap,
+                gap * 100.0 / m_heuristic_peak_mem_size);
+    }
     size_t max_size = 0;
     std::vector<size_t> opr_ids;
     for (auto&& i : m_opr_seq_recorder) {
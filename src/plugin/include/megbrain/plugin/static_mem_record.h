@@ -56,6 +56,15 @@ public:
 
     const size_t& peak_mem_size() { return m_peak_mem_size; }
 
+    //! peak of the heuristic allocator, which may be improved by optimizers
+    void regist_heuristic_peak_mem_size(size_t size) {
+        m_heuristic_peak_mem_size = size;
+    }
+
+    const size_t& heuristic_peak_mem_size() {
+        return m_heuristic_peak_mem_size;
+    }
+
     void set_sum_mem_size(size_t size) { m_sum_mem_size = size; }
 
     const size_t& sum_mem_size() { return m_sum_mem_size; }
@@ -75,7 +84,8 @@ private:
     bool m_is_record = false;
     // All chunks after m_memory_chunk_recorder.at(m_weight_chunk_id) are
     // weights memory chunks
-    size_t m_peak_mem_size, m_sum_mem_size, m_weight_chunk_id;
+    size_t m_peak_mem_size, m_heuristic_peak_mem_size = 0, m_sum_mem_size,
+            m_weight_chunk_id;
     std::vector<opr_record> m_opr_seq_recorder;
     std::vector<memory_chunk_record> m_memory_chunk_recorder;
     std::vector<std::vector<size_t>> get_chunk_construct(
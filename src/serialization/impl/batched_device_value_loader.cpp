@@ -12,6 +12,7 @@
 #include "batched_device_value_loader.h"
 
 #include "megbrain/utils/arith_helper.h"
+#include "megbrain/utils/thread_pool.h"
 
 namespace mgb {
 namespace serialization {
@@ -29,13 +30,16 @@ std::shared_ptr<DeviceTensorND> BatchedDeviceValueLoader::make(
     return dev_tensor;
 }
 
-void BatchedDeviceValueLoader::apply() {
+void BatchedDeviceValueLoader::apply(ThreadPool* pool) {
     for (auto&& item : m_cn2tensor_list) {
         auto alignment = item.first.get_mem_addr_alignment();
+        auto&& tensors = item.second.tensors;
+        std::vector<size_t> offsets(tensors.size());
         size_t tot_size = 0;
-        for (auto&& i : item.second.tensors) {
-            tot_size = get_aligned_power2(tot_size, alignment) +
-                       i.second->layout().span().dist_byte();
+        for (size_t i = 0; i < tensors.size(); ++i) {
+            offsets[i] = get_aligned_power2(tot_size, alignment);
+            tot_size = offsets[i] +
+                       tensors[i].second->layout().span().dist_byte();
         }
 
         HostTensorStorage host_storage{item.first};
@@ -43,20 +47,32 @@ void BatchedDeviceValueLoader::apply() {
         host_storage.ensure_size(tot_size);
         dev_storage.ensure_size(tot_size);
         auto ptr_host = host_storage.ptr();
-        size_t offset = 0;
-        for (auto&& i : item.second.tensors) {
-            offset = get_aligned_power2(offset, alignment);
-            auto size = i.second->layout().span().dist_byte();
+
+        // values in the default format are plain memory copies which can be
+        // done in parallel
+        auto copy_default = [&](size_t idx, size_t) {
+            auto&& i = tensors[idx];
             if (i.second->layout().format.is_default()) {
+                auto size = i.second->layout().span().dist_byte();
                 mgb_assert(size == i.first.layout().span().dist_byte());
-                memcpy(ptr_host + offset, i.first.raw_ptr(), size);
-            } else {
+                memcpy(ptr_host + offsets[idx], i.first.raw_ptr(), size);
+            }
+        };
+        if (pool && tensors.size() > 1) {
+            pool->add_task({copy_default, tensors.size()});
+        } else {
+            for (size_t i = 0; i < tensors.size(); ++i) {
+                copy_default(i, 0);
+            }
+        }
+        for (size_t idx = 0; idx < tensors.size(); ++idx) {
+            auto&& i = tensors[idx];
+            if (!i.second->layout().format.is_default()) {
                 HostTensorND host;
-                host.reset(host_storage.sub(offset), i.second->layout());
+                host.reset(host_storage.sub(offsets[idx]), i.second->layout());
                 host.copy_from_fixlayout(i.first);
             }
-            i.second->reset(dev_storage.sub(offset), i.second->layout());
-            offset += size;
+            i.second->reset(dev_storage.sub(offsets[idx]), i.second->layout());
         }
         dev_storage.copy_from(host_storage, tot_size);
         item.first.sync();
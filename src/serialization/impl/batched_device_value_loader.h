@@ -15,6 +15,8 @@
 #include "megbrain/tensor.h"
 
 namespace mgb {
+class ThreadPool;
+
 namespace serialization {
 
 /*!
@@ -42,8 +44,14 @@ public:
     std::shared_ptr<DeviceTensorND> make(CompNode comp_node,
                                          HostTensorND value);
 
-    //! apply all the lazy loads
-    void apply();
+    bool empty() const { return m_cn2tensor_list.empty(); }
+
+    /*!
+     * \brief apply all the lazy loads
+     * \param pool thread pool to copy the host values into the staging
+     *      buffers in parallel, or null to copy them on the caller thread
+     */
+    void apply(ThreadPool* pool = nullptr);
 };
 
 }  // namespace serialization
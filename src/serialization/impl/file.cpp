@@ -11,6 +11,13 @@
 
 #include "megbrain/serialization/file.h"
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace mgb {
 namespace serialization {
 
@@ -63,6 +70,89 @@ std::unique_ptr<InputFile> InputFile::make_fs(const char* path) {
     return std::make_unique<FsImpl>(path);
 }
 
+#ifndef WIN32
+class InputFile::MmapImpl final : public InputFile {
+    std::shared_ptr<void> m_refhold;
+    uint8_t* m_ptr = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+
+public:
+    MmapImpl(const char* path) {
+        int fd = open(path, O_RDONLY);
+        mgb_assert(fd >= 0, "failed to open %s: %s", path, strerror(errno));
+        struct stat st;
+        void* ptr = MAP_FAILED;
+        int err = fstat(fd, &st);
+        if (!err && st.st_size > 0) {
+            // private writable mapping: pages are shared with the page cache
+            // until a tensor aliasing them is modified
+            ptr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+        }
+        auto mmap_errno = errno;
+        close(fd);
+        mgb_assert(!err && st.st_size > 0, "failed to stat %s or empty file",
+                   path);
+        mgb_assert(ptr != MAP_FAILED, "failed to mmap %s: %s", path,
+                   strerror(mmap_errno));
+        m_size = st.st_size;
+        m_ptr = static_cast<uint8_t*>(ptr);
+        auto size = m_size;
+        m_refhold = {ptr, [size](void* p) { munmap(p, size); }};
+    }
+
+    void rewind() override { m_offset = 0; }
+
+    void skip(size_t bytes) override {
+        m_offset += bytes;
+        mgb_assert(m_offset <= m_size);
+    }
+
+    void read(void* dst, size_t size) override {
+        mgb_assert(m_offset + size <= m_size);
+        memcpy(dst, m_ptr + m_offset, size);
+        m_offset += size;
+    }
+
+    size_t tell() override { return m_offset; }
+
+    void read_into_tensor(HostTensorND& dest,
+                          const TensorLayout& layout) override {
+        auto size = layout.span().high_byte;
+        mgb_assert(m_offset + size <= m_size);
+        void* ptr = m_ptr + m_offset;
+        auto align = dest.comp_node().get_mem_addr_alignment();
+        if (!(reinterpret_cast<uintptr_t>(ptr) & (align - 1))) {
+            HostTensorStorage storage;
+            storage.reset(dest.comp_node(), size,
+                          {m_refhold, static_cast<dt_byte*>(ptr)});
+            dest.reset(storage, layout);
+        } else {
+            dest.dtype(layout.dtype).resize(layout);
+            memcpy(dest.raw_ptr(), ptr, size);
+        }
+        m_offset += size;
+    }
+
+    SharedBuffer read_shared(size_t size) override {
+        mgb_assert(m_offset + size <= m_size);
+        auto ptr = m_ptr + m_offset;
+        m_offset += size;
+        std::shared_ptr<const void> ret{m_refhold, ptr};
+        return {std::move(ret), size};
+    }
+};
+
+std::unique_ptr<InputFile> InputFile::make_mmap(const char* path) {
+    return std::make_unique<MmapImpl>(path);
+}
+#else
+std::unique_ptr<InputFile> InputFile::make_mmap(const char* path) {
+    return make_fs(path);
+}
+#endif
+
 class OutputFile::FsImpl final : public OutputFile {
     FILE* m_fptr;
 
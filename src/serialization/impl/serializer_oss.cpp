@@ -23,6 +23,7 @@
 #if MGB_ENABLE_FBS_SERIALIZATION
 
 #include "batched_device_value_loader.h"
+#include "tensor_compression.h"
 
 #include "megbrain/graph/exc_extra_info.h"
 #include "megbrain/opr/io.h"
@@ -32,13 +33,21 @@
 #include "megbrain/serialization/opr_load_dump.h"
 #include "megbrain/serialization/metadata.h"
 #include "megbrain/serialization/serializer.h"
+#include "megbrain/utils/async_worker.h"
+#include "megbrain/utils/thread_pool.h"
+#include "megbrain/utils/timer.h"
 #include "megbrain/version.h"
 
 #include <flatbuffers/flatbuffers.h>
 
+#include <atomic>
 #include <cerrno>
 #include <cinttypes>
 #include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 using namespace mgb;
 using namespace mgb::serialization;
@@ -430,12 +439,28 @@ void GraphDumperOSS::dump_tensor(const std::string& name,
     }
 
     size_t value_size = 0;
+    Offset<fbs::TensorCompression> compression;
     if (has_value) {
         check_tensor_value_valid(name, tensor);
         auto begin = m_file->tell();
         auto&& dumper = m_config.tensor_value_dumper;
+        GraphDumpConfig::ParamCompression param_compression;
+        if (!dumper && m_config.param_compression.enabled() &&
+            (method == Meth::VALUE_SHARED ||
+             method == Meth::VALUE_ANONYMOUS)) {
+            param_compression = tensor_compression::get_compression(
+                    tensor.layout(), m_config.param_compression);
+        }
         if (dumper) {
             dumper(*m_file, *m_cur_opr, tensor);
+        } else if (param_compression.enabled()) {
+            tensor_compression::dump(*m_file, tensor, param_compression);
+            compression = fbs::CreateTensorCompression(
+                    m_builder,
+                    static_cast<fbs::TensorCodec>(param_compression.codec),
+                    static_cast<fbs::TensorEncoding>(
+                            param_compression.encoding),
+                    param_compression.chunk_size);
         } else {
             m_file->write(tensor.raw_ptr(), tensor.layout().span().high_byte);
         }
@@ -450,8 +475,9 @@ void GraphDumperOSS::dump_tensor(const std::string& name,
             m_builder, m_builder.CreateSharedString(
                                tensor.comp_node().to_string_logical()));
     auto dtype = build_dtype(tensor.dtype());
-    auto serialized_tensor = fbs::CreateTensor(m_builder, fbname, shape,
-                                               comp_node, dtype, value_size);
+    auto serialized_tensor =
+            fbs::CreateTensor(m_builder, fbname, shape, comp_node, dtype,
+                              value_size, 0, compression);
     m_cur_opr_tensor.emplace_back(serialized_tensor);
 }
 
@@ -475,6 +501,9 @@ class GraphLoaderOSS final : public GraphLoader {
 
     class OprLoadContextImpl;
     friend class OprLoadContextImpl;
+#if MGB_HAVE_THREAD
+    class ParallelTensorLoader;
+#endif
 
     void verify();
 
@@ -500,6 +529,260 @@ public:
     }
 };
 
+GraphDumpConfig::ParamCompression load_tensor_compression(
+        const fbs::Tensor* tensor) {
+    using ParamCompression = GraphDumpConfig::ParamCompression;
+    auto fbcompression = tensor->compression();
+    mgb_assert(fbcompression);
+    mgb_throw_if(tensor->data_size() < tensor->offset(), SerializationError,
+                 "invalid compressed tensor: data_size=%u offset=%u",
+                 tensor->data_size(), tensor->offset());
+    ParamCompression ret;
+    ret.codec = static_cast<ParamCompression::Codec>(fbcompression->codec());
+    ret.encoding =
+            static_cast<ParamCompression::Encoding>(fbcompression->encoding());
+    ret.chunk_size = fbcompression->chunk_size();
+    return ret;
+}
+
+#if MGB_HAVE_THREAD
+/*!
+ * \brief load tensor values on worker threads while the oprs are being
+ *      constructed
+ *
+ * The tensor records of all oprs are added before the loading starts. Since
+ * InputFile only supports sequential access, a reader task reads the value
+ * blobs in file order, and the chunks of compressed values are decoded by the
+ * other workers. Opr loaders only wait for the values they use.
+ */
+class GraphLoaderOSS::ParallelTensorLoader {
+public:
+    struct Record {
+        const fbs::Tensor* tensor = nullptr;
+        CompNode comp_node;
+        TensorLayout layout;
+
+        //! host value, which is on comp_node if it is on the CPU memory
+        //! node, and on the default CPU otherwise
+        HostTensorND value;
+
+        //! set when the value is loaded, or the reader fails before reading
+        //! it
+        std::promise<void> ready;
+        std::future<void> ready_future = ready.get_future();
+        bool loaded = false;
+        std::atomic_bool corrupted{false};
+        //! the first exception thrown by the decoding tasks
+        std::exception_ptr error;
+        std::atomic_bool has_error{false};
+
+        //! states for decoding a compressed value
+        SharedBuffer blob{{}, 0};
+        std::unique_ptr<tensor_compression::ChunkDecoder> decoder;
+        std::atomic_size_t nr_pending_chunks{0};
+    };
+
+    ParallelTensorLoader(InputFile& file, size_t nr_threads) : m_file{file} {
+        // the reader occupies a worker
+        m_pool.start(std::max<size_t>(nr_threads, 2));
+    }
+
+    ~ParallelTensorLoader() {
+        m_stop = true;
+        wait_all();
+    }
+
+    //! add a tensor record; all records must be added before start()
+    void add(const fbs::Tensor* tensor, CompNode comp_node,
+             const TensorLayout& layout);
+
+    Record& record(size_t idx) { return m_records.at(idx); }
+
+    //! start reading the values from the current position of the file
+    void start();
+
+    //! wait for the value of a record with data
+    const HostTensorND& get(Record& rec);
+
+    /*!
+     * \brief wait for all the values, after which the file is positioned at
+     *      the end of the last value
+     */
+    void finish();
+
+private:
+    void read();
+    void read_value(Record& rec);
+    void decode_chunk(Record* rec, size_t idx);
+    void wait_all();
+
+    //! scratch buffer of the calling worker with at least \p size bytes
+    uint8_t* worker_buffer(size_t size);
+
+    InputFile& m_file;
+    std::deque<Record> m_records;
+    std::shared_future<void> m_reader;
+    //! futures of the chunk decoding tasks, only modified by the reader
+    std::vector<std::future<void>> m_decoders;
+    std::atomic_bool m_stop{false};
+    //! thread_local is not supported on ios, so the scratch buffers are
+    //! kept by thread id
+    std::mutex m_buffers_mtx;
+    std::unordered_map<std::thread::id, std::vector<uint8_t>> m_buffers;
+    FutureThreadPool<void> m_pool;
+};
+
+void GraphLoaderOSS::ParallelTensorLoader::add(const fbs::Tensor* tensor,
+                                               CompNode comp_node,
+                                               const TensorLayout& layout) {
+    mgb_assert(!m_reader.valid());
+    m_records.emplace_back();
+    auto&& rec = m_records.back();
+    rec.tensor = tensor;
+    rec.comp_node = comp_node;
+    rec.layout = layout;
+    if (comp_node.valid() &&
+        comp_node.mem_node() == CompNode::default_cpu().mem_node()) {
+        rec.value = HostTensorND{comp_node};
+    } else {
+        rec.value = HostTensorND{CompNode::default_cpu()};
+    }
+}
+
+void GraphLoaderOSS::ParallelTensorLoader::start() {
+    m_reader = m_pool.launch(&ParallelTensorLoader::read, this).share();
+}
+
+void GraphLoaderOSS::ParallelTensorLoader::read() {
+    size_t nr_read = 0;
+    MGB_TRY {
+        for (; nr_read < m_records.size() && !m_stop; ++nr_read) {
+            read_value(m_records[nr_read]);
+        }
+    }
+    MGB_CATCH(..., {
+        // wake up the waiters of the values not read; they would get the
+        // error from m_reader
+        for (size_t i = nr_read; i < m_records.size(); ++i) {
+            m_records[i].ready.set_value();
+        }
+        throw;
+    });
+}
+
+void GraphLoaderOSS::ParallelTensorLoader::read_value(Record& rec) {
+    auto tensor = rec.tensor;
+    if (!tensor->data_size()) {
+        return;
+    }
+    auto begin_pos = m_file.tell();
+    m_file.skip(tensor->offset());
+    if (tensor->compression()) {
+        auto compression = load_tensor_compression(tensor);
+        rec.blob = m_file.read_shared(tensor->data_size() - tensor->offset());
+        rec.value.dtype(rec.layout.dtype).resize(rec.layout);
+        rec.decoder = std::make_unique<tensor_compression::ChunkDecoder>(
+                rec.blob.data(), rec.blob.size(), compression, rec.value);
+    } else {
+        m_file.read_into_tensor(rec.value, rec.layout);
+        auto end_pos = begin_pos + tensor->data_size();
+        mgb_throw_if(m_file.tell() > end_pos, SerializationError,
+                     "tensor value exceeds its data size %u",
+                     tensor->data_size());
+        m_file.skip(end_pos - m_file.tell());
+    }
+
+    size_t nr_chunks = rec.decoder ? rec.decoder->nr_chunks() : 0;
+    if (!nr_chunks) {
+        rec.decoder.reset();
+        rec.loaded = true;
+        rec.ready.set_value();
+        return;
+    }
+    rec.nr_pending_chunks = nr_chunks;
+    for (size_t i = 0; i < nr_chunks; ++i) {
+        m_decoders.emplace_back(m_pool.launch(
+                &ParallelTensorLoader::decode_chunk, this, &rec, i));
+    }
+}
+
+void GraphLoaderOSS::ParallelTensorLoader::decode_chunk(Record* rec,
+                                                        size_t idx) {
+    // the record must be signaled after its last chunk even if decoding
+    // throws, otherwise get() would wait forever
+    struct FinishGuard {
+        Record* rec;
+        ~FinishGuard() {
+            if (--rec->nr_pending_chunks == 0) {
+                rec->decoder.reset();
+                rec->blob = {{}, 0};
+                rec->loaded = true;
+                rec->ready.set_value();
+            }
+        }
+    } finish_guard{rec};
+
+    if (m_stop) {
+        return;
+    }
+    MGB_TRY {
+        auto&& decoder = *rec->decoder;
+        if (!decoder.decode(idx, worker_buffer(decoder.buffer_size()))) {
+            rec->corrupted = true;
+        }
+    }
+    MGB_CATCH(..., {
+        if (!rec->has_error.exchange(true)) {
+            rec->error = std::current_exception();
+        }
+    });
+}
+
+uint8_t* GraphLoaderOSS::ParallelTensorLoader::worker_buffer(size_t size) {
+    if (!size) {
+        return nullptr;
+    }
+    std::vector<uint8_t>* buf;
+    {
+        MGB_LOCK_GUARD(m_buffers_mtx);
+        buf = &m_buffers[std::this_thread::get_id()];
+    }
+    if (buf->size() < size) {
+        buf->resize(size);
+    }
+    return buf->data();
+}
+
+const HostTensorND& GraphLoaderOSS::ParallelTensorLoader::get(Record& rec) {
+    mgb_assert(rec.tensor->data_size());
+    rec.ready_future.wait();
+    if (!rec.loaded) {
+        m_reader.get();
+        mgb_assert(0, "tensor value not loaded");
+    }
+    if (rec.has_error) {
+        std::rethrow_exception(rec.error);
+    }
+    mgb_throw_if(rec.corrupted, SerializationError,
+                 "corrupted compressed tensor value");
+    return rec.value;
+}
+
+void GraphLoaderOSS::ParallelTensorLoader::finish() {
+    wait_all();
+    m_reader.get();
+}
+
+void GraphLoaderOSS::ParallelTensorLoader::wait_all() {
+    if (m_reader.valid()) {
+        m_reader.wait();
+    }
+    for (auto&& i : m_decoders) {
+        i.wait();
+    }
+}
+#endif  // MGB_HAVE_THREAD
+
 class GraphLoaderOSS::OprLoadContextImpl final
         : public OprLoadContextFlatBuffers {
     GraphLoaderOSS* const m_loader;
@@ -508,7 +791,15 @@ class GraphLoaderOSS::OprLoadContextImpl final
     LoadResult::TensorMap m_tensor_map;
     VarNodeArray m_id2varnode;
     BatchedDeviceValueLoader m_device_value_loader;
+    //! created on demand to decode compressed tensor values
+    std::unique_ptr<ThreadPool> m_load_thread_pool;
+#if MGB_HAVE_THREAD
+    //! loader of all tensor values in parallel_tensor_load mode
+    std::unique_ptr<ParallelTensorLoader> m_parallel_tensor_loader;
+#endif
     const fbs::Operator* m_current_opr;
+    //! index of the first tensor of current opr among tensors of all oprs
+    size_t m_cur_opr_tensor_begin = 0;
     size_t m_cur_opr_tensor_cnt;
     size_t m_cur_opr_blob_cnt;
     size_t m_cur_opr_param_cnt;
@@ -519,9 +810,32 @@ class GraphLoaderOSS::OprLoadContextImpl final
         return *m_loader->m_cur_load_config;
     }
 
+#if MGB_HAVE_THREAD
+    //! whether tensor values should be loaded by ParallelTensorLoader
+    bool parallel_tensor_load_enabled() const;
+
+    //! add all tensors to a new ParallelTensorLoader and start it
+    void index_tensors();
+
+    //! record of the tensor last fetched by current opr
+    ParallelTensorLoader::Record& cur_tensor_record() {
+        return m_parallel_tensor_loader->record(m_cur_opr_tensor_begin +
+                                                m_cur_opr_tensor_cnt - 1);
+    }
+#endif
+
+    void load_tensor_meta(const fbs::Tensor* tensor, CompNode& comp_node,
+                          TensorLayout& layout);
+
     void load_tensor_value(HostTensorND* dest, const TensorLayout& layout,
                            const fbs::Tensor* tensor);
 
+    void load_compressed_tensor_value(HostTensorND* dest,
+                                      const TensorLayout& layout,
+                                      const fbs::Tensor* tensor);
+
+    ThreadPool* load_thread_pool();
+
     std::shared_ptr<HostTensorND> load_tensor() override;
 
     std::shared_ptr<DeviceTensorND> load_tensor_shared() override;
@@ -619,14 +933,87 @@ TensorLayout load_tensor_layout(const fbs::Tensor* tensor) {
     return layout;
 }
 
+#if MGB_HAVE_THREAD
+bool GraphLoaderOSS::OprLoadContextImpl::parallel_tensor_load_enabled()
+        const {
+    if (!config().parallel_tensor_load || config().tensor_value_loader) {
+        return false;
+    }
+    // values cached by a previous load are skipped, which is only done
+    // sequentially
+    for (auto&& i : m_loader->m_shared_tensor_map) {
+        if (!i.second.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GraphLoaderOSS::OprLoadContextImpl::index_tensors() {
+    size_t nr_threads = config().nr_load_threads;
+    if (!nr_threads) {
+        nr_threads = std::max(sys::get_cpu_count(), 1);
+    }
+    auto loader = std::make_unique<ParallelTensorLoader>(*m_loader->m_file,
+                                                         nr_threads);
+    const auto* oprs = m_loader->m_graph->oprs();
+    for (flatbuffers::uoffset_t i = 0; i < oprs->size(); ++i) {
+        const auto* tensors = oprs->Get(i)->tensors();
+        if (!tensors) {
+            continue;
+        }
+        for (flatbuffers::uoffset_t j = 0; j < tensors->size(); ++j) {
+            auto tensor = tensors->Get(j);
+            loader->add(tensor, load_comp_node(tensor->comp_node()),
+                        load_tensor_layout(tensor));
+        }
+    }
+    loader->start();
+    m_parallel_tensor_loader = std::move(loader);
+}
+#endif
+
+void GraphLoaderOSS::OprLoadContextImpl::load_tensor_meta(
+        const fbs::Tensor* tensor, CompNode& comp_node, TensorLayout& layout) {
+#if MGB_HAVE_THREAD
+    if (m_parallel_tensor_loader) {
+        auto&& rec = cur_tensor_record();
+        mgb_assert(rec.tensor == tensor);
+        comp_node = rec.comp_node;
+        layout = rec.layout;
+        return;
+    }
+#endif
+    comp_node = load_comp_node(tensor->comp_node());
+    layout = load_tensor_layout(tensor);
+}
+
 void GraphLoaderOSS::OprLoadContextImpl::load_tensor_value(
         HostTensorND* dest, const TensorLayout& layout,
         const fbs::Tensor* tensor) {
+#if MGB_HAVE_THREAD
+    if (m_parallel_tensor_loader) {
+        auto&& value = m_parallel_tensor_loader->get(cur_tensor_record());
+        if (dest) {
+            if (dest->comp_node() == value.comp_node()) {
+                *dest = value;
+            } else {
+                dest->copy_from(value);
+            }
+        }
+        return;
+    }
+#endif
     auto&& loader = m_loader->m_cur_load_config->tensor_value_loader;
     auto&& file = m_loader->m_file;
     auto begin_pos = file->tell();
     file->skip(tensor->offset());
-    if (loader) {
+    if (tensor->compression()) {
+        mgb_throw_if(loader, SerializationError,
+                     "compressed tensor values can not be loaded by custom "
+                     "tensor value loader");
+        load_compressed_tensor_value(dest, layout, tensor);
+    } else if (loader) {
         // call custom loader
         void* dest_ptr = nullptr;
         if (dest) {
@@ -659,13 +1046,44 @@ void GraphLoaderOSS::OprLoadContextImpl::load_tensor_value(
     }
 }
 
+void GraphLoaderOSS::OprLoadContextImpl::load_compressed_tensor_value(
+        HostTensorND* dest, const TensorLayout& layout,
+        const fbs::Tensor* tensor) {
+    auto&& file = m_loader->m_file;
+    auto compression = load_tensor_compression(tensor);
+    size_t size = tensor->data_size() - tensor->offset();
+    if (!dest) {
+        file->skip(size);
+        return;
+    }
+    dest->dtype(layout.dtype).resize(layout);
+    auto buf = file->read_shared(size);
+    tensor_compression::load(buf.data(), buf.size(), compression, *dest,
+                             load_thread_pool());
+}
+
+ThreadPool* GraphLoaderOSS::OprLoadContextImpl::load_thread_pool() {
+    if (!m_load_thread_pool) {
+        size_t nr_threads = config().nr_load_threads;
+        if (!nr_threads) {
+            nr_threads = std::max(sys::get_cpu_count(), 1);
+        }
+        if (nr_threads == 1) {
+            return nullptr;
+        }
+        m_load_thread_pool = std::make_unique<ThreadPool>(nr_threads);
+    }
+    return m_load_thread_pool.get();
+}
+
 std::shared_ptr<HostTensorND>
 GraphLoaderOSS::OprLoadContextImpl::load_tensor() {
     mgb_assert(m_current_opr->tensors() &&
                m_cur_opr_tensor_cnt < m_current_opr->tensors()->size());
     auto tensor = m_current_opr->tensors()->Get(m_cur_opr_tensor_cnt++);
-    auto comp_node = load_comp_node(tensor->comp_node());
-    auto layout = load_tensor_layout(tensor);
+    CompNode comp_node;
+    TensorLayout layout;
+    load_tensor_meta(tensor, comp_node, layout);
     auto ret = std::make_shared<HostTensorND>(comp_node, layout);
     if (tensor->data_size()) {
         load_tensor_value(ret.get(), layout, tensor);
@@ -685,8 +1103,9 @@ GraphLoaderOSS::OprLoadContextImpl::load_tensor_shared() {
     mgb_assert(m_current_opr->tensors() &&
                m_cur_opr_tensor_cnt < m_current_opr->tensors()->size());
     auto tensor = m_current_opr->tensors()->Get(m_cur_opr_tensor_cnt++);
-    auto comp_node = load_comp_node(tensor->comp_node());
-    auto layout = load_tensor_layout(tensor);
+    CompNode comp_node;
+    TensorLayout layout;
+    load_tensor_meta(tensor, comp_node, layout);
     mgb_assert(tensor->data_size());
     auto&& sh_reg = m_loader->m_shared_tensor_map.at(m_cur_shared_tensor_idx++);
     auto&& sh_ptr_ref = sh_reg.second[comp_node.mem_node()];
@@ -807,6 +1226,16 @@ void GraphLoaderOSS::OprLoadContextImpl::load_single_opr(
 }
 
 GraphLoader::LoadResult GraphLoaderOSS::OprLoadContextImpl::load_oprs() {
+    LoadResult ret;
+    RealTimer timer;
+#if MGB_HAVE_THREAD
+    if (parallel_tensor_load_enabled()) {
+        index_tensors();
+        ret.phase_time.index_tensors = timer.get_msecs_reset();
+        ret.parallel_tensor_load = true;
+    }
+#endif
+
     // load oprs
     const auto* oprs = m_loader->m_graph->oprs();
     {
@@ -814,16 +1243,33 @@ GraphLoader::LoadResult GraphLoaderOSS::OprLoadContextImpl::load_oprs() {
         // it tries to restore the same graph as it was dumped
         // see test TestSerializer2.LOGEXP for example
         GraphLoader::ScopedGraphOptDisabler _(m_graph);
+        m_cur_opr_tensor_begin = 0;
         for (flatbuffers::uoffset_t i = 0; i < oprs->size(); ++i) {
             m_current_opr = oprs->Get(i);
             load_single_opr(m_current_opr);
+            if (m_current_opr->tensors()) {
+                m_cur_opr_tensor_begin += m_current_opr->tensors()->size();
+            }
         }
     }
+    ret.phase_time.load_oprs = timer.get_msecs_reset();
+
+    ThreadPool* copy_pool = nullptr;
+#if MGB_HAVE_THREAD
+    if (m_parallel_tensor_loader) {
+        m_parallel_tensor_loader->finish();
+        m_parallel_tensor_loader.reset();
+        ret.phase_time.wait_tensors = timer.get_msecs_reset();
+        if (!m_device_value_loader.empty()) {
+            copy_pool = load_thread_pool();
+        }
+    }
+#endif
 
     // batched loading device values
-    m_device_value_loader.apply();
+    m_device_value_loader.apply(copy_pool);
+    ret.phase_time.copy_to_device = timer.get_msecs_reset();
 
-    LoadResult ret;
     ret.graph = m_graph;
     ret.tensor_map = m_tensor_map;
 
@@ -843,6 +1289,7 @@ GraphLoader::LoadResult GraphLoaderOSS::OprLoadContextImpl::load_oprs() {
 GraphLoader::LoadResult GraphLoaderOSS::load(const LoadConfig& config,
                                                    bool rewind) {
     mgb_assert(m_file);
+    RealTimer timer;
     m_cur_load_config = &config;
     if (rewind) {
         m_file->rewind();
@@ -909,10 +1356,12 @@ GraphLoader::LoadResult GraphLoaderOSS::load(const LoadConfig& config,
         mgb_assert(m_shared_tensor_map.size() == m_graph->nr_shared_tensor());
     }
 
+    auto read_graph_time = timer.get_msecs();
     OprLoadContextImpl ctx{this, m_graph->mgb_version()};
     auto metadata = ctx.load_metadata();
     auto result = ctx.load_oprs();
     result.metadata = metadata;
+    result.phase_time.read_graph = read_graph_time;
 
     auto fbs_end = tensor_begin + offset_to_fbs + sizeof(size) + size;
     auto cur = m_file->tell();
@@ -0,0 +1,468 @@
+/**
+ * \file src/serialization/impl/tensor_compression.cpp
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+/*
+ * Compressed tensor value blob:
+ * [uint32_t compressed size of chunk 1]
+ * [...]
+ * [uint32_t compressed size of chunk N]
+ * [float scale of channel 1 ... channel C]   (INT8 encoding only)
+ * [chunk 1]
+ * [...]
+ * [chunk N]
+ *
+ * The encoded value (raw bytes, float16 or int8 values) is split into chunks
+ * of chunk_size bytes, each compressed independently. A chunk is stored
+ * uncompressed if compression does not make it smaller.
+ */
+
+#include "tensor_compression.h"
+
+#include "megbrain/serialization/serializer.h"
+#include "megbrain/utils/thread_pool.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace mgb;
+using namespace serialization;
+using namespace tensor_compression;
+
+namespace {
+
+using Codec = ParamCompression::Codec;
+using Encoding = ParamCompression::Encoding;
+
+/* ======================= LZ4 block format ======================= */
+
+constexpr size_t LZ4_MIN_MATCH = 4;
+//! the last match must start at least 12 bytes before the end of block
+constexpr size_t LZ4_MFLIMIT = 12;
+//! the last 5 bytes are always literals
+constexpr size_t LZ4_LAST_LITERALS = 5;
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+constexpr int LZ4_HASH_LOG = 14;
+
+uint32_t read_u32(const uint8_t* ptr) {
+    uint32_t ret;
+    memcpy(&ret, ptr, sizeof(ret));
+    return ret;
+}
+
+uint32_t lz4_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+uint8_t* lz4_write_len(uint8_t* op, size_t len) {
+    for (; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+//! write literals and, if \p match_len is not zero, a match
+uint8_t* lz4_write_sequence(uint8_t* op, const uint8_t* literal,
+                            size_t literal_len, size_t offset,
+                            size_t match_len) {
+    uint8_t* token = op++;
+    *token = static_cast<uint8_t>(std::min<size_t>(literal_len, 15) << 4);
+    if (literal_len >= 15) {
+        op = lz4_write_len(op, literal_len - 15);
+    }
+    memcpy(op, literal, literal_len);
+    op += literal_len;
+    if (match_len) {
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        match_len -= LZ4_MIN_MATCH;
+        *token |= static_cast<uint8_t>(std::min<size_t>(match_len, 15));
+        if (match_len >= 15) {
+            op = lz4_write_len(op, match_len - 15);
+        }
+    }
+    return op;
+}
+
+/* ======================= encodings ======================= */
+
+//! number of scales for INT8 encoding, one for each slice of the first axis
+size_t get_nr_scales(const TensorLayout& layout) {
+    return layout.ndim >= 2 ? layout.shape[0] : 1;
+}
+
+size_t get_encoded_size(const TensorLayout& layout, Encoding encoding) {
+    switch (encoding) {
+        case Encoding::RAW:
+            return layout.span().high_byte;
+        case Encoding::FLOAT16:
+            return layout.total_nr_elems() * 2;
+        case Encoding::INT8:
+            return layout.total_nr_elems();
+    }
+    mgb_throw(SerializationError, "invalid tensor encoding: %d",
+              static_cast<int>(encoding));
+}
+
+void check_encoding(const TensorLayout& layout, Encoding encoding) {
+    if (encoding == Encoding::RAW) {
+        return;
+    }
+    mgb_throw_if(layout.dtype != dtype::Float32(), SerializationError,
+                 "weight-only encoding %d requires float32 tensor, got %s",
+                 static_cast<int>(encoding), layout.dtype.name());
+#ifdef MEGDNN_DISABLE_FLOAT16
+    mgb_throw_if(encoding == Encoding::FLOAT16, SerializationError,
+                 "float16 tensor encoding is not supported as float16 is "
+                 "disabled");
+#endif
+}
+
+/*!
+ * \brief dequantize the encoded values in [begin, begin + size) bytes of the
+ *      encoded stream
+ */
+void decode_values(Encoding encoding, const uint8_t* src, size_t begin,
+                   size_t size, const float* scales, size_t channel_size,
+                   float* dest) {
+    if (encoding == Encoding::FLOAT16) {
+#ifndef MEGDNN_DISABLE_FLOAT16
+        auto fp16 = reinterpret_cast<const dt_float16*>(src);
+        dest += begin / 2;
+        for (size_t i = 0, it = size / 2; i < it; ++i) {
+            dest[i] = static_cast<float>(fp16[i]);
+        }
+#endif
+        return;
+    }
+    auto q = reinterpret_cast<const int8_t*>(src) - begin;
+    for (size_t i = begin, end = begin + size; i < end;) {
+        size_t channel = i / channel_size;
+        size_t channel_end = std::min(end, (channel + 1) * channel_size);
+        float scale = scales[channel];
+        for (; i < channel_end; ++i) {
+            dest[i] = q[i] * scale;
+        }
+    }
+}
+
+}  // anonymous namespace
+
+size_t tensor_compression::lz4_compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t tensor_compression::lz4_compress(const void* src_ptr, size_t size,
+                                        void* dst_ptr) {
+    mgb_assert(size <= std::numeric_limits<uint32_t>::max());
+    auto src = static_cast<const uint8_t*>(src_ptr);
+    auto op = static_cast<uint8_t*>(dst_ptr);
+    size_t anchor = 0;
+    if (size > LZ4_MFLIMIT) {
+        std::vector<uint32_t> table(1 << LZ4_HASH_LOG, 0);
+        size_t ip_limit = size - LZ4_MFLIMIT,
+               match_limit = size - LZ4_LAST_LITERALS;
+        for (size_t ip = 0; ip < ip_limit;) {
+            uint32_t seq = read_u32(src + ip);
+            auto&& entry = table[lz4_hash(seq)];
+            size_t ref = entry;
+            entry = ip;
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET ||
+                read_u32(src + ref) != seq) {
+                // skip faster in incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            while (ip > anchor && ref && src[ip - 1] == src[ref - 1]) {
+                --ip;
+                --ref;
+            }
+            size_t len = LZ4_MIN_MATCH;
+            while (ip + len < match_limit && src[ip + len] == src[ref + len]) {
+                ++len;
+            }
+            op = lz4_write_sequence(op, src + anchor, ip - anchor, ip - ref,
+                                    len);
+            ip += len;
+            anchor = ip;
+        }
+    }
+    op = lz4_write_sequence(op, src + anchor, size - anchor, 0, 0);
+    return op - static_cast<uint8_t*>(dst_ptr);
+}
+
+bool tensor_compression::lz4_decompress(const void* src, size_t src_size,
+                                        void* dst, size_t dst_size) {
+    auto ip = static_cast<const uint8_t*>(src), iend = ip + src_size;
+    auto ostart = static_cast<uint8_t*>(dst), op = ostart,
+         oend = ostart + dst_size;
+    auto read_len = [&](size_t len, size_t& ret) {
+        if (len == 15) {
+            uint8_t byte;
+            do {
+                if (ip == iend) {
+                    return false;
+                }
+                byte = *ip++;
+                len += byte;
+            } while (byte == 255);
+        }
+        ret = len;
+        return true;
+    };
+    for (;;) {
+        if (ip == iend) {
+            return false;
+        }
+        uint8_t token = *ip++;
+        size_t literal_len, match_len;
+        if (!read_len(token >> 4, literal_len) ||
+            literal_len > static_cast<size_t>(iend - ip) ||
+            literal_len > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        memcpy(op, ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == iend) {
+            // the last sequence has only literals
+            return op == oend;
+        }
+        if (iend - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > static_cast<size_t>(op - ostart) ||
+            !read_len(token & 15, match_len)) {
+            return false;
+        }
+        match_len += LZ4_MIN_MATCH;
+        if (match_len > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        const uint8_t* match = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            // overlapped copy repeats the last offset bytes
+            for (size_t i = 0; i < match_len; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+}
+
+ParamCompression tensor_compression::get_compression(
+        const TensorLayout& layout, const ParamCompression& config) {
+    mgb_assert(config.chunk_size && config.chunk_size % 4 == 0,
+               "chunk size of param compression must be a positive multiple "
+               "of 4, got %u",
+               config.chunk_size);
+    ParamCompression ret = config;
+    if (layout.dtype != dtype::Float32()) {
+        ret.encoding = Encoding::RAW;
+    }
+    if (!layout.total_nr_elems() ||
+        layout.span().high_byte < config.min_size) {
+        ret.codec = Codec::NONE;
+        ret.encoding = Encoding::RAW;
+    }
+    return ret;
+}
+
+void tensor_compression::dump(OutputFile& fout, const HostTensorND& tensor,
+                              const ParamCompression& compression) {
+    auto&& layout = tensor.layout();
+    auto encoding = compression.encoding;
+    check_encoding(layout, encoding);
+
+    // encode
+    size_t nr_elems = layout.total_nr_elems();
+    auto encoded = reinterpret_cast<const uint8_t*>(tensor.raw_ptr());
+    std::unique_ptr<uint8_t[]> encoded_storage;
+    std::vector<float> scales;
+    if (encoding != Encoding::RAW) {
+        encoded_storage.reset(
+                new uint8_t[get_encoded_size(layout, encoding)]);
+        encoded = encoded_storage.get();
+        auto src = tensor.ptr<float>();
+        if (encoding == Encoding::FLOAT16) {
+#ifndef MEGDNN_DISABLE_FLOAT16
+            auto dst = reinterpret_cast<dt_float16*>(encoded_storage.get());
+            for (size_t i = 0; i < nr_elems; ++i) {
+                dst[i] = static_cast<dt_float16>(src[i]);
+            }
+#endif
+        } else {
+            auto dst = reinterpret_cast<int8_t*>(encoded_storage.get());
+            scales.resize(get_nr_scales(layout));
+            size_t channel_size = nr_elems / scales.size();
+            for (size_t c = 0; c < scales.size(); ++c) {
+                auto x = src + c * channel_size;
+                auto q = dst + c * channel_size;
+                float amax = 0;
+                for (size_t i = 0; i < channel_size; ++i) {
+                    amax = std::max(amax, std::abs(x[i]));
+                }
+                float inv_scale = amax > 0 ? 127.f / amax : 0.f;
+                for (size_t i = 0; i < channel_size; ++i) {
+                    float v = std::round(x[i] * inv_scale);
+                    q[i] = static_cast<int8_t>(
+                            std::min(std::max(v, -127.f), 127.f));
+                }
+                scales[c] = amax / 127.f;
+            }
+        }
+    }
+
+    // compress chunks
+    size_t encoded_size = get_encoded_size(layout, encoding),
+           chunk_size = compression.chunk_size,
+           nr_chunks = (encoded_size + chunk_size - 1) / chunk_size;
+    std::vector<uint32_t> chunk_sizes(nr_chunks);
+    std::vector<uint8_t> chunks;
+    std::unique_ptr<uint8_t[]> compressed;
+    if (compression.codec == Codec::LZ4) {
+        compressed.reset(new uint8_t[lz4_compress_bound(chunk_size)]);
+    }
+    for (size_t i = 0; i < nr_chunks; ++i) {
+        size_t begin = i * chunk_size,
+               size = std::min(chunk_size, encoded_size - begin);
+        const uint8_t* data = encoded + begin;
+        if (compressed) {
+            size_t csize = lz4_compress(data, size, compressed.get());
+            if (csize < size) {
+                data = compressed.get();
+                size = csize;
+            }
+        }
+        chunk_sizes[i] = size;
+        chunks.insert(chunks.end(), data, data + size);
+    }
+
+    fout.write(chunk_sizes.data(), chunk_sizes.size() * sizeof(uint32_t));
+    fout.write(scales.data(), scales.size() * sizeof(float));
+    fout.write(chunks.data(), chunks.size());
+}
+
+tensor_compression::ChunkDecoder::ChunkDecoder(
+        const void* data, size_t size, const ParamCompression& compression,
+        HostTensorND& dest)
+        : m_compression{compression},
+          m_data{static_cast<const uint8_t*>(data)} {
+    auto&& layout = dest.layout();
+    auto codec = compression.codec;
+    auto encoding = compression.encoding;
+    size_t chunk_size = compression.chunk_size;
+    mgb_throw_if(codec != Codec::NONE && codec != Codec::LZ4,
+                 SerializationError, "unknown tensor codec: %d",
+                 static_cast<int>(codec));
+    mgb_throw_if(!chunk_size || chunk_size % 4, SerializationError,
+                 "invalid chunk size of compressed tensor: %zu", chunk_size);
+    check_encoding(layout, encoding);
+
+    // parse the header
+    m_encoded_size = get_encoded_size(layout, encoding);
+    size_t nr_chunks = (m_encoded_size + chunk_size - 1) / chunk_size,
+           nr_scales = encoding == Encoding::INT8 ? get_nr_scales(layout) : 0,
+           header_size = (nr_chunks + nr_scales) * sizeof(uint32_t);
+    mgb_throw_if(size < header_size, SerializationError,
+                 "compressed tensor value too small: size=%zu header=%zu",
+                 size, header_size);
+    m_chunk_sizes.resize(nr_chunks);
+    m_chunk_offsets.resize(nr_chunks);
+    m_scales.resize(nr_scales);
+    memcpy(m_chunk_sizes.data(), m_data, nr_chunks * sizeof(uint32_t));
+    memcpy(m_scales.data(), m_data + nr_chunks * sizeof(uint32_t),
+           nr_scales * sizeof(float));
+    size_t offset = header_size;
+    for (size_t i = 0; i < nr_chunks; ++i) {
+        size_t max_size =
+                std::min(chunk_size, m_encoded_size - i * chunk_size);
+        m_chunk_offsets[i] = offset;
+        offset += m_chunk_sizes[i];
+        mgb_throw_if(m_chunk_sizes[i] > max_size, SerializationError,
+                     "invalid size of compressed chunk %zu: %u", i,
+                     m_chunk_sizes[i]);
+    }
+    mgb_throw_if(offset != size, SerializationError,
+                 "size mismatch of compressed tensor value: expected %zu, "
+                 "got %zu",
+                 offset, size);
+
+    m_dest = reinterpret_cast<uint8_t*>(dest.raw_ptr());
+    if (encoding != Encoding::RAW) {
+        m_dest_float = dest.ptr<float>();
+    }
+    m_channel_size = nr_scales ? layout.total_nr_elems() / nr_scales : 0;
+}
+
+size_t tensor_compression::ChunkDecoder::buffer_size() const {
+    return m_compression.encoding != Encoding::RAW ? m_compression.chunk_size
+                                                   : 0;
+}
+
+bool tensor_compression::ChunkDecoder::decode(size_t idx,
+                                              uint8_t* buffer) const {
+    // encoded values other than raw ones are decompressed into the buffer and
+    // then dequantized
+    auto encoding = m_compression.encoding;
+    size_t chunk_size = m_compression.chunk_size,
+           begin = idx * chunk_size,
+           size = std::min(chunk_size, m_encoded_size - begin);
+    const uint8_t* src = m_data + m_chunk_offsets.at(idx);
+    uint8_t* encoded = encoding != Encoding::RAW ? buffer : m_dest + begin;
+    if (m_chunk_sizes[idx] == size) {
+        memcpy(encoded, src, size);
+    } else if (m_compression.codec != Codec::LZ4 ||
+               !lz4_decompress(src, m_chunk_sizes[idx], encoded, size)) {
+        return false;
+    }
+    if (encoding != Encoding::RAW) {
+        decode_values(encoding, encoded, begin, size, m_scales.data(),
+                      m_channel_size, m_dest_float);
+    }
+    return true;
+}
+
+void tensor_compression::load(const void* data, size_t size,
+                              const ParamCompression& compression,
+                              HostTensorND& dest, ThreadPool* pool) {
+    ChunkDecoder decoder{data, size, compression, dest};
+    size_t nr_chunks = decoder.nr_chunks();
+    std::vector<std::unique_ptr<uint8_t[]>> buffers(
+            pool ? pool->nr_threads() : 1);
+    std::atomic_bool corrupted{false};
+    auto decode_chunk = [&](size_t idx, size_t thread_id) {
+        auto&& buf = buffers.at(thread_id);
+        if (!buf && decoder.buffer_size()) {
+            buf.reset(new uint8_t[decoder.buffer_size()]);
+        }
+        if (!decoder.decode(idx, buf.get())) {
+            corrupted = true;
+        }
+    };
+    if (pool && nr_chunks > 1) {
+        pool->add_task({decode_chunk, nr_chunks});
+    } else {
+        for (size_t i = 0; i < nr_chunks; ++i) {
+            decode_chunk(i, 0);
+        }
+    }
+    mgb_throw_if(corrupted, SerializationError,
+                 "corrupted compressed tensor value");
+}
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -0,0 +1,111 @@
+/**
+ * \file src/serialization/impl/tensor_compression.h
+ * MegEngine is Licensed under the Apache License, Version 2.0 (the "License")
+ *
+ * Copyright (c) 2014-2021 Megvii Inc. All rights reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT ARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ */
+#pragma once
+
+#include "megbrain/serialization/file.h"
+#include "megbrain/serialization/load_dump_config.h"
+#include "megbrain/tensor.h"
+
+namespace mgb {
+class ThreadPool;
+
+namespace serialization {
+namespace tensor_compression {
+
+using ParamCompression = GraphDumpConfig::ParamCompression;
+
+//! max size of the output of lz4_compress() for \p size bytes of input
+size_t lz4_compress_bound(size_t size);
+
+/*!
+ * \brief compress into a block of the LZ4 block format
+ * \param dst buffer of at least lz4_compress_bound(size) bytes
+ * \return number of bytes written to \p dst
+ */
+size_t lz4_compress(const void* src, size_t size, void* dst);
+
+/*!
+ * \brief decompress an LZ4 block which should decode to exactly
+ *      \p dst_size bytes
+ * \return false if the block is malformed
+ */
+bool lz4_decompress(const void* src, size_t src_size, void* dst,
+                    size_t dst_size);
+
+/*!
+ * \brief the compression actually applied to a tensor for the requested
+ *      \p config
+ *
+ * Weight-only encodings fall back to RAW for tensors other than float32;
+ * the result is disabled if the tensor should be stored as is.
+ */
+ParamCompression get_compression(const TensorLayout& layout,
+                                 const ParamCompression& config);
+
+/*!
+ * \brief write the compressed value blob of \p tensor
+ * \param compression the compression returned by get_compression()
+ */
+void dump(OutputFile& fout, const HostTensorND& tensor,
+          const ParamCompression& compression);
+
+/*!
+ * \brief decoder of a compressed value blob written by dump(), whose chunks
+ *      can be decoded concurrently
+ */
+class ChunkDecoder {
+public:
+    /*!
+     * \brief parse and check the header of the blob
+     * \param dest tensor with the original dtype and contiguous layout; both
+     *      \p data and \p dest must be kept alive until the chunks are decoded
+     */
+    ChunkDecoder(const void* data, size_t size,
+                 const ParamCompression& compression, HostTensorND& dest);
+
+    size_t nr_chunks() const { return m_chunk_sizes.size(); }
+
+    //! size of the scratch buffer needed by decode(), or 0 if not needed
+    size_t buffer_size() const;
+
+    /*!
+     * \brief decode a chunk into the dest tensor
+     * \param buffer scratch buffer of buffer_size() bytes, which must not be
+     *      shared by concurrent calls
+     * \return false if the chunk is corrupted
+     */
+    bool decode(size_t idx, uint8_t* buffer) const;
+
+private:
+    const ParamCompression m_compression;
+    const uint8_t* const m_data;
+    uint8_t* m_dest = nullptr;
+    float* m_dest_float = nullptr;
+    size_t m_encoded_size = 0, m_channel_size = 0;
+    std::vector<uint32_t> m_chunk_sizes;
+    std::vector<size_t> m_chunk_offsets;
+    std::vector<float> m_scales;
+};
+
+/*!
+ * \brief decode a compressed value blob written by dump()
+ * \param dest tensor with the original dtype and contiguous layout
+ * \param pool thread pool to decode the chunks in parallel, or null to
+ *      decode them on the caller thread
+ */
+void load(const void* data, size_t size, const ParamCompression& compression,
+          HostTensorND& dest, ThreadPool* pool);
+
+}  // namespace tensor_compression
+}  // namespace serialization
+}  // namespace mgb
+
+// vim: syntax=cpp.doxygen foldmethod=marker foldmarker=f{{{,f}}}
@@ -34,6 +34,7 @@ public:
 //! abstract input file interface
 class InputFile {
     class FsImpl;
+    class MmapImpl;
     class MemProxyImpl;
     class SharedMemProxyImpl;
 
@@ -75,6 +76,19 @@ public:
     //! create an InputFile correspoding to a file on local file system
     static std::unique_ptr<InputFile> make_fs(const char* path);
 
+    /*!
+     * \brief create an InputFile that maps a file on local file system into
+     *      memory
+     *
+     * read_shared() returns buffers aliasing the mapping, and
+     * read_into_tensor() makes the tensor storage alias the mapping if the
+     * value is aligned to the comp node requirement. The mapping is private
+     * and copy-on-write, so processes loading the same file share the
+     * physical pages until they are written to. On platforms without mmap
+     * this falls back to make_fs().
+     */
+    static std::unique_ptr<InputFile> make_mmap(const char* path);
+
     //! create an InputFile correspoding to a memory region; the memory
     //! region must be alive throughout lifespan of this InputFile
     static std::unique_ptr<InputFile> make_mem_proxy(const void* ptr,
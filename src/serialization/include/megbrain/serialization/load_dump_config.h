@@ -17,6 +17,40 @@ namespace mgb {
 namespace serialization {
 //! config for dumping a whole graph; setup in GraphDumper
 struct GraphDumpConfig {
+    /*!
+     * \brief how the values of params are stored, i.e. the VALUE_SHARED and
+     *      VALUE_ANONYMOUS tensors (like those of ImmutableTensor)
+     *
+     * Only used by the FlatBuffers format when no custom tensor_value_dumper
+     * is given. The encoded value is split into chunks that are compressed
+     * independently, so they can be decoded in parallel on load.
+     */
+    struct ParamCompression {
+        enum class Codec : uint8_t { NONE = 0, LZ4 = 1 };
+
+        //! weight-only encodings of float32 params, which are dequantized
+        //! to float32 on load; other dtypes are always stored as is
+        enum class Encoding : uint8_t {
+            RAW = 0,
+            FLOAT16 = 1,
+            //! symmetric int8 with a scale for each slice of the first axis
+            INT8 = 2
+        };
+
+        Codec codec = Codec::NONE;
+        Encoding encoding = Encoding::RAW;
+
+        //! bytes of encoded value in each chunk; must be a multiple of 4
+        uint32_t chunk_size = 1 << 20;
+
+        //! params with fewer bytes are always stored as is
+        size_t min_size = 1024;
+
+        bool enabled() const {
+            return codec != Codec::NONE || encoding != Encoding::RAW;
+        }
+    };
+
     /*!
      * \brief write tensor value (excluding metainfo like layout or dtype)
      *      to output file
@@ -54,6 +88,9 @@ struct GraphDumpConfig {
     //! tensor value without layout; useful for compression or encryption
     TensorValueDumper tensor_value_dumper;
 
+    //! compress or encode param values; disabled by default
+    ParamCompression param_compression;
+
     //! a list of output nodes and names. one output node may have multiple
     //! names. this list record the mapping between output node and it's name
     std::vector<std::pair<std::string, SymbolVar>> alias_name_map;
@@ -133,6 +170,22 @@ struct GraphLoadConfig {
     //! GraphDumpConfig
     TensorValueLoader tensor_value_loader;
 
+    //! number of threads to decode compressed tensor values, or to load
+    //! tensor values in parallel_tensor_load mode; 0 for the number of CPU
+    //! cores
+    size_t nr_load_threads = 0;
+
+    /*!
+     * \brief whether to index all the tensor values first, and then read,
+     *      decode and copy them on worker threads while the oprs are being
+     *      constructed
+     *
+     * This is only supported by the FlatBuffers format. It is ignored if
+     * threads are disabled, if tensor_value_loader is set, or if the shared
+     * tensor values have been cached by a previous load.
+     */
+    bool parallel_tensor_load = false;
+
     GraphLoadConfig(const CompNodeMapper& comp_node_mapper_ = {},
                     const OprLoaderMaker& opr_loader_maker_ = {},
                     const std::shared_ptr<UserDataContainer>& user_data_ = {},
@@ -55,6 +55,28 @@ namespace serialization {
                 //! GraphDumper::dump
                 SymbolVarArray output_var_list;
 
+                //! time in milliseconds spent in each phase of the load; only
+                //! filled by the FlatBuffers loader
+                struct PhaseTime {
+                    //! read and verify the graph
+                    double read_graph = 0;
+                    //! index the tensor values; only in parallel load mode
+                    double index_tensors = 0;
+                    //! construct the oprs, including the tensor values loaded
+                    //! on the caller thread
+                    double load_oprs = 0;
+                    //! wait for the tensor values still being loaded on
+                    //! worker threads after all oprs are constructed
+                    double wait_tensors = 0;
+                    //! copy the values of shared tensors to devices
+                    double copy_to_device = 0;
+                } phase_time;
+
+                //! whether the tensor values were loaded in
+                //! parallel_tensor_load mode, which may be ignored as
+                //! described in GraphLoadConfig
+                bool parallel_tensor_load = false;
+
                 /*!
                  * \brief call graph->compile() but also checks for comp seq rec
                  *
@@ -868,4 +868,331 @@ TEST(TestSerializer2, LOGEXP) {
     dump();
     load();
 }
+
+TEST(TestSerializer2, MmapLoad) {
+    auto fname = GET_OUTPUT_FILE();
+    auto cn = CompNode::load("cpu0");
+    TensorShape shape{64, 64};
+
+    HostTensorGenerator<> gen;
+    auto bias_hv = gen(shape, cn);
+    auto bias = std::make_shared<DeviceTensorND>();
+    bias->copy_from(*bias_hv);
+
+    {
+        auto host_x = std::make_shared<HostTensorND>(cn, shape);
+        auto graph = ComputingGraph::make();
+        auto x = opr::Host2DeviceCopy::make(*graph, host_x, {"x"}),
+             y = opr::SharedDeviceTensor::make(*graph, bias, {"y"});
+        auto dumper = GraphDumper::make(OutputFile::make_fs(fname.c_str()),
+                                        GraphDumpFormat::FLATBUFFERS);
+        dumper->dump({(x + y).rename("z")});
+    }
+
+    auto load = [&]() {
+        auto loader = GraphLoader::make(InputFile::make_mmap(fname.c_str()),
+                                        GraphDumpFormat::FLATBUFFERS);
+        auto rst = loader->load();
+        auto xv = rst.tensor_map.at("x");
+        *xv = *gen(shape, cn);
+        HostTensorND host_z, host_z_expect;
+        host_z_expect.copy_from(*xv);
+        for (size_t i = 0, it = shape.total_nr_elems(); i < it; ++i)
+            host_z_expect.ptr<float>()[i] += bias_hv->ptr<float>()[i];
+        auto func = rst.graph_compile(
+                {make_callback_copy(rst.output_var_map.at("z"), host_z)});
+        func->execute();
+        MGB_ASSERT_TENSOR_EQ(host_z_expect, host_z);
+    };
+
+    // the mapping must stay valid after the loader is destructed
+    load();
+    load();
+}
+
+TEST(TestSerializer2, MmapReadShared) {
+    auto fname = GET_OUTPUT_FILE();
+    std::vector<uint8_t> data(10000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = i * 7;
+    OutputFile::make_fs(fname.c_str())->write(data.data(), data.size());
+
+    auto fin = InputFile::make_mmap(fname.c_str());
+    uint8_t head[3];
+    fin->read(head, sizeof(head));
+    ASSERT_EQ(0, memcmp(head, data.data(), sizeof(head)));
+    auto buf0 = fin->read_shared(100);
+    auto buf1 = fin->read_shared(200);
+    ASSERT_EQ(303u, fin->tell());
+    ASSERT_EQ(0, memcmp(buf0.data(), data.data() + 3, 100));
+    ASSERT_EQ(static_cast<const uint8_t*>(buf0.data()) + 100, buf1.data());
+
+    HostTensorND val{CompNode::load("cpu0"), dtype::Float32()};
+    TensorLayout layout{{64}, dtype::Float32()};
+    fin->rewind();
+    fin->skip(1024);
+    fin->read_into_tensor(val, layout);
+    ASSERT_EQ(1024u + 256u, fin->tell());
+    ASSERT_EQ(0, memcmp(val.raw_ptr(), data.data() + 1024, 256));
+    // an aligned value is shared with the mapping
+    ASSERT_EQ(static_cast<const void*>(
+                      static_cast<const uint8_t*>(buf0.data()) + 1021),
+              static_cast<const void*>(val.raw_ptr()));
+
+    fin.reset();
+    ASSERT_EQ(0, memcmp(buf1.data(), data.data() + 103, 200));
+}
+
+namespace {
+using ParamCompression = GraphDumpConfig::ParamCompression;
+
+/*!
+ * dump the tensors as params with \p compression, alternately by
+ * SharedDeviceTensor and ImmutableTensor, and load them back
+ *
+ * \param value_bytes bytes of the dumped tensor values
+ */
+std::vector<HostTensorND> dump_load_compressed_params(
+        const std::string& fname,
+        const std::vector<std::shared_ptr<HostTensorND>>& tensors,
+        const ParamCompression& compression, size_t nr_load_threads,
+        size_t& value_bytes) {
+    {
+        auto graph = ComputingGraph::make();
+        SymbolVarArray outputs;
+        for (size_t i = 0; i < tensors.size(); ++i) {
+            if (i % 2) {
+                outputs.push_back(
+                        opr::ImmutableTensor::make(*graph, *tensors[i]));
+            } else {
+                outputs.push_back(
+                        opr::SharedDeviceTensor::make(*graph, *tensors[i]));
+            }
+        }
+        GraphDumper::DumpConfig config;
+        config.param_compression = compression;
+        value_bytes = GraphDumper::make(OutputFile::make_fs(fname.c_str()),
+                                        GraphDumpFormat::FLATBUFFERS)
+                              ->dump(outputs, config)
+                              .tensor_value_bytes;
+    }
+    auto loader = GraphLoader::make(InputFile::make_fs(fname.c_str()),
+                                    GraphDumpFormat::FLATBUFFERS);
+    GraphLoader::LoadConfig config;
+    config.nr_load_threads = nr_load_threads;
+    auto rst = loader->load(config);
+    std::vector<HostTensorND> ret(tensors.size());
+    ComputingGraph::OutputSpec out_spec;
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        out_spec.push_back(
+                make_callback_copy(rst.output_var_list.at(i), ret[i]));
+    }
+    rst.graph_compile(out_spec)->execute();
+    return ret;
+}
+}  // anonymous namespace
+
+TEST(TestSerializer2, CompressedParamLZ4) {
+    auto fname = GET_OUTPUT_FILE();
+    auto cn = CompNode::load("cpu0");
+    HostTensorGenerator<> gen;
+    auto smooth = std::make_shared<HostTensorND>(cn, TensorShape{32, 100});
+    for (size_t i = 0; i < 3200; ++i) {
+        smooth->ptr<float>()[i] = (i % 100) * 0.5f;
+    }
+    auto ints = std::make_shared<HostTensorND>(cn, TensorShape{5000},
+                                               dtype::Int32());
+    for (size_t i = 0; i < 5000; ++i) {
+        ints->ptr<int>()[i] = i / 3;
+    }
+    std::vector<std::shared_ptr<HostTensorND>> tensors{
+            smooth, gen({3, 1000}, cn), ints, gen({4}, cn), gen({7, 9}, cn)};
+
+    size_t raw_bytes, compressed_bytes;
+    dump_load_compressed_params(fname, tensors, {}, 0, raw_bytes);
+    ParamCompression compression;
+    compression.codec = ParamCompression::Codec::LZ4;
+    compression.chunk_size = 1000;
+    compression.min_size = 64;
+    for (size_t nr_threads : {1, 4}) {
+        auto got = dump_load_compressed_params(fname, tensors, compression,
+                                               nr_threads, compressed_bytes);
+        for (size_t i = 0; i < tensors.size(); ++i) {
+            MGB_ASSERT_TENSOR_EQ(*tensors[i], got[i]);
+        }
+        // random values are incompressible and stored as is
+        ASSERT_LT(compressed_bytes, raw_bytes);
+    }
+}
+
+TEST(TestSerializer2, CompressedParamEncoding) {
+    auto fname = GET_OUTPUT_FILE();
+    auto cn = CompNode::load("cpu0");
+    HostTensorGenerator<> gen;
+    auto ints = std::make_shared<HostTensorND>(cn, TensorShape{600},
+                                               dtype::Int32());
+    for (size_t i = 0; i < 600; ++i) {
+        ints->ptr<int>()[i] = i * 7;
+    }
+    // channels of the first param have different ranges
+    auto weight = gen({16, 3, 3, 3}, cn);
+    for (size_t i = 0; i < 16 * 27; ++i) {
+        weight->ptr<float>()[i] *= (i / 27 + 1) * 10;
+    }
+    std::vector<std::shared_ptr<HostTensorND>> tensors{
+            weight, gen({1000}, cn), ints, gen({2, 3}, cn)};
+
+    size_t raw_bytes, value_bytes;
+    dump_load_compressed_params(fname, tensors, {}, 0, raw_bytes);
+    for (auto codec : {ParamCompression::Codec::NONE,
+                       ParamCompression::Codec::LZ4}) {
+        ParamCompression compression;
+        compression.codec = codec;
+        compression.chunk_size = 256;
+        compression.min_size = 256;
+
+        compression.encoding = ParamCompression::Encoding::FLOAT16;
+        auto got = dump_load_compressed_params(fname, tensors, compression,
+                                               4, value_bytes);
+        for (size_t i = 0; i < tensors.size(); ++i) {
+            MGB_ASSERT_TENSOR_NEAR(*tensors[i], got[i], 1e-3);
+        }
+        ASSERT_LT(value_bytes, raw_bytes);
+
+        compression.encoding = ParamCompression::Encoding::INT8;
+        got = dump_load_compressed_params(fname, tensors, compression, 4,
+                                          value_bytes);
+        // the error is at most half of the scale of each channel
+        for (size_t c = 0; c < 16; ++c) {
+            float amax = 0;
+            for (size_t i = c * 27; i < (c + 1) * 27; ++i) {
+                amax = std::max(amax, std::abs(weight->ptr<float>()[i]));
+            }
+            for (size_t i = c * 27; i < (c + 1) * 27; ++i) {
+                ASSERT_NEAR(weight->ptr<float>()[i], got[0].ptr<float>()[i],
+                            amax / 127 * 0.51);
+            }
+        }
+        MGB_ASSERT_TENSOR_NEAR(*tensors[1], got[1], 0.05);
+        // other dtypes and small params are stored as is
+        MGB_ASSERT_TENSOR_EQ(*tensors[2], got[2]);
+        MGB_ASSERT_TENSOR_EQ(*tensors[3], got[3]);
+        ASSERT_LT(value_bytes, raw_bytes);
+    }
+}
+
+TEST(TestSerializer2, ParallelTensorLoad) {
+    auto fname = GET_OUTPUT_FILE();
+    auto cn = CompNode::load("cpu0");
+    HostTensorGenerator<> gen;
+    auto host_x = gen({3, 4}, cn);
+    std::vector<std::shared_ptr<HostTensorND>> params;
+    for (size_t i = 0; i < 20; ++i) {
+        params.push_back(gen({i % 5 + 1, 100}, cn));
+    }
+
+    for (bool compressed : {false, true}) {
+        {
+            auto graph = ComputingGraph::make();
+            SymbolVarArray outputs;
+            outputs.push_back(
+                    opr::Host2DeviceCopy::make(*graph, host_x, {"x"}) * 2);
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (i % 2) {
+                    outputs.push_back(
+                            opr::ImmutableTensor::make(*graph, *params[i]));
+                } else {
+                    outputs.push_back(
+                            opr::SharedDeviceTensor::make(*graph, *params[i]));
+                }
+            }
+            GraphDumper::DumpConfig config;
+            if (compressed) {
+                config.param_compression.codec = ParamCompression::Codec::LZ4;
+                config.param_compression.chunk_size = 400;
+                config.param_compression.min_size = 0;
+            }
+            GraphDumper::make(OutputFile::make_fs(fname.c_str()),
+                              GraphDumpFormat::FLATBUFFERS)
+                    ->dump(outputs, config);
+        }
+
+        for (bool mmap : {false, true}) {
+            auto loader = GraphLoader::make(
+                    mmap ? InputFile::make_mmap(fname.c_str())
+                         : InputFile::make_fs(fname.c_str()),
+                    GraphDumpFormat::FLATBUFFERS);
+            GraphLoader::LoadConfig config;
+            config.parallel_tensor_load = true;
+            config.nr_load_threads = 3;
+            // the second load uses the cached values of shared tensors
+            for (int load = 0; load < 2; ++load) {
+                auto rst = loader->load(config);
+                ASSERT_EQ(load == 0, rst.parallel_tensor_load);
+                ASSERT_GE(rst.phase_time.load_oprs, 0);
+                auto&& x = rst.tensor_map.at("x");
+                x->copy_from(*host_x);
+                std::vector<HostTensorND> got(params.size() + 1);
+                ComputingGraph::OutputSpec out_spec;
+                for (size_t i = 0; i < got.size(); ++i) {
+                    out_spec.push_back(make_callback_copy(
+                            rst.output_var_list.at(i), got[i]));
+                }
+                rst.graph_compile(out_spec)->execute();
+                for (size_t i = 0; i < 12; ++i) {
+                    ASSERT_FLOAT_EQ(host_x->ptr<float>()[i] * 2,
+                                    got[0].ptr<float>()[i]);
+                }
+                for (size_t i = 0; i < params.size(); ++i) {
+                    MGB_ASSERT_TENSOR_EQ(*params[i], got[i + 1]);
+                }
+            }
+        }
+    }
+}
+
+TEST(TestSerializer2, ParallelTensorLoadCorrupted) {
+    auto fname = GET_OUTPUT_FILE();
+    auto cn = CompNode::load("cpu0");
+    auto param = std::make_shared<HostTensorND>(cn, TensorShape{4000});
+    for (size_t i = 0; i < 4000; ++i) {
+        param->ptr<float>()[i] = 1;
+    }
+    {
+        auto graph = ComputingGraph::make();
+        GraphDumper::DumpConfig config;
+        config.param_compression.codec = ParamCompression::Codec::LZ4;
+        config.param_compression.chunk_size = 400;
+        config.param_compression.min_size = 0;
+        GraphDumper::make(OutputFile::make_fs(fname.c_str()),
+                          GraphDumpFormat::FLATBUFFERS)
+                ->dump({opr::SharedDeviceTensor::make(*graph, *param)},
+                       config);
+    }
+
+    // the only tensor value ends where the graph begins; overwrite its last
+    // compressed chunks so that they can not be decompressed
+    {
+        FILE* fout = fopen(fname.c_str(), "r+b");
+        ASSERT_NE(nullptr, fout);
+        uint64_t offset_to_fbs;
+        ASSERT_EQ(0, fseek(fout, 8, SEEK_SET));
+        ASSERT_EQ(1u, fread(&offset_to_fbs, sizeof(offset_to_fbs), 1, fout));
+        ASSERT_GT(offset_to_fbs, 64u);
+        ASSERT_EQ(0, fseek(fout, 16 + offset_to_fbs - 64, SEEK_SET));
+        std::vector<uint8_t> garbage(64, 0xFF);
+        ASSERT_EQ(garbage.size(),
+                  fwrite(garbage.data(), 1, garbage.size(), fout));
+        fclose(fout);
+    }
+
+    for (bool parallel : {false, true}) {
+        auto loader = GraphLoader::make(InputFile::make_fs(fname.c_str()),
+                                        GraphDumpFormat::FLATBUFFERS);
+        GraphLoader::LoadConfig config;
+        config.parallel_tensor_load = parallel;
+        config.nr_load_threads = 3;
+        ASSERT_THROW(loader->load(config), SerializationError);
+    }
+}
 #endif